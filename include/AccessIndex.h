@@ -0,0 +1,81 @@
+#ifndef SLATE_ACCESS_INDEX_H
+#define SLATE_ACCESS_INDEX_H
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+///An in-memory record of which groups may use which clusters, and which
+///applications each group may install on each cluster, so that authorization
+///checks can be answered without consulting the database.
+///
+///Groups and clusters are assigned dense slot numbers, and each cluster has a
+///bitset with one bit per group slot, so checking a group's access to a
+///cluster costs two hash lookups and a bit test. Application permissions are
+///kept per (cluster, group) pair.
+///
+///This class does no locking of its own.
+class AccessIndex{
+public:
+	///\param anyGroup the group ID which stands for all groups
+	///\param anyApplication the application name which stands for all
+	///                      applications
+	AccessIndex(std::string anyGroup, std::string anyApplication);
+
+	///Record whether a group has access to a cluster
+	///\param groupID the group, or anyGroup to grant access to all groups
+	void setGroupAccess(const std::string& cID, const std::string& groupID, bool allowed);
+	///\return whether a group has been given access to a cluster, either
+	///        specifically or because all groups have
+	bool groupHasAccess(const std::string& cID, const std::string& groupID) const;
+	///\return whether all groups have been given access to a cluster
+	bool allowsAllGroups(const std::string& cID) const;
+	///\return the IDs of the groups specifically given access to a cluster, in
+	///        sorted order, not including anyGroup
+	std::vector<std::string> groupsWithAccess(const std::string& cID) const;
+
+	///Record the applications which a group may use on a cluster
+	///\param applications the permitted applications, which may contain
+	///                    anyApplication
+	void setApplications(const std::string& cID, const std::string& groupID,
+	                     std::set<std::string> applications);
+	///\return the applications which a group may use on a cluster. If no
+	///        permissions have been recorded, this is just anyApplication.
+	std::set<std::string> applications(const std::string& cID, const std::string& groupID) const;
+	///\return whether a group may use an application on a cluster
+	bool applicationAllowed(const std::string& cID, const std::string& groupID,
+	                        const std::string& application) const;
+
+	///\return the numbers of groups and clusters known to the index
+	std::size_t groupCount() const{ return groupIDs.size(); }
+	std::size_t clusterCount() const{ return clusterSlots.size(); }
+
+private:
+	using Bitset=std::vector<uint64_t>;
+	const static std::size_t noSlot;
+
+	std::string anyGroup;
+	std::string anyApplication;
+
+	std::unordered_map<std::string,std::size_t> groupSlots;
+	///Group IDs, indexed by slot
+	std::vector<std::string> groupIDs;
+	std::unordered_map<std::string,std::size_t> clusterSlots;
+	///The groups with access to each cluster, indexed by cluster slot
+	std::vector<Bitset> access;
+	///Application permissions, keyed by cluster slot and group slot
+	std::unordered_map<uint64_t,std::set<std::string>> applicationSets;
+
+	std::size_t findSlot(const std::unordered_map<std::string,std::size_t>& slots,
+	                     const std::string& id) const;
+	std::size_t groupSlot(const std::string& groupID);
+	std::size_t clusterSlot(const std::string& cID);
+	static uint64_t pairKey(std::size_t clusterSlot, std::size_t groupSlot){
+		return ((uint64_t)clusterSlot<<32) | (uint64_t)groupSlot;
+	}
+	bool testBit(std::size_t clusterSlot, std::size_t groupSlot) const;
+};
+
+#endif //SLATE_ACCESS_INDEX_H
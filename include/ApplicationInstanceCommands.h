@@ -7,6 +7,9 @@
 
 ///List application instances which currently exist
 crow::response listApplicationInstances(PersistentStore& store, const crow::request& req);
+///Compute the entity tag for the current result of listApplicationInstances
+///\return the tag, or an empty string if a filter refers to nothing which exists
+std::string listApplicationInstancesETag(PersistentStore& store, const crow::request& req);
 ///Destroy an instance of an application
 ///\param instanceID the instance to query
 crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::request& req, const std::string& instanceID);
@@ -22,6 +22,12 @@ void gzipDecompress(std::istream& src, std::ostream& dest);
 ///compress gzipped data from one stream to another
 void gzipCompress(std::istream& src, std::ostream& dest);
 
+///decompress gzipped data held in memory
+std::string gzipDecompress(const std::string& data);
+
+///compress data held in memory with gzip
+std::string gzipCompress(const std::string& data);
+
 //A simple interface for reading a tarball. 
 //Files are read in on demand, and can be dropped from memory when no longer needed. 
 //Once dropped, a file cannot be retrieved again. 
@@ -0,0 +1,117 @@
+#ifndef SLATE_BLOCKING_EXECUTOR_H
+#define SLATE_BLOCKING_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "crow.h"
+
+///Runs work which may block for a long time, such as request handlers which
+///contact Kubernetes clusters or run helm, on its own bounded set of threads,
+///so that the web server's threads remain free to answer requests which can
+///be served from cached data.
+///
+///Work is queued by a key, normally the ID of the cluster it will contact.
+///Workers take work from the keys in turn, and at most a limited number of
+///tasks for any one key may run at once, so that a few slow clusters cannot
+///occupy every worker. Work with an empty key, which has no single resource
+///to which it can be attributed, shares a separate limit.
+class BlockingExecutor{
+public:
+	///\param threads the number of worker threads
+	///\param maxQueued the number of tasks which may wait for a worker before
+	///                 further tasks are rejected
+	///\param perKeyLimit the number of tasks with the same non-empty key which
+	///                   may run at once
+	///\param unkeyedLimit the number of tasks with an empty key which may run
+	///                    at once
+	BlockingExecutor(unsigned int threads, std::size_t maxQueued, unsigned int perKeyLimit,
+	                 unsigned int unkeyedLimit);
+	///Waits for all queued work to finish
+	~BlockingExecutor();
+
+	BlockingExecutor(const BlockingExecutor&)=delete;
+	BlockingExecutor& operator=(const BlockingExecutor&)=delete;
+
+	///Queue a task to be run by a worker
+	///\param key the resource which the task will use
+	///\param task the work to run
+	///\return false if too many tasks are already waiting, in which case the
+	///        task will not be run
+	bool submit(const std::string& key, std::function<void()> task);
+
+	///Run a request handler on a worker, and complete the response with its
+	///result on the thread which owns the connection. If too many tasks are
+	///waiting, the response is instead completed immediately with status 503.
+	///Requests which do not belong to a connection, such as the parts of a
+	///multiplexed request, are handled immediately on the calling thread.
+	///\param key the resource which the handler will use
+	///\param req the request being handled, which must remain valid until the
+	///           response is completed
+	///\param res the response to complete
+	///\param handler the function which produces the response
+	void dispatch(const std::string& key, const crow::request& req, crow::response& res,
+	              std::function<crow::response()> handler);
+
+	///\return the number of tasks waiting for a worker
+	std::size_t getQueueDepth() const;
+	///\return the number of tasks currently running
+	std::size_t getRunning() const;
+	///\return the number of tasks which were rejected because too many were
+	///        waiting
+	std::size_t getRejected() const;
+	///\return counts of waiting, running, and rejected tasks and the time
+	///        tasks have waited for workers, as lines of text
+	std::string getStatistics() const;
+
+private:
+	using clock=std::chrono::steady_clock;
+
+	struct Task{
+		std::function<void()> work;
+		clock::time_point queued;
+	};
+
+	struct KeyQueue{
+		std::deque<Task> tasks;
+		///The number of this key's tasks being run by workers
+		unsigned int running;
+		///Whether the key is in the ready list
+		bool ready;
+		KeyQueue():running(0),ready(false){}
+	};
+
+	const std::size_t maxQueued;
+	const unsigned int perKeyLimit;
+	const unsigned int unkeyedLimit;
+
+	mutable std::mutex mut;
+	///Signalled when a key becomes ready, or the executor is stopping
+	std::condition_variable available;
+	std::map<std::string,KeyQueue> queues;
+	///Keys which have tasks which may be started now, in the order in which
+	///workers should serve them
+	std::deque<std::string> ready;
+	std::size_t queued;
+	std::size_t running;
+	std::size_t completed;
+	std::size_t rejected;
+	clock::duration totalWait;
+	clock::duration maxWait;
+	bool stopping;
+	std::vector<std::thread> workers;
+
+	///Add a key to the ready list if it has tasks and is under its limit.
+	///Must be called with mut held.
+	void updateReady(const std::string& key, KeyQueue& queue);
+	void work();
+};
+
+#endif //SLATE_BLOCKING_EXECUTOR_H
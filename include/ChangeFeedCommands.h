@@ -0,0 +1,28 @@
+#ifndef SLATE_CHANGE_FEED_COMMANDS_H
+#define SLATE_CHANGE_FEED_COMMANDS_H
+
+#include <set>
+#include <string>
+
+#include "crow.h"
+#include "PersistentStore.h"
+
+///Whether a user may learn of a change. Non-administrators may only observe 
+///the kinds of records which any user could list, and changes to application 
+///instances and volumes belonging to groups of which they are members. 
+bool mayObserveChange(PersistentStore& store, const User& user, const ChangeEvent& event);
+///Whether a user may learn of a change, given the groups of which the user is 
+///already known to be a member, so that the database need not be consulted
+///\param groupIDs the IDs of the groups of which the user is a member
+bool mayObserveChange(const User& user, const std::set<std::string>& groupIDs, 
+                      const ChangeEvent& event);
+
+///List the modifications made through the persistent store after a given 
+///revision, optionally waiting for one to occur
+///\param maxWaiters the number of requests which may wait for changes at the 
+///                  same time. Requests which would wait beyond this limit 
+///                  are refused with status 429. 
+crow::response listChanges(PersistentStore& store, const crow::request& req, 
+                           unsigned int maxWaiters);
+
+#endif //SLATE_CHANGE_FEED_COMMANDS_H
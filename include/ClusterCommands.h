@@ -1,12 +1,17 @@
 #ifndef SLATE_CLUSTER_COMMANDS_H
 #define SLATE_CLUSTER_COMMANDS_H
 
+#include <chrono>
+#include <future>
+
 #include "crow.h"
 #include "Entities.h"
 #include "PersistentStore.h"
 
 ///List currently known clusters
 crow::response listClusters(PersistentStore& store, const crow::request& req);
+///Compute the entity tag for the current result of listClusters
+std::string listClustersETag(PersistentStore& store, const crow::request& req);
 ///Register a new cluster
 crow::response createCluster(PersistentStore& store, const crow::request& req);
 ///Get a cluster's information
@@ -99,6 +104,17 @@ namespace internal{
 	///\return a string describing the error which has occured, or an empty 
 	///        string indicating success
 	std::string deleteCluster(PersistentStore& store, const Cluster& cluster, bool force);
+	
+	///Wait a limited time for a cluster's DNS record to be made, and describe
+	///the result to the user
+	///\param recordMade the result of the record change
+	///\param name the domain within which the cluster's services are given 
+	///            subdomains
+	///\param wait how long to wait for the change before reporting that it is
+	///            still pending
+	///\return a message for the user
+	std::string describeDNSRecordChange(const std::shared_future<bool>& recordMade, const std::string& name,
+	                                    std::chrono::milliseconds wait);
 }
 
 #endif //SLATE_CLUSTER_COMMANDS_H
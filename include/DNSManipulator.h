@@ -1,40 +1,114 @@
 #ifndef SLATE_DNSMANIPULATOR_H
 #define SLATE_DNSMANIPULATOR_H
 
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <aws/core/Aws.h>
 #include <aws/core/auth/AWSCredentialsProvider.h>
 #include <aws/route53/Route53Client.h>
 
+///Makes the DNS records for clusters in Route53.
+///
+///Record changes are queued and submitted by a background thread, so that
+///requests do not wait for Route53. Changes queued within a short time of
+///each other are submitted together, with one ChangeResourceRecordSets call
+///per hosted zone, and a later change to a name replaces an earlier one which
+///has not yet been submitted.
 class DNSManipulator{
 public:
-	DNSManipulator(const Aws::Auth::AWSCredentials& credentials, 
-	               const Aws::Client::ClientConfiguration& clientConfig);
-	
+	///\param credentials the AWS credentials used for authentication
+	///\param clientConfig the configuration used for the database; Route53 is
+	///                    used only if this refers to AWS
+	///\param route53Endpoint a Route53 endpoint to use instead of the AWS one,
+	///                       such as a local stand-in for testing
+	DNSManipulator(const Aws::Auth::AWSCredentials& credentials,
+	               const Aws::Client::ClientConfiguration& clientConfig,
+	               const std::string& route53Endpoint="");
+	///Submits any queued changes before returning
+	~DNSManipulator();
+
+	DNSManipulator(const DNSManipulator&)=delete;
+	DNSManipulator& operator=(const DNSManipulator&)=delete;
+
 	///\return Whether this object is able to make DNS changes, because it is
-	///        associated with a valid Rout53 server and account. 
+	///        associated with a valid Rout53 server and account.
 	bool canUpdateDNS() const{ return validServer; }
-	
-	///Get the version of a record currently stored in Route53, 
+
+	///Get the version of a record currently stored in Route53,
 	///which may not match actual DNS queries due to propagation delay.
 	std::vector<std::string> getDNSRecord(Aws::Route53::Model::RRType type, const std::string& name) const;
-	///Create a DNS record associating a name with an address
-	bool setDNSRecord(const std::string& name, const std::string& address);
-	///Delete the DNS record which associates a particular name with an address
-	bool removeDNSRecord(const std::string& name, const std::string& address);
+	///Queue the creation of a DNS record associating a name with an address
+	///\return a future which becomes true once the record has been made, or
+	///        false if it could not be, including because the name has a
+	///        record which was not made by SLATE
+	///\throws std::runtime_error if the address is not valid
+	std::shared_future<bool> setDNSRecord(const std::string& name, const std::string& address);
+	///Queue the deletion of the DNS records which SLATE made for a name
+	///\return a future which becomes true once no such records remain, or
+	///        false if they could not be deleted
+	std::shared_future<bool> removeDNSRecords(const std::string& name);
+	///Submit all queued changes without waiting for more to be combined with
+	///them
+	void flush();
 private:
+	using clock=std::chrono::steady_clock;
+
+	///A change to the records for one name which has not yet been submitted
+	struct PendingChange{
+		///Whether the records are to be deleted, rather than set
+		bool remove;
+		std::string address;
+		Aws::Route53::Model::RRType type;
+		///Fulfilled with the result of the change, and of any earlier changes
+		///which it replaced
+		std::vector<std::promise<bool>> results;
+		///The time at which the earliest of the changes was queued
+		clock::time_point queued;
+	};
+
 	static std::string zoneForName(const std::string& name);
-	
-	bool safeToModifyDNS(const std::string& name, Aws::Route53::Model::RRType type) const;
+
+	///Find the ID of the hosted zone containing a name, refreshing the list of
+	///zones if it is not known
+	///\return the zone ID, or an empty string if there is no such zone
+	std::string zoneID(const std::string& name) const;
+	///Fetch the list of hosted zones. Must be called with zoneMut held.
+	///\throws std::runtime_error if the zones cannot be listed
+	void loadHostedZones() const;
+
+	std::shared_future<bool> queueChange(const std::string& name, PendingChange change);
+	///Make a set of changes, all of which are for names in the same zone
+	void submitChanges(const std::string& zoneID, std::map<std::string,PendingChange>& changes);
+	void work();
 
 	Aws::Route53::Route53Client dnsClient;
-	std::map<std::string,std::string> hostedZones;
 	bool validServer;
-	
+
+	mutable std::mutex zoneMut;
+	///Hosted zone IDs, keyed by zone name
+	mutable std::map<std::string,std::string> hostedZones;
+	mutable clock::time_point zonesLoaded;
+
+	///The time to wait after a change is queued for others to combine with it
+	const std::chrono::milliseconds batchDelay;
+	std::mutex changeMut;
+	///Signalled when a change is queued, or changes should be submitted
+	///immediately
+	std::condition_variable changeQueued;
+	///Changes waiting to be submitted, keyed by record name
+	std::map<std::string,PendingChange> pendingChanges;
+	bool flushRequested;
+	bool stopping;
+	std::thread worker;
+
 	const static std::string heritageTag;
 };
 
-#endif //SLATE_DNSMANIPULATOR_H
\ No newline at end of file
+#endif //SLATE_DNSMANIPULATOR_H
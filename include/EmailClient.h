@@ -0,0 +1,138 @@
+#ifndef SLATE_EMAIL_CLIENT_H
+#define SLATE_EMAIL_CLIENT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///An interface for sending email with the MailGun service
+class EmailClient{
+public:
+	struct Email{
+		std::string fromAddress;
+		std::vector<std::string> toAddresses;
+		std::vector<std::string> ccAddresses;
+		std::vector<std::string> bccAddresses;
+		std::string replyTo;
+		std::string subject;
+		std::string body;
+	};
+
+	EmailClient():valid(false){}
+	EmailClient(const std::string& mailgunEndpoint,
+	            const std::string& mailgunKey, const std::string& emailDomain);
+	bool canSendEmail() const{ return valid; }
+	bool sendEmail(const Email& email);
+private:
+	std::string mailgunEndpoint;
+	std::string mailgunKey;
+	std::string emailDomain;
+	bool valid;
+};
+
+///Sends email from a background thread, so that request handlers only need
+///to queue their notifications and are not delayed, or made to fail, by a
+///slow or unavailable mail service.
+///
+///Messages queued within a short time of each other with the same sender and
+///recipients are combined into one email. Messages which cannot be sent are
+///retried with increasing delays, and are discarded only after several
+///failures. If a spool directory is given, each message is also written
+///there until it is sent, so that messages queued before the server stops are
+///sent after it restarts.
+class EmailQueue{
+public:
+	using Email=EmailClient::Email;
+
+	struct Options{
+		///The directory in which to keep unsent messages, or an empty string
+		///to keep them only in memory
+		std::string spoolDirectory;
+		///The number of unsent messages which may be held before further
+		///messages are discarded
+		std::size_t maxQueued;
+		///The time to wait after a message is queued for others to the same
+		///recipients
+		std::chrono::milliseconds batchDelay;
+		///The delay before the first retry of a failed message, which doubles
+		///after each further failure
+		std::chrono::milliseconds retryDelay;
+		///The number of times to attempt to send a message
+		unsigned int maxAttempts;
+
+		Options():maxQueued(1000),batchDelay(2000),retryDelay(10000),maxAttempts(8){}
+	};
+
+	///\param send the function which actually sends a message, returning
+	///            whether it was successful
+	///\param options the limits on queueing and retries
+	EmailQueue(std::function<bool(const Email&)> send, Options options=Options());
+	///Stops the background thread. Messages which have not been sent remain
+	///in the spool directory, if there is one.
+	~EmailQueue();
+
+	EmailQueue(const EmailQueue&)=delete;
+	EmailQueue& operator=(const EmailQueue&)=delete;
+
+	///Queue a message to be sent
+	///\return false if too many messages are already waiting, in which case
+	///        the message is discarded
+	bool enqueue(Email email);
+
+	///\return the number of messages which have not yet been sent
+	std::size_t getQueueDepth() const;
+	///\return counts of queued, sent, retried, and discarded messages, as
+	///        lines of text
+	std::string getStatistics() const;
+
+private:
+	using clock=std::chrono::steady_clock;
+
+	///A message, or several combined messages, waiting to be sent
+	struct Pending{
+		Email email;
+		///The number of messages combined into this one
+		std::size_t count;
+		///The spool files holding the original messages
+		std::vector<std::string> spoolFiles;
+		unsigned int attempts;
+		///The earliest time at which to try to send this message
+		clock::time_point due;
+	};
+
+	const std::function<bool(const Email&)> send;
+	const Options options;
+
+	mutable std::mutex mut;
+	///Signalled when a message is queued, or the queue is stopping
+	std::condition_variable changed;
+	std::deque<Pending> pending;
+	///The number of original messages in pending
+	std::size_t queued;
+	std::size_t sent;
+	std::size_t emailsSent;
+	std::size_t retried;
+	std::size_t failed;
+	std::size_t dropped;
+	///Used to give spool files unique names
+	unsigned long long spoolCounter;
+	bool stopping;
+	std::thread worker;
+
+	///Write a message to the spool directory
+	///\return the path of the file written, or an empty string on failure
+	std::string spool(const Email& email);
+	///Queue the messages left in the spool directory by an earlier run
+	void loadSpool();
+	void work();
+};
+
+///Combine messages to the same recipients into a single email
+EmailClient::Email combineEmails(const std::vector<EmailClient::Email>& emails);
+
+#endif //SLATE_EMAIL_CLIENT_H
@@ -0,0 +1,151 @@
+#ifndef SLATE_EVENT_STREAM_H
+#define SLATE_EVENT_STREAM_H
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "crow.h"
+#include "rapidjson/document.h"
+#include "Entities.h"
+#include "PersistentStore.h"
+
+// Number of events a client may have outstanding without acknowledging them
+static constexpr size_t DEFAULT_EVENT_WINDOW = 256;
+// Number of events held back for a client whose window is full before it is
+// instead told to resynchronize
+static constexpr size_t DEFAULT_EVENT_QUEUE_LIMIT = 1024;
+// Number of bytes which may be waiting to be written to a client's socket 
+// before further events are held back
+static constexpr size_t DEFAULT_EVENT_WRITE_LIMIT = 1024*1024;
+
+///Pushes changes from the persistent store's change log to WebSocket clients.
+///
+///After connecting with a valid token, a client sends JSON messages of the
+///forms
+///    {"action":"subscribe","groups":[...],"clusters":[...],"instances":[...]}
+///    {"action":"unsubscribe","groups":[...],"clusters":[...],"instances":[...]}
+///    {"action":"ack","revision":N}
+///Groups and clusters may be given by name or ID, and "*" subscribes to
+///everything. The client then receives an Event message for each change to a
+///subscribed record or to any record belonging to a subscribed group or
+///cluster.
+///
+///To keep slow clients from accumulating unbounded buffers on the server, at
+///most a window of events is sent ahead of the revision the client has
+///acknowledged, and no more is sent while the connection's unwritten data 
+///exceeds a limit. Further events are queued up to a limit, beyond which the
+///queue is discarded and the client is sent a Resync message once it catches
+///up, indicating that it must re-list records and resume from the given
+///revision. The same happens if the change log itself has discarded events
+///which had not yet been sent, or if the store begins a new generation epoch
+///because it may have missed changes.
+///
+///All sending happens on the thread which services each connection, since a
+///connection may close and be destroyed at any time on that thread. 
+///
+///Which groups each client's user belongs to is looked up when it connects 
+///and subscribes, and again when a change to the user is seen, without 
+///holding the lock shared by all connections, so that events can be filtered 
+///without consulting the database. 
+class EventStream{
+public:
+	///\param store the store whose changes should be published
+	///\param window the maximum number of unacknowledged events per client
+	///\param queueLimit the maximum number of events held back per client
+	///\param writeLimit the number of unwritten bytes per client beyond which 
+	///                  events are held back
+	EventStream(PersistentStore& store, std::size_t window=DEFAULT_EVENT_WINDOW,
+	            std::size_t queueLimit=DEFAULT_EVENT_QUEUE_LIMIT,
+	            std::size_t writeLimit=DEFAULT_EVENT_WRITE_LIMIT);
+	~EventStream();
+
+	EventStream(const EventStream&)=delete;
+	EventStream& operator=(const EventStream&)=delete;
+
+	///Decide whether to accept a connection, based on the token in its query
+	///string. Must be followed on the same thread by a call to open for an
+	///accepted connection, as crow does.
+	bool accept(const crow::request& req);
+	///Begin tracking a newly opened connection
+	void open(crow::websocket::connection& conn);
+	///Handle a message from a client
+	void message(crow::websocket::connection& conn, const std::string& data, bool binary);
+	///Stop tracking a connection which is closing
+	void close(crow::websocket::connection& conn);
+
+	///\return the number of currently connected clients
+	std::size_t clientCount() const;
+
+private:
+	struct Subscriber{
+		User user;
+		///IDs of the groups of which the user is a member, used to decide 
+		///which changes it may observe
+		std::set<std::string> groups;
+		///IDs of subscribed records, groups, and clusters
+		std::set<std::string> subscriptions;
+		bool all=false;
+		///Revisions sent but not yet acknowledged, in order
+		std::deque<uint64_t> unacknowledged;
+		///Events waiting for room in the window
+		std::deque<ChangeEvent> pending;
+		///Whether events were discarded so that the client must resynchronize
+		bool overflowed=false;
+		///Cleared when the connection closes, so that work already posted to 
+		///the connection's thread does not touch it afterwards
+		std::shared_ptr<bool> alive;
+		///Whether a flush has been posted to the connection's thread but has 
+		///not yet run
+		bool flushPosted=false;
+	};
+
+	PersistentStore& store;
+	const std::size_t window;
+	const std::size_t queueLimit;
+	const std::size_t writeLimit;
+
+	mutable std::mutex mut;
+	std::map<crow::websocket::connection*,Subscriber> subscribers;
+	///The revision of the most recent change distributed to subscribers
+	uint64_t dispatchedRevision;
+
+	std::atomic<bool> stop;
+	std::thread dispatcher;
+
+	///Repeatedly wait for new changes and distribute them to subscribers
+	void dispatch();
+	///Look up the groups of which a user is a member. This may contact the 
+	///database, so it must not be called with mut held. 
+	///\return the IDs of the user's groups, which are not needed for 
+	///        administrators and so are not looked up for them
+	std::set<std::string> lookupGroups(const User& user);
+	///Whether a subscriber should be sent a change
+	bool matches(const Subscriber& sub, const ChangeEvent& event) const;
+	///Queue an event for a subscriber, and arrange for it to be sent
+	///Must be called with mut held
+	void deliver(crow::websocket::connection& conn, Subscriber& sub, const ChangeEvent& event);
+	///Arrange for flush to be called on the connection's thread, unless it 
+	///already has been
+	///Must be called with mut held
+	void schedule(crow::websocket::connection& conn, Subscriber& sub);
+	///Discard all subscribers' queued events and tell them to resynchronize
+	///Must be called with mut held
+	void resynchronizeAll();
+	///Send as many queued events as the subscriber's window and the 
+	///connection's write buffer allow
+	///Must be called with mut held, on the connection's thread
+	void flush(crow::websocket::connection& conn, Subscriber& sub);
+	///Look up the IDs of the records named in a subscription request
+	///\param ids the set to which the IDs will be added
+	///\param all will be set if the request includes the "*" wildcard
+	///\return an error message, or an empty string on success
+	std::string resolveSubscriptions(const rapidjson::Document& request, 
+	                                 std::set<std::string>& ids, bool& all);
+};
+
+#endif //SLATE_EVENT_STREAM_H
@@ -7,21 +7,28 @@
 ///A RAII object for managing the lifetimes of temporary files
 struct FileHandle{
 public:
-	FileHandle(){}
+	FileHandle():fd(-1){}
 	///Construct a handle to own the file at the given path
 	///\param filePath the path to the file, which should already exist
 	///\param isDirectory whether the path is for a directory rather than a 
 	///                   regular file
 	FileHandle(const std::string& filePath, bool isDirectory=false):
-	filePath(filePath),isDirectory(isDirectory){}
+	filePath(filePath),isDirectory(isDirectory),fd(-1){}
+	///Construct a handle to own an open file which has no name in the 
+	///filesystem
+	///\param fd the file descriptor for the file
+	///\param filePath a path through which the file can be opened
+	FileHandle(int fd, const std::string& filePath):
+	filePath(filePath),isDirectory(false),fd(fd){}
 	///Destroys the associated file
 	~FileHandle();
 	///Copying is forbidden
 	FileHandle(const FileHandle&)=delete;
 	///Move from a handle
 	FileHandle(FileHandle&& other):
-	filePath(other.filePath),isDirectory(other.isDirectory){
+	filePath(other.filePath),isDirectory(other.isDirectory),fd(other.fd){
 		other.filePath="";
+		other.fd=-1;
 	}
 	///Copy assignment is forbidden
 	FileHandle& operator=(const FileHandle&)=delete;
@@ -30,6 +37,7 @@ public:
 		if(this!=&other){
 			std::swap(filePath,other.filePath);
 			std::swap(isDirectory,other.isDirectory);
+			std::swap(fd,other.fd);
 		}
 		return *this;
 	}
@@ -42,6 +50,8 @@ private:
 	std::string filePath;
 	///whether the file is a directory
 	bool isDirectory;
+	///the descriptor for an anonymous file, or -1
+	int fd;
 };
 
 ///Concatenate a string with the path stored in a file handle
@@ -72,4 +82,18 @@ FileHandle makeTemporaryFile(const std::string& nameBase);
 ///                created relative to the current working directory. 
 FileHandle makeTemporaryDir(const std::string& nameBase);
 
+///Create a handle for a file with the given contents which is held only in
+///memory, so that small inputs for child processes (configuration values, 
+///manifests, kubeconfigs) can be passed to them without any disk I/O. 
+///The path of the file refers to it through /proc, so it can be opened by 
+///other processes run by the same user, including ones which do not inherit
+///the descriptor. The file ceases to exist when the handle is dropped. 
+///On systems which do not support memfd_create this falls back to creating a
+///regular temporary file with makeTemporaryFile. 
+///\param nameBase the name for the file, which is visible only for debugging, 
+///                and the prefix for the path of the file when falling back to
+///                makeTemporaryFile
+///\param contents the data to place in the file
+FileHandle makeMemoryFile(const std::string& nameBase, const std::string& contents);
+
 #endif //SLATE_FILEHANDLE_H
@@ -7,11 +7,16 @@
 
 ///List currently groups which exist
 crow::response listGroups(PersistentStore& store, const crow::request& req);
+///Compute the entity tag for the current result of listGroups
+std::string listGroupsETag(PersistentStore& store, const crow::request& req);
 ///Register a new group
 crow::response createGroup(PersistentStore& store, const crow::request& req);
 ///Get a Group's information
 ///\param groupID the Group to look up
 crow::response getGroupInfo(PersistentStore& store, const crow::request& req, const std::string& groupID);
+///Compute the entity tag for the current result of getGroupInfo
+///\return the tag, or an empty string if the Group does not exist
+std::string getGroupInfoETag(PersistentStore& store, const crow::request& req, const std::string& groupID);
 ///Change a Group's information
 ///\param groupID the Group to update
 crow::response updateGroup(PersistentStore& store, const crow::request& req, const std::string& groupID);
@@ -1,6 +1,7 @@
 #ifndef SLATE_HTTPREQUESTS_H
 #define SLATE_HTTPREQUESTS_H
 
+#include <future>
 #include <map>
 #include <string>
 
@@ -13,6 +14,8 @@
 #endif
 
 ///Trivial HTTP(S) request wrappers around libcurl. 
+///Connections are kept open after each request and reused by later requests
+///to the same server, and HTTP/2 is used when the server supports it. 
 namespace httpRequests{
 
 	struct Options{
@@ -23,6 +26,9 @@ namespace httpRequests{
 		///If non-empty, the value to set as curl's CURLOPT_CAINFO for SSL
 		///certificate verification.
 		std::string caBundlePath;
+		///Additional headers to send, such as If-None-Match.
+		///Currently only used for GET requests.
+		std::map<std::string,std::string> headers;
 	};
 
 	///The result of an HTTP(S) request
@@ -31,6 +37,9 @@ namespace httpRequests{
 		unsigned int status;
 		///The data received as the body of the response
 		std::string body;
+		///The headers of the response, with names converted to lower case.
+		///Currently only collected for GET requests.
+		std::map<std::string,std::string> headers;
 	};
 
 	///Make an HTTP(S) GET request
@@ -64,6 +73,32 @@ namespace httpRequests{
 			      const std::multimap<std::string, std::string>& formData,
 			      const Options& options = {});
 
+	///Make an HTTP(S) GET request on a separate thread
+	///\param url the URL to request
+	///\return the eventual response; getting it rethrows any error
+	std::future<Response> httpGetAsync(const std::string& url, const Options& options={});
+
+	///Make an HTTP(S) DELETE request on a separate thread
+	///\param url the URL to request
+	///\return the eventual response; getting it rethrows any error
+	std::future<Response> httpDeleteAsync(const std::string& url, const Options& options={});
+
+	///Make an HTTP(S) PUT request on a separate thread
+	///\param url the URL to request
+	///\param body the data to send as the body of the request
+	///\param options ContentType and CA settings
+	///\return the eventual response; getting it rethrows any error
+	std::future<Response> httpPutAsync(const std::string& url, const std::string& body,
+	                                   const Options& options = {});
+
+	///Make an HTTP(S) POST request on a separate thread
+	///\param url the URL to request
+	///\param body the data to send as the body of the request
+	///\param options ContentType and CA settings
+	///\return the eventual response; getting it rethrows any error
+	std::future<Response> httpPostAsync(const std::string& url, const std::string& body,
+	                                    const Options& options = {});
+
 	#ifdef SLATE_EXTRACT_HOSTNAME_AVAIL
 	///Get the hostname component from a URL.
 	///\throws std::invalid_argument if \p url cannot be parsed as a URL.
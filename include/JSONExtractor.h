@@ -0,0 +1,48 @@
+#ifndef SLATE_JSON_EXTRACTOR_H
+#define SLATE_JSON_EXTRACTOR_H
+
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+///Parses JSON documents keeping only selected parts of them, so that reading a
+///few fields from a large document (such as the output of `kubectl get -o=json`
+///for a busy namespace) does not require building the whole document in
+///memory.
+///
+///Parts are selected by paths in the style of JSON pointers, in which a `*`
+///component matches any object member or array element. For example,
+///`/items/*/metadata/name` selects the name of every item. Each selected value
+///is kept in its entirety, along with the objects and arrays which enclose it,
+///so that it can be reached in the result by the same path as in the original
+///document. Enclosing arrays keep one element for each element of the input
+///whose path matched, so when `*` is used array indices are preserved. Members
+///and elements which are not selected are dropped.
+class JSONExtractor{
+public:
+	///\param paths the paths of the values to keep
+	explicit JSONExtractor(const std::vector<std::string>& paths);
+
+	///Parse a document, modifying the input buffer in the process so that
+	///values which are not needed can be skipped without copying them.
+	///\param json the document to parse; its contents are unspecified
+	///            afterwards
+	///\param result the document into which the selected data will be placed
+	///\throws std::runtime_error if the input is not valid JSON
+	void parseInsitu(std::string& json, rapidjson::Document& result) const;
+
+private:
+	///Each path, split into components
+	std::vector<std::vector<std::string>> paths;
+
+	template<typename Handler> class Filter;
+};
+
+///Split a JSON pointer into its reference tokens, undoing the escaping of `~`
+///and `/` within them
+///\param pointer the pointer, which must be empty or begin with `/`
+///\throws std::runtime_error if the pointer does not begin with `/`
+std::vector<std::string> splitJSONPointer(const std::string& pointer);
+
+#endif //SLATE_JSON_EXTRACTOR_H
@@ -9,6 +9,11 @@
 #endif //SLATE_SERVER
 
 namespace kubernetes{
+	///Set the limits on run time and output size applied to every kubectl and
+	///helm command which does not specify its own. Unless changed, commands 
+	///may run for five minutes and keep 64 MB of output. 
+	void setCommandLimits(const commandLimits& limits);
+	
 	commandResult kubectl(const std::string& configPath,
 	                      const std::vector<std::string>& arguments);
 	
@@ -0,0 +1,15 @@
+#ifndef SLATE_LOG_LEVEL_COMMANDS_H
+#define SLATE_LOG_LEVEL_COMMANDS_H
+
+#include "crow.h"
+#include "PersistentStore.h"
+
+///Report the least severe level of message the server is logging. 
+///Only administrators may use this.
+crow::response fetchServerLogLevel(PersistentStore& store, const crow::request& req);
+
+///Change the least severe level of message the server logs, without 
+///restarting it. Only administrators may use this.
+crow::response updateServerLogLevel(PersistentStore& store, const crow::request& req);
+
+#endif //SLATE_LOG_LEVEL_COMMANDS_H
@@ -2,53 +2,73 @@
 #define SLATE_LOGGING_H
 
 #include <iostream>
-#include <sstream>
 #include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <thread>
 
 #include "Utilities.h"
 #include "ServerUtilities.h"
 
-struct logTarget{
-	std::ostream& stream;
-	std::mutex mutex;
-	
-	void write(const std::string& msg){
-		std::lock_guard<std::mutex> guard(mutex);
-		stream << msg;
-		stream.flush();
-	}
+///The severities of log messages, in increasing order
+enum class LogLevel{Info, Warn, Error, Fatal};
+
+///The ways in which log messages can be written
+enum class LogFormat{
+	///Lines of the form 'LEVEL: [timestamp] (TID thread) message'
+	Text,
+	///One JSON object per line, including the ID of the trace active when the
+	///message was logged, if any
+	JSON
 };
 
-extern logTarget logStdout;
-extern logTarget logStderr;
+///\return whether messages of the given level are currently written
+bool logLevelEnabled(LogLevel level);
+///Set the least severe level of message which will be written. This may be
+///changed at any time.
+void setLogLevel(LogLevel level);
+///\return the least severe level of message which will be written
+LogLevel getLogLevel();
+///Interpret the name of a log level: 'info', 'warn', 'error', or 'fatal'
+///\throws std::runtime_error if the name is not recognized
+LogLevel parseLogLevel(const std::string& name);
+///\return the name of a log level, as accepted by parseLogLevel
+std::string logLevelName(LogLevel level);
 
-///Log an informational message to stdout
-#define log_info(msg) \
+void setLogFormat(LogFormat format);
+///Set the function used to determine the ID of the trace active on the
+///calling thread, for inclusion in JSON output
+void setLogTraceSource(std::string (*source)());
+
+///Queue a message for the background log writer. Messages of level Info are
+///written to stdout, and all others to stderr. If the queue is full, an Info
+///message is discarded and counted, rather than delaying the caller, while
+///more severe messages wait for room so that none are lost or reordered.
+///Fatal messages are not returned from until they have been written.
+void logMessage(LogLevel level, std::string message);
+///Wait until all messages queued so far have been written
+void flushLogs();
+///\return the numbers of log messages written and dropped, as lines of text
+std::string getLogStatistics();
+
+#define log_at_level(level,msg) \
 do{ \
-	std::ostringstream str; \
-	str << "INFO: [" << timestamp() << "] (TID " \
-	<< std::this_thread::get_id() << ") " << msg << std::endl; \
-	logStdout.write(str.str()); \
+	if(logLevelEnabled(level)){ \
+		std::ostringstream str; \
+		str << msg; \
+		logMessage(level,str.str()); \
+	} \
 } while(0)
 
+///Log an informational message to stdout
+#define log_info(msg) log_at_level(LogLevel::Info,msg)
+
 ///Log that an error or problem has occurred to stderr
-#define log_warn(msg) \
-do{ \
-	std::ostringstream str; \
-	str << "WARN: [" << timestamp() << "] (TID " \
-	<< std::this_thread::get_id() << ") " << msg << std::endl; \
-	logStderr.write(str.str()); \
-} while(0)
+#define log_warn(msg) log_at_level(LogLevel::Warn,msg)
 
 ///Log that an error or problem has occurred to stderr
-#define log_error(msg) \
-do{ \
-	std::ostringstream str; \
-	str << "ERROR: [" << timestamp() << "] (TID " \
-	<< std::this_thread::get_id() << ") " << msg << std::endl; \
-	logStderr.write(str.str()); \
-} while(0)
+#define log_error(msg) log_at_level(LogLevel::Error,msg)
 
 ///Log an error to stderr and abort the current activity by throwing an exception
 ///\throws std::runtime_error
@@ -56,10 +76,7 @@ do{ \
 do{ \
 	std::ostringstream mstr; \
 	mstr << msg; \
-	std::ostringstream str; \
-	str << "FATAL: [" << timestamp() << "] (TID " \
-	<< std::this_thread::get_id() << ") " << mstr.str() << std::endl; \
-	logStderr.write(str.str()); \
+	logMessage(LogLevel::Fatal,mstr.str()); \
 	throw std::runtime_error(mstr.str()); \
 } while(0)
 
@@ -2,22 +2,30 @@
 #define SLATE_PERSISTENT_STORE_H
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 
 #include <aws/core/Aws.h>
 #include <aws/core/auth/AWSCredentialsProvider.h>
-#include <aws/dynamodb/DynamoDBClient.h>
 #include <aws/route53/Route53Client.h>
 
 #include <libcuckoo/cuckoohash_map.hh>
 
+#include <AccessIndex.h>
 #include <concurrent_multimap.h>
 #include <DNSManipulator.h>
+#include <EmailClient.h>
 #include <Entities.h>
 #include <FileHandle.h>
 #include <Geocoder.h>
+#include <StorageBackend.h>
 #include <Telemetry.h>
 
 
@@ -123,29 +131,110 @@ struct hash<std::set<T>>{
 };
 }
 
-///An interface for sending email with the MailGun service
-class EmailClient{
-public:
-	struct Email{
-		std::string fromAddress;
-		std::vector<std::string> toAddresses;
-		std::vector<std::string> ccAddresses;
-		std::vector<std::string> bccAddresses;
-		std::string replyTo;
-		std::string subject;
-		std::string body;
-	};
+///The categories of records for which the persistent store tracks generation 
+///numbers
+enum class StoreCollection : unsigned int{
+	Users,
+	Groups,
+	Clusters,
+	Instances,
+	Secrets,
+	MonitoringCredentials,
+	Volumes,
+	///Not a real collection; the number of collections
+	Count
+};
+
+///\return the kind of API object corresponding to a collection, e.g. "Cluster"
+std::string to_string(StoreCollection collection);
+
+///The kinds of modification recorded in the change log
+enum class ChangeOperation : unsigned int{
+	Add,
+	Update,
+	Remove,
+	///A cluster was contacted successfully after being unreachable, or for 
+	///the first time
+	Reachable,
+	///A cluster could not be contacted after being reachable, or at the first 
+	///attempt
+	Unreachable
+};
+
+///\return the name of an operation, e.g. "update"
+std::string to_string(ChangeOperation operation);
 
-	EmailClient():valid(false){}
-	EmailClient(const std::string& mailgunEndpoint, 
-	            const std::string& mailgunKey, const std::string& emailDomain);
-	bool canSendEmail() const{ return valid; }
-	bool sendEmail(const Email& email);
+///A record of one modification made through the persistent store
+struct ChangeEvent{
+	///The position of this change in the sequence of all changes
+	uint64_t revision;
+	StoreCollection collection;
+	ChangeOperation operation;
+	///The ID of the modified record
+	std::string id;
+	///The IDs of the groups and clusters associated with the modified record
+	std::vector<std::string> scopes;
+};
+
+// Retain enough changes that clients polling every few minutes will not 
+// usually need to resynchronize
+static constexpr size_t DEFAULT_CHANGE_LOG_SIZE = 4096;
+
+///A bounded, in-memory log of the most recent modifications made through the 
+///persistent store. Once full, the oldest changes are discarded. 
+class ChangeLog{
+public:
+	///\param capacity the maximum number of changes to retain
+	explicit ChangeLog(std::size_t capacity=DEFAULT_CHANGE_LOG_SIZE);
+	
+	///Record a change, assigning it the next revision number
+	///\return the revision assigned to the change
+	uint64_t append(StoreCollection collection, ChangeOperation operation, 
+	                const std::string& id, std::vector<std::string> scopes);
+	
+	///\return the revision of the most recent change, or zero if there has 
+	///        been none
+	uint64_t currentRevision() const;
+	
+	///Fetch all retained changes after a given revision
+	///\param revision the last revision already known to the caller
+	///\param complete will be set to whether the result contains every change 
+	///                after \p revision. This is not the case if some have 
+	///                already been discarded, or if \p revision is newer than 
+	///                any change in this log. 
+	std::vector<ChangeEvent> changesSince(uint64_t revision, bool& complete) const;
+	
+	///Block until there are changes after a given revision
+	///\param revision the last revision already known to the caller
+	///\param timeout the maximum time to wait
+	///\return whether changes are available
+	bool waitForChanges(uint64_t revision, std::chrono::milliseconds timeout) const;
+	
 private:
-	std::string mailgunEndpoint;
-	std::string mailgunKey;
-	std::string emailDomain;
-	bool valid;
+	mutable std::mutex mut;
+	mutable std::condition_variable changed;
+	///Storage for changes, used as a ring buffer indexed by revision
+	std::vector<ChangeEvent> events;
+	///The revision of the most recent change
+	uint64_t revision;
+};
+
+///A modification of a database record which was not made through this 
+///instance of the persistent store, such as one made by another server replica
+struct ExternalChange{
+	StoreCollection collection;
+	ChangeOperation operation;
+	///The partition key of the modified database item
+	std::string id;
+	///The sort key of the modified database item
+	std::string sortKey;
+	///The string-valued attributes of the item before the change, if known
+	std::map<std::string,std::string> oldAttributes;
+	///The string-valued attributes of the item after the change, if known
+	std::map<std::string,std::string> newAttributes;
+	///All attributes of the item after the change, as described by 
+	///describeItemImage, used to recognize changes made by this store
+	std::string newImage;
 };
 
 class PersistentStore{
@@ -162,6 +251,12 @@ public:
 	///\param appLoggingServerPort port to which application instances should 
 	///                            send monitoring data
 	///\param slateDomain domain to assume as the base for all dns names used in the persistent store
+	///\param cacheValidityFactor multiplier for the durations for which cached 
+	///                           records are trusted. Values greater than one 
+	///                           are only safe if external changes are applied 
+	///                           via applyExternalChange. 
+	///\param route53Endpoint a Route53 endpoint to use for DNS updates instead 
+	///                       of the AWS one, such as a local stand-in
 	PersistentStore(const Aws::Auth::AWSCredentials& credentials, 
 	                const Aws::Client::ClientConfiguration& clientConfig,
 	                std::string bootstrapUserFile,
@@ -169,7 +264,25 @@ public:
 	                std::string appLoggingServerName,
 			unsigned int appLoggingServerPort,
 			std::string slateDomain,
-			opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracerPtr);
+			opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracerPtr,
+			unsigned int cacheValidityFactor=1,
+			std::string route53Endpoint="");
+
+	///Construct a store which keeps its data in the given backend, rather than
+	///in DynamoDB. The remaining parameters are as above; the AWS credentials
+	///and endpoint are still used for DNS updates.
+	///\param backend the storage to use
+	PersistentStore(std::unique_ptr<StorageBackend> backend,
+	                const Aws::Auth::AWSCredentials& credentials, 
+	                const Aws::Client::ClientConfiguration& clientConfig,
+	                std::string bootstrapUserFile,
+	                std::string encryptionKeyFile,
+	                std::string appLoggingServerName,
+			unsigned int appLoggingServerPort,
+			std::string slateDomain,
+			opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracerPtr,
+			unsigned int cacheValidityFactor=1,
+			std::string route53Endpoint="");
 
 	///Store a record for a new user
 	///\return Whether the user record was successfully added to the database
@@ -307,11 +420,13 @@ public:
 	bool updateCluster(const Cluster& cluster);
 	
 	///Find all current clusters
-	///\return all recorded clusters
+	///\return all recorded clusters, without their configurations, which can
+	///        be obtained with findClusterByID or configPathForCluster
 	std::vector<Cluster> listClusters();
 
 	///Find all current clusters the given group is allowed to access
-	///\return recorded clusters associated with given group
+	///\return recorded clusters associated with given group, without their 
+	///        configurations
 	std::vector<Cluster> listClustersByGroup(std::string group);
 	
 	///For consumption by kubectl and helm, cluster configurations are stored on
@@ -515,6 +630,8 @@ public:
 	///          empty to list for all groups on a cluster.
 	///\param cluster the name or ID of the cluster for which secrets should be 
 	///               listed. May be empty to list for all clusters. 
+	///\return the matching secrets, without their data, which can be obtained
+	///        with getSecret
 	std::vector<Secret> listSecrets(std::string group, std::string cluster);
 	
 	///Find the secret, if any, which has the specified name on the given cluster
@@ -541,11 +658,20 @@ public:
 	///Select a currently unused credential to assign to a cluster which does 
 	///not currently have a credential. This may fail if there are no credentials
 	///available for allocation. 
+	///Candidates are taken from a pool of credentials believed to be 
+	///available, so that the database only needs to be scanned when the pool 
+	///runs low. 
 	///\return a tuple containing the selected credential and an empty string, 
 	///        or an invalid credential if allocation was  not possible and a 
 	///        string containing an error message
 	std::tuple<S3Credential,std::string> allocateMonitoringCredential();
 	
+	///\return the number of credentials believed to be available for 
+	///        allocation. This does not query the database, so it may count
+	///        credentials which other servers have allocated since they were 
+	///        last listed. 
+	std::size_t countAvailableMonitoringCredentials();
+	
 	///Mark a credential revoked, preventing it from being eligible for 
 	///allocation and making it eligible for deletion. In-use credentials can be
 	///revoked, but this function will not remove such credentials from the
@@ -609,6 +735,48 @@ public:
 	///Return human-readable performance statistics
 	std::string getStatistics() const;
 	
+	///Get the generation number of a collection of records. The generation is 
+	///incremented each time any record in the collection is modified through 
+	///this store, so an unchanged generation means unchanged contents. 
+	uint64_t getGeneration(StoreCollection collection) const;
+	///Get the generation number of a single record, or of the part of a 
+	///collection associated with one group or cluster. 
+	///\param scope the ID of the record, group, or cluster
+	uint64_t getGeneration(StoreCollection collection, const std::string& scope) const;
+	///An identifier unique to this instance of the store, so that generation 
+	///numbers from before a restart cannot be mistaken for current ones. It 
+	///also changes when cached data is discarded by discardCachedData. 
+	std::string getGenerationEpoch() const;
+	///Declare whether the generation numbers reflect every modification of 
+	///the database, including those made by other servers, as they do when 
+	///database streams are followed or there is only one server. 
+	void setGenerationsComplete(bool complete){ generationsComplete=complete; }
+	///Begin or stop remembering recent writes, so that applyExternalChange 
+	///can ignore changes which this store made itself
+	void setLocalWriteTracking(bool enable){ localWrites->setTracking(enable); }
+	///An identifier for the source of entity tags built from generation 
+	///numbers. When the generation numbers may miss changes made by other 
+	///servers, this also changes with each cache validity period, so that a 
+	///tag cannot outlive the cached data it was derived from. 
+	std::string getETagEpoch() const;
+	///Get the log of recent modifications. Its revision numbers share the 
+	///generation epoch.
+	const ChangeLog& getChangeLog() const{ return changeLog; }
+	
+	///\return the name of the database table which holds a collection
+	const std::string& getTableName(StoreCollection collection) const;
+	///Discard any cached data made stale by a modification which did not pass 
+	///through this store, and record the change so that it is visible to 
+	///clients following changes. If local write tracking is enabled, changes 
+	///recently made through this store are ignored, having already been 
+	///applied. 
+	void applyExternalChange(const ExternalChange& change);
+	///Discard all cached records and begin a new generation epoch, so that 
+	///no entity tag or change log revision issued earlier is trusted. This is 
+	///necessary when modifications not made through this store may have been 
+	///missed, such as when the position in a database stream is lost. 
+	void discardCachedData();
+	
 	///The pseudo-ID associated with wildcard permissions.
 	const static std::string wildcard;
 	///The pseudo-name associated with wildcard permissions.
@@ -629,27 +797,62 @@ public:
 	std::vector<std::string> getDNSRecord(Aws::Route53::Model::RRType type, const std::string& name) const{
 		return dnsClient.getDNSRecord(type, name);
 	}
-	///Create a DNS record associating a name with an address
-	bool setDNSRecord(const std::string& name, const std::string& address){
+	///Create a DNS record associating a name with an address. The change is 
+	///made in the background, together with any others made at about the 
+	///same time. 
+	///\return a future which becomes true once the record has been made
+	std::shared_future<bool> setDNSRecord(const std::string& name, const std::string& address){
 		return dnsClient.setDNSRecord(name, address);
 	}
-	///Delete the DNS record which associates a particular name with an address
-	bool removeDNSRecord(const std::string& name, const std::string& address){
-		return dnsClient.removeDNSRecord(name, address);
+	///Delete the DNS records made for a name. The change is made in the 
+	///background, together with any others made at about the same time. 
+	///\return a future which becomes true once the records have been deleted
+	std::shared_future<bool> removeDNSRecords(const std::string& name){
+		return dnsClient.removeDNSRecords(name);
 	}
 	
 	const Geocoder& getGeocoder(){ return geocoder; }
 	void setGeocoder(Geocoder&& g){ geocoder=std::move(g); }
+	///Look up the place at a location, reusing the result of any earlier 
+	///lookup of nearby coordinates. Results are kept in the database for a 
+	///long time, since places rarely change, and concurrent lookups of the 
+	///same coordinates share one request to the geocoding service. 
+	Geocoder::GeocodeResult reverseGeocode(const GeoLocation& loc);
 	
 	EmailClient& getEmailClient(){ return emailClient; }
-	void setEmailClient(EmailClient&& e){ emailClient=std::move(e); }
+	///Set the client used to send email, and start sending queued email with it
+	///\param options the limits on queueing email
+	void setEmailClient(EmailClient&& e, EmailQueue::Options options=EmailQueue::Options());
+	///Queue an email to be sent in the background
+	///\return false if email cannot be sent, because no email client is set 
+	///        or too many messages are already waiting
+	bool queueEmail(EmailClient::Email email);
 	
 	const std::string& getOpsEmail(){ return opsEmail; }
 	void setOpsEmail(std::string address){ opsEmail=address; }
 	
 private:
+	///An application instance configuration, as it is stored in the database
+	struct StoredConfig{
+		///Whether data is gzip compressed, rather than plain text
+		bool compressed;
+		std::string data;
+		
+		StoredConfig():compressed(false){}
+	};
+	///Instance configurations at least this long are compressed for storage
+	const static std::size_t minCompressedConfigSize;
+	///Prepare an instance configuration for storage, compressing it if that 
+	///is worthwhile
+	static StoredConfig compressConfig(const std::string& config);
+	///Recover the text of an instance configuration
+	static std::string decompressConfig(const StoredConfig& stored);
+	
+	///The storage backend, wrapped so that this store's own writes can be 
+	///recognized when they are reported by database streams
+	WriteTrackingBackend* localWrites;
 	///Database interface object
-	Aws::DynamoDB::DynamoDBClient dbClient;
+	std::unique_ptr<StorageBackend> dbClient;
 	///Name of the users table in the database
 	const std::string userTableName;
 	///Name of the groups table in the database
@@ -674,7 +877,8 @@ private:
 	Geocoder geocoder;
 	
 	///Path to the temporary directory where cluster config files are written 
-	///in order for kubectl and helm to read
+	///in order for kubectl and helm to read, when they cannot be kept in 
+	///memory
 	const FileHandle clusterConfigDir;
 	
 	///duration for which cached user records should remain valid
@@ -694,11 +898,11 @@ private:
 	const std::chrono::seconds clusterCacheValidity;
 	slate_atomic<std::chrono::steady_clock::time_point> clusterCacheExpirationTime;
 	cuckoohash_map<std::string,CacheRecord<Cluster>> clusterCache;
+	///Clusters without their configurations, which are all that listings need
+	cuckoohash_map<std::string,CacheRecord<Cluster>> clusterSummaryCache;
 	cuckoohash_map<std::string,CacheRecord<Cluster>> clusterByNameCache;
 	concurrent_multimap<std::string,CacheRecord<Cluster>> clusterByGroupCache;
 	cuckoohash_map<std::string,SharedFileHandle> clusterConfigs;
-	concurrent_multimap<std::string,CacheRecord<std::string>> clusterGroupAccessCache;
-	cuckoohash_map<std::string,CacheRecord<std::set<std::string>>> clusterGroupApplicationCache;
 	cuckoohash_map<std::string,CacheRecord<std::vector<GeoLocation>>> clusterLocationCache;
 	///This cache is a little tricky since it represents state of the network, 
 	///not something stored in the database, so it's data isn't directly handled
@@ -708,7 +912,9 @@ private:
 	const std::chrono::seconds instanceCacheValidity;
 	slate_atomic<std::chrono::steady_clock::time_point> instanceCacheExpirationTime;
 	cuckoohash_map<std::string,CacheRecord<ApplicationInstance>> instanceCache;
-	cuckoohash_map<std::string,CacheRecord<std::string>> instanceConfigCache;
+	///Instance configurations in the form in which they are stored, so that 
+	///large ones occupy little memory and are decompressed only when used
+	cuckoohash_map<std::string,CacheRecord<StoredConfig>> instanceConfigCache;
 	concurrent_multimap<std::string,CacheRecord<ApplicationInstance>> instanceByGroupCache;
 	concurrent_multimap<std::string,CacheRecord<ApplicationInstance>> instanceByNameCache;
 	concurrent_multimap<std::string,CacheRecord<ApplicationInstance>> instanceByClusterCache;
@@ -716,6 +922,7 @@ private:
 	///duration for which cached secret records should remain valid
 	const std::chrono::seconds secretCacheValidity;
 	cuckoohash_map<std::string,CacheRecord<Secret>> secretCache;
+	///Secrets in the by-group caches do not include their data
 	concurrent_multimap<std::string,CacheRecord<Secret>> secretByGroupCache;
 	concurrent_multimap<std::string,CacheRecord<Secret>> secretByGroupAndClusterCache;
 	///duration for which cached volume claim records should remain valid
@@ -727,6 +934,41 @@ private:
 	concurrent_multimap<std::string,CacheRecord<PersistentVolumeClaim>> volumeByGroupAndClusterCache;
 	///This cache also contains data not directly managed by the persistent store
 	concurrent_multimap<std::string,CacheRecord<Application>> applicationCache;
+	///duration for which geocoding results should be reused
+	const std::chrono::hours geocodeCacheValidity;
+	///Geocoding results, keyed by rounded coordinates
+	cuckoohash_map<std::string,CacheRecord<Geocoder::GeocodeResult>> geocodeCache;
+	///Geocoding lookups in progress, keyed like geocodeCache
+	std::map<std::string,std::shared_future<Geocoder::GeocodeResult>> geocodeLookups;
+	std::mutex geocodeLookupMut;
+	///Protects accessIndex and the state of its loading
+	std::mutex accessIndexMut;
+	///Signalled when loading accessIndex finishes
+	std::condition_variable accessIndexLoaded;
+	///Which groups may use each cluster, and which applications they may 
+	///install there
+	AccessIndex accessIndex;
+	///The time after which accessIndex must be reloaded, since it may lack 
+	///changes made by other servers
+	std::chrono::steady_clock::time_point accessIndexExpiration;
+	bool accessIndexLoading;
+	///Whether accessIndex has ever been loaded successfully, so that it may 
+	///be used while a newer copy is loaded in the background
+	bool accessIndexReady;
+	///Whether accessIndex was invalidated while being loaded, so that the 
+	///loaded copy must not be considered current
+	bool accessIndexInvalidated;
+	///Changes made while accessIndex is being loaded, which must also be 
+	///applied to the loaded copy
+	std::vector<std::function<void(AccessIndex&)>> accessIndexUpdates;
+	///Protects freeMonCreds and monCredRefill
+	std::mutex monCredPoolMut;
+	///Monitoring credentials believed to be available for allocation, in 
+	///random order so that servers sharing the database are unlikely to try 
+	///to allocate the same ones
+	std::deque<S3Credential> freeMonCreds;
+	///The number of entries in freeMonCreds below which it is refilled
+	const static std::size_t monCredPoolLowWater;
 	
 	///Check that all necessary tables exist in the database, and create them if 
 	///they do not
@@ -742,10 +984,49 @@ private:
 	
 	void loadEncryptionKey(const std::string& fileName);
 	
-	///For consumption by kubectl we store configs in the filesystem
+	///For consumption by kubectl we store configs as files, in memory where
+	///possible (see makeMemoryFile). 
 	///These files have implicit validity derived from the corresponding entries
 	///in clusterCache.
-	void writeClusterConfigToDisk(const Cluster& cluster);
+	void storeClusterConfig(const Cluster& cluster);
+	
+	///Add or replace the entry for a cluster in clusterSummaryCache
+	void cacheClusterSummary(Cluster cluster);
+	
+	///Lock accessIndex, first loading it from the database if it has never 
+	///been loaded. If it has been loaded but is no longer current, the 
+	///existing contents are used while a reload runs in the background. If 
+	///loading fails, the previous contents are left in place. 
+	std::unique_lock<std::mutex> lockAccessIndex();
+	///Load accessIndex from the database, replacing its contents if this 
+	///succeeds. accessIndexLoading must already be set. 
+	///\param lock a lock on accessIndexMut, which is released while the 
+	///            database is read
+	void reloadAccessIndex(std::unique_lock<std::mutex>& lock);
+	///Read all group access and application permission records
+	///\param index the index to which to add the records
+	///\return whether the records could be read
+	bool loadAccessIndex(AccessIndex& index);
+	///Apply a change to accessIndex, and to any copy currently being loaded
+	void updateAccessIndex(std::function<void(AccessIndex&)> update);
+	///Mark accessIndex as out of date, so that it is reloaded when next used
+	void invalidateAccessIndex();
+	
+	///Replace the contents of freeMonCreds with the credentials which the 
+	///database lists as available for allocation, keeping any added since 
+	///the listing began
+	///\return an empty string on success, or an error message
+	std::string refillMonitoringCredentialPool();
+	///Begin refilling freeMonCreds in the background, unless that is already 
+	///in progress
+	void startMonitoringCredentialRefill();
+	///Remove a credential which is no longer available from freeMonCreds
+	void removeFromMonitoringCredentialPool(const std::string& accessKey);
+	
+	///Find a stored geocoding result, or perform the lookup and store its 
+	///result if there is none
+	///\param key the rounded coordinates under which the result is stored
+	Geocoder::GeocodeResult fetchGeocode(const std::string& key, const GeoLocation& loc);
 	
 	///Ensure that a string is a group ID, rather than a group name. 
 	///\param groupID the group ID or name. If the value is a valid name, it will 
@@ -770,12 +1051,47 @@ private:
 	unsigned int appLoggingServerPort;
 	
 	EmailClient emailClient;
+	///Sends email with emailClient, so it must be destroyed first
+	std::unique_ptr<EmailQueue> emailQueue;
 	std::string opsEmail;
 	
 	std::atomic<size_t> cacheHits, databaseQueries, databaseScans;
+	
+	///Generation numbers for each entire collection
+	std::atomic<uint64_t> generations[(unsigned int)StoreCollection::Count];
+	///Generation numbers for individual records and for the parts of 
+	///collections associated with particular groups and clusters, keyed by 
+	///collection and scope ID
+	cuckoohash_map<std::string,uint64_t> scopedGenerations;
+	const std::string generationEpoch;
+	///The number of times cached data has been discarded, which distinguishes 
+	///the epochs of this instance of the store
+	std::atomic<unsigned int> generationEpochResets;
+	///Whether changes made by other servers reach the generation numbers
+	std::atomic<bool> generationsComplete;
+	///Recent modifications, for clients which follow changes incrementally
+	ChangeLog changeLog;
+	///Record that a record has been modified, updating the relevant generation 
+	///numbers and the change log. 
+	///Callers must update caches first, so that a reader which observes the 
+	///change also observes the new data. 
+	///\param id the ID of the modified record
+	///\param scopes the IDs of the groups and/or clusters associated with the 
+	///              modified record
+	void recordChange(StoreCollection collection, ChangeOperation operation, 
+	                  const std::string& id, std::initializer_list<std::string> scopes={});
 
 	// tracer to use for opentelemetry tracing
 	opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracer;
+	
+	///The result of reloading accessIndex in the background, if that has 
+	///been started. Like monCredRefill, destroying this waits for the 
+	///reload, so it must be declared after all members the reload uses. 
+	std::shared_future<void> accessIndexReload;
+	///The result of refilling freeMonCreds in the background, if that has 
+	///been started. Destroying this waits for the refill, which uses other 
+	///members, so it must be declared last. 
+	std::shared_future<std::string> monCredRefill;
 
 };
 
@@ -3,10 +3,12 @@
 
 #include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <istream>
 #include <map>
 #include <ostream>
 #include <streambuf>
+#include <string>
 #include <vector>
 
 #include <unistd.h>
@@ -54,6 +56,11 @@ public:
 	///been called. 
 	void endInput();
 	
+	///Get the fd to which data is written, or -1 if there is none
+	int getWriteFD() const{ return fd_in; }
+	///Get the fd from which data is read, or -1 if there is none
+	int getReadFD() const{ return fd_out; }
+	
 private:
 	const static std::size_t bufferSize=4096;
 
@@ -119,6 +126,18 @@ public:
 	///Get the stream connected to the child process's stderr
 	///Not valid if the child was launched detachably
 	std::istream& getStderr(){ return(err); }
+	///Get the file descriptor connected to the child process's stdin, for 
+	///waiting on with poll(). Data written directly to it bypasses getStdin().
+	///Not valid if the child was launched detachably
+	int getStdinFD() const{ return inoutBuf.getWriteFD(); }
+	///Get the file descriptor connected to the child process's stdout. Data 
+	///read directly from it will not be seen by getStdout(). 
+	///Not valid if the child was launched detachably
+	int getStdoutFD() const{ return inoutBuf.getReadFD(); }
+	///Get the file descriptor connected to the child process's stderr. Data 
+	///read directly from it will not be seen by getStderr(). 
+	///Not valid if the child was launched detachably
+	int getStderrFD() const{ return errBuf.getReadFD(); }
 	///Close the stream to the child process's stdin
 	void endInput(){ inoutBuf.endInput(); }
 	///Give up responsibility for stopping the child process
@@ -132,6 +151,15 @@ public:
 	bool done() const;
 	///Only valid if the child process has not been detached and done() is true
 	char exitStatus() const;
+	///Sleep until the child process has exited. Requires that the reaper be 
+	///running. 
+	///Only valid if the child process has not been detached
+	void waitForExit() const;
+	///Sleep until the child process has exited or a deadline passes. Requires 
+	///that the reaper be running. 
+	///Only valid if the child process has not been detached
+	///\return whether the child process has exited
+	bool waitForExit(std::chrono::steady_clock::time_point deadline) const;
 private:
 	pid_t child;
 	ProcessIOBuffer inoutBuf, errBuf;
@@ -152,9 +180,10 @@ private:
 
 ///Reap any child processes which have exited
 void reapProcesses();
-///Spawn a separate thread to periodically run reapProcesses()
+///Spawn a separate thread to run reapProcesses() whenever a child process exits
 void startReaper();
-//Stop the background reaping thread
+///Stop the background reaping thread, waiting for it to finish. Must only be
+///called while the thread is running.
 void stopReaper();
 
 struct ForkCallbacks{
@@ -189,8 +218,37 @@ struct commandResult{
 	std::string error;
 	///The process's exit status
 	int status;
+	///Whether the process was killed for exceeding its time limit
+	bool timedOut;
+	///Whether some of the process's output was discarded for exceeding the 
+	///size limit
+	bool truncated;
 };
 
+///Limits on the resources an external command may consume
+struct commandLimits{
+	///The time for which the command may run before it is killed, or zero for
+	///no limit
+	std::chrono::milliseconds timeout;
+	///The maximum number of bytes which will be kept from each of the 
+	///command's standard output and error, or zero for no limit. Output beyond
+	///this is read and discarded so that the command is not blocked. 
+	std::size_t maxOutput;
+	
+	commandLimits(std::chrono::milliseconds timeout=std::chrono::milliseconds::zero(),
+	              std::size_t maxOutput=0):
+	timeout(timeout),maxOutput(maxOutput){}
+	
+	///\return whether neither time nor output is limited
+	bool unlimited() const{ return timeout==std::chrono::milliseconds::zero() && maxOutput==0; }
+};
+
+///Set the limits applied whenever a command is run without limits of its own
+///\param command the command name exactly as it will be passed to runCommand 
+///               or runCommandWithInput
+///\param limits the limits to apply, or unlimited limits to remove any default
+void setDefaultCommandLimits(const std::string& command, const commandLimits& limits);
+
 ///Run an external command
 ///\param command the command to be run. If \p command contains no slashes, a  
 ///               search will be performed in all entries of $PATH (or 
@@ -200,11 +258,15 @@ struct commandResult{
 ///\param env additions and changes to the child command's environment. These 
 ///           are added to the current process's environment to form the full
 ///           child environment. 
+///\param limits restrictions on the run time and output size of the command. 
+///              If no limits are given, any set for \p command with 
+///              setDefaultCommandLimits are used. 
 ///\return a structure containing all data written by the child process to its
 ///        standard ouput and error and the child process's exit status
 commandResult runCommand(const std::string& command,
 			 const std::vector<std::string>& args = {},
-			 const std::map<std::string, std::string>& env = {});
+			 const std::map<std::string, std::string>& env = {},
+			 const commandLimits& limits = commandLimits());
 
 ///Run an external command, sending given data to its standard input
 ///\param command the command to be run. If \p command contains no slashes, a  
@@ -216,11 +278,15 @@ commandResult runCommand(const std::string& command,
 ///\param env additions and changes to the child command's environment. These 
 ///           are added to the current process's environment to form the full
 ///           child environment. 
+///\param limits restrictions on the run time and output size of the command. 
+///              If no limits are given, any set for \p command with 
+///              setDefaultCommandLimits are used. 
 ///\return a structure containing all data written by the child process to its
 ///        standard ouput and error and the child process's exit status
 commandResult runCommandWithInput(const std::string& command,
 				  const std::string& input,
 				  const std::vector<std::string>& args = {},
-				  const std::map<std::string, std::string>& env = {});
+				  const std::map<std::string, std::string>& env = {},
+				  const commandLimits& limits = commandLimits());
 
 #endif //SLATE_PROCESS_H
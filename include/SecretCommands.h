@@ -7,6 +7,10 @@
 
 ///List installed secrets
 crow::response listSecrets(PersistentStore& store, const crow::request& req);
+///Compute the entity tag for the current result of listSecrets
+///\return the tag, or an empty string if the request does not specify an 
+///        existing Group
+std::string listSecretsETag(PersistentStore& store, const crow::request& req);
 
 ///Install a secret
 crow::response createSecret(PersistentStore& store, const crow::request& req);
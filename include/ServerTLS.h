@@ -0,0 +1,39 @@
+#ifndef SLATE_SERVER_TLS_H
+#define SLATE_SERVER_TLS_H
+
+#include <string>
+
+#include <boost/asio/ssl/context.hpp>
+
+///Settings for the TLS connections accepted by the API server
+struct TLSSettings{
+	///Path to the PEM certificate chain
+	std::string certificateFile;
+	///Path to the PEM private key
+	std::string keyFile;
+	///Optional path to a file containing a secret from which session ticket
+	///keys are derived. When several servers share this file, a client can
+	///resume a session with any of them. If not set, each server generates
+	///its own keys at startup.
+	std::string ticketKeyFile;
+	///The maximum number of sessions kept in the server's session cache
+	unsigned int sessionCacheSize;
+	///The number of seconds for which a session can be resumed
+	unsigned int sessionTimeout;
+
+	TLSSettings():sessionCacheSize(20480),sessionTimeout(7200){}
+};
+
+///Create the context used for the server's TLS connections, with session
+///caching and session tickets enabled so that returning clients can skip
+///the full handshake.
+///\throws std::runtime_error if the certificate, key, or ticket key file
+///        cannot be used
+boost::asio::ssl::context makeServerTLSContext(const TLSSettings& settings);
+
+///\return the numbers of full and resumed TLS handshakes completed by
+///        connections using contexts from makeServerTLSContext, as lines of
+///        text
+std::string getTLSStatistics();
+
+#endif //SLATE_SERVER_TLS_H
@@ -104,4 +104,50 @@ long parseStringSuffix(const std::string& input);
 ///\returns string with integers followed by a suffix like (Ki, Gi, Mi, etc)
 std::string generateSuffixedString(long value);
 
+///Construct an HTTP entity tag for a response which is determined entirely by 
+///the request and the generation numbers of the data it reports
+///\param epoch an identifier for the source of the generation numbers, which 
+///             must change whenever the generation numbers are reset
+///\param requestKey a string distinguishing requests which produce different 
+///                  responses from the same data, such as the full request URL
+///\param generations the generation numbers of all data used in the response
+///\return a quoted, strong entity tag
+std::string makeETag(const std::string& epoch, const std::string& requestKey, 
+                     const std::vector<uint64_t>& generations);
+
+///Check whether a request's If-None-Match header matches an entity tag, which 
+///indicates that the client already has the current version of the response
+///\param req the request to check
+///\param etag the entity tag of the current version of the response
+bool matchesETag(const crow::request& req, const std::string& etag);
+
+///The fields of a response which a client has asked for with the 'fields' 
+///query parameter, a comma separated list of JSON pointers such as 
+///"/metadata/id,/metadata/name". Pointers are relative to each object 
+///reported, so for listings they apply to each of the items. A '*' component 
+///matches any member or array element. When no fields are specified all fields
+///are included.
+class FieldSelection{
+public:
+	///\param fields a comma separated list of JSON pointers
+	explicit FieldSelection(const std::string& fields);
+	///Use the selection given by a request's 'fields' parameter, if any
+	explicit FieldSelection(const crow::request& req);
+
+	///\return whether all fields are included
+	bool all() const{ return paths.empty(); }
+	///Check whether any part of a value is included, so that the work of 
+	///computing values which are not needed can be skipped
+	///\param pointer the JSON pointer of the value, such as "/metadata/nodes"
+	bool includes(const std::string& pointer) const;
+	///Remove the members of an object which are not included. The object's 
+	///apiVersion and kind are always kept.
+	void apply(rapidjson::Value& object) const;
+private:
+	std::vector<std::vector<std::string>> paths;
+
+	void prune(rapidjson::Value& value, const std::vector<std::size_t>& candidates, 
+	           std::size_t depth) const;
+};
+
 #endif //SLATE_SERVER_UTILITIES_H
@@ -0,0 +1,321 @@
+#ifndef SLATE_STORAGE_BACKEND_H
+#define SLATE_STORAGE_BACKEND_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <aws/core/Aws.h>
+#include <aws/core/auth/AWSCredentialsProvider.h>
+#include <aws/dynamodb/DynamoDBClient.h>
+#include <aws/dynamodb/model/CreateTableRequest.h>
+#include <aws/dynamodb/model/DeleteItemRequest.h>
+#include <aws/dynamodb/model/DeleteTableRequest.h>
+#include <aws/dynamodb/model/DescribeTableRequest.h>
+#include <aws/dynamodb/model/DescribeTimeToLiveRequest.h>
+#include <aws/dynamodb/model/GetItemRequest.h>
+#include <aws/dynamodb/model/PutItemRequest.h>
+#include <aws/dynamodb/model/QueryRequest.h>
+#include <aws/dynamodb/model/ReturnValue.h>
+#include <aws/dynamodb/model/ScanRequest.h>
+#include <aws/dynamodb/model/UpdateItemRequest.h>
+#include <aws/dynamodb/model/UpdateTableRequest.h>
+#include <aws/dynamodb/model/UpdateTimeToLiveRequest.h>
+
+///The storage operations used by the PersistentStore.
+///
+///The interface deliberately mirrors the subset of the DynamoDB API which the
+///store uses, in terms of the same request and outcome types, so that the
+///store's logic is independent of where its data actually lives.
+///Implementations must be safe for concurrent use.
+class StorageBackend{
+public:
+	virtual ~StorageBackend(){}
+
+	virtual Aws::DynamoDB::Model::DescribeTableOutcome DescribeTable(const Aws::DynamoDB::Model::DescribeTableRequest& request)=0;
+	virtual Aws::DynamoDB::Model::CreateTableOutcome CreateTable(const Aws::DynamoDB::Model::CreateTableRequest& request)=0;
+	virtual Aws::DynamoDB::Model::UpdateTableOutcome UpdateTable(const Aws::DynamoDB::Model::UpdateTableRequest& request)=0;
+	virtual Aws::DynamoDB::Model::DeleteTableOutcome DeleteTable(const Aws::DynamoDB::Model::DeleteTableRequest& request)=0;
+	virtual Aws::DynamoDB::Model::DescribeTimeToLiveOutcome DescribeTimeToLive(const Aws::DynamoDB::Model::DescribeTimeToLiveRequest& request)=0;
+	virtual Aws::DynamoDB::Model::UpdateTimeToLiveOutcome UpdateTimeToLive(const Aws::DynamoDB::Model::UpdateTimeToLiveRequest& request)=0;
+
+	virtual Aws::DynamoDB::Model::GetItemOutcome GetItem(const Aws::DynamoDB::Model::GetItemRequest& request)=0;
+	virtual Aws::DynamoDB::Model::PutItemOutcome PutItem(const Aws::DynamoDB::Model::PutItemRequest& request)=0;
+	virtual Aws::DynamoDB::Model::UpdateItemOutcome UpdateItem(const Aws::DynamoDB::Model::UpdateItemRequest& request)=0;
+	virtual Aws::DynamoDB::Model::DeleteItemOutcome DeleteItem(const Aws::DynamoDB::Model::DeleteItemRequest& request)=0;
+	virtual Aws::DynamoDB::Model::QueryOutcome Query(const Aws::DynamoDB::Model::QueryRequest& request)=0;
+	virtual Aws::DynamoDB::Model::ScanOutcome Scan(const Aws::DynamoDB::Model::ScanRequest& request)=0;
+};
+
+///Stores data in DynamoDB (or a compatible service)
+class DynamoDBBackend : public StorageBackend{
+public:
+	///\param credentials the AWS credentials used for authenitcation with the
+	///                   database
+	///\param clientConfig specification of the database endpoint to contact
+	DynamoDBBackend(const Aws::Auth::AWSCredentials& credentials,
+	                const Aws::Client::ClientConfiguration& clientConfig);
+
+	Aws::DynamoDB::Model::DescribeTableOutcome DescribeTable(const Aws::DynamoDB::Model::DescribeTableRequest& request) override;
+	Aws::DynamoDB::Model::CreateTableOutcome CreateTable(const Aws::DynamoDB::Model::CreateTableRequest& request) override;
+	Aws::DynamoDB::Model::UpdateTableOutcome UpdateTable(const Aws::DynamoDB::Model::UpdateTableRequest& request) override;
+	Aws::DynamoDB::Model::DeleteTableOutcome DeleteTable(const Aws::DynamoDB::Model::DeleteTableRequest& request) override;
+	Aws::DynamoDB::Model::DescribeTimeToLiveOutcome DescribeTimeToLive(const Aws::DynamoDB::Model::DescribeTimeToLiveRequest& request) override;
+	Aws::DynamoDB::Model::UpdateTimeToLiveOutcome UpdateTimeToLive(const Aws::DynamoDB::Model::UpdateTimeToLiveRequest& request) override;
+
+	Aws::DynamoDB::Model::GetItemOutcome GetItem(const Aws::DynamoDB::Model::GetItemRequest& request) override;
+	Aws::DynamoDB::Model::PutItemOutcome PutItem(const Aws::DynamoDB::Model::PutItemRequest& request) override;
+	Aws::DynamoDB::Model::UpdateItemOutcome UpdateItem(const Aws::DynamoDB::Model::UpdateItemRequest& request) override;
+	Aws::DynamoDB::Model::DeleteItemOutcome DeleteItem(const Aws::DynamoDB::Model::DeleteItemRequest& request) override;
+	Aws::DynamoDB::Model::QueryOutcome Query(const Aws::DynamoDB::Model::QueryRequest& request) override;
+	Aws::DynamoDB::Model::ScanOutcome Scan(const Aws::DynamoDB::Model::ScanRequest& request) override;
+
+private:
+	Aws::DynamoDB::DynamoDBClient dbClient;
+};
+
+///Describe the attributes of an item in a canonical form, so that images of 
+///an item obtained through different APIs, such as the item written in a 
+///request and the new image in a database stream record, can be compared
+///\param image the item's attributes, as DynamoDB or DynamoDB Streams 
+///             AttributeValues
+template<typename Image>
+std::string describeItemImage(const Image& image){
+	std::string description;
+	//Aws::Map is ordered, so equal images produce equal descriptions
+	for(const auto& attribute : image){
+		description+=attribute.first;
+		description+='\0';
+		description+=attribute.second.Jsonize().View().WriteCompact();
+		description+='\0';
+	}
+	return description;
+}
+
+///Passes requests to another backend, optionally remembering for a limited 
+///time which items successful writes modified, and what those items 
+///contained afterwards, so that the records of those modifications reported 
+///by a database stream can be recognized as having been made by this process. 
+///
+///DynamoDB does not report writes which leave an item unchanged, so writes 
+///are matched to stream records by the item's new image rather than only by 
+///its key, and puts and deletes ask for the item's previous contents so that 
+///those which changed nothing are not remembered at all. An update which 
+///changes nothing may still be remembered, but can only be mistaken for a 
+///later change which leaves the item in the same state. 
+class WriteTrackingBackend : public StorageBackend{
+public:
+	///\param backend the backend which actually stores data
+	///\param retention how long to remember each write
+	WriteTrackingBackend(std::unique_ptr<StorageBackend> backend, 
+	                     std::chrono::seconds retention=std::chrono::seconds(60));
+
+	Aws::DynamoDB::Model::DescribeTableOutcome DescribeTable(const Aws::DynamoDB::Model::DescribeTableRequest& request) override;
+	Aws::DynamoDB::Model::CreateTableOutcome CreateTable(const Aws::DynamoDB::Model::CreateTableRequest& request) override;
+	Aws::DynamoDB::Model::UpdateTableOutcome UpdateTable(const Aws::DynamoDB::Model::UpdateTableRequest& request) override;
+	Aws::DynamoDB::Model::DeleteTableOutcome DeleteTable(const Aws::DynamoDB::Model::DeleteTableRequest& request) override;
+	Aws::DynamoDB::Model::DescribeTimeToLiveOutcome DescribeTimeToLive(const Aws::DynamoDB::Model::DescribeTimeToLiveRequest& request) override;
+	Aws::DynamoDB::Model::UpdateTimeToLiveOutcome UpdateTimeToLive(const Aws::DynamoDB::Model::UpdateTimeToLiveRequest& request) override;
+
+	Aws::DynamoDB::Model::GetItemOutcome GetItem(const Aws::DynamoDB::Model::GetItemRequest& request) override;
+	Aws::DynamoDB::Model::PutItemOutcome PutItem(const Aws::DynamoDB::Model::PutItemRequest& request) override;
+	Aws::DynamoDB::Model::UpdateItemOutcome UpdateItem(const Aws::DynamoDB::Model::UpdateItemRequest& request) override;
+	Aws::DynamoDB::Model::DeleteItemOutcome DeleteItem(const Aws::DynamoDB::Model::DeleteItemRequest& request) override;
+	Aws::DynamoDB::Model::QueryOutcome Query(const Aws::DynamoDB::Model::QueryRequest& request) override;
+	Aws::DynamoDB::Model::ScanOutcome Scan(const Aws::DynamoDB::Model::ScanRequest& request) override;
+
+	///Begin or stop remembering writes
+	void setTracking(bool enable);
+	///Check whether an item was recently modified through this backend so as 
+	///to have a particular new image, forgetting one such modification if so
+	///\param tableName the table containing the item
+	///\param id the item's ID (hash key)
+	///\param sortKey the item's sort key
+	///\param newImage the item's contents after the modification, as 
+	///                described by describeItemImage, which is empty for a 
+	///                deletion
+	bool consumeWrite(const std::string& tableName, const std::string& id, 
+	                  const std::string& sortKey, const std::string& newImage);
+
+private:
+	using Item=Aws::Map<Aws::String,Aws::DynamoDB::Model::AttributeValue>;
+	using Clock=std::chrono::steady_clock;
+
+	///A remembered write
+	struct Write{
+		///Distinguishes this write from others to the same item
+		uint64_t serial;
+		Clock::time_point time;
+		///The item's new image, as described by describeItemImage
+		std::string image;
+	};
+
+	std::unique_ptr<StorageBackend> backend;
+	const std::chrono::seconds retention;
+	std::atomic<bool> tracking;
+	std::mutex mut;
+	///Recent writes, by table and primary key, oldest first
+	std::map<std::string,std::deque<Write>> writes;
+	///The serial number to assign to the next write
+	uint64_t nextSerial;
+	///When expired writes were last discarded
+	Clock::time_point lastSweep;
+
+	///\return the key under which writes to an item are remembered, or an 
+	///        empty string if tracking is disabled or the item lacks the 
+	///        expected key attributes
+	std::string writeKey(const std::string& tableName, const Item& key) const;
+	///Remember a write which is about to be made, or has just been made
+	///\return the write's serial number
+	uint64_t noteWrite(const std::string& key, std::string image);
+	///Forget a write which failed or which changed nothing
+	void forgetWrite(const std::string& key, uint64_t serial);
+};
+
+///Stores data in memory within the server process, optionally backed by a
+///journal on local disk so that it survives restarts.
+///
+///Tables are ordered maps from primary key to item, and each global secondary
+///index is a map from its hash key to the primary keys of the items which
+///have that attribute, maintained on every write, so that reads never leave
+///the process. Condition, filter, key condition, update, and projection
+///expressions are evaluated for the subset of the DynamoDB expression language
+///used by the PersistentStore: comparisons, AND/OR/NOT, parentheses,
+///attribute_exists, attribute_not_exists, begins_with, and contains, SET and
+///REMOVE update clauses, and lists of top-level attributes. Only string-typed
+///key attributes are supported.
+///
+///As in DynamoDB, items whose time to live has passed are not removed 
+///promptly, so readers must still check expiration times themselves; here 
+///they are removed only when the backend is next constructed. 
+///
+///When a data directory is used, every modification is appended to a journal
+///file and flushed to disk before the operation returns. Flushing happens 
+///after the tables are unlocked, so that reads do not wait for the disk, and 
+///writers which arrive while a flush is in progress share the next one. A 
+///read may therefore see a modification shortly before it is durable.
+///
+///The journal is replayed when the backend is constructed and then rewritten
+///to contain only the live data; it is likewise compacted whenever it grows
+///to several times the size of the data it describes. An incomplete final
+///record is discarded, but damage anywhere else prevents construction. The
+///directory is locked, so only one process may use it at a time.
+class EmbeddedBackend : public StorageBackend{
+public:
+	///\param dataDirectory the directory in which data should be persisted,
+	///                     which will be created if it does not exist. If
+	///                     empty, data is kept only in memory.
+	explicit EmbeddedBackend(const std::string& dataDirectory="");
+	~EmbeddedBackend();
+
+	EmbeddedBackend(const EmbeddedBackend&)=delete;
+	EmbeddedBackend& operator=(const EmbeddedBackend&)=delete;
+
+	Aws::DynamoDB::Model::DescribeTableOutcome DescribeTable(const Aws::DynamoDB::Model::DescribeTableRequest& request) override;
+	Aws::DynamoDB::Model::CreateTableOutcome CreateTable(const Aws::DynamoDB::Model::CreateTableRequest& request) override;
+	Aws::DynamoDB::Model::UpdateTableOutcome UpdateTable(const Aws::DynamoDB::Model::UpdateTableRequest& request) override;
+	Aws::DynamoDB::Model::DeleteTableOutcome DeleteTable(const Aws::DynamoDB::Model::DeleteTableRequest& request) override;
+	Aws::DynamoDB::Model::DescribeTimeToLiveOutcome DescribeTimeToLive(const Aws::DynamoDB::Model::DescribeTimeToLiveRequest& request) override;
+	Aws::DynamoDB::Model::UpdateTimeToLiveOutcome UpdateTimeToLive(const Aws::DynamoDB::Model::UpdateTimeToLiveRequest& request) override;
+
+	Aws::DynamoDB::Model::GetItemOutcome GetItem(const Aws::DynamoDB::Model::GetItemRequest& request) override;
+	Aws::DynamoDB::Model::PutItemOutcome PutItem(const Aws::DynamoDB::Model::PutItemRequest& request) override;
+	Aws::DynamoDB::Model::UpdateItemOutcome UpdateItem(const Aws::DynamoDB::Model::UpdateItemRequest& request) override;
+	Aws::DynamoDB::Model::DeleteItemOutcome DeleteItem(const Aws::DynamoDB::Model::DeleteItemRequest& request) override;
+	Aws::DynamoDB::Model::QueryOutcome Query(const Aws::DynamoDB::Model::QueryRequest& request) override;
+	Aws::DynamoDB::Model::ScanOutcome Scan(const Aws::DynamoDB::Model::ScanRequest& request) override;
+
+	using Item=Aws::Map<Aws::String,Aws::DynamoDB::Model::AttributeValue>;
+	///An item's primary key: the values of its hash and range key attributes
+	using Key=std::pair<std::string,std::string>;
+
+private:
+	struct Index{
+		std::string hashKey;
+		std::string rangeKey;
+		Aws::DynamoDB::Model::GlobalSecondaryIndex definition;
+		///Primary keys of the items which have the index's hash key attribute,
+		///by the value of that attribute
+		std::multimap<std::string,Key> entries;
+	};
+
+	struct Table{
+		Aws::Vector<Aws::DynamoDB::Model::KeySchemaElement> keySchema;
+		std::string hashKey;
+		std::string rangeKey;
+		Aws::Vector<Aws::DynamoDB::Model::AttributeDefinition> attributes;
+		std::map<std::string,Index> indices;
+		std::map<Key,Item> items;
+		///The numeric attribute holding each item's expiration time, in 
+		///seconds since the epoch, or empty if items do not expire
+		std::string timeToLiveAttribute;
+	};
+
+	///Protects all tables and the journal
+	std::mutex mut;
+	std::map<std::string,Table> tables;
+
+	const std::string dataDirectory;
+	///Descriptor of the journal file, or -1 if data is not persisted
+	int journalFD;
+	///Descriptor of the lock file for the data directory
+	int lockFD;
+	///Number of records currently in the journal
+	std::size_t journalRecords;
+	///Serializes flushes of the journal, and protects journalFD from being 
+	///replaced during one
+	std::mutex syncMut;
+	///Number of records ever appended to the journal
+	std::atomic<uint64_t> journalWritten;
+	///Number of records ever appended which are known to be on disk
+	uint64_t journalSynced;
+
+	///Look up a table, throwing if it does not exist
+	Table& getTable(const std::string& name);
+	///Extract the primary key of an item according to a table's schema,
+	///throwing if it is missing
+	static Key itemKey(const Table& table, const Item& item);
+
+	///Insert or replace an item, updating indices
+	///\param record whether to add the change to the journal
+	void storeItem(const std::string& tableName, Table& table, Item item, bool record=true);
+	///Remove an item, updating indices
+	///\param record whether to add the change to the journal
+	void eraseItem(const std::string& tableName, Table& table, const Key& key, bool record=true);
+	///Add an index to a table, populating it from the table's current contents
+	static void addIndex(Table& table, const Aws::DynamoDB::Model::GlobalSecondaryIndex& definition);
+
+	///Remove all items whose expiration times have passed
+	void removeExpiredItems();
+	///Apply one journal record to the in-memory tables
+	void replay(const Aws::Utils::Json::JsonView& record);
+	///Append a record to the journal, without waiting for it to reach the disk
+	///Must be called with mut held
+	void journal(const Aws::Utils::Json::JsonValue& record);
+	///Ensure that journal records up to a given count are on disk
+	///\param written the value of journalWritten after the records to flush
+	void syncJournal(uint64_t written);
+	///Rewrite the journal to contain only the current state of the data
+	void compact();
+	///Compact the journal if it has grown much larger than the data
+	void maybeCompact();
+	static Aws::DynamoDB::Model::TableDescription describeTable(const std::string& name, const Table& table);
+};
+
+///Construct a storage backend
+///\param type the kind of backend: "dynamodb" or "embedded"
+///\param credentials the AWS credentials used with DynamoDB
+///\param clientConfig the DynamoDB endpoint to contact
+///\param dataDirectory the directory for the embedded backend's data
+std::unique_ptr<StorageBackend> makeStorageBackend(const std::string& type,
+                                                   const Aws::Auth::AWSCredentials& credentials,
+                                                   const Aws::Client::ClientConfiguration& clientConfig,
+                                                   const std::string& dataDirectory);
+
+#endif //SLATE_STORAGE_BACKEND_H
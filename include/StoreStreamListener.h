@@ -0,0 +1,90 @@
+#ifndef SLATE_STORE_STREAM_LISTENER_H
+#define SLATE_STORE_STREAM_LISTENER_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <aws/core/Aws.h>
+#include <aws/core/auth/AWSCredentialsProvider.h>
+#include <aws/dynamodb/DynamoDBClient.h>
+#include <aws/dynamodbstreams/DynamoDBStreamsClient.h>
+
+#include "PersistentStore.h"
+
+///Follows the DynamoDB Streams of the tables used by a PersistentStore and
+///applies every modification to the store's caches, so that changes made by
+///other server replicas become visible without waiting for cached records to
+///expire. Streams are enabled on the tables if necessary.
+///
+///Changes made by this replica are also observed, but are recognized and
+///ignored, since they were applied to the caches when they were made.
+///
+///If the position in a shard is lost because its records expired before they
+///were read, changes may have been missed. Reading then resumes from the
+///present, after which all cached data is discarded and the store begins a 
+///new generation epoch, so that nothing derived from the missed changes' 
+///predecessors is trusted.
+class StoreStreamListener{
+public:
+	///\param store the store whose caches should be kept up to date
+	///\param credentials the AWS credentials used for authenitcation with the
+	///                   database
+	///\param clientConfig specification of the database endpoint to contact
+	///\param pollInterval how often to check each stream shard for new records
+	///\throws std::runtime_error if a table's stream cannot be enabled
+	StoreStreamListener(PersistentStore& store,
+	                    const Aws::Auth::AWSCredentials& credentials,
+	                    const Aws::Client::ClientConfiguration& clientConfig,
+	                    std::chrono::milliseconds pollInterval=std::chrono::seconds(1));
+	~StoreStreamListener();
+
+	StoreStreamListener(const StoreStreamListener&)=delete;
+	StoreStreamListener& operator=(const StoreStreamListener&)=delete;
+
+	///\return the number of stream records applied so far
+	std::size_t recordsApplied() const{ return applied.load(); }
+
+private:
+	///The state of following one table's stream
+	struct TableStream{
+		StoreCollection collection;
+		std::string streamArn;
+		///Iterators for the shards currently being read, by shard ID
+		std::map<std::string,std::string> iterators;
+		///Shards which have been read to completion
+		std::set<std::string> finished;
+		///Whether records have been missed, so that cached data must be 
+		///discarded once the stream is being read again
+		bool positionLost=false;
+	};
+
+	PersistentStore& store;
+	Aws::DynamoDB::DynamoDBClient dbClient;
+	Aws::DynamoDBStreams::DynamoDBStreamsClient streamsClient;
+	const std::chrono::milliseconds pollInterval;
+	std::vector<TableStream> streams;
+	std::atomic<std::size_t> applied;
+	std::atomic<bool> stop;
+	std::thread poller;
+
+	///Ensure that a table has a stream including old and new item images
+	///\return the ARN of the table's stream
+	///\throws std::runtime_error if the stream cannot be enabled
+	std::string enableStream(const std::string& tableName);
+	///Begin reading any shards of a stream which are not already being read.
+	///\param initial whether this is the first discovery for the stream, in
+	///               which case only records written from now on are read
+	///\return whether every open shard is now being read
+	bool discoverShards(TableStream& stream, bool initial);
+	///Read and apply all available records from a stream's shards
+	///\return whether any shard was closed, requiring rediscovery
+	bool readShards(TableStream& stream);
+	void run();
+};
+
+#endif //SLATE_STORE_STREAM_LISTENER_H
@@ -6,6 +6,8 @@
 #define SLATE_CLIENT_SERVER_TELEMETRY_H
 #pragma once
 
+#include <memory>
+
 #include <crow.h>
 
 #include "opentelemetry/exporters/otlp/otlp_http_exporter_factory.h"
@@ -13,6 +15,7 @@
 #include "opentelemetry/sdk/trace/batch_span_processor_factory.h"
 #include "opentelemetry/sdk/trace/tracer_provider_factory.h"
 #include "opentelemetry/trace/provider.h"
+#include "opentelemetry/trace/scope.h"
 
 #include "opentelemetry/context/propagation/global_propagator.h"
 #include "opentelemetry/context/propagation/text_map_propagator.h"
@@ -39,42 +42,60 @@ void initializeTracer(const std::string &endpoint, const resource::ResourceAttri
 ///\return A shared ptr to a tracer that can be used to generate spans
 nostd::shared_ptr<trace::Tracer> getTracer(const std::string& tracerName = "SlateAPIServer");
 
-///Get options to use when creating a span for web facing functions
-///\param req crow request
-///\return Options to use to create a web span
-trace::StartSpanOptions getWebSpanOptions(const crow::request& req);
-
-///Get attributes to use when creating a span for internal functions
-///\param spanAttributes map with attributes
-///\return Attributes to use to create a web span
-void setInternalSpanAttributes(std::map<std::string, std::string>& spanAttributes);
-
-///Get options to use when creating a span for internal functions
-///\return Options to use to create a web span
-trace::StartSpanOptions getInternalSpanOptions();
-
-///Get attributes to use when creating a span for web facing functions
-///\param spanAttributes map with attributes
-///\param req crow request
-///\return Attributes to use to create a web span
-void setWebSpanAttributes(std::map<std::string, std::string>& spanAttributes, const crow::request& req);
+///Starts a span, makes it the active span on the current thread, and ends it
+///when destroyed. Attributes describing the work are only gathered if the
+///sampler chooses to record the span, so unsampled work costs little more
+///than the sampling decision.
+class SpanGuard{
+public:
+	///Start a span for handling a web request, continuing any trace propagated
+	///by the client
+	explicit SpanGuard(const crow::request& req);
+	///Start a span for internal work
+	explicit SpanGuard(nostd::string_view name);
+	///Start a span for internal work using a particular tracer
+	SpanGuard(const nostd::shared_ptr<trace::Tracer>& tracer, nostd::string_view name);
+	~SpanGuard();
+
+	SpanGuard(const SpanGuard&)=delete;
+	SpanGuard& operator=(const SpanGuard&)=delete;
+
+	trace::Span* operator->() const{ return span.get(); }
+	///\return whether the span will be recorded, so that it is worth
+	///        computing attributes for it
+	bool recording() const;
+
+private:
+	nostd::shared_ptr<trace::Span> span;
+	///Null if the span need not be made active
+	std::unique_ptr<trace::Scope> scope;
+
+	///Make the span active, unless that is unnecessary
+	///\param childOfCurrent whether the span's parent is the span which is
+	///                      currently active
+	void activate(bool childOfCurrent);
+};
 
 ///Set attributes for a span based on a crow request
 ///\param span span to populate with attributes
 ///\param req crow request
-void populateSpan(nostd::shared_ptr<trace::Span>& span, const crow::request& req);
+void populateSpan(SpanGuard& span, const crow::request& req);
 
 ///Set error for a given web related span and add error message
 ///\param span span to set
 ///\param mesg error message to add to span
 ///\param errorCode http error code for span
-void setWebSpanError(nostd::shared_ptr<trace::Span>& span, const std::string& mesg, int errorCode);
+void setWebSpanError(SpanGuard& span, const std::string& mesg, int errorCode);
 
-///Set error for a given web related span and add error message
+///Set error for a given span and add error message
 ///\param span span to set
 ///\param mesg error message to add to span
-///\param errorCode http error code for span
-void setSpanError(nostd::shared_ptr<trace::Span>& span, const std::string& mesg);
+void setSpanError(SpanGuard& span, const std::string& mesg);
+
+///Get the ID of the trace to which the span active on the calling thread 
+///belongs
+///\return the ID in hexadecimal, or an empty string if no span is active
+std::string currentTraceID();
 
 
 #endif //SLATE_CLIENT_SERVER_TELEMETRY_H
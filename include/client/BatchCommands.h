@@ -0,0 +1,62 @@
+#ifndef SLATE_BATCHCOMMANDS_H
+#define SLATE_BATCHCOMMANDS_H
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+///Split a line into words in the manner of a (very) simple shell: words
+///are separated by whitespace, and single quotes, double quotes, and
+///backslashes may be used to include whitespace within words.
+///\throws std::runtime_error if a quotation is not terminated
+std::vector<std::string> splitCommandLine(const std::string& line);
+
+///A single API request to be made as part of a batch
+struct BatchRequest{
+	///The line of the input from which the request came
+	std::size_t lineNumber;
+	///The text of the command
+	std::string command;
+	std::string method;
+	///The path of the request, relative to the API version
+	std::string path;
+	///Additional query parameters, each beginning with '&'
+	std::string query;
+	std::string body;
+	///The names and IDs of the objects which the request involves
+	std::set<std::string> objects;
+	///The names and IDs of the objects which the request changes, all of
+	///which are also in objects
+	std::set<std::string> changes;
+	///Whether the request may change objects other than the ones it names,
+	///such as the contents of a group which it deletes, so that it must not
+	///be sent together with any other request
+	bool exclusive;
+
+	BatchRequest():lineNumber(0),exclusive(false){}
+};
+
+///Translate a command into the API request which performs it
+///\param words the command, split into words
+///\param resolveInstance a function which converts an instance name to an
+///                       instance ID
+///\throws std::runtime_error if the command is not supported in batches, or
+///        its arguments are wrong
+BatchRequest parseBatchCommand(const std::vector<std::string>& words,
+                               const std::function<std::string(const std::string&)>& resolveInstance);
+
+///Find how many requests, starting from a given one, may be sent to the API
+///server together. A bundle ends before a request which involves an object
+///changed by an earlier request in the bundle, which changes an object an
+///earlier request involves, or which has the same path as an earlier request,
+///since a multiplexed request cannot contain the same URL twice. Exclusive
+///requests are always sent alone.
+///\param requests the requests to divide into bundles
+///\param start the index of the first request in the bundle
+///\param maxBundleSize the largest number of requests to send together
+///\return the index of the first request after the bundle
+std::size_t batchBundleEnd(const std::vector<BatchRequest>& requests, std::size_t start,
+                           std::size_t maxBundleSize);
+
+#endif //SLATE_BATCHCOMMANDS_H
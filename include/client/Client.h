@@ -7,6 +7,7 @@
 #include <condition_variable>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <stdexcept>
@@ -19,6 +20,8 @@
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include "HTTPRequests.h"
+#include "client/KubeResourceCache.h"
+#include "client/ResponseCache.h"
 
 #if ! ( __APPLE__ && __MACH__ )
 	//Whether to use CURLOPT_CAINFO to specify a CA bundle path.
@@ -304,6 +307,13 @@ struct SecretDeleteOptions : public SecretOptions{
 	SecretDeleteOptions():force(false),assumeYes(false){}
 };
 
+struct BatchOptions{
+	///The file from which commands are read, or "-" for stdin
+	std::string commandFile;
+	
+	BatchOptions():commandFile("-"){}
+};
+
 ///Try to get the value of an enviroment variable and store it to a string object.
 ///If the variable was not set \p target will not be modified. 
 ///\param name the name of the environment variable to get
@@ -453,6 +463,11 @@ public:
 
 	void deleteVolume(const VolumeDeleteOptions& opt);
 
+	///Run a sequence of commands, one per line, sending independent commands
+	///to the API server together as multiplexed requests, and print the 
+	///result of each as a line of JSON. 
+	void runBatch(const BatchOptions& opt);
+
 	bool clientShouldPrintOnlyJson() const;
 	
 private:
@@ -508,7 +523,19 @@ private:
 	}
 	
 	httpRequests::Options defaultOptions() const;
-	rapidjson::Document getClusterList(std::string group);
+	
+	///Make a GET request, using a response stored in the local cache if it is
+	///recent enough, or if the server confirms that it is still current. 
+	///Successful responses are stored for later use. 
+	///\param url the URL to request
+	///\param maxAge how long a stored response may be used without checking 
+	///              with the server. If zero, the server is always asked, but
+	///              need not resend an unchanged response. 
+	httpRequests::Response cachedGet(const std::string& url, std::chrono::seconds maxAge);
+	
+	///\param fields additional query parameters selecting the fields to fetch,
+	///              as produced by fieldsParameter
+	rapidjson::Document getClusterList(std::string group, const std::string& fields="");
 	
 #ifdef USE_CURLOPT_CAINFO
 	void detectCABundlePath() const;
@@ -609,6 +636,12 @@ private:
 	std::string formatOutput(const rapidjson::Value& jdata, const rapidjson::Value& original,
 				 const std::vector<columnSpec>& columns) const;
 	
+	///Construct the query parameter which asks the server to send only the 
+	///fields shown by the given default columns
+	///\return the parameter to append to a URL, or an empty string if the 
+	///        selected output format may need other fields
+	std::string fieldsParameter(const std::vector<columnSpec>& columns) const;
+	
 	///return true if the argument matches the correct format for an instance ID
 	static bool verifyInstanceID(const std::string& id);
 	///return true if the argument matches the correct format for a user ID
@@ -632,6 +665,13 @@ private:
 	std::size_t outputWidth;
 	std::string outputFormat;
 	std::string orderBy = "";
+	///Whether to use the local cache of API responses
+	bool useCache = true;
+	///The local cache of API responses, created when first needed
+	std::unique_ptr<ResponseCache> responseCache;
+	///Listings of Kubernetes objects made while checking and installing 
+	///cluster components
+	mutable KubeResourceCache kubeResources;
 #ifdef USE_CURLOPT_CAINFO
 	mutable std::string caBundlePath;
 #endif
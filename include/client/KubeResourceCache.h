@@ -0,0 +1,75 @@
+#ifndef SLATE_KUBERESOURCECACHE_H
+#define SLATE_KUBERESOURCECACHE_H
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+///Remembers the listings of Kubernetes objects fetched with kubectl during one
+///invocation of the client, so that the checks made while installing or
+///inspecting cluster components do not each list the same objects again.
+///Several kinds of objects which are not yet known can be fetched with a
+///single kubectl call, and concurrent requests for the same listing share one
+///fetch, so the cache may be used from multiple threads. Listings which
+///could not be fetched are not kept, so that later requests try again.
+class KubeResourceCache{
+public:
+	struct Listing{
+		///Whether kubectl failed to list the objects
+		bool failed;
+		///The error reported by kubectl, if it failed
+		std::string error;
+		///An array of the objects found
+		rapidjson::Document items;
+
+		Listing():failed(false),items(rapidjson::kArrayType){}
+	};
+
+	///Get the objects of several kinds, fetching all which are not already
+	///known with one kubectl call. If that call fails, each kind is fetched
+	///separately, so that a kind which cannot be listed does not prevent the
+	///others from being listed.
+	///\param configPath the kubeconfig to use
+	///\param nspace the namespace to search for namespaced objects, or an empty
+	///              string to search all namespaces
+	///\param selector a label selector which the objects must match, or an
+	///                empty string for all objects
+	///\param kinds the kinds of object to list, such as "Deployment"
+	///\return the listings for the kinds, in the same order
+	std::vector<std::shared_ptr<const Listing>> get(const std::string& configPath,
+	                                                const std::string& nspace,
+	                                                const std::string& selector,
+	                                                const std::vector<std::string>& kinds);
+
+	///Get the objects of one kind
+	std::shared_ptr<const Listing> get(const std::string& configPath,
+	                                   const std::string& nspace,
+	                                   const std::string& selector,
+	                                   const std::string& kind);
+
+	///Discard all listings from a cluster, which must be done after changing
+	///objects in it
+	///\param configPath the kubeconfig for the cluster
+	void invalidate(const std::string& configPath);
+
+private:
+	using Key=std::vector<std::string>;
+	std::mutex mut;
+	std::map<Key,std::shared_future<std::shared_ptr<const Listing>>> listings;
+};
+
+///Find an object by name in a listing
+///\return the object, or nullptr if there is none with that name
+const rapidjson::Value* findKubeObject(const KubeResourceCache::Listing& listing,
+                                      const std::string& name);
+
+///Get the value of a label of an object
+///\return the value, or an empty string if the object does not have the label
+std::string getKubeLabel(const rapidjson::Value& object, const std::string& label);
+
+#endif //SLATE_KUBERESOURCECACHE_H
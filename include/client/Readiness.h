@@ -0,0 +1,49 @@
+#ifndef SLATE_READINESS_H
+#define SLATE_READINESS_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+///Limits on how long and how often to check a condition while waiting for it
+struct WaitOptions{
+	///\param timeout the total time after which to stop waiting
+	explicit WaitOptions(std::chrono::milliseconds timeout):
+	timeout(timeout),initialDelay(50),maxDelay(5000),warnAfter(0){}
+
+	///The total time after which to stop waiting
+	std::chrono::milliseconds timeout;
+	///The delay before the condition is first rechecked, which doubles after
+	///each further check
+	std::chrono::milliseconds initialDelay;
+	///The longest delay between checks
+	std::chrono::milliseconds maxDelay;
+	///The time after which to call warning, if the condition has not yet been
+	///met. Zero disables the warning.
+	std::chrono::milliseconds warnAfter;
+	///A function to call, at most once, if waiting takes longer than warnAfter
+	std::function<void()> warning;
+};
+
+///Check a condition repeatedly, with exponentially increasing delays between
+///checks, until it is met or the timeout expires
+///\param condition the check to perform, which should return true when the
+///                 condition is met
+///\param options the limits on waiting
+///\return whether the condition was met before the timeout
+bool waitForCondition(const std::function<bool()>& condition, const WaitOptions& options);
+
+///Wait for Kubernetes objects to satisfy a condition using `kubectl wait`,
+///which watches the objects so that it returns as soon as they are ready.
+///Since `kubectl wait` fails immediately if the objects do not yet exist, it
+///is retried with backoff until the timeout expires.
+///\param configPath the kubeconfig to use
+///\param args the arguments to kubectl wait which select the objects and the
+///            condition, such as {"--for=condition=established", "crd/foo"}
+///\param options the limits on waiting
+///\return whether the condition was met before the timeout
+bool kubectlWaitFor(const std::string& configPath, const std::vector<std::string>& args,
+                    const WaitOptions& options);
+
+#endif //SLATE_READINESS_H
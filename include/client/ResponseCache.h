@@ -0,0 +1,66 @@
+#ifndef SLATE_RESPONSECACHE_H
+#define SLATE_RESPONSECACHE_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include "HTTPRequests.h"
+
+///Stores responses from the API server on disk, so that later invocations of
+///the client can reuse them instead of fetching the same data again. Each
+///response is stored with the time at which it was fetched and its entity tag,
+///if the server provided one, so that it can either be used directly while it
+///is fresh enough or revalidated cheaply with If-None-Match.
+///All operations are best effort: failures to read or write the cache are
+///treated as cache misses, so that a damaged or unwritable cache never
+///prevents the client from working.
+class ResponseCache{
+public:
+	struct Entry{
+		///When the response was fetched or last revalidated
+		std::chrono::system_clock::time_point stored;
+		///The entity tag sent by the server with the response, if any
+		std::string etag;
+		///The body of the response
+		std::string body;
+	};
+
+	///\param directory the directory in which responses are stored. It will be
+	///                 created, accessible only to the current user, if it
+	///                 does not exist.
+	explicit ResponseCache(std::string directory);
+
+	///Look up the stored response for a URL
+	///\param url the full URL of the request, including any query parameters
+	///\param entry the object into which the stored response will be placed
+	///\return whether a stored response was found
+	bool fetch(const std::string& url, Entry& entry) const;
+
+	///Store a response, replacing any which was previously stored for the
+	///same URL
+	///\param url the full URL of the request, including any query parameters
+	///\param entry the response to store
+	void store(const std::string& url, const Entry& entry) const;
+
+	///Get a response, using the stored one if it is recent enough, or if the
+	///server confirms that it is still current. Successful responses are
+	///stored for later use.
+	///\param url the full URL of the request, including any query parameters
+	///\param maxAge how long a stored response may be used without checking
+	///              with the server. If zero, the server is always asked, but
+	///              need not resend an unchanged response.
+	///\param request the function which makes the request, given the entity
+	///               tag of the stored response, if any, to send in
+	///               If-None-Match
+	httpRequests::Response get(const std::string& url, std::chrono::seconds maxAge,
+	                           std::function<httpRequests::Response(const std::string&)> request) const;
+
+private:
+	std::string directory;
+
+	///\return the path of the file in which the response for a URL is stored
+	std::string pathFor(const std::string& url) const;
+};
+
+#endif //SLATE_RESPONSECACHE_H
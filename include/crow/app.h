@@ -78,6 +78,22 @@ namespace crow
             return *this;
         }
 
+        // seconds for which an idle connection is kept open
+        self_t& timeout(int timeout)
+        {
+            if (timeout < 1)
+                timeout = 1;
+            timeout_ = timeout;
+            return *this;
+        }
+
+        // close connections after serving this many requests, or never if 0
+        self_t& max_requests_per_connection(unsigned int max_requests)
+        {
+            max_requests_ = max_requests;
+            return *this;
+        }
+
         self_t& multithreaded()
         {
             return concurrency(std::thread::hardware_concurrency());
@@ -111,6 +127,7 @@ namespace crow
             {
                 ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, &middlewares_, concurrency_, &ssl_context_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
+                ssl_server_->set_connection_limits(timeout_, max_requests_);
                 notify_server_start();
                 ssl_server_->run();
             }
@@ -119,6 +136,7 @@ namespace crow
             {
                 server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, &middlewares_, concurrency_, nullptr)));
                 server_->set_tick_function(tick_interval_, tick_function_);
+                server_->set_connection_limits(timeout_, max_requests_);
                 notify_server_start();
                 server_->run();
             }
@@ -248,6 +266,8 @@ namespace crow
     private:
         uint16_t port_ = 80;
         uint16_t concurrency_ = 1;
+        int timeout_ = 5;
+        unsigned int max_requests_ = 0;
         std::string bindaddr_ = "0.0.0.0";
         Router router_;
 
@@ -66,6 +66,12 @@ namespace crow
                 io_service_ = &io_service;
             }
 
+            // the number of seconds after which timers expire
+            void set_tick(int seconds)
+            {
+                tick = seconds;
+            }
+
             dumb_timer_queue() noexcept
             {
             }
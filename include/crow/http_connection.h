@@ -189,7 +189,8 @@ namespace crow
             std::tuple<Middlewares...>* middlewares,
             std::function<std::string()>& get_cached_date_str_f,
             detail::dumb_timer_queue& timer_queue,
-            typename Adaptor::context* adaptor_ctx_
+            typename Adaptor::context* adaptor_ctx_,
+            unsigned int max_requests = 0
             ) 
             : adaptor_(io_service, adaptor_ctx_), 
             handler_(handler), 
@@ -197,7 +198,8 @@ namespace crow
             server_name_(server_name),
             middlewares_(middlewares),
             get_cached_date_str(get_cached_date_str_f),
-            timer_queue(timer_queue)
+            timer_queue(timer_queue),
+            max_requests_(max_requests)
         {
 #ifdef CROW_ENABLE_DEBUG
             connectionCount ++;
@@ -258,6 +260,10 @@ namespace crow
             request& req = req_;
             req.remote_endpoint = boost::lexical_cast<std::string>(adaptor_.remote_endpoint());
 
+            // limit how long one client can keep a connection
+            if (max_requests_ && ++requests_served_ >= max_requests_)
+                close_connection_ = true;
+
             if (parser_.check_version(1, 0))
             {
                 // HTTP/1.0
@@ -438,7 +444,13 @@ namespace crow
                 buffers_.emplace_back(date_str_.data(), date_str_.size());
                 buffers_.emplace_back(crlf.data(), crlf.size());
             }
-            if (add_keep_alive_)
+            if (close_connection_)
+            {
+                static std::string close_tag = "Connection: close";
+                buffers_.emplace_back(close_tag.data(), close_tag.size());
+                buffers_.emplace_back(crlf.data(), crlf.size());
+            }
+            else if (add_keep_alive_)
             {
                 static std::string keep_alive_tag = "Connection: Keep-Alive";
                 buffers_.emplace_back(keep_alive_tag.data(), keep_alive_tag.size());
@@ -454,8 +466,16 @@ namespace crow
             if (need_to_start_read_after_complete_)
             {
                 need_to_start_read_after_complete_ = false;
-                start_deadline();
-                do_read();
+                if (close_connection_)
+                {
+                    // the write handler closes the connection and destroys it
+                    is_reading = false;
+                }
+                else
+                {
+                    start_deadline();
+                    do_read();
+                }
             }
         }
 
@@ -486,7 +506,7 @@ namespace crow
                         CROW_LOG_DEBUG << this << " from read(1)";
                         check_destroy();
                     }
-                    else if (close_connection_)
+                    else if (close_connection_ && !need_to_call_after_handlers_)
                     {
                         cancel_deadline_timer();
                         parser_.done();
@@ -593,6 +613,9 @@ namespace crow
         bool need_to_start_read_after_complete_{};
         bool add_keep_alive_{};
 
+        unsigned int max_requests_;
+        unsigned int requests_served_{};
+
         std::tuple<Middlewares...>* middlewares_;
         detail::context<Middlewares...> ctx_;
 
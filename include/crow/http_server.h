@@ -39,6 +39,12 @@ namespace crow
         {
         }
 
+        void set_connection_limits(int timeout, unsigned int max_requests)
+        {
+            timeout_ = timeout;
+            max_requests_ = max_requests;
+        }
+
         void set_tick_function(std::chrono::milliseconds d, std::function<void()> f)
         {
             tick_interval_ = d;
@@ -107,6 +113,7 @@ namespace crow
                             timer_queue_pool_[i] = &timer_queue;
 
                             timer_queue.set_io_service(*io_service_pool_[i]);
+                            timer_queue.set_tick(timeout_);
                             boost::asio::deadline_timer timer(*io_service_pool_[i]);
                             timer.expires_from_now(boost::posix_time::seconds(1));
 
@@ -191,7 +198,7 @@ namespace crow
             auto p = new Connection<Adaptor, Handler, Middlewares...>(
                 is, handler_, server_name_, middlewares_,
                 get_cached_date_str_pool_[roundrobin_index_], *timer_queue_pool_[roundrobin_index_],
-                adaptor_ctx_);
+                adaptor_ctx_, max_requests_);
             acceptor_.async_accept(p->socket(),
                 [this, p, &is](boost::system::error_code ec)
                 {
@@ -229,6 +236,9 @@ namespace crow
         std::chrono::milliseconds tick_interval_;
         std::function<void()> tick_function_;
 
+        int timeout_{5};
+        unsigned int max_requests_{};
+
         std::tuple<Middlewares...>* middlewares_;
 
 #ifdef CROW_ENABLE_SSL
@@ -23,6 +23,11 @@ namespace crow
             virtual void send_binary(const std::string& msg) = 0;
             virtual void send_text(const std::string& msg) = 0;
             virtual void close(const std::string& msg = "quit") = 0;
+            // run a handler on the thread which services this connection
+            virtual void post_task(std::function<void()> handler) = 0;
+            // bytes queued for sending but not yet written to the socket;
+            // only meaningful on the thread which services this connection
+            virtual std::size_t unsent_bytes() const = 0;
             virtual ~connection(){}
 
             void userdata(void* u) { userdata_ = u; }
@@ -115,6 +120,21 @@ namespace crow
                     });
                 }
 
+                void post_task(std::function<void()> handler) override
+                {
+                    post(std::move(handler));
+                }
+
+                std::size_t unsent_bytes() const override
+                {
+                    std::size_t size = 0;
+                    for(auto& s:sending_buffers_)
+                        size += s.size();
+                    for(auto& s:write_buffers_)
+                        size += s.size();
+                    return size;
+                }
+
                 void close(const std::string& msg) override
                 {
                     dispatch([this, msg]{
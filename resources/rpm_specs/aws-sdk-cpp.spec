@@ -41,6 +41,20 @@ Requires: aws-sdk-cpp-core-libs
 %description dynamodb-libs
 %{summary}.
 
+%package dynamodbstreams-devel
+Summary: headers for AWS C++ SDK for DynamoDB Streams
+Group: Development/Libraries
+Requires: aws-sdk-cpp-core-devel
+%description dynamodbstreams-devel
+%{summary}.
+
+%package dynamodbstreams-libs
+Summary: AWS C++ SDK runtime libraries for DynamoDB Streams
+Group: System Environment/Libraries
+Requires: aws-sdk-cpp-core-libs
+%description dynamodbstreams-libs
+%{summary}.
+
 %package route53-devel
 Summary: headers for AWS C++ SDK for Route53
 Group: Development/Libraries
@@ -62,7 +76,7 @@ Requires: aws-sdk-cpp-core-libs
 cd %{name}-%{version}
 mkdir -p build
 cd build
-cmake3 .. -DBUILD_ONLY="dynamodb;route53" -DBUILD_SHARED_LIBS=Off -Wno-error
+cmake3 .. -DBUILD_ONLY="dynamodb;dynamodbstreams;route53" -DBUILD_SHARED_LIBS=Off -Wno-error
 make
 
 %install
@@ -578,6 +592,13 @@ rm -rf $RPM_BUILD_ROOT
 %{_libdir}/cmake/aws-cpp-sdk-dynamodb/aws-cpp-sdk-dynamodb-targets-release.cmake
 %{_libdir}/libaws-cpp-sdk-dynamodb.a
 
+%files dynamodbstreams-devel
+%{_includedir}/aws/dynamodbstreams
+
+%files dynamodbstreams-libs
+%{_libdir}/cmake/aws-cpp-sdk-dynamodbstreams
+%{_libdir}/libaws-cpp-sdk-dynamodbstreams.a
+
 %files route53-devel
 %{_includedir}/aws/route53/Route53Client.h
 %{_includedir}/aws/route53/Route53Endpoint.h
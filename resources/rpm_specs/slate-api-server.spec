@@ -7,8 +7,8 @@ URL: https://github.com/slateci/slate-api-server
 
 Source0: slate-client-server-%{version}.tar.gz
 
-BuildRequires: gcc-c++ boost-devel zlib-devel openssl-devel libcurl-devel yaml-cpp-devel cmake3 aws-sdk-cpp-dynamodb-devel aws-sdk-cpp-route53-devel openssl-static
-Requires: boost zlib openssl libcurl yaml-cpp aws-sdk-cpp-dynamodb-libs aws-sdk-cpp-route53-libs cryptopp
+BuildRequires: gcc-c++ boost-devel zlib-devel openssl-devel libcurl-devel yaml-cpp-devel cmake3 aws-sdk-cpp-dynamodb-devel aws-sdk-cpp-dynamodbstreams-devel aws-sdk-cpp-route53-devel openssl-static
+Requires: boost zlib openssl libcurl yaml-cpp aws-sdk-cpp-dynamodb-libs aws-sdk-cpp-dynamodbstreams-libs aws-sdk-cpp-route53-libs cryptopp
 
 %description
 SLATE API Server
@@ -0,0 +1,123 @@
+#include <AccessIndex.h>
+
+#include <algorithm>
+#include <limits>
+
+const std::size_t AccessIndex::noSlot=std::numeric_limits<std::size_t>::max();
+
+AccessIndex::AccessIndex(std::string anyGroup, std::string anyApplication):
+anyGroup(std::move(anyGroup)),anyApplication(std::move(anyApplication)){}
+
+std::size_t AccessIndex::findSlot(const std::unordered_map<std::string,std::size_t>& slots,
+                                  const std::string& id) const{
+	auto it=slots.find(id);
+	if(it==slots.end())
+		return noSlot;
+	return it->second;
+}
+
+std::size_t AccessIndex::groupSlot(const std::string& groupID){
+	auto it=groupSlots.find(groupID);
+	if(it!=groupSlots.end())
+		return it->second;
+	std::size_t slot=groupIDs.size();
+	groupSlots.emplace(groupID,slot);
+	groupIDs.push_back(groupID);
+	return slot;
+}
+
+std::size_t AccessIndex::clusterSlot(const std::string& cID){
+	auto it=clusterSlots.find(cID);
+	if(it!=clusterSlots.end())
+		return it->second;
+	std::size_t slot=access.size();
+	clusterSlots.emplace(cID,slot);
+	access.emplace_back();
+	return slot;
+}
+
+bool AccessIndex::testBit(std::size_t clusterSlot, std::size_t groupSlot) const{
+	if(clusterSlot==noSlot || groupSlot==noSlot)
+		return false;
+	const Bitset& bits=access[clusterSlot];
+	std::size_t word=groupSlot/64;
+	if(word>=bits.size())
+		return false;
+	return bits[word] & ((uint64_t)1<<(groupSlot%64));
+}
+
+void AccessIndex::setGroupAccess(const std::string& cID, const std::string& groupID, bool allowed){
+	std::size_t cSlot=clusterSlot(cID);
+	std::size_t gSlot=groupSlot(groupID);
+	Bitset& bits=access[cSlot];
+	std::size_t word=gSlot/64;
+	if(word>=bits.size()){
+		if(!allowed)
+			return; //already clear
+		bits.resize(word+1,0);
+	}
+	if(allowed)
+		bits[word]|=((uint64_t)1<<(gSlot%64));
+	else
+		bits[word]&=~((uint64_t)1<<(gSlot%64));
+}
+
+bool AccessIndex::groupHasAccess(const std::string& cID, const std::string& groupID) const{
+	std::size_t cSlot=findSlot(clusterSlots,cID);
+	if(cSlot==noSlot)
+		return false;
+	return testBit(cSlot,findSlot(groupSlots,anyGroup)) ||
+	       testBit(cSlot,findSlot(groupSlots,groupID));
+}
+
+bool AccessIndex::allowsAllGroups(const std::string& cID) const{
+	return testBit(findSlot(clusterSlots,cID),findSlot(groupSlots,anyGroup));
+}
+
+std::vector<std::string> AccessIndex::groupsWithAccess(const std::string& cID) const{
+	std::vector<std::string> groups;
+	std::size_t cSlot=findSlot(clusterSlots,cID);
+	if(cSlot==noSlot)
+		return groups;
+	const Bitset& bits=access[cSlot];
+	for(std::size_t word=0; word<bits.size(); word++){
+		for(std::size_t bit=0; bit<64; bit++){
+			if(bits[word] & ((uint64_t)1<<bit)){
+				const std::string& groupID=groupIDs[word*64+bit];
+				if(groupID!=anyGroup)
+					groups.push_back(groupID);
+			}
+		}
+	}
+	std::sort(groups.begin(),groups.end());
+	return groups;
+}
+
+void AccessIndex::setApplications(const std::string& cID, const std::string& groupID,
+                                  std::set<std::string> applications){
+	applicationSets[pairKey(clusterSlot(cID),groupSlot(groupID))]=std::move(applications);
+}
+
+std::set<std::string> AccessIndex::applications(const std::string& cID, const std::string& groupID) const{
+	std::size_t cSlot=findSlot(clusterSlots,cID);
+	std::size_t gSlot=findSlot(groupSlots,groupID);
+	if(cSlot!=noSlot && gSlot!=noSlot){
+		auto it=applicationSets.find(pairKey(cSlot,gSlot));
+		if(it!=applicationSets.end())
+			return it->second;
+	}
+	//with no record, all applications are allowed
+	return {anyApplication};
+}
+
+bool AccessIndex::applicationAllowed(const std::string& cID, const std::string& groupID,
+                                     const std::string& application) const{
+	std::size_t cSlot=findSlot(clusterSlots,cID);
+	std::size_t gSlot=findSlot(groupSlots,groupID);
+	if(cSlot==noSlot || gSlot==noSlot)
+		return true;
+	auto it=applicationSets.find(pairKey(cSlot,gSlot));
+	if(it==applicationSets.end())
+		return true;
+	return it->second.count(anyApplication) || it->second.count(application);
+}
@@ -62,13 +62,7 @@ std::string filterValuesFile(std::string data){
 }
 
 crow::response listApplications(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 
 	using namespace std::chrono;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
@@ -88,7 +82,6 @@ crow::response listApplications(PersistentStore& store, const crow::request& req
 	}
 	catch(std::runtime_error& err){
 		setWebSpanError(span, std::string("helm search failed: ").append(err.what()), 500);
-		span->End();
 		return crow::response(500,generateError("helm search failed"));
 	}
 
@@ -117,18 +110,11 @@ crow::response listApplications(PersistentStore& store, const crow::request& req
 
 	high_resolution_clock::time_point t2 = high_resolution_clock::now();
 	log_info("application listing completed in " << duration_cast<duration<double>>(t2-t1).count() << " seconds");
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response fetchApplicationConfig(PersistentStore& store, const crow::request& req, const std::string& appName){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -157,20 +143,17 @@ crow::response fetchApplicationConfig(PersistentStore& store, const crow::reques
 	catch(std::runtime_error& err){
 		const std::string& errMesg = std::string("Runtime Error: ") + err.what();
 		setWebSpanError(span, errMesg, 500);
-		span->End();
 		return crow::response(500, generateError(errMesg));
 	}
 	if(!application) {
 		const std::string& err = "Application not found";
 		setWebSpanError(span, err, 404);
-		span->End();
 		return crow::response(404, generateError(err));
 	}
 	auto commandResult = runCommand("helm",{"inspect","values",repoName + "/" + application.name, "--version", application.chartVersion});
 	if(commandResult.status){
 		const std::string& err = "Unable to fetch application config";
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error("Command failed: helm inspect " << (repoName + "/" + appName) << ": [exit] " << commandResult.status << " [err] " << commandResult.error << " [out] " << commandResult.output);
 		return crow::response(500, generateError(err));
 	}
@@ -191,19 +174,11 @@ crow::response fetchApplicationConfig(PersistentStore& store, const crow::reques
 	spec.AddMember("body", filterValuesFile(commandResult.output), alloc);
 	result.AddMember("spec", spec, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response fetchApplicationVersions(PersistentStore& store, const crow::request& req, const std::string& appName){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -226,13 +201,11 @@ crow::response fetchApplicationVersions(PersistentStore& store, const crow::requ
 	}
 	catch(std::runtime_error& err){
 		setWebSpanError(span, std::string("Runtime error: ").append(err.what()), 500);
-		span->End();
 		return crow::response(500);
 	}
 	if(!application) {
 		const std::string& err = "Application not found";
 		setWebSpanError(span, err, 404);
-		span->End();
 		return crow::response(404, generateError(err));
 	}
 	
@@ -240,7 +213,6 @@ crow::response fetchApplicationVersions(PersistentStore& store, const crow::requ
 	if(commandResult.status){
 		const std::string& err = "Unable to fetch application versions";
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error("Command failed: helm search " << (repoName + "/" + appName) << ": [exit] " << commandResult.status << " [err] " << commandResult.error << " [out] " << commandResult.output);
 		return crow::response(500, generateError(err));
 	}
@@ -278,19 +250,11 @@ crow::response fetchApplicationVersions(PersistentStore& store, const crow::requ
 	spec.AddMember("body", versions, alloc);
 	result.AddMember("spec", spec, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response fetchApplicationDocumentation(PersistentStore& store, const crow::request& req, const std::string& appName){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
 
@@ -317,13 +281,11 @@ crow::response fetchApplicationDocumentation(PersistentStore& store, const crow:
 	}
 	catch(std::runtime_error& err){
 		setWebSpanError(span, std::string("Runtime error: ").append(err.what()), 500);
-		span->End();
 		return crow::response(500);
 	}
 	if(!application) {
 		const std::string& err = "Application not found";
 		setWebSpanError(span, err, 404);
-		span->End();
 		return crow::response(404, generateError(err));
 	}
 	
@@ -331,7 +293,6 @@ crow::response fetchApplicationDocumentation(PersistentStore& store, const crow:
 	if(commandResult.status){
 		const std::string& err = "Unable to fetch application readme";
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error("Command failed: helm inspect " << (repoName + "/" + appName) << ": [exit] " << commandResult.status << " [err] " << commandResult.error << " [out] " << commandResult.output);
 		return crow::response(500, generateError(err));
 	}
@@ -352,7 +313,6 @@ crow::response fetchApplicationDocumentation(PersistentStore& store, const crow:
 	spec.AddMember("body", commandResult.output, alloc);
 	result.AddMember("spec", spec, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
@@ -381,50 +341,39 @@ std::string assembleExtraHelmValues(const PersistentStore& store, const Cluster&
 
 ///Internal function which requires that initial authorization checks have already been performed
 crow::response installApplicationImpl(PersistentStore& store, const User& user, const std::string& appName, const std::string& installSrc, const rapidjson::Document& body){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("installApplicationImpl", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("installApplicationImpl");
 	span->SetAttribute("user", user.name);
 
 	if(!body.HasMember("group")) {
 		const std::string& err = "Missing Group";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	if(!body["group"].IsString()) {
 		const std::string& err = "Incorrect type for Group";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	const std::string groupID=body["group"].GetString();
 	if(!body.HasMember("cluster")) {
 		const std::string& err = "Missing cluster";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	if(!body["cluster"].IsString()) {
 		const std::string& err = "Incorrect type for cluster";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	const std::string clusterID=body["cluster"].GetString();
 	if(!body.HasMember("configuration")) {
 		const std::string& err = "Missing configuration";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	if(!body["configuration"].IsString()) {
 		const std::string& err = "Incorrect type for configuration";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	const std::string config=body["configuration"].GetString();
@@ -459,7 +408,6 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 		if(!extractInstanceTag(config, yamlError)) {
 			const std::string& err = "Configuration could not be parsed as YAML.\n" + yamlError;
 			setWebSpanError(span, err, 400);
-			span->End();
 			return crow::response(400, generateError(err));
 		}
 	}
@@ -471,20 +419,17 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 			log_error("Command failed: helm inspect values " << installSrc << ": [exit] " << commandResult.status << " [err] " << commandResult.error << " [out] " << commandResult.output);
 			const std::string& err = "Unable to fetch default application config";
 			setWebSpanError(span, err, 500);
-			span->End();
 			return crow::response(500, generateError(err));
 		}
 		if(!extractInstanceTag(commandResult.output, yamlError)) {
 			const std::string& err = "Default configuration could not be parsed as YAML.\n" + yamlError;
 			setWebSpanError(span, err, 500);
-			span->End();
 			return crow::response(500, generateError(err));
 		}
 	}
 	if(!gotTag){
 		const std::string& err = "Failed to determine instance tag for "+appName;
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error(err);
 		return crow::response(500, generateError(err));
 	}
@@ -499,13 +444,11 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	if(!validTagGroupName(tag)) {
 		const std::string& err = "Instance tags names may only contain [a-z], [0-9] and -";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	if(!tag.empty() && tag.back()=='-') {
 		const std::string& err = "Instance tags names may not end with a dash";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	
@@ -514,14 +457,12 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	if(!group) {
 		const std::string& err = "Invalid Group";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	const Cluster cluster=store.getCluster(clusterID);
 	if(!cluster) {
 		const std::string& err = "Invalid Cluster";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	span->SetAttribute("cluster", cluster.name);
@@ -529,7 +470,6 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	if(!store.userInGroup(user.id,group.id)) {
 		const std::string& err = "Not authorized";
 		setWebSpanError(span, err, 403);
-		span->End();
 		return crow::response(403, generateError(err));
 	}
 	//The Group must own or be allowed to access to the cluster to install
@@ -540,13 +480,11 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 		if(!store.groupAllowedOnCluster(group.id,cluster.id)) {
 			const std::string& err = "Not authorized";
 			setWebSpanError(span, err, 403);
-			span->End();
 			return crow::response(403, generateError(err));
 		}
 		if(!store.groupMayUseApplication(group.id, cluster.id, appName)) {
 			const std::string& err = "Not authorized";
 			setWebSpanError(span, err, 403);
-			span->End();
 			return crow::response(403, generateError(err));
 		}
 	}
@@ -570,7 +508,6 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	if(instance.name.size()>63) {
 		const std::string& err = "Instance tag too long";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	
@@ -582,23 +519,19 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 			const std::string& err = "Instance name is already in use,"
 			                         " consider using a different tag";
 			setWebSpanError(span, err, 400);
-			span->End();
 			return crow::response(400, generateError(err));
 		}
 	}
 	
 	//write configuration to a file for helm's benefit
-	FileHandle instanceConfig=makeTemporaryFile(instance.id);
-	{
-		std::ofstream outfile(instanceConfig.path());
-		outfile << instance.config;
-		if(!outfile){
-			const std::string& err = "Failed to write instance configuration to " + instanceConfig.path();
-			setWebSpanError(span, err, 500);
-			span->End();
-			log_error(err);
-			return crow::response(500,generateError(err));
-		}
+	FileHandle instanceConfig;
+	try{
+		instanceConfig=makeMemoryFile(instance.id,instance.config);
+	}catch(std::runtime_error& ex){
+		const std::string& err = "Failed to write instance configuration: " + std::string(ex.what());
+		setWebSpanError(span, err, 500);
+		log_error(err);
+		return crow::response(500,generateError(err));
 	}
 	
 	log_info("Instantiating " << appName << " on " << cluster);
@@ -608,7 +541,6 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	if(!success){
 		const std::string& err = "Failed to add application instance record to the persistent store";
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error(err);
 		return crow::response(500,generateError(err));
 	}
@@ -619,22 +551,19 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	auto clusterConfig=store.configPathForCluster(cluster.id);
 
 	span->AddEvent("kubectl create ns");
-	setInternalSpanAttributes(attributes);
-	options = getInternalSpanOptions();
-	auto nsSpan = tracer->StartSpan("kubectl create ns", attributes, options);
-	auto nsScope = tracer->WithActiveSpan(nsSpan);
-	try{
-		kubernetes::kubectl_create_namespace(*clusterConfig, group);
-		nsSpan->End();
-	}
-	catch(std::runtime_error& err){
-		std::ostringstream errMsg;
-		errMsg << "Failure installing " << appName << " on " << cluster << ": " << err.what();
-		log_error(errMsg.str());
-		setSpanError(nsSpan, errMsg.str());
-		store.removeApplicationInstance(instance.id);
-		nsSpan->End();
-		return crow::response(500,generateError(err.what()));
+	{
+		SpanGuard nsSpan("kubectl create ns");
+		try{
+			kubernetes::kubectl_create_namespace(*clusterConfig, group);
+		}
+		catch(std::runtime_error& err){
+			std::ostringstream errMsg;
+			errMsg << "Failure installing " << appName << " on " << cluster << ": " << err.what();
+			log_error(errMsg.str());
+			setSpanError(nsSpan, errMsg.str());
+			store.removeApplicationInstance(instance.id);
+			return crow::response(500,generateError(err.what()));
+		}
 	}
 
 	
@@ -654,19 +583,20 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	}
 
 	span->AddEvent("helm install");
-	setInternalSpanAttributes(attributes);
-	options = getInternalSpanOptions();
-	auto helmSpan = tracer->StartSpan("helm install", attributes, options);
-	auto helmScope = tracer->WithActiveSpan(helmSpan);
-	auto commandResult=runCommand("helm",installArgs,{{"KUBECONFIG",*clusterConfig}});
+	std::string errMsg;
+	{
+		SpanGuard helmSpan("helm install");
+		auto commandResult=runCommand("helm",installArgs,{{"KUBECONFIG",*clusterConfig}});
+		if(commandResult.status || 
+		   (commandResult.output.find("STATUS: DEPLOYED")==std::string::npos
+		    && commandResult.output.find("STATUS: deployed")==std::string::npos)){
+			errMsg="Failed to start application instance with helm:\n[exit] "+std::to_string(commandResult.status)+"\n[err]: "+commandResult.error+"\n[out]: "+commandResult.output+"\n system namespace: "+cluster.systemNamespace;
+			setSpanError(helmSpan, errMsg);
+		}
+	}
 	//if application instantiation fails, remove record from DB again
-	if(commandResult.status || 
-	   (commandResult.output.find("STATUS: DEPLOYED")==std::string::npos
-	    && commandResult.output.find("STATUS: deployed")==std::string::npos)){
-		std::string errMsg="Failed to start application instance with helm:\n[exit] "+std::to_string(commandResult.status)+"\n[err]: "+commandResult.error+"\n[out]: "+commandResult.output+"\n system namespace: "+cluster.systemNamespace;
+	if(!errMsg.empty()){
 		log_error(errMsg);
-		setSpanError(helmSpan, errMsg);
-		helmSpan->End();
 
 		store.removeApplicationInstance(instance.id);
 		//helm will (unhelpfully) keep broken 'releases' around, so clean up here
@@ -682,16 +612,13 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 		}
 
 		span->AddEvent("helm cleanup delete");
-		setInternalSpanAttributes(attributes);
-		options = getInternalSpanOptions();
-		auto helmDeleteSpan = tracer->StartSpan("helm cleanup delete", attributes, options);
-		auto helmDeleteScope = tracer->WithActiveSpan(helmDeleteSpan);
-		runCommand("helm",deleteArgs,{{"KUBECONFIG",*clusterConfig}});
-		helmDeleteSpan->End();
+		{
+			SpanGuard helmDeleteSpan("helm cleanup delete");
+			runCommand("helm",deleteArgs,{{"KUBECONFIG",*clusterConfig}});
+		}
 		//TODO: include any other error information?
 		return crow::response(500,generateError(errMsg));
 	}
-	helmSpan->End();
 	
 	log_info("Installed " << instance << " of " << appName
 	         << " to " << cluster << " on behalf of " << user);
@@ -734,26 +661,17 @@ crow::response installApplicationImpl(PersistentStore& store, const User& user,
 	result.AddMember("metadata", metadata, alloc);
 	result.AddMember("status", "DEPLOYED", alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response installApplication(PersistentStore& store, const crow::request& req, const std::string& appName){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
 	if(!user) {
 		const std::string& err = "An unauthorized user attempted to install an instance of " + appName;
 		setWebSpanError(span, err, 403);
-		span->End();
 		log_info("An unauthorized user attempted to install an instance of " << appName << " from " << req.remote_endpoint);
 		return crow::response(403, generateError(err));
 	}
@@ -764,7 +682,6 @@ crow::response installApplication(PersistentStore& store, const crow::request& r
 	if(appName.find('\'')!=std::string::npos) {
 		const std::string& err = "Application names cannot contain single quote characters";
 		setWebSpanError(span, err, 400);
-		span->End();
 		return crow::response(400, generateError(err));
 	}
 	//collect data out of JSON body
@@ -774,13 +691,11 @@ crow::response installApplication(PersistentStore& store, const crow::request& r
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = std::string("Invalid JSON in request body: ").append(err.what()) ;
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 
@@ -796,12 +711,10 @@ crow::response installApplication(PersistentStore& store, const crow::request& r
 	catch(std::runtime_error& err){
 		const std::string& errMsg = std::string("Runtime error: ").append(err.what());
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(500);
 	}
 	if (!application) {
 		setWebSpanError(span, "Application not found", 404);
-		span->End();
 		return crow::response(404, generateError("Application not found"));
 	}
 	log_info(user << " requested to install an instance of " << application << " from " << req.remote_endpoint);
@@ -812,11 +725,7 @@ crow::response installApplication(PersistentStore& store, const crow::request& r
 //return a pair consisting of either true and the chart's/application's name
 //or false and the error message from helm
 std::pair<bool,std::string> extractChartName(const std::string& path){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("extractChartName", attributes, options);
+	SpanGuard span("extractChartName");
 
 	span->AddEvent("helm inspect chart");
 	auto result=kubernetes::helm("","",{"inspect","chart",path});
@@ -827,29 +736,19 @@ std::pair<bool,std::string> extractChartName(const std::string& path){
 			if (!node.IsMap() || !node["name"] || !node["name"].IsScalar()) {
 				throw YAML::ParserException(YAML::Mark(), "Unexpected document structure");
 			}
-			span->End();
 			return std::make_pair(true,node["name"].as<std::string>());
 		}catch(const YAML::ParserException& ex){
 			setSpanError(span, std::string("Yaml parse error: ").append(ex.what()));
-			span->End();
 			return std::make_pair(false,"Did not get valid YAML chart description");
 		}
 	}
 	else {
-		span->End();
 		return std::make_pair(false, result.error);
 	}
 }
 
 crow::response installAdHocApplication(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -858,7 +757,6 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 	if(!user) {
 		const std::string& err = "An unauthorized user attempted to install an ad-hoc application";
 		setWebSpanError(span, err, 403);
-		span->End();
 		log_info(err);
 		return crow::response(403, generateError(err));
 	}
@@ -870,14 +768,12 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = std::string("Invalid JSON in request body: ").append(err.what());
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -885,14 +781,12 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 	if(!body.HasMember("chart")) {
 		const std::string& errMsg = "Missing chart";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["chart"].IsString()) {
 		const std::string& errMsg = "Incorrect type for chart";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -916,7 +810,6 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 	}catch(std::exception& ex){
 		const std::string& errMsg = std::string("Unable to extract application chart: ") + ex.what();
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -938,7 +831,6 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 		else {
 			const std::string& errMsg = "Too many directories in chart tarball";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			log_error(errMsg);
 			return crow::response(400, generateError(errMsg));
 		}
@@ -946,7 +838,6 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 	if(!foundSubDir) {
 		const std::string& errMsg = "No directory in chart tarball";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -957,33 +848,23 @@ crow::response installAdHocApplication(PersistentStore& store, const crow::reque
 	if (templates == tempNotFound) {
 		const std::string& errMsg = "Templates subdirectory not found in chart tarball";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!nameInfo.first) {
 		const std::string& errMsg = std::string("No name obtained for chart");
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	appName=nameInfo.second;
-	span->End();
 	return installApplicationImpl(store, user, appName, chartSubDir, body);
 
 	//return crow::response(500,generateError("Ad-hoc application installation is not implemented"));
 }
 
 crow::response updateCatalog(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -991,7 +872,6 @@ crow::response updateCatalog(PersistentStore& store, const crow::request& req){
 	if(!user) {
 		const std::string& err = "An unauthorized user attempted to update the application catalog";
 		setWebSpanError(span, err, 403);
-		span->End();
 		log_info(err);
 		return crow::response(403, generateError(err));
 	}
@@ -1001,7 +881,6 @@ crow::response updateCatalog(PersistentStore& store, const crow::request& req){
 		std::ostringstream msg;
 		msg << "helm repo update failed: [exit] " << result.status << " [err] " << result.error << " [out] " << result.output;
 		setWebSpanError(span, msg.str(), 500);
-		span->End();
 		log_info(msg.str());
 		return crow::response(500,generateError("helm repo update failed"));
 	}
@@ -1009,6 +888,5 @@ crow::response updateCatalog(PersistentStore& store, const crow::request& req){
 	store.fetchApplications("slate");
 	store.fetchApplications("slate-dev");
 
-	span->End();
 	return crow::response(200);
 }
@@ -3,6 +3,7 @@
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
 
+#include "JSONExtractor.h"
 #include "KubeInterface.h"
 #include "Logging.h"
 #include "Telemetry.h"
@@ -12,13 +13,7 @@
 #include <chrono>
 
 crow::response listApplicationInstances(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 
 	using namespace std::chrono;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
@@ -28,7 +23,6 @@ crow::response listApplicationInstances(PersistentStore& store, const crow::requ
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -54,6 +48,7 @@ crow::response listApplicationInstances(PersistentStore& store, const crow::requ
 	} else {
 		instances=store.listApplicationInstances();
 	}
+	const FieldSelection fields(req);
 	
 	rapidjson::Document result(rapidjson::kObjectType);
 	rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
@@ -73,10 +68,13 @@ crow::response listApplicationInstances(PersistentStore& store, const crow::requ
 			application = application.substr(application.find('/') + 1);
 		}
 		instanceData.AddMember("application", application, alloc);
-		instanceData.AddMember("group", store.getGroup(instance.owningGroup).name, alloc);
-		instanceData.AddMember("cluster", store.getCluster(instance.cluster).name, alloc);
+		if(fields.includes("/metadata/group"))
+			instanceData.AddMember("group", store.getGroup(instance.owningGroup).name, alloc);
+		if(fields.includes("/metadata/cluster"))
+			instanceData.AddMember("cluster", store.getCluster(instance.cluster).name, alloc);
 		instanceData.AddMember("created", instance.ctime, alloc);
 		instanceResult.AddMember("metadata", instanceData, alloc);
+		fields.apply(instanceResult);
 		resultItems.PushBack(instanceResult, alloc);
 		//TODO: query helm to get current status (helm list {instance.name})?
 	}
@@ -84,10 +82,32 @@ crow::response listApplicationInstances(PersistentStore& store, const crow::requ
 
 	high_resolution_clock::time_point t2 = high_resolution_clock::now();
 	log_info("instance listing completed in " << duration_cast<duration<double>>(t2-t1).count() << " seconds");
-	span->End();
 	return crow::response(to_string(result));
 }
 
+std::string listApplicationInstancesETag(PersistentStore& store, const crow::request& req){
+	//instance listings include group and cluster names
+	std::vector<uint64_t> generations{store.getGeneration(StoreCollection::Groups),
+	                                  store.getGeneration(StoreCollection::Clusters)};
+	auto group = req.url_params.get("group");
+	auto cluster = req.url_params.get("cluster");
+	if(group){
+		const Group g=store.getGroup(group);
+		if(!g)
+			return "";
+		generations.push_back(store.getGeneration(StoreCollection::Instances, g.id));
+	}
+	if(cluster){
+		const Cluster c=store.getCluster(cluster);
+		if(!c)
+			return "";
+		generations.push_back(store.getGeneration(StoreCollection::Instances, c.id));
+	}
+	if(!group && !cluster)
+		generations.push_back(store.getGeneration(StoreCollection::Instances));
+	return makeETag(store.getETagEpoch(), req.raw_url, generations);
+}
+
 struct ServiceInterface{
 	//represent IP addresses as strings because
 	//1) it's simple
@@ -105,13 +125,7 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 							const std::string &releaseName,
 							const std::string &nspace,
 							const std::string &systemNamespace) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("getServices", attributes, options);
-
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("getServices");
 
 	using namespace std::chrono;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
@@ -124,18 +138,24 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 		err << "kubectl get services failed for instance " << releaseName << ": " << servicesResult.error;
 		setSpanError(span, err.str());
 		log_error(err.str());
-		span->End();
 		return {};
 	}
+	static const JSONExtractor serviceFields({
+		"/items/*/metadata/name",
+		"/items/*/spec/clusterIP",
+		"/items/*/spec/type",
+		"/items/*/spec/selector",
+		"/items/*/spec/ports",
+		"/items/*/status/loadBalancer",
+	});
 	rapidjson::Document servicesData;
 	try{
-		servicesData.Parse(servicesResult.output.c_str());
+		serviceFields.parseInsitu(servicesResult.output,servicesData);
 	}catch(std::runtime_error& err){
 		std::ostringstream  errMsg;
 		errMsg << "Unable to parse kubectl get services JSON output for " << nspace << "::" << releaseName << ": " << err.what();
 		log_error(errMsg.str());
 		setSpanError(span, errMsg.str());
-		span->End();
 		return {};
 	}
 
@@ -180,19 +200,21 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 				errMsg << "kubectl get pod -l " << filter << " --namespace " << nspace << " failed: " << podResult.error;
 				log_error(errMsg.str());
 				setSpanError(span, errMsg.str());
-				span->End();
 				continue;
 			}
+			static const JSONExtractor podFields({
+				"/items/*/status/hostIP",
+				"/items/*/spec/nodeName",
+			});
 			rapidjson::Document podData;
 			try{
-				podData.Parse(podResult.output.c_str());
+				podFields.parseInsitu(podResult.output,podData);
 			}catch(std::runtime_error& err){
 				std::ostringstream  errMsg;
 				errMsg << "Unable to parse kubectl get service JSON output for kubectl get pod -l "
 				       << filter << " --namespace " << nspace << ": " << err.what();
 				log_error(errMsg.str());
 				setSpanError(span, errMsg.str());
-				span->End();
 				continue;
 			}
 			if(podData["items"].GetArray().Size()==0){
@@ -200,12 +222,11 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 				errMsg << "Did not find any pods matching service selector for " << nspace << "::" << serviceName;
 				log_error(errMsg.str());
 				setSpanError(span, errMsg.str());
-				span->End();
 				continue;
 			}
-			if(podData["items"][0]["status"].HasMember("hostIP")){
+			if(podData["items"][0].HasMember("status") && podData["items"][0]["status"].HasMember("hostIP")){
 				// now we should get the node info, to see if it has a ExternalIP which we ought to preferentially use
-				if(podData["items"][0]["spec"].HasMember("nodeName")) {
+				if(podData["items"][0].HasMember("spec") && podData["items"][0]["spec"].HasMember("nodeName")) {
 					auto nodename=podData["items"][0]["spec"]["nodeName"].GetString();
 
 					t1 = high_resolution_clock::now();
@@ -224,9 +245,10 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 					// data, but we'll try to get something more accurate
 					interface.externalIP=podData["items"][0]["status"]["hostIP"].GetString();
 
+					static const JSONExtractor nodeFields({"/status/addresses"});
 					rapidjson::Document nodeData;
 					try{
-						nodeData.Parse(nodeResult.output.c_str());
+						nodeFields.parseInsitu(nodeResult.output,nodeData);
 					}catch(std::runtime_error& err){
 						std::ostringstream  errMsg;
 						errMsg << "Unable to parse kubectl node JSON output for kubectl get node " << nodename << ": " << err.what();
@@ -294,18 +316,17 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 		errMsg << "kubectl get ingresses failed for instance " << releaseName << ": " << ingressesResult.error;
 		log_error(errMsg.str());
 		setSpanError(span, errMsg.str());
-		span->End();
 		return {};
 	}
+	static const JSONExtractor ingressFields({"/items/*/spec/rules"});
 	rapidjson::Document ingressesData;
 	try{
-		ingressesData.Parse(ingressesResult.output.c_str());
+		ingressFields.parseInsitu(ingressesResult.output,ingressesData);
 	}catch(std::runtime_error& err){
 		std::ostringstream  errMsg;
 		errMsg << "Unable to parse kubectl get ingresses JSON output for " << nspace << "::" << releaseName << ": " << err.what();
 		log_error(errMsg.str());
 		setSpanError(span, errMsg.str());
-		span->End();
 		return {};
 	}
 	for(const auto& ingressData : ingressesData["items"].GetArray()){
@@ -363,7 +384,6 @@ std::multimap<std::string,ServiceInterface> getServices(const SharedFileHandle&
 			}
 		}
 	}
-	span->End();
 	return services;
 }
 
@@ -373,12 +393,7 @@ rapidjson::Value fetchInstanceDetails(PersistentStore &store,
 				      const ApplicationInstance &instance,
 				      const std::string &systemNamespace,
 				      rapidjson::Document::AllocatorType &alloc) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("fetchInstanceDetails", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("fetchInstanceDetails");
 
 	rapidjson::Value instanceDetails(rapidjson::kObjectType);
 	rapidjson::Value podDetails(rapidjson::kArrayType);
@@ -406,21 +421,35 @@ rapidjson::Value fetchInstanceDetails(PersistentStore &store,
 		podDetails.PushBack(podInfo,alloc);
 		instanceDetails.AddMember("pods",podDetails,alloc);
 		setSpanError(span, err.str());
-		span->End();
 		return instanceDetails;
 	}	
 
+	static const JSONExtractor podFields({
+		"/items/*/metadata/name",
+		"/items/*/metadata/creationTimestamp",
+		"/items/*/spec/nodeName",
+		"/items/*/status/hostIP",
+		"/items/*/status/phase",
+		"/items/*/status/conditions",
+		"/items/*/status/message",
+		"/items/*/status/containerStatuses/*/image",
+		"/items/*/status/containerStatuses/*/imageID",
+		"/items/*/status/containerStatuses/*/name",
+		"/items/*/status/containerStatuses/*/ready",
+		"/items/*/status/containerStatuses/*/restartCount",
+		"/items/*/status/containerStatuses/*/state",
+		"/items/*/status/containerStatuses/*/lastState",
+	});
 	rapidjson::Document podData(&alloc);
 	std::vector<std::future<std::pair<std::size_t,std::string>>> eventData;
 	try{
-		podData.Parse(result.output.c_str());
+		podFields.parseInsitu(result.output,podData);
 	}
 	catch(std::runtime_error& err){
 		std::ostringstream errMsg;
 		errMsg << "Unable to parse kubectl output for " << instance << " pods";
 		log_error(errMsg.str());
 		setSpanError(span, errMsg.str());
-		span->End();
 		throw std::runtime_error("Could not find pods for instance");
 	}
 	std::size_t podIndex=0;
@@ -512,11 +541,18 @@ rapidjson::Value fetchInstanceDetails(PersistentStore &store,
 		
 		podDetails.PushBack(podInfo,alloc);
 	}
+	static const JSONExtractor eventFields({
+		"/items/*/count",
+		"/items/*/firstTimestamp",
+		"/items/*/lastTimestamp",
+		"/items/*/reason",
+		"/items/*/message",
+	});
 	for(auto& f : eventData){
 		auto p=f.get();
 		rapidjson::Document data(rapidjson::kObjectType,&alloc);
 		try{
-			data.Parse(p.second.c_str());
+			eventFields.parseInsitu(p.second,data);
 		}catch(std::runtime_error& err){
 			log_warn("Unable to parse event data as JSON");
 			continue;
@@ -547,18 +583,11 @@ rapidjson::Value fetchInstanceDetails(PersistentStore &store,
 		
 	}
 	instanceDetails.AddMember("pods",podDetails,alloc);
-	span->End();
 	return instanceDetails;
 }
 
 crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::request& req, const std::string& instanceID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -566,7 +595,6 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -575,7 +603,6 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -584,20 +611,21 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
 	
+	const FieldSelection fields(req);
+	
 	//fetch the full configuration for the instance
-	instance.config=store.getApplicationInstanceConfig(instanceID);
+	if(fields.includes("/metadata/configuration"))
+		instance.config=store.getApplicationInstanceConfig(instanceID);
 	
 	//get information on the owning Group, needed to look up services, etc.
 	const Group group=store.getGroup(instance.owningGroup);
 	if(!group) {
 		const std::string& errMsg = "Invalid Group";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -607,7 +635,6 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	if(!cluster) {
 		const std::string& errMsg = "Invalid Cluster";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError("Invalid Cluster"));
 	}
@@ -628,15 +655,17 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 		application = application.substr(application.find('/') + 1);
 	}
 	instanceData.AddMember("application", application, alloc);
-	// get helm release info
-	std::vector<std::string> listArgs={"list",
-		"-f","^" + instance.name + "$",
-		"-n",group.namespaceName(),
-		"--output","json",
-	};
-	auto commandResult=runCommand("helm",listArgs,{{"KUBECONFIG",*clusterConfig}});
+	// get helm release info, only if the versions it provides are wanted
 	rapidjson::Document releaseInfo;
-	releaseInfo.Parse(commandResult.output.c_str());
+	if(fields.includes("/metadata/appVersion") || fields.includes("/metadata/chartVersion")){
+		std::vector<std::string> listArgs={"list",
+			"-f","^" + instance.name + "$",
+			"-n",group.namespaceName(),
+			"--output","json",
+		};
+		auto commandResult=runCommand("helm",listArgs,{{"KUBECONFIG",*clusterConfig}});
+		releaseInfo.Parse(commandResult.output.c_str());
+	}
 	//There should be at most one matching result
 	if (releaseInfo.IsArray() && releaseInfo.Size() != 0 && releaseInfo[0].HasMember("app_version")) {
 		instanceData.AddMember("appVersion", rapidjson::StringRef(releaseInfo[0]["app_version"].GetString()),
@@ -644,8 +673,8 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	} else {
 		instanceData.AddMember("appVersion", "Unknown", alloc);
 	}
-	instanceData.AddMember("group", store.getGroup(instance.owningGroup).name, alloc);
-	instanceData.AddMember("cluster", store.getCluster(instance.cluster).name, alloc);
+	instanceData.AddMember("group", group.name, alloc);
+	instanceData.AddMember("cluster", cluster.name, alloc);
 	instanceData.AddMember("created", rapidjson::StringRef(instance.ctime.c_str()), alloc);
 	instanceData.AddMember("configuration", rapidjson::StringRef(instance.config.c_str()), alloc);
 	if (releaseInfo.IsArray() && releaseInfo.Size() != 0 && releaseInfo[0].HasMember("chart")) {
@@ -656,9 +685,10 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	}
 	result.AddMember("metadata", instanceData, alloc);
 	
-	auto configPath=store.configPathForCluster(instance.cluster);
-	auto systemNamespace=store.getCluster(instance.cluster).systemNamespace;
-	auto services=getServices(configPath,instance.name,group.namespaceName(),systemNamespace);
+	auto systemNamespace=cluster.systemNamespace;
+	std::multimap<std::string,ServiceInterface> services;
+	if(fields.includes("/services"))
+		services=getServices(clusterConfig,instance.name,group.namespaceName(),systemNamespace);
 	rapidjson::Value serviceData(rapidjson::kArrayType);
 	for(const auto& service : services){
 		rapidjson::Value serviceEntry(rapidjson::kObjectType);
@@ -673,7 +703,7 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 	}
 	result.AddMember("services", serviceData, alloc);
 	
-	if(req.url_params.get("detailed")){
+	if(req.url_params.get("detailed") && fields.includes("/details")){
 		try{
 			result.AddMember("details",fetchInstanceDetails(store,instance,systemNamespace,alloc),alloc);
 		}catch(std::runtime_error& err){
@@ -683,19 +713,13 @@ crow::response fetchApplicationInstanceInfo(PersistentStore& store, const crow::
 			result.AddMember("details",error,alloc);
 		}
 	}
+	fields.apply(result);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response deleteApplicationInstance(PersistentStore& store, const crow::request& req, const std::string& instanceID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -704,7 +728,6 @@ crow::response deleteApplicationInstance(PersistentStore& store, const crow::req
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -713,7 +736,6 @@ crow::response deleteApplicationInstance(PersistentStore& store, const crow::req
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -721,7 +743,6 @@ crow::response deleteApplicationInstance(PersistentStore& store, const crow::req
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -730,23 +751,16 @@ crow::response deleteApplicationInstance(PersistentStore& store, const crow::req
 	auto err=internal::deleteApplicationInstance(store,instance,force);
 	if(!err.empty()) {
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error(err);
 		return crow::response(500, generateError(err));
 	}
 
-	span->End();
 	return crow::response(200);
 }
 
 namespace internal {
 	std::string deleteApplicationInstance(PersistentStore& store, const ApplicationInstance& instance, bool force){
-		auto tracer = getTracer();
-		std::map<std::string, std::string> attributes;
-		setInternalSpanAttributes(attributes);
-		auto options = getInternalSpanOptions();
-		auto span = tracer->StartSpan("deleteApplicationInstance", attributes, options);
-		auto scope = tracer->WithActiveSpan(span);
+		SpanGuard span("deleteApplicationInstance");
 
 		log_info("Deleting " << instance);
 		try{
@@ -771,7 +785,6 @@ namespace internal {
 				log_error(message);
 				setSpanError(span, message);
 				if(!force) {
-					span->End();
 					return message;
 				} else {
 					log_info("Forcing deletion of " << instance << " in spite of helm error");
@@ -791,22 +804,14 @@ namespace internal {
 			err << "Failed to delete " << instance << " from persistent store";
 			log_error(err.str());
 			setSpanError(span, err.str());
-			span->End();
 			return "Failed to delete instance from database";
 		}
-		span->End();
 		return "";
 	}
 }
 
 crow::response updateApplicationInstance(PersistentStore& store, const crow::request& req, const std::string& instanceID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -814,7 +819,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -823,7 +827,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -832,7 +835,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -841,7 +843,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if(!group) {
 		const std::string& errMsg = "Invalid Group";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -849,7 +850,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if(!cluster) {
 		const std::string& errMsg = "Invalid Cluster";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -861,14 +861,12 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -876,7 +874,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if (!body.HasMember("configuration")) {
 	    const std::string& errMsg = "Configuration for update missing";
 	    setWebSpanError(span, errMsg, 400);
-	    span->End();
 	    log_error(errMsg);
 	    return crow::response(400, generateError(errMsg));
 	}
@@ -884,7 +881,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	if(!body["configuration"].IsString()) {
 		const std::string& errMsg = "Incorrect type for configuration";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -902,7 +898,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 		errMsg << "Command failed: helm search " << (instance.application) << ": [exit] " << helmSearchResult.status
 		       << " [err] " << helmSearchResult.error << " [out] " << helmSearchResult.output;
 		setWebSpanError(span, errMsg.str(), 400);
-		span->End();
 		log_error(errMsg.str());
 		return crow::response(500, generateError("Unable to fetch application version"));
 	}
@@ -935,7 +930,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 		   && helmResult.error.find(notFoundMsg)==std::string::npos){
 			std::string message="helm delete failed: " + helmResult.error;
 			setWebSpanError(span, message, 500);
-			span->End();
 			log_error(message);
 			return crow::response(500,generateError(message));
 		}
@@ -943,7 +937,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	catch(std::runtime_error& e){
 		std::string message = std::string("Failed to delete instance using helm: ") + e.what();
 		setWebSpanError(span, message, 500);
-		span->End();
 		log_error(message);
 		return crow::response(500,generateError(message));
 	}
@@ -1000,18 +993,15 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	
 	log_info("Starting new " << instance);
 	//write configuration to a file for helm's benefit
-	FileHandle instanceConfig=makeTemporaryFile(instance.id);
-	{
-		std::ofstream outfile(instanceConfig.path());
-		outfile << instance.config;
-		if(!outfile){
-			std::ostringstream errMsg;
-			errMsg << "Failed to write instance configuration to " << instanceConfig.path();
-			log_error(errMsg.str());
-			setWebSpanError(span, errMsg.str(), 500);
-			span->End();
-			return crow::response(500,generateError("Failed to write instance configuration to disk"));
-		}
+	FileHandle instanceConfig;
+	try{
+		instanceConfig=makeMemoryFile(instance.id,instance.config);
+	}catch(std::runtime_error& err){
+		std::ostringstream errMsg;
+		errMsg << "Failed to write instance configuration: " << err.what();
+		log_error(errMsg.str());
+		setWebSpanError(span, errMsg.str(), 500);
+		return crow::response(500,generateError("Failed to write instance configuration"));
 	}
 	std::string additionalValues=internal::assembleExtraHelmValues(store,cluster,instance,group);
 	
@@ -1022,7 +1012,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 		store.removeApplicationInstance(instance.id);
 		log_error(err.what());
 		setWebSpanError(span, err.what(), 500);
-		span->End();
 		return crow::response(500,generateError(err.what()));
 	}
 
@@ -1043,13 +1032,9 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 
 	commandResult commandResult;
 	{
-		setInternalSpanAttributes(attributes);
-		options = getInternalSpanOptions();
-		auto helmSpan = tracer->StartSpan("helm install", attributes, options);
+		SpanGuard helmSpan("helm install");
 		populateSpan(helmSpan, req);
-		auto helmScope = tracer->WithActiveSpan(helmSpan);
 		commandResult = runCommand("helm", installArgs, {{"KUBECONFIG", *clusterConfig}});
-		helmSpan->End();
 	}
 	if(commandResult.status || 
 	   (commandResult.output.find("STATUS: DEPLOYED")==std::string::npos &&
@@ -1069,7 +1054,6 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 			errMsg += "\n" + resultMessage;
 		}
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500,generateError(errMsg));
 	}
 
@@ -1105,18 +1089,11 @@ crow::response updateApplicationInstance(PersistentStore& store, const crow::req
 	//TODO: not including this data is non-compliant with the spec, but it is never used
 	//result.AddMember("status", "DEPLOYED", alloc);
 	result.AddMember("message", resultMessage, alloc);
-	span->End();
 	return crow::response(to_string(result));	
 }
 
 crow::response restartApplicationInstance(PersistentStore& store, const crow::request& req, const std::string& instanceID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1124,7 +1101,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1133,7 +1109,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1141,7 +1116,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1150,7 +1124,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	if(!group) {
 		const std::string& errMsg = "Invalid Group";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -1158,7 +1131,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	if(!cluster) {
 		const std::string& errMsg = "Invalid Cluster";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -1194,7 +1166,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 			const std::string& message = "helm delete failed: " + helmResult.error;
 			log_error(message);
 			setWebSpanError(span, message, 500);
-			span->End();
 			return crow::response(500,generateError(message));
 		}
 	}
@@ -1202,7 +1173,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 		const std::string& message = std::string("Failed to delete instance using helm: ")+e.what();
 		log_error(message);
 		setWebSpanError(span, message, 500);
-		span->End();
 		return crow::response(500,generateError(message));
 	}
 	
@@ -1260,18 +1230,15 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	
 	log_info("Starting new " << instance);
 	//write configuration to a file for helm's benefit
-	FileHandle instanceConfig=makeTemporaryFile(instance.id);
-	{
-		std::ofstream outfile(instanceConfig.path());
-		outfile << instance.config;
-		if(!outfile){
-			std::ostringstream errMsg;
-			errMsg << "Failed to write instance configuration to " << instanceConfig.path();
-			log_error(errMsg.str());
-			setWebSpanError(span, errMsg.str(), 500);
-			span->End();
-			return crow::response(500,generateError("Failed to write instance configuration to disk"));
-		}
+	FileHandle instanceConfig;
+	try{
+		instanceConfig=makeMemoryFile(instance.id,instance.config);
+	}catch(std::runtime_error& err){
+		std::ostringstream errMsg;
+		errMsg << "Failed to write instance configuration: " << err.what();
+		log_error(errMsg.str());
+		setWebSpanError(span, errMsg.str(), 500);
+		return crow::response(500,generateError("Failed to write instance configuration"));
 	}
 	std::string additionalValues=internal::assembleExtraHelmValues(store,cluster,instance,group);
 	
@@ -1281,7 +1248,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	catch(std::runtime_error& err){
 		store.removeApplicationInstance(instance.id);
 		setWebSpanError(span, err.what(), 500);
-		span->End();
 		return crow::response(500,generateError(err.what()));
 	}
 
@@ -1316,7 +1282,6 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 			errMsg += "\n" + resultMessage;
 		}
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500,generateError(errMsg));
 	}
 	log_info("Restarted " << instance << " on " << cluster << " on behalf of " << user);
@@ -1347,18 +1312,11 @@ crow::response restartApplicationInstance(PersistentStore& store, const crow::re
 	//TODO: not including this data is non-compliant with the spec, but it is never used
 	//result.AddMember("status", "DEPLOYED", alloc);
 	result.AddMember("message", resultMessage, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response getApplicationInstanceScale(PersistentStore& store, const crow::request& req, const std::string& instanceID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user=authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1366,7 +1324,6 @@ crow::response getApplicationInstanceScale(PersistentStore& store, const crow::r
 	if (!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1375,7 +1332,6 @@ crow::response getApplicationInstanceScale(PersistentStore& store, const crow::r
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -1384,7 +1340,6 @@ crow::response getApplicationInstanceScale(PersistentStore& store, const crow::r
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1454,23 +1409,15 @@ crow::response getApplicationInstanceScale(PersistentStore& store, const crow::r
 	if(!depName.empty() && !deploymentFound) {
 		const std::string& errMsg = "Deployment " + depName + " not found in " + instanceID;
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	result.AddMember("deployments", deploymentScales, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response scaleApplicationInstance(PersistentStore& store, const crow::request& req, const std::string& instanceID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1479,7 +1426,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 	if (!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1488,7 +1434,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1497,7 +1442,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1514,7 +1458,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 		catch(std::runtime_error& err){
 			const std::string& errMsg = "Invalid number of replicas";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			log_error(errMsg);
 			return crow::response(400, generateError(errMsg));
 		}
@@ -1522,7 +1465,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 	else{
 		const std::string& errMsg = "Missing number of replicas";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -1558,7 +1500,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 		const std::string& errMsg =
 				instanceID + " does not expose exactly one deployment, and no deployment was specified to be scaled.";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -1605,7 +1546,6 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 	if(!deploymentFound) {
 		const std::string& errMsg = "Deployment " + depName + " not found in " + instanceID;
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1617,24 +1557,16 @@ crow::response scaleApplicationInstance(PersistentStore& store, const crow::requ
 		  << name << " --namespace " << nspace << "failed :" << scaleResult.error);
 		const std::string& errMsg = "Scaling deployment "+depName+" to "+std::to_string(replicas)+" replicas failed: "+scaleResult.error;
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response getApplicationInstanceLogs(PersistentStore &store,
 					  const crow::request &req,
 					  const std::string &instanceID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1643,7 +1575,6 @@ crow::response getApplicationInstanceLogs(PersistentStore &store,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1652,7 +1583,6 @@ crow::response getApplicationInstanceLogs(PersistentStore &store,
 	if(!instance) {
 		const std::string& errMsg = "Application instance not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1661,7 +1591,6 @@ crow::response getApplicationInstanceLogs(PersistentStore &store,
 	if(!user.admin && !store.userInGroup(user.id,instance.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 
@@ -1702,24 +1631,26 @@ crow::response getApplicationInstanceLogs(PersistentStore &store,
 		std::ostringstream errMsg;
 		errMsg << "Failed to look up pods for " << instance << ": " << podsResult.error;
 		setWebSpanError(span, errMsg.str(), 500);
-		span->End();
 		log_error(errMsg.str());
 		return crow::response(500, generateError("Failed to look up pods"));
 	}
+	static const JSONExtractor containerFields({
+		"/items/*/metadata/name",
+		"/items/*/spec/containers/*/name",
+	});
 	rapidjson::Document podData;
 	try{
-		podData.Parse(podsResult.output.c_str());
+		containerFields.parseInsitu(podsResult.output,podData);
 	}
 	catch(std::runtime_error& err){
 		std::ostringstream errMsg;
 		errMsg << "Unable to parse kubectl output for " << instance << " pods";
 		setWebSpanError(span, errMsg.str(), 500);
-		span->End();
 		log_error(errMsg.str());
 		throw std::runtime_error("Could not find pods for instance");
 	}
 	for(const auto& pod : podData["items"].GetArray()){
-		if (!pod["spec"].HasMember("containers")) {
+		if (!pod.HasMember("spec") || !pod["spec"].HasMember("containers")) {
 			continue;
 		}
 		std::string podName=pod["metadata"]["name"].GetString();
@@ -1735,7 +1666,6 @@ crow::response getApplicationInstanceLogs(PersistentStore &store,
 	if(allContainers.empty() && !selectedContainer.empty()) {
 		const std::string& errMsg = "No containers found matching the name '" + selectedContainer + "'";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -1790,6 +1720,5 @@ crow::response getApplicationInstanceLogs(PersistentStore &store,
 	result.AddMember("metadata", instanceData, alloc);
 	result.AddMember("logs", rapidjson::StringRef(logData.c_str()), alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
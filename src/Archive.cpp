@@ -364,6 +364,20 @@ void gzipCompress(std::istream& src, std::ostream& dest){
 	dest.write((const char*)&totalSize,sizeof(totalSize));
 }
 
+std::string gzipDecompress(const std::string& data){
+	std::istringstream src(data);
+	std::ostringstream dest;
+	gzipDecompress(src,dest);
+	return dest.str();
+}
+
+std::string gzipCompress(const std::string& data){
+	std::istringstream src(data);
+	std::ostringstream dest;
+	gzipCompress(src,dest);
+	return dest.str();
+}
+
 struct header_posix_ustar {
 	enum typeCode{
 		RegularFile = 0,
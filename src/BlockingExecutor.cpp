@@ -0,0 +1,168 @@
+#include "BlockingExecutor.h"
+
+#include <memory>
+
+#include "Logging.h"
+#include "ServerUtilities.h"
+
+BlockingExecutor::BlockingExecutor(unsigned int threads, std::size_t maxQueued, unsigned int perKeyLimit,
+                                   unsigned int unkeyedLimit):
+maxQueued(maxQueued),
+perKeyLimit(perKeyLimit ? perKeyLimit : 1),
+unkeyedLimit(unkeyedLimit ? unkeyedLimit : 1),
+queued(0),
+running(0),
+completed(0),
+rejected(0),
+totalWait(clock::duration::zero()),
+maxWait(clock::duration::zero()),
+stopping(false)
+{
+	if(!threads)
+		threads=1;
+	workers.reserve(threads);
+	for(unsigned int i=0; i<threads; i++)
+		workers.emplace_back(&BlockingExecutor::work,this);
+}
+
+BlockingExecutor::~BlockingExecutor(){
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		stopping=true;
+	}
+	available.notify_all();
+	for(auto& worker : workers)
+		worker.join();
+}
+
+bool BlockingExecutor::submit(const std::string& key, std::function<void()> task){
+	std::lock_guard<std::mutex> lock(mut);
+	if(queued>=maxQueued){
+		rejected++;
+		return false;
+	}
+	KeyQueue& queue=queues[key];
+	queue.tasks.push_back(Task{std::move(task),clock::now()});
+	queued++;
+	updateReady(key,queue);
+	return true;
+}
+
+void BlockingExecutor::dispatch(const std::string& key, const crow::request& req, crow::response& res,
+                                std::function<crow::response()> handler){
+	if(!req.io_service){
+		res=handler();
+		res.end();
+		return;
+	}
+	boost::asio::io_service* io=req.io_service;
+	bool accepted=submit(key,[io,&res,handler]{
+		auto result=std::make_shared<crow::response>();
+		try{
+			*result=handler();
+		}catch(std::exception& ex){
+			log_error("Request handler failed: " << ex.what());
+			*result=crow::response(500,generateError(ex.what()));
+		}catch(...){
+			log_error("Request handler failed");
+			*result=crow::response(500,generateError("Exception"));
+		}
+		//The connection may only be used from the thread which runs its
+		//io_service
+		io->post([&res,result]{
+			res=std::move(*result);
+			res.end();
+		});
+	});
+	if(!accepted){
+		log_warn("Rejecting request for " << req.url << " because too many requests are waiting");
+		res=crow::response(503,generateError("The server is busy; please try again later"));
+		res.set_header("Retry-After","1");
+		res.end();
+	}
+}
+
+std::size_t BlockingExecutor::getQueueDepth() const{
+	std::lock_guard<std::mutex> lock(mut);
+	return queued;
+}
+
+std::size_t BlockingExecutor::getRunning() const{
+	std::lock_guard<std::mutex> lock(mut);
+	return running;
+}
+
+std::size_t BlockingExecutor::getRejected() const{
+	std::lock_guard<std::mutex> lock(mut);
+	return rejected;
+}
+
+std::string BlockingExecutor::getStatistics() const{
+	using std::chrono::duration_cast;
+	using std::chrono::milliseconds;
+	std::lock_guard<std::mutex> lock(mut);
+	std::ostringstream os;
+	os << "Blocking tasks waiting: " << queued << "\n";
+	os << "Blocking tasks running: " << running << "\n";
+	os << "Blocking tasks completed: " << completed << "\n";
+	os << "Blocking tasks rejected: " << rejected << "\n";
+	std::size_t started=completed+running;
+	os << "Blocking task mean wait (ms): "
+	   << (started ? duration_cast<milliseconds>(totalWait).count()/started : 0) << "\n";
+	os << "Blocking task max wait (ms): " << duration_cast<milliseconds>(maxWait).count() << "\n";
+	return os.str();
+}
+
+void BlockingExecutor::updateReady(const std::string& key, KeyQueue& queue){
+	if(queue.ready || queue.tasks.empty())
+		return;
+	if(queue.running>=(key.empty() ? unkeyedLimit : perKeyLimit))
+		return;
+	ready.push_back(key);
+	queue.ready=true;
+	available.notify_one();
+}
+
+void BlockingExecutor::work(){
+	std::unique_lock<std::mutex> lock(mut);
+	while(true){
+		available.wait(lock,[this]{ return stopping || !ready.empty(); });
+		if(ready.empty()) //stopping, and no work remains
+			return;
+		const std::string key=std::move(ready.front());
+		ready.pop_front();
+		KeyQueue& queue=queues[key];
+		queue.ready=false;
+		Task task=std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		queued--;
+		queue.running++;
+		running++;
+		//put the key back at the end of the list, so that other keys get a
+		//turn before it runs another task
+		updateReady(key,queue);
+		clock::duration wait=clock::now()-task.queued;
+		totalWait+=wait;
+		if(wait>maxWait)
+			maxWait=wait;
+
+		lock.unlock();
+		try{
+			task.work();
+		}catch(std::exception& ex){
+			log_error("Blocking task failed: " << ex.what());
+		}catch(...){
+			log_error("Blocking task failed");
+		}
+		lock.lock();
+
+		//the queue cannot have been removed while this task was running
+		queue.running--;
+		running--;
+		completed++;
+		if(queue.tasks.empty() && !queue.running)
+			queues.erase(key);
+		else
+			updateReady(key,queue);
+	}
+}
@@ -0,0 +1,162 @@
+#include "ChangeFeedCommands.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "Logging.h"
+#include "ServerUtilities.h"
+#include "Telemetry.h"
+
+namespace{
+	///The longest time for which a request may wait for new changes, since 
+	///each waiting request occupies a server thread
+	const unsigned int maxChangeWaitSeconds=60;
+	///How long a client turned away because too many requests are already 
+	///waiting should wait before asking again
+	const unsigned int waiterRetrySeconds=5;
+	
+	///The number of requests currently waiting for changes
+	std::atomic<unsigned int> changeWaiters(0);
+	
+	///Counts a request as waiting for as long as it exists
+	struct WaiterGuard{
+		WaiterGuard(){ changeWaiters++; }
+		~WaiterGuard(){ changeWaiters--; }
+	};
+}
+
+namespace{
+	///\param inGroup a function which determines whether the user is a member 
+	///               of a group, given its ID
+	template<typename InGroup>
+	bool mayObserve(const User& user, const ChangeEvent& event, InGroup inGroup){
+		if(user.admin)
+			return true;
+		switch(event.collection){
+			case StoreCollection::Users:
+			case StoreCollection::Secrets:
+			case StoreCollection::MonitoringCredentials:
+				return false;
+			case StoreCollection::Instances:
+			case StoreCollection::Volumes:
+				//only members of the owning group may examine these
+				for(const auto& scope : event.scopes){
+					if(scope.find(IDGenerator::groupIDPrefix)==0 && inGroup(scope))
+						return true;
+				}
+				return false;
+			default:
+				return true;
+		}
+	}
+}
+
+bool mayObserveChange(PersistentStore& store, const User& user, const ChangeEvent& event){
+	return mayObserve(user,event,[&](const std::string& groupID){
+		return store.userInGroup(user.id,groupID);
+	});
+}
+
+bool mayObserveChange(const User& user, const std::set<std::string>& groupIDs, 
+                      const ChangeEvent& event){
+	return mayObserve(user,event,[&](const std::string& groupID){
+		return groupIDs.count(groupID)>0;
+	});
+}
+
+crow::response listChanges(PersistentStore& store, const crow::request& req, 
+                           unsigned int maxWaiters){
+	SpanGuard span(req);
+	//authenticate
+	const User user = authenticateUser(store, req.url_params.get("token"));
+	span->SetAttribute("user", user.name);
+	log_info(user << " requested to list changes from " << req.remote_endpoint);
+	if(!user) {
+		const std::string& errMsg = "User not authorized";
+		setWebSpanError(span, errMsg, 403);
+		log_error(errMsg);
+		return crow::response(403, generateError(errMsg));
+	}
+	//All users may follow changes, but non-administrators only see the kinds 
+	//of records which they could list
+	
+	uint64_t since=0;
+	unsigned int waitSeconds=0;
+	try{
+		if(auto raw = req.url_params.get("since"))
+			since=std::stoull(raw);
+		if(auto raw = req.url_params.get("wait"))
+			waitSeconds=std::min((unsigned long)maxChangeWaitSeconds,std::stoul(raw));
+	}catch(std::exception& ex){
+		const std::string& errMsg = "Invalid revision or wait time";
+		setWebSpanError(span, errMsg, 400);
+		log_error(errMsg);
+		return crow::response(400, generateError(errMsg));
+	}
+	
+	const ChangeLog& changeLog=store.getChangeLog();
+	const std::string& epoch=store.getGenerationEpoch();
+	//Revisions from a previous run of the server are meaningless
+	auto clientEpoch = req.url_params.get("epoch");
+	bool sameEpoch = (!clientEpoch || epoch==clientEpoch);
+	
+	bool complete=false;
+	std::vector<ChangeEvent> changes;
+	uint64_t revision=changeLog.currentRevision();
+	if(sameEpoch){
+		if(waitSeconds && since==revision){
+			WaiterGuard waiter;
+			if(changeWaiters>maxWaiters){
+				//each waiting request holds a server thread, so waiting must 
+				//not be allowed to take all of them
+				const std::string& errMsg = "Too many requests are waiting for changes";
+				setWebSpanError(span, errMsg, 429);
+				log_warn(errMsg);
+				crow::response res(429, generateError(errMsg));
+				res.add_header("Retry-After", std::to_string(waiterRetrySeconds));
+				return res;
+			}
+			changeLog.waitForChanges(since,std::chrono::seconds(waitSeconds));
+		}
+		changes=changeLog.changesSince(since,complete);
+		if(complete)
+			revision=(changes.empty() ? since : changes.back().revision);
+		else
+			revision=changeLog.currentRevision();
+	}
+	if(!complete){
+		//the client must resynchronize from full listings, and can then 
+		//follow changes from the current revision
+		changes.clear();
+		log_info("Changes since revision " << since << " are not available; client must resynchronize");
+	}
+	
+	rapidjson::Document result(rapidjson::kObjectType);
+	rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
+	
+	result.AddMember("apiVersion", "v1alpha3", alloc);
+	result.AddMember("kind", "ChangeList", alloc);
+	rapidjson::Value metadata(rapidjson::kObjectType);
+	metadata.AddMember("epoch", epoch, alloc);
+	metadata.AddMember("revision", revision, alloc);
+	metadata.AddMember("complete", complete, alloc);
+	result.AddMember("metadata", metadata, alloc);
+	rapidjson::Value resultItems(rapidjson::kArrayType);
+	resultItems.Reserve(changes.size(), alloc);
+	for(const ChangeEvent& change : changes){
+		if(!mayObserveChange(store, user, change))
+			continue;
+		rapidjson::Value changeData(rapidjson::kObjectType);
+		changeData.AddMember("revision", change.revision, alloc);
+		changeData.AddMember("kind", to_string(change.collection), alloc);
+		changeData.AddMember("id", change.id, alloc);
+		changeData.AddMember("operation", to_string(change.operation), alloc);
+		resultItems.PushBack(changeData, alloc);
+	}
+	result.AddMember("items", resultItems, alloc);
+	
+	return crow::response(to_string(result));
+}
@@ -1,5 +1,4 @@
 #include "ClusterCommands.h"
-#include "server_version.h"
 
 #include <algorithm>
 #include <iterator>
@@ -8,13 +7,13 @@
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
 
-#include "opentelemetry/trace/provider.h"
 
 #include <yaml-cpp/yaml.h>
 #include <yaml-cpp/exceptions.h>
 #include <yaml-cpp/node/node.h>
 #include <yaml-cpp/node/parse.h>
 
+#include "JSONExtractor.h"
 #include "KubeInterface.h"
 #include "Telemetry.h"
 #include "Logging.h"
@@ -51,13 +50,7 @@ crow::response listClusters(PersistentStore& store, const crow::request& req){
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	std::vector<Cluster> clusters;
 
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -65,7 +58,6 @@ crow::response listClusters(PersistentStore& store, const crow::request& req){
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -75,6 +67,7 @@ crow::response listClusters(PersistentStore& store, const crow::request& req){
 		clusters=store.listClustersByGroup(group);
 	else
 		clusters=store.listClusters();
+	const FieldSelection fields(req);
 
 	rapidjson::Document result(rapidjson::kObjectType);
 	rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
@@ -89,43 +82,67 @@ crow::response listClusters(PersistentStore& store, const crow::request& req){
 		rapidjson::Value clusterData(rapidjson::kObjectType);
 		clusterData.AddMember("id", cluster.id, alloc);
 		clusterData.AddMember("name", cluster.name, alloc);
-		clusterData.AddMember("owningGroup", store.findGroupByID(cluster.owningGroup).name, alloc);
+		if(fields.includes("/metadata/owningGroup"))
+			clusterData.AddMember("owningGroup", store.findGroupByID(cluster.owningGroup).name, alloc);
 		clusterData.AddMember("owningOrganization", cluster.owningOrganization, alloc);
-		std::vector<GeoLocation> locations = store.getLocationsForCluster(cluster.id);
-		rapidjson::Value clusterLocation(rapidjson::kArrayType);
-		clusterLocation.Reserve(locations.size(), alloc);
-		for(const auto& location : locations){
-			rapidjson::Value entry(rapidjson::kObjectType);
-			entry.AddMember("lat",location.lat, alloc);
-			entry.AddMember("lon",location.lon, alloc);
-			if(!location.description.empty())
-				entry.AddMember("desc",location.description, alloc);
-			clusterLocation.PushBack(entry, alloc);
+		if(fields.includes("/metadata/location")){
+			std::vector<GeoLocation> locations = store.getLocationsForCluster(cluster.id);
+			rapidjson::Value clusterLocation(rapidjson::kArrayType);
+			clusterLocation.Reserve(locations.size(), alloc);
+			for(const auto& location : locations){
+				rapidjson::Value entry(rapidjson::kObjectType);
+				entry.AddMember("lat",location.lat, alloc);
+				entry.AddMember("lon",location.lon, alloc);
+				if(!location.description.empty())
+					entry.AddMember("desc",location.description, alloc);
+				clusterLocation.PushBack(entry, alloc);
+			}
+			clusterData.AddMember("location", clusterLocation, alloc);
 		}
-		clusterData.AddMember("location", clusterLocation, alloc);
 		clusterData.AddMember("hasMonitoring", (bool)cluster.monitoringCredential, alloc);
 		clusterResult.AddMember("metadata", clusterData, alloc);
+		fields.apply(clusterResult);
 		resultItems.PushBack(clusterResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
 
 	high_resolution_clock::time_point t2 = high_resolution_clock::now();
 	log_info("cluster listing completed in " << duration_cast<duration<double>>(t2-t1).count() << " seconds");
-	span->End();
 	return crow::response(to_string(result));
 }
 
+std::string listClustersETag(PersistentStore& store, const crow::request& req){
+	//cluster listings include the names of the owning groups
+	return makeETag(store.getETagEpoch(), req.raw_url,
+	                {store.getGeneration(StoreCollection::Clusters),
+	                 store.getGeneration(StoreCollection::Groups)});
+}
+
 namespace internal {
 
+	std::string describeDNSRecordChange(const std::shared_future<bool>& recordMade, const std::string& name,
+	                                    std::chrono::milliseconds wait) {
+		if (recordMade.wait_for(wait) != std::future_status::ready) {
+			return "The DNS record for the " + name + " domain has been requested but is not yet in place.\n"
+			       "Once it is, services using Ingress on this cluster can be assigned subdomains within it.\n";
+		}
+		bool made = false;
+		try {
+			made = recordMade.get();
+		}
+		catch (std::exception &err) {
+			log_error("DNS record change for " << name << " failed: " << err.what());
+		}
+		if (made)
+			return "Services using Ingress on this cluster can be assigned subdomains within the " + name + " domain.\n";
+		return "[Warning] The DNS record for the " + name + " domain could not be made, so services using Ingress\n"
+		       "on this cluster cannot be assigned subdomains within it.\n";
+	}
+
 	///Locate a cluster's ingress controller and set a DNS record to point to it.
 	///\return any informative message for the user
 	std::string setClusterDNSRecord(PersistentStore& store, const Cluster& cluster) {
-		auto tracer = getTracer();
-		std::map<std::string, std::string> attributes;
-		setInternalSpanAttributes(attributes);
-		auto options = getInternalSpanOptions();
-		auto span = tracer->StartSpan("setClusterDNSRecord", attributes, options);
-		auto scope = tracer->WithActiveSpan(span);
+		SpanGuard span("setClusterDNSRecord");
 
 		std::string resultMessage;
 		auto configPath = store.configPathForCluster(cluster.id);
@@ -155,9 +172,12 @@ namespace internal {
 			auto wildcard = "*." + name;
 			log_info("Cluster wildcard DNS: " << wildcard);
 			if (store.canUpdateDNS()) {
-				bool success = false;
 				try {
-					success = store.setDNSRecord(wildcard, icAddress.output);
+					//The record is made in the background, together with 
+					//others requested at about the same time, so only wait 
+					//briefly for it before telling the user how it stands
+					auto recordMade = store.setDNSRecord(wildcard, icAddress.output);
+					resultMessage += internal::describeDNSRecordChange(recordMade, name, std::chrono::seconds(5));
 				}
 				catch (std::runtime_error &err) {
 					std::ostringstream errMsg;
@@ -165,34 +185,18 @@ namespace internal {
 					log_error(errMsg.str());
 					setSpanError(span, errMsg.str());
 				}
-				if (!success) {
-					std::ostringstream errMsg;
-					errMsg << "Failed to create DNS record mapping " << wildcard << " to " << icAddress.output;
-					log_error(errMsg.str());
-					setSpanError(span, errMsg.str());
-				} else {
-					resultMessage +=
-							"Services using Ingress on this cluster can be assigned subdomains within the " + name +
-							" domain.\n";
-				}
 			} else {
 				log_warn("Not able to make DNS records, no wildcard record will be available for " << cluster);
 				resultMessage += "[Warning] The SLATE API server is not able to make DNS records, so no DNS name will be available for this cluster.\n";
 			}
 		}
-		span->End();
 		return resultMessage;
 	}
 
 	///\return An informational message for the user
 	///\throw std::runtime_error
 	std::string ensureClusterSetup(PersistentStore& store, const Cluster& cluster, bool autodelete=true) {
-		auto tracer = getTracer();
-		std::map<std::string, std::string> attributes;
-		setInternalSpanAttributes(attributes);
-		auto options = getInternalSpanOptions();
-		auto span = tracer->StartSpan("ensureClusterSetup", attributes, options);
-		auto scope = tracer->WithActiveSpan(span);
+		SpanGuard span("ensureClusterSetup");
 
 		auto configPath = store.configPathForCluster(cluster.id);
 		log_info("Attempting to access " << cluster);
@@ -227,7 +231,6 @@ namespace internal {
 				//things aren't working, delete our apparently non-functional record
 				store.removeCluster(cluster.id);
 				setSpanError(span, errMsg.str());
-				span->End();
 				throw std::runtime_error("Cluster registration failed: "
 				                         "Found no ServiceAccounts in the default namespace");
 			}
@@ -236,7 +239,6 @@ namespace internal {
 				const std::string &errMsg = std::string("Cluster registration failed: ") +
 				                            "Unable to find matching service account in default namespace";
 				setSpanError(span, errMsg);
-				span->End();
 				throw std::runtime_error(errMsg);
 			}
 			//now double-check that the namespace name really does match the serviceaccount name
@@ -248,7 +250,6 @@ namespace internal {
 				setSpanError(span, errMsg.str());
 				log_error(errMsg.str());
 				store.removeCluster(cluster.id);
-				span->End();
 				throw std::runtime_error("Cluster registration failed: "
 				                         "Checking default namespace name failed");
 			}
@@ -275,7 +276,6 @@ namespace internal {
 				log_error(error);
 				store.removeCluster(cluster.id);
 				setSpanError(span, error);
-				span->End();
 				throw std::runtime_error("Cluster registration failed: " + error);
 			}
 		}
@@ -306,7 +306,6 @@ namespace internal {
 				log_error(errMsg.str());
 				//things aren't working, delete our apparently non-functional record
 				store.removeCluster(cluster.id);
-				span->End();
 				throw std::runtime_error("Cluster registration failed: "
 				                         "Unable to initialize helm");
 			}
@@ -331,7 +330,6 @@ namespace internal {
 					log_info(error);
 					//things aren't working, delete our apparently non-functional record
 					store.removeCluster(cluster.id);
-					span->End();
 					throw std::runtime_error("Cluster registration failed: "
 					                         "Unable to initialize helm");
 				}
@@ -393,13 +391,12 @@ namespace internal {
 
 		//set the convenience DNS record for the cluster
 		resultMessage += internal::setClusterDNSRecord(store, cluster);
-		span->End();
 		return resultMessage;
 	}
 
 	void supplementLocation(PersistentStore& store, GeoLocation& loc) {
 		if (store.getGeocoder().canGeocode()) {
-			auto geoData = store.getGeocoder().reverseLookup(loc);
+			auto geoData = store.reverseGeocode(loc);
 			if (!geoData)
 				log_warn("Failed to look up geographic coordinates " << loc << ": " << geoData.error);
 			else {
@@ -421,13 +418,7 @@ namespace internal {
 }
 
 crow::response createCluster(PersistentStore& store, const crow::request& req) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -435,7 +426,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	if (!user) {
 		const std::string &errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -449,7 +439,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	} catch (std::runtime_error &err) {
 		const std::string &errMsg = "Invalid JSON in request body ";
 		setWebSpanError(span, errMsg + err.what(), 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -457,21 +446,18 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	if (body.IsNull()) {
 		const std::string &errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if (!body.HasMember("metadata")) {
 		const std::string &errMsg = "Missing user metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if (!body["metadata"].IsObject()) {
 		const std::string &errMsg = "Incorrect type for metadata";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -479,84 +465,72 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	if (!body["metadata"].HasMember("name")) {
 		const std::string &errMsg = "Missing cluster name in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if (!body["metadata"]["name"].IsString()) {
 		const std::string &errMsg = "Incorrect type for cluster name";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if (!body["metadata"].HasMember("group")) {
 		const std::string& errMsg = "Missing Group ID in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["group"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group ID";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].HasMember("owningOrganization")) {
 		const std::string& errMsg = "Missing organization name in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["owningOrganization"].IsString()) {
 		const std::string& errMsg = "Incorrect type for organization";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].HasMember("caData")) {
 		const std::string& errMsg = "Missing caData in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["caData"].IsString()) {
 		const std::string& errMsg = "Incorrect type for caData";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].HasMember("token")) {
 		const std::string& errMsg = "Missing token in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["token"].IsString()) {
 		const std::string& errMsg = "Incorrect type for token";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].HasMember("serverAddress")) {
 		const std::string& errMsg = "Missing serverAddress in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["serverAddress"].IsString()) {
 		const std::string& errMsg = "Incorrect type for serverAddress";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -611,14 +585,12 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	}catch(const YAML::ParserException& ex){
 		const std::string& errMsg = "Unable to parse kubeconfig as YAML";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(systemNamespace.empty()) {
 		const std::string& errMsg = "Unable to determine kubernetes namespace from kubeconfig";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -641,7 +613,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 		if(!group) {
 			const std::string& errMsg = "User not authorized";
 			setWebSpanError(span, errMsg, 403);
-			span->End();
 			log_error(errMsg);
 			return crow::response(403, generateError(errMsg));
 		}
@@ -653,7 +624,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	if(!store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -662,21 +632,18 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	if(!validDnsToken(cluster.name)) {
 		const std::string& errMsg = "Cluster names may only contain [a-zA-Z0-9-]";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(cluster.name.find(IDGenerator::clusterIDPrefix)==0) {
 		const std::string& errMsg = "Cluster names may not begin with " + IDGenerator::clusterIDPrefix;
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(store.findClusterByName(cluster.name)) {
 		const std::string& errMsg = "Cluster name is already in use";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -686,7 +653,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	if(!created){
 		const std::string& errMsg = "Cluster registration failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error("Failed to create " << cluster);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -698,7 +664,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	catch(std::runtime_error& err){
 		const std::string& errMsg = err.what();
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -716,7 +681,6 @@ crow::response createCluster(PersistentStore& store, const crow::request& req) {
 	metadata.AddMember("name", rapidjson::StringRef(cluster.name.c_str()), alloc);
 	result.AddMember("metadata", metadata, alloc); 
 	result.AddMember("message", resultMessage, alloc); 
-	span->End();
 	return crow::response(to_string(result));
 }
 
@@ -742,11 +706,18 @@ namespace internal{
 			return storageClasses;
 		}
 		
+		static const JSONExtractor classFields({
+			"/items/*/metadata/name",
+			"/items/*/metadata/annotations/storageclass.kubernetes.io~1is-default-class",
+			"/items/*/allowVolumeExpansion",
+			"/items/*/volumeBindingMode",
+			"/items/*/reclaimPolicy",
+		});
 		rapidjson::Document classInfo;
 		try{
-			classInfo.Parse(classInfoRaw.output);
+			classFields.parseInsitu(classInfoRaw.output,classInfo);
 		}catch(std::runtime_error& err){
-			log_error("Failed to parse output of kubectl get storageclasses -o=json as JSON");
+			log_error("Failed to parse output of kubectl get storageclasses -o=json as JSON: " << err.what());
 			return storageClasses;
 		}
 		
@@ -801,11 +772,17 @@ namespace internal{
 			return priorityClasses;
 		}
 		
+		static const JSONExtractor classFields({
+			"/items/*/metadata/name",
+			"/items/*/description",
+			"/items/*/value",
+			"/items/*/globalDefault",
+		});
 		rapidjson::Document classInfo;
 		try{
-			classInfo.Parse(classInfoRaw.output);
+			classFields.parseInsitu(classInfoRaw.output,classInfo);
 		}catch(std::runtime_error& err){
-			log_error("Failed to parse output of kubectl get priorityclasses -o=json as JSON");
+			log_error("Failed to parse output of kubectl get priorityclasses -o=json as JSON: " << err.what());
 			return priorityClasses;
 		}
 		
@@ -836,30 +813,24 @@ namespace internal{
 
 crow::response getClusterInfo(PersistentStore& store, const crow::request& req,
 			      const std::string clusterID) {
-	auto provider = opentelemetry::trace::Provider::GetTracerProvider();
-	auto tracer = provider->GetTracer("SlateAPIServer", serverVersionString);
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("getClusterInfo", attributes, options);
+	SpanGuard span("getClusterInfo");
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	log_info(user << " requested information about " << clusterID << " from " << req.remote_endpoint);
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
 	//all users are allowed to query all clusters?
 	
 	bool all_nodes = (req.url_params.get("nodes")!=nullptr);
+	const FieldSelection fields(req);
 
 	const Cluster cluster=store.getCluster(clusterID);
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -874,58 +845,67 @@ crow::response getClusterInfo(PersistentStore& store, const crow::request& req,
 	rapidjson::Value clusterData(rapidjson::kObjectType);
 	clusterData.AddMember("id", cluster.id, alloc);
 	clusterData.AddMember("name", cluster.name, alloc);
-	clusterData.AddMember("owningGroup", store.findGroupByID(cluster.owningGroup).name, alloc);
+	if(fields.includes("/metadata/owningGroup"))
+		clusterData.AddMember("owningGroup", store.findGroupByID(cluster.owningGroup).name, alloc);
 	clusterData.AddMember("owningOrganization", cluster.owningOrganization, alloc);
-	// Attempt to find master node address (API server address-- typically the same)
 	auto configPath=store.configPathForCluster(cluster.id);
-	std::vector<std::string> serverArgs = {"config","view","-o=jsonpath={.clusters[0].cluster.server}"};
-	auto server_info = kubernetes::kubectl(*configPath, serverArgs);
-	clusterData.AddMember("masterAddress", rapidjson::StringRef(server_info.output), alloc);
-
-	std::vector<GeoLocation> locations=store.getLocationsForCluster(cluster.id);
-	rapidjson::Value clusterLocation(rapidjson::kArrayType);
-	clusterLocation.Reserve(locations.size(), alloc);
-	for(const auto& location : locations){
-		rapidjson::Value entry(rapidjson::kObjectType);
-		entry.AddMember("lat",location.lat, alloc);
-		entry.AddMember("lon",location.lon, alloc);
-		if(!location.description.empty())
-			entry.AddMember("desc",location.description, alloc);
-		clusterLocation.PushBack(entry, alloc);
-	}
-	clusterData.AddMember("location", clusterLocation, alloc);
+	// Attempt to find master node address (API server address-- typically the same)
+	if(fields.includes("/metadata/masterAddress")){
+		std::vector<std::string> serverArgs = {"config","view","-o=jsonpath={.clusters[0].cluster.server}"};
+		auto server_info = kubernetes::kubectl(*configPath, serverArgs);
+		clusterData.AddMember("masterAddress", server_info.output, alloc);
+	}
+
+	if(fields.includes("/metadata/location")){
+		std::vector<GeoLocation> locations=store.getLocationsForCluster(cluster.id);
+		rapidjson::Value clusterLocation(rapidjson::kArrayType);
+		clusterLocation.Reserve(locations.size(), alloc);
+		for(const auto& location : locations){
+			rapidjson::Value entry(rapidjson::kObjectType);
+			entry.AddMember("lat",location.lat, alloc);
+			entry.AddMember("lon",location.lon, alloc);
+			if(!location.description.empty())
+				entry.AddMember("desc",location.description, alloc);
+			clusterLocation.PushBack(entry, alloc);
+		}
+		clusterData.AddMember("location", clusterLocation, alloc);
+	}
 	log_info(cluster << " monitoring credential is " << cluster.monitoringCredential);
 	clusterData.AddMember("hasMonitoring", (bool)cluster.monitoringCredential, alloc);
 	
-	auto storageClasses=internal::getClusterStorageClasses(store,cluster);
-	rapidjson::Value storageClassData(rapidjson::kArrayType);
-	storageClassData.Reserve(storageClasses.size(), alloc);
-	for(const auto& storageClass : storageClasses){
-		rapidjson::Value entry(rapidjson::kObjectType);
-		entry.AddMember("name",storageClass.name, alloc);
-		entry.AddMember("isDefault",storageClass.isDefault, alloc);
-		entry.AddMember("allowVolumeExpansion",storageClass.allowVolumeExpansion, alloc);
-		entry.AddMember("bindingMode",storageClass.bindingMode, alloc);
-		entry.AddMember("reclaimPolicy",storageClass.reclaimPolicy, alloc);
-		storageClassData.PushBack(entry, alloc);
-	}
-	clusterData.AddMember("storageClasses", storageClassData, alloc);
-	
-	auto priorityClasses=internal::getClusterPriorityClasses(store,cluster);
-	rapidjson::Value priorityClassData(rapidjson::kArrayType);
-	priorityClassData.Reserve(priorityClasses.size(), alloc);
-	for(const auto& priorityClass : priorityClasses){
-		rapidjson::Value entry(rapidjson::kObjectType);
-		entry.AddMember("name",priorityClass.name, alloc);
-		entry.AddMember("isDefault",priorityClass.isDefault, alloc);
-		entry.AddMember("description",priorityClass.description, alloc);
-		entry.AddMember("priority",priorityClass.priority, alloc);
-		priorityClassData.PushBack(entry, alloc);
-	}
-	clusterData.AddMember("priorityClasses", priorityClassData, alloc);
+	if(fields.includes("/metadata/storageClasses")){
+		auto storageClasses=internal::getClusterStorageClasses(store,cluster);
+		rapidjson::Value storageClassData(rapidjson::kArrayType);
+		storageClassData.Reserve(storageClasses.size(), alloc);
+		for(const auto& storageClass : storageClasses){
+			rapidjson::Value entry(rapidjson::kObjectType);
+			entry.AddMember("name",storageClass.name, alloc);
+			entry.AddMember("isDefault",storageClass.isDefault, alloc);
+			entry.AddMember("allowVolumeExpansion",storageClass.allowVolumeExpansion, alloc);
+			entry.AddMember("bindingMode",storageClass.bindingMode, alloc);
+			entry.AddMember("reclaimPolicy",storageClass.reclaimPolicy, alloc);
+			storageClassData.PushBack(entry, alloc);
+		}
+		clusterData.AddMember("storageClasses", storageClassData, alloc);
+	}
+	
+	if(fields.includes("/metadata/priorityClasses")){
+		auto priorityClasses=internal::getClusterPriorityClasses(store,cluster);
+		rapidjson::Value priorityClassData(rapidjson::kArrayType);
+		priorityClassData.Reserve(priorityClasses.size(), alloc);
+		for(const auto& priorityClass : priorityClasses){
+			rapidjson::Value entry(rapidjson::kObjectType);
+			entry.AddMember("name",priorityClass.name, alloc);
+			entry.AddMember("isDefault",priorityClass.isDefault, alloc);
+			entry.AddMember("description",priorityClass.description, alloc);
+			entry.AddMember("priority",priorityClass.priority, alloc);
+			priorityClassData.PushBack(entry, alloc);
+		}
+		clusterData.AddMember("priorityClasses", priorityClassData, alloc);
+	}
 
 	// Collect k8s version information
-	{
+	if(fields.includes("/metadata/version")){
 		auto versionInfo = kubernetes::kubectl(*configPath, {"version", "-o", "json"});
 		rapidjson::Document cmdOutput;
 		cmdOutput.Parse(versionInfo.output);
@@ -934,18 +914,28 @@ crow::response getClusterInfo(PersistentStore& store, const crow::request& req,
 			if (serverInfo.HasMember("gitVersion") && serverInfo["gitVersion"].IsString()) {
 				clusterData.AddMember("version", rapidjson::Value().SetString(serverInfo["gitVersion"].GetString(), alloc), alloc);
 			} else {
-				std::string version = "Version unknown";
-				clusterData.AddMember("version", rapidjson::StringRef(version), alloc);
+				clusterData.AddMember("version", "Version unknown", alloc);
 			}
 		}
 	}
 
 	// Collect all node info if requested
-	if (all_nodes) {
+	if (all_nodes && (fields.includes("/metadata/nodes") || fields.includes("/metadata/clusterNodes")
+	                  || fields.includes("/metadata/clusterCpus") || fields.includes("/metadata/clusterMemory"))) {
 		rapidjson::Value nodeInfo(rapidjson::kArrayType);
 		auto node_info = kubernetes::kubectl(*configPath, {"get", "nodes", "-o", "json"});
+		static const JSONExtractor nodeFields({
+			"/items/*/metadata/name",
+			"/items/*/status/addresses",
+			"/items/*/status/allocatable",
+			"/items/*/status/capacity",
+		});
 		rapidjson::Document cmdOutput;
-		cmdOutput.Parse(node_info.output);
+		try{
+			nodeFields.parseInsitu(node_info.output,cmdOutput);
+		}catch(std::runtime_error& err){
+			log_error("Failed to parse output of kubectl get nodes -o json as JSON: " << err.what());
+		}
 
 		if(cmdOutput.IsObject() && cmdOutput.HasMember("items")) {
 			// Get number of nodes
@@ -1030,19 +1020,13 @@ crow::response getClusterInfo(PersistentStore& store, const crow::request& req,
 		}
 	}
 	clusterResult.AddMember("metadata", clusterData, alloc);
-	span->End();
+	fields.apply(clusterResult);
 	return crow::response(to_string(clusterResult));
 }
 
 crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 			     const std::string& clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1050,7 +1034,6 @@ crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1059,7 +1042,6 @@ crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1071,7 +1053,6 @@ crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 		if(!force || !user.admin) {
 			const std::string& errMsg = "User not authorized";
 			setWebSpanError(span, errMsg, 403);
-			span->End();
 			log_error(errMsg);
 			return crow::response(403, generateError(errMsg));
 		}
@@ -1089,7 +1070,6 @@ crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 		if (!reachable && !force) {
 			const std::string &errMsg = "Cluster not reachable, please use force option when deleting";
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			log_error(errMsg);
 			return crow::response(500, generateError(errMsg));
 		}
@@ -1098,7 +1078,6 @@ crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 	auto err=internal::deleteCluster(store,cluster,force);
 	if(!err.empty()) {
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error(err);
 		return crow::response(500, generateError(err));
 	}
@@ -1114,8 +1093,7 @@ crow::response deleteCluster(PersistentStore& store, const crow::request& req,
 	message.subject="SLATE: Cluster Deleted";
 	message.body="A cluster your organization has access to ("+
 				cluster.name+") has been deleted by the cluster administrator.";
-	store.getEmailClient().sendEmail(message);
-	span->End();
+	store.queueEmail(message);
 	return(crow::response(200));
 }
 
@@ -1228,35 +1206,13 @@ namespace internal {
 		// Delete our DNS record for the cluster
 		auto dnsName = "*." + store.dnsNameForCluster(cluster);
 		if (store.canUpdateDNS()) {
-			Aws::Route53::Model::RRType type = Aws::Route53::Model::RRType::A;
-			//try for an IPv4 record
-			std::vector<std::string> record;
+			//The records are deleted in the background; any failure is logged 
+			//when the change is submitted
 			try {
-				record = store.getDNSRecord(type, dnsName);
+				store.removeDNSRecords(dnsName);
 			}
 			catch (std::runtime_error &err) {
-				log_error("Unable to look up DNS record for " << cluster << ": " << err.what());
-			}
-			if (record.empty()) {
-				//try again as IPv6
-				type = Aws::Route53::Model::RRType::AAAA;
-				try {
-					record = store.getDNSRecord(type, dnsName);
-				}
-				catch (std::runtime_error &err) {
-					log_error("Unable to look up DNS record for " << cluster << ": " << err.what());
-				}
-			}
-			if (!record.empty()) {
-				bool success = false;
-				try {
-					success = store.removeDNSRecord(dnsName, record.front());
-				}
-				catch (std::runtime_error &err) {
-					log_error("Unable to remove DNS record for " << cluster << ": " << err.what());
-				}
-				if (!success)
-					log_error("Failed to remove DNS record mapping " << dnsName << " to " << record.front());
+				log_error("Unable to remove DNS record for " << cluster << ": " << err.what());
 			}
 		} else {
 			log_warn("Not able to change DNS records, so the record for " << dnsName
@@ -1278,13 +1234,7 @@ namespace internal {
 
 crow::response updateCluster(PersistentStore& store, const crow::request& req,
 			     const std::string &clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1292,7 +1242,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1301,7 +1250,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1312,7 +1260,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1325,28 +1272,24 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg + std::string(" Runtime exception: ") + err.what(), 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("metadata")) {
 		const std::string& errMsg = "Missing cluster metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for metadata";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -1357,7 +1300,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 		if(!body["metadata"]["kubeconfig"].IsString()) {
 			const std::string& errMsg = "Incorrect type for kubeconfig";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			log_error(errMsg);
 			return crow::response(400, generateError(errMsg));
 		}
@@ -1369,7 +1311,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 		if(!body["metadata"]["owningOrganization"].IsString()) {
 			const std::string& errMsg = "Incorrect type for owningOrganization";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			log_error(errMsg);
 			return crow::response(400, generateError(errMsg));
 		}
@@ -1382,7 +1323,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 		if(!body["metadata"]["location"].IsArray()) {
 			const std::string& errMsg = "Incorrect type for location";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			log_error(errMsg);
 			return crow::response(400, generateError(errMsg));
 		}
@@ -1391,7 +1331,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 			  || !entry["lat"].IsNumber() || !entry["lon"].IsNumber()) {
 				const std::string& errMsg = "Incorrect type for location";
 				setWebSpanError(span, errMsg, 400);
-				span->End();
 				log_error(errMsg);
 				return crow::response(400, generateError(errMsg));
 			}
@@ -1406,7 +1345,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 	
 	if(!updateMainRecord && !updateLocation){
 		log_info("Requested update to " << cluster << " is trivial");
-		span->End();
 		return(crow::response(200));
 	}
 	
@@ -1422,7 +1360,6 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 		log_error("Failed to update " << cluster);
 		const std::string& errMsg = "Cluster update failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -1438,23 +1375,15 @@ crow::response updateCluster(PersistentStore& store, const crow::request& req,
 		catch(std::runtime_error& err){
 			log_error("Failed to update " << cluster);
 			setWebSpanError(span, err.what(), 500);
-			span->End();
 			return crow::response(500, generateError(err.what()));
 		}
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response listClusterAllowedgroups(PersistentStore& store, const crow::request& req,
 					const std::string& clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1462,7 +1391,6 @@ crow::response listClusterAllowedgroups(PersistentStore& store, const crow::requ
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1472,7 +1400,6 @@ crow::response listClusterAllowedgroups(PersistentStore& store, const crow::requ
 	if(!cluster) {
 		const std::string &errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1524,19 +1451,12 @@ crow::response listClusterAllowedgroups(PersistentStore& store, const crow::requ
 		}
 	}
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response checkGroupClusterAccess(PersistentStore& store, const crow::request& req, 
 									   const std::string& clusterID, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1544,7 +1464,6 @@ crow::response checkGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1554,7 +1473,6 @@ crow::response checkGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1577,7 +1495,6 @@ crow::response checkGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!group) { //more input validation
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1586,25 +1503,17 @@ crow::response checkGroupClusterAccess(PersistentStore& store, const crow::reque
 	//if the group is the owner of the cluster, the answer is yes and we're done
 	if(group.id == cluster.owningGroup){
 		result.AddMember("accessAllowed", true, alloc);
-		span->End();
 		return crow::response(to_string(result));
 	}
 	bool allowed=store.groupAllowedOnCluster(group.id,cluster.id);
 	log_info(group << (allowed?" is ":" is not ") << "allowed on " << cluster);
 	result.AddMember("accessAllowed", allowed, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response grantGroupClusterAccess(PersistentStore& store, const crow::request& req,
 				       const std::string& clusterID, const std::string& groupID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1612,7 +1521,6 @@ crow::response grantGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!user) {
 		const std::string &errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1622,7 +1530,6 @@ crow::response grantGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1632,7 +1539,6 @@ crow::response grantGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1649,7 +1555,6 @@ crow::response grantGroupClusterAccess(PersistentStore& store, const crow::reque
 		if(!group) {
 			const std::string& errMsg = "Group not found";
 			setWebSpanError(span, errMsg, 404);
-			span->End();
 			log_error(errMsg);
 			return crow::response(404, generateError(errMsg));
 		}
@@ -1657,7 +1562,6 @@ crow::response grantGroupClusterAccess(PersistentStore& store, const crow::reque
 		if(group.id==cluster.owningGroup) {
 			//the owning group always implicitly has access, 
 			//so return success without making a pointless record
-			span->End();
 			return crow::response(200);
 		}
 		
@@ -1668,23 +1572,15 @@ crow::response grantGroupClusterAccess(PersistentStore& store, const crow::reque
 	if(!success) {
 		const std::string& errMsg = "Granting Group access to cluster failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::request& req,
 					const std::string& clusterID, const std::string& groupID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1692,7 +1588,6 @@ crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::requ
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1702,7 +1597,6 @@ crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::requ
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1712,7 +1606,6 @@ crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::requ
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1728,7 +1621,6 @@ crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::requ
 		if(!group) {
 			const std::string& errMsg = "Group not found";
 			setWebSpanError(span, errMsg, 404);
-			span->End();
 			log_error(errMsg);
 			return crow::response(404, generateError(errMsg));
 		}
@@ -1737,7 +1629,6 @@ crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::requ
 		if(group.id==cluster.owningGroup) {
 			const std::string& errMsg = "Cannot deny cluster access to owning Group";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			log_error(errMsg);
 			return crow::response(400, generateError(errMsg));
 		}
@@ -1749,11 +1640,9 @@ crow::response revokeGroupClusterAccess(PersistentStore& store, const crow::requ
 	if(!success) {
 		const std::string& errMsg = "Removing Group access to cluster failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
@@ -1762,13 +1651,7 @@ crow::response listClusterGroupAllowedApplications(PersistentStore& store,
 						   const std::string& clusterID,
 						   const std::string& groupID) {
 
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1777,7 +1660,6 @@ crow::response listClusterGroupAllowedApplications(PersistentStore& store,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1787,7 +1669,6 @@ crow::response listClusterGroupAllowedApplications(PersistentStore& store,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1797,7 +1678,6 @@ crow::response listClusterGroupAllowedApplications(PersistentStore& store,
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1808,7 +1688,6 @@ crow::response listClusterGroupAllowedApplications(PersistentStore& store,
 	   && !store.userInGroup(user.id,group.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1822,20 +1701,13 @@ crow::response listClusterGroupAllowedApplications(PersistentStore& store,
 	for(const auto& application : allowed)
 		resultItems.PushBack(rapidjson::Value(application,alloc), alloc);
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response allowGroupUseOfApplication(PersistentStore& store, const crow::request& req,
 					  const std::string& clusterID, const std::string& groupID,
 					  const std::string& applicationName) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1845,7 +1717,6 @@ crow::response allowGroupUseOfApplication(PersistentStore& store, const crow::re
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1855,7 +1726,6 @@ crow::response allowGroupUseOfApplication(PersistentStore& store, const crow::re
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1865,7 +1735,6 @@ crow::response allowGroupUseOfApplication(PersistentStore& store, const crow::re
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1874,7 +1743,6 @@ crow::response allowGroupUseOfApplication(PersistentStore& store, const crow::re
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1886,24 +1754,16 @@ crow::response allowGroupUseOfApplication(PersistentStore& store, const crow::re
 	if(!success) {
 		const std::string& errMsg = "Granting Group permission to use application failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response denyGroupUseOfApplication(PersistentStore& store, const crow::request& req,
 					 const std::string& clusterID, const std::string& groupID,
 					 const std::string& applicationName) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1913,7 +1773,6 @@ crow::response denyGroupUseOfApplication(PersistentStore& store, const crow::req
 	if (!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1923,7 +1782,6 @@ crow::response denyGroupUseOfApplication(PersistentStore& store, const crow::req
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1933,7 +1791,6 @@ crow::response denyGroupUseOfApplication(PersistentStore& store, const crow::req
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1943,7 +1800,6 @@ crow::response denyGroupUseOfApplication(PersistentStore& store, const crow::req
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1955,24 +1811,16 @@ crow::response denyGroupUseOfApplication(PersistentStore& store, const crow::req
 	if(!success) {
 		const std::string& errMsg = "Granting Group permission to use application failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response getClusterMonitoringCredential(PersistentStore& store,
 					      const crow::request& req,
 					      const std::string& clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -1980,7 +1828,6 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -1989,7 +1836,6 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -1999,7 +1845,6 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -2021,12 +1866,11 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 				message.body="Allocation of a monitoring credential for the "+
 				cluster.name+" cluster was requested but could not be fulfilled:\n"
 				+errMsg;
-				store.getEmailClient().sendEmail(message);
+				store.queueEmail(message);
 			}
 
 			const std::string& err = "Allocating monitoring credential failed";
 			setWebSpanError(span, err, 500);
-			span->End();
 			log_error(err);
 			return crow::response(500, generateError(err));
 		}
@@ -2043,20 +1887,17 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 				+cluster.name+" cluster but adding it to the cluster record in "
 				"the persistent store failed. This inconsistent state should be "
 				"manually resolved.";
-				store.getEmailClient().sendEmail(message);
+				store.queueEmail(message);
 			}
 
 			const std::string& err = "Allocating monitoring credential failed";
 			setWebSpanError(span, err, 500);
-			span->End();
 			log_error(err);
 			return crow::response(500, generateError(err));
 		}
 		cluster.monitoringCredential=cred;
 		
-		auto allCreds=store.listMonitoringCredentials();
-		unsigned int availableCreds=std::count_if(allCreds.begin(),allCreds.end(),
-			[](const S3Credential& c){ return !c.inUse && !c.revoked; });
+		unsigned int availableCreds=store.countAvailableMonitoringCredentials();
 		if(availableCreds<3 && !store.getOpsEmail().empty()){
 			//send email notification to the platform Ops team
 			EmailClient::Email message;
@@ -2065,7 +1906,7 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 			message.subject="API Server: Low number of monitoring credentials available";
 			message.body=(availableCreds?"Only ":"")+std::to_string(availableCreds)
 			+" credential"+std::string(availableCreds!=1?"":"s")+" remain available for allocation.";
-			store.getEmailClient().sendEmail(message);
+			store.queueEmail(message);
 		}
 	}
 	
@@ -2081,20 +1922,13 @@ crow::response getClusterMonitoringCredential(PersistentStore& store,
 	credData.AddMember("revoked", cluster.monitoringCredential.revoked, alloc);
 	result.AddMember("metadata", credData, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response removeClusterMonitoringCredential(PersistentStore& store,
 						 const crow::request& req,
 						 const std::string& clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -2102,7 +1936,6 @@ crow::response removeClusterMonitoringCredential(PersistentStore& store,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -2111,7 +1944,6 @@ crow::response removeClusterMonitoringCredential(PersistentStore& store,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -2121,7 +1953,6 @@ crow::response removeClusterMonitoringCredential(PersistentStore& store,
 	if(!user.admin && !store.userInGroup(user.id,cluster.owningGroup)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -2130,10 +1961,8 @@ crow::response removeClusterMonitoringCredential(PersistentStore& store,
 	if(!credRemoval.empty()){
 		log_error(credRemoval);
 		setWebSpanError(span, credRemoval, 500);
-		span->End();
 		return crow::response(500, generateError("Removing monitoring credential failed"));
 	}
-	span->End();
 	return crow::response(200);
 }
 
@@ -2325,13 +2154,7 @@ rapidjson::Document ClusterConsistencyResult::toJSON() const{
 
 crow::response pingCluster(PersistentStore& store, const crow::request& req,
 			   const std::string& clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -2339,7 +2162,6 @@ crow::response pingCluster(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -2349,7 +2171,6 @@ crow::response pingCluster(PersistentStore& store, const crow::request& req,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -2376,19 +2197,12 @@ crow::response pingCluster(PersistentStore& store, const crow::request& req,
 	result.AddMember("apiVersion", "v1alpha3", alloc);
 	result.AddMember("reachable", reachable, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response verifyCluster(PersistentStore& store, const crow::request& req,
                              const std::string& clusterID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -2396,7 +2210,6 @@ crow::response verifyCluster(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -2406,7 +2219,6 @@ crow::response verifyCluster(PersistentStore& store, const crow::request& req,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -2417,13 +2229,7 @@ crow::response verifyCluster(PersistentStore& store, const crow::request& req,
 
 crow::response repairCluster(PersistentStore& store, const crow::request& req,
 			     const std::string& clusterID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -2431,7 +2237,6 @@ crow::response repairCluster(PersistentStore& store, const crow::request& req,
 	if(!user || !user.admin) { //only admins can perform this action
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -2441,7 +2246,6 @@ crow::response repairCluster(PersistentStore& store, const crow::request& req,
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -2465,7 +2269,6 @@ crow::response repairCluster(PersistentStore& store, const crow::request& req,
 		//Delete records of things which no longer exist
 		//TODO: implement this
 	}
-	span->End();
 	return crow::response(200);
 
 }
@@ -1,8 +1,13 @@
 #include <DNSManipulator.h>
 
+#include <algorithm>
+#include <cctype>
+
 #include <Logging.h>
 
 #include <aws/route53/Route53Client.h>
+#include <aws/route53/model/Change.h>
+#include <aws/route53/model/ChangeBatch.h>
 #include <aws/route53/model/ChangeResourceRecordSetsRequest.h>
 #include <aws/route53/model/ListHostedZonesRequest.h>
 #include <aws/route53/model/ListResourceRecordSetsRequest.h>
@@ -12,40 +17,48 @@
 #include <aws/route53/model/TestDNSAnswerRequest.h>
 
 DNSManipulator::DNSManipulator(const Aws::Auth::AWSCredentials& credentials, 
-	                           const Aws::Client::ClientConfiguration& clientConfig)
-:validServer(false){
-	if(clientConfig.endpointOverride.find("amazonaws.com")!=std::string::npos){
+	                           const Aws::Client::ClientConfiguration& clientConfig,
+	                           const std::string& route53Endpoint)
+:validServer(false),batchDelay(250),flushRequested(false),stopping(false){
+	if(!route53Endpoint.empty() || clientConfig.endpointOverride.find("amazonaws.com")!=std::string::npos){
 		Aws::Client::ClientConfiguration dnsConfig;
 		dnsConfig.region = "us-east-1";
 		dnsConfig.enableEndpointDiscovery = false;
 //		dnsConfig.endpointOverride  = clientConfig.endpointOverride;
-		dnsConfig.endpointOverride = "https://route53.amazonaws.com";
+		if(!route53Endpoint.empty()){
+			dnsConfig.endpointOverride = route53Endpoint;
+			dnsConfig.scheme = clientConfig.scheme;
+		}
+		else
+			dnsConfig.endpointOverride = "https://route53.amazonaws.com";
 		std::cout << "Using AWS region: " << dnsConfig.region << std::endl;
 		std::cout << "Using DNS endpoint: " << dnsConfig.endpointOverride << std::endl;
 		dnsClient=Aws::Route53::Route53Client(credentials, dnsConfig);
 		
-		auto result=dnsClient.ListHostedZones(Aws::Route53::Model::ListHostedZonesRequest());
-		if(!result.IsSuccess()){
-			log_fatal("Failed to list hosted DNS zones: " 
-			<< (int)result.GetError().GetErrorType() << ' '
-			<< result.GetError().GetExceptionName() << ' '
-			<< result.GetError().GetMessage());
-		}
-		
-		for(auto zone : result.GetResult().GetHostedZones()){
-			std::string id=zone.GetId();
-			std::size_t pos=id.rfind('/');
-			if (pos != std::string::npos && pos < id.size()) {
-				id = id.substr(pos + 1);
-			}
-			hostedZones.emplace(zone.GetName(),id);
+		try{
+			std::lock_guard<std::mutex> lock(zoneMut);
+			loadHostedZones();
+		}catch(std::runtime_error& err){
+			log_fatal(err.what());
 		}
 		
 		validServer=true;
+		worker=std::thread(&DNSManipulator::work,this);
 		log_info("DNS client ready");
 	}
 }
 
+DNSManipulator::~DNSManipulator(){
+	if(!worker.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(changeMut);
+		stopping=true;
+	}
+	changeQueued.notify_all();
+	worker.join();
+}
+
 const std::string DNSManipulator::heritageTag="heritage=slate-api";
 
 std::string DNSManipulator::zoneForName(const std::string& name){
@@ -63,56 +76,51 @@ std::string DNSManipulator::zoneForName(const std::string& name){
 	return zone;
 }
 
-bool DNSManipulator::safeToModifyDNS(const std::string& name, Aws::Route53::Model::RRType type) const{
-	auto zone=zoneForName(name);
-	auto zoneIt=hostedZones.find(zone);
-	if (zoneIt == hostedZones.end()) {
-		throw std::runtime_error(zone + " is not a hosted zone in this AWS account");
-	}
-	
-	auto result=dnsClient.TestDNSAnswer(Aws::Route53::Model::TestDNSAnswerRequest()
-	                                    .WithHostedZoneId(zoneIt->second)
-	                                    .WithRecordName(name)
-	                                    .WithRecordType(type)
-	                                    );
-	if(!result.IsSuccess()){
-		throw std::runtime_error("Failed to look up A record for "+name+": "
-		  +std::to_string((int)result.GetError().GetErrorType())+" "
-		  +result.GetError().GetExceptionName()+" "
-		  +result.GetError().GetMessage());
-	}
-	bool baseRecordExists=!result.GetResult().GetRecordData().empty();
+void DNSManipulator::loadHostedZones() const{
+	std::map<std::string,std::string> zones;
+	auto request=Aws::Route53::Model::ListHostedZonesRequest();
+	while(true){
+		auto result=dnsClient.ListHostedZones(request);
+		if(!result.IsSuccess()){
+			throw std::runtime_error("Failed to list hosted DNS zones: "
+			  +std::to_string((int)result.GetError().GetErrorType())+" "
+			  +result.GetError().GetExceptionName()+" "
+			  +result.GetError().GetMessage());
+		}
 		
-	result=dnsClient.TestDNSAnswer(Aws::Route53::Model::TestDNSAnswerRequest()
-	                               .WithHostedZoneId(zoneIt->second)
-	                               .WithRecordName(name)
-	                               .WithRecordType(Aws::Route53::Model::RRType::TXT));
-	if(!result.IsSuccess()){
-		throw std::runtime_error("Failed to look up TXT record for "+name+": "
-		  +std::to_string((int)result.GetError().GetErrorType())+" "
-		  +result.GetError().GetExceptionName()+" "
-		  +result.GetError().GetMessage());
-	}
-	bool heritageRecordExists=!result.GetResult().GetRecordData().empty();
-	if(heritageRecordExists){
-		heritageRecordExists=false; //reset this prior to checking more exhaustively
-		for(auto record : result.GetResult().GetRecordData()){
-			if (record.find(heritageTag) != std::string::npos) {
-				heritageRecordExists = true;
+		for(auto zone : result.GetResult().GetHostedZones()){
+			std::string id=zone.GetId();
+			std::size_t pos=id.rfind('/');
+			if (pos != std::string::npos && pos < id.size()) {
+				id = id.substr(pos + 1);
 			}
+			zones.emplace(zone.GetName(),id);
 		}
+		if(!result.GetResult().GetIsTruncated())
+			break;
+		request.SetMarker(result.GetResult().GetNextMarker());
 	}
-	
-	//Now figure out what to do. Cases:
-	//Base record exists, heritage record also exists -> We made this record and can replace it
-	//Base record exists, heritage record does not exist -> Not our record, can not modify
-	//Neither record exists -> We are free to create one
-	//No base record, but heritage record exists 
-	//    -> slightly corrupt state, but since we apparently touched the record in the past
-	//       and no one else seems to be using it now, assume that we can replace it.
-	log_info(name << ": " << (baseRecordExists?"has base record":"does not have base record")
-	  << ", " << (heritageRecordExists?"has heritage record":"does not have heritage record"));
-	return !baseRecordExists || heritageRecordExists;
+	hostedZones=std::move(zones);
+	zonesLoaded=clock::now();
+}
+
+std::string DNSManipulator::zoneID(const std::string& name) const{
+	const std::string zone=zoneForName(name);
+	std::lock_guard<std::mutex> lock(zoneMut);
+	auto zoneIt=hostedZones.find(zone);
+	//zones are rarely added, so only check for new ones occasionally
+	if(zoneIt==hostedZones.end() && clock::now()-zonesLoaded>std::chrono::minutes(1)){
+		try{
+			loadHostedZones();
+		}catch(std::runtime_error& err){
+			log_error(err.what());
+			zonesLoaded=clock::now();
+		}
+		zoneIt=hostedZones.find(zone);
+	}
+	if(zoneIt==hostedZones.end())
+		return "";
+	return zoneIt->second;
 }
 
 std::vector<std::string> DNSManipulator::getDNSRecord(Aws::Route53::Model::RRType type, const std::string& name) const{
@@ -120,14 +128,13 @@ std::vector<std::string> DNSManipulator::getDNSRecord(Aws::Route53::Model::RRTyp
 		throw std::runtime_error("No valid Route53 server");
 	}
 
-	auto zone=zoneForName(name);
-	auto zoneIt=hostedZones.find(zone);
-	if (zoneIt == hostedZones.end()) {
-		throw std::runtime_error(zone + " is not a hosted zone in this AWS account");
+	auto zone=zoneID(name);
+	if (zone.empty()) {
+		throw std::runtime_error(zoneForName(name) + " is not a hosted zone in this AWS account");
 	}
 	
 	auto result=dnsClient.TestDNSAnswer(Aws::Route53::Model::TestDNSAnswerRequest()
-	                                    .WithHostedZoneId(zoneIt->second)
+	                                    .WithHostedZoneId(zone)
 	                                    .WithRecordName(name)
 	                                    .WithRecordType(type)
 	                                    );
@@ -148,7 +155,7 @@ std::vector<std::string> DNSManipulator::getDNSRecord(Aws::Route53::Model::RRTyp
 	return data;
 }
 
-bool DNSManipulator::setDNSRecord(const std::string& name, const std::string& address){
+std::shared_future<bool> DNSManipulator::setDNSRecord(const std::string& name, const std::string& address){
 	if (!validServer) {
 		throw std::runtime_error("No valid Route53 server");
 	}
@@ -166,106 +173,255 @@ bool DNSManipulator::setDNSRecord(const std::string& name, const std::string& ad
 	} else {
 		throw std::runtime_error("Unrecognized IP address type: " + address);
 	}
-
-	if (!safeToModifyDNS(name, type)) {
-		return false;
-	}
 	
-	auto zone=zoneForName(name);
-	auto zoneIt=hostedZones.find(zone);
-	if (zoneIt == hostedZones.end()) {
-		throw std::runtime_error(zone + " is not a hosted zone in this AWS account");
+	PendingChange change;
+	change.remove=false;
+	change.address=address;
+	change.type=type;
+	return queueChange(name,std::move(change));
+}
+
+std::shared_future<bool> DNSManipulator::removeDNSRecords(const std::string& name){
+	if (!validServer) {
+		throw std::runtime_error("No valid Route53 server");
 	}
 	
-	auto mainRecordset=Aws::Route53::Model::ResourceRecordSet()
-	                   .WithName(name)
-	                   .WithType(type)
-	                   .WithResourceRecords({Aws::Route53::Model::ResourceRecord().WithValue(address)})
-	                   .WithTTL(300);
-	auto txtRecordset=Aws::Route53::Model::ResourceRecordSet()
-	                  .WithName(name)
-	                  .WithType(Aws::Route53::Model::RRType::TXT)
-	                  .WithResourceRecords({Aws::Route53::Model::ResourceRecord().WithValue('"'+heritageTag+'"')})
-	                  .WithTTL(300);
-	auto result=
-	dnsClient.ChangeResourceRecordSets(Aws::Route53::Model::ChangeResourceRecordSetsRequest()
-	  .WithChangeBatch(Aws::Route53::Model::ChangeBatch().WithChanges(
-	  {Aws::Route53::Model::Change()
-	   .WithAction(Aws::Route53::Model::ChangeAction::UPSERT)
-	   .WithResourceRecordSet(mainRecordset),
-	   Aws::Route53::Model::Change()
-	   .WithAction(Aws::Route53::Model::ChangeAction::UPSERT)
-	   .WithResourceRecordSet(txtRecordset)
-	  }))
-	  .WithHostedZoneId(zoneIt->second));
-	if(!result.IsSuccess()){
-		log_error("Failed set DNS records for " << name << ": "
-		  << std::to_string((int)result.GetError().GetErrorType()) << " "
-		  << result.GetError().GetExceptionName() << " "
-		  << result.GetError().GetMessage());
-		return false;
+	PendingChange change;
+	change.remove=true;
+	change.type=Aws::Route53::Model::RRType::A;
+	return queueChange(name,std::move(change));
+}
+
+void DNSManipulator::flush(){
+	{
+		std::lock_guard<std::mutex> lock(changeMut);
+		flushRequested=true;
 	}
-	return true;
+	changeQueued.notify_all();
 }
 
-bool DNSManipulator::removeDNSRecord(const std::string& name, const std::string& address){
-	if (!validServer) {
-		throw std::runtime_error("No valid Route53 server");
+std::shared_future<bool> DNSManipulator::queueChange(const std::string& name, PendingChange change){
+	change.results.emplace_back();
+	std::shared_future<bool> result=change.results.back().get_future().share();
+	{
+		std::lock_guard<std::mutex> lock(changeMut);
+		auto it=pendingChanges.find(name);
+		if(it==pendingChanges.end()){
+			change.queued=clock::now();
+			pendingChanges.emplace(name,std::move(change));
+		}
+		else{
+			//only the final state matters, so the new change replaces the 
+			//earlier one, and both learn its result
+			PendingChange& existing=it->second;
+			existing.remove=change.remove;
+			existing.address=change.address;
+			existing.type=change.type;
+			for(auto& promise : change.results)
+				existing.results.push_back(std::move(promise));
+		}
 	}
+	changeQueued.notify_one();
+	return result;
+}
 
-	//guess which kind of record we should be working on
-	Aws::Route53::Model::RRType type;
-	if (address.empty()) {
-		throw std::runtime_error("Invalid IP address: must not be empty");
-		//an IPv6 address must(?) contain at least one ':' and cannot match this
-	} else if (address.find_first_not_of("0123456789.") == std::string::npos) {
-		type = Aws::Route53::Model::RRType::A;
-		//an IPv4 address in dot-decimal form must contain at least one '.' and cannot match this
-	} else if (address.find_first_not_of("0123456789abcdefABCDEF:") == std::string::npos) {
-		type = Aws::Route53::Model::RRType::AAAA;
-	} else {
-		throw std::runtime_error("Unrecognized IP address type: " + address);
+namespace{
+	///Put a record name into the form in which Route53 reports it
+	std::string canonicalRecordName(std::string name){
+		std::transform(name.begin(),name.end(),name.begin(),
+		               [](unsigned char c){ return std::tolower(c); });
+		if(name.empty() || name.back()!='.')
+			name+='.';
+		//Route53 reports wildcards in escaped form
+		if(name.compare(0,2,"*.")==0)
+			name="\\052"+name.substr(1);
+		return name;
+	}
+	
+	std::string describeError(const Aws::Client::AWSError<Aws::Route53::Route53Errors>& err){
+		return std::to_string((int)err.GetErrorType())+" "+err.GetExceptionName()+" "+err.GetMessage();
 	}
+}
 
-	if (!safeToModifyDNS(name, type)) {
-		return false;
+void DNSManipulator::submitChanges(const std::string& zoneID, std::map<std::string,PendingChange>& changes){
+	using namespace Aws::Route53::Model;
+	
+	//the changes needed for each name, or none if the name cannot be changed
+	std::map<std::string,Aws::Vector<Change>> recordChanges;
+	std::map<std::string,bool> results;
+	for(const auto& item : changes){
+		const std::string& name=item.first;
+		const PendingChange& change=item.second;
+		//Find the existing records for the name with one request, rather 
+		//than querying each type of record separately
+		const std::string canonicalName=canonicalRecordName(name);
+		auto listing=dnsClient.ListResourceRecordSets(ListResourceRecordSetsRequest()
+		                                              .WithHostedZoneId(zoneID)
+		                                              .WithStartRecordName(canonicalName)
+		                                              .WithMaxItems("10"));
+		if(!listing.IsSuccess()){
+			log_error("Failed to look up DNS records for " << name << ": " << describeError(listing.GetError()));
+			results[name]=false;
+			continue;
+		}
+		std::vector<ResourceRecordSet> addressRecords;
+		std::vector<ResourceRecordSet> heritageRecords;
+		for(const auto& recordSet : listing.GetResult().GetResourceRecordSets()){
+			if(canonicalRecordName(recordSet.GetName())!=canonicalName)
+				break;
+			if(recordSet.GetType()==RRType::A || recordSet.GetType()==RRType::AAAA)
+				addressRecords.push_back(recordSet);
+			else if(recordSet.GetType()==RRType::TXT){
+				for(const auto& record : recordSet.GetResourceRecords()){
+					if(record.GetValue().find(heritageTag)!=std::string::npos){
+						heritageRecords.push_back(recordSet);
+						break;
+					}
+				}
+			}
+		}
+		//Now figure out what to do. Cases:
+		//Address record exists, heritage record also exists -> We made this record and can replace it
+		//Address record exists, heritage record does not exist -> Not our record, can not modify
+		//Neither record exists -> We are free to create one
+		//No address record, but heritage record exists 
+		//    -> slightly corrupt state, but since we apparently touched the record in the past
+		//       and no one else seems to be using it now, assume that we can replace it.
+		log_info(name << ": " << (!addressRecords.empty()?"has base record":"does not have base record")
+		  << ", " << (!heritageRecords.empty()?"has heritage record":"does not have heritage record"));
+		if(!addressRecords.empty() && heritageRecords.empty()){
+			log_error("Not modifying DNS records for " << name << " which were not made by SLATE");
+			results[name]=false;
+			continue;
+		}
+		
+		Aws::Vector<Change>& nameChanges=recordChanges[name];
+		if(change.remove){
+			//deletions must match the existing records exactly
+			for(const auto& recordSet : addressRecords)
+				nameChanges.push_back(Change().WithAction(ChangeAction::DELETE_).WithResourceRecordSet(recordSet));
+			for(const auto& recordSet : heritageRecords)
+				nameChanges.push_back(Change().WithAction(ChangeAction::DELETE_).WithResourceRecordSet(recordSet));
+		}
+		else{
+			auto mainRecordset=ResourceRecordSet()
+			                   .WithName(name)
+			                   .WithType(change.type)
+			                   .WithResourceRecords({ResourceRecord().WithValue(change.address)})
+			                   .WithTTL(300);
+			auto txtRecordset=ResourceRecordSet()
+			                  .WithName(name)
+			                  .WithType(RRType::TXT)
+			                  .WithResourceRecords({ResourceRecord().WithValue('"'+heritageTag+'"')})
+			                  .WithTTL(300);
+			nameChanges.push_back(Change().WithAction(ChangeAction::UPSERT).WithResourceRecordSet(mainRecordset));
+			nameChanges.push_back(Change().WithAction(ChangeAction::UPSERT).WithResourceRecordSet(txtRecordset));
+		}
+		if(nameChanges.empty()){ //nothing to delete
+			recordChanges.erase(name);
+			results[name]=true;
+		}
 	}
 	
-	auto zone=zoneForName(name);
-	auto zoneIt=hostedZones.find(zone);
-	if (zoneIt == hostedZones.end()) {
-		throw std::runtime_error(zone + " is not a hosted zone in this AWS account");
+	//Route53 applies a batch atomically, so if a batch fails, its names are 
+	//retried separately so that one bad record does not prevent the others 
+	//from being changed
+	auto apply=[&](const std::vector<std::string>& names)->bool{
+		Aws::Vector<Change> batch;
+		for(const auto& name : names)
+			batch.insert(batch.end(),recordChanges[name].begin(),recordChanges[name].end());
+		auto outcome=dnsClient.ChangeResourceRecordSets(ChangeResourceRecordSetsRequest()
+		                                                .WithChangeBatch(ChangeBatch().WithChanges(batch))
+		                                                .WithHostedZoneId(zoneID));
+		if(!outcome.IsSuccess()){
+			log_error("Failed to change DNS records for " << names.size() << " name"
+			          << (names.size()>1?"s":"") << (names.size()==1?" "+names.front():"")
+			          << ": " << describeError(outcome.GetError()));
+			return false;
+		}
+		return true;
+	};
+	//Route53 accepts at most 1000 changes in one batch, and each name needs 
+	//no more than a few
+	const std::size_t maxNamesPerBatch=250;
+	std::vector<std::string> batch;
+	auto submitBatch=[&]{
+		if(batch.empty())
+			return;
+		bool success=apply(batch);
+		for(const auto& name : batch)
+			results[name]=(success || (batch.size()>1 && apply({name})));
+		batch.clear();
+	};
+	for(const auto& item : recordChanges){
+		batch.push_back(item.first);
+		if(batch.size()==maxNamesPerBatch)
+			submitBatch();
 	}
+	submitBatch();
 	
-	auto mainRecordset=Aws::Route53::Model::ResourceRecordSet()
-	                   .WithName(name)
-	                   .WithType(type)
-	                   .WithResourceRecords({Aws::Route53::Model::ResourceRecord().WithValue(address)})
-	                   .WithTTL(300)
-	                   ;
-	auto txtRecordset=Aws::Route53::Model::ResourceRecordSet()
-	                  .WithName(name)
-	                  .WithType(Aws::Route53::Model::RRType::TXT)
-	                  .WithResourceRecords({Aws::Route53::Model::ResourceRecord().WithValue('"'+heritageTag+'"')})
-	                  .WithTTL(300)
-	                  ;
-	auto result=
-	dnsClient.ChangeResourceRecordSets(Aws::Route53::Model::ChangeResourceRecordSetsRequest()
-	  .WithChangeBatch(Aws::Route53::Model::ChangeBatch().WithChanges(
-	  {Aws::Route53::Model::Change()
-	   .WithAction(Aws::Route53::Model::ChangeAction::DELETE_)
-	   .WithResourceRecordSet(mainRecordset),
-	   Aws::Route53::Model::Change()
-	   .WithAction(Aws::Route53::Model::ChangeAction::DELETE_)
-	   .WithResourceRecordSet(txtRecordset)
-	  }))
-	  .WithHostedZoneId(zoneIt->second));
-	if(!result.IsSuccess()){
-		log_error("Failed remove DNS records for " << name << ": "
-		  << std::to_string((int)result.GetError().GetErrorType()) << " "
-		  << result.GetError().GetExceptionName() << " "
-		  << result.GetError().GetMessage());
-		return false;
+	for(auto& item : changes){
+		for(auto& promise : item.second.results)
+			promise.set_value(results[item.first]);
 	}
-	return true;
-}
\ No newline at end of file
+}
+
+void DNSManipulator::work(){
+	std::unique_lock<std::mutex> lock(changeMut);
+	while(true){
+		if(pendingChanges.empty()){
+			flushRequested=false;
+			if(stopping)
+				return;
+			changeQueued.wait(lock);
+			continue;
+		}
+		//wait a short time for other changes to combine with the earliest
+		clock::time_point earliest=clock::time_point::max();
+		for(const auto& item : pendingChanges)
+			earliest=std::min(earliest,item.second.queued);
+		if(!stopping && !flushRequested && clock::now()<earliest+batchDelay){
+			changeQueued.wait_until(lock,earliest+batchDelay);
+			continue;
+		}
+		
+		std::map<std::string,PendingChange> changes;
+		changes.swap(pendingChanges);
+		flushRequested=false;
+		lock.unlock();
+		
+		std::map<std::string,std::map<std::string,PendingChange>> byZone;
+		for(auto& item : changes){
+			std::string zone;
+			try{
+				zone=zoneID(item.first);
+				if(zone.empty())
+					log_error("No hosted zone in this AWS account contains " << item.first);
+			}catch(std::exception& ex){
+				log_error("Unable to change DNS records for " << item.first << ": " << ex.what());
+			}
+			if(zone.empty()){
+				for(auto& promise : item.second.results)
+					promise.set_value(false);
+				continue;
+			}
+			byZone[zone].emplace(item.first,std::move(item.second));
+		}
+		for(auto& zone : byZone){
+			try{
+				submitChanges(zone.first,zone.second);
+			}catch(std::exception& ex){
+				log_error("Failed to change DNS records: " << ex.what());
+				for(auto& item : zone.second){
+					for(auto& promise : item.second.results){
+						try{
+							promise.set_value(false);
+						}catch(std::future_error&){ /*already set*/ }
+					}
+				}
+			}
+		}
+		
+		lock.lock();
+	}
+}
@@ -0,0 +1,349 @@
+#include <EmailClient.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <FileSystem.h>
+#include <HTTPRequests.h>
+#include <Logging.h>
+
+EmailClient::EmailClient(const std::string& mailgunEndpoint,
+			 const std::string& mailgunKey,
+			 const std::string& emailDomain) :
+	mailgunEndpoint(mailgunEndpoint),mailgunKey(mailgunKey),emailDomain(emailDomain)
+{
+	valid=!mailgunEndpoint.empty() && !mailgunKey.empty() && !emailDomain.empty();
+}
+
+bool EmailClient::sendEmail(const EmailClient::Email& email){
+	if (!valid) {
+		return false;
+	}
+	std::string url="https://api:"+mailgunKey+"@"+mailgunEndpoint+"/v3/"+emailDomain+"/messages";
+	std::multimap<std::string,std::string> data{
+		{"from",email.fromAddress},
+		{"subject",email.subject},
+		{"text",email.body}
+	};
+	for (const auto &to: email.toAddresses) {
+		data.emplace("to", to);
+	}
+	for (const auto &cc: email.ccAddresses) {
+		data.emplace("cc", cc);
+	}
+	for (const auto &bcc: email.bccAddresses) {
+		data.emplace("bcc", bcc);
+	}
+	auto response=httpRequests::httpPostForm(url,data);
+	if(response.status!=200){
+		log_warn("Failed to send email: " << response.body);
+		return false;
+	}
+	return true;
+}
+
+namespace{
+	///\return a key which is the same for messages with the same sender and
+	///        recipients
+	std::string recipientKey(const EmailClient::Email& email){
+		std::string key=email.fromAddress+'\n'+email.replyTo+'\n';
+		for(const auto* addresses : {&email.toAddresses,&email.ccAddresses,&email.bccAddresses}){
+			for(const auto& address : *addresses)
+				key+=address+',';
+			key+='\n';
+		}
+		return key;
+	}
+	
+	rapidjson::Value toJSON(const std::vector<std::string>& strings, rapidjson::Document::AllocatorType& alloc){
+		rapidjson::Value array(rapidjson::kArrayType);
+		for(const auto& str : strings)
+			array.PushBack(rapidjson::Value(str,alloc),alloc);
+		return array;
+	}
+	
+	std::vector<std::string> stringsFromJSON(const rapidjson::Value& value){
+		std::vector<std::string> strings;
+		if(!value.IsArray())
+			return strings;
+		for(const auto& item : value.GetArray()){
+			if(item.IsString())
+				strings.push_back(item.GetString());
+		}
+		return strings;
+	}
+	
+	std::string stringFromJSON(const rapidjson::Document& json, const char* name){
+		if(!json.HasMember(name) || !json[name].IsString())
+			return "";
+		return json[name].GetString();
+	}
+}
+
+EmailClient::Email combineEmails(const std::vector<EmailClient::Email>& emails){
+	if(emails.size()==1)
+		return emails.front();
+	EmailClient::Email combined=emails.front();
+	bool sameSubject=std::all_of(emails.begin(),emails.end(),
+		[&](const EmailClient::Email& email){ return email.subject==combined.subject; });
+	if(!sameSubject)
+		combined.subject+=" (and "+std::to_string(emails.size()-1)+" other notification"
+		                  +(emails.size()>2?"s":"")+")";
+	combined.body.clear();
+	for(const auto& email : emails){
+		if(!combined.body.empty())
+			combined.body+="\n\n----------\n\n";
+		if(!sameSubject)
+			combined.body+=email.subject+"\n\n";
+		combined.body+=email.body;
+	}
+	return combined;
+}
+
+EmailQueue::EmailQueue(std::function<bool(const Email&)> send, Options options):
+send(std::move(send)),
+options(std::move(options)),
+queued(0),
+sent(0),
+emailsSent(0),
+retried(0),
+failed(0),
+dropped(0),
+spoolCounter(0),
+stopping(false)
+{
+	if(!this->options.spoolDirectory.empty()){
+		try{
+			mkdir_p(this->options.spoolDirectory,0700);
+			loadSpool();
+		}catch(std::runtime_error& err){
+			log_error("Unable to use email spool directory " << this->options.spoolDirectory
+			          << ": " << err.what() << "; unsent email will be kept only in memory");
+		}
+	}
+	worker=std::thread(&EmailQueue::work,this);
+}
+
+EmailQueue::~EmailQueue(){
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		stopping=true;
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+bool EmailQueue::enqueue(Email email){
+	std::string spoolFile;
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		if(queued>=options.maxQueued){
+			dropped++;
+			log_warn("Discarding email \"" << email.subject << "\" because too many messages are waiting to be sent");
+			return false;
+		}
+		queued++;
+	}
+	//write the message out without holding the lock
+	if(!options.spoolDirectory.empty())
+		spoolFile=spool(email);
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		Pending item{std::move(email),1,{},0,clock::now()+options.batchDelay};
+		if(!spoolFile.empty())
+			item.spoolFiles.push_back(spoolFile);
+		pending.push_back(std::move(item));
+	}
+	changed.notify_one();
+	return true;
+}
+
+std::size_t EmailQueue::getQueueDepth() const{
+	std::lock_guard<std::mutex> lock(mut);
+	return queued;
+}
+
+std::string EmailQueue::getStatistics() const{
+	std::lock_guard<std::mutex> lock(mut);
+	std::ostringstream os;
+	os << "Email messages waiting: " << queued << "\n";
+	os << "Email messages sent: " << sent << "\n";
+	os << "Emails sent: " << emailsSent << "\n";
+	os << "Email retries: " << retried << "\n";
+	os << "Email messages failed: " << failed << "\n";
+	os << "Email messages discarded: " << dropped << "\n";
+	return os.str();
+}
+
+std::string EmailQueue::spool(const Email& email){
+	rapidjson::Document json(rapidjson::kObjectType);
+	auto& alloc=json.GetAllocator();
+	json.AddMember("from",rapidjson::Value(email.fromAddress,alloc),alloc);
+	json.AddMember("to",toJSON(email.toAddresses,alloc),alloc);
+	json.AddMember("cc",toJSON(email.ccAddresses,alloc),alloc);
+	json.AddMember("bcc",toJSON(email.bccAddresses,alloc),alloc);
+	json.AddMember("replyTo",rapidjson::Value(email.replyTo,alloc),alloc);
+	json.AddMember("subject",rapidjson::Value(email.subject,alloc),alloc);
+	json.AddMember("body",rapidjson::Value(email.body,alloc),alloc);
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	json.Accept(writer);
+	
+	unsigned long long counter;
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		counter=spoolCounter++;
+	}
+	//names sort in the order in which the messages were queued
+	char name[64];
+	snprintf(name,sizeof(name),"%020lld-%08llu",
+	         (long long)std::chrono::system_clock::now().time_since_epoch().count(),counter);
+	const std::string path=options.spoolDirectory+"/"+name+".json";
+	//write under a temporary name, so that a partly written file is never 
+	//mistaken for a message
+	const std::string tempPath=path+".tmp";
+	{
+		std::ofstream file(tempPath);
+		file << buffer.GetString();
+		if(!file){
+			log_warn("Failed to write email to spool file " << tempPath);
+			std::remove(tempPath.c_str());
+			return "";
+		}
+	}
+	if(std::rename(tempPath.c_str(),path.c_str())!=0){
+		log_warn("Failed to rename email spool file " << tempPath);
+		std::remove(tempPath.c_str());
+		return "";
+	}
+	return path;
+}
+
+void EmailQueue::loadSpool(){
+	std::vector<std::string> files;
+	for(const auto& entry : directory(options.spoolDirectory)){
+		if(!is_regular_file(entry))
+			continue;
+		if(entry.path().extension()=="json")
+			files.push_back(entry.path().str());
+		else if(entry.path().extension()=="tmp")
+			std::remove(entry.path().str().c_str());
+	}
+	std::sort(files.begin(),files.end());
+	
+	std::lock_guard<std::mutex> lock(mut);
+	for(const auto& path : files){
+		std::ifstream file(path);
+		std::stringstream contents;
+		contents << file.rdbuf();
+		rapidjson::Document json;
+		json.Parse(contents.str().c_str());
+		if(json.HasParseError() || !json.IsObject()){
+			log_warn("Discarding malformed email spool file " << path);
+			std::remove(path.c_str());
+			continue;
+		}
+		Email email;
+		email.fromAddress=stringFromJSON(json,"from");
+		if(json.HasMember("to"))
+			email.toAddresses=stringsFromJSON(json["to"]);
+		if(json.HasMember("cc"))
+			email.ccAddresses=stringsFromJSON(json["cc"]);
+		if(json.HasMember("bcc"))
+			email.bccAddresses=stringsFromJSON(json["bcc"]);
+		email.replyTo=stringFromJSON(json,"replyTo");
+		email.subject=stringFromJSON(json,"subject");
+		email.body=stringFromJSON(json,"body");
+		pending.push_back(Pending{std::move(email),1,{path},0,clock::now()+options.batchDelay});
+		queued++;
+	}
+	if(!files.empty())
+		log_info("Loaded " << pending.size() << " unsent email messages from " << options.spoolDirectory);
+}
+
+void EmailQueue::work(){
+	std::unique_lock<std::mutex> lock(mut);
+	while(true){
+		if(pending.empty()){
+			if(stopping)
+				return;
+			changed.wait(lock);
+			continue;
+		}
+		//When stopping, messages still waiting for others to be combined with 
+		//them are sent immediately, but messages waiting to be retried are 
+		//left in the spool for the next run
+		if(stopping){
+			pending.erase(std::remove_if(pending.begin(),pending.end(),
+			                             [](const Pending& p){ return p.attempts>0; }),pending.end());
+			if(pending.empty())
+				return;
+		}
+		auto next=std::min_element(pending.begin(),pending.end(),
+		                           [](const Pending& p1, const Pending& p2){ return p1.due<p2.due; });
+		if(!stopping && next->due>clock::now()){
+			changed.wait_until(lock,next->due);
+			continue;
+		}
+		
+		Pending item=std::move(*next);
+		pending.erase(next);
+		//combine any other new messages to the same recipients
+		if(item.attempts==0){
+			const std::string key=recipientKey(item.email);
+			std::vector<Email> batch{std::move(item.email)};
+			for(auto it=pending.begin(); it!=pending.end();){
+				if(it->attempts==0 && recipientKey(it->email)==key){
+					batch.push_back(std::move(it->email));
+					item.count+=it->count;
+					item.spoolFiles.insert(item.spoolFiles.end(),it->spoolFiles.begin(),it->spoolFiles.end());
+					it=pending.erase(it);
+				}
+				else
+					++it;
+			}
+			item.email=combineEmails(batch);
+		}
+		
+		lock.unlock();
+		bool success=false;
+		try{
+			success=send(item.email);
+		}catch(std::exception& ex){
+			log_warn("Failed to send email: " << ex.what());
+		}catch(...){
+			log_warn("Failed to send email");
+		}
+		bool finished=success || item.attempts+1>=options.maxAttempts;
+		if(finished){
+			for(const auto& path : item.spoolFiles)
+				std::remove(path.c_str());
+		}
+		lock.lock();
+		
+		item.attempts++;
+		if(success){
+			sent+=item.count;
+			emailsSent++;
+			queued-=item.count;
+		}
+		else if(finished){
+			failed+=item.count;
+			queued-=item.count;
+			log_error("Giving up on sending email \"" << item.email.subject << "\" after "
+			          << item.attempts << " attempts");
+		}
+		else{
+			retried++;
+			item.due=clock::now()+options.retryDelay*(1u<<std::min(item.attempts-1,16u));
+			pending.push_back(std::move(item));
+		}
+	}
+}
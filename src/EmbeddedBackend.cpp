@@ -0,0 +1,1170 @@
+#include "StorageBackend.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <aws/core/utils/json/JsonSerializer.h>
+
+#include "FileSystem.h"
+#include "Logging.h"
+
+using namespace Aws::DynamoDB::Model;
+using Aws::DynamoDB::DynamoDBErrors;
+using Aws::Utils::Json::JsonValue;
+using Aws::Utils::Json::JsonView;
+
+namespace{
+
+///An error to be reported to the caller as a DynamoDB error of the given type
+struct StorageError : public std::runtime_error{
+	StorageError(DynamoDBErrors type, std::string name, const std::string& message):
+	std::runtime_error(message),type(type),name(std::move(name)){}
+	DynamoDBErrors type;
+	std::string name;
+};
+
+StorageError validationError(const std::string& message){
+	return StorageError(DynamoDBErrors::VALIDATION,"ValidationException",message);
+}
+
+///Convert a caught error to an outcome of the appropriate type
+template<typename Outcome>
+Outcome failure(const StorageError& err){
+	using ErrorType=typename std::decay<decltype(std::declval<Outcome>().GetError())>::type;
+	return Outcome(ErrorType(Aws::Client::AWSError<DynamoDBErrors>(err.type,err.name,err.what(),false)));
+}
+
+template<typename Outcome>
+Outcome failure(const std::exception& err){
+	return failure<Outcome>(StorageError(DynamoDBErrors::INTERNAL_FAILURE,"InternalFailure",err.what()));
+}
+
+using Item=EmbeddedBackend::Item;
+using NameMap=Aws::Map<Aws::String,Aws::String>;
+using ValueMap=Aws::Map<Aws::String,AttributeValue>;
+
+std::string canonical(const AttributeValue& value){
+	return value.Jsonize().View().WriteCompact();
+}
+
+bool equal(const AttributeValue& v1, const AttributeValue& v2){
+	return canonical(v1)==canonical(v2);
+}
+
+///\return negative, zero, or positive as v1 orders before, with, or after v2
+int compare(const AttributeValue& v1, const AttributeValue& v2){
+	if(v1.GetType()!=v2.GetType())
+		throw validationError("Comparison of values of different types");
+	switch(v1.GetType()){
+		case ValueType::STRING:
+			return v1.GetS().compare(v2.GetS());
+		case ValueType::NUMBER:{
+			double n1=std::stod(v1.GetN()), n2=std::stod(v2.GetN());
+			return (n1<n2 ? -1 : (n1>n2 ? 1 : 0));
+		}
+		default:
+			throw validationError("Values of this type cannot be ordered");
+	}
+}
+
+struct Token{
+	enum Type{Path,Placeholder,Symbol,End} type;
+	std::string text;
+};
+
+std::vector<Token> tokenize(const std::string& expression){
+	std::vector<Token> tokens;
+	auto isWordChar=[](char c){ return std::isalnum(c) || c=='_' || c=='#' || c=='.'; };
+	std::size_t i=0;
+	while(i<expression.size()){
+		char c=expression[i];
+		if(std::isspace(c)){
+			i++;
+			continue;
+		}
+		if(c==':'){
+			std::size_t start=i++;
+			while(i<expression.size() && (std::isalnum(expression[i]) || expression[i]=='_'))
+				i++;
+			tokens.push_back(Token{Token::Placeholder,expression.substr(start,i-start)});
+		}
+		else if(isWordChar(c)){
+			std::size_t start=i;
+			while(i<expression.size() && isWordChar(expression[i]))
+				i++;
+			tokens.push_back(Token{Token::Path,expression.substr(start,i-start)});
+		}
+		else if(c=='<' || c=='>'){
+			std::size_t len=(i+1<expression.size() && (expression[i+1]=='=' || (c=='<' && expression[i+1]=='>'))) ? 2 : 1;
+			tokens.push_back(Token{Token::Symbol,expression.substr(i,len)});
+			i+=len;
+		}
+		else if(c=='(' || c==')' || c==',' || c=='='){
+			tokens.push_back(Token{Token::Symbol,std::string(1,c)});
+			i++;
+		}
+		else
+			throw validationError("Invalid character '"+std::string(1,c)+"' in expression: "+expression);
+	}
+	tokens.push_back(Token{Token::End,""});
+	return tokens;
+}
+
+bool isKeyword(const Token& token, const std::string& keyword){
+	if(token.type!=Token::Path || token.text.size()!=keyword.size())
+		return false;
+	for(std::size_t i=0; i<keyword.size(); i++){
+		if(std::toupper(token.text[i])!=keyword[i])
+			return false;
+	}
+	return true;
+}
+
+///Common state for interpreting an expression with its substitutions
+class ExpressionParser{
+public:
+	ExpressionParser(const std::string& expression, const NameMap& names, const ValueMap& values):
+	expression(expression),tokens(tokenize(expression)),pos(0),names(names),values(values){}
+
+protected:
+	const std::string& expression;
+	std::vector<Token> tokens;
+	std::size_t pos;
+	const NameMap& names;
+	const ValueMap& values;
+
+	const Token& peek() const{ return tokens[pos]; }
+	const Token& next(){
+		const Token& token=tokens[pos];
+		if(token.type!=Token::End)
+			pos++;
+		return token;
+	}
+	bool accept(const std::string& symbol){
+		if(peek().type==Token::Symbol && peek().text==symbol){
+			pos++;
+			return true;
+		}
+		return false;
+	}
+	void expect(const std::string& symbol){
+		if(!accept(symbol))
+			throw validationError("Expected '"+symbol+"' in expression: "+expression);
+	}
+
+	std::string resolveName(const Token& token) const{
+		if(token.type!=Token::Path)
+			throw validationError("Expected an attribute name in expression: "+expression);
+		if(token.text.find('.')!=std::string::npos)
+			throw validationError("Nested attribute paths are not supported: "+expression);
+		if(token.text[0]!='#')
+			return token.text;
+		auto it=names.find(token.text);
+		if(it==names.end())
+			throw validationError("Undefined attribute name "+token.text+" in expression: "+expression);
+		return it->second;
+	}
+	const AttributeValue& resolveValue(const Token& token) const{
+		auto it=values.find(token.text);
+		if(it==values.end())
+			throw validationError("Undefined attribute value "+token.text+" in expression: "+expression);
+		return it->second;
+	}
+	///\return the value of an operand, or null if it names a missing attribute
+	const AttributeValue* operand(const Item& item){
+		const Token& token=next();
+		if(token.type==Token::Placeholder)
+			return &resolveValue(token);
+		auto it=item.find(resolveName(token));
+		return (it==item.end() ? nullptr : &it->second);
+	}
+};
+
+///Evaluates condition, filter, and key condition expressions against an item
+class ConditionEvaluator : private ExpressionParser{
+public:
+	ConditionEvaluator(const std::string& expression, const NameMap& names, const ValueMap& values):
+	ExpressionParser(expression,names,values){}
+
+	bool evaluate(const Item& item){
+		pos=0;
+		bool result=disjunction(item);
+		if(peek().type!=Token::End)
+			throw validationError("Unexpected '"+peek().text+"' in expression: "+expression);
+		return result;
+	}
+
+	///Find the value to which an expression requires an attribute to be equal
+	std::string requiredValue(const std::string& attribute) const{
+		for(std::size_t i=0; i+2<tokens.size(); i++){
+			if(tokens[i].type==Token::Path && resolveName(tokens[i])==attribute
+			   && tokens[i+1].type==Token::Symbol && tokens[i+1].text=="="
+			   && tokens[i+2].type==Token::Placeholder)
+				return resolveValue(tokens[i+2]).GetS();
+		}
+		throw validationError("Query condition missed key schema element: "+attribute);
+	}
+
+private:
+	//Each level of the grammar evaluates both operands, so that syntax errors
+	//are detected regardless of the data.
+	bool disjunction(const Item& item){
+		bool result=conjunction(item);
+		while(isKeyword(peek(),"OR")){
+			next();
+			bool other=conjunction(item);
+			result=result || other;
+		}
+		return result;
+	}
+	bool conjunction(const Item& item){
+		bool result=negation(item);
+		while(isKeyword(peek(),"AND")){
+			next();
+			bool other=negation(item);
+			result=result && other;
+		}
+		return result;
+	}
+	bool negation(const Item& item){
+		if(isKeyword(peek(),"NOT")){
+			next();
+			return !negation(item);
+		}
+		return primary(item);
+	}
+	bool primary(const Item& item){
+		if(accept("(")){
+			bool result=disjunction(item);
+			expect(")");
+			return result;
+		}
+		if(peek().type==Token::Path && tokens[pos+1].type==Token::Symbol && tokens[pos+1].text=="(")
+			return function(item);
+		const AttributeValue* lhs=operand(item);
+		const Token& op=next();
+		if(op.type!=Token::Symbol)
+			throw validationError("Expected a comparison in expression: "+expression);
+		const AttributeValue* rhs=operand(item);
+		if(!lhs || !rhs)
+			return false;
+		if(op.text=="=")
+			return equal(*lhs,*rhs);
+		if(op.text=="<>")
+			return !equal(*lhs,*rhs);
+		int order=compare(*lhs,*rhs);
+		if(op.text=="<")
+			return order<0;
+		if(op.text=="<=")
+			return order<=0;
+		if(op.text==">")
+			return order>0;
+		if(op.text==">=")
+			return order>=0;
+		throw validationError("Unsupported comparison '"+op.text+"' in expression: "+expression);
+	}
+	bool function(const Item& item){
+		const std::string name=next().text;
+		expect("(");
+		bool result=false;
+		if(name=="attribute_exists" || name=="attribute_not_exists"){
+			bool exists=item.count(resolveName(next()));
+			result=(name=="attribute_exists" ? exists : !exists);
+		}
+		else if(name=="begins_with" || name=="contains"){
+			const AttributeValue* target=operand(item);
+			expect(",");
+			const AttributeValue* arg=operand(item);
+			if(target && arg){
+				if(name=="begins_with")
+					result=target->GetType()==ValueType::STRING && arg->GetType()==ValueType::STRING
+					       && target->GetS().compare(0,arg->GetS().size(),arg->GetS())==0;
+				else if(target->GetType()==ValueType::STRING)
+					result=arg->GetType()==ValueType::STRING && target->GetS().find(arg->GetS())!=std::string::npos;
+				else if(target->GetType()==ValueType::STRING_SET){
+					const auto& set=target->GetSS();
+					result=std::find(set.begin(),set.end(),arg->GetS())!=set.end();
+				}
+				else if(target->GetType()==ValueType::ATTRIBUTE_LIST){
+					for(const auto& element : target->GetL()){
+						if(equal(*element,*arg))
+							result=true;
+					}
+				}
+			}
+		}
+		else
+			throw validationError("Unsupported function "+name+" in expression: "+expression);
+		expect(")");
+		return result;
+	}
+};
+
+///Applies an update expression to an item
+class UpdateEvaluator : private ExpressionParser{
+public:
+	UpdateEvaluator(const std::string& expression, const NameMap& names, const ValueMap& values):
+	ExpressionParser(expression,names,values){}
+
+	void apply(Item& item){
+		pos=0;
+		//Values are read from the original item, as DynamoDB does
+		const Item original=item;
+		while(peek().type!=Token::End){
+			if(isKeyword(peek(),"SET")){
+				next();
+				do{
+					std::string target=resolveName(next());
+					expect("=");
+					const AttributeValue* value=operand(original);
+					if(!value)
+						throw validationError("The provided expression refers to an attribute that does not exist in the item");
+					item[target]=*value;
+				}while(accept(","));
+			}
+			else if(isKeyword(peek(),"REMOVE")){
+				next();
+				do{
+					item.erase(resolveName(next()));
+				}while(accept(","));
+			}
+			else
+				throw validationError("Unsupported update clause '"+peek().text+"' in expression: "+expression);
+		}
+	}
+};
+
+///Reduces items to the attributes listed in a projection expression
+class ProjectionEvaluator : private ExpressionParser{
+public:
+	ProjectionEvaluator(const std::string& expression, const NameMap& names):
+	ExpressionParser(expression,names,noValues()){
+		do{
+			attributes.push_back(resolveName(next()));
+		}while(accept(","));
+		if(peek().type!=Token::End)
+			throw validationError("Unexpected '"+peek().text+"' in projection expression: "+expression);
+	}
+
+	Item apply(const Item& item) const{
+		Item result;
+		for(const auto& name : attributes){
+			auto it=item.find(name);
+			if(it!=item.end())
+				result.insert(*it);
+		}
+		return result;
+	}
+
+private:
+	std::vector<std::string> attributes;
+
+	static const ValueMap& noValues(){
+		static const ValueMap empty;
+		return empty;
+	}
+};
+
+///Construct the projection for a request, if it has one
+template<typename Request>
+std::unique_ptr<ProjectionEvaluator> projectionFor(const Request& request){
+	if(!request.ProjectionExpressionHasBeenSet())
+		return nullptr;
+	return std::unique_ptr<ProjectionEvaluator>(new ProjectionEvaluator(request.GetProjectionExpression(),
+	                                                                    request.GetExpressionAttributeNames()));
+}
+
+///Whether a request's condition, if any, holds for an item
+template<typename Request>
+bool conditionHolds(const Request& request, const Item& item){
+	if(!request.ConditionExpressionHasBeenSet())
+		return true;
+	return ConditionEvaluator(request.GetConditionExpression(),request.GetExpressionAttributeNames(),
+	                          request.GetExpressionAttributeValues()).evaluate(item);
+}
+
+StorageError conditionFailed(){
+	return StorageError(DynamoDBErrors::CONDITIONAL_CHECK_FAILED,"ConditionalCheckFailedException","The conditional request failed");
+}
+
+JsonValue itemToJson(const Item& item){
+	JsonValue json;
+	for(const auto& attribute : item)
+		json.WithObject(attribute.first,attribute.second.Jsonize());
+	return json;
+}
+
+Item itemFromJson(const JsonView& json){
+	Item item;
+	for(const auto& attribute : json.GetAllObjects())
+		item.emplace(attribute.first,AttributeValue(attribute.second));
+	return item;
+}
+
+const std::string journalName="journal";
+
+void writeFully(int fd, const std::string& data){
+	std::size_t written=0;
+	while(written<data.size()){
+		ssize_t result=write(fd,data.c_str()+written,data.size()-written);
+		if(result<0){
+			if(errno==EINTR)
+				continue;
+			throw std::runtime_error("Failed to write storage journal: "+std::string(strerror(errno)));
+		}
+		written+=result;
+	}
+}
+
+void syncFully(int fd){
+	if(fdatasync(fd)!=0)
+		throw std::runtime_error("Failed to flush storage journal: "+std::string(strerror(errno)));
+}
+
+} //anonymous namespace
+
+EmbeddedBackend::EmbeddedBackend(const std::string& dataDirectory):
+dataDirectory(dataDirectory),journalFD(-1),lockFD(-1),journalRecords(0),
+journalWritten(0),journalSynced(0)
+{
+	if(dataDirectory.empty()){
+		log_info("Storing data in memory only");
+		return;
+	}
+	mkdir_p(dataDirectory,0700);
+	lockFD=open((dataDirectory+"/lock").c_str(),O_RDWR|O_CREAT|O_CLOEXEC,0600);
+	if(lockFD<0)
+		throw std::runtime_error("Unable to open lock file in "+dataDirectory+": "+strerror(errno));
+	if(flock(lockFD,LOCK_EX|LOCK_NB)!=0){
+		close(lockFD);
+		throw std::runtime_error("Data directory "+dataDirectory+" is in use by another process");
+	}
+
+	std::size_t replayed=0;
+	try{
+		std::ifstream journalFile(dataDirectory+"/"+journalName);
+		std::string line;
+		while(std::getline(journalFile,line)){
+			JsonValue record(line);
+			if(!record.WasParseSuccessful()){
+				//Only the last record can be incomplete, if the process stopped
+				//while writing it, and that operation was never reported to 
+				//succeed. Damage anywhere else must not be papered over, as 
+				//compaction would make the loss of the later records permanent. 
+				std::string rest;
+				while(std::getline(journalFile,rest)){
+					if(!rest.empty())
+						throw std::runtime_error("Storage journal in "+dataDirectory+" is corrupt at record "
+						                         +std::to_string(replayed+1));
+				}
+				log_warn("Discarding incomplete record at the end of the storage journal");
+				break;
+			}
+			replay(record.View());
+			replayed++;
+		}
+		journalFile.close();
+		removeExpiredItems();
+		compact();
+	}catch(...){
+		if(journalFD>=0)
+			close(journalFD);
+		close(lockFD);
+		throw;
+	}
+	log_info("Loaded " << replayed << " journal records from " << dataDirectory);
+}
+
+EmbeddedBackend::~EmbeddedBackend(){
+	if(journalFD>=0)
+		close(journalFD);
+	if(lockFD>=0)
+		close(lockFD);
+}
+
+EmbeddedBackend::Table& EmbeddedBackend::getTable(const std::string& name){
+	auto it=tables.find(name);
+	if(it==tables.end())
+		throw StorageError(DynamoDBErrors::RESOURCE_NOT_FOUND,"ResourceNotFoundException","Cannot do operations on a non-existent table");
+	return it->second;
+}
+
+EmbeddedBackend::Key EmbeddedBackend::itemKey(const Table& table, const Item& item){
+	auto hash=item.find(table.hashKey);
+	if(hash==item.end())
+		throw validationError("Missing the key "+table.hashKey+" in the item");
+	Key key(hash->second.GetS(),"");
+	if(!table.rangeKey.empty()){
+		auto range=item.find(table.rangeKey);
+		if(range==item.end())
+			throw validationError("Missing the key "+table.rangeKey+" in the item");
+		key.second=range->second.GetS();
+	}
+	return key;
+}
+
+namespace{
+	///Remove the index entries which point to an item
+	template<typename Indices>
+	void unindex(Indices& indices, const EmbeddedBackend::Key& key, const Item& item){
+		for(auto& index : indices){
+			auto attribute=item.find(index.second.hashKey);
+			if(attribute==item.end())
+				continue;
+			auto range=index.second.entries.equal_range(attribute->second.GetS());
+			for(auto it=range.first; it!=range.second; ++it){
+				if(it->second==key){
+					index.second.entries.erase(it);
+					break;
+				}
+			}
+		}
+	}
+	///Add index entries for an item
+	template<typename Indices>
+	void reindex(Indices& indices, const EmbeddedBackend::Key& key, const Item& item){
+		for(auto& index : indices){
+			auto attribute=item.find(index.second.hashKey);
+			if(attribute!=item.end())
+				index.second.entries.emplace(attribute->second.GetS(),key);
+		}
+	}
+}
+
+void EmbeddedBackend::storeItem(const std::string& tableName, Table& table, Item item, bool record){
+	Key key=itemKey(table,item);
+	if(record)
+		journal(JsonValue().WithString("op","put").WithString("table",tableName)
+		        .WithObject("item",itemToJson(item)));
+	auto existing=table.items.find(key);
+	if(existing!=table.items.end()){
+		unindex(table.indices,key,existing->second);
+		existing->second=std::move(item);
+		reindex(table.indices,key,existing->second);
+	}
+	else{
+		auto inserted=table.items.emplace(key,std::move(item)).first;
+		reindex(table.indices,key,inserted->second);
+	}
+	if(record)
+		maybeCompact();
+}
+
+void EmbeddedBackend::eraseItem(const std::string& tableName, Table& table, const Key& key, bool record){
+	auto existing=table.items.find(key);
+	if(existing==table.items.end())
+		return;
+	if(record)
+		journal(JsonValue().WithString("op","delete").WithString("table",tableName)
+		        .WithString("hash",key.first).WithString("range",key.second));
+	unindex(table.indices,key,existing->second);
+	table.items.erase(existing);
+	if(record)
+		maybeCompact();
+}
+
+void EmbeddedBackend::addIndex(Table& table, const GlobalSecondaryIndex& definition){
+	Index& index=table.indices[definition.GetIndexName()];
+	index=Index();
+	index.definition=definition;
+	for(const auto& element : definition.GetKeySchema()){
+		if(element.GetKeyType()==KeyType::HASH)
+			index.hashKey=element.GetAttributeName();
+		else
+			index.rangeKey=element.GetAttributeName();
+	}
+	for(const auto& entry : table.items){
+		auto attribute=entry.second.find(index.hashKey);
+		if(attribute!=entry.second.end())
+			index.entries.emplace(attribute->second.GetS(),entry.first);
+	}
+}
+
+void EmbeddedBackend::removeExpiredItems(){
+	const long long now=std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	for(auto& table : tables){
+		const std::string& attributeName=table.second.timeToLiveAttribute;
+		if(attributeName.empty())
+			continue;
+		std::vector<Key> expired;
+		for(const auto& entry : table.second.items){
+			auto attribute=entry.second.find(attributeName);
+			//like DynamoDB, ignore expiration times which are not numbers
+			if(attribute==entry.second.end() || attribute->second.GetType()!=ValueType::NUMBER)
+				continue;
+			try{
+				if(std::stoll(attribute->second.GetN())<now)
+					expired.push_back(entry.first);
+			}catch(std::exception&){}
+		}
+		//the journal is rewritten afterwards, so the removals need not be recorded
+		for(const auto& key : expired)
+			eraseItem(table.first,table.second,key,false);
+		if(!expired.empty())
+			log_info("Removed " << expired.size() << " expired items from " << table.first);
+	}
+}
+
+void EmbeddedBackend::replay(const JsonView& record){
+	const std::string op=record.GetString("op");
+	const std::string tableName=record.GetString("table");
+	if(op=="createTable"){
+		Table table;
+		auto keyData=record.GetArray("keySchema");
+		for(std::size_t i=0; i<keyData.GetLength(); i++){
+			KeySchemaElement kse(keyData[i]);
+			table.keySchema.push_back(kse);
+			if(kse.GetKeyType()==KeyType::HASH)
+				table.hashKey=kse.GetAttributeName();
+			else
+				table.rangeKey=kse.GetAttributeName();
+		}
+		auto attributeData=record.GetArray("attributes");
+		for(std::size_t i=0; i<attributeData.GetLength(); i++)
+			table.attributes.push_back(AttributeDefinition(attributeData[i]));
+		tables[tableName]=std::move(table);
+		return;
+	}
+	Table& table=getTable(tableName);
+	if(op=="deleteTable")
+		tables.erase(tableName);
+	else if(op=="createIndex")
+		addIndex(table,GlobalSecondaryIndex(record.GetObject("index")));
+	else if(op=="deleteIndex")
+		table.indices.erase(record.GetString("index"));
+	else if(op=="setTimeToLive")
+		table.timeToLiveAttribute=record.GetString("attribute");
+	else if(op=="put")
+		storeItem(tableName,table,itemFromJson(record.GetObject("item")),false);
+	else if(op=="delete")
+		eraseItem(tableName,table,Key(record.GetString("hash"),record.GetString("range")),false);
+	else
+		throw std::runtime_error("Unrecognized storage journal record: "+op);
+}
+
+namespace{
+	JsonValue createTableRecord(const std::string& name,
+	                            const Aws::Vector<KeySchemaElement>& keySchema,
+	                            const Aws::Vector<AttributeDefinition>& attributes){
+		Aws::Utils::Array<JsonValue> keyData(keySchema.size());
+		for(std::size_t i=0; i<keySchema.size(); i++)
+			keyData[i]=keySchema[i].Jsonize();
+		Aws::Utils::Array<JsonValue> attributeData(attributes.size());
+		for(std::size_t i=0; i<attributes.size(); i++)
+			attributeData[i]=attributes[i].Jsonize();
+		return JsonValue().WithString("op","createTable").WithString("table",name)
+		       .WithArray("keySchema",std::move(keyData))
+		       .WithArray("attributes",std::move(attributeData));
+	}
+
+	JsonValue createIndexRecord(const std::string& table, const GlobalSecondaryIndex& index){
+		return JsonValue().WithString("op","createIndex").WithString("table",table)
+		       .WithObject("index",index.Jsonize());
+	}
+
+	JsonValue timeToLiveRecord(const std::string& table, const std::string& attribute){
+		return JsonValue().WithString("op","setTimeToLive").WithString("table",table)
+		       .WithString("attribute",attribute);
+	}
+}
+
+void EmbeddedBackend::journal(const JsonValue& record){
+	if(journalFD<0)
+		return;
+	writeFully(journalFD,record.View().WriteCompact()+"\n");
+	journalRecords++;
+	journalWritten++;
+}
+
+void EmbeddedBackend::syncJournal(uint64_t written){
+	std::lock_guard<std::mutex> lock(syncMut);
+	//Another writer's flush may already have covered these records
+	if(journalFD<0 || journalSynced>=written)
+		return;
+	//Flush everything written so far, so that writers waiting for the lock 
+	//can share this flush
+	uint64_t target=journalWritten;
+	syncFully(journalFD);
+	journalSynced=target;
+}
+
+void EmbeddedBackend::maybeCompact(){
+	if(journalFD<0 || journalRecords<=1024)
+		return;
+	//Rewrite the journal once most of it describes data which no longer exists
+	std::size_t liveRecords=0;
+	for(const auto& table : tables)
+		liveRecords+=1+table.second.indices.size()+table.second.items.size();
+	if(journalRecords<=4*liveRecords)
+		return;
+	try{
+		compact();
+	}catch(std::exception& ex){
+		//The journal remains valid, if long, so this need not fail the
+		//operation which triggered it
+		log_error("Failed to compact storage journal: " << ex.what());
+	}
+}
+
+void EmbeddedBackend::compact(){
+	const std::string journalPath=dataDirectory+"/"+journalName;
+	const std::string tempPath=journalPath+".new";
+	int fd=open(tempPath.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0600);
+	if(fd<0)
+		throw std::runtime_error("Unable to create "+tempPath+": "+strerror(errno));
+	std::size_t records=0;
+	try{
+		std::string data;
+		auto append=[&](const JsonValue& record){
+			data+=record.View().WriteCompact();
+			data+='\n';
+			records++;
+		};
+		for(const auto& table : tables){
+			append(createTableRecord(table.first,table.second.keySchema,table.second.attributes));
+			for(const auto& index : table.second.indices)
+				append(createIndexRecord(table.first,index.second.definition));
+			if(!table.second.timeToLiveAttribute.empty())
+				append(timeToLiveRecord(table.first,table.second.timeToLiveAttribute));
+			for(const auto& item : table.second.items)
+				append(JsonValue().WithString("op","put").WithString("table",table.first)
+				       .WithObject("item",itemToJson(item.second)));
+		}
+		writeFully(fd,data);
+		syncFully(fd);
+	}catch(...){
+		close(fd);
+		unlink(tempPath.c_str());
+		throw;
+	}
+	close(fd);
+	if(rename(tempPath.c_str(),journalPath.c_str())!=0)
+		throw std::runtime_error("Unable to replace "+journalPath+": "+strerror(errno));
+	//Make the rename itself durable
+	int dirFD=open(dataDirectory.c_str(),O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	if(dirFD>=0){
+		fsync(dirFD);
+		close(dirFD);
+	}
+	//The new journal holds everything, already flushed, and flushes of the 
+	//old one must not use its descriptor while it is replaced
+	std::lock_guard<std::mutex> lock(syncMut);
+	if(journalFD>=0)
+		close(journalFD);
+	journalFD=open(journalPath.c_str(),O_WRONLY|O_APPEND|O_CLOEXEC);
+	if(journalFD<0)
+		throw std::runtime_error("Unable to open "+journalPath+": "+strerror(errno));
+	journalRecords=records;
+	journalSynced=journalWritten;
+}
+
+TableDescription EmbeddedBackend::describeTable(const std::string& name, const Table& table){
+	TableDescription desc=TableDescription()
+	                      .WithTableName(name)
+	                      .WithTableStatus(TableStatus::ACTIVE)
+	                      .WithKeySchema(table.keySchema)
+	                      .WithAttributeDefinitions(table.attributes)
+	                      .WithItemCount(table.items.size());
+	for(const auto& index : table.indices)
+		desc.AddGlobalSecondaryIndexes(GlobalSecondaryIndexDescription()
+		                               .WithIndexName(index.first)
+		                               .WithKeySchema(index.second.definition.GetKeySchema())
+		                               .WithProjection(index.second.definition.GetProjection())
+		                               .WithIndexStatus(IndexStatus::ACTIVE)
+		                               .WithItemCount(index.second.entries.size()));
+	return desc;
+}
+
+DescribeTableOutcome EmbeddedBackend::DescribeTable(const DescribeTableRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const Table& table=getTable(request.GetTableName());
+		return DescribeTableResult().WithTable(describeTable(request.GetTableName(),table));
+	}catch(StorageError& err){
+		return failure<DescribeTableOutcome>(err);
+	}catch(std::exception& err){
+		return failure<DescribeTableOutcome>(err);
+	}
+}
+
+CreateTableOutcome EmbeddedBackend::CreateTable(const CreateTableRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const std::string& name=request.GetTableName();
+		if(tables.count(name))
+			throw StorageError(DynamoDBErrors::RESOURCE_IN_USE,"ResourceInUseException","Cannot create preexisting table");
+		Table table;
+		table.keySchema=request.GetKeySchema();
+		table.attributes=request.GetAttributeDefinitions();
+		for(const auto& element : table.keySchema){
+			if(element.GetKeyType()==KeyType::HASH)
+				table.hashKey=element.GetAttributeName();
+			else
+				table.rangeKey=element.GetAttributeName();
+		}
+		if(table.hashKey.empty())
+			throw validationError("No hash key specified for table "+name);
+		journal(createTableRecord(name,table.keySchema,table.attributes));
+		for(const auto& index : request.GetGlobalSecondaryIndexes()){
+			journal(createIndexRecord(name,index));
+			addIndex(table,index);
+		}
+		Table& created=tables[name];
+		created=std::move(table);
+		//table changes are rare, so they need not avoid flushing under the lock
+		syncJournal(journalWritten);
+		return CreateTableResult().WithTableDescription(describeTable(name,created));
+	}catch(StorageError& err){
+		return failure<CreateTableOutcome>(err);
+	}catch(std::exception& err){
+		return failure<CreateTableOutcome>(err);
+	}
+}
+
+UpdateTableOutcome EmbeddedBackend::UpdateTable(const UpdateTableRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const std::string& name=request.GetTableName();
+		Table& table=getTable(name);
+		//Throughput and stream settings have no meaning here, so only index
+		//changes need to be applied
+		for(const auto& update : request.GetGlobalSecondaryIndexUpdates()){
+			if(update.CreateHasBeenSet()){
+				const CreateGlobalSecondaryIndexAction& action=update.GetCreate();
+				if(table.indices.count(action.GetIndexName()))
+					throw validationError("Index "+action.GetIndexName()+" already exists");
+				GlobalSecondaryIndex index=GlobalSecondaryIndex()
+				                           .WithIndexName(action.GetIndexName())
+				                           .WithKeySchema(action.GetKeySchema())
+				                           .WithProjection(action.GetProjection());
+				journal(createIndexRecord(name,index));
+				addIndex(table,index);
+			}
+			if(update.DeleteHasBeenSet()){
+				const std::string& indexName=update.GetDelete().GetIndexName();
+				if(!table.indices.count(indexName))
+					throw StorageError(DynamoDBErrors::RESOURCE_NOT_FOUND,"ResourceNotFoundException","Requested resource not found: Index: "+indexName);
+				journal(JsonValue().WithString("op","deleteIndex").WithString("table",name)
+				        .WithString("index",indexName));
+				table.indices.erase(indexName);
+			}
+		}
+		syncJournal(journalWritten);
+		return UpdateTableResult().WithTableDescription(describeTable(name,table));
+	}catch(StorageError& err){
+		return failure<UpdateTableOutcome>(err);
+	}catch(std::exception& err){
+		return failure<UpdateTableOutcome>(err);
+	}
+}
+
+DeleteTableOutcome EmbeddedBackend::DeleteTable(const DeleteTableRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const std::string& name=request.GetTableName();
+		Table& table=getTable(name);
+		TableDescription desc=describeTable(name,table);
+		journal(JsonValue().WithString("op","deleteTable").WithString("table",name));
+		tables.erase(name);
+		syncJournal(journalWritten);
+		return DeleteTableResult().WithTableDescription(desc);
+	}catch(StorageError& err){
+		return failure<DeleteTableOutcome>(err);
+	}catch(std::exception& err){
+		return failure<DeleteTableOutcome>(err);
+	}
+}
+
+DescribeTimeToLiveOutcome EmbeddedBackend::DescribeTimeToLive(const DescribeTimeToLiveRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const Table& table=getTable(request.GetTableName());
+		TimeToLiveDescription desc;
+		if(table.timeToLiveAttribute.empty())
+			desc.SetTimeToLiveStatus(TimeToLiveStatus::DISABLED);
+		else{
+			desc.SetTimeToLiveStatus(TimeToLiveStatus::ENABLED);
+			desc.SetAttributeName(table.timeToLiveAttribute);
+		}
+		return DescribeTimeToLiveResult().WithTimeToLiveDescription(desc);
+	}catch(StorageError& err){
+		return failure<DescribeTimeToLiveOutcome>(err);
+	}catch(std::exception& err){
+		return failure<DescribeTimeToLiveOutcome>(err);
+	}
+}
+
+UpdateTimeToLiveOutcome EmbeddedBackend::UpdateTimeToLive(const UpdateTimeToLiveRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const std::string& name=request.GetTableName();
+		Table& table=getTable(name);
+		const TimeToLiveSpecification& spec=request.GetTimeToLiveSpecification();
+		if(spec.GetAttributeName().empty())
+			throw validationError("No attribute name specified for time to live");
+		std::string attribute=(spec.GetEnabled() ? spec.GetAttributeName() : "");
+		if(attribute==table.timeToLiveAttribute)
+			throw validationError(std::string("TimeToLive is already ")+(spec.GetEnabled()?"enabled":"disabled"));
+		journal(timeToLiveRecord(name,attribute));
+		table.timeToLiveAttribute=attribute;
+		syncJournal(journalWritten);
+		return UpdateTimeToLiveResult().WithTimeToLiveSpecification(spec);
+	}catch(StorageError& err){
+		return failure<UpdateTimeToLiveOutcome>(err);
+	}catch(std::exception& err){
+		return failure<UpdateTimeToLiveOutcome>(err);
+	}
+}
+
+GetItemOutcome EmbeddedBackend::GetItem(const GetItemRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const Table& table=getTable(request.GetTableName());
+		auto projection=projectionFor(request);
+		GetItemResult result;
+		auto it=table.items.find(itemKey(table,request.GetKey()));
+		if(it!=table.items.end())
+			result.SetItem(projection ? projection->apply(it->second) : it->second);
+		return result;
+	}catch(StorageError& err){
+		return failure<GetItemOutcome>(err);
+	}catch(std::exception& err){
+		return failure<GetItemOutcome>(err);
+	}
+}
+
+PutItemOutcome EmbeddedBackend::PutItem(const PutItemRequest& request){
+	try{
+		uint64_t written;
+		{
+			std::lock_guard<std::mutex> lock(mut);
+			Table& table=getTable(request.GetTableName());
+			const Item& item=request.GetItem();
+			auto existing=table.items.find(itemKey(table,item));
+			if(!conditionHolds(request,existing==table.items.end() ? Item() : existing->second))
+				throw conditionFailed();
+			storeItem(request.GetTableName(),table,item);
+			written=journalWritten;
+		}
+		syncJournal(written);
+		return PutItemResult();
+	}catch(StorageError& err){
+		return failure<PutItemOutcome>(err);
+	}catch(std::exception& err){
+		return failure<PutItemOutcome>(err);
+	}
+}
+
+UpdateItemOutcome EmbeddedBackend::UpdateItem(const UpdateItemRequest& request){
+	try{
+		uint64_t written;
+		{
+			std::lock_guard<std::mutex> lock(mut);
+			Table& table=getTable(request.GetTableName());
+			const Key key=itemKey(table,request.GetKey());
+			auto existing=table.items.find(key);
+			//Like DynamoDB, updating a nonexistent item creates it
+			Item item=(existing==table.items.end() ? request.GetKey() : existing->second);
+			if(!conditionHolds(request,existing==table.items.end() ? Item() : existing->second))
+				throw conditionFailed();
+			if(request.UpdateExpressionHasBeenSet())
+				UpdateEvaluator(request.GetUpdateExpression(),request.GetExpressionAttributeNames(),
+				                request.GetExpressionAttributeValues()).apply(item);
+			for(const auto& update : request.GetAttributeUpdates()){
+				switch(update.second.GetAction()){
+					case AttributeAction::DELETE_:
+						if(!update.second.ValueHasBeenSet()){
+							item.erase(update.first);
+							break;
+						}
+						//fall through
+					case AttributeAction::ADD:
+						throw validationError("Only PUT and DELETE without a value are supported for attribute updates");
+					default:
+						item[update.first]=update.second.GetValue();
+				}
+			}
+			if(itemKey(table,item)!=key)
+				throw validationError("Cannot update attribute "+table.hashKey+". This attribute is part of the key");
+			storeItem(request.GetTableName(),table,std::move(item));
+			written=journalWritten;
+		}
+		syncJournal(written);
+		return UpdateItemResult();
+	}catch(StorageError& err){
+		return failure<UpdateItemOutcome>(err);
+	}catch(std::exception& err){
+		return failure<UpdateItemOutcome>(err);
+	}
+}
+
+DeleteItemOutcome EmbeddedBackend::DeleteItem(const DeleteItemRequest& request){
+	try{
+		uint64_t written;
+		{
+			std::lock_guard<std::mutex> lock(mut);
+			Table& table=getTable(request.GetTableName());
+			const Key key=itemKey(table,request.GetKey());
+			auto existing=table.items.find(key);
+			if(!conditionHolds(request,existing==table.items.end() ? Item() : existing->second))
+				throw conditionFailed();
+			eraseItem(request.GetTableName(),table,key);
+			written=journalWritten;
+		}
+		syncJournal(written);
+		return DeleteItemResult();
+	}catch(StorageError& err){
+		return failure<DeleteItemOutcome>(err);
+	}catch(std::exception& err){
+		return failure<DeleteItemOutcome>(err);
+	}
+}
+
+namespace{
+	///Reduce an item to the attributes projected into an index
+	Item project(const Item& item, const std::string& tableHash, const std::string& tableRange,
+	             const std::string& indexHash, const std::string& indexRange, const Projection& projection){
+		if(projection.GetProjectionType()==ProjectionType::ALL)
+			return item;
+		Item result;
+		auto copy=[&](const std::string& name){
+			auto it=item.find(name);
+			if(it!=item.end())
+				result.insert(*it);
+		};
+		for(const auto& name : {tableHash,tableRange,indexHash,indexRange})
+			copy(name);
+		if(projection.GetProjectionType()==ProjectionType::INCLUDE){
+			for(const auto& name : projection.GetNonKeyAttributes())
+				copy(name);
+		}
+		return result;
+	}
+}
+
+QueryOutcome EmbeddedBackend::Query(const QueryRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const Table& table=getTable(request.GetTableName());
+		ConditionEvaluator keyCondition(request.GetKeyConditionExpression(),
+		                                request.GetExpressionAttributeNames(),
+		                                request.GetExpressionAttributeValues());
+		std::unique_ptr<ConditionEvaluator> filter;
+		if(request.FilterExpressionHasBeenSet())
+			filter.reset(new ConditionEvaluator(request.GetFilterExpression(),
+			                                    request.GetExpressionAttributeNames(),
+			                                    request.GetExpressionAttributeValues()));
+		auto projection=projectionFor(request);
+		Aws::Vector<Item> items;
+		int scanned=0;
+		auto consider=[&](const Item& item)->bool{
+			if(!keyCondition.evaluate(item))
+				return false;
+			scanned++;
+			return !filter || filter->evaluate(item);
+		};
+		if(request.IndexNameHasBeenSet()){
+			auto indexIt=table.indices.find(request.GetIndexName());
+			if(indexIt==table.indices.end())
+				throw validationError("The table does not have the specified index: "+request.GetIndexName());
+			const Index& index=indexIt->second;
+			auto range=index.entries.equal_range(keyCondition.requiredValue(index.hashKey));
+			for(auto it=range.first; it!=range.second; ++it){
+				const Item& item=table.items.find(it->second)->second;
+				if(consider(item))
+					items.push_back(project(item,table.hashKey,table.rangeKey,index.hashKey,
+					                        index.rangeKey,index.definition.GetProjection()));
+			}
+		}
+		else{
+			const std::string hashValue=keyCondition.requiredValue(table.hashKey);
+			for(auto it=table.items.lower_bound(Key(hashValue,""));
+			    it!=table.items.end() && it->first.first==hashValue; ++it){
+				if(consider(it->second))
+					items.push_back(it->second);
+			}
+		}
+		if(projection){
+			for(auto& item : items)
+				item=projection->apply(item);
+		}
+		QueryResult result;
+		result.SetCount(items.size());
+		result.SetScannedCount(scanned);
+		result.SetItems(std::move(items));
+		return result;
+	}catch(StorageError& err){
+		return failure<QueryOutcome>(err);
+	}catch(std::exception& err){
+		return failure<QueryOutcome>(err);
+	}
+}
+
+ScanOutcome EmbeddedBackend::Scan(const ScanRequest& request){
+	try{
+		std::lock_guard<std::mutex> lock(mut);
+		const Table& table=getTable(request.GetTableName());
+		std::unique_ptr<ConditionEvaluator> filter;
+		if(request.FilterExpressionHasBeenSet())
+			filter.reset(new ConditionEvaluator(request.GetFilterExpression(),
+			                                    request.GetExpressionAttributeNames(),
+			                                    request.GetExpressionAttributeValues()));
+		const Index* index=nullptr;
+		if(request.IndexNameHasBeenSet()){
+			auto indexIt=table.indices.find(request.GetIndexName());
+			if(indexIt==table.indices.end())
+				throw validationError("The table does not have the specified index: "+request.GetIndexName());
+			index=&indexIt->second;
+		}
+		auto projection=projectionFor(request);
+		Aws::Vector<Item> items;
+		int scanned=0;
+		//Everything is returned in a single page, so no LastEvaluatedKey is
+		//ever set and ExclusiveStartKey need not be considered
+		for(const auto& entry : table.items){
+			const Item& item=entry.second;
+			if(index && !item.count(index->hashKey))
+				continue;
+			scanned++;
+			if(filter && !filter->evaluate(item))
+				continue;
+			if(projection)
+				items.push_back(projection->apply(index ? project(item,table.hashKey,table.rangeKey,index->hashKey,
+				                                                  index->rangeKey,index->definition.GetProjection())
+				                                        : item));
+			else if(index)
+				items.push_back(project(item,table.hashKey,table.rangeKey,index->hashKey,
+				                        index->rangeKey,index->definition.GetProjection()));
+			else if(request.AttributesToGetHasBeenSet()){
+				Item selected;
+				for(const auto& name : request.GetAttributesToGet()){
+					auto it=item.find(name);
+					if(it!=item.end())
+						selected.insert(*it);
+				}
+				items.push_back(std::move(selected));
+			}
+			else
+				items.push_back(item);
+		}
+		ScanResult result;
+		result.SetCount(items.size());
+		result.SetScannedCount(scanned);
+		result.SetItems(std::move(items));
+		return result;
+	}catch(StorageError& err){
+		return failure<ScanOutcome>(err);
+	}catch(std::exception& err){
+		return failure<ScanOutcome>(err);
+	}
+}
@@ -0,0 +1,352 @@
+#include "EventStream.h"
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "ChangeFeedCommands.h"
+#include "Logging.h"
+#include "ServerUtilities.h"
+
+namespace{
+	///The user authenticated by the most recent call to accept on this thread.
+	///crow calls the open handler immediately after the accept handler, on the
+	///same thread, but does not pass the request to the former.
+	thread_local User acceptedUser;
+	///The groups of acceptedUser
+	thread_local std::set<std::string> acceptedGroups;
+
+	std::string eventMessage(const ChangeEvent& event){
+		rapidjson::Document result(rapidjson::kObjectType);
+		rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
+		result.AddMember("apiVersion", "v1alpha3", alloc);
+		result.AddMember("kind", "Event", alloc);
+		rapidjson::Value metadata(rapidjson::kObjectType);
+		metadata.AddMember("revision", event.revision, alloc);
+		metadata.AddMember("kind", to_string(event.collection), alloc);
+		metadata.AddMember("id", event.id, alloc);
+		metadata.AddMember("operation", to_string(event.operation), alloc);
+		result.AddMember("metadata", metadata, alloc);
+		return to_string(result);
+	}
+
+	std::string revisionMessage(const std::string& kind, const std::string& epoch, uint64_t revision){
+		rapidjson::Document result(rapidjson::kObjectType);
+		rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
+		result.AddMember("apiVersion", "v1alpha3", alloc);
+		result.AddMember("kind", kind, alloc);
+		rapidjson::Value metadata(rapidjson::kObjectType);
+		metadata.AddMember("epoch", epoch, alloc);
+		metadata.AddMember("revision", revision, alloc);
+		result.AddMember("metadata", metadata, alloc);
+		return to_string(result);
+	}
+}
+
+EventStream::EventStream(PersistentStore& store, std::size_t window, std::size_t queueLimit,
+                         std::size_t writeLimit):
+store(store),window(window),queueLimit(queueLimit),writeLimit(writeLimit),
+dispatchedRevision(store.getChangeLog().currentRevision()),stop(false){
+	if(window==0)
+		throw std::logic_error("Event window must be positive");
+	dispatcher=std::thread(&EventStream::dispatch,this);
+}
+
+EventStream::~EventStream(){
+	stop=true;
+	dispatcher.join();
+}
+
+bool EventStream::accept(const crow::request& req){
+	acceptedUser=authenticateUser(store, req.url_params.get("token"));
+	log_info(acceptedUser << " requested to open an event stream from " << req.remote_endpoint);
+	if(!acceptedUser){
+		log_error("User not authorized");
+		return false;
+	}
+	acceptedGroups=lookupGroups(acceptedUser);
+	return true;
+}
+
+void EventStream::open(crow::websocket::connection& conn){
+	Subscriber sub;
+	sub.user=std::move(acceptedUser);
+	acceptedUser=User();
+	sub.groups=std::move(acceptedGroups);
+	acceptedGroups.clear();
+	sub.alive=std::make_shared<bool>(true);
+	std::lock_guard<std::mutex> lock(mut);
+	subscribers.emplace(&conn,std::move(sub));
+}
+
+void EventStream::close(crow::websocket::connection& conn){
+	std::lock_guard<std::mutex> lock(mut);
+	auto it=subscribers.find(&conn);
+	if(it==subscribers.end())
+		return;
+	//crow destroys the connection once this returns
+	*it->second.alive=false;
+	subscribers.erase(it);
+}
+
+std::size_t EventStream::clientCount() const{
+	std::lock_guard<std::mutex> lock(mut);
+	return subscribers.size();
+}
+
+void EventStream::message(crow::websocket::connection& conn, const std::string& data, bool binary){
+	User user;
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		auto it=subscribers.find(&conn);
+		if(it==subscribers.end())
+			return;
+		user=it->second.user;
+	}
+
+	rapidjson::Document request;
+	request.Parse(data.c_str());
+	if(binary || request.HasParseError() || !request.IsObject()
+	   || !request.HasMember("action") || !request["action"].IsString()){
+		conn.send_text(generateError("Messages must be JSON objects with a string member named 'action'"));
+		return;
+	}
+	const std::string action=request["action"].GetString();
+
+	if(action=="ack"){
+		if(!request.HasMember("revision") || !request["revision"].IsUint64()){
+			conn.send_text(generateError("Acknowledgements must include the revision"));
+			return;
+		}
+		uint64_t revision=request["revision"].GetUint64();
+		std::lock_guard<std::mutex> lock(mut);
+		auto it=subscribers.find(&conn);
+		if(it==subscribers.end())
+			return;
+		Subscriber& sub=it->second;
+		while(!sub.unacknowledged.empty() && sub.unacknowledged.front()<=revision)
+			sub.unacknowledged.pop_front();
+		flush(conn,sub);
+		return;
+	}
+
+	if(action!="subscribe" && action!="unsubscribe"){
+		conn.send_text(generateError("Unrecognized action: "+action));
+		return;
+	}
+	//Resolve names to IDs and refresh the user's group memberships before 
+	//taking the lock, as this may require contacting the database
+	std::set<std::string> ids;
+	bool all=false;
+	std::string err=resolveSubscriptions(request,ids,all);
+	if(!err.empty()){
+		conn.send_text(generateError(err));
+		return;
+	}
+	std::set<std::string> groups;
+	if(action=="subscribe")
+		groups=lookupGroups(user);
+
+	std::lock_guard<std::mutex> lock(mut);
+	auto it=subscribers.find(&conn);
+	if(it==subscribers.end())
+		return;
+	Subscriber& sub=it->second;
+	if(action=="subscribe"){
+		sub.groups=std::move(groups);
+		sub.subscriptions.insert(ids.begin(),ids.end());
+		sub.all|=all;
+		log_info(user << " subscribed to " << ids.size() << " record(s)" << (all ? " and all changes" : ""));
+	}
+	else{
+		for(const auto& id : ids)
+			sub.subscriptions.erase(id);
+		if(all)
+			sub.all=false;
+	}
+	//Tell the client the revision from which it will receive events, so that
+	//it can list the records of interest and then rely on events
+	conn.send_text(revisionMessage("Subscription",store.getGenerationEpoch(),dispatchedRevision));
+}
+
+std::string EventStream::resolveSubscriptions(const rapidjson::Document& request,
+                                              std::set<std::string>& ids, bool& all){
+	for(const char* field : {"groups","clusters","instances"}){
+		if(!request.HasMember(field))
+			continue;
+		if(!request[field].IsArray())
+			return std::string("Subscription field '")+field+"' must be an array";
+		for(const auto& entry : request[field].GetArray()){
+			if(!entry.IsString())
+				return std::string("Subscription field '")+field+"' must contain only strings";
+			const std::string name=entry.GetString();
+			if(name=="*"){
+				all=true;
+				continue;
+			}
+			std::string id;
+			if(field==std::string("groups"))
+				id=store.getGroup(name).id;
+			else if(field==std::string("clusters"))
+				id=store.getCluster(name).id;
+			else{
+				ApplicationInstance instance=store.getApplicationInstance(name);
+				if(instance)
+					id=instance.id;
+			}
+			if(id.empty())
+				return "Not found: "+name;
+			ids.insert(id);
+		}
+	}
+	return "";
+}
+
+std::set<std::string> EventStream::lookupGroups(const User& user){
+	if(user.admin)
+		return {};
+	auto groups=store.getUserGroupMemberships(user.id);
+	return std::set<std::string>(groups.begin(),groups.end());
+}
+
+bool EventStream::matches(const Subscriber& sub, const ChangeEvent& event) const{
+	if(!mayObserveChange(sub.user, sub.groups, event))
+		return false;
+	if(sub.all || sub.subscriptions.count(event.id))
+		return true;
+	for(const auto& scope : event.scopes){
+		if(sub.subscriptions.count(scope))
+			return true;
+	}
+	return false;
+}
+
+void EventStream::deliver(crow::websocket::connection& conn, Subscriber& sub, const ChangeEvent& event){
+	if(sub.overflowed)
+		return; //the client will resynchronize anyway
+	sub.pending.push_back(event);
+	if(sub.pending.size()>queueLimit){
+		log_warn(sub.user << " is not keeping up with its event stream; dropping "
+		         << sub.pending.size() << " queued events");
+		sub.pending.clear();
+		sub.overflowed=true;
+	}
+	schedule(conn,sub);
+}
+
+void EventStream::schedule(crow::websocket::connection& conn, Subscriber& sub){
+	if(sub.flushPosted)
+		return;
+	sub.flushPosted=true;
+	crow::websocket::connection* connPtr=&conn;
+	std::shared_ptr<bool> alive=sub.alive;
+	conn.post_task([this,connPtr,alive]{
+		//the connection is closed on this thread, so if it is still alive 
+		//now it cannot be destroyed while this runs
+		if(!*alive)
+			return;
+		std::lock_guard<std::mutex> lock(mut);
+		auto it=subscribers.find(connPtr);
+		if(it==subscribers.end())
+			return;
+		it->second.flushPosted=false;
+		flush(*connPtr,it->second);
+	});
+}
+
+void EventStream::flush(crow::websocket::connection& conn, Subscriber& sub){
+	//Events are held back while the connection has too much unwritten data, 
+	//so that a client which is not reading fills its queue and is told to 
+	//resynchronize rather than growing the connection's write buffer
+	while(sub.unacknowledged.size()<window && !sub.pending.empty()
+	      && conn.unsent_bytes()<writeLimit){
+		const ChangeEvent& event=sub.pending.front();
+		conn.send_text(eventMessage(event));
+		sub.unacknowledged.push_back(event.revision);
+		sub.pending.pop_front();
+	}
+	if(sub.overflowed && sub.pending.empty() && sub.unacknowledged.size()<window
+	   && conn.unsent_bytes()<writeLimit){
+		conn.send_text(revisionMessage("Resync",store.getGenerationEpoch(),dispatchedRevision));
+		sub.overflowed=false;
+	}
+}
+
+void EventStream::resynchronizeAll(){
+	for(auto& entry : subscribers){
+		entry.second.pending.clear();
+		entry.second.overflowed=true;
+		schedule(*entry.first,entry.second);
+	}
+}
+
+void EventStream::dispatch(){
+	const ChangeLog& changeLog=store.getChangeLog();
+	uint64_t revision=dispatchedRevision;
+	std::string epoch=store.getGenerationEpoch();
+	while(!stop){
+		//The store begins a new epoch when it may have missed changes, so 
+		//clients must re-list everything
+		std::string currentEpoch=store.getGenerationEpoch();
+		if(currentEpoch!=epoch){
+			epoch=currentEpoch;
+			log_warn("Store data was discarded; all event stream clients must resynchronize");
+			std::lock_guard<std::mutex> lock(mut);
+			resynchronizeAll();
+		}
+		if(!changeLog.waitForChanges(revision,std::chrono::seconds(1))){
+			//Retry sending events held back because connections' write 
+			//buffers were full, as nothing else will prompt it until the 
+			//clients acknowledge events or new changes arrive
+			std::lock_guard<std::mutex> lock(mut);
+			for(auto& entry : subscribers){
+				if(!entry.second.pending.empty() || entry.second.overflowed)
+					schedule(*entry.first,entry.second);
+			}
+			continue;
+		}
+		bool complete=false;
+		std::vector<ChangeEvent> changes=changeLog.changesSince(revision,complete);
+		revision=(changes.empty() ? changeLog.currentRevision() : changes.back().revision);
+		
+		//Membership changes are recorded as changes to users, so refresh 
+		//the groups of any affected subscribers before filtering, looking 
+		//them up without holding the lock
+		std::set<std::string> changedUsers;
+		for(const ChangeEvent& change : changes){
+			if(change.collection==StoreCollection::Users)
+				changedUsers.insert(change.id);
+		}
+		std::map<std::string,std::set<std::string>> memberships;
+		if(!changedUsers.empty()){
+			std::map<std::string,User> affected;
+			{
+				std::lock_guard<std::mutex> lock(mut);
+				for(const auto& entry : subscribers){
+					if(changedUsers.count(entry.second.user.id))
+						affected.emplace(entry.second.user.id,entry.second.user);
+				}
+			}
+			for(const auto& entry : affected)
+				memberships[entry.first]=lookupGroups(entry.second);
+		}
+
+		std::lock_guard<std::mutex> lock(mut);
+		dispatchedRevision=revision;
+		for(auto& entry : subscribers){
+			auto updated=memberships.find(entry.second.user.id);
+			if(updated!=memberships.end())
+				entry.second.groups=updated->second;
+		}
+		if(!complete){
+			log_warn("Event stream fell behind the change log; all clients must resynchronize");
+			resynchronizeAll();
+			continue;
+		}
+		for(const ChangeEvent& change : changes){
+			for(auto& entry : subscribers){
+				if(matches(entry.second,change))
+					deliver(*entry.first,entry.second,change);
+			}
+		}
+	}
+}
@@ -2,11 +2,19 @@
 
 #include <cerrno>
 #include <cstring>
+#include <fstream>
 #include <stdexcept>
 
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 FileHandle::~FileHandle(){
+	if(fd!=-1){ //anonymous file, which goes away once no longer open
+		close(fd);
+		return;
+	}
 	if(!filePath.empty()){
 		if(!isDirectory){ //regular file
 			int err=remove(filePath.c_str());
@@ -60,3 +68,45 @@ FileHandle makeTemporaryDir(const std::string& nameBase){
 	}
 	return FileHandle(dirPath,true);
 }
+
+namespace{
+	bool writeAll(int fd, const std::string& data){
+		std::size_t written=0;
+		while(written<data.size()){
+			ssize_t result=write(fd,data.data()+written,data.size()-written);
+			if(result<0){
+				if(errno==EINTR)
+					continue;
+				return false;
+			}
+			written+=result;
+		}
+		return true;
+	}
+}
+
+FileHandle makeMemoryFile(const std::string& nameBase, const std::string& contents){
+#if defined(__linux__) && defined(SYS_memfd_create)
+	//the name is only a label, so drop any leading directories
+	std::string name=nameBase.substr(nameBase.rfind('/')+1);
+	//use the system call directly, since the glibc wrapper is fairly recent
+	const unsigned int closeOnExec=1; //MFD_CLOEXEC
+	int fd=syscall(SYS_memfd_create,name.c_str(),closeOnExec);
+	if(fd!=-1){
+		FileHandle handle(fd,"/proc/"+std::to_string(getpid())+"/fd/"+std::to_string(fd));
+		if(!writeAll(fd,contents)){
+			int err=errno;
+			throw std::runtime_error("Writing in-memory file failed with error "+std::to_string(err));
+		}
+		return handle;
+	}
+	//otherwise, the kernel is too old, so fall back to a regular file
+#endif
+	FileHandle handle=makeTemporaryFile(nameBase);
+	std::ofstream file(handle.path());
+	file << contents;
+	file.close();
+	if(file.fail())
+		throw std::runtime_error("Writing temporary file "+handle.path()+" failed");
+	return handle;
+}
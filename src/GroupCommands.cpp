@@ -104,13 +104,7 @@ namespace{
 crow::response listGroups(PersistentStore& store, const crow::request& req){
 	using namespace std::chrono;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -119,7 +113,6 @@ crow::response listGroups(PersistentStore& store, const crow::request& req){
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -132,6 +125,7 @@ crow::response listGroups(PersistentStore& store, const crow::request& req){
 	} else {
 		vos = store.listGroups();
 	}
+	const FieldSelection fields(req);
 
 	rapidjson::Document result(rapidjson::kObjectType);
 	rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
@@ -152,24 +146,25 @@ crow::response listGroups(PersistentStore& store, const crow::request& req){
 		groupResult.AddMember("apiVersion", "v1alpha3", alloc);
 		groupResult.AddMember("kind", "Group", alloc);
 		groupResult.AddMember("metadata", metadata, alloc);
+		fields.apply(groupResult);
 		resultItems.PushBack(groupResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
 	
 	high_resolution_clock::time_point t2 = high_resolution_clock::now();
 	log_info("group listing completed in " << duration_cast<duration<double>>(t2-t1).count() << " seconds");
-	span->End();
 	return crow::response(to_string(result));
 }
 
+std::string listGroupsETag(PersistentStore& store, const crow::request& req){
+	//changes to group memberships also update the group generation, which 
+	//covers listing only the requesting user's groups
+	return makeETag(store.getETagEpoch(), req.raw_url,
+	                {store.getGeneration(StoreCollection::Groups)});
+}
+
 crow::response createGroup(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -177,7 +172,6 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -190,72 +184,61 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 		body.Parse(req.body.c_str());
 	} catch(std::runtime_error& err) {
 		setWebSpanError(span, std::string("Invalid JSON in body, exception: ") + err.what(), 400);
-		span->End();
 		return crow::response(400,generateError("Invalid JSON in request body"));
 	}
 
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("metadata")) {
 		const std::string& errMsg = "Missing user metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for configuration";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	
 	if(!body["metadata"].HasMember("name")) {
 		const std::string& errMsg = "Missing Group name in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["name"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group name";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	
 	if(body["metadata"].HasMember("email") && !body["metadata"]["email"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group email";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body["metadata"].HasMember("phone") && !body["metadata"]["phone"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group phone";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	
 	if(!body["metadata"].HasMember("scienceField")) {
 		const std::string &errMsg = "Missing Group scienceField in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["scienceField"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group scienceField";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 		
 	if(body["metadata"].HasMember("description") && !body["metadata"]["description"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group description";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	
@@ -266,37 +249,31 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 	if(group.name.empty()) {
 		const std::string& errMsg = "Group names may not be the empty string";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!validTagGroupName(group.name)) {
 		const std::string& errMsg = "Group names may only contain [a-z], [0-9] and -";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(group.name.back()=='-') {
 		const std::string& errMsg = "Group names may not end with a dash";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(group.name.size()>54) {
 		const std::string& errMsg = "Group names may not be more than 54 characters long";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(group.name.find(IDGenerator::groupIDPrefix)==0) {
 		const std::string& errMsg = "Group names may not begin with " + IDGenerator::groupIDPrefix;
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(store.findGroupByName(group.name)) {
 		const std::string& errMsg = "Group name is already in use";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 
@@ -326,7 +303,6 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 	if(group.scienceField.empty()) {
 		const std::string& errMsg = "Unrecognized value for Group scienceField";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError("Unrecognized value for Group scienceField\n"
 		                                         "See http://slateci.io/docs/science-fields for a list of accepted values"));
 	}
@@ -346,7 +322,6 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 	if(!created) {
 		const std::string& errMsg = "Group creation failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500, generateError("Group creation failed"));
 	}
 	
@@ -361,7 +336,6 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 		log_error(problem);
 		const std::string& errMsg = problem;
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(500,generateError(problem));
 	}
 	
@@ -381,18 +355,11 @@ crow::response createGroup(PersistentStore& store, const crow::request& req){
 	metadata.AddMember("description", rapidjson::StringRef(group.description.c_str()), alloc);
 	result.AddMember("metadata", metadata, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response getGroupInfo(PersistentStore& store, const crow::request& req, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -401,7 +368,6 @@ crow::response getGroupInfo(PersistentStore& store, const crow::request& req, co
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -411,7 +377,6 @@ crow::response getGroupInfo(PersistentStore& store, const crow::request& req, co
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 	span->SetAttribute("group", group.name);
@@ -429,19 +394,21 @@ crow::response getGroupInfo(PersistentStore& store, const crow::request& req, co
 	metadata.AddMember("description", rapidjson::StringRef(group.description.c_str()), alloc);
 	result.AddMember("kind", "Group", alloc);
 	result.AddMember("metadata", metadata, alloc);
+	FieldSelection(req).apply(result);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
+std::string getGroupInfoETag(PersistentStore& store, const crow::request& req, const std::string& groupID){
+	const Group group=store.getGroup(groupID);
+	if(!group)
+		return "";
+	return makeETag(store.getETagEpoch(), req.raw_url,
+	                {store.getGeneration(StoreCollection::Groups, group.id)});
+}
+
 crow::response updateGroup(PersistentStore& store, const crow::request& req, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -450,7 +417,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -458,7 +424,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 	if(!user.admin && !store.userInGroup(user.id,groupID)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -467,7 +432,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 	if(!targetGroup) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 	span->SetAttribute("group", targetGroup.name);
@@ -479,25 +443,21 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("metadata")) {
 		const std::string& errMsg = "Missing Group metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for metadata";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 		
@@ -506,7 +466,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 		if(!body["metadata"]["email"].IsString()) {
 			const std::string& errMsg = "Incorrect type for email";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		targetGroup.email=body["metadata"]["email"].GetString();
@@ -516,7 +475,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 		if(!body["metadata"]["phone"].IsString()) {
 			const std::string& errMsg = "Incorrect type for phone";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		targetGroup.phone=body["metadata"]["phone"].GetString();
@@ -526,14 +484,12 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 		if(!body["metadata"]["scienceField"].IsString()) {
 			const std::string& errMsg = "Incorrect type for scienceField";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		targetGroup.scienceField=normalizeScienceField(body["metadata"]["scienceField"].GetString());
 		if(targetGroup.scienceField.empty()) {
 			const std::string& errMsg = "Unrecognized value for Group scienceField";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		doUpdate=true;
@@ -542,7 +498,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 		if(!body["metadata"]["description"].IsString()) {
 			const std::string& errMsg = "Incorrect type for description";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		targetGroup.description=body["metadata"]["description"].GetString();
@@ -551,7 +506,6 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 	
 	if(!doUpdate){
 		log_info("Requested update to " << targetGroup << " is trivial");
-		span->End();
 		return(crow::response(200));
 	}
 	
@@ -562,22 +516,14 @@ crow::response updateGroup(PersistentStore& store, const crow::request& req, con
 		std::ostringstream errMsg;
 		errMsg << "Failed to update " << targetGroup;
 		setWebSpanError(span, errMsg.str(), 500);
-		span->End();
 		return crow::response(500, generateError(errMsg.str()));
 	}
 
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response deleteGroup(PersistentStore& store, const crow::request& req, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -586,7 +532,6 @@ crow::response deleteGroup(PersistentStore& store, const crow::request& req, con
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -595,7 +540,6 @@ crow::response deleteGroup(PersistentStore& store, const crow::request& req, con
 	if(!targetGroup) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 	span->SetAttribute("group", targetGroup.name);
@@ -604,7 +548,6 @@ crow::response deleteGroup(PersistentStore& store, const crow::request& req, con
 	if(!user.admin && !store.userInGroup(user.id,groupID)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -615,7 +558,6 @@ crow::response deleteGroup(PersistentStore& store, const crow::request& req, con
 	if (!deleted) {
 		const std::string& errMsg = "Group deletion failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500, generateError(errMsg));
 	}
 	
@@ -669,18 +611,11 @@ crow::response deleteGroup(PersistentStore& store, const crow::request& req, con
 		item.wait();
 	}
 
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response listGroupMembers(PersistentStore& store, const crow::request& req, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -688,7 +623,6 @@ crow::response listGroupMembers(PersistentStore& store, const crow::request& req
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -697,7 +631,6 @@ crow::response listGroupMembers(PersistentStore& store, const crow::request& req
 	if(!targetGroup) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -706,7 +639,6 @@ crow::response listGroupMembers(PersistentStore& store, const crow::request& req
 	if(!user.admin && !store.userInGroup(user.id,targetGroup.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -734,18 +666,11 @@ crow::response listGroupMembers(PersistentStore& store, const crow::request& req
 		resultItems.PushBack(userResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response listGroupClusters(PersistentStore& store, const crow::request& req, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -753,7 +678,6 @@ crow::response listGroupClusters(PersistentStore& store, const crow::request& re
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -762,7 +686,6 @@ crow::response listGroupClusters(PersistentStore& store, const crow::request& re
 	if(!targetGroup) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -792,6 +715,5 @@ crow::response listGroupClusters(PersistentStore& store, const crow::request& re
 		resultItems.PushBack(clusterResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
@@ -1,9 +1,12 @@
 #include <cassert>
+#include <cctype>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <curl/curl.h>
 
@@ -13,6 +16,9 @@
 #if CURL_AT_LEAST_VERSION(7, 56, 0)
 #define CURL_MIME_INIT_AVAIL 1
 #endif
+#if CURL_AT_LEAST_VERSION(7, 47, 0)
+#define CURL_HTTP2_TLS_AVAIL 1
+#endif
 #endif
 
 namespace httpRequests{
@@ -27,6 +33,39 @@ namespace httpRequests{
 			std::string context;
 		};
 
+		///Callback function for collecting response headers from libcurl, and only to be called by libcurl.
+		///See https://curl.haxx.se/libcurl/c/CURLOPT_HEADERFUNCTION.html
+		///\param buffer the header line being provided by libcurl
+		///\param size the size of each 'item' of available data
+		///\param nitems the number of 'items' in the available data
+		///\param userp pointer to the map in which headers are to be collected
+		size_t collectCurlHeader(char* buffer, size_t size, size_t nitems, void* userp){
+			auto& headers=*static_cast<std::map<std::string,std::string>*>(userp);
+			try{
+				std::string line(buffer,size*nitems);
+				auto colon=line.find(':');
+				if(colon==std::string::npos){
+					//a status line starts a new response, possibly after a 
+					//redirect, so forget any earlier headers
+					if(line.compare(0,5,"HTTP/")==0)
+						headers.clear();
+					return size*nitems;
+				}
+				std::string name=line.substr(0,colon);
+				for(auto& c : name)
+					c=std::tolower((unsigned char)c);
+				auto start=line.find_first_not_of(" \t",colon+1);
+				auto end=line.find_last_not_of(" \t\r\n");
+				if(start!=std::string::npos && end!=std::string::npos && end>=start)
+					headers[name]=line.substr(start,end+1-start);
+				else
+					headers[name]="";
+			}catch(...){
+				return(size*nitems?0:1); //return a different number to indicate error
+			}
+			return size*nitems;
+		}
+
 		///Helper data used for sending input data to libcurl
 		struct CurlInputData{
 			///Stream containing data to be given to libcurl
@@ -96,6 +135,100 @@ namespace httpRequests{
 			}
 		}
 
+		///Keeps curl handles alive between requests, so that later requests 
+		///to the same server can reuse an existing connection instead of 
+		///repeating DNS resolution and TCP and TLS setup. All handles also 
+		///share a DNS cache and TLS session cache, so that even a new 
+		///connection can usually resume an earlier TLS session. 
+		class SessionPool{
+		public:
+			SessionPool():share(curl_share_init()){
+				if(!share)
+					return;
+				curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &SessionPool::lock);
+				curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &SessionPool::unlock);
+				curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+				curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+				curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+				//curl does not support sharing the connection cache among 
+				//concurrent threads, so connections are instead kept with 
+				//the idle handles
+			}
+			
+			///Get a handle which is ready to have a request's options set
+			CURL* acquire(){
+				CURL* handle=nullptr;
+				{
+					std::lock_guard<std::mutex> guard(idleMutex);
+					if(!idle.empty()){
+						handle=idle.back();
+						idle.pop_back();
+					}
+				}
+				if(!handle)
+					handle=curl_easy_init();
+				if(!handle)
+					throw std::runtime_error("Failed to allocate curl session");
+				if(share)
+					curl_easy_setopt(handle, CURLOPT_SHARE, share);
+#ifdef CURL_HTTP2_TLS_AVAIL
+				//use HTTP/2 when the server offers it during the TLS handshake
+				curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+#endif
+				return handle;
+			}
+			
+			///Return a handle to the pool once its request is complete
+			void release(CURL* handle){
+				//Clear all options, which may point to data which will no 
+				//longer exist, while keeping the handle's open connections.
+				curl_easy_reset(handle);
+				std::unique_lock<std::mutex> guard(idleMutex);
+				if(idle.size()<maxIdle){
+					idle.push_back(handle);
+					return;
+				}
+				guard.unlock();
+				curl_easy_cleanup(handle);
+			}
+			
+		private:
+			///The maximum number of handles kept when not in use
+			static const std::size_t maxIdle=16;
+			
+			CURLSH* share;
+			std::mutex shareMutexes[CURL_LOCK_DATA_LAST];
+			std::mutex idleMutex;
+			std::vector<CURL*> idle;
+			
+			static void lock(CURL*, curl_lock_data data, curl_lock_access, void* userp){
+				static_cast<SessionPool*>(userp)->shareMutexes[data].lock();
+			}
+			static void unlock(CURL*, curl_lock_data data, void* userp){
+				static_cast<SessionPool*>(userp)->shareMutexes[data].unlock();
+			}
+		};
+		
+		SessionPool& sessionPool(){
+			//This is deliberately never destroyed, since requests may still 
+			//be running on other threads while the program exits. 
+			static SessionPool* pool=new SessionPool;
+			return *pool;
+		}
+		
+		///An RAII object which borrows a handle from the session pool for the
+		///duration of one request
+		class PooledSession{
+		public:
+			PooledSession():handle(sessionPool().acquire()){}
+			~PooledSession(){ sessionPool().release(handle); }
+			PooledSession(const PooledSession&)=delete;
+			PooledSession& operator=(const PooledSession&)=delete;
+			CURL* get() const{ return handle; }
+		private:
+			CURL* handle;
+		};
+
 	} //namespace detail
 
 	Response httpGet(const std::string& url, const Options& options){
@@ -104,7 +237,7 @@ namespace httpRequests{
 		CURLcode err;
 		std::unique_ptr<char[]> errBuf(new char[CURL_ERROR_SIZE]);
 		errBuf[0]=0;
-		std::unique_ptr<CURL,void (*)(CURL*)> curlSession(curl_easy_init(),curl_easy_cleanup);
+		detail::PooledSession curlSession;
 		using detail::reportCurlError;
 
 		err=curl_easy_setopt(curlSession.get(), CURLOPT_ERRORBUFFER, errBuf.get());
@@ -139,6 +272,24 @@ namespace httpRequests{
 		if (err != CURLE_OK) {
 			detail::reportCurlError("Failed to set curl max redirects", err, errBuf.get());
 		}
+		std::map<std::string,std::string> responseHeaders;
+		err=curl_easy_setopt(curlSession.get(), CURLOPT_HEADERFUNCTION, detail::collectCurlHeader);
+		if (err != CURLE_OK) {
+			detail::reportCurlError("Failed to set curl header callback", err, errBuf.get());
+		}
+		err=curl_easy_setopt(curlSession.get(), CURLOPT_HEADERDATA, &responseHeaders);
+		if (err != CURLE_OK) {
+			detail::reportCurlError("Failed to set curl header callback data", err, errBuf.get());
+		}
+		std::unique_ptr<curl_slist,void (*)(curl_slist*)> headerList(nullptr,curl_slist_free_all);
+		for(const auto& header : options.headers)
+			headerList.reset(curl_slist_append(headerList.release(),(header.first+": "+header.second).c_str()));
+		if(headerList){
+			err=curl_easy_setopt(curlSession.get(), CURLOPT_HTTPHEADER, headerList.get());
+			if (err != CURLE_OK) {
+				detail::reportCurlError("Failed to set request headers", err, errBuf.get());
+			}
+		}
 		if(!options.caBundlePath.empty()){
 			err=curl_easy_setopt(curlSession.get(), CURLOPT_CAINFO, options.caBundlePath.c_str());
 			if (err != CURLE_OK) {
@@ -157,7 +308,7 @@ namespace httpRequests{
 		}
 		assert(code>=0);
 
-		return Response{(unsigned int)code,data.output};
+		return Response{(unsigned int)code,data.output,std::move(responseHeaders)};
 	}
 
 	Response httpDelete(const std::string& url, const Options& options){
@@ -166,7 +317,7 @@ namespace httpRequests{
 		CURLcode err;
 		std::unique_ptr<char[]> errBuf(new char[CURL_ERROR_SIZE]);
 		errBuf[0]=0;
-		std::unique_ptr<CURL,void (*)(CURL*)> curlSession(curl_easy_init(),curl_easy_cleanup);
+		detail::PooledSession curlSession;
 		using detail::reportCurlError;
 
 		err=curl_easy_setopt(curlSession.get(), CURLOPT_ERRORBUFFER, errBuf.get());
@@ -207,7 +358,7 @@ namespace httpRequests{
 		}
 		assert(code>=0);
 
-		return Response{(unsigned int)code,data.output};
+		return Response{(unsigned int)code,data.output,{}};
 	}
 
 	Response httpPut(const std::string& url, const std::string& body,
@@ -219,7 +370,7 @@ namespace httpRequests{
 		CURLcode err;
 		std::unique_ptr<char[]> errBuf(new char[CURL_ERROR_SIZE]);
 		errBuf[0]=0;
-		std::unique_ptr<CURL,void (*)(CURL*)> curlSession(curl_easy_init(),curl_easy_cleanup);
+		detail::PooledSession curlSession;
 		using detail::reportCurlError;
 
 		err=curl_easy_setopt(curlSession.get(), CURLOPT_ERRORBUFFER, errBuf.get());
@@ -279,7 +430,7 @@ namespace httpRequests{
 		}
 		assert(code>=0);
 
-		return Response{(unsigned int)code,output.output};
+		return Response{(unsigned int)code,output.output,{}};
 	}
 
 	Response httpPost(const std::string& url, const std::string& body,
@@ -290,7 +441,7 @@ namespace httpRequests{
 		CURLcode err;
 		std::unique_ptr<char[]> errBuf(new char[CURL_ERROR_SIZE]);
 		errBuf[0]=0;
-		std::unique_ptr<CURL,void (*)(CURL*)> curlSession(curl_easy_init(),curl_easy_cleanup);
+		detail::PooledSession curlSession;
 		using detail::reportCurlError;
 
 		err=curl_easy_setopt(curlSession.get(), CURLOPT_ERRORBUFFER, errBuf.get());
@@ -342,7 +493,7 @@ namespace httpRequests{
 		}
 		assert(code>=0);
 
-		return Response{(unsigned int)code,output.output};
+		return Response{(unsigned int)code,output.output,{}};
 	}
 
 	Response httpPostForm(const std::string& url,
@@ -353,7 +504,7 @@ namespace httpRequests{
 		CURLcode err;
 		std::unique_ptr<char[]> errBuf(new char[CURL_ERROR_SIZE]);
 		errBuf[0] = 0;
-		std::unique_ptr<CURL, void (*)(CURL *)> curlSession(curl_easy_init(), curl_easy_cleanup);
+		detail::PooledSession curlSession;
 		using detail::reportCurlError;
 
 		err = curl_easy_setopt(curlSession.get(), CURLOPT_ERRORBUFFER, errBuf.get());
@@ -425,7 +576,25 @@ namespace httpRequests{
 		}
 		assert(code>=0);
 
-		return Response{(unsigned int)code,output.output};
+		return Response{(unsigned int)code,output.output,{}};
+	}
+
+	std::future<Response> httpGetAsync(const std::string& url, const Options& options){
+		return std::async(std::launch::async,[=]{ return httpGet(url,options); });
+	}
+
+	std::future<Response> httpDeleteAsync(const std::string& url, const Options& options){
+		return std::async(std::launch::async,[=]{ return httpDelete(url,options); });
+	}
+
+	std::future<Response> httpPutAsync(const std::string& url, const std::string& body,
+	                                   const Options& options){
+		return std::async(std::launch::async,[=]{ return httpPut(url,body,options); });
+	}
+
+	std::future<Response> httpPostAsync(const std::string& url, const std::string& body,
+	                                    const Options& options){
+		return std::async(std::launch::async,[=]{ return httpPost(url,body,options); });
 	}
 
 #ifdef SLATE_EXTRACT_HOSTNAME_AVAIL
@@ -0,0 +1,199 @@
+#include "JSONExtractor.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "rapidjson/error/en.h"
+#include "rapidjson/reader.h"
+
+using rapidjson::SizeType;
+
+std::vector<std::string> splitJSONPointer(const std::string& path){
+	std::vector<std::string> components;
+	if(path.empty())
+		return components;
+	if(path.front()!='/')
+		throw std::runtime_error("JSON path must begin with '/': "+path);
+	std::size_t start=1;
+	while(true){
+		std::size_t end=path.find('/',start);
+		std::string component=path.substr(start,end==std::string::npos ? std::string::npos : end-start);
+		//undo JSON pointer escaping
+		for(std::size_t pos=component.find('~'); pos!=std::string::npos; pos=component.find('~',pos+1)){
+			if(pos+1<component.size() && component[pos+1]=='1')
+				component.replace(pos,2,"/");
+			else if(pos+1<component.size() && component[pos+1]=='0')
+				component.replace(pos,2,"~");
+		}
+		components.push_back(std::move(component));
+		if(end==std::string::npos)
+			break;
+		start=end+1;
+	}
+	return components;
+}
+
+JSONExtractor::JSONExtractor(const std::vector<std::string>& paths){
+	this->paths.reserve(paths.size());
+	for(const auto& path : paths)
+		this->paths.push_back(splitJSONPointer(path));
+}
+
+///Passes on only the SAX events for the selected parts of a document
+template<typename Handler>
+class JSONExtractor::Filter{
+public:
+	Filter(const std::vector<std::vector<std::string>>& paths, Handler& out):
+	paths(paths),out(out),skipDepth(0){}
+
+	bool Null(){ return scalar([this]{ return out.Null(); }); }
+	bool Bool(bool b){ return scalar([=]{ return out.Bool(b); }); }
+	bool Int(int i){ return scalar([=]{ return out.Int(i); }); }
+	bool Uint(unsigned int u){ return scalar([=]{ return out.Uint(u); }); }
+	bool Int64(int64_t i){ return scalar([=]{ return out.Int64(i); }); }
+	bool Uint64(uint64_t u){ return scalar([=]{ return out.Uint64(u); }); }
+	bool Double(double d){ return scalar([=]{ return out.Double(d); }); }
+	bool RawNumber(const char* str, SizeType length, bool){
+		return scalar([=]{ return out.RawNumber(str,length,true); });
+	}
+	bool String(const char* str, SizeType length, bool){
+		return scalar([=]{ return out.String(str,length,true); });
+	}
+
+	bool Key(const char* str, SizeType length, bool){
+		if(!skipDepth)
+			frames.back().key.assign(str,length);
+		return true;
+	}
+
+	bool StartObject(){ return open(false); }
+	bool EndObject(SizeType){ return close(); }
+	bool StartArray(){ return open(true); }
+	bool EndArray(SizeType){ return close(); }
+
+private:
+	///An object or array which is being kept
+	struct Frame{
+		bool array;
+		///Whether everything within this container is kept
+		bool captured;
+		///The paths which this container's position matches so far
+		std::vector<std::size_t> candidates;
+		///The index of the next element, for an array
+		SizeType nextIndex;
+		///The key of the member being read, for an object
+		std::string key;
+		///The number of members or elements passed on so far
+		SizeType kept;
+	};
+
+	const std::vector<std::vector<std::string>>& paths;
+	Handler& out;
+	std::vector<Frame> frames;
+	///The nesting depth within a container which is being skipped
+	std::size_t skipDepth;
+
+	///Determine whether the value about to be read should be kept, either
+	///entirely, or only for some parts within it
+	void select(bool& captured, std::vector<std::size_t>& candidates){
+		captured=false;
+		candidates.clear();
+		if(frames.empty()){ //the root is always kept
+			for(std::size_t i=0; i<paths.size(); i++){
+				candidates.push_back(i);
+				if(paths[i].empty())
+					captured=true;
+			}
+			return;
+		}
+		Frame& parent=frames.back();
+		std::string index;
+		if(parent.array)
+			index=std::to_string(parent.nextIndex++);
+		if(parent.captured){
+			captured=true;
+			return;
+		}
+		const std::string& component=(parent.array ? index : parent.key);
+		const std::size_t depth=frames.size()-1;
+		for(std::size_t i : parent.candidates){
+			const std::vector<std::string>& path=paths[i];
+			if(path[depth]!="*" && path[depth]!=component)
+				continue;
+			if(path.size()==depth+1)
+				captured=true;
+			else
+				candidates.push_back(i);
+		}
+	}
+
+	///Pass on the key of the member being kept, if it is in an object
+	bool keep(){
+		if(frames.empty())
+			return true;
+		Frame& parent=frames.back();
+		parent.kept++;
+		if(parent.array)
+			return true;
+		return out.Key(parent.key.data(),(SizeType)parent.key.size(),true);
+	}
+
+	template<typename Emit>
+	bool scalar(Emit emit){
+		if(skipDepth)
+			return true;
+		bool captured;
+		std::vector<std::size_t> candidates;
+		select(captured,candidates);
+		if(!captured && !frames.empty())
+			return true;
+		return keep() && emit();
+	}
+
+	bool open(bool array){
+		if(skipDepth){
+			skipDepth++;
+			return true;
+		}
+		Frame frame;
+		select(frame.captured,frame.candidates);
+		if(!frame.captured && frame.candidates.empty() && !frames.empty()){
+			skipDepth=1;
+			return true;
+		}
+		if(!keep())
+			return false;
+		frame.array=array;
+		frame.nextIndex=0;
+		frame.kept=0;
+		frames.push_back(std::move(frame));
+		return (array ? out.StartArray() : out.StartObject());
+	}
+
+	bool close(){
+		if(skipDepth){
+			skipDepth--;
+			return true;
+		}
+		Frame& frame=frames.back();
+		bool array=frame.array;
+		SizeType kept=frame.kept;
+		frames.pop_back();
+		return (array ? out.EndArray(kept) : out.EndObject(kept));
+	}
+};
+
+void JSONExtractor::parseInsitu(std::string& json, rapidjson::Document& result) const{
+	rapidjson::ParseResult parseResult;
+	auto generate=[&](rapidjson::Document& handler)->bool{
+		Filter<rapidjson::Document> filter(paths,handler);
+		rapidjson::InsituStringStream stream(&json[0]);
+		rapidjson::Reader reader;
+		parseResult=reader.Parse<rapidjson::kParseInsituFlag>(stream,filter);
+		return !parseResult.IsError();
+	};
+	result.Populate(generate);
+	if(parseResult.IsError())
+		throw std::runtime_error(std::string("Invalid JSON: ")+rapidjson::GetParseError_En(parseResult.Code())
+		                         +" at offset "+std::to_string(parseResult.Offset()));
+}
@@ -15,16 +15,46 @@
 #endif
 
 namespace kubernetes{
+
+namespace{
+///Installed during static initialization so that every program which runs 
+///kubectl or helm has some protection against commands which hang or produce
+///unbounded output
+const bool defaultLimitsSet=(setCommandLimits(commandLimits(std::chrono::minutes(5),64UL<<20)),true);
+
+///Note in a command's error output if it was cut short by its limits, since 
+///callers generally report only the error output
+void describeLimitsExceeded(const std::string& command, commandResult& result){
+	if(result.timedOut)
+		result.error+="\n"+command+" was stopped after exceeding its time limit";
+	if(result.truncated)
+		result.error+="\nSome of the output of "+command+" was discarded for exceeding the size limit";
+}
+}
+
+void setCommandLimits(const commandLimits& limits){
+	setDefaultCommandLimits("kubectl",limits);
+	setDefaultCommandLimits("helm",limits);
+}
+
+#ifdef SLATE_SERVER
+namespace{
+///Reconstruct a command line for display in a trace
+std::string formatCommandLine(const std::string& command, const std::vector<std::string>& arguments){
+	std::string line=command;
+	for (const auto& arg : arguments) {
+		line+=' ';
+		line+=arg;
+	}
+	return line;
+}
+}
+#endif
 	
 commandResult kubectl(const std::string& configPath,
 		      const std::vector<std::string>& arguments) {
 #ifdef SLATE_SERVER
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("kubectl", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("kubectl");
 #endif
 	std::vector<std::string> fullArgs;
 	fullArgs.push_back("--request-timeout=10s");
@@ -32,45 +62,30 @@ commandResult kubectl(const std::string& configPath,
 		fullArgs.push_back("--kubeconfig=" + configPath);
 	}
 	std::copy(arguments.begin(),arguments.end(),std::back_inserter(fullArgs));
-	std::ostringstream cmd;
-	cmd << "kubectl";
-	for (std::vector<std::string>::const_iterator i = fullArgs.begin(); i != fullArgs.end(); ++i ) {
-		cmd << " " << *i;
-	}
 #ifdef SLATE_SERVER
-	span->SetAttribute("log.message", cmd.str());
+	if (span.recording()) {
+		span->SetAttribute("log.message", formatCommandLine("kubectl", fullArgs));
+	}
 #endif
 	auto result=runCommand("kubectl",fullArgs);
-#ifdef SLATE_SERVER
-	span->End();
-#endif
+	describeLimitsExceeded("kubectl",result);
 	return commandResult{removeShellEscapeSequences(result.output),
-	                     removeShellEscapeSequences(result.error),result.status};
+	                     removeShellEscapeSequences(result.error),result.status,
+	                     result.timedOut,result.truncated};
 }
 
 int getControllerVersion(const std::string& clusterConfig) {
 #ifdef SLATE_SERVER
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("getControllerVersion", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("getControllerVersion");
 #endif
 	auto result=runCommand("kubectl",{"--kubeconfig",clusterConfig,"get", "crd", "clusternss.slateci.io"});
 
 	if (result.output.find("CREATED AT") != std::string::npos) {
 		std::cerr << "Cluster using federation controller" << std::endl;
 		// if clusternss is found, we're talking to a cluster with the new version of the controller
-#ifdef SLATE_SERVER
-		span->End();
-#endif
 		return 2;
 	}
 	std::cerr << "Cluster using nrp controller" << std::endl;
-#ifdef SLATE_SERVER
-	span->End();
-#endif
 	return 1;
 }
 
@@ -93,10 +108,7 @@ metadata:
 
 	}
 
-	auto tmpFile=makeTemporaryFile("namespace_yaml_");
-	std::ofstream tmpfile(tmpFile);
-	tmpfile << input;
-	tmpfile.close();
+	auto tmpFile=makeMemoryFile("namespace_yaml_",input);
 	
 	auto result=runCommand("kubectl",{"--kubeconfig",clusterConfig,"create","-f",tmpFile});
 	if(result.status){
@@ -128,12 +140,7 @@ commandResult helm(const std::string& configPath,
 		   const std::vector<std::string>& arguments) {
 
 #ifdef SLATE_SERVER
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("helm", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("helm");
 #endif
 
 	std::vector<std::string> fullArgs;
@@ -143,30 +150,20 @@ commandResult helm(const std::string& configPath,
 	}
 	std::copy(arguments.begin(),arguments.end(),std::back_inserter(fullArgs));
 
-	std::ostringstream cmd;
-	cmd << "kubectl";
-	for (std::vector<std::string>::const_iterator i = fullArgs.begin(); i != fullArgs.end(); ++i ) {
-		cmd << " " << *i;
-	}
 #ifdef SLATE_SERVER
-	span->SetAttribute("log.message", cmd.str());
+	if (span.recording()) {
+		span->SetAttribute("log.message", formatCommandLine("helm", fullArgs));
+	}
 #endif
 
 	auto result = runCommand("helm",fullArgs,{{"KUBECONFIG",configPath}});
-#ifdef SLATE_SERVER
-	span->End();
-#endif
+	describeLimitsExceeded("helm",result);
 	return result;
 }
 
 unsigned int getHelmMajorVersion(){
 #ifdef SLATE_SERVER
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("getHelmMajorVersion", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("getHelmMajorVersion");
 	span->SetAttribute("log.message", "helm version");
 #endif
 	auto commandResult = runCommand("helm",{"version"});
@@ -210,21 +207,13 @@ unsigned int getHelmMajorVersion(){
 #endif
 		throw std::runtime_error(err);
 	}
-#ifdef SLATE_SERVER
-	span->End();
-#endif
 	return helmMajorVersion;
 }
 
 std::multimap<std::string,std::string> findAll(const std::string& clusterConfig, const std::string& selector,
 											   const std::string& nspace, const std::string& verbs){
 #ifdef SLATE_SERVER
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("findAll", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("findAll");
 #endif
 
 	std::multimap<std::string,std::string> objects;
@@ -234,7 +223,6 @@ std::multimap<std::string,std::string> findAll(const std::string& clusterConfig,
 	if(result.status!=0) {
 #ifdef SLATE_SERVER
 		setSpanError(span, "Failed to determine list of Kubernetes resource types");
-		span->End();
 #endif
 		throw std::runtime_error("Failed to determine list of Kubernetes resource types");
 	}
@@ -257,7 +245,6 @@ std::multimap<std::string,std::string> findAll(const std::string& clusterConfig,
 		if(result.status!=0) {
 #ifdef SLATE_SERVER
 			setSpanError(span, "Failed to list resources of type " + type);
-			span->End();
 #endif
 			throw std::runtime_error("Failed to list resources of type " + type);
 		}
@@ -268,9 +255,6 @@ std::multimap<std::string,std::string> findAll(const std::string& clusterConfig,
 		}
 	}
 
-#ifdef SLATE_SERVER
-	span->End();
-#endif
 	return objects;
 }
 
@@ -0,0 +1,63 @@
+#include "LogLevelCommands.h"
+
+#include "rapidjson/document.h"
+
+#include "Logging.h"
+#include "ServerUtilities.h"
+#include "Telemetry.h"
+
+crow::response fetchServerLogLevel(PersistentStore& store, const crow::request& req){
+	SpanGuard span(req);
+	const User user = authenticateUser(store, req.url_params.get("token"));
+	span->SetAttribute("user", user.name);
+	if (!user || !user.admin) {
+		const std::string& errMsg = "User not authorized";
+		setWebSpanError(span, errMsg, 403);
+		log_error(errMsg);
+		return crow::response(403, generateError(errMsg));
+	}
+	
+	rapidjson::Document result(rapidjson::kObjectType);
+	rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
+	result.AddMember("apiVersion", "v1alpha3", alloc);
+	result.AddMember("level", logLevelName(getLogLevel()), alloc);
+	return crow::response(to_string(result));
+}
+
+crow::response updateServerLogLevel(PersistentStore& store, const crow::request& req){
+	SpanGuard span(req);
+	const User user = authenticateUser(store, req.url_params.get("token"));
+	span->SetAttribute("user", user.name);
+	if (!user || !user.admin) {
+		const std::string& errMsg = "User not authorized";
+		setWebSpanError(span, errMsg, 403);
+		log_error(errMsg);
+		return crow::response(403, generateError(errMsg));
+	}
+	
+	rapidjson::Document body;
+	try{
+		body.Parse(req.body.c_str());
+	}catch(std::runtime_error& err){
+		const std::string& errMsg = "Invalid JSON in request body";
+		setWebSpanError(span, errMsg, 400);
+		return crow::response(400, generateError(errMsg));
+	}
+	if(body.IsNull() || !body.IsObject() || !body.HasMember("level") || !body["level"].IsString()) {
+		const std::string& errMsg = "Request body must contain a level string";
+		setWebSpanError(span, errMsg, 400);
+		return crow::response(400, generateError(errMsg));
+	}
+	LogLevel level;
+	try{
+		level = parseLogLevel(body["level"].GetString());
+	}catch(std::runtime_error& err){
+		setWebSpanError(span, err.what(), 400);
+		return crow::response(400, generateError(err.what()));
+	}
+	
+	//record the change even if it suppresses informational messages
+	log_warn(user << " set the log level to " << logLevelName(level));
+	setLogLevel(level);
+	return crow::response(200);
+}
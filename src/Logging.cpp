@@ -1,4 +1,335 @@
 #include <Logging.h>
 
-logTarget logStdout{std::cout};
-logTarget logStderr{std::cerr};
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace{
+
+std::atomic<int> minimumLevel((int)LogLevel::Info);
+std::atomic<int> outputFormat((int)LogFormat::Text);
+std::atomic<std::string(*)()> traceSource(nullptr);
+
+struct LogRecord{
+	LogLevel level;
+	std::chrono::system_clock::time_point time;
+	std::thread::id thread;
+	std::string traceID;
+	std::string message;
+};
+
+///A bounded queue to which any number of threads may add without locking, and
+///from which a single thread removes. Each slot carries a sequence number
+///indicating whether it is next to be filled by a producer or emptied by the
+///consumer.
+class LogQueue{
+public:
+	///\param capacity the number of records the queue can hold; must be a
+	///                power of two
+	explicit LogQueue(std::size_t capacity):
+	slots(new Slot[capacity]),mask(capacity-1),enqueuePos(0),dequeuePos(0){
+		for(std::size_t i=0; i<capacity; i++)
+			slots[i].sequence.store(i,std::memory_order_relaxed);
+	}
+
+	///\return false if the queue is full
+	bool push(LogRecord&& record){
+		Slot* slot;
+		std::size_t pos=enqueuePos.load(std::memory_order_relaxed);
+		while(true){
+			slot=&slots[pos&mask];
+			std::size_t seq=slot->sequence.load(std::memory_order_acquire);
+			std::intptr_t diff=(std::intptr_t)seq-(std::intptr_t)pos;
+			if(diff==0){
+				if(enqueuePos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+					break;
+			}
+			else if(diff<0) //the consumer has not yet emptied this slot
+				return false;
+			else //another producer took this slot first
+				pos=enqueuePos.load(std::memory_order_relaxed);
+		}
+		slot->record=std::move(record);
+		slot->sequence.store(pos+1);
+		return true;
+	}
+
+	///Must only be called by the consuming thread
+	///\return false if the queue is empty
+	bool pop(LogRecord& record){
+		Slot& slot=slots[dequeuePos&mask];
+		std::size_t seq=slot.sequence.load(std::memory_order_acquire);
+		if(seq!=dequeuePos+1)
+			return false;
+		record=std::move(slot.record);
+		slot.sequence.store(dequeuePos+mask+1,std::memory_order_release);
+		dequeuePos.store(dequeuePos+1,std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const{
+		std::size_t pos=dequeuePos.load(std::memory_order_acquire);
+		return slots[pos&mask].sequence.load()!=pos+1;
+	}
+
+	///\return the number of records which have been added to the queue
+	std::size_t added() const{ return enqueuePos.load(); }
+
+private:
+	struct Slot{
+		std::atomic<std::size_t> sequence;
+		LogRecord record;
+	};
+	std::unique_ptr<Slot[]> slots;
+	const std::size_t mask;
+	std::atomic<std::size_t> enqueuePos;
+	std::atomic<std::size_t> dequeuePos;
+};
+
+std::string levelLabel(LogLevel level){
+	switch(level){
+		case LogLevel::Info: return "INFO";
+		case LogLevel::Warn: return "WARN";
+		case LogLevel::Error: return "ERROR";
+		case LogLevel::Fatal: return "FATAL";
+	}
+	return "UNKNOWN";
+}
+
+std::string formatTime(std::chrono::system_clock::time_point time){
+	using namespace std::chrono;
+	auto sinceEpoch=duration_cast<microseconds>(time.time_since_epoch()).count();
+	auto t=boost::posix_time::from_time_t(sinceEpoch/1000000)
+	       +boost::posix_time::microseconds(sinceEpoch%1000000);
+	return to_simple_string(t)+" UTC";
+}
+
+void formatRecord(const LogRecord& record, LogFormat format, std::string& out){
+	std::ostringstream thread;
+	thread << record.thread;
+	if(format==LogFormat::JSON){
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		writer.StartObject();
+		writer.Key("time");
+		writer.String(formatTime(record.time));
+		writer.Key("level");
+		writer.String(logLevelName(record.level));
+		writer.Key("thread");
+		writer.String(thread.str());
+		if(!record.traceID.empty()){
+			writer.Key("traceID");
+			writer.String(record.traceID);
+		}
+		writer.Key("message");
+		writer.String(record.message);
+		writer.EndObject();
+		out.append(buffer.GetString(),buffer.GetSize());
+	}
+	else{
+		out+=levelLabel(record.level)+": ["+formatTime(record.time)+"] (TID "
+		     +thread.str()+") "+record.message;
+	}
+	out+='\n';
+}
+
+///Owns the queue of pending messages and the thread which writes them out, so
+///that callers never wait on the output streams.
+class LogWriter{
+public:
+	LogWriter():
+	queue(queueCapacity),
+	writerSleeping(false),
+	written(0),
+	dropped(0),
+	completed(0)
+	{
+		std::thread(&LogWriter::run,this).detach();
+		//Write whatever is still queued when the program ends normally
+		std::atexit(flushLogs);
+	}
+
+	void enqueue(LogRecord&& record){
+		const LogLevel level=record.level;
+		std::size_t done=completed.load();
+		//a failed push leaves the record intact
+		while(!queue.push(std::move(record))){
+			if(level==LogLevel::Info){
+				dropped++;
+				return;
+			}
+			//Problems must not be lost, but neither may they overtake 
+			//messages already queued, so wait for the writer to make room
+			std::unique_lock<std::mutex> lock(mut);
+			wakeup.notify_one();
+			flushed.wait(lock,[&]{ return completed.load()!=done; });
+			done=completed.load();
+		}
+		//Either the writer sees this record when it re-checks the queue after 
+		//marking itself as sleeping, or this sees the mark; the fences pair 
+		//with the writer's to guarantee this. Only then is the writer waiting,
+		//or about to, and taking the lock orders the notification after its 
+		//check so that it cannot be missed. 
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(writerSleeping.load(std::memory_order_relaxed)){
+			{ std::lock_guard<std::mutex> lock(mut); }
+			wakeup.notify_one();
+		}
+	}
+
+	void flush(){
+		const std::size_t target=queue.added();
+		std::unique_lock<std::mutex> lock(mut);
+		wakeup.notify_one();
+		flushed.wait(lock,[&]{ return completed.load()>=target; });
+	}
+
+	std::size_t getWritten() const{ return written.load(); }
+	std::size_t getDropped() const{ return dropped.load(); }
+
+private:
+	const static std::size_t queueCapacity=1<<13;
+	const static std::size_t maxBatchSize=256;
+
+	LogQueue queue;
+	///Protects sleeping and waking of the writer thread
+	std::mutex mut;
+	///Signalled when messages are added
+	std::condition_variable wakeup;
+	///Whether the writer has found, or may be about to find, the queue empty
+	///and wait to be woken
+	std::atomic<bool> writerSleeping;
+	///Signalled when the writer finishes writing a batch of messages
+	std::condition_variable flushed;
+	std::atomic<std::size_t> written;
+	std::atomic<std::size_t> dropped;
+	///The number of messages taken from the queue and written out
+	std::atomic<std::size_t> completed;
+
+	void run(){
+		LogRecord record;
+		std::string outText, errText;
+		while(true){
+			//Format messages in batches and write each batch with a single
+			//flush, rather than flushing every line
+			std::size_t count=0;
+			LogFormat format=(LogFormat)outputFormat.load();
+			while(count<maxBatchSize && queue.pop(record)){
+				formatRecord(record,format,record.level==LogLevel::Info?outText:errText);
+				count++;
+			}
+			if(!outText.empty()){
+				std::cout.write(outText.data(),outText.size());
+				std::cout.flush();
+				outText.clear();
+			}
+			if(!errText.empty()){
+				std::cerr.write(errText.data(),errText.size());
+				std::cerr.flush();
+				errText.clear();
+			}
+			written+=count;
+			completed+=count;
+
+			std::unique_lock<std::mutex> lock(mut);
+			flushed.notify_all();
+			if(count)
+				continue;
+			writerSleeping.store(true,std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			wakeup.wait(lock,[this]{ return !queue.empty(); });
+			writerSleeping.store(false,std::memory_order_relaxed);
+		}
+	}
+};
+
+LogWriter& logWriter(){
+	//Never destroyed, so that messages may still be logged during static
+	//destruction
+	static LogWriter* writer=new LogWriter;
+	return *writer;
+}
+
+} //anonymous namespace
+
+bool logLevelEnabled(LogLevel level){
+	return (int)level>=minimumLevel.load(std::memory_order_relaxed);
+}
+
+void setLogLevel(LogLevel level){
+	minimumLevel=(int)level;
+}
+
+LogLevel getLogLevel(){
+	return (LogLevel)minimumLevel.load();
+}
+
+LogLevel parseLogLevel(const std::string& name){
+	std::string lower;
+	for(char c : name)
+		lower+=std::tolower((unsigned char)c);
+	if(lower=="info")
+		return LogLevel::Info;
+	if(lower=="warn" || lower=="warning")
+		return LogLevel::Warn;
+	if(lower=="error")
+		return LogLevel::Error;
+	if(lower=="fatal")
+		return LogLevel::Fatal;
+	throw std::runtime_error("Unrecognized log level: '"+name+"'");
+}
+
+std::string logLevelName(LogLevel level){
+	switch(level){
+		case LogLevel::Info: return "info";
+		case LogLevel::Warn: return "warn";
+		case LogLevel::Error: return "error";
+		case LogLevel::Fatal: return "fatal";
+	}
+	return "unknown";
+}
+
+void setLogFormat(LogFormat format){
+	outputFormat=(int)format;
+}
+
+void setLogTraceSource(std::string (*source)()){
+	traceSource=source;
+}
+
+void logMessage(LogLevel level, std::string message){
+	LogRecord record;
+	record.level=level;
+	record.time=std::chrono::system_clock::now();
+	record.thread=std::this_thread::get_id();
+	if((LogFormat)outputFormat.load(std::memory_order_relaxed)==LogFormat::JSON){
+		if(auto source=traceSource.load())
+			record.traceID=source();
+	}
+	record.message=std::move(message);
+	LogWriter& writer=logWriter();
+	writer.enqueue(std::move(record));
+	//the caller is likely to stop soon, so ensure that the reason is seen
+	if(level==LogLevel::Fatal)
+		writer.flush();
+}
+
+void flushLogs(){
+	logWriter().flush();
+}
+
+std::string getLogStatistics(){
+	std::ostringstream os;
+	os << "Log messages written: " << logWriter().getWritten() << "\n";
+	os << "Log messages dropped: " << logWriter().getDropped() << "\n";
+	return os.str();
+}
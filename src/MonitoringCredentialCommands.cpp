@@ -7,13 +7,7 @@
 #include "ServerUtilities.h"
 
 crow::response listMonitoringCredentials(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -23,7 +17,6 @@ crow::response listMonitoringCredentials(PersistentStore& store, const crow::req
 		log_info("Request to list monitoring credentials rejected");
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -49,18 +42,11 @@ crow::response listMonitoringCredentials(PersistentStore& store, const crow::req
 		resultItems.PushBack(credResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response addMonitoringCredential(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -70,7 +56,6 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 		log_info("Request to add a monitoring credential rejected");
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -81,7 +66,6 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg + " exception: " + err.what(), 400);
-		span->End();
 		log_warn(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -89,21 +73,18 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("metadata")) {
 		const std::string& errMsg = "Missing metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for metadata member";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -111,14 +92,12 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 	if(!body["metadata"].HasMember("accessKey")) {
 		const std::string& errMsg = "Missing access key in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["accessKey"].IsString()) {
 		const std::string& errMsg = "Incorrect type for access key";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -126,14 +105,12 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 	if(!body["metadata"].HasMember("secretKey")) {
 		const std::string& errMsg = "Missing secret key in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["secretKey"].IsString()) {
 		const std::string& errMsg = "Incorrect type for secret key";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -144,14 +121,12 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 	if(cred.accessKey.empty()) {
 		const std::string& errMsg = "Empty access key in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(cred.secretKey.empty()) {
 		const std::string& errMsg = "Empty secret key in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -161,23 +136,15 @@ crow::response addMonitoringCredential(PersistentStore& store, const crow::reque
 	if(!added) {
 		const std::string& errMsg = "Storing monitoring credential failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return crow::response(200);
 }
 
 crow::response revokeMonitoringCredential(PersistentStore& store, const crow::request& req,
 					  const std::string& credentialID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -188,7 +155,6 @@ crow::response revokeMonitoringCredential(PersistentStore& store, const crow::re
 		log_info("Request to revoke a monitoring credential rejected");
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -197,7 +163,6 @@ crow::response revokeMonitoringCredential(PersistentStore& store, const crow::re
 	if(!cred){
 		const std::string& errMsg = "Monitoring credential not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_warn(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -210,7 +175,6 @@ crow::response revokeMonitoringCredential(PersistentStore& store, const crow::re
 		if(!removed) {
 			const std::string& errMsg = "Revoking monitoring credential failed";
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			log_error(errMsg);
 			return crow::response(500, generateError(errMsg));
 		}
@@ -220,23 +184,15 @@ crow::response revokeMonitoringCredential(PersistentStore& store, const crow::re
 	if(!revoked) {
 		const std::string& errMsg = "Revoking monitoring credential failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return crow::response(200);
 }
 
 crow::response deleteMonitoringCredential(PersistentStore& store, const crow::request& req,
 					  const std::string& credentialID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -247,7 +203,6 @@ crow::response deleteMonitoringCredential(PersistentStore& store, const crow::re
 		log_info("Request to delete a monitoring credential rejected");
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -256,7 +211,6 @@ crow::response deleteMonitoringCredential(PersistentStore& store, const crow::re
 	if(!cred){
 		const std::string& errMsg = "Monitoring credential not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_warn(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -266,10 +220,8 @@ crow::response deleteMonitoringCredential(PersistentStore& store, const crow::re
 	if(!deleted) {
 		const std::string& errMsg = "Deleting monitoring credential failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return crow::response(200);
 }
@@ -1,8 +1,11 @@
 #include <PersistentStore.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fstream>
+#include <random>
 #include <thread>
 
 #include <boost/lexical_cast.hpp>
@@ -21,6 +24,7 @@
 #include <aws/dynamodb/model/DescribeTableRequest.h>
 #include <aws/dynamodb/model/UpdateTableRequest.h>
 
+#include <Archive.h>
 #include <HTTPRequests.h>
 #include <Logging.h>
 #include <ServerUtilities.h>
@@ -30,41 +34,6 @@ extern "C"{
 }
 #include <KubeInterface.h>
 
-EmailClient::EmailClient(const std::string& mailgunEndpoint,
-			 const std::string& mailgunKey,
-			 const std::string& emailDomain) :
-	mailgunEndpoint(mailgunEndpoint),mailgunKey(mailgunKey),emailDomain(emailDomain)
-{
-	valid=!mailgunEndpoint.empty() && !mailgunKey.empty() && !emailDomain.empty();
-}
-
-bool EmailClient::sendEmail(const EmailClient::Email& email){
-	if (!valid) {
-		return false;
-	}
-	std::string url="https://api:"+mailgunKey+"@"+mailgunEndpoint+"/v3/"+emailDomain+"/messages";
-	std::multimap<std::string,std::string> data{
-		{"from",email.fromAddress},
-		{"subject",email.subject},
-		{"text",email.body}
-	};
-	for (const auto &to: email.toAddresses) {
-		data.emplace("to", to);
-	}
-	for (const auto &cc: email.ccAddresses) {
-		data.emplace("cc", cc);
-	}
-	for (const auto &bcc: email.bccAddresses) {
-		data.emplace("bcc", bcc);
-	}
-	auto response=httpRequests::httpPostForm(url,data);
-	if(response.status!=200){
-		log_warn("Failed to send email: " << response.body);
-		return false;
-	}
-	return true;
-}
-
 namespace{
 	
 bool hasIndex(const Aws::DynamoDB::Model::TableDescription& tableDesc, const std::string& name){
@@ -117,7 +86,7 @@ updateTableWithNewSecondaryIndex(const std::string& tableName, const Aws::Dynamo
 	return request;
 }
 	
-void waitTableReadiness(Aws::DynamoDB::DynamoDBClient& dbClient, const std::string& tableName){
+void waitTableReadiness(StorageBackend& dbClient, const std::string& tableName){
 	using namespace Aws::DynamoDB::Model;
 	log_info("Waiting for table " << tableName << " to reach active status");
 	DescribeTableOutcome outcome;
@@ -133,7 +102,7 @@ void waitTableReadiness(Aws::DynamoDB::DynamoDBClient& dbClient, const std::stri
 	}
 }
 
-void waitIndexReadiness(Aws::DynamoDB::DynamoDBClient& dbClient,
+void waitIndexReadiness(StorageBackend& dbClient,
 			const std::string& tableName,
 			const std::string& indexName) {
 	using namespace Aws::DynamoDB::Model;
@@ -158,7 +127,7 @@ void waitIndexReadiness(Aws::DynamoDB::DynamoDBClient& dbClient,
 	
 
 
-void waitUntilIndexDeleted(Aws::DynamoDB::DynamoDBClient& dbClient,
+void waitUntilIndexDeleted(StorageBackend& dbClient,
 			   const std::string& tableName,
 			   const std::string& indexName) {
 	using namespace Aws::DynamoDB::Model;
@@ -180,10 +149,50 @@ void waitUntilIndexDeleted(Aws::DynamoDB::DynamoDBClient& dbClient,
 	}
 }
 
+///Have the database delete items from a table once the time in a numeric 
+///attribute, in seconds since the epoch, has passed. Failure is not fatal, 
+///since readers must check expiration times anyway. 
+void enableTimeToLive(StorageBackend& dbClient,
+                      const std::string& tableName,
+                      const std::string& attributeName){
+	using namespace Aws::DynamoDB::Model;
+	auto describeOut=dbClient.DescribeTimeToLive(DescribeTimeToLiveRequest()
+	                                             .WithTableName(tableName));
+	if(!describeOut.IsSuccess()){
+		log_warn("Unable to check expiration of items in table " << tableName 
+		         << ": " << describeOut.GetError().GetMessage());
+		return;
+	}
+	auto status=describeOut.GetResult().GetTimeToLiveDescription().GetTimeToLiveStatus();
+	if(status==TimeToLiveStatus::ENABLED || status==TimeToLiveStatus::ENABLING)
+		return;
+	auto updateOut=dbClient.UpdateTimeToLive(UpdateTimeToLiveRequest()
+	                                         .WithTableName(tableName)
+	                                         .WithTimeToLiveSpecification(TimeToLiveSpecification()
+	                                                                      .WithAttributeName(attributeName)
+	                                                                      .WithEnabled(true)));
+	if(!updateOut.IsSuccess()){
+		log_warn("Unable to enable expiration of items in table " << tableName 
+		         << ": " << updateOut.GetError().GetMessage());
+		return;
+	}
+	log_info("Enabled expiration of items in table " << tableName);
+}
+
 ///A default string value to use in place of missing properties, when having a 
 ///trivial value is not a big concern
 const Aws::DynamoDB::Model::AttributeValue missingString(" ");
 
+///The attributes of a secret record needed to list it, omitting its contents.
+///Requests using this must define #name and #cluster.
+const std::string secretSummaryAttributes="ID, #name, owningGroup, #cluster, ctime";
+
+///\return a copy of a secret without its data
+Secret secretSummary(Secret secret){
+	secret.data.clear();
+	return secret;
+}
+
 template<typename Cache, typename Key=typename Cache::key_type, typename Value=typename Cache::mapped_type>
 void replaceCacheRecord(Cache& cache, const Key& key, const Value& value){
 	cache.upsert(key,[&value](Value& existing){ existing=value; },value);
@@ -211,6 +220,8 @@ do{ \
 
 const std::string PersistentStore::wildcard="*";
 const std::string PersistentStore::wildcardName="<all>";
+const std::size_t PersistentStore::monCredPoolLowWater=4;
+const std::size_t PersistentStore::minCompressedConfigSize=1024;
 
 PersistentStore::PersistentStore(const Aws::Auth::AWSCredentials& credentials,
 				 const Aws::Client::ClientConfiguration &clientConfig,
@@ -219,8 +230,29 @@ PersistentStore::PersistentStore(const Aws::Auth::AWSCredentials& credentials,
 				 std::string appLoggingServerName,
 				 unsigned int appLoggingServerPort,
 				 std::string slateDomain,
-				 opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracerPtr) :
-	dbClient(credentials,clientConfig),
+				 opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracerPtr,
+				 unsigned int cacheValidityFactor,
+				 std::string route53Endpoint) :
+	PersistentStore(std::unique_ptr<StorageBackend>(new DynamoDBBackend(credentials,clientConfig)),
+	                credentials,clientConfig,std::move(bootstrapUserFile),
+	                std::move(encryptionKeyFile),std::move(appLoggingServerName),
+	                appLoggingServerPort,std::move(slateDomain),tracerPtr,
+	                cacheValidityFactor,std::move(route53Endpoint))
+{}
+
+PersistentStore::PersistentStore(std::unique_ptr<StorageBackend> backend,
+				 const Aws::Auth::AWSCredentials& credentials,
+				 const Aws::Client::ClientConfiguration &clientConfig,
+				 std::string bootstrapUserFile,
+				 std::string encryptionKeyFile,
+				 std::string appLoggingServerName,
+				 unsigned int appLoggingServerPort,
+				 std::string slateDomain,
+				 opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer> tracerPtr,
+				 unsigned int cacheValidityFactor,
+				 std::string route53Endpoint) :
+	localWrites(new WriteTrackingBackend(std::move(backend))),
+	dbClient(localWrites),
 	tracer(tracerPtr),
 	userTableName("SLATE_users"),
 	groupTableName("SLATE_groups"),
@@ -229,19 +261,19 @@ PersistentStore::PersistentStore(const Aws::Auth::AWSCredentials& credentials,
 	secretTableName("SLATE_secrets"),
 	monCredTableName("SLATE_moncreds"),
 	volumeTableName("SLATE_volumes"),
-	dnsClient(credentials, clientConfig),
+	dnsClient(credentials, clientConfig, route53Endpoint),
 	baseDomain(std::move(slateDomain)),
 	clusterConfigDir(makeTemporaryDir("/var/tmp/slate_")),
-	userCacheValidity(std::chrono::minutes(5)),
+	userCacheValidity(std::chrono::minutes(5)*cacheValidityFactor),
 	userCacheExpirationTime(std::chrono::steady_clock::now()),
-	groupCacheValidity(std::chrono::minutes(30)),
+	groupCacheValidity(std::chrono::minutes(30)*cacheValidityFactor),
 	groupCacheExpirationTime(std::chrono::steady_clock::now()),
-	clusterCacheValidity(std::chrono::minutes(30)),
+	clusterCacheValidity(std::chrono::minutes(30)*cacheValidityFactor),
 	clusterCacheExpirationTime(std::chrono::steady_clock::now()),
-	instanceCacheValidity(std::chrono::minutes(5)),
+	instanceCacheValidity(std::chrono::minutes(5)*cacheValidityFactor),
 	instanceCacheExpirationTime(std::chrono::steady_clock::now()),
-	secretCacheValidity(std::chrono::minutes(5)),
-	volumeCacheValidity(std::chrono::minutes(5)),
+	secretCacheValidity(std::chrono::minutes(5)*cacheValidityFactor),
+	volumeCacheValidity(std::chrono::minutes(5)*cacheValidityFactor),
 	volumeCacheExpirationTime(std::chrono::steady_clock::now()),
 	secretKey(1024),
 	appLoggingServerName(appLoggingServerName),
@@ -249,21 +281,34 @@ PersistentStore::PersistentStore(const Aws::Auth::AWSCredentials& credentials,
 	cacheHits(0),
 	databaseQueries(0),
 	databaseScans(0),
+	scopedGenerations(DEFAULT_CACHE_SIZE),
+	generationEpoch(std::to_string(std::chrono::system_clock::now().time_since_epoch().count())),
+	generationEpochResets(0),
+	generationsComplete(false),
 	userCache(DEFAULT_CACHE_SIZE),
 	userByTokenCache(DEFAULT_CACHE_SIZE),
 	userByGlobusIDCache(DEFAULT_CACHE_SIZE),
 	groupCache(DEFAULT_CACHE_SIZE),
 	groupByNameCache(DEFAULT_CACHE_SIZE),
 	clusterCache(DEFAULT_CACHE_SIZE),
+	clusterSummaryCache(DEFAULT_CACHE_SIZE),
 	clusterByNameCache(DEFAULT_CACHE_SIZE),
 	clusterConfigs(DEFAULT_CACHE_SIZE),
-	clusterGroupApplicationCache(DEFAULT_CACHE_SIZE),
 	clusterLocationCache(DEFAULT_CACHE_SIZE),
 	clusterConnectivityCache(DEFAULT_CACHE_SIZE),
 	instanceCache(DEFAULT_CACHE_SIZE),
 	secretCache(DEFAULT_CACHE_SIZE),
-	volumeCache(DEFAULT_CACHE_SIZE)
+	volumeCache(DEFAULT_CACHE_SIZE),
+	geocodeCacheValidity(std::chrono::hours(24*30)*cacheValidityFactor),
+	geocodeCache(DEFAULT_CACHE_SIZE),
+	accessIndex(wildcard,wildcardName),
+	accessIndexExpiration(std::chrono::steady_clock::time_point::min()),
+	accessIndexLoading(false),
+	accessIndexReady(false),
+	accessIndexInvalidated(false)
 {
+	for(auto& generation : generations)
+		generation=0;
 	loadEncryptionKey(encryptionKeyFile);
 	log_info("Starting database client");
 	InitializeTables(bootstrapUserFile);
@@ -317,7 +362,7 @@ void PersistentStore::InitializeUserTable(std::string bootstrapUserFile){
 	};
 	
 	//check status of the table
-	auto userTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto userTableOut=dbClient->DescribeTable(DescribeTableRequest()
 	                                         .WithTableName(userTableName));
 	if(!userTableOut.IsSuccess() &&
 	   userTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -346,12 +391,12 @@ void PersistentStore::InitializeUserTable(std::string bootstrapUserFile){
 		request.AddGlobalSecondaryIndexes(getByGlobusIDIndex());
 		request.AddGlobalSecondaryIndexes(getByGroupIndex());
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal("Failed to create user table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,userTableName);
+		waitTableReadiness(*dbClient,userTableName);
 		
 		{
 			try{
@@ -376,7 +421,7 @@ void PersistentStore::InitializeUserTable(std::string bootstrapUserFile){
 				log_error("Failed to inject portal user; deleting users table");
 				//Demolish the whole table again. This is technically overkill, but it ensures that
 				//on the next start up this step will be run again (hopefully with better results).
-				auto outc=dbClient.DeleteTable(Aws::DynamoDB::Model::DeleteTableRequest().WithTableName(userTableName));
+				auto outc=dbClient->DeleteTable(Aws::DynamoDB::Model::DeleteTableRequest().WithTableName(userTableName));
 				//If the table deletion fails it is still possible to get stuck on a restart, but 
 				//it isn't clear what else could be done about such a failure. 
 				if (!outc.IsSuccess()) {
@@ -398,12 +443,12 @@ void PersistentStore::InitializeUserTable(std::string bootstrapUserFile){
 			log_info("Deleting by-token index");
 			UpdateTableRequest req=UpdateTableRequest().WithTableName(userTableName);
 			req.AddGlobalSecondaryIndexUpdates(GlobalSecondaryIndexUpdate().WithDelete(DeleteGlobalSecondaryIndexAction().WithIndexName("ByToken")));
-			auto updateResult=dbClient.UpdateTable(req);
+			auto updateResult=dbClient->UpdateTable(req);
 			if (!updateResult.IsSuccess()) {
 				log_fatal("Failed to delete incomplete ByToken secondary index from user table: " +
 					  updateResult.GetError().GetMessage());
 			}
-			waitUntilIndexDeleted(dbClient,groupTableName,"ByToken");
+			waitUntilIndexDeleted(*dbClient,groupTableName,"ByToken");
 			changed=true;
 		}
 		if(hasIndex(tableDesc,"ByGlobusID") && 
@@ -412,18 +457,18 @@ void PersistentStore::InitializeUserTable(std::string bootstrapUserFile){
 			log_info("Deleting by-globus-id index");
 			UpdateTableRequest req=UpdateTableRequest().WithTableName(userTableName);
 			req.AddGlobalSecondaryIndexUpdates(GlobalSecondaryIndexUpdate().WithDelete(DeleteGlobalSecondaryIndexAction().WithIndexName("ByGlobusID")));
-			auto updateResult=dbClient.UpdateTable(req);
+			auto updateResult=dbClient->UpdateTable(req);
 			if (!updateResult.IsSuccess()) {
 				log_fatal("Failed to delete incomplete ByGlobusID secondary index from user table: " +
 					  updateResult.GetError().GetMessage());
 			}
-			waitUntilIndexDeleted(dbClient,groupTableName,"ByGlobusID");
+			waitUntilIndexDeleted(*dbClient,groupTableName,"ByGlobusID");
 			changed=true;
 		}
 		
 		//if an index was deleted, update the table description so we know to recreate it
 		if(changed){
-			userTableOut=dbClient.DescribeTable(DescribeTableRequest()
+			userTableOut=dbClient->DescribeTable(DescribeTableRequest()
 			                                  .WithTableName(userTableName));
 			tableDesc=userTableOut.GetResult().GetTable();
 		}
@@ -431,34 +476,34 @@ void PersistentStore::InitializeUserTable(std::string bootstrapUserFile){
 		if(!hasIndex(tableDesc,"ByToken")){
 			auto request=updateTableWithNewSecondaryIndex(userTableName,getByTokenIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("token").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-token index to user table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,userTableName,"ByToken");
+			waitIndexReadiness(*dbClient,userTableName,"ByToken");
 			log_info("Added by-token index to user table");
 		}
 		if(!hasIndex(tableDesc,"ByGlobusID")){
 			auto request=updateTableWithNewSecondaryIndex(userTableName,getByGlobusIDIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("globusID").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-GlobusID index to user table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,userTableName,"ByGlobusID");
+			waitIndexReadiness(*dbClient,userTableName,"ByGlobusID");
 			log_info("Added by-GlobusID index to user table");
 		}
 		if(!hasIndex(tableDesc,"ByGroup")){
 			auto request=updateTableWithNewSecondaryIndex(userTableName,getByGroupIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("groupID").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-Group index to user table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,userTableName,"ByGroup");
+			waitIndexReadiness(*dbClient,userTableName,"ByGroup");
 			log_info("Added by-Group index to user table");
 		}
 	}
@@ -485,7 +530,7 @@ void PersistentStore::InitializeGroupTable(){
 	};
 	
 	//check status of the table
-	auto groupTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto groupTableOut=dbClient->DescribeTable(DescribeTableRequest()
 											 .WithTableName(groupTableName));
 	if(!groupTableOut.IsSuccess() &&
 	   groupTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -510,12 +555,12 @@ void PersistentStore::InitializeGroupTable(){
 		                                 .WithWriteCapacityUnits(1));
 		request.AddGlobalSecondaryIndexes(getByNameIndex());
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal("Failed to create groups table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,groupTableName);
+		waitTableReadiness(*dbClient,groupTableName);
 		log_info("Created groups table");
 	}
 	else{ //table exists; check whether any indices are missing
@@ -531,18 +576,18 @@ void PersistentStore::InitializeGroupTable(){
 			log_info("Deleting by-name index");
 			UpdateTableRequest req=UpdateTableRequest().WithTableName(groupTableName);
 			req.AddGlobalSecondaryIndexUpdates(GlobalSecondaryIndexUpdate().WithDelete(DeleteGlobalSecondaryIndexAction().WithIndexName("ByName")));
-			auto updateResult=dbClient.UpdateTable(req);
+			auto updateResult=dbClient->UpdateTable(req);
 			if (!updateResult.IsSuccess()) {
 				log_fatal("Failed to delete incomplete secondary index from Group table: " +
 					  updateResult.GetError().GetMessage());
 			}
-			waitUntilIndexDeleted(dbClient,groupTableName,"ByName");
+			waitUntilIndexDeleted(*dbClient,groupTableName,"ByName");
 			changed=true;
 		}
 		
 		//if an index was deleted, update the table description so we know to recreate it
 		if(changed){
-			groupTableOut=dbClient.DescribeTable(DescribeTableRequest()
+			groupTableOut=dbClient->DescribeTable(DescribeTableRequest()
 			                                  .WithTableName(groupTableName));
 			tableDesc=groupTableOut.GetResult().GetTable();
 		}
@@ -550,12 +595,12 @@ void PersistentStore::InitializeGroupTable(){
 		if(!hasIndex(tableDesc,"ByName")){
 			auto request=updateTableWithNewSecondaryIndex(groupTableName,getByNameIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("name").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-name index to Group table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,groupTableName,"ByName");
+			waitIndexReadiness(*dbClient,groupTableName,"ByName");
 			log_info("Added by-name index to Group table");
 		}
 	}
@@ -608,7 +653,7 @@ void PersistentStore::InitializeClusterTable(){
 	};
 	
 	//check status of the table
-	auto clusterTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto clusterTableOut=dbClient->DescribeTable(DescribeTableRequest()
 											 .WithTableName(clusterTableName));
 	if(!clusterTableOut.IsSuccess() &&
 	   clusterTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -638,12 +683,12 @@ void PersistentStore::InitializeClusterTable(){
 		request.AddGlobalSecondaryIndexes(getByNameIndex());
 		request.AddGlobalSecondaryIndexes(getGroupAccessIndex());
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal("Failed to create clusters table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,clusterTableName);
+		waitTableReadiness(*dbClient,clusterTableName);
 		log_info("Created clusters table");
 	}
 	else{ //table exists; check whether any indices are missing
@@ -659,12 +704,12 @@ void PersistentStore::InitializeClusterTable(){
 			UpdateTableRequest req=UpdateTableRequest().WithTableName(clusterTableName);
 			//req.AddAttributeDefinitions(AttDef().WithAttributeName("systemNamespace").WithAttributeType(SAT::S));
 			req.AddGlobalSecondaryIndexUpdates(GlobalSecondaryIndexUpdate().WithDelete(DeleteGlobalSecondaryIndexAction().WithIndexName("ByGroup")));
-			auto updateResult=dbClient.UpdateTable(req);
+			auto updateResult=dbClient->UpdateTable(req);
 			if (!updateResult.IsSuccess()) {
 				log_fatal("Failed to delete incomplete secondary index from cluster table: " +
 					  updateResult.GetError().GetMessage());
 			}
-			waitUntilIndexDeleted(dbClient,clusterTableName,"ByGroup");
+			waitUntilIndexDeleted(*dbClient,clusterTableName,"ByGroup");
 			changed=true;
 		}
 		
@@ -675,18 +720,18 @@ void PersistentStore::InitializeClusterTable(){
 			log_info("Deleting by-name index");
 			UpdateTableRequest req=UpdateTableRequest().WithTableName(clusterTableName);
 			req.AddGlobalSecondaryIndexUpdates(GlobalSecondaryIndexUpdate().WithDelete(DeleteGlobalSecondaryIndexAction().WithIndexName("ByName")));
-			auto updateResult=dbClient.UpdateTable(req);
+			auto updateResult=dbClient->UpdateTable(req);
 			if (!updateResult.IsSuccess()) {
 				log_fatal("Failed to delete incomplete secondary index from cluster table: " +
 					  updateResult.GetError().GetMessage());
 			}
-			waitUntilIndexDeleted(dbClient,clusterTableName,"ByName");
+			waitUntilIndexDeleted(*dbClient,clusterTableName,"ByName");
 			changed=true;
 		}
 		
 		//if an index was deleted, update the table description so we know to recreate it
 		if(changed){
-			clusterTableOut=dbClient.DescribeTable(DescribeTableRequest()
+			clusterTableOut=dbClient->DescribeTable(DescribeTableRequest()
 			                                       .WithTableName(clusterTableName));
 			tableDesc=clusterTableOut.GetResult().GetTable();
 		}
@@ -694,37 +739,39 @@ void PersistentStore::InitializeClusterTable(){
 		if(!hasIndex(tableDesc,"ByGroup")){
 			auto request=updateTableWithNewSecondaryIndex(clusterTableName,getByGroupIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("owningGroup").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-Group index to cluster table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,clusterTableName,"ByGroup");
+			waitIndexReadiness(*dbClient,clusterTableName,"ByGroup");
 			log_info("Added by-Group index to cluster table");
 		}
 		if(!hasIndex(tableDesc,"ByName")){
 			auto request=updateTableWithNewSecondaryIndex(clusterTableName,getByNameIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("name").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-name index to cluster table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,clusterTableName,"ByName");
+			waitIndexReadiness(*dbClient,clusterTableName,"ByName");
 			log_info("Added by-name index to cluster table");
 		}
 		if(!hasIndex(tableDesc,"GroupAccess")){
 			auto request=updateTableWithNewSecondaryIndex(clusterTableName,getGroupAccessIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("groupID").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add Group access index to cluster table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitIndexReadiness(dbClient,clusterTableName,"GroupAccess");
+			waitIndexReadiness(*dbClient,clusterTableName,"GroupAccess");
 			log_info("Added Group access index to cluster table");
 		}
 	}
+	//stored geocoding results are the only items which expire
+	enableTimeToLive(*dbClient,clusterTableName,"expirationTime");
 }
 
 void PersistentStore::InitializeInstanceTable(){
@@ -773,7 +820,7 @@ void PersistentStore::InitializeInstanceTable(){
 				                          .WithWriteCapacityUnits(1));
 	};
 	
-	auto instanceTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto instanceTableOut=dbClient->DescribeTable(DescribeTableRequest()
 	                                             .WithTableName(instanceTableName));
 	if(!instanceTableOut.IsSuccess() &&
 	   instanceTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -804,12 +851,12 @@ void PersistentStore::InitializeInstanceTable(){
 		request.AddGlobalSecondaryIndexes(getByNameIndex());
 		request.AddGlobalSecondaryIndexes(getByClusterIndex());
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal("Failed to create instance table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,instanceTableName);
+		waitTableReadiness(*dbClient,instanceTableName);
 		log_info("Created Instances table");
 	}
 	else{ //table exists; check whether any indices are missing
@@ -818,34 +865,34 @@ void PersistentStore::InitializeInstanceTable(){
 		if(!hasIndex(tableDesc,"ByGroup")){
 			auto request=updateTableWithNewSecondaryIndex(instanceTableName,getByGroupIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("owningGroup").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-Group index to instance table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,instanceTableName);
+			waitTableReadiness(*dbClient,instanceTableName);
 			log_info("Added by-Group index to instance table");
 		}
 		if(!hasIndex(tableDesc,"ByName")){
 			auto request=updateTableWithNewSecondaryIndex(instanceTableName,getByNameIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("name").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-name index to instance table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,instanceTableName);
+			waitTableReadiness(*dbClient,instanceTableName);
 			log_info("Added by-name index to instance table");
 		}
 		if(!hasIndex(tableDesc,"ByCluster")){
 			auto request=updateTableWithNewSecondaryIndex(instanceTableName,getByClusterIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("cluster").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-cluster index to instance table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,instanceTableName);
+			waitTableReadiness(*dbClient,instanceTableName);
 			log_info("Added by-cluster index to instance table");
 		}
 	}
@@ -886,7 +933,7 @@ void PersistentStore::InitializeSecretTable(){
 	};
 	
 	//check status of the table
-	auto secretTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto secretTableOut=dbClient->DescribeTable(DescribeTableRequest()
 											  .WithTableName(secretTableName));
 	if(!secretTableOut.IsSuccess() &&
 	   secretTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -916,12 +963,12 @@ void PersistentStore::InitializeSecretTable(){
 		request.AddGlobalSecondaryIndexes(getByGroupIndex());
 		request.AddGlobalSecondaryIndexes(getByClusterIndex());
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal("Failed to create secrets table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,secretTableName);
+		waitTableReadiness(*dbClient,secretTableName);
 		log_info("Created secrets table");
 	}
 	else{ //table exists; check whether any indices are missing
@@ -930,23 +977,23 @@ void PersistentStore::InitializeSecretTable(){
 		if(!hasIndex(tableDesc,"ByGroup")){
 			auto request=updateTableWithNewSecondaryIndex(secretTableName,getByGroupIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("owningGroup").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-Group index to secret table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,secretTableName);
+			waitTableReadiness(*dbClient,secretTableName);
 			log_info("Added by-Group index to secret table");
 		}
 		if(!hasIndex(tableDesc,"ByCluster")){
 			auto request=updateTableWithNewSecondaryIndex(secretTableName,getByClusterIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("cluster").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-cluster index to secret table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,secretTableName);
+			waitTableReadiness(*dbClient,secretTableName);
 			log_info("Added by-cluster index to secret table");
 		}
 	}
@@ -958,7 +1005,7 @@ void PersistentStore::InitializeMonCredTable(){
 	using SAT=Aws::DynamoDB::Model::ScalarAttributeType;
 	
 	//check status of the table
-	auto credTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto credTableOut=dbClient->DescribeTable(DescribeTableRequest()
 											  .WithTableName(monCredTableName));
 	if(!credTableOut.IsSuccess() &&
 	   credTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -981,13 +1028,13 @@ void PersistentStore::InitializeMonCredTable(){
 		                                 .WithReadCapacityUnits(1)
 		                                 .WithWriteCapacityUnits(1));
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal(
 				"Failed to create monitoring credentials table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,monCredTableName);
+		waitTableReadiness(*dbClient,monCredTableName);
 		log_info("Created monitoring credentials table");
 	}
 	/*else{ //table exists; check whether any indices are missing
@@ -1030,7 +1077,7 @@ using namespace Aws::DynamoDB::Model;
 	};
 	
 	//check status of the table
-	auto volumeTableOut=dbClient.DescribeTable(DescribeTableRequest()
+	auto volumeTableOut=dbClient->DescribeTable(DescribeTableRequest()
 											  .WithTableName(volumeTableName));
 	if(!volumeTableOut.IsSuccess() &&
 	   volumeTableOut.GetError().GetErrorType()!=Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND){
@@ -1057,12 +1104,12 @@ using namespace Aws::DynamoDB::Model;
 		request.AddGlobalSecondaryIndexes(getByGroupIndex());
 		request.AddGlobalSecondaryIndexes(getByClusterIndex());
 		
-		auto createOut=dbClient.CreateTable(request);
+		auto createOut=dbClient->CreateTable(request);
 		if (!createOut.IsSuccess()) {
 			log_fatal("Failed to create volumes table: " + createOut.GetError().GetMessage());
 		}
 		
-		waitTableReadiness(dbClient,volumeTableName);
+		waitTableReadiness(*dbClient,volumeTableName);
 		log_info("Created volumes table");
 	}
 	else{ //table exists; check whether any indices are missing
@@ -1071,23 +1118,23 @@ using namespace Aws::DynamoDB::Model;
 		if(!hasIndex(tableDesc,"ByGroup")){
 			auto request=updateTableWithNewSecondaryIndex(volumeTableName,getByGroupIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("owningGroup").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-Group index to volume table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,volumeTableName);
+			waitTableReadiness(*dbClient,volumeTableName);
 			log_info("Added by-Group index to volume table");
 		}
 		if(!hasIndex(tableDesc,"ByCluster")){
 			auto request=updateTableWithNewSecondaryIndex(volumeTableName,getByClusterIndex());
 			request.WithAttributeDefinitions({AttDef().WithAttributeName("cluster").WithAttributeType(SAT::S)});
-			auto createOut=dbClient.UpdateTable(request);
+			auto createOut=dbClient->UpdateTable(request);
 			if (!createOut.IsSuccess()) {
 				log_fatal("Failed to add by-cluster index to volume table: " +
 					  createOut.GetError().GetMessage());
 			}
-			waitTableReadiness(dbClient,volumeTableName);
+			waitTableReadiness(*dbClient,volumeTableName);
 			log_info("Added by-cluster index to volume table");
 		}
 	}
@@ -1117,11 +1164,7 @@ void PersistentStore::loadEncryptionKey(const std::string& fileName){
 
 bool PersistentStore::addUser(const User& user){
 	using Aws::DynamoDB::Model::AttributeValue;
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addUser", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addUser");
 
 	auto request=Aws::DynamoDB::Model::PutItemRequest()
 	.WithTableName(userTableName)
@@ -1136,11 +1179,10 @@ bool PersistentStore::addUser(const User& user){
 		{"institution",AttributeValue(user.institution)},
 		{"admin",AttributeValue().SetBool(user.admin)}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add user record: " << err);
 		return false;
 	}
@@ -1151,16 +1193,12 @@ bool PersistentStore::addUser(const User& user){
 	replaceCacheRecord(userByTokenCache,user.token,record);
 	replaceCacheRecord(userByGlobusIDCache,user.globusID,record);
 
-	span->End();
+	recordChange(StoreCollection::Users,ChangeOperation::Add,user.id);
 	return true;
 }
 
 User PersistentStore::getUser(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getUser", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getUser");
 
 	//first see if we have this cached
 	{
@@ -1169,7 +1207,6 @@ User PersistentStore::getUser(const std::string& id){
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -1178,20 +1215,18 @@ User PersistentStore::getUser(const std::string& id){
 	databaseQueries++;
 	log_info("Querying database for user " << id);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(userTableName)
 								  .WithKey({{"ID",AttributeValue(id)},
 	                                        {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err=outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch user record: " << err);
 		return User();
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) {//no match found
-		span->End();
 		return User{};
 	}
 	User user;
@@ -1211,16 +1246,11 @@ User PersistentStore::getUser(const std::string& id){
 	replaceCacheRecord(userByTokenCache,user.token,record);
 	replaceCacheRecord(userByGlobusIDCache,user.globusID,record);
 
-	span->End();
 	return user;
 }
 
 User PersistentStore::findUserByToken(const std::string& token){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findUserByToken", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findUserByToken");
 
 	//first see if we have this cached
 	{
@@ -1229,7 +1259,6 @@ User PersistentStore::findUserByToken(const std::string& token){
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -1247,23 +1276,20 @@ User PersistentStore::findUserByToken(const std::string& token){
 	.WithExpressionAttributeValues({
 		{":tok_val",AttributeValue(token)}
 	});
-	auto outcome=dbClient.Query(request);
+	auto outcome=dbClient->Query(request);
 	if(!outcome.IsSuccess()){
 		const auto& err=outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to look up user by token: " << err);
 		return User();
 	}
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return User();
 	}
 	if(queryResult.GetCount()>1) {
 		const std::string& err = "Multiple user records are associated with token " + token + "!";
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	
@@ -1285,16 +1311,11 @@ User PersistentStore::findUserByToken(const std::string& token){
 	replaceCacheRecord(userByTokenCache,user.token,record);
 	replaceCacheRecord(userByGlobusIDCache,user.globusID,record);
 
-	span->End();
 	return user;
 }
 
 User PersistentStore::findUserByGlobusID(const std::string& globusID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findUserByGlobusID", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findUserByGlobusID");
 
 	//first see if we have this cached
 	{
@@ -1303,7 +1324,6 @@ User PersistentStore::findUserByGlobusID(const std::string& globusID){
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -1311,7 +1331,7 @@ User PersistentStore::findUserByGlobusID(const std::string& globusID){
 	//need to query the database
 	databaseQueries++;
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	auto outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 								.WithTableName(userTableName)
 								.WithIndexName("ByGlobusID")
 								.WithKeyConditionExpression("#globusID = :id_val")
@@ -1321,19 +1341,16 @@ User PersistentStore::findUserByGlobusID(const std::string& globusID){
 	if(!outcome.IsSuccess()){
 		const auto& err=outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to look up user by Globus ID: " << err);
 		return User();
 	}
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return User();
 	}
 	if(queryResult.GetCount()>1) {
 		const std::string& err = "Multiple user records are associated with Globus ID " + globusID + '!';
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	
@@ -1355,20 +1372,15 @@ User PersistentStore::findUserByGlobusID(const std::string& globusID){
 	replaceCacheRecord(userByTokenCache,user.token,record);
 	replaceCacheRecord(userByGlobusIDCache,user.globusID,record);
 
-	span->End();
 	return user;
 }
 
 bool PersistentStore::updateUser(const User& user, const User& oldUser){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::updateUser", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::updateUser");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
 	using AVU=Aws::DynamoDB::Model::AttributeValueUpdate;
-	auto outcome=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+	auto outcome=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
 	                                 .WithTableName(userTableName)
 									 .WithKey({{"ID",AV(user.id)},
 	                                           {"sortKey",AV(user.id)}})
@@ -1384,7 +1396,6 @@ bool PersistentStore::updateUser(const User& user, const User& oldUser){
 	if(!outcome.IsSuccess()){
 		const auto& err=outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to update user record: " << err);
 		return false;
 	}
@@ -1399,16 +1410,12 @@ bool PersistentStore::updateUser(const User& user, const User& oldUser){
 	replaceCacheRecord(userByTokenCache,user.token,record);
 	replaceCacheRecord(userByGlobusIDCache,user.globusID,record);
 
-	span->End();
+	recordChange(StoreCollection::Users,ChangeOperation::Update,user.id);
 	return true;
 }
 
 bool PersistentStore::removeUser(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeUser", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeUser");
 
 	//erase cache entries
 	{
@@ -1430,28 +1437,23 @@ bool PersistentStore::removeUser(const std::string& id){
 	}
 	
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 								     .WithTableName(userTableName)
 								     .WithKey({{"ID",AttributeValue(id)},
 	                                           {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete user record: " << err);
 		return false;
 	}
 
-	span->End();
+	recordChange(StoreCollection::Users,ChangeOperation::Remove,id);
 	return true;
 }
 
 std::vector<User> PersistentStore::listUsers(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listUsers", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listUsers");
 
 	std::vector<User> collected;
 	//First check if users are cached
@@ -1463,7 +1465,6 @@ std::vector<User> PersistentStore::listUsers(){
 			collected.push_back(user);
 		}
 		table.unlock();
-		span->End();
 		return collected;
 	}
 	
@@ -1476,11 +1477,10 @@ std::vector<User> PersistentStore::listUsers(){
 	bool keepGoing=false;
 	
 	do{
-		auto outcome=dbClient.Scan(request);
+		auto outcome=dbClient->Scan(request);
 		if(!outcome.IsSuccess()){
 			const auto& err = outcome.GetError().GetMessage();
 			setSpanError(span, err);
-			span->End();
 			log_error("Failed to fetch user records: " << err);
 			return collected;
 		}
@@ -1511,16 +1511,11 @@ std::vector<User> PersistentStore::listUsers(){
 		}
 	}while(keepGoing);
 	userCacheExpirationTime=std::chrono::steady_clock::now()+userCacheValidity;
-	span->End();
 	return collected;
 }
 
 std::vector<User> PersistentStore::listUsersByGroup(const std::string& group){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listUsersByGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listUsersByGroup");
 
 	//first check if list of users is cached
 	auto cached = userByGroupCache.find(group);
@@ -1532,7 +1527,6 @@ std::vector<User> PersistentStore::listUsersByGroup(const std::string& group){
 			auto user = getUser(record);
 			users.push_back(user);
 		}
-		span->End();
 		return users;
 	}
 
@@ -1541,7 +1535,7 @@ std::vector<User> PersistentStore::listUsersByGroup(const std::string& group){
 	databaseQueries++;
 
 	Aws::DynamoDB::Model::QueryOutcome outcome;
-	outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 			       .WithTableName(userTableName)
 			       .WithIndexName("ByGroup")
 			       .WithKeyConditionExpression("#groupID = :group_val")
@@ -1551,14 +1545,12 @@ std::vector<User> PersistentStore::listUsersByGroup(const std::string& group){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to list Users by Group: " << err);
 		return users;
 	}
 
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return users;
 	}
 
@@ -1577,21 +1569,15 @@ std::vector<User> PersistentStore::listUsersByGroup(const std::string& group){
 	userByGroupCache.update_expiration(group,std::chrono::steady_clock::now()+userCacheValidity);
 
 	
-	span->End();
 	return users;
 }
 
 bool PersistentStore::addUserToGroup(const std::string& uID, std::string groupID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addUserToGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addUserToGroup");
 
 	//check whether the 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID)) {
 		setSpanError(span, "Can't normalize GroupID");
-		span->End();
 		return false;
 	}
 
@@ -1606,11 +1592,10 @@ bool PersistentStore::addUserToGroup(const std::string& uID, std::string groupID
 		{"sortKey",AttributeValue(uID+":"+groupID)},
 		{"groupID",AttributeValue(groupID)}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add user Group membership record: " << err);
 		return false;
 	}
@@ -1621,21 +1606,17 @@ bool PersistentStore::addUserToGroup(const std::string& uID, std::string groupID
 	CacheRecord<Group> groupRecord(group,groupCacheValidity); 
 	groupByUserCache.insert_or_assign(user.id, groupRecord);
 
-	span->End();
+	recordChange(StoreCollection::Users,ChangeOperation::Update,uID);
+	recordChange(StoreCollection::Groups,ChangeOperation::Update,groupID);
 	return true;
 }
 
 bool PersistentStore::removeUserFromGroup(const std::string& uID, std::string groupID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeUserFromGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeUserFromGroup");
 
 	//check whether the 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID)) {
 		setSpanError(span, "Can't normalize GroupID");
-		span->End();
 		return false;
 	}
 
@@ -1649,7 +1630,7 @@ bool PersistentStore::removeUserFromGroup(const std::string& uID, std::string gr
 	}
 
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 								     .WithTableName(userTableName)
 								     .WithKey({{"ID",AttributeValue(uID)},
 	                                           {"sortKey",AttributeValue(uID+":"+groupID)}}));
@@ -1657,21 +1638,17 @@ bool PersistentStore::removeUserFromGroup(const std::string& uID, std::string gr
 		const auto& err = outcome.GetError().GetMessage();
 		
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete user Group membership record: " << err);
 		return false;
 	}
 
-	span->End();
+	recordChange(StoreCollection::Users,ChangeOperation::Update,uID);
+	recordChange(StoreCollection::Groups,ChangeOperation::Update,groupID);
 	return true;
 }
 
 std::vector<std::string> PersistentStore::getUserGroupMemberships(const std::string& uID, bool useNames){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getUserGroupMemberships", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getUserGroupMemberships");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 	databaseQueries++;
@@ -1687,13 +1664,12 @@ std::vector<std::string> PersistentStore::getUserGroupMemberships(const std::str
 		{":id",AttributeValue(uID)},
 		{":prefix",AttributeValue(uID+":"+IDGenerator::groupIDPrefix)}
 	});
-	auto outcome=dbClient.Query(request);
+	auto outcome=dbClient->Query(request);
 	std::vector<std::string> vos;
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch user's Group membership records: " << err);
 		return vos;
 	}
@@ -1713,16 +1689,11 @@ std::vector<std::string> PersistentStore::getUserGroupMemberships(const std::str
 		}
 	}
 	
-	span->End();
 	return vos;
 }
 
 bool PersistentStore::userInGroup(const std::string& uID, std::string groupID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::userInGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::userInGroup");
 
 	//TODO: possible issue: We only store memberships, so repeated queries about
 	//a user's belonging to a Group to which that user does not in fact belong will
@@ -1734,7 +1705,6 @@ bool PersistentStore::userInGroup(const std::string& uID, std::string groupID){
 	if(!normalizeGroupID(groupID)) {
 		
 		setSpanError(span, "Can't normalize GroupID");
-		span->End();
 		return false;
 	}
 	
@@ -1745,7 +1715,6 @@ bool PersistentStore::userInGroup(const std::string& uID, std::string groupID){
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -1754,61 +1723,50 @@ bool PersistentStore::userInGroup(const std::string& uID, std::string groupID){
 	databaseQueries++;
 	log_info("Querying database for user " << uID << " membership in Group " << groupID);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(userTableName)
 								  .WithKey({{"ID",AttributeValue(uID)},
 	                                        {"sortKey",AttributeValue(uID+":"+groupID)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch user Group membership record: " << err);
 		return false;
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) { //no match found
-		span->End();
 		return false;
 	}
 	//update cache
 	CacheRecord<std::string> record(uID,userCacheValidity);
 	userByGroupCache.insert_or_assign(groupID,record);
 	
-	span->End();
 	return true;
 }
 
 //----
 
 bool PersistentStore::addGroup(const Group& group){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addGroup");
 
 	if(group.email.empty()) {
 		setSpanError(span, "Group email must not be empty");
-		span->End();
 		throw std::runtime_error("Group email must not be empty because Dynamo");
 	}
 	if(group.phone.empty()) {
 		setSpanError(span, "Group phone must not be empty");
-		span->End();
 		throw std::runtime_error("Group phone must not be empty because Dynamo");
 	}
 	if(group.scienceField.empty()) {
 		setSpanError(span, "Group scienceField must not be empty");
-		span->End();
 		throw std::runtime_error("Group scienceField must not be empty because Dynamo");
 	}
 	if(group.description.empty()) {
 		setSpanError(span, "Group description must not be empty");
-		span->End();
 		throw std::runtime_error("Group description must not be empty because Dynamo");
 	}
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.PutItem(Aws::DynamoDB::Model::PutItemRequest()
+	auto outcome=dbClient->PutItem(Aws::DynamoDB::Model::PutItemRequest()
 	                              .WithTableName(groupTableName)
 	                              .WithItem({{"ID",AV(group.id)},
 	                                         {"sortKey",AV(group.id)},
@@ -1821,7 +1779,6 @@ bool PersistentStore::addGroup(const Group& group){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add Group record: " << err);
 		return false;
 	}
@@ -1831,16 +1788,12 @@ bool PersistentStore::addGroup(const Group& group){
 	replaceCacheRecord(groupCache,group.id,record);
 	replaceCacheRecord(groupByNameCache,group.name,record);
 	
-	span->End();
+	recordChange(StoreCollection::Groups,ChangeOperation::Add,group.id);
 	return true;
 }
 
 bool PersistentStore::removeGroup(const std::string& groupID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeGroup");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 
@@ -1848,7 +1801,6 @@ bool PersistentStore::removeGroup(const std::string& groupID){
 	for(auto uID : getMembersOfGroup(groupID)){
 		if(!removeUserFromGroup(uID,groupID)) {
 			setSpanError(span, "Can't remove user from group");
-			span->End();
 			return false;
 		}
 	}
@@ -1871,32 +1823,27 @@ bool PersistentStore::removeGroup(const std::string& groupID){
 	}
 	
 	//delete the Group record itself
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 								     .WithTableName(groupTableName)
 								     .WithKey({{"ID",AttributeValue(groupID)},
 	                                           {"sortKey",AttributeValue(groupID)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete Group record: " << err);
 		return false;
 	}
 	
-	span->End();
+	recordChange(StoreCollection::Groups,ChangeOperation::Remove,groupID);
 	return true;
 }
 
 bool PersistentStore::updateGroup(const Group& group){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::updateGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::updateGroup");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
 	using AVU=Aws::DynamoDB::Model::AttributeValueUpdate;
-	auto outcome=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+	auto outcome=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
 	                                 .WithTableName(groupTableName)
 	                                 .WithKey({{"ID",AV(group.id)},
 	                                           {"sortKey",AV(group.id)}})
@@ -1911,7 +1858,6 @@ bool PersistentStore::updateGroup(const Group& group){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to update Group record: " << err);
 		return false;
 	}
@@ -1924,21 +1870,17 @@ bool PersistentStore::updateGroup(const Group& group){
 	//which users are the keys. However, that cache is used only for Group properties 
 	//which cannot be changed (ID, name), so failing to update it does not do any harm.
 	
-	span->End();
+	recordChange(StoreCollection::Groups,ChangeOperation::Update,group.id);
 	return true;
 }
 
 std::vector<std::string> PersistentStore::getMembersOfGroup(const std::string groupID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getMembersOfGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getMembersOfGroup");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 	databaseQueries++;
 	log_info("Querying database for members of Group " << groupID);
-	auto outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	auto outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 	                            .WithTableName(userTableName)
 	                            .WithIndexName("ByGroup")
 	                            .WithKeyConditionExpression("#groupID = :id_val")
@@ -1949,7 +1891,6 @@ std::vector<std::string> PersistentStore::getMembersOfGroup(const std::string gr
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch Group membership records: " << err);
 		return users;
 	}
@@ -1959,21 +1900,16 @@ std::vector<std::string> PersistentStore::getMembersOfGroup(const std::string gr
 		users.push_back(item.find("ID")->second.GetS());
 	}
 
-	span->End();
 	return users;
 }
 
 std::vector<std::string> PersistentStore::clustersOwnedByGroup(const std::string groupID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::clustersOwnedByGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::clustersOwnedByGroup");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 	databaseQueries++;
 	log_info("Querying database for clusters owned by Group " << groupID);
-	auto outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	auto outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 	                            .WithTableName(clusterTableName)
 	                            .WithIndexName("ByGroup")
 	                            .WithKeyConditionExpression("#groupID = :id_val")
@@ -1984,7 +1920,6 @@ std::vector<std::string> PersistentStore::clustersOwnedByGroup(const std::string
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch Group owned cluster records: " << err);
 		return clusters;
 	}
@@ -1994,16 +1929,11 @@ std::vector<std::string> PersistentStore::clustersOwnedByGroup(const std::string
 		clusters.push_back(item.find("ID")->second.GetS());
 	}
 	
-	span->End();
 	return clusters;
 }
 
 std::vector<Group> PersistentStore::listGroups(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listGroups", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listGroups");
 
 	//First check if vos are cached
 	std::vector<Group> collected;
@@ -2017,7 +1947,6 @@ std::vector<Group> PersistentStore::listGroups(){
 	
 		table.unlock();
 		
-		span->End();
 		return collected;
 	}	
 
@@ -2029,11 +1958,10 @@ std::vector<Group> PersistentStore::listGroups(){
 	bool keepGoing=false;
 	
 	do{
-		auto outcome=dbClient.Scan(request);
+		auto outcome=dbClient->Scan(request);
 		if(!outcome.IsSuccess()){
 			const auto& err = outcome.GetError().GetMessage();
 			setSpanError(span, err);
-			span->End();
 			log_error("Failed to fetch Group records: " << err);
 			return collected;
 		}
@@ -2064,16 +1992,11 @@ std::vector<Group> PersistentStore::listGroups(){
 	}while(keepGoing);
 	groupCacheExpirationTime=std::chrono::steady_clock::now()+groupCacheValidity;
 
-	span->End();
 	return collected;
 }
 
 std::vector<Group> PersistentStore::listGroupsForUser(const std::string& user){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listGroupsForUser", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listGroupsForUser");
 
 	// first check if groups list is cached
 	maybeReturnCachedCategoryMembers(groupByUserCache,user);
@@ -2083,7 +2006,7 @@ std::vector<Group> PersistentStore::listGroupsForUser(const std::string& user){
 	databaseQueries++;
 
 	Aws::DynamoDB::Model::QueryOutcome outcome;
-	outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 			       .WithTableName(userTableName)
 			       .WithKeyConditionExpression("ID = :user_val")
 			       .WithFilterExpression("attribute_exists(#groupID)")
@@ -2094,14 +2017,12 @@ std::vector<Group> PersistentStore::listGroupsForUser(const std::string& user){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to list groups by user: " << err);
 		return vos;
 	}
 
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return vos;
 	}
 
@@ -2119,16 +2040,11 @@ std::vector<Group> PersistentStore::listGroupsForUser(const std::string& user){
 	}
 	groupByUserCache.update_expiration(user,std::chrono::steady_clock::now()+groupCacheValidity);
 
-	span->End();
 	return vos;
 }
 
 Group PersistentStore::findGroupByID(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findGroupByID", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findGroupByID");
 	log_info("find group: " << id);
 	//first see if we have this cached
 	{
@@ -2138,7 +2054,6 @@ Group PersistentStore::findGroupByID(const std::string& id){
 			if(record){ //it is, just return it
 				log_info("found group: " << id);
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -2148,20 +2063,18 @@ Group PersistentStore::findGroupByID(const std::string& id){
 	databaseQueries++;
 	log_info("Querying database for Group " << id);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 	                              .WithTableName(groupTableName)
 	                              .WithKey({{"ID",AttributeValue(id)},
 	                                        {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch Group record: " << err);
 		return Group();
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) { //no match found
-		span->End();
 		return Group{};
 	}
 	Group group;
@@ -2178,16 +2091,11 @@ Group PersistentStore::findGroupByID(const std::string& id){
 	replaceCacheRecord(groupCache,group.id,record);
 	replaceCacheRecord(groupByNameCache,group.name,record);
 	
-	span->End();
 	return group;
 }
 
 Group PersistentStore::findGroupByName(const std::string& name){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findGroupByName", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findGroupByName");
 
 	//first see if we have this cached
 	{
@@ -2196,7 +2104,6 @@ Group PersistentStore::findGroupByName(const std::string& name){
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -2205,7 +2112,7 @@ Group PersistentStore::findGroupByName(const std::string& name){
 	databaseQueries++;
 	log_info("Querying database for Group " << name);
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	auto outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 	                            .WithTableName(groupTableName)
 	                            .WithIndexName("ByName")
 	                            .WithKeyConditionExpression("#name = :name_val")
@@ -2215,19 +2122,16 @@ Group PersistentStore::findGroupByName(const std::string& name){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to look up Group by name: " << err);
 		return Group();
 	}
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return Group();
 	}
 	if(queryResult.GetCount()>1) {
 		const auto& err = "Group name \"" + name + "\" is not unique!";
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	
@@ -2246,52 +2150,35 @@ Group PersistentStore::findGroupByName(const std::string& name){
 	replaceCacheRecord(groupCache,group.id,record);
 	replaceCacheRecord(groupByNameCache,group.name,record);
 
-	span->End();
 	return group;
 }
 
 Group PersistentStore::getGroup(const std::string& idOrName){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getGroup");
 
 	if(idOrName.find(IDGenerator::groupIDPrefix)==0) {
-		span->End();
 		return findGroupByID(idOrName);
 	}
 	
-	span->End();
 	return findGroupByName(idOrName);
 }
 
 //----
 
 SharedFileHandle PersistentStore::configPathForCluster(const std::string& cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::configPathForCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::configPathForCluster");
 
 	if(!findClusterByID(cID)) { //need to do this to ensure local data is fresh
 		const std::string& err = cID + " does not exist; cannot get config data";
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	
-	span->End();
 	return clusterConfigs.find(cID);
 }
 
 bool PersistentStore::addCluster(const Cluster& cluster){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addCluster");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 	auto request=Aws::DynamoDB::Model::PutItemRequest()
@@ -2306,11 +2193,10 @@ bool PersistentStore::addCluster(const Cluster& cluster){
 		{"owningOrganization",AttributeValue(cluster.owningOrganization)},
 		{"monCredential",AttributeValue(cluster.monitoringCredential.serialize())},
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add cluster record: " << err);
 		return false;
 	}
@@ -2319,44 +2205,35 @@ bool PersistentStore::addCluster(const Cluster& cluster){
 	replaceCacheRecord(clusterCache,cluster.id,record);
 	replaceCacheRecord(clusterByNameCache,cluster.name,record);
 	clusterByGroupCache.insert_or_assign(cluster.owningGroup,record);
-	writeClusterConfigToDisk(cluster);
+	storeClusterConfig(cluster);
+	cacheClusterSummary(cluster);
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Add,cluster.id,{cluster.owningGroup});
 	return true;
 }
 
-void PersistentStore::writeClusterConfigToDisk(const Cluster& cluster){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::writeClusterConfigToDisk", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+void PersistentStore::storeClusterConfig(const Cluster& cluster){
+	SpanGuard span(tracer, "PersistentStore::storeClusterConfig");
 
-	FileHandle file=makeTemporaryFile(clusterConfigDir+"/"+cluster.id+"_v");
-	std::ofstream confFile(file.path());
-	if(!confFile) {
-		const std::string& err = "Unable to open " + file.path() + " for writing";
+	FileHandle file;
+	try{
+		file=makeMemoryFile(clusterConfigDir+"/"+cluster.id+"_v",cluster.config);
+	}catch(std::runtime_error& ex){
+		const std::string& err = "Unable to write cluster config: " + std::string(ex.what());
 		setSpanError(span, err);
-		span->End();
-		log_fatal(err);
-	}
-	confFile << cluster.config;
-	if(confFile.fail()) {
-		const std::string& err = "Unable to write cluster config to " + file.path();
-		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	
 	replaceCacheRecord(clusterConfigs,cluster.id,std::make_shared<FileHandle>(std::move(file)));
 }
 
+void PersistentStore::cacheClusterSummary(Cluster cluster){
+	cluster.config.clear();
+	replaceCacheRecord(clusterSummaryCache,cluster.id,CacheRecord<Cluster>(cluster,clusterCacheValidity));
+}
+
 Cluster PersistentStore::findClusterByID(const std::string& cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findClusterByID", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findClusterByID");
 
 	log_info("Querying for " << cID);
 	//first see if we have this cached
@@ -2367,7 +2244,6 @@ Cluster PersistentStore::findClusterByID(const std::string& cID){
 			if(record){ //it is, just return it
 				log_info("Found " << cID);
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -2377,20 +2253,18 @@ Cluster PersistentStore::findClusterByID(const std::string& cID){
 	using Aws::DynamoDB::Model::AttributeValue;
 	databaseQueries++;
 	log_info("Querying database for cluster " << cID);
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(clusterTableName)
 								  .WithKey({{"ID",AttributeValue(cID)},
 	                                        {"sortKey",AttributeValue(cID)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch cluster record: " << err);
 		return Cluster();
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) { //no match found
-		span->End();
 		return Cluster{};
 	}
 	Cluster cluster;
@@ -2408,18 +2282,14 @@ Cluster PersistentStore::findClusterByID(const std::string& cID){
 	replaceCacheRecord(clusterCache,cluster.id,record);
 	clusterByNameCache.insert_or_assign(cluster.name,record);
 	clusterByGroupCache.insert_or_assign(cluster.owningGroup,record);
-	writeClusterConfigToDisk(cluster);
+	storeClusterConfig(cluster);
+	cacheClusterSummary(cluster);
 	
-	span->End();
 	return cluster;
 }
 
 Cluster PersistentStore::findClusterByName(const std::string& name){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findClusterByName", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findClusterByName");
 
 	//first see if we have this cached
 	{
@@ -2428,7 +2298,6 @@ Cluster PersistentStore::findClusterByName(const std::string& name){
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -2437,7 +2306,7 @@ Cluster PersistentStore::findClusterByName(const std::string& name){
 	using AV=Aws::DynamoDB::Model::AttributeValue;
 	databaseQueries++;
 	log_info("Querying database for cluster " << name);
-	auto outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	auto outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 	                            .WithTableName(clusterTableName)
 	                            .WithIndexName("ByName")
 	                            .WithKeyConditionExpression("#name = :name_val")
@@ -2447,19 +2316,16 @@ Cluster PersistentStore::findClusterByName(const std::string& name){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to look up Cluster by name: " << err);
 		return Cluster();
 	}
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return Cluster();
 	}
 	if(queryResult.GetCount()>1) {
 		const std::string& err = "Cluster name \"" + name + "\" is not unique!";
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	
@@ -2483,34 +2349,24 @@ Cluster PersistentStore::findClusterByName(const std::string& name){
 	replaceCacheRecord(clusterCache,cluster.id,record);
 	clusterByNameCache.insert_or_assign(cluster.name,record);
 	clusterByGroupCache.insert_or_assign(cluster.owningGroup,record);
-	writeClusterConfigToDisk(cluster);
+	storeClusterConfig(cluster);
+	cacheClusterSummary(cluster);
 
-	span->End();
 	return cluster;
 }
 
 Cluster PersistentStore::getCluster(const std::string& idOrName){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getCluster");
 
 	if(idOrName.find(IDGenerator::clusterIDPrefix)==0) {
-		span->End();
 		return findClusterByID(idOrName);
 	}
 	
-	span->End();
 	return findClusterByName(idOrName);
 }
 
 bool PersistentStore::removeCluster(const std::string& cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeCluster");
 
 	//remove all records of groups granted access to the cluster
 	for (const auto &guest: listGroupsAllowedOnCluster(cID)) {
@@ -2535,47 +2391,42 @@ bool PersistentStore::removeCluster(const std::string& cID){
 		}
 	}
 	clusterCache.erase(cID);
+	clusterSummaryCache.erase(cID);
 	clusterConfigs.erase(cID);
 	clusterLocationCache.erase(cID);
 	
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 								     .WithTableName(clusterTableName)
 								     .WithKey({{"ID",AttributeValue(cID)},
 	                                           {"sortKey",AttributeValue(cID)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete cluster record: " << err);
 		return false;
 	}
-	outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 								.WithTableName(clusterTableName)
 								.WithKey({{"ID",AttributeValue(cID)},
 	                                      {"sortKey",AttributeValue(cID+":Locations")}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete cluster location record: " << err);
 		return false;
 	}
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Remove,cID);
 	return true;
 }
 
 bool PersistentStore::updateCluster(const Cluster& cluster){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::updateCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::updateCluster");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
 	using AVU=Aws::DynamoDB::Model::AttributeValueUpdate;
-	auto outcome=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+	auto outcome=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
 	                                 .WithTableName(clusterTableName)
 	                                 .WithKey({{"ID",AV(cluster.id)},
 	                                           {"sortKey",AV(cluster.id)}})
@@ -2590,7 +2441,6 @@ bool PersistentStore::updateCluster(const Cluster& cluster){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to update cluster record: " << err);
 		return false;
 	}
@@ -2600,24 +2450,21 @@ bool PersistentStore::updateCluster(const Cluster& cluster){
 	replaceCacheRecord(clusterCache,cluster.id,record);
 	clusterByNameCache.insert_or_assign(cluster.name,record);
 	clusterByGroupCache.insert_or_assign(cluster.owningGroup,record);
-	writeClusterConfigToDisk(cluster);
+	storeClusterConfig(cluster);
+	cacheClusterSummary(cluster);
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cluster.id,{cluster.owningGroup});
 	return true;
 }
 
 std::vector<Cluster> PersistentStore::listClusters(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listClusters", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listClusters");
 
 	std::vector<Cluster> collected;
 
 	// first check if clusters are cached
 	if(clusterCacheExpirationTime.load() > std::chrono::steady_clock::now()){
-		auto table = clusterCache.lock_table();
+		auto table = clusterSummaryCache.lock_table();
 		for(auto itr = table.cbegin(); itr != table.cend(); itr++){
 			auto cluster = itr->second;
 			cacheHits++;
@@ -2626,7 +2473,6 @@ std::vector<Cluster> PersistentStore::listClusters(){
 		
 		table.unlock();
 		
-		span->End();
 		return collected;
 	}
 
@@ -2635,14 +2481,16 @@ std::vector<Cluster> PersistentStore::listClusters(){
 	request.SetTableName(clusterTableName);
 	request.SetFilterExpression("attribute_not_exists(#groupID) AND attribute_exists(#name)");
 	request.SetExpressionAttributeNames({{"#groupID", "groupID"},{"#name","name"}});
+	//leave out the configs, which are large and are only needed to contact 
+	//the clusters
+	request.SetProjectionExpression("ID, #name, owningGroup, systemNamespace, owningOrganization, monCredential");
 	bool keepGoing=false;
 	
 	do{
-		auto outcome=dbClient.Scan(request);
+		auto outcome=dbClient->Scan(request);
 		if(!outcome.IsSuccess()){
 			const auto& err = outcome.GetError().GetMessage();
 			setSpanError(span, err);
-			span->End();
 			log_error("Failed to fetch cluster records: " << err);
 			return collected;
 		}
@@ -2661,31 +2509,20 @@ std::vector<Cluster> PersistentStore::listClusters(){
 			cluster.id=findOrThrow(item,"ID","Cluster record missing ID attribute").GetS();
 			cluster.name=findOrThrow(item,"name","Cluster record missing name attribute").GetS();
 			cluster.owningGroup=findOrThrow(item,"owningGroup","Cluster record missing owningGroup attribute").GetS();
-			cluster.config=findOrThrow(item,"config","Cluster record missing config attribute").GetS();
 			cluster.systemNamespace=findOrThrow(item,"systemNamespace","Cluster record missing systemNamespace attribute").GetS();
 			cluster.owningOrganization=findOrDefault(item,"owningOrganization",missingString).GetS();
 			cluster.monitoringCredential=S3Credential::deserialize(findOrDefault(item,"monCredential",missingString).GetS());
 			collected.push_back(cluster);
-			
-			CacheRecord<Cluster> record(cluster,clusterCacheValidity);
-			replaceCacheRecord(clusterCache,cluster.id,record);
-			clusterByNameCache.insert_or_assign(cluster.name,record);
-			clusterByGroupCache.insert_or_assign(cluster.owningGroup,record);
-			writeClusterConfigToDisk(cluster);
+			cacheClusterSummary(cluster);
 		}
 	}while(keepGoing);
 	clusterCacheExpirationTime=std::chrono::steady_clock::now()+clusterCacheValidity;
 	
-	span->End();
 	return collected;
 }
 
 std::vector<Cluster> PersistentStore::listClustersByGroup(std::string group){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listClustersByGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listClustersByGroup");
 
 	std::vector<Cluster> collected;
 
@@ -2695,7 +2532,6 @@ std::vector<Cluster> PersistentStore::listClustersByGroup(std::string group){
 		Group group_=findGroupByName(group);
 		//if no such Group exists it does not have clusters associated with it
 		if(!group_) {
-			span->End();
 			return collected;
 		}
 		//otherwise, get the actual Group ID and continue with the operation
@@ -2709,35 +2545,23 @@ std::vector<Cluster> PersistentStore::listClustersByGroup(std::string group){
 		}
 	}
 
-	span->End();
 	return collected;
 }
 
 bool PersistentStore::addGroupToCluster(std::string groupID, std::string cID) {
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addGroupToCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addGroupToCluster");
 
 	//check whether the Group 'ID' we got was actually a name
 	if (!normalizeGroupID(groupID, true)) {
 		setSpanError(span, "Can't normalize groupID");
-		span->End();
 		return false;
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if (!normalizeClusterID(cID)) {
 		setSpanError(span, "Can't normalize clusterID");
-		span->End();
 		return false;
 	}
 	
-	//remove any negative cache entry
-	//HACK: a special record with a trailing dash is used to indicate that the 
-	//group is known _not_ to have access
-	clusterGroupAccessCache.erase(cID,CacheRecord<std::string>(groupID+"-"));
-	
 	using Aws::DynamoDB::Model::AttributeValue;
 	auto request=Aws::DynamoDB::Model::PutItemRequest()
 	.WithTableName(clusterTableName)
@@ -2746,121 +2570,71 @@ bool PersistentStore::addGroupToCluster(std::string groupID, std::string cID) {
 		{"sortKey",AttributeValue(cID+":"+groupID)},
 		{"groupID",AttributeValue(groupID)}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add Group cluster access record: " << err);
 		return false;
 	}
 	
-	//update cache
-	CacheRecord<std::string> record(groupID,clusterCacheValidity);
-	clusterGroupAccessCache.insert_or_assign(cID,record);
+	updateAccessIndex([=](AccessIndex& index){ index.setGroupAccess(cID,groupID,true); });
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID,{groupID});
 	return true;
 }
 
 bool PersistentStore::removeGroupFromCluster(std::string groupID, std::string cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeGroupFromCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeGroupFromCluster");
 
 	//check whether the Group 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID,true)) {
 		setSpanError(span, "Can't normalize groupID");
-		span->End();
 		return false;
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)) {
 		setSpanError(span, "Can't normalize clusterID");
-		span->End();
 		return false;
 	}
 	
-	//remove any cache entry
-	clusterGroupAccessCache.erase(cID,CacheRecord<std::string>(groupID));
-	
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 	                                 .WithTableName(clusterTableName)
 	                                 .WithKey({{"ID",AttributeValue(cID)},
 	                                           {"sortKey",AttributeValue(cID+":"+groupID)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete Group cluster access record: " << err);
 		return false;
 	}
 	
-	//Make a cache entry
-	//HACK: group names (and IDs) may not end with a dash, so we use such a 
-	//record to indicate that a group is known _not_ to have access
-	CacheRecord<std::string> record(groupID+"-",clusterCacheValidity);
-	clusterGroupAccessCache.insert_or_assign(cID,record);
+	updateAccessIndex([=](AccessIndex& index){ index.setGroupAccess(cID,groupID,false); });
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID,{groupID});
 	return true;
 }
 
 std::vector<std::string> PersistentStore::listGroupsAllowedOnCluster(std::string cID, bool useNames){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listGroupsAllowedOnCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listGroupsAllowedOnCluster");
 
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)) {
-		span->End();
 		return {}; //A nonexistent cluster cannot have any allowed groups
 	}
-	//check for a wildcard record
-	if(clusterAllowsAllGroups(cID)){
-		if(useNames) {
-			span->End();
-			return {wildcardName};
-		}
-		
-		span->End();
-		return {wildcard};
-	}
-	
-	using Aws::DynamoDB::Model::AttributeValue;
-	databaseQueries++;
-	log_info("Querying database for groups allowed on cluster " << cID);
-	auto request=Aws::DynamoDB::Model::QueryRequest()
-	.WithTableName(clusterTableName)
-	.WithKeyConditionExpression("#id = :id AND begins_with(#sortKey,:prefix)")
-	.WithExpressionAttributeNames({
-		{"#id","ID"},
-		{"#sortKey","sortKey"}
-	})
-	.WithExpressionAttributeValues({
-		{":id",AttributeValue(cID)},
-		{":prefix",AttributeValue(cID+":"+IDGenerator::groupIDPrefix)}
-	});
-	auto outcome=dbClient.Query(request);
 	std::vector<std::string> vos;
-	if(!outcome.IsSuccess()){
-		const auto& err = outcome.GetError().GetMessage();
-		setSpanError(span, err);
-		span->End();
-		log_error("Failed to fetch cluster's Group whitelist records: " << err);
-		return vos;
-	}
-	
-	const auto& queryResult=outcome.GetResult();
-	for(const auto& item : queryResult.GetItems()){
-		if (item.count("groupID")) {
-			vos.push_back(item.find("groupID")->second.GetS());
+	{
+		auto lock=lockAccessIndex();
+		//check for a wildcard record
+		if(accessIndex.allowsAllGroups(cID)){
+			if(useNames) {
+				return {wildcardName};
+			}
+			
+			return {wildcard};
 		}
+		vos=accessIndex.groupsWithAccess(cID);
 	}
 	
 	if(useNames){
@@ -2871,249 +2645,64 @@ std::vector<std::string> PersistentStore::listGroupsAllowedOnCluster(std::string
 		}
 	}
 
-	span->End();
 	return vos;
 }
 
 bool PersistentStore::groupAllowedOnCluster(std::string groupID, std::string cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::groupAllowedOnCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::groupAllowedOnCluster");
 
-	//TODO: possible issue: We only store memberships, so repeated queries about
-	//a Group's access to a cluster to which it does not have access belong will
-	//never be in the cache, and will always incur a database query. This should
-	//not be a problem for normal/well intentioned use, but seems like a way to
-	//turn accident or malice into denial of service or a large AWS bill. 
-	
 	//check whether the 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID)) {
 		setSpanError(span, "Can't normalize groupID");
-		span->End();
 		return false;
 	}
 	if(!normalizeClusterID(cID)) {
 		setSpanError(span, "Can't normalize clusterID");
-		span->End();
 		return false;
 	}
 	
-	//before checking for the specific Group, see if a wildcard record exists
-	if(clusterAllowsAllGroups(cID)) {
-		span->End();
-		return true;
-	}
-	//if no wildcard, look for the specific cluster
-	//first see if we have this cached
-	{
-		CacheRecord<std::string> record(groupID);
-		if(clusterGroupAccessCache.find(cID,record)){
-			//we have a cached record; is it still valid?
-			if(record){ //it is, just return it
-				cacheHits++;
-				span->End();
-				return true;
-			}
-		}
-	}
-	{ //HACK: look for a special record with a trailing dash to indicate that 
-		//the group is known _not_ to have access
-		CacheRecord<std::string> record(groupID+"-");
-		if(clusterGroupAccessCache.find(cID,record)){
-			//we have a cached record; is it still valid?
-			if(record){ //it is, just return it
-				cacheHits++;
-				span->End();
-				return false;
-			}
-		}
-	}
-	//need to query the database
-	databaseQueries++;
-	log_info("Querying database for Group " << groupID << " access to cluster " << cID);
-	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
-								  .WithTableName(clusterTableName)
-								  .WithKey({{"ID",AttributeValue(cID)},
-	                                        {"sortKey",AttributeValue(cID+":"+groupID)}}));
-	if(!outcome.IsSuccess()){
-		const auto& err = outcome.GetError().GetMessage();
-		setSpanError(span, err);
-		span->End();
-		log_error("Failed to fetch cluster Group access record: " << err);
-		return false;
-	}
-	const auto& item=outcome.GetResult().GetItem();
-	if(item.empty()){ //no match found
-		//update cache
-		//HACK: group names (and IDs) may not end with a dash, so we use such a 
-		//record to indicate that a group is known _not_ to have access
-		CacheRecord<std::string> record(groupID+"-",clusterCacheValidity);
-		clusterGroupAccessCache.insert_or_assign(cID,record);
-		span->End();
-		return false;
-	}
-	
-	//update cache
-	CacheRecord<std::string> record(groupID,clusterCacheValidity);
-	clusterGroupAccessCache.insert_or_assign(cID,record);
-	
-	span->End();
-	return true;
+	//the index covers both wildcard and specific records, including the 
+	//absence of a record, so no check requires a database query
+	auto lock=lockAccessIndex();
+	return accessIndex.groupHasAccess(cID,groupID);
 }
 
 bool PersistentStore::clusterAllowsAllGroups(std::string cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::clusterAllowsAllGroups", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
-
-	{ //check cache first
-		CacheRecord<std::string> record(wildcard);
-		if(clusterGroupAccessCache.find(cID,record)){
-			//we have a cached record; is it still valid?
-			if(record){ //it is, just return it
-				cacheHits++;
-				span->End();
-				return record;
-			}
-		}
-	}
-	{ //HACK: look for a special record with a trailing dash to indicate that 
-		//the group is known _not_ to have access
-		CacheRecord<std::string> record(wildcard+"-");
-		if(clusterGroupAccessCache.find(cID,record)){
-			//we have a cached record; is it still valid?
-			if(record){ //it is, just return it
-				cacheHits++;
-				span->End();
-				return false;
-			}
-		}
-	}
-	//query the database
-	databaseQueries++;
-	log_info("Querying database for wildcard access to cluster " << cID);
-	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
-								  .WithTableName(clusterTableName)
-								  .WithKey({{"ID",AttributeValue(cID)},
-	                                        {"sortKey",AttributeValue(cID+":"+wildcard)}}));
-	if(!outcome.IsSuccess()){
-		const auto& err = outcome.GetError().GetMessage();
-		setSpanError(span, err);
-		span->End();
-		log_error("Failed to fetch cluster Group access record: " << err);
-		return false;
-	}
-	const auto& item=outcome.GetResult().GetItem();
-	if(item.empty()){ //no match found
-		//update cache
-		//HACK: group names (and IDs) may not end with a dash, so we use such a 
-		//record to indicate that a group is known _not_ to have access
-		CacheRecord<std::string> record(wildcard+"-",clusterCacheValidity);
-		clusterGroupAccessCache.insert_or_assign(cID,record);
-		span->End();
-		return false;
-	}
-	//update cache
-	CacheRecord<std::string> record(wildcard,clusterCacheValidity);
-	clusterGroupAccessCache.insert_or_assign(cID,record);
+	SpanGuard span(tracer, "PersistentStore::clusterAllowsAllGroups");
 
-	span->End();
-	return true;
+	auto lock=lockAccessIndex();
+	return accessIndex.allowsAllGroups(cID);
 }
 
 std::set<std::string> PersistentStore::listApplicationsGroupMayUseOnCluster(std::string groupID, std::string cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listApplicationsGroupMayUseOnCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listApplicationsGroupMayUseOnCluster");
 
 	//check whether the Group 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID,true)) {
 		setSpanError(span, "Can't normalize groupID");
-		span->End();
 		return {};
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)) {
 		setSpanError(span, "Can't normalize clusterID");
-		span->End();
-		return {};
-	}
-	
-	std::string sortKey=cID+":"+groupID+":Applications";
-	
-	{ //check cache first
-		CacheRecord<std::set<std::string>> record;
-		if(clusterGroupApplicationCache.find(sortKey,record)){
-			//we have a cached record; is it still valid?
-			if(record){ //it is, just return it
-				cacheHits++;
-				span->End();
-				return record;
-			}
-		}
-	}
-	//query the database
-	databaseQueries++;
-	log_info("Querying database for applications " << groupID << " may use on " << cID);
-	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
-								  .WithTableName(clusterTableName)
-								  .WithKey({{"ID",AttributeValue(cID)},
-	                                        {"sortKey",AttributeValue(sortKey)}}));
-	if(!outcome.IsSuccess()){
-		const auto& err = outcome.GetError().GetMessage();
-		setSpanError(span, err);
-		span->End();
-		log_error("Failed to fetch Group application use record: " << err);
 		return {};
 	}
-	std::set<std::string> result;
-	const auto& item=outcome.GetResult().GetItem();
-	if(item.empty()){ //no record found, treat this as all allowed
-		log_info("Found no record of allowed applications for " << groupID << " on " << cID << ", treating as universal");
-		result={wildcardName};
-	}
-	else{
-		auto applications=findOrThrow(item,"applications","Cluster record missing applications attribute").GetSS();
-		result=std::set<std::string>(applications.begin(),applications.end());
-		if (result.count("<none>")) {
-			result = {};
-		}
-	}
-	//update cache
-	CacheRecord<std::set<std::string>> record(result,clusterCacheValidity);
-	replaceCacheRecord(clusterGroupApplicationCache,sortKey,record);
-
 	
-	span->End();
-	return result;
+	auto lock=lockAccessIndex();
+	return accessIndex.applications(cID,groupID);
 }
 
 bool PersistentStore::allowVoToUseApplication(std::string groupID, std::string cID, std::string appName){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::allowVoToUseApplication", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::allowVoToUseApplication");
 
 	//check whether the Group 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID,true)) {
 		setSpanError(span, "Can't normalize groupID");
-		span->End();
 		return false;
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)) {
 		setSpanError(span, "Can't normalize clusterID");
-		span->End();
 		return false;
 	}
 	if (appName == wildcard) {
@@ -3149,34 +2738,26 @@ bool PersistentStore::allowVoToUseApplication(std::string groupID, std::string c
 		{"sortKey",AttributeValue(sortKey)},
 		{"applications",value}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add Group record: " << err);
 		return false;
 	}
 	
-	//update cache
-	CacheRecord<std::set<std::string>> record(allowed,clusterCacheValidity);
-	replaceCacheRecord(clusterGroupApplicationCache,sortKey,record);
+	updateAccessIndex([=](AccessIndex& index){ index.setApplications(cID,groupID,allowed); });
 
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID,{groupID});
 	return true;
 }
 
 bool PersistentStore::denyGroupUseOfApplication(std::string groupID, std::string cID, std::string appName){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::denyGroupUseOfApplication", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::denyGroupUseOfApplication");
 
 	//check whether the Group 'ID' we got was actually a name
 	if(!normalizeGroupID(groupID,true)){
 		setSpanError(span, "Invalid Group name");
-		span->End();
 		log_error("Invalid Group name");
 		return false;
 	}
@@ -3184,7 +2765,6 @@ bool PersistentStore::denyGroupUseOfApplication(std::string groupID, std::string
 	if(!normalizeClusterID(cID)){
 		const auto& err = "Invalid cluster name";
 		setSpanError(span, err);
-		span->End();
 		log_error(err);
 		return false;
 	}
@@ -3202,10 +2782,8 @@ bool PersistentStore::denyGroupUseOfApplication(std::string groupID, std::string
 	if (appName == wildcardName) {
 		allowed = {}; //revoking all permission, replace with empty set
 	} else if (allowed.count(wildcardName)) {
-		span->End();
 		return false; //removing permission for one application while all others are allowed is not supported
 	} else if (!allowed.count(appName)) {
-		span->End();
 		return false; //can't remove permission for something already forbidden
 	} else {
 		allowed.erase(appName);
@@ -3227,53 +2805,170 @@ bool PersistentStore::denyGroupUseOfApplication(std::string groupID, std::string
 		{"sortKey",AttributeValue(sortKey)},
 		{"applications",value}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to remove Group application use record: " << err);
 		return false;
 	}
 	
-	//update cache
-	CacheRecord<std::set<std::string>> record(allowed,clusterCacheValidity);
-	replaceCacheRecord(clusterGroupApplicationCache,sortKey,record);
+	updateAccessIndex([=](AccessIndex& index){ index.setApplications(cID,groupID,allowed); });
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID,{groupID});
 	return true;
 }
 
 bool PersistentStore::groupMayUseApplication(std::string groupID, std::string cID, std::string appName){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::groupMayUseApplication", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::groupMayUseApplication");
 
-	//no need to normalize groupID/cID because listApplicationsGroupMayUseOnCluster will do it
-	auto allowed=listApplicationsGroupMayUseOnCluster(groupID,cID);
-	if(allowed.count(wildcardName)) {
-		span->End();
-		return true;
+	//check whether the Group 'ID' we got was actually a name
+	if(!normalizeGroupID(groupID,true)) {
+		setSpanError(span, "Can't normalize groupID");
+		return false;
+	}
+	//check whether the cluster 'ID' we got was actually a name
+	if(!normalizeClusterID(cID)) {
+		setSpanError(span, "Can't normalize clusterID");
+		return false;
 	}
 	
-	span->End();
-	return allowed.count(appName);
+	auto lock=lockAccessIndex();
+	return accessIndex.applicationAllowed(cID,groupID,appName);
+}
+
+std::unique_lock<std::mutex> PersistentStore::lockAccessIndex(){
+	std::unique_lock<std::mutex> lock(accessIndexMut);
+	while(accessIndexLoading && !accessIndexReady){
+		//use the result of the first load already in progress, even if it 
+		//failed, rather than immediately trying again
+		accessIndexLoaded.wait(lock);
+		if(!accessIndexLoading)
+			return lock;
+	}
+	if(std::chrono::steady_clock::now()<accessIndexExpiration){
+		cacheHits++;
+		return lock;
+	}
+	if(accessIndexLoading) //a reload is already running in the background
+		return lock;
+	
+	accessIndexLoading=true;
+	accessIndexInvalidated=false;
+	if(!accessIndexReady){
+		//there is nothing to use until the first load finishes
+		reloadAccessIndex(lock);
+		return lock;
+	}
+	//keep serving the current contents, and bring them up to date in the 
+	//background
+	accessIndexReload=std::async(std::launch::async,[this](){
+		std::unique_lock<std::mutex> lock(accessIndexMut);
+		reloadAccessIndex(lock);
+	}).share();
+	return lock;
+}
+
+void PersistentStore::reloadAccessIndex(std::unique_lock<std::mutex>& lock){
+	lock.unlock();
+	AccessIndex loaded(wildcard,wildcardName);
+	bool success=false;
+	try{
+		success=loadAccessIndex(loaded);
+	}catch(std::exception& ex){
+		log_error("Failed to load group access records: " << ex.what());
+	}
+	lock.lock();
+	if(success){
+		for(const auto& update : accessIndexUpdates)
+			update(loaded);
+		std::swap(accessIndex,loaded);
+		accessIndexReady=true;
+		if(!accessIndexInvalidated)
+			accessIndexExpiration=std::chrono::steady_clock::now()+clusterCacheValidity;
+	}
+	accessIndexUpdates.clear();
+	accessIndexLoading=false;
+	accessIndexLoaded.notify_all();
+}
+
+bool PersistentStore::loadAccessIndex(AccessIndex& index){
+	SpanGuard span(tracer, "PersistentStore::loadAccessIndex");
+
+	databaseScans++;
+	log_info("Scanning database for group access records");
+	using Aws::DynamoDB::Model::AttributeValue;
+	auto request=Aws::DynamoDB::Model::ScanRequest()
+	.WithTableName(clusterTableName)
+	.WithProjectionExpression("#id, #sortKey, groupID, applications")
+	.WithFilterExpression("attribute_exists(groupID) OR attribute_exists(applications)")
+	.WithExpressionAttributeNames({
+		{"#id","ID"},
+		{"#sortKey","sortKey"}
+	});
+	const std::string appSuffix=":Applications";
+	std::size_t records=0;
+	bool keepGoing=false;
+	do{
+		auto outcome=dbClient->Scan(request);
+		if(!outcome.IsSuccess()){
+			const auto& err = outcome.GetError().GetMessage();
+			setSpanError(span, err);
+			log_error("Failed to fetch group access records: " << err);
+			return false;
+		}
+		const auto& result=outcome.GetResult();
+		//set up fetching the next page if necessary
+		if(!result.GetLastEvaluatedKey().empty()){
+			keepGoing=true;
+			request.SetExclusiveStartKey(result.GetLastEvaluatedKey());
+		} else {
+			keepGoing=false;
+		}
+		for(const auto& item : result.GetItems()){
+			const std::string cID=findOrThrow(item,"ID","Cluster record missing ID attribute").GetS();
+			const std::string sortKey=findOrThrow(item,"sortKey","Cluster record missing sortKey attribute").GetS();
+			if(item.count("applications")){
+				if(sortKey.size()<cID.size()+1+appSuffix.size())
+					continue;
+				std::string groupID=sortKey.substr(cID.size()+1,sortKey.size()-cID.size()-1-appSuffix.size());
+				const auto& applications=item.find("applications")->second.GetSS();
+				std::set<std::string> allowed(applications.begin(),applications.end());
+				if(allowed.count("<none>"))
+					allowed.clear();
+				index.setApplications(cID,groupID,std::move(allowed));
+			}
+			else
+				index.setGroupAccess(cID,item.find("groupID")->second.GetS(),true);
+			records++;
+		}
+	}while(keepGoing);
+	log_info("Loaded " << records << " group access records for " 
+	         << index.clusterCount() << " clusters");
+	return true;
+}
+
+void PersistentStore::updateAccessIndex(std::function<void(AccessIndex&)> update){
+	std::lock_guard<std::mutex> lock(accessIndexMut);
+	update(accessIndex);
+	if(accessIndexLoading)
+		accessIndexUpdates.push_back(std::move(update));
+}
+
+void PersistentStore::invalidateAccessIndex(){
+	std::lock_guard<std::mutex> lock(accessIndexMut);
+	accessIndexExpiration=std::chrono::steady_clock::time_point::min();
+	if(accessIndexLoading)
+		accessIndexInvalidated=true;
 }
 
 std::vector<GeoLocation> PersistentStore::getLocationsForCluster(std::string cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getLocationsForCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getLocationsForCluster");
 
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)){
 		const auto& err = "Invalid cluster name";
 		setSpanError(span, err);
-		span->End();
 		log_error(err);
 		return {};
 	}
@@ -3285,7 +2980,6 @@ std::vector<GeoLocation> PersistentStore::getLocationsForCluster(std::string cID
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -3295,14 +2989,13 @@ std::vector<GeoLocation> PersistentStore::getLocationsForCluster(std::string cID
 	databaseQueries++;
 	log_info("Querying database for locations associated with cluster " << cID);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(clusterTableName)
 								  .WithKey({{"ID",AttributeValue(cID)},
 	                                        {"sortKey",AttributeValue(sortKey)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch cluster location record: " << err);
 		return {};
 	}
@@ -3324,22 +3017,16 @@ std::vector<GeoLocation> PersistentStore::getLocationsForCluster(std::string cID
 	CacheRecord<std::vector<GeoLocation>> record(result,clusterCacheValidity);
 	replaceCacheRecord(clusterLocationCache,cID,record);
 	
-	span->End();
 	return result;
 }
 
 bool PersistentStore::setLocationsForCluster(std::string cID, const std::vector<GeoLocation>& locations){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::setLocationsForCluster", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::setLocationsForCluster");
 
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)){
 		const auto& err = "Invalid cluster name";
 		setSpanError(span, err);
-		span->End();
 		log_error(err);
 		return {};
 	}
@@ -3358,11 +3045,10 @@ bool PersistentStore::setLocationsForCluster(std::string cID, const std::vector<
 		{"sortKey",AttributeValue(sortKey)},
 		{"locations",value}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to store cluster location record: " << err);
 		return false;
 	}
@@ -3371,19 +3057,154 @@ bool PersistentStore::setLocationsForCluster(std::string cID, const std::vector<
 	CacheRecord<std::vector<GeoLocation>> record(locations,clusterCacheValidity);
 	replaceCacheRecord(clusterLocationCache,cID,record);
 
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID);
 	return true;
 }
 
+namespace{
+	///The ID under which geocoding results are stored in the cluster table, 
+	///with the rounded coordinates as the sort key
+	const std::string geocodeRecordID="Geocode";
+	
+	///Round coordinates to about 100 meters, which is much finer than the 
+	///descriptions derived from them, so that nearby locations share results
+	std::string geocodeKey(const GeoLocation& loc){
+		auto format=[](double coordinate){
+			long long value=std::llround(coordinate*1000);
+			std::string sign=(value<0?"-":"");
+			value=std::llabs(value);
+			std::string fraction=std::to_string(value%1000);
+			return sign+std::to_string(value/1000)+"."+std::string(3-fraction.size(),'0')+fraction;
+		};
+		return format(loc.lat)+","+format(loc.lon);
+	}
+}
+
+Geocoder::GeocodeResult PersistentStore::reverseGeocode(const GeoLocation& loc){
+	SpanGuard span(tracer, "PersistentStore::reverseGeocode");
+	
+	const std::string key=geocodeKey(loc);
+	{ //check cache first
+		CacheRecord<Geocoder::GeocodeResult> record;
+		if(geocodeCache.find(key,record) && record){
+			cacheHits++;
+			return record;
+		}
+	}
+	
+	//join a lookup of the same coordinates which is already in progress, or 
+	//start one
+	std::promise<Geocoder::GeocodeResult> promise;
+	std::shared_future<Geocoder::GeocodeResult> lookup;
+	{
+		std::lock_guard<std::mutex> lock(geocodeLookupMut);
+		auto it=geocodeLookups.find(key);
+		if(it!=geocodeLookups.end())
+			lookup=it->second;
+		else
+			geocodeLookups.emplace(key,promise.get_future().share());
+	}
+	if(lookup.valid())
+		return lookup.get();
+	
+	Geocoder::GeocodeResult result;
+	try{
+		//another lookup may have finished since the cache was checked
+		CacheRecord<Geocoder::GeocodeResult> record;
+		if(geocodeCache.find(key,record) && record)
+			result=record;
+		else
+			result=fetchGeocode(key,loc);
+		promise.set_value(result);
+	}catch(...){
+		promise.set_exception(std::current_exception());
+		std::lock_guard<std::mutex> lock(geocodeLookupMut);
+		geocodeLookups.erase(key);
+		throw;
+	}
+	std::lock_guard<std::mutex> lock(geocodeLookupMut);
+	geocodeLookups.erase(key);
+	return result;
+}
+
+Geocoder::GeocodeResult PersistentStore::fetchGeocode(const std::string& key, const GeoLocation& loc){
+	using Aws::DynamoDB::Model::AttributeValue;
+	using std::chrono::system_clock;
+	
+	databaseQueries++;
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	                               .WithTableName(clusterTableName)
+	                               .WithKey({{"ID",AttributeValue(geocodeRecordID)},
+	                                         {"sortKey",AttributeValue(key)}}));
+	if(!outcome.IsSuccess()) //not fatal, since the lookup can still be made
+		log_warn("Failed to fetch geocoding record: " << outcome.GetError().GetMessage());
+	else if(!outcome.GetResult().GetItem().empty()){
+		const auto& item=outcome.GetResult().GetItem();
+		//records written before the expiration time was stored as a number 
+		//have it as a string, which the database will not expire, so they
+		//are treated as expired in order to be replaced
+		const AttributeValue expirationValue=findOrDefault(item,"expirationTime",AttributeValue().SetN("0"));
+		auto expiration=system_clock::time_point(std::chrono::seconds(
+			expirationValue.GetType()==Aws::DynamoDB::Model::ValueType::NUMBER ? std::stoll(expirationValue.GetN()) : 0));
+		auto remaining=expiration-system_clock::now();
+		if(remaining>system_clock::duration::zero()){
+			const AttributeValue none("");
+			Geocoder::GeocodeResult result;
+			result.latitude=loc.lat;
+			result.longitude=loc.lon;
+			result.geonumber=0;
+			result.geocode=findOrDefault(item,"geocode",none).GetS();
+			result.timezone=findOrDefault(item,"timezone",none).GetS();
+			result.city=findOrDefault(item,"city",none).GetS();
+			result.countryCode=findOrDefault(item,"countryCode",none).GetS();
+			result.countryName=findOrDefault(item,"countryName",none).GetS();
+			CacheRecord<Geocoder::GeocodeResult> record(result,
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(remaining));
+			replaceCacheRecord(geocodeCache,key,record);
+			return result;
+		}
+	}
+	
+	log_info("Looking up geographic coordinates " << loc);
+	Geocoder::GeocodeResult result=geocoder.reverseLookup(loc);
+	if(!result) //do not remember failures, which may be temporary
+		return result;
+	
+	auto expiration=system_clock::now()+geocodeCacheValidity;
+	Aws::Map<Aws::String,AttributeValue> item{
+		{"ID",AttributeValue(geocodeRecordID)},
+		{"sortKey",AttributeValue(key)},
+		//a number, so that the database can delete the record once it expires
+		{"expirationTime",AttributeValue().SetN(std::to_string(
+			std::chrono::duration_cast<std::chrono::seconds>(expiration.time_since_epoch()).count()))}
+	};
+	//store only the fields which the service provided, since empty strings 
+	//cannot be stored
+	auto addField=[&item](const std::string& name, const std::string& value){
+		if(!value.empty())
+			item.emplace(name,AttributeValue(value));
+	};
+	addField("geocode",result.geocode);
+	addField("timezone",result.timezone);
+	addField("city",result.city);
+	addField("countryCode",result.countryCode);
+	addField("countryName",result.countryName);
+	auto putOutcome=dbClient->PutItem(Aws::DynamoDB::Model::PutItemRequest()
+	                                  .WithTableName(clusterTableName)
+	                                  .WithItem(item));
+	if(!putOutcome.IsSuccess())
+		log_warn("Failed to store geocoding record: " << putOutcome.GetError().GetMessage());
+	
+	CacheRecord<Geocoder::GeocodeResult> record(result,geocodeCacheValidity);
+	replaceCacheRecord(geocodeCache,key,record);
+	return result;
+}
+
 bool PersistentStore::setClusterMonitoringCredential(const std::string& cID, const S3Credential& cred){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::setClusterMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::setClusterMonitoringCredential");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+	auto outcome=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
 	                                 .WithTableName(clusterTableName)
 	                                 .WithKey({{"ID",AV(cID)},
 	                                           {"sortKey",AV(cID)}})
@@ -3397,7 +3218,6 @@ bool PersistentStore::setClusterMonitoringCredential(const std::string& cID, con
 		const auto& err = outcome.GetError().GetMessage();
 		
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to set monitoring credential for cluster: " << err);
 		return false;
 	}
@@ -3406,19 +3226,15 @@ bool PersistentStore::setClusterMonitoringCredential(const std::string& cID, con
 	clusterCache.erase(cID);
 	findClusterByID(cID);
 
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID);
 	return true;
 }
 
 bool PersistentStore::removeClusterMonitoringCredential(const std::string& cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeClusterMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeClusterMonitoringCredential");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+	auto outcome=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
 	                                 .WithTableName(clusterTableName)
 	                                 .WithKey({{"ID",AV(cID)},
 	                                           {"sortKey",AV(cID)}})
@@ -3430,7 +3246,6 @@ bool PersistentStore::removeClusterMonitoringCredential(const std::string& cID){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to remove monitoring credential for cluster: " << err);
 		return false;
 	}
@@ -3439,20 +3254,16 @@ bool PersistentStore::removeClusterMonitoringCredential(const std::string& cID){
 	clusterCache.erase(cID);
 	findClusterByID(cID);
 	
-	span->End();
+	recordChange(StoreCollection::Clusters,ChangeOperation::Update,cID);
 	return true;
 }
 
 Cluster PersistentStore::findClusterUsingCredential(const S3Credential& cred){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findClusterUsingCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findClusterUsingCredential");
 
 	databaseScans++;
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.Scan(Aws::DynamoDB::Model::ScanRequest()
+	auto outcome=dbClient->Scan(Aws::DynamoDB::Model::ScanRequest()
 								.WithTableName(clusterTableName)
 								.WithFilterExpression("#monCredential = :cred")
 								.WithExpressionAttributeNames({{"#monCredential","monCredential"}})
@@ -3461,13 +3272,11 @@ Cluster PersistentStore::findClusterUsingCredential(const S3Credential& cred){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to scan clusters: " << err);
 		return Cluster{};
 	}
 	
 	if(outcome.GetResult().GetItems().empty()) { //no match found
-		span->End();
 		return Cluster{};
 	}
 	const auto& item=outcome.GetResult().GetItems().front();
@@ -3487,25 +3296,20 @@ Cluster PersistentStore::findClusterUsingCredential(const S3Credential& cred){
 	replaceCacheRecord(clusterCache,cluster.id,record);
 	clusterByNameCache.insert_or_assign(cluster.name,record);
 	clusterByGroupCache.insert_or_assign(cluster.owningGroup,record);
-	writeClusterConfigToDisk(cluster);
+	storeClusterConfig(cluster);
+	cacheClusterSummary(cluster);
 
 	
-	span->End();
 	return cluster;
 }
 
 CacheRecord<bool> PersistentStore::getCachedClusterReachability(std::string cID){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getCachedClusterReachability", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getCachedClusterReachability");
 
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)){
 		const auto& err = "Invalid cluster name";
 		setSpanError(span, err);
-		span->End();
 		log_error(err);
 		return {};
 	}
@@ -3514,37 +3318,33 @@ CacheRecord<bool> PersistentStore::getCachedClusterReachability(std::string cID)
 	//if(record)
 	//	log_info("Found valid cluster reachability record in cache for " << cID);
 	
-	span->End();
 	return record;
 }
 
 void PersistentStore::cacheClusterReachability(std::string cID, bool reachable){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::cacheClusterReachability", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::cacheClusterReachability");
 
 	//check whether the cluster 'ID' we got was actually a name
 	if(!normalizeClusterID(cID)){
 		const auto& err = "Invalid cluster name";
 		setSpanError(span, err);
-		span->End();
 		log_error(err);
 		return;
 	}
+	CacheRecord<bool> previous;
+	bool known=clusterConnectivityCache.find(cID,previous);
 	CacheRecord<bool> record(reachable,clusterCacheValidity);
 	replaceCacheRecord(clusterConnectivityCache,cID,record);
+	//expired records still hold the last known state, so only transitions 
+	//are recorded
+	if(!known || previous.record!=reachable)
+		recordChange(StoreCollection::Clusters,
+		             reachable ? ChangeOperation::Reachable : ChangeOperation::Unreachable,cID);
 	
-	span->End();
 }
 
 bool PersistentStore::addApplicationInstance(const ApplicationInstance& inst){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addApplicationInstance", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addApplicationInstance");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 	auto request=Aws::DynamoDB::Model::PutItemRequest()
@@ -3558,29 +3358,34 @@ bool PersistentStore::addApplicationInstance(const ApplicationInstance& inst){
 		{"cluster",AttributeValue(inst.cluster)},
 		{"ctime",AttributeValue(inst.ctime)}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add application instance record: " << err);
 		return false;
 	}
 	//We assume that configs will be accessed less often than the rest of the 
 	//information about an instance, and they are relatively large, so we store
 	//them in separate, secondary items
+	const StoredConfig storedConfig=compressConfig(inst.config);
+	Aws::Map<Aws::String,AttributeValue> configItem{
+		{"ID",AttributeValue(inst.id)},
+		{"sortKey",AttributeValue(inst.id+":config")}
+	};
+	if(storedConfig.compressed){
+		configItem["config"]=AttributeValue().SetB(Aws::Utils::ByteBuffer((const unsigned char*)storedConfig.data.data(),storedConfig.data.size()));
+		configItem["configFormat"]=AttributeValue("gzip");
+	}
+	else
+		configItem["config"]=AttributeValue(storedConfig.data);
 	request=Aws::DynamoDB::Model::PutItemRequest()
 	.WithTableName(instanceTableName)
-	.WithItem({
-		{"ID",AttributeValue(inst.id)},
-		{"sortKey",AttributeValue(inst.id+":config")},
-		{"config",AttributeValue(inst.config)}
-	});
-	outcome=dbClient.PutItem(request);
+	.WithItem(configItem);
+	outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add application instance config record: " << err);
 		return false;
 	}
@@ -3592,18 +3397,18 @@ bool PersistentStore::addApplicationInstance(const ApplicationInstance& inst){
 	instanceByNameCache.insert_or_assign(inst.name,record);
 	instanceByClusterCache.insert_or_assign(inst.cluster,record);
 	instanceByGroupAndClusterCache.insert_or_assign(inst.owningGroup+":"+inst.cluster,record);
-	instanceConfigCache.insert(inst.id,inst.config,instanceCacheValidity);
+	replaceCacheRecord(instanceConfigCache,inst.id,CacheRecord<StoredConfig>(storedConfig,instanceCacheValidity));
 
-	span->End();
+	recordChange(StoreCollection::Instances,ChangeOperation::Add,inst.id,{inst.owningGroup,inst.cluster});
 	return true;
 }
 
 bool PersistentStore::removeApplicationInstance(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeApplicationInstance", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeApplicationInstance");
+
+	//note the group and cluster to which the instance belongs, so that their 
+	//generations can be updated
+	const ApplicationInstance removed=getApplicationInstance(id);
 
 	//erase cache entries
 	{
@@ -3628,39 +3433,33 @@ bool PersistentStore::removeApplicationInstance(const std::string& id){
 	}
 	
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 	                                      .WithTableName(instanceTableName)
 	                                      .WithKey({{"ID",AttributeValue(id)},
 	                                                {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete instance record: " << err);
 		return false;
 	}
-	outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 	                                      .WithTableName(instanceTableName)
 	                                      .WithKey({{"ID",AttributeValue(id)},
 	                                                {"sortKey",AttributeValue(id+":config")}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete instance config record: " << err);
 		return false;
 	}
 	
-	span->End();
+	recordChange(StoreCollection::Instances,ChangeOperation::Remove,id,{removed.owningGroup,removed.cluster});
 	return true;
 }
 
 ApplicationInstance PersistentStore::getApplicationInstance(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getApplicationInstance", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getApplicationInstance");
 
 	//first see if we have this cached
 	{
@@ -3669,7 +3468,6 @@ ApplicationInstance PersistentStore::getApplicationInstance(const std::string& i
 			//we have a cached record; is it still valid?
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -3678,20 +3476,18 @@ ApplicationInstance PersistentStore::getApplicationInstance(const std::string& i
 	databaseQueries++;
 	log_info("Querying database for instance " << id);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(instanceTableName)
 								  .WithKey({{"ID",AttributeValue(id)},
 	                                        {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch application instance record: " << err);
 		return ApplicationInstance();
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) { //no match found
-		span->End();
 		return ApplicationInstance{};
 	}
 	ApplicationInstance inst;
@@ -3711,26 +3507,20 @@ ApplicationInstance PersistentStore::getApplicationInstance(const std::string& i
 	instanceByClusterCache.insert_or_assign(inst.cluster,record);
 	instanceByGroupAndClusterCache.insert_or_assign(inst.owningGroup+":"+inst.cluster,record);
 	
-	span->End();
 	return inst;
 }
 
 std::string PersistentStore::getApplicationInstanceConfig(const std::string& id) {
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getApplicationInstanceConfig", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getApplicationInstanceConfig");
 
 	//first see if we have this cached
 	{
-		CacheRecord<std::string> record;
+		CacheRecord<StoredConfig> record;
 		if (instanceConfigCache.find(id, record)) {
 			//we have a cached record; is it still valid?
 			if (record) { //it is, just return it
 				cacheHits++;
-				span->End();
-				return record;
+				return decompressConfig(record.record);
 			}
 		}
 	}
@@ -3738,38 +3528,60 @@ std::string PersistentStore::getApplicationInstanceConfig(const std::string& id)
 	databaseQueries++;
 	log_info("Querying database for instance " << id << " config");
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome = dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome = dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 			                                .WithTableName(instanceTableName)
 			                                .WithKey({{"ID",      AttributeValue(id)},
 			                                          {"sortKey", AttributeValue(id + ":config")}}));
 	if (!outcome.IsSuccess()) {
 		const auto &err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch application instance config record: " << err);
 		return std::string{};
 	}
 	const auto &item = outcome.GetResult().GetItem();
 	if (item.empty()) { //no match found
-		span->End();
 		return std::string{};
 	}
-	std::string config= findOrThrow(item,"config","Instance config record missing config attribute").GetS();
+	//records written before compression was introduced have no format, and 
+	//hold the config as a plain string
+	StoredConfig stored;
+	const auto& config=findOrThrow(item,"config","Instance config record missing config attribute");
+	stored.compressed=(findOrDefault(item,"configFormat",missingString).GetS()=="gzip");
+	if(stored.compressed){
+		const auto& data=config.GetB();
+		stored.data=std::string((const char*)data.GetUnderlyingData(),data.GetLength());
+	}
+	else
+		stored.data=config.GetS();
 	
 	//update cache
-	CacheRecord<std::string> record(config,instanceCacheValidity);
+	CacheRecord<StoredConfig> record(stored,instanceCacheValidity);
 	replaceCacheRecord(instanceConfigCache,id,record);
 	
-	span->End();
-	return config;
+	return decompressConfig(stored);
+}
+
+PersistentStore::StoredConfig PersistentStore::compressConfig(const std::string& config){
+	StoredConfig stored;
+	if(config.size()>=minCompressedConfigSize){
+		stored.data=gzipCompress(config);
+		if(stored.data.size()<config.size()){
+			stored.compressed=true;
+			return stored;
+		}
+	}
+	stored.data=config;
+	return stored;
+}
+
+std::string PersistentStore::decompressConfig(const StoredConfig& stored){
+	if(!stored.compressed)
+		return stored.data;
+	return gzipDecompress(stored.data);
 }
 
 std::vector<ApplicationInstance> PersistentStore::listApplicationInstances(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listApplicationInstances", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listApplicationInstances");
 
 	//First check if instances are cached
 	std::vector<ApplicationInstance> collected;
@@ -3783,7 +3595,6 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstances(){
 		
 		table.unlock();
 		
-		span->End();
 		return collected;
 	}
 
@@ -3791,14 +3602,15 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstances(){
 	Aws::DynamoDB::Model::ScanRequest request;
 	request.SetTableName(instanceTableName);
 	request.SetFilterExpression("attribute_exists(ctime)");
+	request.SetProjectionExpression("ID, #name, application, owningGroup, #cluster, ctime");
+	request.SetExpressionAttributeNames({{"#name","name"},{"#cluster","cluster"}});
 	bool keepGoing=false;
 	
 	do{
-		auto outcome=dbClient.Scan(request);
+		auto outcome=dbClient->Scan(request);
 		if(!outcome.IsSuccess()){
 			const auto& err = outcome.GetError().GetMessage();
 			setSpanError(span, err);
-			span->End();
 			log_error("Failed to fetch application instance records: " << err);
 			return collected;
 		}
@@ -3833,29 +3645,22 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstances(){
 	instanceCacheExpirationTime=std::chrono::steady_clock::now()+instanceCacheValidity;
 
 	
-	span->End();
 	return collected;
 }
 
 std::vector<ApplicationInstance> PersistentStore::listApplicationInstancesByClusterOrGroup(std::string group, std::string cluster){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listApplicationInstancesByClusterOrGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listApplicationInstancesByClusterOrGroup");
 
 	std::vector<ApplicationInstance> instances;
 	
 	//check whether the Group 'ID' we got was actually a name
 	if(!group.empty() && !normalizeGroupID(group)) {
 		setSpanError(span, "Can't normalize groupID");
-		span->End();
 		return instances; //a nonexistent Group cannot have any running instances
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if(!cluster.empty() && !normalizeClusterID(cluster)) {
 		setSpanError(span, "Can't normalize clusterID");
-		span->End();
 		return instances; //a nonexistent cluster cannot run any instances
 	}
 	
@@ -3874,7 +3679,7 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstancesByClus
 	Aws::DynamoDB::Model::QueryOutcome outcome;
 
 	if (!group.empty() && !cluster.empty()) {
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 				       .WithTableName(instanceTableName)
 				       .WithIndexName("ByGroup")
 				       .WithKeyConditionExpression("owningGroup = :group_val")
@@ -3883,14 +3688,14 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstancesByClus
 				       .WithExpressionAttributeValues({{":group_val", AV(group)}, {":cluster_val", AV(cluster)}})
 				       );
 	} else if (!group.empty()) {
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 				       .WithTableName(instanceTableName)
 				       .WithIndexName("ByGroup")
 				       .WithKeyConditionExpression("owningGroup = :group_val")
 				       .WithExpressionAttributeValues({{":group_val", AV(group)}})
 				       );
 	} else if (!cluster.empty()) {
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 				       .WithTableName(instanceTableName)
 				       .WithIndexName("ByCluster")
 				       .WithKeyConditionExpression("#cluster = :cluster_val")
@@ -3902,14 +3707,12 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstancesByClus
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to list Instances by Cluster or Group: " << err);
 		return instances;
 	}
 
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return instances;
 	}
 
@@ -3942,16 +3745,11 @@ std::vector<ApplicationInstance> PersistentStore::listApplicationInstancesByClus
 		instanceByClusterCache.update_expiration(cluster, expirationTime);
 	}
 	
-	span->End();
 	return instances;
 }
 
 std::vector<ApplicationInstance> PersistentStore::findInstancesByName(const std::string& name){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findInstancesByName", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findInstancesByName");
 
 	//TODO: read from cache
 	std::vector<ApplicationInstance> instances;
@@ -3959,7 +3757,7 @@ std::vector<ApplicationInstance> PersistentStore::findInstancesByName(const std:
 	using AV=Aws::DynamoDB::Model::AttributeValue;
 	databaseQueries++;
 	log_info("Querying database for instance with name " << name);
-	auto outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+	auto outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 	                            .WithTableName(instanceTableName)
 	                            .WithIndexName("ByName")
 	                            .WithKeyConditionExpression("#name = :name_val")
@@ -3969,13 +3767,11 @@ std::vector<ApplicationInstance> PersistentStore::findInstancesByName(const std:
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to look up Instances by name: " << err);
 		return instances;
 	}
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
-		span->End();
 		return instances;
 	}
 	//this is allowed
@@ -4004,7 +3800,6 @@ std::vector<ApplicationInstance> PersistentStore::findInstancesByName(const std:
 		instanceByGroupAndClusterCache.insert_or_assign(instance.owningGroup+":"+instance.cluster,record);
 	}
 	
-	span->End();
 	return instances;
 }
 
@@ -4037,11 +3832,7 @@ SecretData PersistentStore::decryptSecret(const Secret& s) const{
 }
 
 bool PersistentStore::addSecret(const Secret& secret){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addSecret", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addSecret");
 
 	if (secret.data.substr(0, 6) != "scrypt") {
 		throw std::runtime_error("Secret data does not have valid encryption header");
@@ -4062,32 +3853,31 @@ bool PersistentStore::addSecret(const Secret& secret){
 		{"ctime",AttributeValue(secret.ctime)},
 		{"contents",AttributeValue().SetB(Aws::Utils::ByteBuffer((const unsigned char*)secret.data.data(),secret.data.size()))}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add secret record: " << err);
 		return false;
 	}
 	
 	//update caches
-	CacheRecord<Secret> record(secret,secretCacheValidity);
-	replaceCacheRecord(secretCache,secret.id,record);
-	secretByGroupCache.insert_or_assign(secret.group,record);
-	secretByGroupAndClusterCache.insert_or_assign(secret.group+":"+secret.cluster,record);
+	replaceCacheRecord(secretCache,secret.id,CacheRecord<Secret>(secret,secretCacheValidity));
+	CacheRecord<Secret> summary(secretSummary(secret),secretCacheValidity);
+	secretByGroupCache.insert_or_assign(secret.group,summary);
+	secretByGroupAndClusterCache.insert_or_assign(secret.group+":"+secret.cluster,summary);
 
 	
-	span->End();
+	recordChange(StoreCollection::Secrets,ChangeOperation::Add,secret.id,{secret.group,secret.cluster});
 	return true;
 }
 
 bool PersistentStore::removeSecret(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removeSecret", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removeSecret");
+
+	//note the group and cluster to which the secret belongs, so that their 
+	//generations can be updated
+	const Secret removed=getSecret(id);
 
 	//erase cache entries
 	{
@@ -4109,29 +3899,24 @@ bool PersistentStore::removeSecret(const std::string& id){
 	}
 	
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 	                                      .WithTableName(secretTableName)
 	                                      .WithKey({{"ID",AttributeValue(id)},
 	                                                {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete secret record: " << err);
 		return false;
 	}
 
 	
-	span->End();
+	recordChange(StoreCollection::Secrets,ChangeOperation::Remove,id,{removed.group,removed.cluster});
 	return true;
 }
 
 Secret PersistentStore::getSecret(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getSecret", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getSecret");
 
 	//first see if we have this cached
 	{
@@ -4141,7 +3926,6 @@ Secret PersistentStore::getSecret(const std::string& id){
 			log_info("Found record of " << id << " in cache");
 			if(record){ //it is, just return it
 				cacheHits++;
-				span->End();
 				return record;
 			}
 		}
@@ -4150,14 +3934,13 @@ Secret PersistentStore::getSecret(const std::string& id){
 	databaseQueries++;
 	log_info("Querying database for secret " << id);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(secretTableName)
 								  .WithKey({{"ID",AttributeValue(id)},
 	                                        {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch secret record: " << err);
 		return Secret();
 	}
@@ -4176,21 +3959,16 @@ Secret PersistentStore::getSecret(const std::string& id){
 	secret.data=std::string((const std::string::value_type*)secret_data.GetUnderlyingData(),secret_data.GetLength());
 	
 	//update caches
-	CacheRecord<Secret> record(secret,secretCacheValidity);
-	replaceCacheRecord(secretCache,secret.id,record);
-	secretByGroupCache.insert_or_assign(secret.group,record);
-	secretByGroupAndClusterCache.insert_or_assign(secret.group+":"+secret.cluster,record);
+	replaceCacheRecord(secretCache,secret.id,CacheRecord<Secret>(secret,secretCacheValidity));
+	CacheRecord<Secret> summary(secretSummary(secret),secretCacheValidity);
+	secretByGroupCache.insert_or_assign(secret.group,summary);
+	secretByGroupAndClusterCache.insert_or_assign(secret.group+":"+secret.cluster,summary);
 
-	span->End();
 	return secret;
 }
 
 std::vector<Secret> PersistentStore::listSecrets(std::string group, std::string cluster){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listSecrets", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listSecrets");
 
 	std::vector<Secret> secrets;
 	
@@ -4200,13 +3978,11 @@ std::vector<Secret> PersistentStore::listSecrets(std::string group, std::string
 	if(!group.empty() && !normalizeGroupID(group)) {
 		
 		setSpanError(span, "Invalid group name");
-		span->End();
 		return secrets; //a Group which does not exist cannot own any secrets
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if(!cluster.empty() && !normalizeClusterID(cluster)) {
 		setSpanError(span, "Invalid cluster name");
-		span->End();
 		return secrets; //a nonexistent cluster cannot store any secrets
 	}
 	
@@ -4229,21 +4005,23 @@ std::vector<Secret> PersistentStore::listSecrets(std::string group, std::string
 		query.WithTableName(secretTableName)
 		     .WithIndexName("ByGroup")
 		     .WithKeyConditionExpression("owningGroup = :group_val")
+		     .WithProjectionExpression(secretSummaryAttributes)
+		     .WithExpressionAttributeNames({{"#name", "name"}, {"#cluster", "cluster"}})
 		     .WithExpressionAttributeValues({{":group_val", AV(group)}});
 		if (!cluster.empty()) {
 			query.SetFilterExpression("contains(#cluster, :cluster_val)");
-			query.AddExpressionAttributeNames("#cluster", "cluster");
 			query.AddExpressionAttributeValues(":cluster_val", AV(cluster));
 		}
 		
-		outcome=dbClient.Query(query);
+		outcome=dbClient->Query(query);
 	}
 	else if (!cluster.empty()) {
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 							   .WithTableName(secretTableName)
 							   .WithIndexName("ByCluster")
 							   .WithKeyConditionExpression("#cluster = :cluster_val")
-							   .WithExpressionAttributeNames({{"#cluster", "cluster"}})
+							   .WithProjectionExpression(secretSummaryAttributes)
+							   .WithExpressionAttributeNames({{"#name", "name"}, {"#cluster", "cluster"}})
 							   .WithExpressionAttributeValues({{":cluster_val", AV(cluster)}})
 							   );
 	}
@@ -4251,7 +4029,6 @@ std::vector<Secret> PersistentStore::listSecrets(std::string group, std::string
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to list secrets: " << err);
 		return secrets;
 	}
@@ -4274,15 +4051,12 @@ std::vector<Secret> PersistentStore::listSecrets(std::string group, std::string
 			secret.cluster = cluster;
 		}
 		secret.ctime=findOrThrow(item,"ctime","Secret record missing ctime attribute").GetS();
-		const auto& secret_data=findOrThrow(item,"contents","Secret record missing contents attribute").GetB();
-		secret.data=std::string((const std::string::value_type*)secret_data.GetUnderlyingData(),secret_data.GetLength());
 		secret.valid=true;
 		
 		secrets.push_back(secret);
 		
-		//update caches
+		//update caches; secretCache holds only complete records
 		CacheRecord<Secret> record(secret,secretCacheValidity);
-		replaceCacheRecord(secretCache,secret.id,record);
 		secretByGroupCache.insert_or_assign(secret.group,record);
 		secretByGroupAndClusterCache.insert_or_assign(secret.group+":"+secret.cluster,record);
 	}
@@ -4293,49 +4067,35 @@ std::vector<Secret> PersistentStore::listSecrets(std::string group, std::string
 		secretByGroupCache.update_expiration(group, expirationTime);
 	}
 
-	span->End();
 	return secrets;
 }
 
 Secret PersistentStore::findSecretByName(std::string group, std::string cluster, std::string name){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findSecretByName", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findSecretByName");
 
 	auto secrets=listSecrets(group, cluster);
 	for(const auto& secret : secrets){
 		if(secret.name==name) {
-			span->End();
 			return secret;
 		}
 	}
 	
-	span->End();
 	return Secret();
 }
 
 bool PersistentStore::addMonitoringCredential(const S3Credential& cred){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addMonitoringCredential");
 
 	if(!cred) {
 		setSpanError(span, "Cannot store invalid S3 credentials in Dynamo");
-		span->End();
 		throw std::runtime_error("Cannot store invalid S3 credentials in Dynamo");
 	}
 	if(cred.inUse) {
 		setSpanError(span, "Already in-use credentials should not be added");
-		span->End();
 		throw std::runtime_error("Already in-use credentials should not be added");
 	}
 	if(cred.revoked) {
 		setSpanError(span, "Already revoked credentials should not be added");
-		span->End();
 		throw std::runtime_error("Already revoked credentials should not be added");
 	}
 
@@ -4349,47 +4109,45 @@ bool PersistentStore::addMonitoringCredential(const S3Credential& cred){
 		{"inUse",AttributeValue().SetBool(false)},
 		{"revoked",AttributeValue().SetBool(false)},
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add monitoring credential record: " << err);
 		return false;
 	}
 	
-	//credentials should be manipulated infrequently, so we do not cache them
+	//credentials should be manipulated infrequently, so we do not cache them, 
+	//but new credentials are available for allocation
+	{
+		std::lock_guard<std::mutex> lock(monCredPoolMut);
+		freeMonCreds.push_back(cred);
+	}
 
-	span->End();
+	recordChange(StoreCollection::MonitoringCredentials,ChangeOperation::Add,cred.accessKey);
 	return true;
 }
 
 S3Credential PersistentStore::getMonitoringCredential(const std::string& accessKey){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getMonitoringCredential");
 
 	//we do not keep these cached, always query
 	databaseQueries++;
 	log_info("Querying database for monitoring credential " << accessKey);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(monCredTableName)
 								  .WithKey({{"accessKey",AttributeValue(accessKey)},
 	                                        {"sortKey",AttributeValue(accessKey)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch monitoring credential record: " << err);
 		return S3Credential();
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) { //no match found
 		const auto& err = outcome.GetError().GetMessage();
-		span->End();
 		return S3Credential{};
 	}
 	S3Credential cred;
@@ -4402,16 +4160,11 @@ S3Credential PersistentStore::getMonitoringCredential(const std::string& accessK
 
 	const auto& err = outcome.GetError().GetMessage();
 	
-	span->End();
 	return cred;
 }
 
 std::vector<S3Credential> PersistentStore::listMonitoringCredentials(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listMonitoringCredentials", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listMonitoringCredentials");
 
 	std::vector<S3Credential> creds;
 
@@ -4421,11 +4174,10 @@ std::vector<S3Credential> PersistentStore::listMonitoringCredentials(){
 	bool keepGoing=false;
 	
 	do{
-		auto outcome=dbClient.Scan(request);
+		auto outcome=dbClient->Scan(request);
 		if(!outcome.IsSuccess()){
 			const auto& err = outcome.GetError().GetMessage();
 			setSpanError(span, err);
-			span->End();
 			log_error("Failed to fetch monitoring credential records: " << err);
 			return creds;
 		}
@@ -4449,96 +4201,183 @@ std::vector<S3Credential> PersistentStore::listMonitoringCredentials(){
 		}
 	}while(keepGoing);
 
-	span->End();
 	return creds;
 }
 
+std::string PersistentStore::refillMonitoringCredentialPool(){
+	//note which credentials are added while the scan is in progress, so that 
+	//they are not lost if the scan does not see them
+	std::set<std::string> known;
+	{
+		std::lock_guard<std::mutex> lock(monCredPoolMut);
+		for(const auto& cred : freeMonCreds)
+			known.insert(cred.accessKey);
+	}
+	
+	databaseScans++;
+	using AV=Aws::DynamoDB::Model::AttributeValue;
+	auto request=Aws::DynamoDB::Model::ScanRequest()
+	             .WithTableName(monCredTableName)
+	             .WithProjectionExpression("accessKey, secretKey")
+	             .WithFilterExpression("#inUse = :false AND #revoked = :false")
+	             .WithExpressionAttributeNames({{"#inUse","inUse"},{"#revoked","revoked"}})
+	             .WithExpressionAttributeValues({{":false",AV().SetBool(false)}});
+	std::vector<S3Credential> available;
+	bool keepGoing=false;
+	do{
+		auto outcome=dbClient->Scan(request);
+		if(!outcome.IsSuccess())
+			return outcome.GetError().GetMessage();
+		const auto& result=outcome.GetResult();
+		//set up fetching the next page if necessary
+		if(!result.GetLastEvaluatedKey().empty()){
+			keepGoing=true;
+			request.SetExclusiveStartKey(result.GetLastEvaluatedKey());
+		} else {
+			keepGoing=false;
+		}
+		for(const auto& item : result.GetItems()){
+			S3Credential cred;
+			cred.accessKey=findOrThrow(item,"accessKey","Monitoring credential record missing accessKey attribute").GetS();
+			cred.secretKey=findOrThrow(item,"secretKey","Monitoring credential record missing secretKey attribute").GetS();
+			available.push_back(cred);
+		}
+	}while(keepGoing);
+	log_info("Found " << available.size() << " credentials available for allocation");
+	
+	std::random_device seed;
+	std::shuffle(available.begin(),available.end(),std::mt19937(seed()));
+	
+	std::lock_guard<std::mutex> lock(monCredPoolMut);
+	std::set<std::string> listed;
+	for(const auto& cred : available)
+		listed.insert(cred.accessKey);
+	for(const auto& cred : freeMonCreds){
+		if(!known.count(cred.accessKey) && !listed.count(cred.accessKey))
+			available.push_back(cred);
+	}
+	freeMonCreds.assign(available.begin(),available.end());
+	return "";
+}
+
+void PersistentStore::startMonitoringCredentialRefill(){
+	std::lock_guard<std::mutex> lock(monCredPoolMut);
+	if(monCredRefill.valid() && 
+	   monCredRefill.wait_for(std::chrono::seconds(0))!=std::future_status::ready)
+		return;
+	monCredRefill=std::async(std::launch::async,[this]()->std::string{
+		try{
+			std::string err=refillMonitoringCredentialPool();
+			if(!err.empty())
+				log_error("Failed to look up available monitoring credentials: " << err);
+			return err;
+		}catch(std::exception& ex){
+			log_error("Failed to look up available monitoring credentials: " << ex.what());
+			return ex.what();
+		}
+	}).share();
+}
+
 std::tuple<S3Credential,std::string> PersistentStore::allocateMonitoringCredential(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::allocateMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::allocateMonitoringCredential");
 
-	S3Credential cred;
+	using AV=Aws::DynamoDB::Model::AttributeValue;
+	bool refilled=false;
 	while(true){
-		//find out what credentials are available
-		databaseScans++;
-		using AV=Aws::DynamoDB::Model::AttributeValue;
-		auto outcome=dbClient.Scan(Aws::DynamoDB::Model::ScanRequest()
-		                            .WithTableName(monCredTableName)
-		                            .WithFilterExpression("#inUse = :false AND #revoked = :false")
-	                                .WithExpressionAttributeNames({{"#inUse","inUse"},{"#revoked","revoked"}})
-	                                .WithExpressionAttributeValues({{":false",AV().SetBool(false)}})
-		                            );
-		if(!outcome.IsSuccess()){
-			const auto& err = outcome.GetError().GetMessage();
-			setSpanError(span, err);
-			span->End();
-			log_error("Failed to look up available monitoring credentials: " << err);
-			return std::make_tuple(cred,"Failed to look up available monitoring credentials: " + err);
-		}
-		const auto& queryResult=outcome.GetResult();
-		if(queryResult.GetCount()==0){
-			const auto& err = "No monitoring credentials available for allocation";
-			setSpanError(span, err);
-			span->End();
-			log_error(err);
-			return std::make_tuple(cred,"No monitoring credentials available for allocation");
+		S3Credential cred;
+		std::size_t remaining=0;
+		std::shared_future<std::string> refill;
+		{
+			std::lock_guard<std::mutex> lock(monCredPoolMut);
+			if(!freeMonCreds.empty()){
+				cred=freeMonCreds.front();
+				freeMonCreds.pop_front();
+				remaining=freeMonCreds.size();
+			}
+			else if(monCredRefill.valid() && 
+			        monCredRefill.wait_for(std::chrono::seconds(0))!=std::future_status::ready)
+				refill=monCredRefill;
 		}
-		log_info("Found " << queryResult.GetCount() << " candidate credentials for allocation");
-		//try to acquire one of the candidate credentials
-		for(const auto& item : queryResult.GetItems()){
-			std::string accessKey=findOrThrow(item,"accessKey","Monitoring credential record missing accessKey attribute").GetS();
-			
-			log_info("Attempting to allocate credential " << accessKey);
-			//this should atomically check that the credential is still available 
-			//and then mark it as in-use
-			auto updateResult=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
-			                                 .WithTableName(monCredTableName)
-			                                 .WithKey({{"accessKey",AV(accessKey)},
-			                                           {"sortKey",AV(accessKey)}})
-			                                 //.WithAttributeUpdates({
-			                                 //           {"inUse",AVU().WithValue(AV().SetBool(true))}
-			                                 //           })
-			                                 .WithUpdateExpression("SET #inUse = :true")
-			                                 .WithConditionExpression("#inUse = :false AND #revoked = :false")
-	                                         .WithExpressionAttributeNames({{"#inUse","inUse"},{"#revoked","revoked"}})
-	                                         .WithExpressionAttributeValues({{":true",AV().SetBool(true)},
-	                                                                         {":false",AV().SetBool(false)}})
-			                                 );
-			if(!updateResult.IsSuccess()){
-				const auto& err = updateResult.GetError().GetMessage();
+		if(!cred){
+			//Every candidate has been tried, so the database must be consulted. 
+			//Once it has been, and none of the credentials it listed could be 
+			//allocated, there is nothing more to try. 
+			if(refilled){
+				const auto& err = "No monitoring credentials available for allocation";
+				setSpanError(span, err);
+				log_error(err);
+				return std::make_tuple(cred,"No monitoring credentials available for allocation");
+			}
+			//join a refill which is already in progress, rather than scanning again
+			std::string err=(refill.valid() ? refill.get() : refillMonitoringCredentialPool());
+			if(!err.empty()){
 				setSpanError(span, err);
-				span->End();
-				log_info("Failed to allocate credential credential: " << err);
+				log_error("Failed to look up available monitoring credentials: " << err);
+				return std::make_tuple(cred,"Failed to look up available monitoring credentials: " + err);
+			}
+			refilled=true;
+			continue;
+		}
+		if(remaining<monCredPoolLowWater)
+			startMonitoringCredentialRefill();
+		
+		log_info("Attempting to allocate credential " << cred.accessKey);
+		//this should atomically check that the credential is still available 
+		//and then mark it as in-use
+		auto updateResult=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+		                                 .WithTableName(monCredTableName)
+		                                 .WithKey({{"accessKey",AV(cred.accessKey)},
+		                                           {"sortKey",AV(cred.accessKey)}})
+		                                 .WithUpdateExpression("SET #inUse = :true")
+		                                 .WithConditionExpression("#inUse = :false AND #revoked = :false")
+		                                 .WithExpressionAttributeNames({{"#inUse","inUse"},{"#revoked","revoked"}})
+		                                 .WithExpressionAttributeValues({{":true",AV().SetBool(true)},
+		                                                                 {":false",AV().SetBool(false)}})
+		                                 );
+		if(!updateResult.IsSuccess()){
+			const auto& error = updateResult.GetError();
+			//if the credential has been allocated by another server, or revoked, 
+			//just move on to the next candidate
+			if(error.GetErrorType()==Aws::DynamoDB::DynamoDBErrors::CONDITIONAL_CHECK_FAILED){
+				log_info("Credential " << cred.accessKey << " is no longer available");
 				continue;
 			}
-			
-			cred.accessKey=accessKey;
-			cred.secretKey=findOrThrow(item,"secretKey","Monitoring credential record missing secretKey attribute").GetS();
-			cred.inUse=true;
-			cred.revoked=false;
-			
-			span->End();
-			return std::make_tuple(cred,"");
+			//otherwise, the credential may still be available later
+			{
+				std::lock_guard<std::mutex> lock(monCredPoolMut);
+				freeMonCreds.push_front(cred);
+			}
+			const auto& err = error.GetMessage();
+			setSpanError(span, err);
+			log_error("Failed to allocate monitoring credential: " << err);
+			return std::make_tuple(S3Credential(),"Failed to allocate monitoring credential: " + err);
 		}
-		//if we failed to acquire any of the credentials, query again in the hope that something will be available
+		
+		cred.inUse=true;
+		cred.revoked=false;
+		recordChange(StoreCollection::MonitoringCredentials,ChangeOperation::Update,cred.accessKey);
+		
+		return std::make_tuple(cred,"");
 	}
-	
-	span->End();
-	return std::make_tuple(cred,"Internal Error"); //unreachable
+}
+
+void PersistentStore::removeFromMonitoringCredentialPool(const std::string& accessKey){
+	std::lock_guard<std::mutex> lock(monCredPoolMut);
+	freeMonCreds.erase(std::remove_if(freeMonCreds.begin(),freeMonCreds.end(),
+	                                  [&](const S3Credential& c){ return c.accessKey==accessKey; }),
+	                   freeMonCreds.end());
+}
+
+std::size_t PersistentStore::countAvailableMonitoringCredentials(){
+	std::lock_guard<std::mutex> lock(monCredPoolMut);
+	return freeMonCreds.size();
 }
 
 bool PersistentStore::revokeMonitoringCredential(const std::string& accessKey){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::revokeMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::revokeMonitoringCredential");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
+	auto outcome=dbClient->UpdateItem(Aws::DynamoDB::Model::UpdateItemRequest()
 	                                 .WithTableName(monCredTableName)
 	                                 .WithKey({{"accessKey",AV(accessKey)},
 	                                           {"sortKey",AV(accessKey)}})
@@ -4555,24 +4394,20 @@ bool PersistentStore::revokeMonitoringCredential(const std::string& accessKey){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to mark monitoring credential revoked: " << err);
 		return false;
 	}
+	removeFromMonitoringCredentialPool(accessKey);
 	
-	span->End();
+	recordChange(StoreCollection::MonitoringCredentials,ChangeOperation::Update,accessKey);
 	return true;
 }
 
 bool PersistentStore::deleteMonitoringCredential(const std::string& accessKey){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::deleteMonitoringCredential", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::deleteMonitoringCredential");
 
 	using AV=Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 	                                 .WithTableName(monCredTableName)
 	                                 .WithKey({{"accessKey",AV(accessKey)},
 	                                           {"sortKey",AV(accessKey)}})
@@ -4583,21 +4418,17 @@ bool PersistentStore::deleteMonitoringCredential(const std::string& accessKey){
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to delete monitoring credential: " << err);
 		return false;
 	}
+	removeFromMonitoringCredentialPool(accessKey);
 	
-	span->End();
+	recordChange(StoreCollection::MonitoringCredentials,ChangeOperation::Remove,accessKey);
 	return true;
 }
 
 bool PersistentStore::addPersistentVolumeClaim(const PersistentVolumeClaim& pvc){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::addPersistentVolumeClaim", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::addPersistentVolumeClaim");
 
 	using Aws::DynamoDB::Model::AttributeValue;
 	
@@ -4623,11 +4454,10 @@ bool PersistentStore::addPersistentVolumeClaim(const PersistentVolumeClaim& pvc)
 		//{"selectorMatchLabel",AttributeValue(pvc.selectorMatchLabel)},
 		//{"selectorLabelExpressions",expressionList}
 	});
-	auto outcome=dbClient.PutItem(request);
+	auto outcome=dbClient->PutItem(request);
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add volume claim record: " << err);
 		return false;
 	}
@@ -4640,16 +4470,16 @@ bool PersistentStore::addPersistentVolumeClaim(const PersistentVolumeClaim& pvc)
 	volumeByGroupAndClusterCache.insert_or_assign(pvc.group+":"+pvc.cluster,record);
 
 	
-	span->End();
+	recordChange(StoreCollection::Volumes,ChangeOperation::Add,pvc.id,{pvc.group,pvc.cluster});
 	return true;
 }
 
 bool PersistentStore::removePersistentVolumeClaim(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::removePersistentVolumeClaim", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::removePersistentVolumeClaim");
+
+	//note the group and cluster to which the volume claim belongs, so that 
+	//their generations can be updated
+	const PersistentVolumeClaim removed=getPersistentVolumeClaim(id);
 
 	//erase cache entries
 	{
@@ -4672,29 +4502,24 @@ bool PersistentStore::removePersistentVolumeClaim(const std::string& id){
 	}
 	
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
+	auto outcome=dbClient->DeleteItem(Aws::DynamoDB::Model::DeleteItemRequest()
 	                                      .WithTableName(volumeTableName)
 	                                      .WithKey({{"ID",AttributeValue(id)},
 	                                                {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to add Group record: " << err);
 		return false;
 	}
 
 	
-	span->End();
+	recordChange(StoreCollection::Volumes,ChangeOperation::Remove,id,{removed.group,removed.cluster});
 	return true;
 }
 
 PersistentVolumeClaim PersistentStore::getPersistentVolumeClaim(const std::string& id){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::getPersistentVolumeClaim", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::getPersistentVolumeClaim");
 
 	//first see if we have this cached
 	{
@@ -4705,7 +4530,6 @@ PersistentVolumeClaim PersistentStore::getPersistentVolumeClaim(const std::strin
 			if(record){ //it is, just return it
 				cacheHits++;
 				log_info("RETURNING RECORD FROM CACHE");
-				span->End();
 				return record;
 			}
 		}
@@ -4714,20 +4538,18 @@ PersistentVolumeClaim PersistentStore::getPersistentVolumeClaim(const std::strin
 	databaseQueries++;
 	log_info("Querying database for volume " << id);
 	using Aws::DynamoDB::Model::AttributeValue;
-	auto outcome=dbClient.GetItem(Aws::DynamoDB::Model::GetItemRequest()
+	auto outcome=dbClient->GetItem(Aws::DynamoDB::Model::GetItemRequest()
 								  .WithTableName(volumeTableName)
 								  .WithKey({{"ID",AttributeValue(id)},
 	                                        {"sortKey",AttributeValue(id)}}));
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to fetch volume record: " << err);
 		return PersistentVolumeClaim();
 	}
 	const auto& item=outcome.GetResult().GetItem();
 	if(item.empty()) { //no match found
-		span->End();
 		return PersistentVolumeClaim{};
 	}
 	PersistentVolumeClaim pvc;
@@ -4753,35 +4575,24 @@ PersistentVolumeClaim PersistentStore::getPersistentVolumeClaim(const std::strin
 	volumeByClusterCache.insert_or_assign(pvc.cluster,record);
 	volumeByGroupAndClusterCache.insert_or_assign(pvc.group+":"+pvc.cluster,record);
 
-	span->End();
 	return pvc;
 }
 
 PersistentVolumeClaim PersistentStore::findPersistentVolumeClaimByName(std::string group, std::string cluster, std::string name){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findPersistentVolumeClaimByName", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findPersistentVolumeClaimByName");
 
 	auto volumes=listPersistentVolumeClaimsByClusterOrGroup(group, cluster);
 	for(const auto& volume : volumes){
 		if(volume.name==name) {
-			span->End();
 			return volume;
 		}
 	}
 	
-	span->End();
 	return PersistentVolumeClaim();
 }
 
 std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaims(){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listPersistentVolumeClaims", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listPersistentVolumeClaims");
 
 	log_info("Entered listPersistentVolumeClaims()");
 	//First check if volumes are cached
@@ -4796,7 +4607,6 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaims()
 		
 		table.unlock();
 		
-		span->End();
 		log_info("Found in cache");
 		return collected;
 	}
@@ -4810,11 +4620,10 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaims()
 	
 	std::set<std::string> allGroups, allClusters;
 	do{
-		auto outcome=dbClient.Scan(request);
+		auto outcome=dbClient->Scan(request);
 		if(!outcome.IsSuccess()){
 			const auto& err = outcome.GetError().GetMessage();
 			setSpanError(span, err);
-			span->End();
 			log_error("Failed to fetch volume records: " << err);
 			return collected;
 		}
@@ -4869,16 +4678,11 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaims()
 		}
 	}
 	
-	span->End();
 	return collected;
 }
 
 std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsByClusterOrGroup(std::string group, std::string cluster){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listPersistentVolumeClaimsByClusterOrGroup", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listPersistentVolumeClaimsByClusterOrGroup");
 
 	log_info("Entered List PVC By Group or Cluster");
 	std::vector<PersistentVolumeClaim> volumes;
@@ -4886,14 +4690,12 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 	if(!group.empty() && !normalizeGroupID(group)) {
 		log_info("RETURNING EMPTY VOLUMES - GROUP ID PROBLEM");
 		setSpanError(span, "Invalid group name");
-		span->End();
 		return volumes; //a nonexistent Group cannot have any allocated volumes
 	}
 	//check whether the cluster 'ID' we got was actually a name
 	if(!cluster.empty() && !normalizeClusterID(cluster)) {
 		log_info("RETURNING EMPTY VOLUMES - CLUSTER ID PROBLEM");
 		setSpanError(span, "Invalid cluster name");
-		span->End();
 		return volumes; //a nonexistent cluster cannot allocate any volumes
 	}
 	
@@ -4917,7 +4719,7 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 	Aws::DynamoDB::Model::QueryOutcome outcome;
 	if (!group.empty() && !cluster.empty()) {
 		log_info("RUNNING QUERY WITH CLUSTER AND GROUP");
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 				       .WithTableName(volumeTableName)
 				       .WithIndexName("ByGroup")
 				       .WithKeyConditionExpression("owningGroup = :group_val")
@@ -4927,7 +4729,7 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 				       );
 	} else if (!group.empty()) {
 		log_info("RUNNING QUERY WITH GROUP: " << group);
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 				       .WithTableName(volumeTableName)
 				       .WithIndexName("ByGroup")
 				       .WithKeyConditionExpression("owningGroup = :group_val")
@@ -4935,7 +4737,7 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 				       );
 	} else if (!cluster.empty()) { 
 		log_info("RUNNING QUERY WITH CLUSTER");
-		outcome=dbClient.Query(Aws::DynamoDB::Model::QueryRequest()
+		outcome=dbClient->Query(Aws::DynamoDB::Model::QueryRequest()
 				       .WithTableName(volumeTableName)
 				       .WithIndexName("ByCluster")
 				       .WithKeyConditionExpression("#cluster = :cluster_val")
@@ -4947,7 +4749,6 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 	if(!outcome.IsSuccess()){
 		const auto& err = outcome.GetError().GetMessage();
 		setSpanError(span, err);
-		span->End();
 		log_error("Failed to list volumes by Cluster or Group: " << err);
 		return volumes;
 	}
@@ -4955,7 +4756,6 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 	const auto& queryResult=outcome.GetResult();
 	if(queryResult.GetCount()==0) {
 		log_info("EMPTY RESULTS");
-		span->End();
 		return volumes;
 	}
 
@@ -5006,16 +4806,11 @@ std::vector<PersistentVolumeClaim> PersistentStore::listPersistentVolumeClaimsBy
 		volumeByClusterCache.update_expiration(cluster, expirationTime);
 	}
 	
-	span->End();
 	return volumes;
 }
 
 Application PersistentStore::findApplication(const std::string& repository, const std::string& appName, const std::string& chartVersion){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::findApplication", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::findApplication");
 
 	{ //check for cached data first
 		log_info("Checking for application " << appName << " in cache");
@@ -5024,7 +4819,6 @@ Application PersistentStore::findApplication(const std::string& repository, cons
 			auto records = cached.first;
 			for(const auto& record : records){
 				if(record.record.name==appName && record) {
-					span->End();
 					return record;
 				}
 			}
@@ -5041,12 +4835,10 @@ Application PersistentStore::findApplication(const std::string& repository, cons
 	if(result.status) {
 		const std::string& err = "Command failed: helm search " + target + ": [err] " + result.error + " [out] " + result.output;
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	log_info("Helm output: " << result.output);
 	if(result.output.find("No results found")!=std::string::npos) {
-		span->End();
 		return Application();
 	}
 	//Deal with the possibility of multiple results, which could happen if
@@ -5072,16 +4864,11 @@ Application PersistentStore::findApplication(const std::string& repository, cons
 	CacheRecord<Application> record(app,instanceCacheValidity);
 	applicationCache.insert_or_assign(repository,record);
 
-	span->End();
 	return app;
 }
 
 std::vector<Application> PersistentStore::fetchApplications(const std::string& repository){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::fetchApplications", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::fetchApplications");
 
 	//Tell helm the terminal is rather wide to prevent truncation of results 
 	//(unless they are rather long).
@@ -5097,7 +4884,6 @@ std::vector<Application> PersistentStore::fetchApplications(const std::string& r
 	if(commandResult.status) {
 		const std::string& err = "helm search failed: [err] " + commandResult.error + " [out] " + commandResult.output;
 		setSpanError(span, err);
-		span->End();
 		log_fatal(err);
 	}
 	std::vector<std::string> lines = string_split_lines(commandResult.output);
@@ -5117,22 +4903,16 @@ std::vector<Application> PersistentStore::fetchApplications(const std::string& r
 	auto expirationTime = std::chrono::steady_clock::now() + instanceCacheValidity;
 	applicationCache.update_expiration(repository, expirationTime);
 	
-	span->End();
 	return results;
 }
 
 std::vector<Application> PersistentStore::listApplications(const std::string& repository){
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("PersistentStore::listApplications", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(tracer, "PersistentStore::listApplications");
 
 	//check for cached data first
 	maybeReturnCachedCategoryMembers(applicationCache,repository);
 	//No cached data, or out of date.
 	
-	span->End();
 	return fetchApplications(repository);
 }
 
@@ -5141,9 +4921,417 @@ std::string PersistentStore::getStatistics() const{
 	os << "Cache hits: " << cacheHits.load() << "\n";
 	os << "Database queries: " << databaseQueries.load() << "\n";
 	os << "Database scans: " << databaseScans.load() << "\n";
+	if(emailQueue)
+		os << emailQueue->getStatistics();
 	return os.str();
 }
 
+void PersistentStore::setEmailClient(EmailClient&& e, EmailQueue::Options options){
+	//stop sending with the old client before replacing it
+	emailQueue.reset();
+	emailClient=std::move(e);
+	emailQueue.reset(new EmailQueue([this](const EmailClient::Email& email){
+		return emailClient.sendEmail(email);
+	},std::move(options)));
+}
+
+bool PersistentStore::queueEmail(EmailClient::Email email){
+	if(!emailQueue || !emailClient.canSendEmail())
+		return false;
+	return emailQueue->enqueue(std::move(email));
+}
+
+namespace{
+	std::string scopedGenerationKey(StoreCollection collection, const std::string& scope){
+		return std::to_string((unsigned int)collection)+":"+scope;
+	}
+}
+
+std::string PersistentStore::getGenerationEpoch() const{
+	unsigned int resets=generationEpochResets.load();
+	if(!resets)
+		return generationEpoch;
+	return generationEpoch+"-"+std::to_string(resets);
+}
+
+std::string PersistentStore::getETagEpoch() const{
+	if(generationsComplete)
+		return getGenerationEpoch();
+	//Changes made by other servers may never be seen here, so a tag may be 
+	//honored only for as long as the shortest-lived cache it could describe.
+	std::chrono::seconds period=std::min({userCacheValidity,groupCacheValidity,
+	                                      clusterCacheValidity,instanceCacheValidity,
+	                                      secretCacheValidity});
+	auto now=std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+	return getGenerationEpoch()+"."+std::to_string(now.count()/period.count());
+}
+
+uint64_t PersistentStore::getGeneration(StoreCollection collection) const{
+	return generations[(unsigned int)collection].load();
+}
+
+uint64_t PersistentStore::getGeneration(StoreCollection collection, const std::string& scope) const{
+	uint64_t generation=0;
+	scopedGenerations.find(scopedGenerationKey(collection,scope),generation);
+	return generation;
+}
+
+void PersistentStore::recordChange(StoreCollection collection, ChangeOperation operation, 
+                                   const std::string& id, std::initializer_list<std::string> scopes){
+	std::vector<std::string> allScopes;
+	allScopes.reserve(scopes.size()+1);
+	allScopes.push_back(id);
+	for(const auto& scope : scopes){
+		if(!scope.empty())
+			allScopes.push_back(scope);
+	}
+	for(const auto& scope : allScopes){
+		scopedGenerations.upsert(scopedGenerationKey(collection,scope),
+		                         [](uint64_t& generation){ generation++; },1);
+	}
+	generations[(unsigned int)collection]++;
+	allScopes.erase(allScopes.begin());
+	changeLog.append(collection,operation,id,std::move(allScopes));
+}
+
+const std::string& PersistentStore::getTableName(StoreCollection collection) const{
+	switch(collection){
+		case StoreCollection::Users: return userTableName;
+		case StoreCollection::Groups: return groupTableName;
+		case StoreCollection::Clusters: return clusterTableName;
+		case StoreCollection::Instances: return instanceTableName;
+		case StoreCollection::Secrets: return secretTableName;
+		case StoreCollection::MonitoringCredentials: return monCredTableName;
+		case StoreCollection::Volumes: return volumeTableName;
+		default: throw std::logic_error("Invalid collection");
+	}
+}
+
+namespace{
+	///Collect the distinct values of an attribute from before and after a change
+	std::set<std::string> changedValues(const ExternalChange& change, const std::string& attribute){
+		std::set<std::string> values;
+		for(const auto* attributes : {&change.oldAttributes,&change.newAttributes}){
+			auto it=attributes->find(attribute);
+			if(it!=attributes->end())
+				values.insert(it->second);
+		}
+		return values;
+	}
+	
+	///Get the value of an attribute after a change, or before it if the 
+	///record was removed
+	std::string lastValue(const ExternalChange& change, const std::string& attribute){
+		auto it=change.newAttributes.find(attribute);
+		if(it!=change.newAttributes.end())
+			return it->second;
+		it=change.oldAttributes.find(attribute);
+		if(it!=change.oldAttributes.end())
+			return it->second;
+		return "";
+	}
+}
+
+void PersistentStore::applyExternalChange(const ExternalChange& change){
+	SpanGuard span(tracer, "PersistentStore::applyExternalChange");
+	
+	//Entries are only ever discarded here, never replaced, so that the next 
+	//lookup fetches the authoritative version from the database. Category 
+	//caches are dropped as a whole, since a record may have been added to 
+	//them. Resetting a collection's expiration time forces the next full 
+	//listing to rescan. 
+	//A change made by this store was applied to the caches and recorded when 
+	//it was made
+	if(localWrites->consumeWrite(getTableName(change.collection),change.id,change.sortKey,change.newImage))
+		return;
+	const std::string& id=change.id;
+	const auto now=std::chrono::steady_clock::now();
+	switch(change.collection){
+		case StoreCollection::Users:
+			if(change.sortKey==id){
+				std::set<std::string> tokens=changedValues(change,"token");
+				std::set<std::string> globusIDs=changedValues(change,"globusID");
+				CacheRecord<User> record;
+				if(userCache.find(id,record)){
+					tokens.insert(record.record.token);
+					globusIDs.insert(record.record.globusID);
+				}
+				for(const auto& token : tokens)
+					userByTokenCache.erase(token);
+				for(const auto& globusID : globusIDs)
+					userByGlobusIDCache.erase(globusID);
+				userCache.erase(id);
+				userCacheExpirationTime=now;
+				recordChange(StoreCollection::Users,change.operation,id);
+			}
+			else{ //a group membership
+				std::string groupID=lastValue(change,"groupID");
+				if(groupID.empty())
+					groupID=change.sortKey.substr(change.sortKey.find(':')+1);
+				userByGroupCache.erase(groupID);
+				groupByUserCache.erase(id);
+				recordChange(StoreCollection::Users,ChangeOperation::Update,id);
+				recordChange(StoreCollection::Groups,ChangeOperation::Update,groupID);
+			}
+			break;
+		case StoreCollection::Groups:
+		{
+			std::set<std::string> names=changedValues(change,"name");
+			CacheRecord<Group> record;
+			if(groupCache.find(id,record))
+				names.insert(record.record.name);
+			for(const auto& name : names)
+				groupByNameCache.erase(name);
+			groupCache.erase(id);
+			groupCacheExpirationTime=now;
+			recordChange(StoreCollection::Groups,change.operation,id);
+			break;
+		}
+		case StoreCollection::Clusters:
+			if(id==geocodeRecordID) //not a cluster, so no change to record
+				geocodeCache.erase(change.sortKey);
+			else if(change.sortKey==id){
+				std::set<std::string> names=changedValues(change,"name");
+				std::set<std::string> groups=changedValues(change,"owningGroup");
+				CacheRecord<Cluster> record;
+				if(clusterCache.find(id,record)){
+					names.insert(record.record.name);
+					groups.insert(record.record.owningGroup);
+				}
+				for(const auto& name : names)
+					clusterByNameCache.erase(name);
+				for(const auto& group : groups)
+					clusterByGroupCache.erase(group);
+				clusterCache.erase(id);
+				clusterSummaryCache.erase(id);
+				if(change.operation==ChangeOperation::Remove){
+					clusterConfigs.erase(id);
+					clusterLocationCache.erase(id);
+				}
+				clusterCacheExpirationTime=now;
+				recordChange(StoreCollection::Clusters,change.operation,id,{lastValue(change,"owningGroup")});
+			}
+			else if(change.sortKey==id+":Locations"){
+				clusterLocationCache.erase(id);
+				recordChange(StoreCollection::Clusters,ChangeOperation::Update,id);
+			}
+			else{ //group access or application permissions
+				std::string groupID=change.sortKey.substr(id.size()+1);
+				const std::string appSuffix=":Applications";
+				if(groupID.size()>appSuffix.size() && 
+				   groupID.compare(groupID.size()-appSuffix.size(),appSuffix.size(),appSuffix)==0){
+					//the change does not include the set of applications, so 
+					//the whole index must be reloaded
+					invalidateAccessIndex();
+					groupID.erase(groupID.size()-appSuffix.size());
+				}
+				else{
+					bool allowed=(change.operation!=ChangeOperation::Remove);
+					updateAccessIndex([=](AccessIndex& index){ index.setGroupAccess(id,groupID,allowed); });
+				}
+				recordChange(StoreCollection::Clusters,ChangeOperation::Update,id,{groupID});
+			}
+			break;
+		case StoreCollection::Instances:
+			if(change.sortKey==id){
+				std::set<std::string> groups=changedValues(change,"owningGroup");
+				std::set<std::string> clusters=changedValues(change,"cluster");
+				std::set<std::string> names=changedValues(change,"name");
+				CacheRecord<ApplicationInstance> record;
+				if(instanceCache.find(id,record)){
+					groups.insert(record.record.owningGroup);
+					clusters.insert(record.record.cluster);
+					names.insert(record.record.name);
+				}
+				for(const auto& group : groups){
+					instanceByGroupCache.erase(group);
+					for(const auto& cluster : clusters)
+						instanceByGroupAndClusterCache.erase(group+":"+cluster);
+				}
+				for(const auto& cluster : clusters)
+					instanceByClusterCache.erase(cluster);
+				for(const auto& name : names)
+					instanceByNameCache.erase(name);
+				instanceCache.erase(id);
+				instanceConfigCache.erase(id);
+				instanceCacheExpirationTime=now;
+				recordChange(StoreCollection::Instances,change.operation,id,
+				             {lastValue(change,"owningGroup"),lastValue(change,"cluster")});
+			}
+			else //the configuration record, which is written with the instance
+				instanceConfigCache.erase(id);
+			break;
+		case StoreCollection::Secrets:
+		{
+			std::set<std::string> groups=changedValues(change,"owningGroup");
+			std::set<std::string> clusters=changedValues(change,"cluster");
+			CacheRecord<Secret> record;
+			if(secretCache.find(id,record)){
+				groups.insert(record.record.group);
+				clusters.insert(record.record.cluster);
+			}
+			for(const auto& group : groups){
+				secretByGroupCache.erase(group);
+				for(const auto& cluster : clusters)
+					secretByGroupAndClusterCache.erase(group+":"+cluster);
+			}
+			secretCache.erase(id);
+			recordChange(StoreCollection::Secrets,change.operation,id,
+			             {lastValue(change,"owningGroup"),lastValue(change,"cluster")});
+			break;
+		}
+		case StoreCollection::MonitoringCredentials:
+			//not cached, but another server may have allocated, revoked, or 
+			//deleted a credential in the pool
+			if(change.operation!=ChangeOperation::Add)
+				removeFromMonitoringCredentialPool(id);
+			recordChange(StoreCollection::MonitoringCredentials,change.operation,id);
+			break;
+		case StoreCollection::Volumes:
+		{
+			std::set<std::string> groups=changedValues(change,"owningGroup");
+			std::set<std::string> clusters=changedValues(change,"cluster");
+			CacheRecord<PersistentVolumeClaim> record;
+			if(volumeCache.find(id,record)){
+				groups.insert(record.record.group);
+				clusters.insert(record.record.cluster);
+			}
+			for(const auto& group : groups){
+				volumeByGroupCache.erase(group);
+				for(const auto& cluster : clusters)
+					volumeByGroupAndClusterCache.erase(group+":"+cluster);
+			}
+			for(const auto& cluster : clusters)
+				volumeByClusterCache.erase(cluster);
+			volumeCache.erase(id);
+			volumeCacheExpirationTime=now;
+			recordChange(StoreCollection::Volumes,change.operation,id,
+			             {lastValue(change,"owningGroup"),lastValue(change,"cluster")});
+			break;
+		}
+		default:
+			log_error("External change to unknown collection");
+	}
+	
+}
+
+void PersistentStore::discardCachedData(){
+	SpanGuard span(tracer, "PersistentStore::discardCachedData");
+	
+	log_warn("Discarding all cached records");
+	//Cluster configuration files are left in place, since they are replaced 
+	//whenever their clusters are fetched again
+	const auto now=std::chrono::steady_clock::now();
+	userCache.clear();
+	userByTokenCache.clear();
+	userByGlobusIDCache.clear();
+	userByGroupCache.clear();
+	userCacheExpirationTime=now;
+	groupCache.clear();
+	groupByNameCache.clear();
+	groupByUserCache.clear();
+	groupCacheExpirationTime=now;
+	clusterCache.clear();
+	clusterSummaryCache.clear();
+	clusterByNameCache.clear();
+	clusterByGroupCache.clear();
+	clusterLocationCache.clear();
+	clusterCacheExpirationTime=now;
+	instanceCache.clear();
+	instanceConfigCache.clear();
+	instanceByGroupCache.clear();
+	instanceByNameCache.clear();
+	instanceByClusterCache.clear();
+	instanceByGroupAndClusterCache.clear();
+	instanceCacheExpirationTime=now;
+	secretCache.clear();
+	secretByGroupCache.clear();
+	secretByGroupAndClusterCache.clear();
+	volumeCache.clear();
+	volumeByGroupCache.clear();
+	volumeByClusterCache.clear();
+	volumeByGroupAndClusterCache.clear();
+	volumeCacheExpirationTime=now;
+	geocodeCache.clear();
+	invalidateAccessIndex();
+	//Only once the caches are empty may clients holding tags from the old 
+	//epoch be told to fetch again
+	generationEpochResets++;
+}
+
+std::string to_string(StoreCollection collection){
+	switch(collection){
+		case StoreCollection::Users: return "User";
+		case StoreCollection::Groups: return "Group";
+		case StoreCollection::Clusters: return "Cluster";
+		case StoreCollection::Instances: return "ApplicationInstance";
+		case StoreCollection::Secrets: return "Secret";
+		case StoreCollection::MonitoringCredentials: return "MonitoringCredential";
+		case StoreCollection::Volumes: return "PersistentVolumeClaim";
+		default: return "Unknown";
+	}
+}
+
+std::string to_string(ChangeOperation operation){
+	switch(operation){
+		case ChangeOperation::Add: return "add";
+		case ChangeOperation::Update: return "update";
+		case ChangeOperation::Remove: return "remove";
+		case ChangeOperation::Reachable: return "reachable";
+		case ChangeOperation::Unreachable: return "unreachable";
+		default: return "unknown";
+	}
+}
+
+ChangeLog::ChangeLog(std::size_t capacity):events(capacity),revision(0){
+	if(capacity==0)
+		throw std::logic_error("Change log capacity must be positive");
+}
+
+uint64_t ChangeLog::append(StoreCollection collection, ChangeOperation operation, 
+                           const std::string& id, std::vector<std::string> scopes){
+	uint64_t assigned;
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		assigned=++revision;
+		ChangeEvent& event=events[assigned%events.size()];
+		event.revision=assigned;
+		event.collection=collection;
+		event.operation=operation;
+		event.id=id;
+		event.scopes=std::move(scopes);
+	}
+	changed.notify_all();
+	return assigned;
+}
+
+uint64_t ChangeLog::currentRevision() const{
+	std::lock_guard<std::mutex> lock(mut);
+	return revision;
+}
+
+std::vector<ChangeEvent> ChangeLog::changesSince(uint64_t since, bool& complete) const{
+	std::lock_guard<std::mutex> lock(mut);
+	std::vector<ChangeEvent> result;
+	if(since>revision){
+		complete=false;
+		return result;
+	}
+	//the oldest revision still retained
+	uint64_t oldest=(revision>events.size() ? revision-events.size()+1 : 1);
+	complete=(since+1>=oldest);
+	uint64_t first=std::max(since+1,oldest);
+	result.reserve(revision+1-first);
+	for(uint64_t r=first; r<=revision; r++)
+		result.push_back(events[r%events.size()]);
+	return result;
+}
+
+bool ChangeLog::waitForChanges(uint64_t since, std::chrono::milliseconds timeout) const{
+	std::unique_lock<std::mutex> lock(mut);
+	return changed.wait_for(lock,timeout,[&]{ return revision>since; });
+}
+
 bool PersistentStore::normalizeGroupID(std::string& groupID, bool allowWildcard){
 	if(allowWildcard){
 		if (groupID == wildcard) {
@@ -1,14 +1,17 @@
 #include "Process.h"
 
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
 
 #include <fcntl.h>
 #include <paths.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -31,16 +34,49 @@ void setNonblocking(int fd){
 }
 
 namespace{
-sig_atomic_t reapFlag=0;
+///Set by the signal handler when a child exits. Lock-free atomics are safe to
+///use in signal handlers, and unlike sig_atomic_t are also safe to share with
+///the reaper thread. 
+std::atomic<bool> reapFlag(false);
+///A pipe to which a byte is written for each SIGCHLD, so that the reaper thread
+///can sleep in poll() until there is work for it
+int reapPipe[2]={-1,-1};
 
 void handleSIGCHLD(int, siginfo_t* info, void* uap){
-	reapFlag=1;
-	//const char msg[]="We get signal!\n";
-	//write(1,msg,sizeof(msg));
+	int savedErrno=errno;
+	reapFlag=true;
+	if(reapPipe[1]!=-1){
+		const char wake=0;
+		//if the pipe is full the reaper is already due to wake up
+		ssize_t res=write(reapPipe[1],&wake,1);
+		(void)res;
+	}
+	errno=savedErrno;
+}
+
+///Wake the reaper thread without indicating that any child has exited
+void wakeReaper(){
+	const char wake=0;
+	ssize_t res=write(reapPipe[1],&wake,1);
+	(void)res;
+}
+
+///Discard all pending wake-ups from the reaper pipe
+void drainReapPipe(){
+	char buf[64];
+	while(read(reapPipe[0],buf,sizeof(buf))>0){}
 }
 	
 struct PrepareForSignals{
 	PrepareForSignals(){
+		if(pipe(reapPipe)==-1){
+			auto err=errno;
+			throw std::runtime_error("reaper pipe: "+std::to_string(err));
+		}
+		for(int fd : reapPipe){
+			setNonblocking(fd);
+			fcntl(fd,F_SETFD,FD_CLOEXEC);
+		}
 		struct sigaction act;
 		act.sa_flags=SA_RESTART | SA_NOCLDSTOP | SA_SIGINFO;
 		act.sa_sigaction=handleSIGCHLD;
@@ -60,7 +96,25 @@ struct PrepareForSignals{
 } signalPrep;
 	
 std::atomic<bool> reaperStop;
+///Used with reaperStopped to wait for the reaper thread to finish
+std::mutex reaperMutex;
+///Notified when the reaper thread finishes
+std::condition_variable reaperStopped;
+///Whether the reaper thread is running, protected by reaperMutex
+bool reaperRunning=false;
 cuckoohash_map<pid_t,ProcessRecord> processTable;
+
+///Used with exitCondition to wait for child processes to exit
+std::mutex exitMutex;
+///Notified whenever the reaper collects the exit status of a child process
+std::condition_variable exitCondition;
+
+void notifyExit(){
+	//Taking the lock orders this notification after any waiter's check of its 
+	//handle's exit status, so the notification cannot be missed
+	{ std::lock_guard<std::mutex> lock(exitMutex); }
+	exitCondition.notify_all();
+}
 } //anonymous namespace
 
 ProcessIOBuffer::ProcessIOBuffer():
@@ -197,43 +251,29 @@ void ProcessIOBuffer::endInput(){
 }
 
 bool ProcessIOBuffer::waitReady(rw direction, bool wait){
-	fd_set set;
-	fd_set* readset=NULL;
-	fd_set* writeset=NULL;
-	FD_ZERO(&set);
-	int maxfd=-1;
-	if(direction==READ){
-		FD_SET(fd_out,&set);
-		maxfd=fd_out+1;
-		readset=&set;
-	}
-	else{
-		FD_SET(fd_in,&set);
-		maxfd=fd_in+1;
-		writeset=&set;
-	}
+	struct pollfd pfd;
+	pfd.fd=(direction==READ ? fd_out : fd_in);
+	pfd.events=(direction==READ ? POLLIN : POLLOUT);
 	while(true){
-		struct timeval timeout;
-		timeout.tv_sec=0;
-		timeout.tv_usec=0;
-		int result=select(maxfd,readset,writeset,NULL,(wait?NULL:&timeout));
+		pfd.revents=0;
+		int result=poll(&pfd,1,(wait ? -1 : 0));
 		if(result==-1){
 			int err=errno;
 			if(err!=EAGAIN && err!=EINTR){
-				std::cerr << "select gave error " << err << std::endl;
-				if(err==9){
-					std::cerr << "fds were: fd_out=" << fd_out << " fd_in=" 
-					<< fd_in << " maxfd=" << maxfd << " direction=" 
-					<< (direction==READ ? "READ" : "WRITE") << std::endl;
-				}
+				std::cerr << "poll gave error " << err << std::endl;
 				return false;
 			}
 		}
 		else{
-			if (direction == READ && FD_ISSET(fd_out, readset)) {
-				return true;
+			if(pfd.revents & POLLNVAL){
+				std::cerr << "fds were: fd_out=" << fd_out << " fd_in=" 
+				<< fd_in << " direction=" 
+				<< (direction==READ ? "READ" : "WRITE") << std::endl;
+				return false;
 			}
-			if (direction == WRITE && FD_ISSET(fd_in, writeset)) {
+			//hangups and errors count as ready, since the following read or 
+			//write will report them
+			if (pfd.revents) {
 				return true;
 			}
 			if (!wait) {
@@ -358,13 +398,27 @@ char ProcessHandle::exitStatus() const{
 	return exitStatusValue;
 }
 
+void ProcessHandle::waitForExit() const{
+	assert(child && "child process must not be detached");
+	std::unique_lock<std::mutex> lock(exitMutex);
+	exitCondition.wait(lock,[this]{ return hasExitStatus.load(); });
+}
+
+bool ProcessHandle::waitForExit(std::chrono::steady_clock::time_point deadline) const{
+	assert(child && "child process must not be detached");
+	std::unique_lock<std::mutex> lock(exitMutex);
+	return exitCondition.wait_until(lock,deadline,[this]{ return hasExitStatus.load(); });
+}
+
 void ProcessHandle::setExitStatus(unsigned char status){
 	exitStatusValue=status;
 	hasExitStatus=true;
 }
 
 void reapProcesses(){
-	if (!reapFlag) {
+	//Clear the flag before collecting children, so that a child which exits 
+	//after the last call to waitpid sets it again rather than being forgotten
+	if (!reapFlag.exchange(false)) {
 		return;
 	}
 	int stat;
@@ -372,13 +426,11 @@ void reapProcesses(){
 	while(true){
 		p=waitpid(-1,&stat,WNOHANG);
 		if(!p){ //great, done
-			reapFlag=0;
 			return;
 		}
 		if(p==-1){
 			auto err=errno;
 			if(err==ECHILD){ //great, done
-				reapFlag=0;
 				return;
 			}
 			if (err == EINTR) {
@@ -402,29 +454,44 @@ void reapProcesses(){
 				}
 				return true; //delete record
 			},ProcessRecord(exitStatus));
+			notifyExit();
 		}
 	}
 }
 
 void startReaper(){
 	reaperStop.store(false);
+	{
+		std::lock_guard<std::mutex> lock(reaperMutex);
+		reaperRunning=true;
+	}
 	std::thread reaper([](){
+		struct pollfd wake;
+		wake.fd=reapPipe[0];
+		wake.events=POLLIN;
 		while(!reaperStop.load()){
+			drainReapPipe();
 			reapProcesses();
-			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			//sleep until the signal handler or stopReaper writes to the pipe
+			wake.revents=0;
+			poll(&wake,1,-1);
 		}
-		//set the flag back to its original state to signal stopping
-		reaperStop.store(false);
+		{
+			std::lock_guard<std::mutex> lock(reaperMutex);
+			reaperRunning=false;
+		}
+		reaperStopped.notify_all();
 	});
 	reaper.detach();
 }
 
 void stopReaper(){
 	reaperStop.store(true);
+	wakeReaper();
 	//wait for background thread to signal that it has indeed stopped
-	while(!reaperStop.load()){
-		std::this_thread::sleep_for(std::chrono::milliseconds(500));
-	}
+	std::unique_lock<std::mutex> lock(reaperMutex);
+	reaperStopped.wait(lock,[]{ return !reaperRunning; });
+	reaperStop.store(false);
 }
 
 extern char **environ;
@@ -594,57 +661,156 @@ ProcessHandle startProcessAsync(std::string exe, const std::vector<std::string>&
 
 
 namespace{
-	void collectChildOutput(ProcessHandle& child, commandResult& result){
-		std::unique_ptr<char[]> buf(new char[1024]);
-		char* bufptr=buf.get();
-		//collect stdout
-		//std::cout << "collecting child stdout" << std::endl;
-		std::istream& child_stdout=child.getStdout();
-		while(!child_stdout.eof()){
-			char* ptr=bufptr;
-			child_stdout.read(ptr,1);
-			ptr+=child_stdout.gcount();
-			child_stdout.readsome(ptr,1023);
-			ptr+=child_stdout.gcount();
-			result.output.append(bufptr,ptr-bufptr);
+	///Forcibly stop a child process, first politely, then not
+	void terminateChild(ProcessHandle& child){
+		child.kill();
+		if(!child.waitForExit(std::chrono::steady_clock::now()+std::chrono::seconds(1))){
+			::kill(child.getPid(),SIGKILL);
+			child.waitForExit();
 		}
-		//collect stderr
-		//std::cout << "collecting child stderr" << std::endl;
-		std::istream& child_stderr=child.getStderr();
-		while(!child_stderr.eof()){
-			char* ptr=bufptr;
-			child_stderr.read(ptr,1);
-			ptr+=child_stderr.gcount();
-			child_stderr.readsome(ptr,1023);
-			ptr+=child_stderr.gcount();
-			result.error.append(bufptr,ptr-bufptr);
+	}
+
+	///Feed input to a child process while collecting its output and error 
+	///streams, all concurrently so that the child cannot block on any one of 
+	///them, and then wait for it to exit
+	void collectChildOutput(ProcessHandle& child, commandResult& result, 
+	                        const commandLimits& limits, const std::string& input=""){
+		using clock=std::chrono::steady_clock;
+		const bool hasDeadline=limits.timeout>std::chrono::milliseconds::zero();
+		const clock::time_point deadline=clock::now()+limits.timeout;
+		result.status=255;
+		result.timedOut=false;
+		result.truncated=false;
+		
+		const std::size_t bufferSize=65536;
+		std::unique_ptr<char[]> buf(new char[bufferSize]);
+		std::size_t inputWritten=0;
+		if(input.empty())
+			child.endInput();
+		
+		//poll ignores entries whose fds are negative, so each is set to -1 
+		//when its stream is finished
+		struct pollfd fds[3];
+		fds[0].fd=child.getStdinFD();
+		fds[0].events=POLLOUT;
+		fds[1].fd=child.getStdoutFD();
+		fds[1].events=POLLIN;
+		fds[2].fd=child.getStderrFD();
+		fds[2].events=POLLIN;
+		std::string* destinations[3]={nullptr,&result.output,&result.error};
+		
+		while(fds[0].fd>=0 || fds[1].fd>=0 || fds[2].fd>=0){
+			int timeout=-1;
+			if(hasDeadline){
+				auto now=clock::now();
+				if(now>=deadline){
+					result.timedOut=true;
+					break;
+				}
+				//round up so that we do not wake just before the deadline
+				timeout=std::chrono::duration_cast<std::chrono::milliseconds>(deadline-now).count()+1;
+			}
+			for(auto& pfd : fds)
+				pfd.revents=0;
+			if(poll(fds,3,timeout)==-1){
+				auto err=errno;
+				if(err==EINTR || err==EAGAIN)
+					continue;
+				throw std::runtime_error("poll failed: Error "+std::to_string(err)+": "+strerror(err));
+			}
+			
+			if(fds[0].fd>=0 && fds[0].revents){
+				bool failed=true;
+				if(fds[0].revents & POLLOUT){
+					ssize_t written=write(fds[0].fd,input.data()+inputWritten,input.size()-inputWritten);
+					if(written>=0)
+						inputWritten+=written;
+					failed=(written<0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR);
+				}
+				if(failed)
+					inputWritten=input.size(); //the child will not read the rest
+				if(inputWritten==input.size()){
+					child.endInput();
+					fds[0].fd=-1;
+				}
+			}
+			
+			for(int i=1; i<3; i++){
+				if(fds[i].fd<0 || !fds[i].revents)
+					continue;
+				ssize_t amountRead=read(fds[i].fd,buf.get(),bufferSize);
+				if(amountRead>0){
+					std::string& dest=*destinations[i];
+					std::size_t keep=amountRead;
+					if(limits.maxOutput && dest.size()+keep>limits.maxOutput){
+						keep=limits.maxOutput-dest.size();
+						result.truncated=true;
+					}
+					dest.append(buf.get(),keep);
+				}
+				else if(amountRead==0 || (errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR))
+					fds[i].fd=-1;
+			}
 		}
-		//std::cout << "waiting for child exit" << std::endl;
-		while (!child.done()) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		
+		if(!result.timedOut){
+			if(!hasDeadline)
+				child.waitForExit();
+			else if(!child.waitForExit(deadline))
+				result.timedOut=true;
 		}
+		if(result.timedOut)
+			terminateChild(child);
 		result.status=child.exitStatus();
 	}
 }
 
+namespace{
+	std::mutex defaultLimitsMutex;
+	
+	///Held in a function local static so that defaults may be set during 
+	///static initialization of other translation units
+	std::map<std::string,commandLimits>& defaultLimits(){
+		static std::map<std::string,commandLimits> limits;
+		return limits;
+	}
+	
+	commandLimits effectiveLimits(const std::string& command, const commandLimits& limits){
+		if(!limits.unlimited())
+			return limits;
+		std::lock_guard<std::mutex> lock(defaultLimitsMutex);
+		auto it=defaultLimits().find(command);
+		if(it==defaultLimits().end())
+			return limits;
+		return it->second;
+	}
+}
+
+void setDefaultCommandLimits(const std::string& command, const commandLimits& limits){
+	std::lock_guard<std::mutex> lock(defaultLimitsMutex);
+	if(limits.unlimited())
+		defaultLimits().erase(command);
+	else
+		defaultLimits()[command]=limits;
+}
+
 commandResult runCommand(const std::string& command,
 			 const std::vector<std::string>& args,
-			 const std::map<std::string, std::string>& env) {
+			 const std::map<std::string, std::string>& env,
+			 const commandLimits& limits) {
 	commandResult result;
 	ProcessHandle child=startProcessAsync(command,args,env);
-	collectChildOutput(child,result);
+	collectChildOutput(child,result,effectiveLimits(command,limits));
 	return result;
 }
 
 commandResult runCommandWithInput(const std::string& command,
 				  const std::string& input,
 				  const std::vector<std::string>& args,
-				  const std::map<std::string, std::string>& env) {
+				  const std::map<std::string, std::string>& env,
+				  const commandLimits& limits) {
 	commandResult result;
 	ProcessHandle child=startProcessAsync(command,args,env);
-	child.getStdin() << input;
-	child.getStdin().flush();
-	child.endInput();
-	collectChildOutput(child,result);
+	collectChildOutput(child,result,effectiveLimits(command,limits),input);
 	return result;
 }
@@ -76,13 +76,7 @@ struct SecretStringBuffer{
 };
 
 crow::response listSecrets(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -91,7 +85,6 @@ crow::response listSecrets(PersistentStore& store, const crow::request& req){
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -103,7 +96,6 @@ crow::response listSecrets(PersistentStore& store, const crow::request& req){
 	if(!groupRaw) {
 		const std::string& errMsg = "Group not specified";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -117,7 +109,6 @@ crow::response listSecrets(PersistentStore& store, const crow::request& req){
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -127,7 +118,6 @@ crow::response listSecrets(PersistentStore& store, const crow::request& req){
 	if(!user.admin && !store.userInGroup(user.id,group.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -155,18 +145,27 @@ crow::response listSecrets(PersistentStore& store, const crow::request& req){
 		resultItems.PushBack(secretResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
+std::string listSecretsETag(PersistentStore& store, const crow::request& req){
+	auto groupRaw = req.url_params.get("group");
+	if(!groupRaw)
+		return "";
+	const Group group=store.getGroup(groupRaw);
+	if(!group)
+		return "";
+	//whether the user may see the secrets depends on the user's admin status 
+	//and group memberships, and the listing includes the cluster names
+	return makeETag(store.getETagEpoch(), req.raw_url,
+	                {store.getGeneration(StoreCollection::Secrets, group.id),
+	                 store.getGeneration(StoreCollection::Users),
+	                 store.getGeneration(StoreCollection::Groups, group.id),
+	                 store.getGeneration(StoreCollection::Clusters)});
+}
+
 crow::response createSecret(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -174,7 +173,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -186,7 +184,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg + " exception: " + err.what(), 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -194,21 +191,18 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("metadata")) {
 		const std::string& errMsg = "Missing user metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for metadata";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -216,42 +210,36 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(!body["metadata"].HasMember("name")) {
 		const std::string& errMsg = "Missing secret name in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["name"].IsString()) {
 		const std::string& errMsg = "Incorrect type for secret name";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].HasMember("group")) {
 		const std::string& errMsg = "Missing Group ID in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["group"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group ID";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].HasMember("cluster")) {
 		const std::string& errMsg = "Missing cluster ID in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["cluster"].IsString()) {
 		const std::string& errMsg = "Incorrect type for cluster ID";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -259,28 +247,24 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(body.HasMember("contents") && body.HasMember("copyFrom")) {
 		const std::string& errMsg = "Secret contents and copy source cannot both be specified";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("contents") && !body.HasMember("copyFrom")) {
 		const std::string& errMsg = "Missing secret contents or source in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.HasMember("contents") && !body["contents"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for contents";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.HasMember("copyFrom") && !body["copyFrom"].IsString()) {
 		const std::string& errMsg = "Incorrect type for copyFrom";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -296,21 +280,18 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 			if(!member.value.IsString()) {
 				const std::string& errMsg = "Secret value is not a string";
 				setWebSpanError(span, errMsg, 400);
-				span->End();
 				log_error(errMsg);
 				return crow::response(400, generateError(errMsg));
 			}
 			if(member.name.GetStringLength()==0) {
 				const std::string& errMsg = "Secret keys may not be empty";
 				setWebSpanError(span, errMsg, 400);
-				span->End();
 				log_error(errMsg);
 				return crow::response(400, generateError(errMsg));
 			}
 			if(member.name.GetStringLength()>253) {
 				const std::string& errMsg = "Secret keys may be no more than 253 characters";
 				setWebSpanError(span, errMsg, 400);
-				span->End();
 				log_error(errMsg);
 				return crow::response(400, generateError(errMsg));
 			}
@@ -318,14 +299,12 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 			   .find_first_not_of(allowedKeyCharacters)!=std::string::npos) {
  				const std::string& errMsg = "Secret key does not match [-._a-zA-Z0-9]+";
 				setWebSpanError(span, errMsg, 400);
-				span->End();
 				log_error(errMsg);
 				return crow::response(400, generateError(errMsg));
 			}
 			if(!sanityCheckBase64(member.value.GetString())){
 				const std::string& errMsg = "Secret data items must be base64 encoded";
 				setWebSpanError(span, errMsg, 400);
-				span->End();
 				log_error(errMsg);
 				return crow::response(400, generateError(errMsg));
 			}
@@ -343,14 +322,12 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(secret.name.size()>253) {
 		const std::string& errMsg = "Secret name too long";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(secret.name.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789-.")!=std::string::npos) {
 		const std::string& errMsg = "Secret name contains an invalid character";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -359,7 +336,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -372,7 +348,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(!store.userInGroup(user.id,group.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -381,7 +356,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -395,7 +369,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(group.id!=cluster.owningGroup && !store.groupAllowedOnCluster(group.id,cluster.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -405,7 +378,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	if(existing) {
 		const std::string& errMsg = "A secret with the same name already exists";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -434,7 +406,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 		if(!existing) {
 			const std::string& errMsg = "The specified source secret does not exist";
 			setWebSpanError(span, errMsg, 404);
-			span->End();
 			log_error(errMsg);
 			return crow::response(404, generateError(errMsg));
 		}
@@ -442,7 +413,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 		if(!store.userInGroup(user.id,existing.group)) {
 			const std::string& errMsg = "User not authorized";
 			setWebSpanError(span, errMsg, 403);
-			span->End();
 			log_error(errMsg);
 			return crow::response(403, generateError(errMsg));
 		}
@@ -464,14 +434,12 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 		if(!success) {
 			const std::string& errMsg = "Failed to store secret to the persistent store";
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			log_error(errMsg);
 			return crow::response(500, generateError(errMsg));
 		}
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Failed to store secret to the persistent store";
 		setWebSpanError(span, errMsg + ": " + err.what(), 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -487,42 +455,31 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 			store.removeSecret(secret.id);
 			const std::string& errMsg = std::string("Failed to create namespace: ") + err.what();
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			log_error(errMsg);
 			return crow::response(500, generateError(errMsg));
 		}
 		
 		//build up the kubectl command to create the secret. this involves 
 		//writing each secret value to a temporary file to avoid losing data if 
-		//there are NUL bytes. This is not very nice because it means that 
-		//unencrypted secrets are temporarily on the local filesystem (and on 
-		//an SSD) may continue to exist on the disk for a long time. The only 
-		//alternative would be to compose a large YAML document specifying the 
-		//secret and streaming it directly to kubectl, but input to child 
+		//there are NUL bytes. These are in-memory files where supported, so 
+		//that unencrypted secrets are not left on the local filesystem; 
+		//otherwise they may continue to exist on the disk for a long time. 
+		//The alternative would be to compose a large YAML document specifying 
+		//the secret and streaming it directly to kubectl, but input to child 
 		//processes seems to be unreliable at the moment for reasons which are unclear. 
 		std::vector<std::string> arguments={"create","secret","generic",
 		                                    secret.name,"--namespace",group.namespaceName()};
 		std::vector<FileHandle> valueFiles;
 		for(const auto& member : body["contents"].GetObject()){
 			const std::string value=decodeBase64(member.value.GetString());
-			valueFiles.emplace_back(makeTemporaryFile("secret_"));
-			std::string outPath=valueFiles.back();
-			{
-				std::ofstream outFile(outPath);
-				if(!outFile) {
-					const std::string& errMsg = "Failed to open " + outPath + " for writing";
-					setWebSpanError(span, errMsg, 500);
-					span->End();
-					log_fatal(errMsg);
-				}
-				outFile.write(value.c_str(),value.size());
-				if(outFile.fail()) {
-					const std::string& errMsg = "Failed while writing to " + outPath;
-					setWebSpanError(span, errMsg, 500);
-					span->End();
-					log_fatal(errMsg);
-				}
+			try{
+				valueFiles.emplace_back(makeMemoryFile("secret_",value));
+			}catch(std::runtime_error& err){
+				const std::string& errMsg = "Failed to write secret value: " + std::string(err.what());
+				setWebSpanError(span, errMsg, 500);
+				log_fatal(errMsg);
 			}
+			std::string outPath=valueFiles.back();
 			arguments.push_back(std::string("--from-file=")+member.name.GetString()
 			+std::string("=")+outPath);
 		}
@@ -534,7 +491,6 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 			//if installation fails, remove from the database again
 			store.removeSecret(secret.id);
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			return crow::response(500, generateError(errMsg));
 		}
 	}
@@ -552,19 +508,12 @@ crow::response createSecret(PersistentStore& store, const crow::request& req){
 	metadata.AddMember("name", secret.name, alloc);
 	result.AddMember("metadata", metadata, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response deleteSecret(PersistentStore& store, const crow::request& req,
 			    const std::string& secretID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -572,7 +521,6 @@ crow::response deleteSecret(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -581,7 +529,6 @@ crow::response deleteSecret(PersistentStore& store, const crow::request& req,
 	if(!secret) {
 		const std::string& errMsg = "Secret not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -590,7 +537,6 @@ crow::response deleteSecret(PersistentStore& store, const crow::request& req,
 	if(!store.userInGroup(user.id,secret.group)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -599,11 +545,9 @@ crow::response deleteSecret(PersistentStore& store, const crow::request& req,
 	auto err=internal::deleteSecret(store,secret,force);
 	if(!err.empty()) {
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error(err);
 		return crow::response(500, generateError(err));
 	}
-	span->End();
 	return crow::response(200);
 }
 
@@ -653,13 +597,7 @@ namespace internal {
 
 crow::response getSecret(PersistentStore& store, const crow::request& req,
 			 const std::string& secretID) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -667,7 +605,6 @@ crow::response getSecret(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -676,7 +613,6 @@ crow::response getSecret(PersistentStore& store, const crow::request& req,
 	if(!secret) {
 		const std::string& errMsg = "Secret not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -685,7 +621,6 @@ crow::response getSecret(PersistentStore& store, const crow::request& req,
 	if(!store.userInGroup(user.id,secret.group)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -713,11 +648,9 @@ crow::response getSecret(PersistentStore& store, const crow::request& req,
 	} catch(std::runtime_error& err){
 		const std::string& errMsg = std::string("Secret decryption failed: ") + err.what();
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
 
-	span->End();
 	return crow::response(to_string(result));
 }
@@ -0,0 +1,107 @@
+#include "ServerTLS.h"
+
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+
+namespace{
+
+std::atomic<std::size_t> fullHandshakes(0);
+std::atomic<std::size_t> resumedHandshakes(0);
+
+void countHandshakes(const SSL* ssl, int where, int){
+	if(where & SSL_CB_HANDSHAKE_DONE){
+		if(SSL_session_reused(const_cast<SSL*>(ssl)))
+			resumedHandshakes++;
+		else
+			fullHandshakes++;
+	}
+}
+
+///Expand a secret of arbitrary length into the number of bytes OpenSSL needs
+///for its ticket name, HMAC, and encryption keys.
+std::vector<unsigned char> deriveTicketKeys(const std::string& secret, std::size_t length){
+	const static std::string label="slate-service TLS session tickets";
+	std::vector<unsigned char> keys;
+	for(unsigned char counter=1; keys.size()<length; counter++){
+		std::string input=label;
+		input+=(char)counter;
+		input+=secret;
+		unsigned char digest[EVP_MAX_MD_SIZE];
+		unsigned int digestLength=0;
+		if(!EVP_Digest(input.data(),input.size(),digest,&digestLength,EVP_sha512(),nullptr))
+			throw std::runtime_error("Failed to derive TLS session ticket keys");
+		keys.insert(keys.end(),digest,digest+digestLength);
+	}
+	keys.resize(length);
+	return keys;
+}
+
+void setTicketKeys(SSL_CTX* ctx, const std::string& path){
+	std::ifstream keyFile(path);
+	if(!keyFile)
+		throw std::runtime_error("Unable to read TLS session ticket key file "+path);
+	std::stringstream buffer;
+	buffer << keyFile.rdbuf();
+	std::string secret=buffer.str();
+	while(!secret.empty() && std::isspace((unsigned char)secret.back()))
+		secret.pop_back();
+	if(secret.size()<32)
+		throw std::runtime_error("TLS session ticket key file "+path
+		                         +" must contain at least 32 bytes of secret data");
+
+	long length=SSL_CTX_get_tlsext_ticket_keys(ctx,nullptr,0);
+	if(length<=0)
+		throw std::runtime_error("Unable to determine the size of TLS session ticket keys");
+	std::vector<unsigned char> keys=deriveTicketKeys(secret,length);
+	if(SSL_CTX_set_tlsext_ticket_keys(ctx,keys.data(),keys.size())!=1)
+		throw std::runtime_error("Failed to set TLS session ticket keys");
+}
+
+} //anonymous namespace
+
+boost::asio::ssl::context makeServerTLSContext(const TLSSettings& settings){
+	using boost::asio::ssl::context;
+	context ctx(context::sslv23);
+	try{
+		//These match the settings Crow applies for ssl_file()
+		ctx.set_verify_mode(boost::asio::ssl::verify_peer);
+		ctx.use_certificate_chain_file(settings.certificateFile);
+		ctx.use_private_key_file(settings.keyFile,context::pem);
+		ctx.set_options(context::default_workarounds
+		                | context::no_sslv2
+		                | context::no_sslv3);
+	}catch(boost::system::system_error& err){
+		throw std::runtime_error("Unable to load TLS certificate or key: "+std::string(err.what()));
+	}
+
+	SSL_CTX* native=ctx.native_handle();
+	//Sessions are only resumed within the same context ID; this is required
+	//when peer verification is enabled
+	const static std::string sessionContext="slate-service";
+	SSL_CTX_set_session_id_context(native,(const unsigned char*)sessionContext.data(),
+	                               sessionContext.size());
+	SSL_CTX_set_session_cache_mode(native,SSL_SESS_CACHE_SERVER);
+	SSL_CTX_sess_set_cache_size(native,settings.sessionCacheSize);
+	SSL_CTX_set_timeout(native,settings.sessionTimeout);
+	//Session tickets are enabled by default; ensure nothing has disabled them
+	SSL_CTX_clear_options(native,SSL_OP_NO_TICKET);
+	if(!settings.ticketKeyFile.empty())
+		setTicketKeys(native,settings.ticketKeyFile);
+	SSL_CTX_set_info_callback(native,&countHandshakes);
+
+	return ctx;
+}
+
+std::string getTLSStatistics(){
+	std::ostringstream os;
+	os << "TLS full handshakes: " << fullHandshakes.load() << "\n";
+	os << "TLS resumed handshakes: " << resumedHandshakes.load() << "\n";
+	return os.str();
+}
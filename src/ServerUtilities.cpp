@@ -5,6 +5,7 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include "JSONExtractor.h"
 #include "Process.h"
 
 std::string timestamp(){
@@ -265,4 +266,126 @@ std::string generateSuffixedString(long value) {
 		}
 		i++;
 	}
-}
\ No newline at end of file
+}
+
+std::string makeETag(const std::string& epoch, const std::string& requestKey, 
+                     const std::vector<uint64_t>& generations){
+	std::ostringstream tag;
+	tag << '"' << epoch << '-' << std::hex << std::hash<std::string>{}(requestKey);
+	for(const auto generation : generations)
+		tag << '-' << generation;
+	tag << '"';
+	return tag.str();
+}
+
+bool matchesETag(const crow::request& req, const std::string& etag){
+	const std::string& header=req.get_header_value("If-None-Match");
+	if(header.empty())
+		return false;
+	for(std::string candidate : string_split_columns(header, ',', false)){
+		if(candidate=="*")
+			return true;
+		//If-None-Match uses the weak comparison, so any weakness indicator is 
+		//irrelevant
+		if(candidate.find("W/")==0)
+			candidate=candidate.substr(2);
+		if(candidate==etag)
+			return true;
+	}
+	return false;
+}
+
+namespace{
+	///Split a field pointer, allowing the leading slash to be omitted
+	std::vector<std::string> splitFieldPointer(const std::string& pointer){
+		if(!pointer.empty() && pointer.front()=='/')
+			return splitJSONPointer(pointer);
+		return splitJSONPointer("/"+pointer);
+	}
+}
+
+FieldSelection::FieldSelection(const std::string& fields){
+	for(const std::string& field : string_split_columns(fields, ',', false)){
+		std::string pointer=trim(field);
+		if(pointer.empty() || pointer=="/")
+			continue;
+		paths.push_back(splitFieldPointer(pointer));
+	}
+}
+
+FieldSelection::FieldSelection(const crow::request& req):
+FieldSelection(req.url_params.get("fields") ? req.url_params.get("fields") : ""){}
+
+bool FieldSelection::includes(const std::string& pointer) const{
+	if(all())
+		return true;
+	const std::vector<std::string> target=splitFieldPointer(pointer);
+	for(const auto& path : paths){
+		bool matches=true;
+		for(std::size_t i=0; i<path.size() && i<target.size() && matches; i++)
+			matches=(path[i]=="*" || path[i]==target[i]);
+		if(matches)
+			return true;
+	}
+	return false;
+}
+
+void FieldSelection::apply(rapidjson::Value& object) const{
+	if(all() || !object.IsObject())
+		return;
+	std::vector<std::size_t> candidates(paths.size());
+	for(std::size_t i=0; i<paths.size(); i++)
+		candidates[i]=i;
+	prune(object,candidates,0);
+}
+
+void FieldSelection::prune(rapidjson::Value& value, const std::vector<std::size_t>& candidates, 
+                           std::size_t depth) const{
+	//Determine whether the child with the given name is kept entirely, or only
+	//in part, in which case the paths which continue into it are collected
+	auto select=[&](const std::string& name, std::vector<std::size_t>& next)->bool{
+		next.clear();
+		bool captured=false;
+		for(std::size_t i : candidates){
+			const auto& path=paths[i];
+			if(path[depth]!="*" && path[depth]!=name)
+				continue;
+			if(path.size()==depth+1)
+				captured=true;
+			else
+				next.push_back(i);
+		}
+		return captured;
+	};
+	std::vector<std::size_t> next;
+	if(value.IsObject()){
+		for(auto member=value.MemberBegin(); member!=value.MemberEnd();){
+			const std::string name(member->name.GetString(),member->name.GetStringLength());
+			bool captured=select(name,next);
+			if(depth==0 && (name=="apiVersion" || name=="kind"))
+				captured=true;
+			if(captured)
+				++member;
+			else if(!next.empty() && (member->value.IsObject() || member->value.IsArray())){
+				prune(member->value,next,depth+1);
+				++member;
+			}
+			else
+				member=value.EraseMember(member);
+		}
+	}
+	else if(value.IsArray()){
+		std::size_t index=0;
+		for(auto element=value.Begin(); element!=value.End(); index++){
+			bool captured=select(std::to_string(index),next);
+			if(captured)
+				++element;
+			else if(!next.empty() && (element->IsObject() || element->IsArray())){
+				prune(*element,next,depth+1);
+				++element;
+			}
+			else
+				element=value.Erase(element);
+		}
+	}
+}
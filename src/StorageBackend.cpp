@@ -0,0 +1,230 @@
+#include "StorageBackend.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Aws::DynamoDB::Model;
+
+DynamoDBBackend::DynamoDBBackend(const Aws::Auth::AWSCredentials& credentials,
+                                 const Aws::Client::ClientConfiguration& clientConfig):
+dbClient(credentials,clientConfig){}
+
+DescribeTableOutcome DynamoDBBackend::DescribeTable(const DescribeTableRequest& request){
+	return dbClient.DescribeTable(request);
+}
+
+CreateTableOutcome DynamoDBBackend::CreateTable(const CreateTableRequest& request){
+	return dbClient.CreateTable(request);
+}
+
+UpdateTableOutcome DynamoDBBackend::UpdateTable(const UpdateTableRequest& request){
+	return dbClient.UpdateTable(request);
+}
+
+DeleteTableOutcome DynamoDBBackend::DeleteTable(const DeleteTableRequest& request){
+	return dbClient.DeleteTable(request);
+}
+
+DescribeTimeToLiveOutcome DynamoDBBackend::DescribeTimeToLive(const DescribeTimeToLiveRequest& request){
+	return dbClient.DescribeTimeToLive(request);
+}
+
+UpdateTimeToLiveOutcome DynamoDBBackend::UpdateTimeToLive(const UpdateTimeToLiveRequest& request){
+	return dbClient.UpdateTimeToLive(request);
+}
+
+GetItemOutcome DynamoDBBackend::GetItem(const GetItemRequest& request){
+	return dbClient.GetItem(request);
+}
+
+PutItemOutcome DynamoDBBackend::PutItem(const PutItemRequest& request){
+	return dbClient.PutItem(request);
+}
+
+UpdateItemOutcome DynamoDBBackend::UpdateItem(const UpdateItemRequest& request){
+	return dbClient.UpdateItem(request);
+}
+
+DeleteItemOutcome DynamoDBBackend::DeleteItem(const DeleteItemRequest& request){
+	return dbClient.DeleteItem(request);
+}
+
+QueryOutcome DynamoDBBackend::Query(const QueryRequest& request){
+	return dbClient.Query(request);
+}
+
+ScanOutcome DynamoDBBackend::Scan(const ScanRequest& request){
+	return dbClient.Scan(request);
+}
+
+WriteTrackingBackend::WriteTrackingBackend(std::unique_ptr<StorageBackend> backend, 
+                                           std::chrono::seconds retention):
+backend(std::move(backend)),retention(retention),tracking(false),nextSerial(0),
+lastSweep(Clock::now()){}
+
+DescribeTableOutcome WriteTrackingBackend::DescribeTable(const DescribeTableRequest& request){
+	return backend->DescribeTable(request);
+}
+
+CreateTableOutcome WriteTrackingBackend::CreateTable(const CreateTableRequest& request){
+	return backend->CreateTable(request);
+}
+
+UpdateTableOutcome WriteTrackingBackend::UpdateTable(const UpdateTableRequest& request){
+	return backend->UpdateTable(request);
+}
+
+DeleteTableOutcome WriteTrackingBackend::DeleteTable(const DeleteTableRequest& request){
+	return backend->DeleteTable(request);
+}
+
+DescribeTimeToLiveOutcome WriteTrackingBackend::DescribeTimeToLive(const DescribeTimeToLiveRequest& request){
+	return backend->DescribeTimeToLive(request);
+}
+
+UpdateTimeToLiveOutcome WriteTrackingBackend::UpdateTimeToLive(const UpdateTimeToLiveRequest& request){
+	return backend->UpdateTimeToLive(request);
+}
+
+GetItemOutcome WriteTrackingBackend::GetItem(const GetItemRequest& request){
+	return backend->GetItem(request);
+}
+
+PutItemOutcome WriteTrackingBackend::PutItem(const PutItemRequest& request){
+	const std::string key=writeKey(request.GetTableName(),request.GetItem());
+	if(key.empty())
+		return backend->PutItem(request);
+	//The write must be noted before it is made, since its stream record may 
+	//be read before the outcome is returned here
+	const std::string image=describeItemImage(request.GetItem());
+	uint64_t serial=noteWrite(key,image);
+	PutItemRequest tracked(request);
+	tracked.SetReturnValues(ReturnValue::ALL_OLD);
+	PutItemOutcome outcome=backend->PutItem(tracked);
+	//a write which left the item as it was produces no stream record
+	if(!outcome.IsSuccess() || describeItemImage(outcome.GetResult().GetAttributes())==image)
+		forgetWrite(key,serial);
+	return outcome;
+}
+
+UpdateItemOutcome WriteTrackingBackend::UpdateItem(const UpdateItemRequest& request){
+	const std::string key=writeKey(request.GetTableName(),request.GetKey());
+	if(key.empty())
+		return backend->UpdateItem(request);
+	//The new image is only known once the update has been applied, so in 
+	//the unlikely event that its stream record is read first, it is treated 
+	//as another replica's change, which only causes extra cache invalidation
+	UpdateItemRequest tracked(request);
+	tracked.SetReturnValues(ReturnValue::ALL_NEW);
+	UpdateItemOutcome outcome=backend->UpdateItem(tracked);
+	if(outcome.IsSuccess())
+		noteWrite(key,describeItemImage(outcome.GetResult().GetAttributes()));
+	return outcome;
+}
+
+DeleteItemOutcome WriteTrackingBackend::DeleteItem(const DeleteItemRequest& request){
+	const std::string key=writeKey(request.GetTableName(),request.GetKey());
+	if(key.empty())
+		return backend->DeleteItem(request);
+	uint64_t serial=noteWrite(key,"");
+	DeleteItemRequest tracked(request);
+	tracked.SetReturnValues(ReturnValue::ALL_OLD);
+	DeleteItemOutcome outcome=backend->DeleteItem(tracked);
+	//deleting an item which did not exist produces no stream record
+	if(!outcome.IsSuccess() || outcome.GetResult().GetAttributes().empty())
+		forgetWrite(key,serial);
+	return outcome;
+}
+
+QueryOutcome WriteTrackingBackend::Query(const QueryRequest& request){
+	return backend->Query(request);
+}
+
+ScanOutcome WriteTrackingBackend::Scan(const ScanRequest& request){
+	return backend->Scan(request);
+}
+
+void WriteTrackingBackend::setTracking(bool enable){
+	tracking=enable;
+	if(!enable){
+		std::lock_guard<std::mutex> lock(mut);
+		writes.clear();
+	}
+}
+
+std::string WriteTrackingBackend::writeKey(const std::string& tableName, const Item& key) const{
+	if(!tracking)
+		return "";
+	auto id=key.find("ID");
+	auto sortKey=key.find("sortKey");
+	if(id==key.end() || sortKey==key.end())
+		return "";
+	return tableName+'\0'+id->second.GetS()+'\0'+sortKey->second.GetS();
+}
+
+uint64_t WriteTrackingBackend::noteWrite(const std::string& key, std::string image){
+	const auto now=Clock::now();
+	std::lock_guard<std::mutex> lock(mut);
+	if(now-lastSweep>retention){
+		for(auto it=writes.begin(); it!=writes.end();){
+			auto& recent=it->second;
+			while(!recent.empty() && now-recent.front().time>retention)
+				recent.pop_front();
+			if(recent.empty())
+				it=writes.erase(it);
+			else
+				++it;
+		}
+		lastSweep=now;
+	}
+	uint64_t serial=nextSerial++;
+	writes[key].push_back(Write{serial,now,std::move(image)});
+	return serial;
+}
+
+void WriteTrackingBackend::forgetWrite(const std::string& key, uint64_t serial){
+	std::lock_guard<std::mutex> lock(mut);
+	auto it=writes.find(key);
+	if(it==writes.end())
+		return;
+	auto& recent=it->second;
+	//the write may already have been matched to its stream record
+	auto write=std::find_if(recent.begin(),recent.end(),
+	                        [=](const Write& w){ return w.serial==serial; });
+	if(write!=recent.end())
+		recent.erase(write);
+	if(recent.empty())
+		writes.erase(it);
+}
+
+bool WriteTrackingBackend::consumeWrite(const std::string& tableName, const std::string& id, 
+                                        const std::string& sortKey, const std::string& newImage){
+	const std::string key=tableName+'\0'+id+'\0'+sortKey;
+	const auto now=Clock::now();
+	std::lock_guard<std::mutex> lock(mut);
+	auto it=writes.find(key);
+	if(it==writes.end())
+		return false;
+	auto& recent=it->second;
+	while(!recent.empty() && now-recent.front().time>retention)
+		recent.pop_front();
+	auto write=std::find_if(recent.begin(),recent.end(),
+	                        [&](const Write& w){ return w.image==newImage; });
+	bool found=(write!=recent.end());
+	if(found)
+		recent.erase(write);
+	if(recent.empty())
+		writes.erase(it);
+	return found;
+}
+
+std::unique_ptr<StorageBackend> makeStorageBackend(const std::string& type,
+                                                   const Aws::Auth::AWSCredentials& credentials,
+                                                   const Aws::Client::ClientConfiguration& clientConfig,
+                                                   const std::string& dataDirectory){
+	if(type=="dynamodb")
+		return std::unique_ptr<StorageBackend>(new DynamoDBBackend(credentials,clientConfig));
+	if(type=="embedded")
+		return std::unique_ptr<StorageBackend>(new EmbeddedBackend(dataDirectory));
+	throw std::runtime_error("Unknown storage backend type: "+type);
+}
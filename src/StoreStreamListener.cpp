@@ -0,0 +1,236 @@
+#include "StoreStreamListener.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <aws/dynamodb/model/DescribeTableRequest.h>
+#include <aws/dynamodb/model/UpdateTableRequest.h>
+#include <aws/dynamodbstreams/model/DescribeStreamRequest.h>
+#include <aws/dynamodbstreams/model/GetRecordsRequest.h>
+#include <aws/dynamodbstreams/model/GetShardIteratorRequest.h>
+
+#include "Logging.h"
+
+namespace{
+	using StreamAttributes=Aws::Map<Aws::String,Aws::DynamoDBStreams::Model::AttributeValue>;
+
+	///Extract the string-valued attributes of an item image
+	std::map<std::string,std::string> stringAttributes(const StreamAttributes& image){
+		std::map<std::string,std::string> result;
+		for(const auto& attribute : image){
+			//other types (e.g. the admin flag) are not used as cache keys
+			if(!attribute.second.GetS().empty())
+				result.emplace(attribute.first,attribute.second.GetS());
+		}
+		return result;
+	}
+
+	ChangeOperation toChangeOperation(Aws::DynamoDBStreams::Model::OperationType type){
+		using Aws::DynamoDBStreams::Model::OperationType;
+		switch(type){
+			case OperationType::INSERT: return ChangeOperation::Add;
+			case OperationType::REMOVE: return ChangeOperation::Remove;
+			default: return ChangeOperation::Update;
+		}
+	}
+}
+
+StoreStreamListener::StoreStreamListener(PersistentStore& store,
+                                         const Aws::Auth::AWSCredentials& credentials,
+                                         const Aws::Client::ClientConfiguration& clientConfig,
+                                         std::chrono::milliseconds pollInterval):
+store(store),
+dbClient(credentials,clientConfig),
+streamsClient(credentials,clientConfig),
+pollInterval(pollInterval),
+applied(0),
+stop(false)
+{
+	for(unsigned int i=0; i<(unsigned int)StoreCollection::Count; i++){
+		TableStream stream;
+		stream.collection=(StoreCollection)i;
+		stream.streamArn=enableStream(store.getTableName(stream.collection));
+		discoverShards(stream,true);
+		streams.push_back(std::move(stream));
+	}
+	store.setLocalWriteTracking(true);
+	poller=std::thread(&StoreStreamListener::run,this);
+	log_info("Following database streams for cache invalidation");
+}
+
+StoreStreamListener::~StoreStreamListener(){
+	stop=true;
+	poller.join();
+	store.setLocalWriteTracking(false);
+}
+
+std::string StoreStreamListener::enableStream(const std::string& tableName){
+	using namespace Aws::DynamoDB::Model;
+	auto describe=[&]{
+		auto outcome=dbClient.DescribeTable(DescribeTableRequest().WithTableName(tableName));
+		if(!outcome.IsSuccess())
+			throw std::runtime_error("Unable to describe table "+tableName+": "+outcome.GetError().GetMessage());
+		return outcome.GetResult().GetTable();
+	};
+	TableDescription table=describe();
+	const StreamSpecification& spec=table.GetStreamSpecification();
+	if(!spec.GetStreamEnabled() || spec.GetStreamViewType()!=StreamViewType::NEW_AND_OLD_IMAGES){
+		if(spec.GetStreamEnabled()){
+			//The view type of an existing stream cannot be changed
+			throw std::runtime_error("Table "+tableName+" has a stream which does not include "
+			                         "old and new item images; it must be disabled before it can be used for cache invalidation");
+		}
+		log_info("Enabling stream for table " << tableName);
+		auto outcome=dbClient.UpdateTable(UpdateTableRequest()
+		                                  .WithTableName(tableName)
+		                                  .WithStreamSpecification(StreamSpecification()
+		                                                           .WithStreamEnabled(true)
+		                                                           .WithStreamViewType(StreamViewType::NEW_AND_OLD_IMAGES)));
+		if(!outcome.IsSuccess())
+			throw std::runtime_error("Failed to enable stream for table "+tableName+": "+outcome.GetError().GetMessage());
+		//Wait for the table to become active again, checking less often as 
+		//time goes on
+		const auto deadline=std::chrono::steady_clock::now()+std::chrono::minutes(5);
+		std::chrono::milliseconds delay(100);
+		while(table.GetTableStatus()!=TableStatus::ACTIVE || table.GetLatestStreamArn().empty()){
+			if(std::chrono::steady_clock::now()+delay>deadline)
+				throw std::runtime_error("Timed out waiting for stream to be enabled for table "+tableName);
+			std::this_thread::sleep_for(delay);
+			delay=std::min(2*delay,std::chrono::milliseconds(5000));
+			table=describe();
+		}
+	}
+	return table.GetLatestStreamArn();
+}
+
+bool StoreStreamListener::discoverShards(TableStream& stream, bool initial){
+	using namespace Aws::DynamoDBStreams::Model;
+	bool complete=true;
+	std::string startShard;
+	do{
+		DescribeStreamRequest request;
+		request.SetStreamArn(stream.streamArn);
+		if(!startShard.empty())
+			request.SetExclusiveStartShardId(startShard);
+		auto outcome=streamsClient.DescribeStream(request);
+		if(!outcome.IsSuccess()){
+			log_error("Failed to describe stream " << stream.streamArn << ": " << outcome.GetError().GetMessage());
+			return false;
+		}
+		const StreamDescription& description=outcome.GetResult().GetStreamDescription();
+		for(const Shard& shard : description.GetShards()){
+			const std::string& shardID=shard.GetShardId();
+			if(stream.iterators.count(shardID) || stream.finished.count(shardID))
+				continue;
+			bool closed=!shard.GetSequenceNumberRange().GetEndingSequenceNumber().empty();
+			//A shard whose parent we were reading contains records we have not
+			//seen and must be read from its beginning. Otherwise, only the open
+			//shards matter, and only from the present, since the caches start
+			//out empty.
+			bool childOfKnown=stream.finished.count(shard.GetParentShardId())
+			                  || stream.iterators.count(shard.GetParentShardId());
+			ShardIteratorType start;
+			if(!initial && childOfKnown)
+				start=ShardIteratorType::TRIM_HORIZON;
+			else if(!closed)
+				start=ShardIteratorType::LATEST;
+			else{
+				stream.finished.insert(shardID);
+				continue;
+			}
+			auto iterOutcome=streamsClient.GetShardIterator(GetShardIteratorRequest()
+			                                                .WithStreamArn(stream.streamArn)
+			                                                .WithShardId(shardID)
+			                                                .WithShardIteratorType(start));
+			if(!iterOutcome.IsSuccess()){
+				log_error("Failed to get iterator for shard " << shardID << ": " << iterOutcome.GetError().GetMessage());
+				complete=false;
+				continue;
+			}
+			stream.iterators[shardID]=iterOutcome.GetResult().GetShardIterator();
+		}
+		startShard=description.GetLastEvaluatedShardId();
+	}while(!startShard.empty());
+	return complete;
+}
+
+bool StoreStreamListener::readShards(TableStream& stream){
+	using namespace Aws::DynamoDBStreams::Model;
+	bool shardClosed=false;
+	for(auto it=stream.iterators.begin(); it!=stream.iterators.end();){
+		auto outcome=streamsClient.GetRecords(GetRecordsRequest().WithShardIterator(it->second));
+		if(!outcome.IsSuccess()){
+			auto errType=outcome.GetError().GetErrorType();
+			if(errType==Aws::DynamoDBStreams::DynamoDBStreamsErrors::EXPIRED_ITERATOR ||
+			   errType==Aws::DynamoDBStreams::DynamoDBStreamsErrors::TRIMMED_DATA_ACCESS){
+				//Changes may have been missed, so nothing cached can be trusted. 
+				//Drop the shard and pick it up again from the present, and 
+				//then discard the caches. 
+				log_warn("Lost position in stream shard " << it->first << "; "
+				         "cached data will be discarded");
+				it=stream.iterators.erase(it);
+				stream.positionLost=true;
+				shardClosed=true;
+			}
+			else{
+				log_error("Failed to read stream shard " << it->first << ": " << outcome.GetError().GetMessage());
+				++it;
+			}
+			continue;
+		}
+		const GetRecordsResult& result=outcome.GetResult();
+		for(const Record& record : result.GetRecords()){
+			const StreamRecord& data=record.GetDynamodb();
+			ExternalChange change;
+			change.collection=stream.collection;
+			change.operation=toChangeOperation(record.GetEventName());
+			const auto& keys=data.GetKeys();
+			auto id=keys.find("ID");
+			auto sortKey=keys.find("sortKey");
+			if(id==keys.end() || sortKey==keys.end())
+				continue;
+			change.id=id->second.GetS();
+			change.sortKey=sortKey->second.GetS();
+			change.oldAttributes=stringAttributes(data.GetOldImage());
+			change.newAttributes=stringAttributes(data.GetNewImage());
+			change.newImage=describeItemImage(data.GetNewImage());
+			store.applyExternalChange(change);
+			applied++;
+		}
+		if(result.GetNextShardIterator().empty()){ //the shard has been closed
+			stream.finished.insert(it->first);
+			it=stream.iterators.erase(it);
+			shardClosed=true;
+		}
+		else{
+			it->second=result.GetNextShardIterator();
+			++it;
+		}
+	}
+	return shardClosed;
+}
+
+void StoreStreamListener::run(){
+	//Shards are split periodically, so new ones must be looked for even if no
+	//shard has closed
+	const auto discoveryInterval=std::chrono::seconds(60);
+	auto nextDiscovery=std::chrono::steady_clock::now()+discoveryInterval;
+	while(!stop){
+		bool rediscover=(std::chrono::steady_clock::now()>nextDiscovery);
+		for(auto& stream : streams){
+			if(readShards(stream) || rediscover || stream.positionLost){
+				bool following=discoverShards(stream,false);
+				//Changes made from now on will be read, so once the caches are 
+				//emptied they can only be refilled with current data. Until 
+				//then, keep trying to resume reading. 
+				if(stream.positionLost && following){
+					store.discardCachedData();
+					stream.positionLost=false;
+				}
+			}
+		}
+		if(rediscover)
+			nextDiscovery=std::chrono::steady_clock::now()+discoveryInterval;
+		std::this_thread::sleep_for(pollInterval);
+	}
+}
@@ -39,44 +39,56 @@ namespace sdktrace = opentelemetry::sdk::trace;
 namespace otlp      = opentelemetry::exporter::otlp;
 namespace resource = opentelemetry::sdk::resource;
 
-// template class from opentel c++ example
-template <typename T>
-class HttpTextMapCarrier : public opentelemetry::context::propagation::TextMapCarrier
+namespace{
+
+///Reads propagated trace context directly from a request's headers, which
+///crow already matches case-insensitively
+class RequestHeaderCarrier : public opentelemetry::context::propagation::TextMapCarrier
 {
 public:
-	HttpTextMapCarrier<T>(T &headers) : headers_(headers) {}
-	HttpTextMapCarrier() = default;
-	virtual opentelemetry::nostd::string_view Get(
+	explicit RequestHeaderCarrier(const crow::ci_map& headers) : headers_(headers) {}
+
+	opentelemetry::nostd::string_view Get(
 			opentelemetry::nostd::string_view key) const noexcept override
 	{
-		std::string key_to_compare = key.data();
-		// Header's first letter seems to be  automatically capitalized by our test http-server, so
-		// compare accordingly.
-		if (key == opentelemetry::trace::propagation::kTraceParent)
-		{
-			key_to_compare = "Traceparent";
-		}
-		else if (key == opentelemetry::trace::propagation::kTraceState)
-		{
-			key_to_compare = "Tracestate";
-		}
-		auto it = headers_.find(key_to_compare);
-		if (it != headers_.end())
-		{
+		auto it = headers_.find(std::string(key.data(), key.size()));
+		if (it != headers_.end()) {
 			return it->second;
 		}
 		return "";
 	}
 
-	virtual void Set(opentelemetry::nostd::string_view key,
-	                 opentelemetry::nostd::string_view value) noexcept override
+	void Set(opentelemetry::nostd::string_view key,
+	         opentelemetry::nostd::string_view value) noexcept override
 	{
-		headers_.insert(std::pair<std::string, std::string>(std::string(key), std::string(value)));
+		//extraction only
 	}
 
-	T headers_;
+private:
+	const crow::ci_map& headers_;
 };
 
+///Set once by initializeTracer, before requests are handled
+bool tracingActive = false;
+nostd::shared_ptr<trace::Tracer> defaultTracer;
+
+const nostd::shared_ptr<trace::Tracer>& getDefaultTracer() {
+	if (!defaultTracer) {
+		//tracing has not been initialized, so this will be a no-op tracer
+		static const nostd::shared_ptr<trace::Tracer> fallback = getTracer();
+		return fallback;
+	}
+	return defaultTracer;
+}
+
+trace::StartSpanOptions getInternalSpanOptions() {
+	trace::StartSpanOptions spanOptions;
+	spanOptions.kind = trace::SpanKind::kServer;
+	return spanOptions;
+}
+
+}
+
 void initializeTracer(const std::string& endpoint, const resource::ResourceAttributes& resources, bool disableTracing, bool disableSampling) {
 
 	// Configure opentelemetry otlpExporter
@@ -117,6 +129,8 @@ void initializeTracer(const std::string& endpoint, const resource::ResourceAttri
 
 	// Set the global trace provider
 	trace::Provider::SetTracerProvider(provider);
+	tracingActive = !disableTracing;
+	defaultTracer = getTracer();
 
 
 }
@@ -127,56 +141,57 @@ nostd::shared_ptr<trace::Tracer> getTracer(const std::string& tracerName)
 	return provider->GetTracer(tracerName);
 }
 
-void setWebSpanAttributes(std::map<std::string, std::string>& spanAttributes, const crow::request& req) {
-	spanAttributes = {
-			{trace::SemanticConventions::HTTP_METHOD,    crow::method_name(req.method)},
-			{trace::SemanticConventions::HTTP_SCHEME,    "http"},
-			{trace::SemanticConventions::HTTP_CLIENT_IP, req.remote_endpoint}};
-	auto val = req.headers.find("Host");
-	if (val != req.headers.end()) {
-		std::string host = val->second;
-		auto commaPos = host.find(':');
-		if (commaPos != std::string::npos) {
-			spanAttributes[trace::SemanticConventions::NET_HOST_NAME] = host.substr(0, commaPos);
-			spanAttributes[trace::SemanticConventions::NET_HOST_PORT] = host.substr(commaPos);
-		} else {
-			spanAttributes[trace::SemanticConventions::NET_HOST_NAME] = host;
-		}
-	}
-	val = req.headers.find("Content-Length");
-	if (val != req.headers.end()) {
-		spanAttributes[trace::SemanticConventions::HTTP_REQUEST_CONTENT_LENGTH] = val->second;
-	}
-}
-
-trace::StartSpanOptions getWebSpanOptions(const crow::request& req) {
+SpanGuard::SpanGuard(const crow::request& req) {
 	trace::StartSpanOptions spanOptions;
 	spanOptions.kind = trace::SpanKind::kServer;
-	auto propagator = opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
-	auto current_ctx = opentelemetry::context::RuntimeContext::GetCurrent();
-	std::map<std::string, std::string> headers;
-	for (auto it=req.headers.begin(), end = req.headers.end(); it != end; ++it) {
-		headers[it->first] = it->second;
+	//only pay for extraction when the client actually propagated a trace
+	bool propagated = tracingActive && req.headers.count("traceparent");
+	if (propagated) {
+		auto propagator = opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
+		auto current_ctx = opentelemetry::context::RuntimeContext::GetCurrent();
+		const RequestHeaderCarrier carrier(req.headers);
+		auto new_context = propagator->Extract(carrier, current_ctx);
+		spanOptions.parent = trace::GetSpan(new_context)->GetContext();
 	}
-	const HttpTextMapCarrier <std::map<std::string, std::string>> carrier = headers;
-	auto new_context = propagator->Extract(carrier, current_ctx);
-	spanOptions.parent = opentelemetry::trace::GetSpan(new_context)->GetContext();
-	return spanOptions;
+	span = getDefaultTracer()->StartSpan(req.url, spanOptions);
+	populateSpan(*this, req);
+	activate(!propagated);
 }
 
-void setInternalSpanAttributes(std::map<std::string, std::string>& spanAttributes) {
-	// No-op for now
-	static_assert(true, "NO OP");
+SpanGuard::SpanGuard(nostd::string_view name) : 
+SpanGuard(getDefaultTracer(), name) {}
+
+SpanGuard::SpanGuard(const nostd::shared_ptr<trace::Tracer>& tracer, nostd::string_view name) {
+	span = tracer->StartSpan(name, getInternalSpanOptions());
+	activate(true);
 }
 
-trace::StartSpanOptions getInternalSpanOptions() {
-	trace::StartSpanOptions spanOptions;
-	spanOptions.kind = trace::SpanKind::kServer;
-	return spanOptions;
+SpanGuard::~SpanGuard() {
+	span->End();
 }
 
+bool SpanGuard::recording() const {
+	return tracingActive && span->IsRecording();
+}
 
-void populateSpan(nostd::shared_ptr<trace::Span>& span, const crow::request& req) {
+void SpanGuard::activate(bool childOfCurrent) {
+	if (!tracingActive) {
+		return;
+	}
+	//An unsampled span only needs to be active so that its children inherit
+	//the decision not to sample; if its parent is the active span, they will
+	//inherit the same decision from that
+	if (childOfCurrent && !span->IsRecording() &&
+	    trace::Tracer::GetCurrentSpan()->GetContext().IsValid()) {
+		return;
+	}
+	scope.reset(new trace::Scope(span));
+}
+
+void populateSpan(SpanGuard& span, const crow::request& req) {
+	if (!span.recording()) {
+		return;
+	}
 	span->SetAttribute("http.method", crow::method_name(req.method));
 	span->SetAttribute("http.route", req.url);
 	span->SetAttribute("http.flavor", "1.1");
@@ -206,13 +221,29 @@ void populateSpan(nostd::shared_ptr<trace::Span>& span, const crow::request& req
 	}
 }
 
-void setWebSpanError(nostd::shared_ptr<trace::Span>& span, const std::string& mesg, int errorCode) {
+void setWebSpanError(SpanGuard& span, const std::string& mesg, int errorCode) {
+	if (!span.recording()) {
+		return;
+	}
 	span->SetStatus(trace::StatusCode::kError);
 	span->SetAttribute("http.status_code", errorCode);
 	span->SetAttribute("log.message", mesg);
 }
 
-void setSpanError(nostd::shared_ptr<trace::Span>& span, const std::string& mesg) {
+void setSpanError(SpanGuard& span, const std::string& mesg) {
+	if (!span.recording()) {
+		return;
+	}
 	span->SetStatus(trace::StatusCode::kError);
 	span->SetAttribute("log.message", mesg);
 }
+
+std::string currentTraceID() {
+	auto context = trace::Tracer::GetCurrentSpan()->GetContext();
+	if (!context.IsValid()) {
+		return "";
+	}
+	char traceID[2 * trace::TraceId::kSize];
+	context.trace_id().ToLowerBase16(traceID);
+	return std::string(traceID, sizeof(traceID));
+}
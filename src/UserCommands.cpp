@@ -5,13 +5,7 @@
 #include "Telemetry.h"
 
 crow::response listUsers(PersistentStore& store, const crow::request& req) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -19,7 +13,6 @@ crow::response listUsers(PersistentStore& store, const crow::request& req) {
 	if (!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -54,18 +47,11 @@ crow::response listUsers(PersistentStore& store, const crow::request& req) {
 		resultItems.PushBack(userResult, alloc);
 	}
 	result.AddMember("items", resultItems, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response createUser(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -74,14 +60,12 @@ crow::response createUser(PersistentStore& store, const crow::request& req){
 	if(!user){
 		log_warn(user << " is not authorized to create users");
 		setWebSpanError(span, "Not authorized to create users", 403);
-		span->End();
 		return crow::response(403,generateError("Not authorized"));
 	}
 	
 	if(!user.admin){ //only administrators can create new users
 		log_warn(user << " is not an admin and so is not allowed to create users");
 		setWebSpanError(span, "Not an admin", 403);
-		span->End();
 		return crow::response(403,generateError("Not authorized"));
 	}
 	
@@ -92,99 +76,83 @@ crow::response createUser(PersistentStore& store, const crow::request& req){
 	}catch(std::runtime_error& err){
 		log_warn("User creation request body was not valid JSON");
 		setWebSpanError(span, "Invalid JSON in request body", 400);
-		span->End();
 		return crow::response(400,generateError("Invalid JSON in request body"));
 	}
 	
 	if(body.IsNull()){
 		log_warn("User creation request body was null");
 		setWebSpanError(span, "User creation request body was null", 400);
-		span->End();
 		return crow::response(400,generateError("Invalid JSON in request body"));
 	}
 	if(!body.HasMember("metadata")){
 		log_warn("User creation request body was missing metadata field");
 		setWebSpanError(span, "User creation request body was missing metadata field", 400);
-		span->End();
 		return crow::response(400,generateError("Missing user metadata in request"));
 	}
 	if(!body["metadata"].IsObject()){
 		log_warn("User creation in request body, metadata field was not an object");
 		setWebSpanError(span, "User creation in request body, metadata field was not an object", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for configuration"));
 	}
 	
 	if(!body["metadata"].HasMember("globusID")){
 		log_warn("User creation request was missing globus ID");
 		setWebSpanError(span, "User creation request was missing globus ID", 400);
-		span->End();
 		return crow::response(400,generateError("Missing user globus ID in request"));
 	}
 	if(!body["metadata"]["globusID"].IsString()){
 		log_warn("Globus ID in user creation request was not a string");
 		setWebSpanError(span, "Globus ID in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for user globus ID"));
 	}
 	if(!body["metadata"].HasMember("name")){
 		log_warn("User creation request was missing user name");
 		setWebSpanError(span, "Globus ID in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Missing user name in request"));
 	}
 	if(!body["metadata"]["name"].IsString()){
 		log_warn("User name in user creation request was not a string");
 		setWebSpanError(span, "User name in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for user name"));
 	}
 	if(!body["metadata"].HasMember("email")){
 		log_warn("User creation request was missing user email address");
 		setWebSpanError(span, "User creation request was missing user email address", 400);
-		span->End();
 		return crow::response(400,generateError("Missing user email in request"));
 	}
 	if(!body["metadata"]["email"].IsString()){
 		log_warn("User email address in user creation request was not a string");
 		setWebSpanError(span, "User email address in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for user email"));
 	}
 	if(!body["metadata"].HasMember("phone")){
 		log_warn("User creation request was missing user phone number");
 		setWebSpanError(span, "User creation request was missing user phone number", 400);
-		span->End();
 		return crow::response(400,generateError("Missing user phone in request"));
 	}
 	if(!body["metadata"]["phone"].IsString()){
 		log_warn("User phone number in user creation request was not a string");
 		setWebSpanError(span, "User phone number in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for user phone"));
 	}
 	if(!body["metadata"].HasMember("institution")){
 		log_warn("User creation request was missing user institution");
 		setWebSpanError(span, "User creation request was missing user institution", 400);
-		span->End();
 		return crow::response(400,generateError("Missing user institution in request"));
 	}
 	if(!body["metadata"]["institution"].IsString()){
 		log_warn("User institution in user creation request was not a string");
 		setWebSpanError(span, "User institution in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for user institution"));
 	}
 	if(!body["metadata"].HasMember("admin")){
 		log_warn("User creation request was missing admin flag");
 		setWebSpanError(span, "User creation request was missing admin flag", 400);
-		span->End();
 		return crow::response(400,generateError("Missing admin flag in request"));
 	}
 	if(!body["metadata"]["admin"].IsBool()){
 		log_warn("Admin flag in user creation request was not a string");
 		setWebSpanError(span, "Admin flag in user creation request was not a string", 400);
-		span->End();
 		return crow::response(400,generateError("Incorrect type for user admin flag"));
 	}
 	
@@ -202,7 +170,6 @@ crow::response createUser(PersistentStore& store, const crow::request& req){
 	if(store.findUserByGlobusID(targetUser.globusID)){
 		log_warn("User Globus ID is already registered");
 		setWebSpanError(span, "User Globus ID is already registered", 400);
-		span->End();
 		return crow::response(400,generateError("Globus ID is already registered"));
 	}
 	log_info("Creating " << targetUser);
@@ -213,7 +180,6 @@ crow::response createUser(PersistentStore& store, const crow::request& req){
 	if(!created){
 		log_error("Failed to create user account");
 		setWebSpanError(span, "Failed to create user account", 500);
-		span->End();
 		return crow::response(500,generateError("User account creation failed"));
 	}
 
@@ -233,18 +199,11 @@ crow::response createUser(PersistentStore& store, const crow::request& req){
 	metadata.AddMember("groups", vos, alloc);
 	result.AddMember("metadata", metadata, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response getUserInfo(PersistentStore& store, const crow::request& req, const std::string uID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -254,7 +213,6 @@ crow::response getUserInfo(PersistentStore& store, const crow::request& req, con
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -262,7 +220,6 @@ crow::response getUserInfo(PersistentStore& store, const crow::request& req, con
 	if(!user.admin && user.id!=uID) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -271,7 +228,6 @@ crow::response getUserInfo(PersistentStore& store, const crow::request& req, con
 
 	if(!targetUser) {
 		setWebSpanError(span, "User not found", 404);
-		span->End();
 		return crow::response(404, generateError("Not found"));
 	}
 	rapidjson::Document result(rapidjson::kObjectType);
@@ -296,18 +252,11 @@ crow::response getUserInfo(PersistentStore& store, const crow::request& req, con
 	}
 	metadata.AddMember("groups", groupMemberships, alloc);
 	result.AddMember("metadata", metadata, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response whoAreThey(PersistentStore& store, const crow::request& req) {
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -317,7 +266,6 @@ crow::response whoAreThey(PersistentStore& store, const crow::request& req) {
 	if(!user) {
 		const std::string& errMsg = "User not found";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -345,18 +293,11 @@ crow::response whoAreThey(PersistentStore& store, const crow::request& req) {
 	metadata.AddMember("groups", groupMemberships, alloc);
 	result.AddMember("metadata", metadata, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response updateUser(PersistentStore& store, const crow::request& req, const std::string uID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -366,7 +307,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 
@@ -375,7 +315,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 	if(!user.admin && user.id!=uID) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -383,7 +322,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 	
 	if(!targetUser) {
 		setWebSpanError(span, "User not found", 404);
-		span->End();
 		return crow::response(404, generateError("User not found"));
 	}
 	
@@ -394,25 +332,21 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400,generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string &errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body.HasMember("metadata")) {
 		const std::string &errMsg = "Missing user metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string &errMsg = "Incorrect type for user metadata";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	
@@ -422,7 +356,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 		if(!body["metadata"]["name"].IsString()) {
 			const std::string &errMsg = "Incorrect type for user name";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		updatedUser.name=body["metadata"]["name"].GetString();
@@ -431,7 +364,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 		if(!body["metadata"]["email"].IsString()) {
 			const std::string &errMsg = "Incorrect type for user email";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		updatedUser.email=body["metadata"]["email"].GetString();
@@ -440,7 +372,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 		if(!body["metadata"]["phone"].IsString()) {
 			const std::string &errMsg = "Incorrect type for user phone";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		updatedUser.phone=body["metadata"]["phone"].GetString();
@@ -449,7 +380,6 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 		if(!body["metadata"]["institution"].IsString()) {
 			const std::string &errMsg = "Incorrect type for user institution";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		updatedUser.institution=body["metadata"]["institution"].GetString();
@@ -458,13 +388,11 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 		if(!body["metadata"]["admin"].IsBool()) {
 			const std::string &errMsg = "Incorrect type for user admin flag";
 			setWebSpanError(span, errMsg, 400);
-			span->End();
 			return crow::response(400, generateError(errMsg));
 		}
 		if(!user.admin) { //only admins can alter admin rights
 			const std::string& errMsg = "User not authorized";
 			setWebSpanError(span, errMsg, 403);
-			span->End();
 			log_error(errMsg);
 			return crow::response(403, generateError(errMsg));
 		}
@@ -476,21 +404,13 @@ crow::response updateUser(PersistentStore& store, const crow::request& req, cons
 	
 	if(!updated) {
 		setWebSpanError(span, "User account update failed", 500);
-		span->End();
 		return crow::response(500, generateError("User account update failed"));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response deleteUser(PersistentStore& store, const crow::request& req, const std::string uID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -500,14 +420,12 @@ crow::response deleteUser(PersistentStore& store, const crow::request& req, cons
 	if(!user) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	//users can only be deleted by admins or themselves
 	if(!user.admin && user.id!=uID) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	
@@ -519,7 +437,6 @@ crow::response deleteUser(PersistentStore& store, const crow::request& req, cons
 		if (!targetUser) {
 			const std::string &errMsg = "User not found";
 			setWebSpanError(span, errMsg, 404);
-			span->End();
 			return crow::response(404, generateError(errMsg));
 		}
 	}
@@ -535,7 +452,6 @@ crow::response deleteUser(PersistentStore& store, const crow::request& req, cons
 	if(!deleted) {
 		const std::string &errMsg = "User account deletion failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500, generateError(errMsg));
 	}
 	
@@ -546,19 +462,12 @@ crow::response deleteUser(PersistentStore& store, const crow::request& req, cons
 	message.subject="SLATE account deleted";
 	message.body="This is an automatic notification that your SLATE user "
 	"account ("+targetUser.name+", "+targetUser.id+") has been deleted.";
-	store.getEmailClient().sendEmail(message);
-	span->End();
+	store.queueEmail(message);
 	return(crow::response(200));
 }
 
 crow::response listUsergroups(PersistentStore& store, const crow::request& req, const std::string uID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -568,7 +477,6 @@ crow::response listUsergroups(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 
@@ -581,7 +489,6 @@ crow::response listUsergroups(PersistentStore& store, const crow::request& req,
 		if (!targetUser) {
 			const std::string &errMsg = "User not found";
 			setWebSpanError(span, errMsg, 404);
-			span->End();
 			return crow::response(404, generateError(errMsg));
 		}
 	}
@@ -604,19 +511,12 @@ crow::response listUsergroups(PersistentStore& store, const crow::request& req,
 		groupMemberships.PushBack(entry, alloc);
 	}
 	result.AddMember("items", groupMemberships, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response addUserToGroup(PersistentStore& store, const crow::request& req, 
 						   const std::string uID, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -626,7 +526,6 @@ crow::response addUserToGroup(PersistentStore& store, const crow::request& req,
 	if(!user) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	
@@ -634,7 +533,6 @@ crow::response addUserToGroup(PersistentStore& store, const crow::request& req,
 	if(!targetUser) {
 		const std::string &errMsg = "User not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 	
@@ -642,7 +540,6 @@ crow::response addUserToGroup(PersistentStore& store, const crow::request& req,
 	if(!group) {
 		const std::string &errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 	
@@ -650,7 +547,6 @@ crow::response addUserToGroup(PersistentStore& store, const crow::request& req,
 	if(!user.admin && !store.userInGroup(user.id,groupID)) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	
@@ -660,22 +556,14 @@ crow::response addUserToGroup(PersistentStore& store, const crow::request& req,
 	if(!success) {
 		const std::string &errMsg = "User addition to Group failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response removeUserFromGroup(PersistentStore& store, const crow::request& req, 
 								const std::string uID, const std::string& groupID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -685,7 +573,6 @@ crow::response removeUserFromGroup(PersistentStore& store, const crow::request&
 	if(!user) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	
@@ -693,7 +580,6 @@ crow::response removeUserFromGroup(PersistentStore& store, const crow::request&
 	if(!targetUser) {
 		const std::string &errMsg = "User not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 
@@ -701,7 +587,6 @@ crow::response removeUserFromGroup(PersistentStore& store, const crow::request&
 	if(!user.admin && !store.userInGroup(user.id,groupID)) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 
 	}
@@ -712,21 +597,13 @@ crow::response removeUserFromGroup(PersistentStore& store, const crow::request&
 	if(!success) {
 		const std::string &errMsg = "User removal from Group failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500, generateError(errMsg));
 	}
-	span->End();
 	return(crow::response(200));
 }
 
 crow::response findUser(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//this is the requesting user, not the requested user
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -736,14 +613,12 @@ crow::response findUser(PersistentStore& store, const crow::request& req){
 	if(!user || !user.admin) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	
 	if(!req.url_params.get("globus_id")) {
 		const std::string &errMsg = "Missing globus ID in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		return crow::response(400, generateError(errMsg));
 	}
 	std::string globusID=req.url_params.get("globus_id");
@@ -753,7 +628,6 @@ crow::response findUser(PersistentStore& store, const crow::request& req){
 	if(!targetUser) {
 		const std::string &errMsg = "User not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 
@@ -767,18 +641,11 @@ crow::response findUser(PersistentStore& store, const crow::request& req){
 	metadata.AddMember("access_token", rapidjson::StringRef(targetUser.token.c_str()), alloc);
 	result.AddMember("metadata", metadata, alloc);
 
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response replaceUserToken(PersistentStore& store, const crow::request& req, const std::string uID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	span->AddEvent("Authenticating user");
 	//important: user is the user issuing the command, not the user being modified
 	const User user = authenticateUser(store, req.url_params.get("token"));
@@ -788,14 +655,12 @@ crow::response replaceUserToken(PersistentStore& store, const crow::request& req
 	if(!user) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	//users can only be altered by admins and themselves
 	if(!user.admin && user.id!=uID) {
 		const std::string &errMsg = "Not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		return crow::response(403, generateError(errMsg));
 	}
 	
@@ -804,7 +669,6 @@ crow::response replaceUserToken(PersistentStore& store, const crow::request& req
 	if(!targetUser) {
 		const std::string &errMsg = "User not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		return crow::response(404, generateError(errMsg));
 	}
 	
@@ -816,7 +680,6 @@ crow::response replaceUserToken(PersistentStore& store, const crow::request& req
 	if(!updated) {
 		const std::string &errMsg = "User account update failed";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		return crow::response(500, generateError(errMsg));
 	}
 	
@@ -840,7 +703,6 @@ crow::response replaceUserToken(PersistentStore& store, const crow::request& req
 	"replaced. This should not affect how you log into the SLATE web portal, "
 	"but if you use the slate CLI tool you will need to download your updated "
 	"token from https://portal.slateci.io/cli";
-	store.getEmailClient().sendEmail(message);
-	span->End();
+	store.queueEmail(message);
 	return crow::response(to_string(result));
 }
@@ -8,12 +8,7 @@
 
 
 crow::response serverVersionInfo(){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setInternalSpanAttributes(attributes);
-	auto options = getInternalSpanOptions();
-	auto span = tracer->StartSpan("/version", attributes, options);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span("/version");
 	rapidjson::Document result(rapidjson::kObjectType);
 	rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
 	result.AddMember("serverVersion", serverVersionString, alloc);
@@ -22,6 +17,5 @@ crow::response serverVersionInfo(){
 	currentAPI.SetString("v1alpha3");
 	apiVersions.PushBack(currentAPI,alloc);
 	result.AddMember("supportedAPIVersions", apiVersions, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }
@@ -10,6 +10,7 @@
 #include "Telemetry.h"
 #include "ServerUtilities.h"
 #include "KubeInterface.h"
+#include "JSONExtractor.h"
 #include "Archive.h"
 
 
@@ -17,13 +18,7 @@ crow::response listVolumeClaims(PersistentStore& store, const crow::request& req
 	using namespace std::chrono;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	// Take the user token presented in the request and authenticate the user against the PersistentStore
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -32,7 +27,6 @@ crow::response listVolumeClaims(PersistentStore& store, const crow::request& req
 	if (!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -93,7 +87,6 @@ crow::response listVolumeClaims(PersistentStore& store, const crow::request& req
 			errMsg << "kubectl get PVC " << volume.name << " --namespace "
 			       << nspace << "failed :" << volumeGetResult.error;
 			setWebSpanError(span, errMsg.str(), 500);
-			span->End();
 			log_error(errMsg.str());
 		}
 
@@ -105,7 +98,6 @@ crow::response listVolumeClaims(PersistentStore& store, const crow::request& req
 			std::ostringstream errMsg;
 			errMsg << "Unable to parse kubectl get PVC JSON output for " << volume.name << ": " << err.what();
 			setWebSpanError(span, errMsg.str(), 500);
-			span->End();
 			log_error(errMsg.str());
 		}
 
@@ -124,18 +116,11 @@ crow::response listVolumeClaims(PersistentStore& store, const crow::request& req
 
 	high_resolution_clock::time_point t2 = high_resolution_clock::now();
 	log_info("volume listing completed in " << duration_cast<duration<double>>(t2-t1).count() << " seconds");
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request& req, const std::string& claimID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -143,7 +128,6 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -152,7 +136,6 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 	if(!volume) {
 		const std::string& errMsg = "Volume not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -161,7 +144,6 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 	if(!user.admin && !store.userInGroup(user.id,volume.group)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -171,7 +153,6 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 	if(!cluster) {
 		const std::string& errMsg = "Invalid Cluster";
 		setWebSpanError(span, errMsg, 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -223,7 +204,6 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 		std::ostringstream errMsg;
 		errMsg << std::string("Failed to get PVC information for ") << volume;
 		setWebSpanError(span, errMsg.str(), 400);
-		span->End();
 		log_error(errMsg.str());
 		rapidjson::Value claimInfo(rapidjson::kObjectType);
 		claimInfo.AddMember("kind", "Error", alloc);
@@ -240,7 +220,6 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 		std::ostringstream errMsg;
 		errMsg << "Unable to parse kubectl get pvc JSON output for " << volume << ": " << err.what();
 		setWebSpanError(span, errMsg.str(), 400);
-		span->End();
 		log_error(errMsg.str());
 		return crow::response(to_string(result));
 	}
@@ -249,18 +228,11 @@ crow::response fetchVolumeClaimInfo(PersistentStore& store, const crow::request&
 		claimInfo.AddMember("status", claimDetails["status"]["phase"], alloc);
 		result.AddMember("details", claimInfo, alloc); //claimInfo, alloc);
 	}
-	span->End();
 	return crow::response(to_string(result));
 }
 
 crow::response createVolumeClaim(PersistentStore& store, const crow::request& req){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -268,7 +240,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -279,14 +250,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg + " exception: " + err.what(), 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(body.IsNull()) {
 		const std::string& errMsg = "Invalid JSON in request body";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -294,14 +263,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body.HasMember("metadata")) {
 		const std::string& errMsg = "Missing user metadata in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"].IsObject()) {
 		const std::string& errMsg = "Incorrect type for metadata";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -309,14 +276,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("group")) {
 		const std::string& errMsg = "Missing Group";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["group"].IsString()) {
 		const std::string& errMsg = "Incorrect type for Group";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -325,14 +290,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("cluster")) {
 		const std::string& errMsg = "Missing cluster";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["cluster"].IsString()) {
 		const std::string& errMsg = "Incorrect type for cluster";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -341,14 +304,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("name")) {
 		const std::string& errMsg = "Missing volume name in request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["name"].IsString()) {
 		const std::string& errMsg = "Incorrect type for volume name";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -356,14 +317,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("storageRequest")) {
 		const std::string& errMsg = "Missing storage request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if (!body["metadata"]["storageRequest"].IsString()) {
 		const std::string& errMsg = "Incorrect type for storage request";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -371,14 +330,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("accessMode")) {
 		const std::string& errMsg = "Missing access mode";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["accessMode"].IsString()) {
 		const std::string& errMsg = "Incorrect type for access mode";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -386,14 +343,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("volumeMode")) {
 		const std::string& errMsg = "Missing volume mode";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["volumeMode"].IsString()) {
 		const std::string& errMsg = "Incorrect type for volume mode";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -401,14 +356,12 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!body["metadata"].HasMember("storageClass")) {
 		const std::string& errMsg = "Missing StorageClass";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
 	if(!body["metadata"]["storageClass"].IsString()) {
 		const std::string& errMsg = "Incorrect type for StorageClass";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -441,7 +394,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = std::string("Invalid value for access mode: ") + err.what();
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -450,7 +402,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = std::string("Invalid value for volume mode: ") + err.what();
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -465,7 +416,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(volume.name.size()>253) {
 		const std::string& errMsg = "Volume name too long";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -473,7 +423,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(volume.name.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789-.")!=std::string::npos) {
 		const std::string& errMsg = "Volume name contains an invalid character";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -482,7 +431,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!group) {
 		const std::string& errMsg = "Group not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -495,7 +443,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!store.userInGroup(user.id,group.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -504,7 +451,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!cluster) {
 		const std::string& errMsg = "Cluster not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -518,7 +464,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(group.id!=cluster.owningGroup && !store.groupAllowedOnCluster(group.id,cluster.id)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -528,7 +473,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	if(existing) {
 		const std::string& errMsg = "A volume with the same name already exists";
 		setWebSpanError(span, errMsg, 400);
-		span->End();
 		log_error(errMsg);
 		return crow::response(400, generateError(errMsg));
 	}
@@ -546,7 +490,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	}catch(std::runtime_error& err){
 		const std::string& errMsg = "Failed to store volume to the persistent store";
 		setWebSpanError(span, errMsg + ": " + err.what(), 500);
-		span->End();
 		log_error(errMsg);
 		return crow::response(500, generateError(errMsg));
 	}
@@ -564,7 +507,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 			store.removePersistentVolumeClaim(volume.id);
 			const std::string& errMsg = std::string("Failed to create namespace: ") + err.what();
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			log_error(errMsg);
 			return crow::response(500, generateError(errMsg));
 		}
@@ -580,7 +522,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 		//std::vector<std::string> selectorLabelExpressions = volume.getSelectorLabelExpressions();
 		// new section for json
 		//Create PVC from JSON file with Kubectl
-		FileHandle pvcFile=makeTemporaryFile(".pvc.json");
 
 		rapidjson::Document doc(rapidjson::kObjectType);
 		rapidjson::Document::AllocatorType& alloc = doc.GetAllocator();
@@ -653,10 +594,7 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 		rapidjson::StringBuffer buffer;
 		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
 		doc.Accept(writer);
-		std::ofstream pvcJson(pvcFile);
-		pvcJson << buffer.GetString();
-
-		pvcJson.close();
+		FileHandle pvcFile=makeMemoryFile(".pvc.json",buffer.GetString());
 
 		std::vector<std::string> arguments={"create", "-f", pvcFile};
 
@@ -668,7 +606,6 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 			//if installation fails, remove from the database again
 			store.removePersistentVolumeClaim(volume.id);
 			setWebSpanError(span, errMsg, 500);
-			span->End();
 			log_error(errMsg);
 			return crow::response(500, generateError(errMsg));
 		}
@@ -702,18 +639,11 @@ crow::response createVolumeClaim(PersistentStore& store, const crow::request& re
 	metadata.AddMember("selectorLabelExpressions", selectorLabelExpressions, alloc);
 	*/
 	result.AddMember("metadata", metadata, alloc);
-	span->End();
 	return crow::response(to_string(result));
 }	
 
 crow::response deleteVolumeClaim(PersistentStore& store, const crow::request& req, const std::string& claimID){
-	auto tracer = getTracer();
-	std::map<std::string, std::string> attributes;
-	setWebSpanAttributes(attributes, req);
-	auto options = getWebSpanOptions(req);
-	auto span = tracer->StartSpan(req.url, attributes, options);
-	populateSpan(span, req);
-	auto scope = tracer->WithActiveSpan(span);
+	SpanGuard span(req);
 	//authenticate
 	const User user = authenticateUser(store, req.url_params.get("token"));
 	span->SetAttribute("user", user.name);
@@ -721,7 +651,6 @@ crow::response deleteVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!user) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -730,7 +659,6 @@ crow::response deleteVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!volume) {
 		const std::string& errMsg = "Volume not found";
 		setWebSpanError(span, errMsg, 404);
-		span->End();
 		log_error(errMsg);
 		return crow::response(404, generateError(errMsg));
 	}
@@ -738,7 +666,6 @@ crow::response deleteVolumeClaim(PersistentStore& store, const crow::request& re
 	if(!user.admin && !store.userInGroup(user.id,volume.group)) {
 		const std::string& errMsg = "User not authorized";
 		setWebSpanError(span, errMsg, 403);
-		span->End();
 		log_error(errMsg);
 		return crow::response(403, generateError(errMsg));
 	}
@@ -747,11 +674,9 @@ crow::response deleteVolumeClaim(PersistentStore& store, const crow::request& re
 	auto err=internal::deleteVolumeClaim(store,volume,force);
 	if(!err.empty()) {
 		setWebSpanError(span, err, 500);
-		span->End();
 		log_error(err);
 		return crow::response(500, generateError(err));
 	}
-	span->End();
 	return crow::response(200);
 }
 
@@ -776,10 +701,15 @@ namespace internal{
 					log_error("kubectl get pods failed: " << podResult.error);
 				}
 
+				static const JSONExtractor podFields({
+					"/items/*/metadata/generateName",
+					"/items/*/metadata/labels/instanceID",
+					"/items/*/spec/volumes/*/persistentVolumeClaim/claimName",
+				});
 				rapidjson::Document podData;
 
 				// For each pod in the namespace loop through each of the pod's volumes (pod.Spec.Volumes)
-				podData.Parse(podResult.output.c_str());
+				podFields.parseInsitu(podResult.output,podData);
 
 				for(const auto& pod : podData["items"].GetArray()){
 
@@ -794,6 +724,7 @@ namespace internal{
 					    !pod["spec"].HasMember("volumes") || !pod["spec"]["volumes"].IsArray()) {
 						log_warn("Pod result does not have expected structure or "
 							 "does not contain any volumes. Skipping");
+						continue;
 					}
 
 					// For volumes of "type" PersistentVolumeClaims check PersistentVolumeClaim.ClaimName
@@ -0,0 +1,224 @@
+#include "client/BatchCommands.h"
+
+#include <map>
+#include <stdexcept>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+std::vector<std::string> splitCommandLine(const std::string& line){
+	std::vector<std::string> words;
+	std::string word;
+	bool inWord=false;
+	char quote=0;
+	for(std::size_t i=0; i<line.size(); i++){
+		char c=line[i];
+		if(quote){
+			if(c==quote)
+				quote=0;
+			else if(c=='\\' && quote=='"' && i+1<line.size())
+				word+=line[++i];
+			else
+				word+=c;
+		}
+		else if(c=='\'' || c=='"'){
+			quote=c;
+			inWord=true;
+		}
+		else if(c=='\\' && i+1<line.size()){
+			word+=line[++i];
+			inWord=true;
+		}
+		else if(std::isspace((unsigned char)c)){
+			if(inWord)
+				words.push_back(word);
+			word.clear();
+			inWord=false;
+		}
+		else{
+			word+=c;
+			inWord=true;
+		}
+	}
+	if(quote)
+		throw std::runtime_error("Unterminated quotation");
+	if(inWord)
+		words.push_back(word);
+	return words;
+}
+
+BatchRequest parseBatchCommand(const std::vector<std::string>& words, 
+                               const std::function<std::string(const std::string&)>& resolveInstance){
+	std::vector<std::string> args;
+	std::map<std::string,std::string> options;
+	bool force=false;
+	for(std::size_t i=0; i<words.size(); i++){
+		const std::string& word=words[i];
+		if(word=="-f" || word=="--force")
+			force=true;
+		else if(word=="-y" || word=="--assume-yes" || word=="--assumeyes")
+			continue; //batches never ask for confirmation anyway
+		else if(word=="--group" || word=="--cluster"){
+			if(i+1==words.size())
+				throw std::runtime_error("Option "+word+" requires a value");
+			options[word.substr(2)]=words[++i];
+		}
+		else if(word.size()>1 && word[0]=='-')
+			throw std::runtime_error("Unsupported option: "+word);
+		else
+			args.push_back(word);
+	}
+	if(args.size()<2)
+		throw std::runtime_error("Expected a command and a subcommand");
+	const std::string command=args[0]+" "+args[1];
+	auto expect=[&](std::size_t count, const std::string& usage){
+		if(args.size()!=count)
+			throw std::runtime_error("Usage: "+command+" "+usage);
+	};
+	
+	BatchRequest request;
+	bool modifies=true;
+	bool allowForce=false, allowOptions=false;
+	if(command=="group info"){
+		expect(3,"group-name");
+		request.method="GET";
+		request.path="groups/"+args[2];
+		modifies=false;
+	}
+	else if(command=="group delete"){
+		expect(3,"group-name");
+		request.method="DELETE";
+		request.path="groups/"+args[2];
+		//deleting a group also deletes its instances, secrets, and volumes, 
+		//which other requests may name in ways which cannot be matched up
+		request.exclusive=true;
+	}
+	else if(command=="cluster info"){
+		expect(3,"cluster-name");
+		request.method="GET";
+		request.path="clusters/"+args[2];
+		modifies=false;
+	}
+	else if(command=="cluster allow-group" || command=="cluster deny-group"){
+		expect(4,"cluster-name group-name");
+		request.method=(args[1]=="allow-group" ? "PUT" : "DELETE");
+		request.path="clusters/"+args[2]+"/allowed_groups/"+args[3];
+	}
+	else if(command=="instance info"){
+		expect(3,"instance");
+		args[2]=resolveInstance(args[2]);
+		request.method="GET";
+		request.path="instances/"+args[2];
+		modifies=false;
+	}
+	else if(command=="instance restart"){
+		expect(3,"instance");
+		args[2]=resolveInstance(args[2]);
+		request.method="PUT";
+		request.path="instances/"+args[2]+"/restart";
+	}
+	else if(command=="instance delete"){
+		expect(3,"instance [--force]");
+		args[2]=resolveInstance(args[2]);
+		request.method="DELETE";
+		request.path="instances/"+args[2];
+		allowForce=true;
+	}
+	else if(command=="secret info"){
+		expect(3,"secret");
+		request.method="GET";
+		request.path="secrets/"+args[2];
+		modifies=false;
+	}
+	else if(command=="secret delete"){
+		expect(3,"secret [--force]");
+		request.method="DELETE";
+		request.path="secrets/"+args[2];
+		allowForce=true;
+	}
+	else if(command=="secret copy"){
+		expect(4,"source-id secret-name --group group --cluster cluster");
+		if(!options.count("group") || !options.count("cluster"))
+			throw std::runtime_error("Usage: "+command+" source-id secret-name --group group --cluster cluster");
+		rapidjson::Document body(rapidjson::kObjectType);
+		rapidjson::Document::AllocatorType& alloc = body.GetAllocator();
+		body.AddMember("apiVersion", "v1alpha3", alloc);
+		rapidjson::Value metadata(rapidjson::kObjectType);
+		metadata.AddMember("name", args[3], alloc);
+		metadata.AddMember("group", options["group"], alloc);
+		metadata.AddMember("cluster", options["cluster"], alloc);
+		body.AddMember("metadata", metadata, alloc);
+		body.AddMember("copyFrom", args[2], alloc);
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		body.Accept(writer);
+		request.method="POST";
+		request.path="secrets";
+		request.body=buffer.GetString();
+		request.objects={options["group"],options["cluster"]};
+		request.changes=request.objects;
+		allowOptions=true;
+	}
+	else if(command=="volume info"){
+		expect(3,"volume");
+		request.method="GET";
+		request.path="volumes/"+args[2];
+		modifies=false;
+	}
+	else if(command=="volume delete"){
+		expect(3,"volume [--force]");
+		request.method="DELETE";
+		request.path="volumes/"+args[2];
+		allowForce=true;
+	}
+	else if(command=="user add-to-group" || command=="user remove-from-group"){
+		expect(4,"user group");
+		request.method=(args[1]=="add-to-group" ? "PUT" : "DELETE");
+		request.path="users/"+args[2]+"/groups/"+args[3];
+	}
+	else
+		throw std::runtime_error("The "+command+" command is not supported in batches");
+	
+	if(force && !allowForce)
+		throw std::runtime_error("The "+command+" command does not accept --force");
+	if(force)
+		request.query="&force";
+	if(!options.empty() && !allowOptions)
+		throw std::runtime_error("The "+command+" command does not accept --"+options.begin()->first);
+	//every argument after the command names an object, except that the 
+	//source secret of a copy is only read
+	for(std::size_t i=2; i<args.size(); i++){
+		request.objects.insert(args[i]);
+		if(modifies && !(command=="secret copy" && i==2))
+			request.changes.insert(args[i]);
+	}
+	return request;
+}
+
+std::size_t batchBundleEnd(const std::vector<BatchRequest>& requests, std::size_t start,
+                           std::size_t maxBundleSize){
+	std::set<std::string> involved, changed, paths;
+	std::size_t end=start;
+	for(; end<requests.size() && end-start<maxBundleSize; end++){
+		const BatchRequest& request=requests[end];
+		if(request.exclusive)
+			return (end==start ? end+1 : end);
+		if(!paths.insert(request.path+request.query).second)
+			break;
+		bool conflict=false;
+		for(const auto& object : request.objects){
+			if(changed.count(object))
+				conflict=true;
+		}
+		for(const auto& object : request.changes){
+			if(involved.count(object))
+				conflict=true;
+		}
+		if(conflict)
+			break;
+		involved.insert(request.objects.begin(),request.objects.end());
+		changed.insert(request.changes.begin(),request.changes.end());
+	}
+	return end;
+}
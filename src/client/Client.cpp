@@ -5,8 +5,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
@@ -21,9 +23,17 @@
 #include "Utilities.h"
 #include "Process.h"
 #include "OSDetection.h"
+#include "client/BatchCommands.h"
 
 namespace{
 	
+	///How long the application catalog may be reused from the local cache
+	///before it is fetched again
+	const std::chrono::seconds catalogCacheLifetime(600);
+	///How long a list of instances may be reused from the local cache when
+	///only looking for close matches to a mistyped instance name or ID
+	const std::chrono::seconds instanceFixupCacheLifetime(60);
+	
 	std::string makeTemporaryFile(const std::string& nameBase){
 		std::string base=nameBase+"XXXXXXXX";
 		//make a modifiable copy for mkstemp to scribble over
@@ -803,6 +813,24 @@ std::string Client::formatOutput(const rapidjson::Value& jdata, const rapidjson:
 	throw std::runtime_error("Specified output format is not supported");
 }
 
+std::string Client::fieldsParameter(const std::vector<columnSpec>& columns) const{
+	//other output formats may show any part of the response
+	if(!outputFormat.empty() && outputFormat!="no-headers")
+		return "";
+	std::string fields;
+	for(const auto& column : columns){
+		//an empty attribute refers to the whole object
+		if(column.attribute.empty())
+			return "";
+		if(!fields.empty())
+			fields+=',';
+		fields+=column.attribute;
+	}
+	if(fields.empty())
+		return "";
+	return "&fields="+fields;
+}
+
 Client::Client(bool useANSICodes, std::size_t outputWidth):
 apiVersion("v1alpha3"),
 useANSICodes(useANSICodes),
@@ -1175,12 +1203,14 @@ void Client::listGroups(const GroupListOptions& opt){
 	if (opt.user) {
 		url += "&user=true";
 	}
-	auto response=httpRequests::httpGet(url,defaultOptions());
+	const std::vector<columnSpec> columns={{"Name", "/metadata/name"},{"ID", "/metadata/id", true}};
+	url += fieldsParameter(columns);
+	auto response=cachedGet(url,std::chrono::seconds(0));
 	//TODO: handle errors, make output nice
 	if(response.status==200){
 		rapidjson::Document json;
 		json.Parse(response.body.c_str());
-		std::cout << formatOutput(json["items"], json, {{"Name", "/metadata/name"},{"ID", "/metadata/id", true}});
+		std::cout << formatOutput(json["items"], json, columns);
 	} else {
 		std::cerr << "Failed to list groups";
 		showError(response.body);
@@ -1188,13 +1218,14 @@ void Client::listGroups(const GroupListOptions& opt){
 	}
 }
 
-rapidjson::Document Client::getClusterList(std::string group){
+rapidjson::Document Client::getClusterList(std::string group, const std::string& fields){
 	std::string url=Client::makeURL("clusters");
 	if (!group.empty()) {
 		url += "&group=" + group;
 	}
+	url += fields;
 	ProgressToken progress(pman_,"Fetching cluster list...");
-	auto response=httpRequests::httpGet(url,defaultOptions());
+	auto response=cachedGet(url,std::chrono::seconds(0));
 	if(response.status==200){
 		rapidjson::Document json;
 		json.Parse(response.body.c_str());
@@ -1308,7 +1339,6 @@ void Client::createCluster(const ClusterCreateOptions& opt){
 
 	//set up the system namespace and service account
 	ensureFederationController(configPath, opt.assumeYes);
-	std::this_thread::sleep_for(std::chrono::milliseconds(10000));
 	ensureRBAC(configPath, opt.assumeYes);
 	ClusterConfig config=extractClusterConfig(configPath,opt.assumeYes);
 	
@@ -1473,11 +1503,11 @@ void Client::deleteCluster(const ClusterDeleteOptions& opt){
 }
 
 void Client::listClusters(const ClusterListOptions& opt){
-	rapidjson::Document json = getClusterList(opt.group);
-	std::cout << formatOutput(json["items"], json,
-			{{"Name","/metadata/name"},
-			{"Admin","/metadata/owningGroup"},
-			{"ID","/metadata/id",true}});
+	const std::vector<columnSpec> columns={{"Name","/metadata/name"},
+	                                       {"Admin","/metadata/owningGroup"},
+	                                       {"ID","/metadata/id",true}};
+	rapidjson::Document json = getClusterList(opt.group, fieldsParameter(columns));
+	std::cout << formatOutput(json["items"], json, columns);
 }
 
 void Client::getClusterInfo(const ClusterInfoOptions& opt){
@@ -1856,17 +1886,68 @@ void checkSystemNamespace(const std::string& configPath, const std::string& syst
 		throw std::runtime_error("'" + systemNamespace + "' does not appear to be a SLATE system namespace");
 	}
 }
+
+///The maximum number of cluster components to check at once
+const unsigned int maxConcurrentComponentChecks=4;
+
+///Run a collection of tasks, using at most a limited number of threads at once
+///\param tasks the work to run
+///\param maxThreads the number of tasks which may run concurrently, including
+///                  on the calling thread
+///\return the results of the tasks, in the same order. If any task throws an
+///        exception, the exception from the first such task is rethrown after
+///        all tasks have finished.
+template<typename Result>
+std::vector<Result> runConcurrently(const std::vector<std::function<Result()>>& tasks, unsigned int maxThreads){
+	std::vector<std::packaged_task<Result()>> work;
+	std::vector<std::future<Result>> futures;
+	work.reserve(tasks.size());
+	futures.reserve(tasks.size());
+	for(const auto& task : tasks){
+		work.emplace_back(task);
+		futures.push_back(work.back().get_future());
+	}
+	
+	std::atomic<std::size_t> next(0);
+	auto worker=[&]{
+		for(std::size_t i=next++; i<work.size(); i=next++)
+			work[i]();
+	};
+	std::vector<std::thread> threads;
+	for(std::size_t i=1; i<std::min<std::size_t>(maxThreads,work.size()); i++)
+		threads.emplace_back(worker);
+	worker();
+	for(auto& thread : threads)
+		thread.join();
+	
+	std::vector<Result> results;
+	results.reserve(futures.size());
+	for(auto& future : futures)
+		results.push_back(future.get());
+	return results;
+}
 }
 
 void Client::listInstalledClusterComponents(const ClusterComponentListOptions& opt) const{
 	std::string configPath=getKubeconfigPath(opt.kubeconfig);
 	checkSystemNamespace(configPath,opt.systemNamespace);
 	
+	//The components' checks mostly examine objects of these kinds, so fetch 
+	//them all together before the checks run
+	kubeResources.get(configPath,opt.systemNamespace,"",std::vector<std::string>{"Deployment","ClusterRole"});
+	std::vector<std::function<ClusterComponent::ComponentStatus()>> checks;
+	for(const auto& component : clusterComponents){
+		auto check=component.second.check;
+		checks.push_back([=,&opt]{ return (this->*check)(configPath,opt.systemNamespace); });
+	}
+	auto results=runConcurrently(checks,maxConcurrentComponentChecks);
+	
 	rapidjson::Document data(rapidjson::kArrayType);
 	rapidjson::Document::AllocatorType& alloc=data.GetAllocator();
 	
+	auto resultIt=results.begin();
 	for(const auto& component : clusterComponents){
-		auto result=(this->*component.second.check)(configPath,opt.systemNamespace);
+		auto result=*resultIt++;
 		rapidjson::Value componentData(rapidjson::kObjectType);
 		componentData.AddMember("name", component.first, alloc);
 		switch(result){
@@ -1964,7 +2045,7 @@ void Client::listApplications(const ApplicationOptions& opt){
 	if (opt.testRepo) {
 		url += "&test";
 	}
-	auto response=httpRequests::httpGet(url,defaultOptions());
+	auto response=cachedGet(url,catalogCacheLifetime);
 	//TODO: handle errors, make output nice
 	if(response.status==200){
 		rapidjson::Document json;
@@ -2207,6 +2288,7 @@ void Client::listInstances(const InstanceListOptions& opt){
 		columns = {{"Name", "/metadata/name"},
 			   {"ID",   "/metadata/id", true}};
 	}
+	url+=fieldsParameter(columns);
 	
 	auto response=httpRequests::httpGet(url,defaultOptions());
 	//TODO: handle errors, make output nice
@@ -3619,7 +3701,7 @@ void Client::retryInstanceCommandWithFixup(void (Client::* command)(const Option
 			   {"Cluster","/metadata/cluster"},
 			   {"ID","/metadata/id",true}};
 
-	auto response=httpRequests::httpGet(url,defaultOptions());
+	auto response=cachedGet(url,instanceFixupCacheLifetime);
 
 	if(response.status!=200){
 		std::cerr << "Failed to fetch instances" << std::endl;
@@ -3710,6 +3792,156 @@ void Client::retryInstanceCommandWithFixup(void (Client::* command)(const Option
 	}
 }
 
+namespace{
+	///Format a message in the same way as error responses from the API server
+	std::string batchError(const std::string& message){
+		rapidjson::Document error(rapidjson::kObjectType);
+		rapidjson::Document::AllocatorType& alloc = error.GetAllocator();
+		error.AddMember("kind", "Error", alloc);
+		error.AddMember("message", message, alloc);
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		error.Accept(writer);
+		return buffer.GetString();
+	}
+	
+	///Print the result of one command in a batch as a line of JSON
+	void printBatchResult(const BatchRequest& request, unsigned int status, 
+	                      const std::string& body){
+		rapidjson::Document result(rapidjson::kObjectType);
+		rapidjson::Document::AllocatorType& alloc = result.GetAllocator();
+		result.AddMember("line", (uint64_t)request.lineNumber, alloc);
+		result.AddMember("command", request.command, alloc);
+		result.AddMember("status", status, alloc);
+		rapidjson::Document bodyJSON(&alloc);
+		bodyJSON.Parse(body.c_str());
+		if(!bodyJSON.HasParseError())
+			result.AddMember("body", bodyJSON, alloc);
+		else
+			result.AddMember("body", body, alloc);
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		result.Accept(writer);
+		std::cout << buffer.GetString() << std::endl;
+	}
+}
+
+void Client::runBatch(const BatchOptions& opt){
+	std::ifstream file;
+	std::istream* input=&std::cin;
+	if(opt.commandFile!="-"){
+		file.open(opt.commandFile);
+		if(!file)
+			throw std::runtime_error("Unable to read commands from "+opt.commandFile);
+		input=&file;
+	}
+	
+	//Instance names are resolved using a single listing of all instances, 
+	//fetched only if needed
+	rapidjson::Document instances;
+	auto resolveInstance=[&](const std::string& idOrName)->std::string{
+		if(verifyInstanceID(idOrName))
+			return idOrName;
+		if(!instances.IsObject()){
+			auto response=cachedGet(makeURL("instances"),std::chrono::seconds(0));
+			if(response.status!=200)
+				throw std::runtime_error("Failed to list instances to look up "+idOrName);
+			instances.Parse(response.body.c_str());
+			if(!instances.IsObject() || !instances.HasMember("items") || !instances["items"].IsArray())
+				throw std::runtime_error("Instance list response from API server does not have expected structure");
+		}
+		std::string match;
+		for(const auto& instance : instances["items"].GetArray()){
+			if(instance["metadata"]["name"].GetString()!=idOrName)
+				continue;
+			if(!match.empty())
+				throw std::runtime_error("More than one instance is named "+idOrName+"; use an instance ID instead");
+			match=instance["metadata"]["id"].GetString();
+		}
+		if(match.empty())
+			throw std::runtime_error("No instance found with name "+idOrName);
+		return match;
+	};
+	
+	//Check all commands before running any, so that a mistake part way 
+	//through a script does not leave it half done
+	std::vector<BatchRequest> requests;
+	bool allValid=true;
+	std::string line;
+	for(std::size_t lineNumber=1; std::getline(*input,line); lineNumber++){
+		try{
+			auto words=splitCommandLine(line);
+			if(words.empty() || words.front()[0]=='#')
+				continue;
+			if(words.front()=="slate")
+				words.erase(words.begin());
+			requests.push_back(parseBatchCommand(words,resolveInstance));
+			requests.back().lineNumber=lineNumber;
+			requests.back().command=line;
+		}catch(std::runtime_error& err){
+			BatchRequest invalid;
+			invalid.lineNumber=lineNumber;
+			invalid.command=line;
+			printBatchResult(invalid,400,batchError(err.what()));
+			allValid=false;
+		}
+	}
+	if(!allValid){
+		std::cerr << "No commands were run because some could not be understood" << std::endl;
+		throw OperationFailed();
+	}
+	
+	//Requests are sent together until one conflicts with an earlier request
+	//in the same bundle; it must then wait for the earlier requests to 
+	//finish, so it starts the next bundle. 
+	const std::size_t maxBundleSize=32;
+	bool allSucceeded=true;
+	for(std::size_t start=0, end=0; start<requests.size(); start=end){
+		end=batchBundleEnd(requests,start,maxBundleSize);
+		
+		rapidjson::Document bundle(rapidjson::kObjectType);
+		auto& alloc=bundle.GetAllocator();
+		for(std::size_t i=start; i<end; i++){
+			std::string url="/"+apiVersion+"/"+requests[i].path+"?token="+getToken()+requests[i].query;
+			rapidjson::Value request(rapidjson::kObjectType);
+			request.AddMember("method",requests[i].method,alloc);
+			request.AddMember("requestBody",requests[i].body,alloc);
+			bundle.AddMember(rapidjson::Value().SetString(url,alloc),request,alloc);
+		}
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		bundle.Accept(writer);
+		auto response=httpRequests::httpPost(makeURL("multiplex"),buffer.GetString(),defaultOptions());
+		
+		rapidjson::Document results;
+		if(response.status==200)
+			results.Parse(response.body.c_str());
+		//results are listed in the same order as the requests
+		if(!results.IsObject() || results.MemberCount()!=end-start){
+			for(std::size_t i=start; i<end; i++)
+				printBatchResult(requests[i],response.status==200 ? 500 : response.status,
+				                 response.status==200 ? batchError("Unexpected response from API server") : response.body);
+			allSucceeded=false;
+			continue;
+		}
+		std::size_t i=start;
+		for(const auto& result : results.GetObject()){
+			unsigned int status=500;
+			std::string body;
+			if(result.value.IsObject() && result.value.HasMember("status") && result.value["status"].IsUint()
+			   && result.value.HasMember("body") && result.value["body"].IsString()){
+				status=result.value["status"].GetUint();
+				body=result.value["body"].GetString();
+			}
+			printBatchResult(requests[i++],status,body);
+			if(status!=200)
+				allSucceeded=false;
+		}
+	}
+	if(!allSucceeded)
+		throw OperationFailed();
+}
+
 std::string Client::getKubeconfigPath(std::string configPath) const{
 	if (configPath.empty()) { //try environment
 		fetchFromEnvironment("KUBECONFIG", configPath);
@@ -3882,6 +4114,20 @@ httpRequests::Options Client::defaultOptions() const{
 	return opts;
 }
 
+httpRequests::Response Client::cachedGet(const std::string& url, std::chrono::seconds maxAge){
+	if(!useCache)
+		return httpRequests::httpGet(url,defaultOptions());
+	if(!responseCache)
+		responseCache.reset(new ResponseCache(getHomeDirectory()+".slate/cache"));
+
+	return responseCache->get(url,maxAge,[&](const std::string& etag){
+		auto options=defaultOptions();
+		if(!etag.empty())
+			options.headers["If-None-Match"]=etag;
+		return httpRequests::httpGet(url,options);
+	});
+}
+
 #ifdef USE_CURLOPT_CAINFO
 void Client::detectCABundlePath() const{
 	if(caBundlePath.empty()){
@@ -1,4 +1,5 @@
 #include <client/Client.h>
+#include <client/Readiness.h>
 
 #include <fstream>
 #include <iostream>
@@ -23,14 +24,25 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 	const static std::string federationRoleURL = "https://raw.githubusercontent.com/slateci/federation-controller/main/resources/installation/federation-role.yaml";
 
 	std::cout << "Checking federation-controller status..." << std::endl;
-	auto result = runCommand("kubectl", {"get", "deployments", "-n", "kube-system", "--kubeconfig", configPath});
-	if (result.status != 0) {
+	//Each kind is fetched on its own, since permission to list one does not
+	//imply permission to list the others
+	auto deploymentListing = kubeResources.get(configPath, "kube-system", "", "Deployment");
+	const auto& deployments = *deploymentListing;
+	if (deployments.failed) {
 		throw std::runtime_error("Unable to list deployments in the kube-system namespace; "
 		                         "this command needs to be run with kubernetes administrator "
 		                         "privileges in order to create the correct environment (with "
 		                         "limited privileges) for SLATE to use.\n"
-		                         "Kubernetes error: " + result.error);
+		                         "Kubernetes error: " + deployments.error);
 	}
+	std::string deploymentNames;
+	for (const auto &deployment: deployments.items.GetArray()) {
+		if (deployment.HasMember("metadata") && deployment["metadata"].HasMember("name")
+		    && deployment["metadata"]["name"].IsString()) {
+			deploymentNames += std::string(deployment["metadata"]["name"].GetString()) + "\n";
+		}
+	}
+	commandResult result;
 
 	//We can list objects in kube-system, so permissions are too broad. 
 	//Check whether the controller is running:
@@ -39,11 +51,11 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 	// nrp-controller isn't running => check for federation-controller
 	// nrp-controller is running => update to use federation-controller
 	// federation-controller is running => check to see about updating
-	if ((result.output.find("nrp-controller") == std::string::npos) &&
-	    (result.output.find("federation-controller") == std::string::npos)) {
+	if ((deploymentNames.find("nrp-controller") == std::string::npos) &&
+	    (deploymentNames.find("federation-controller") == std::string::npos)) {
 		needToInstall = true;
 	} else {
-		if (result.output.find("nrp-controller") != std::string::npos) {
+		if (deploymentNames.find("nrp-controller") != std::string::npos) {
 			nrpDeployment = true;
 		}
 		if (nrpDeployment) {
@@ -62,22 +74,37 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 				deleteExisting = true;
 			}
 		} else {
-			result = runCommand("kubectl",
-					    {"get", "pods", "-l", "k8s-app=federation-controller", "-n",
-					     "kube-system", "-o",
-					     "jsonpath={.items[*].status.containerStatuses[*].image}",
-					     "--kubeconfig", configPath});
-			if (result.status != 0) {
+			auto podListing = kubeResources.get(configPath, "kube-system", "", "Pod");
+			const auto& pods = *podListing;
+			if (pods.failed) {
 				throw std::runtime_error(
-					"Unable to check image being used by the federation-controller.\n"
-					"Kubernetes error: " + result.error);
+					"Unable to list pods in the kube-system namespace to check the image "
+					"being used by the federation-controller.\n"
+					"Kubernetes error: " + pods.error);
+			}
+			std::string images;
+			for (const auto &pod: pods.items.GetArray()) {
+				if (getKubeLabel(pod, "k8s-app") != "federation-controller" ||
+				    !pod.HasMember("status") || !pod["status"].IsObject() ||
+				    !pod["status"].HasMember("containerStatuses") ||
+				    !pod["status"]["containerStatuses"].IsArray()) {
+					continue;
+				}
+				for (const auto &container: pod["status"]["containerStatuses"].GetArray()) {
+					if (container.HasMember("image") && container["image"].IsString()) {
+						if (!images.empty()) {
+							images += ' ';
+						}
+						images += container["image"].GetString();
+					}
+				}
 			}
 
 			std::string installedVersion;
-			std::size_t startPos = result.output.rfind(':');
-			if (!result.output.empty() && startPos != std::string::npos &&
-			    startPos < result.output.size() - 1) {
-				installedVersion = result.output.substr(startPos + 1);
+			std::size_t startPos = images.rfind(':');
+			if (!images.empty() && startPos != std::string::npos &&
+			    startPos < images.size() - 1) {
+				installedVersion = images.substr(startPos + 1);
 			}
 			std::cout << "Installed Federation-Controller tag: " << installedVersion << std::endl;
 
@@ -122,6 +149,7 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 					     "kube-system",
 					     "--kubeconfig", configPath});
 		}
+		kubeResources.invalidate(configPath);
 		if (result.status != 0) {
 			throw std::runtime_error("Unable to remove old controller deployment.\n"
 			                         "Kubernetes error: " + result.error);
@@ -162,51 +190,33 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 	if (needToInstall) {
 		std::cout << "Applying " << controllerDeploymentURL << std::endl;
 		result = runCommand("kubectl", {"apply", "-f", controllerDeploymentURL, "--kubeconfig", configPath});
+		kubeResources.invalidate(configPath);
 		if (result.status) {
 			throw std::runtime_error("Failed to deploy federation controller: " + result.error);
 		}
 
 		std::cout << "Waiting for the federation Controller to become active..." << std::endl;
-		while (true) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(50));
-			result = runCommand("kubectl",
-			                    {"get", "pods", "-n", "kube-system", "-lk8s-app=federation-controller", "-o", "json",
-			                     "--kubeconfig", configPath});
-			if (result.status == 0) {
-				rapidjson::Document resultJSON;
-				try {
-					resultJSON.Parse(result.output.c_str());
-				} catch (...) { continue; }
-				if (!resultJSON.HasMember("items") || !resultJSON["items"].IsArray() ||
-				    resultJSON["items"].GetArray().Size() == 0) {
-					continue;
-				}
-				bool allGood = true, problem = false;
-				for (const auto &pod: resultJSON["items"].GetArray()) {
-					if (!pod.HasMember("status") || !pod["status"].IsObject()) {
-						continue;
-					}
-					if (!pod["status"].HasMember("phase") || !pod["status"]["phase"].IsString()) {
-						continue;
-					}
-					std::string status = pod["status"]["phase"].GetString();
-					if (status != "Running") {
-						allGood = false;
-						if (status == "CrashLoopBackoff") {
-							problem = true;
-						}
-					}
-				}
-				if (allGood) {
-					std::cout << " Federation Controller is active" << std::endl;
-					break;
-				}
-				if (problem) {
-					throw std::runtime_error(
-						"Federation Controller deployment is not healthy; aborting");
-				}
-			}
+	}
+
+	//Whether or not it was just installed, the controller must be available 
+	//before it can handle the Cluster object created later
+	{
+		WaitOptions controllerWait(std::chrono::minutes(5));
+		controllerWait.warnAfter = std::chrono::minutes(1);
+		controllerWait.warning = [this] {
+			HideProgress quiet(pman_);
+			std::cout << "The federation controller is taking abnormally long to become available.\n"
+			          << "If progress does not occur shortly, you may want to abort this process (Ctrl+C)\n"
+			          << "and examine the state of its deployment in the kube-system namespace." << std::endl;
+		};
+		if (!kubectlWaitFor(configPath, {"--for=condition=available", "deployments", "-n", "kube-system",
+		                                 "-l", "k8s-app in (federation-controller,nrp-controller)"},
+		                    controllerWait)) {
+			throw std::runtime_error("Federation Controller deployment is not healthy; aborting");
 		}
+	}
+	if (needToInstall) {
+		std::cout << " Federation Controller is active" << std::endl;
 	} else {
 		std::cout << " Controller is deployed" << std::endl;
 	}
@@ -214,15 +224,12 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 	pman_.SetProgress(0.1);
 
 	std::cout << "Ensuring that Custom Resource Definitions are active..." << std::endl;
-	while (true) {
-		result = runCommand("kubectl", {"get", "crds", "--kubeconfig", configPath});
-		if (result.output.find("clusters.slateci.io") != std::string::npos &&
-		    result.output.find("clusternss.slateci.io") != std::string::npos) {
-			std::cout << " CRDs are active" << std::endl;
-			break;
-		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	if (!kubectlWaitFor(configPath, {"--for=condition=established",
+	                                 "crd/clusters.slateci.io", "crd/clusternss.slateci.io"},
+	                    WaitOptions(std::chrono::minutes(2)))) {
+		throw std::runtime_error("The federation controller's Custom Resource Definitions did not become active");
 	}
+	std::cout << " CRDs are active" << std::endl;
 
 	pman_.SetProgress(0.2);
 }
@@ -230,6 +237,8 @@ void Client::ensureFederationController(const std::string &configPath, bool assu
 
 void Client::ensureRBAC(const std::string &configPath, bool assumeYes) {
 	std::cout << "Checking for federation ClusterRole..." << std::endl;
+	//Only this one ClusterRole is fetched, since permission to read it does 
+	//not imply permission to list all ClusterRoles
 	auto result = runCommand("kubectl", {"get", "clusterrole", "federation-cluster", "--kubeconfig", configPath});
 	if (result.status) {
 		{
@@ -255,6 +264,7 @@ void Client::ensureRBAC(const std::string &configPath, bool assumeYes) {
 
 		std::cout << "Applying " << federationRoleURL << std::endl;
 		result = runCommand("kubectl", {"apply", "-f", federationRoleURL, "--kubeconfig", configPath});
+		kubeResources.invalidate(configPath);
 		if (result.status) {
 			throw std::runtime_error("Failed to deploy federation clusterrole: " + result.error);
 		}
@@ -270,55 +280,35 @@ void Client::ensureRBAC(const std::string &configPath, bool assumeYes) {
 ///        claimed that there is some LoadBalancer present
 bool Client::checkLoadBalancer(const std::string &configPath, bool assumeYes) {
 	std::cout << "Checking for a LoadBalancer..." << std::endl;
+	//MetalLB controller pods may be labeled in either of two ways
+	auto isMetalLBController = [](const rapidjson::Value &pod) -> bool {
+		return (getKubeLabel(pod, "app") == "metallb" && getKubeLabel(pod, "component") == "controller") ||
+		       (getKubeLabel(pod, "app.kubernetes.io/instance") == "metallb" &&
+		        getKubeLabel(pod, "app.kubernetes.io/component") == "controller");
+	};
+	auto isRunning = [](const rapidjson::Value &pod) -> bool {
+		return pod.HasMember("status") && pod["status"].IsObject() && pod["status"].HasMember("phase") &&
+		       pod["status"]["phase"].IsString() && std::string(pod["status"]["phase"].GetString()) == "Running";
+	};
 	bool present = false;
-	// check the metallb-system namespace for loadbalancer
+	// check the metallb-system namespace for the controller, under either set 
+	// of labels, with a single listing
 	{
-		auto result = runCommand("kubectl", {"get", "namespace",
-						     "-o", "jsonpath={.items[*].metadata.name}",
-						     "--kubeconfig", configPath});
-		if (result.status == 0) {
-			present = (result.output.find("metallb-system") != std::string::npos);
-		}
-		// look for app, component labels
-		result = runCommand("kubectl", {"get", "pods",
-						"-n", "metallb-system",
-						"-l", "app=metallb,component=controller",
-						"-o", "jsonpath={.items[*].status.phase}",
-						"--kubeconfig", configPath});
-		if (result.status == 0) {
-			present = (result.output.find("Running") != std::string::npos);
-		}
-		// alternate system of labels to check
-		result = runCommand("kubectl", {"get", "pods",
-						"-n", "metallb-system",
-						"-l",
-						"app.kubernetes.io/component=controller,app.kubernetes.io/instance=metallb",
-						"-o", "jsonpath={.items[*].status.phase}",
-						"--kubeconfig", configPath});
-		if (result.status == 0) {
-			present = (result.output.find("Running") != std::string::npos);
+		auto pods = kubeResources.get(configPath, "metallb-system", "", "Pod");
+		for (const auto &pod: pods->items.GetArray()) {
+			if (isMetalLBController(pod) && isRunning(pod)) {
+				present = true;
+			}
 		}
-
 	}
 	// try checking all namespaces for metallb
 	// this doesn't always work, so we want to try this after looking at the metallb-system namespace
-	{
-		auto result = runCommand("kubectl", {"get", "pods", "--all-namespaces",
-						     "-l", "app=metallb,component=controller",
-						     "-o", "jsonpath={.items[*].status.phase}",
-						     "--kubeconfig", configPath});
-		if (result.status == 0) {
-			present = (result.output.find("Running") != std::string::npos);
-		}
-		// alternate system of labels to check
-		result = runCommand("kubectl", {"get", "pods",
-						"-n", "metallb-system",
-						"-l",
-						"app.kubernetes.io/component=controller,app.kubernetes.io/instance=metallb",
-						"-o", "jsonpath={.items[*].status.phase}",
-						"--kubeconfig", configPath});
-		if (result.status == 0) {
-			present = (result.output.find("Running") != std::string::npos);
+	if (!present) {
+		auto pods = kubeResources.get(configPath, "", "app=metallb,component=controller", "Pod");
+		for (const auto &pod: pods->items.GetArray()) {
+			if (isRunning(pod)) {
+				present = true;
+			}
 		}
 	}
 
@@ -353,12 +343,9 @@ bool Client::checkLoadBalancer(const std::string &configPath, bool assumeYes) {
 std::string
 Client::getIngressControllerAddress(const std::string &configPath, const std::string &systemNamespace) const {
 	std::cout << "Finding the LoadBalancer address assigned to the ingress controller..." << std::endl;
-	unsigned int attempts = 0;
-	do {
-		if (attempts) {
-			std::this_thread::sleep_for(std::chrono::seconds(5));
-		}
-		attempts++;
+	std::string address;
+	//keep trying for up to two minutes
+	bool assigned = waitForCondition([&] {
 		auto result = runCommand("kubectl", {"get", "services", "-n", systemNamespace,
 		                                     "-l", "app.kubernetes.io/name=ingress-nginx",
 		                                     "-o", "jsonpath={.items[*].status.loadBalancer.ingress[0].ip}",
@@ -366,10 +353,12 @@ Client::getIngressControllerAddress(const std::string &configPath, const std::st
 		if (result.status) {
 			throw std::runtime_error("Failed to check ingress controller service status: " + result.error);
 		}
-		if (!result.output.empty()) {
-			return result.output;
-		}
-	} while (attempts < 25); //keep trying for up to two minutes
+		address = result.output;
+		return !address.empty();
+	}, WaitOptions(std::chrono::minutes(2)));
+	if (assigned) {
+		return address;
+	}
 	throw std::runtime_error("Ingress controller service has not received an IP address."
 	                         "This can happen if a LoadBalancer is not installed in the cluster, "
 	                         "or has exhausted its pool of allocatable addresses.");
@@ -516,14 +505,11 @@ metadata:
 	//Tricky point: if the namespace name is already in use, the nrp-controller
 	//pseudo-helpfully makes up a different one. First we need to detect if this
 	//has happened. 
-	unsigned int attempts = 0;
-	do {
-		if (attempts) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-		}
+	waitForCondition([&] {
 		result = runCommand("kubectl", {"get", "cluster.slateci.io", namespaceName, "-o", "jsonpath={.spec.Namespace}",
 		                                "--kubeconfig", configPath});
-	} while ((result.status || result.output.empty()) && attempts++ < 10);
+		return result.status == 0 && !result.output.empty();
+	}, WaitOptions(std::chrono::seconds(30)));
 	if (result.status || result.output.empty()) {
 		throw std::runtime_error("Checking created namespace name failed: " + result.error);
 	}
@@ -553,22 +539,25 @@ metadata:
 		HideProgress quiet(pman_);
 		std::cout << "Waiting for namespace " << namespaceName << " to become ready..." << std::endl;
 	}
-	attempts = 0;
-	while (true) {
-		result = runCommand("kubectl",
-		                    {"get", "namespace", namespaceName, "-o", "jsonpath={.status.phase}", "--kubeconfig",
-		                     configPath});
-		if (result.status == 0 && result.output == "Active") {
-			break;
-		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
-		if (++attempts == 600) {
+	{
+		WaitOptions namespaceWait(std::chrono::minutes(10));
+		namespaceWait.warnAfter = std::chrono::minutes(1);
+		namespaceWait.warning = [&] {
 			HideProgress quiet(pman_);
 			std::cout << "Namespace creation is taking abnormally long.\n"
 			          << "If progress does not occur shortly, you may want to abort this process (Ctrl+C)\n"
 			          << "and either examine the state of the " << namespaceName << " namespace or run\n"
 			          << "`kubectl delete cluster.slateci.io " << namespaceName << "` before running\n"
 			          << "this command again." << std::endl;
+		};
+		bool active = waitForCondition([&] {
+			result = runCommand("kubectl",
+			                    {"get", "namespace", namespaceName, "-o", "jsonpath={.status.phase}", "--kubeconfig",
+			                     configPath});
+			return result.status == 0 && result.output == "Active";
+		}, namespaceWait);
+		if (!active) {
+			throw std::runtime_error("Namespace " + namespaceName + " did not become ready");
 		}
 	}
 
@@ -579,25 +568,24 @@ metadata:
 		HideProgress quiet(pman_);
 		std::cout << "Locating ServiceAccount credentials..." << std::endl;
 	}
-	attempts = 0;
-	while (true) {
-		result = runCommand("kubectl", {"get", "serviceaccount", namespaceName, "-n", namespaceName, "-o",
-		                                "jsonpath='{.secrets[].name}'", "--kubeconfig", configPath});
-		if (result.status == 0 && !result.output.empty()) {
-			break;
-		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
-		if (++attempts == 600) {
+	{
+		WaitOptions accountWait(std::chrono::minutes(5));
+		accountWait.warnAfter = std::chrono::minutes(1);
+		accountWait.warning = [&] {
 			HideProgress quiet(pman_);
 			std::cout << "ServiceAccount creation is taking abnormally long.\n"
 			          << "If progress does not occur shortly, you may want to abort this process (Ctrl+C)\n"
 			          << "and either examine the state of the " << namespaceName << " namespace and serviceaccount\n"
 			          << " or run `kubectl delete cluster.slateci.io " << namespaceName << "` before running\n"
 			          << "this command again." << std::endl;
-		}
+		};
+		//if the account never gets a token secret, one is created below
+		waitForCondition([&] {
+			result = runCommand("kubectl", {"get", "serviceaccount", namespaceName, "-n", namespaceName, "-o",
+			                                "jsonpath='{.secrets[].name}'", "--kubeconfig", configPath});
+			return result.status == 0 && !result.output.empty();
+		}, accountWait);
 	}
-	result = runCommand("kubectl", {"get", "serviceaccount", namespaceName, "-n", namespaceName, "-o",
-	                                "jsonpath='{.secrets[].name}'", "--kubeconfig", configPath});
 	if (result.status) {
 		std::cout << "ServiceAccount token secret not present, try to create one? [y]/n: ";
 		std::cout.flush();
@@ -0,0 +1,155 @@
+#include "client/KubeResourceCache.h"
+
+#include <Process.h>
+
+namespace{
+	using Listing=KubeResourceCache::Listing;
+
+	///List objects of several kinds with a single kubectl call
+	std::vector<std::shared_ptr<Listing>> fetchListings(const std::string& configPath,
+	                                                    const std::string& nspace,
+	                                                    const std::string& selector,
+	                                                    const std::vector<std::string>& kinds){
+		std::vector<std::shared_ptr<Listing>> results;
+		std::string resources;
+		for(const auto& kind : kinds){
+			results.push_back(std::make_shared<Listing>());
+			if(!resources.empty())
+				resources+=',';
+			resources+=kind;
+		}
+
+		std::vector<std::string> args={"get",resources,"-o=json","--kubeconfig",configPath};
+		if(nspace.empty())
+			args.push_back("--all-namespaces");
+		else{
+			args.push_back("-n");
+			args.push_back(nspace);
+		}
+		if(!selector.empty())
+			args.push_back("-l="+selector);
+		auto result=runCommand("kubectl",args);
+
+		rapidjson::Document json;
+		if(result.status==0)
+			json.Parse(result.output.c_str());
+		if(result.status!=0 || !json.IsObject() || !json.HasMember("items") || !json["items"].IsArray()){
+			//one forbidden or unknown kind makes kubectl fail for all of them, 
+			//so try each kind alone to find which can be listed
+			if(kinds.size()>1){
+				for(std::size_t i=0; i<kinds.size(); i++)
+					results[i]=fetchListings(configPath,nspace,selector,{kinds[i]}).front();
+				return results;
+			}
+			for(auto& listing : results){
+				listing->failed=true;
+				listing->error=(result.status!=0 ? result.error : "Malformed JSON from kubectl");
+			}
+			return results;
+		}
+		//a listing of several kinds contains all of the objects together
+		for(auto& item : json["items"].GetArray()){
+			if(!item.IsObject() || !item.HasMember("kind") || !item["kind"].IsString())
+				continue;
+			const std::string kind=item["kind"].GetString();
+			for(std::size_t i=0; i<kinds.size(); i++){
+				if(kinds[i]!=kind)
+					continue;
+				auto& items=results[i]->items;
+				items.PushBack(rapidjson::Value(item,items.GetAllocator()),items.GetAllocator());
+				break;
+			}
+		}
+		return results;
+	}
+}
+
+std::vector<std::shared_ptr<const KubeResourceCache::Listing>>
+KubeResourceCache::get(const std::string& configPath, const std::string& nspace,
+                       const std::string& selector, const std::vector<std::string>& kinds){
+	std::vector<std::shared_future<std::shared_ptr<const Listing>>> futures;
+	//the kinds which this call is responsible for fetching
+	std::vector<std::string> missing;
+	std::vector<std::promise<std::shared_ptr<const Listing>>> promises;
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		for(const auto& kind : kinds){
+			Key key{configPath,nspace,selector,kind};
+			auto it=listings.find(key);
+			if(it==listings.end()){
+				promises.emplace_back();
+				missing.push_back(kind);
+				it=listings.emplace(key,promises.back().get_future().share()).first;
+			}
+			futures.push_back(it->second);
+		}
+	}
+	if(!missing.empty()){
+		//failures are passed to those already waiting, but not kept, so that
+		//later requests try again
+		std::vector<std::string> failed;
+		try{
+			auto fetched=fetchListings(configPath,nspace,selector,missing);
+			for(std::size_t i=0; i<missing.size(); i++){
+				promises[i].set_value(fetched[i]);
+				if(fetched[i]->failed)
+					failed.push_back(missing[i]);
+			}
+		}catch(...){
+			for(auto& promise : promises)
+				promise.set_exception(std::current_exception());
+			failed=missing;
+		}
+		if(!failed.empty()){
+			std::lock_guard<std::mutex> lock(mut);
+			for(const auto& kind : failed)
+				listings.erase(Key{configPath,nspace,selector,kind});
+		}
+	}
+
+	std::vector<std::shared_ptr<const Listing>> results;
+	results.reserve(futures.size());
+	for(auto& future : futures)
+		results.push_back(future.get());
+	return results;
+}
+
+std::shared_ptr<const KubeResourceCache::Listing>
+KubeResourceCache::get(const std::string& configPath, const std::string& nspace,
+                       const std::string& selector, const std::string& kind){
+	return get(configPath,nspace,selector,std::vector<std::string>{kind}).front();
+}
+
+void KubeResourceCache::invalidate(const std::string& configPath){
+	std::lock_guard<std::mutex> lock(mut);
+	for(auto it=listings.begin(); it!=listings.end();){
+		if(it->first.front()==configPath)
+			it=listings.erase(it);
+		else
+			++it;
+	}
+}
+
+const rapidjson::Value* findKubeObject(const KubeResourceCache::Listing& listing,
+                                      const std::string& name){
+	for(const auto& item : listing.items.GetArray()){
+		if(item.HasMember("metadata") && item["metadata"].IsObject()
+		   && item["metadata"].HasMember("name") && item["metadata"]["name"].IsString()
+		   && item["metadata"]["name"].GetString()==name)
+			return &item;
+	}
+	return nullptr;
+}
+
+std::string getKubeLabel(const rapidjson::Value& object, const std::string& label){
+	if(!object.IsObject() || !object.HasMember("metadata") || !object["metadata"].IsObject())
+		return "";
+	const auto& metadata=object["metadata"];
+	if(!metadata.HasMember("labels") || !metadata["labels"].IsObject())
+		return "";
+	const auto& labels=metadata["labels"];
+	auto it=labels.FindMember(label.c_str());
+	if(it==labels.MemberEnd() || !it->value.IsString())
+		return "";
+	return it->value.GetString();
+}
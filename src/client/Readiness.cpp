@@ -0,0 +1,49 @@
+#include "client/Readiness.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <Process.h>
+
+bool waitForCondition(const std::function<bool()>& condition, const WaitOptions& options){
+	using clock=std::chrono::steady_clock;
+	const auto start=clock::now();
+	const auto deadline=start+options.timeout;
+	std::chrono::milliseconds delay=options.initialDelay;
+	bool warned=false;
+	while(true){
+		if(condition())
+			return true;
+		const auto now=clock::now();
+		if(now>=deadline)
+			return false;
+		if(!warned && options.warnAfter.count() && now-start>=options.warnAfter){
+			if(options.warning)
+				options.warning();
+			warned=true;
+		}
+		//do not sleep past the deadline, so that the condition is checked one
+		//final time just as the deadline arrives
+		auto remaining=std::chrono::duration_cast<std::chrono::milliseconds>(deadline-now);
+		std::this_thread::sleep_for(std::min(delay,remaining));
+		delay=std::min(delay*2,options.maxDelay);
+	}
+}
+
+bool kubectlWaitFor(const std::string& configPath, const std::vector<std::string>& args,
+                    const WaitOptions& options){
+	using clock=std::chrono::steady_clock;
+	const auto deadline=clock::now()+options.timeout;
+	return waitForCondition([&]()->bool{
+		//let kubectl watch for the rest of the time available
+		auto remaining=std::chrono::duration_cast<std::chrono::seconds>(deadline-clock::now());
+		std::vector<std::string> waitArgs={"wait"};
+		waitArgs.insert(waitArgs.end(),args.begin(),args.end());
+		waitArgs.push_back("--timeout="+std::to_string(std::max<long long>(remaining.count(),1))+"s");
+		waitArgs.push_back("--kubeconfig");
+		waitArgs.push_back(configPath);
+		//kubectl may legitimately wait longer than the usual limit
+		commandLimits limits(remaining+std::chrono::seconds(30));
+		return runCommand("kubectl",waitArgs,{},limits).status==0;
+	},options);
+}
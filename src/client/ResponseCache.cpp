@@ -0,0 +1,142 @@
+#include "client/ResponseCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+
+namespace{
+	///Identifies the format of cache files, so that files in an older format
+	///are ignored
+	const std::string cacheFormatVersion="slate-response-cache 1";
+
+	///Remove the value of the token parameter from a URL, so that credentials
+	///are not written into cache files
+	std::string redactToken(const std::string& url){
+		std::string result=url;
+		for(const std::string key : {"?token=","&token="}){
+			auto pos=result.find(key);
+			if(pos==std::string::npos)
+				continue;
+			pos+=key.size();
+			auto end=result.find('&',pos);
+			result.replace(pos,end==std::string::npos ? std::string::npos : end-pos,"*");
+		}
+		return result;
+	}
+}
+
+ResponseCache::ResponseCache(std::string directory):directory(std::move(directory)){
+	//Failure is ignored here, and will just result in all lookups missing
+	mkdir(this->directory.c_str(),0700);
+}
+
+std::string ResponseCache::pathFor(const std::string& url) const{
+	//The token is included in the hash so that different users' responses
+	//are stored separately
+	//A cryptographic digest is used because, unlike std::hash, it does not 
+	//change when the client is rebuilt, which would orphan existing entries
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digestLength=0;
+	if(!EVP_Digest(url.data(),url.size(),digest,&digestLength,EVP_sha256(),nullptr))
+		throw std::runtime_error("Failed to compute response cache key");
+	std::ostringstream path;
+	path << directory << '/' << std::hex << std::setfill('0');
+	for(unsigned int i=0; i<digestLength; i++)
+		path << std::setw(2) << (unsigned int)digest[i];
+	return path.str();
+}
+
+bool ResponseCache::fetch(const std::string& url, Entry& entry) const{
+	std::string path;
+	try{
+		path=pathFor(url);
+	}catch(std::runtime_error&){
+		return false;
+	}
+	std::ifstream file(path);
+	if(!file)
+		return false;
+	std::string version, storedURL, etag;
+	long long storedTime;
+	if(!std::getline(file,version) || version!=cacheFormatVersion)
+		return false;
+	//guard against hash collisions
+	if(!std::getline(file,storedURL) || storedURL!=redactToken(url))
+		return false;
+	if(!(file >> storedTime) || file.get()!='\n')
+		return false;
+	if(!std::getline(file,etag))
+		return false;
+	std::ostringstream body;
+	body << file.rdbuf();
+	if(file.bad())
+		return false;
+	entry.stored=std::chrono::system_clock::time_point(std::chrono::seconds(storedTime));
+	entry.etag=etag;
+	entry.body=body.str();
+	return true;
+}
+
+void ResponseCache::store(const std::string& url, const Entry& entry) const{
+	std::string path;
+	try{
+		path=pathFor(url);
+	}catch(std::runtime_error&){
+		return;
+	}
+	//Write to a separate file and then rename it into place, so that other
+	//invocations of the client reading concurrently never see a partial entry
+	const std::string tempPath=path+".tmp"+std::to_string(getpid());
+	{
+		std::ofstream file(tempPath);
+		if(!file)
+			return;
+		//responses may contain private information, such as secret metadata
+		chmod(tempPath.c_str(),0600);
+		auto storedTime=std::chrono::duration_cast<std::chrono::seconds>(entry.stored.time_since_epoch()).count();
+		file << cacheFormatVersion << '\n' << redactToken(url) << '\n'
+		     << storedTime << '\n' << entry.etag << '\n' << entry.body;
+		file.close();
+		if(file.fail()){
+			remove(tempPath.c_str());
+			return;
+		}
+	}
+	if(rename(tempPath.c_str(),path.c_str())!=0)
+		remove(tempPath.c_str());
+}
+
+httpRequests::Response ResponseCache::get(const std::string& url, std::chrono::seconds maxAge,
+                                          std::function<httpRequests::Response(const std::string&)> request) const{
+	const auto now=std::chrono::system_clock::now();
+	Entry entry;
+	bool haveEntry=fetch(url,entry);
+	if(haveEntry && now-entry.stored<maxAge)
+		return httpRequests::Response{200,entry.body,{}};
+
+	auto response=request(haveEntry ? entry.etag : "");
+	if(response.status==304 && haveEntry){
+		//the stored response is still current
+		entry.stored=now;
+		store(url,entry);
+		return httpRequests::Response{200,entry.body,response.headers};
+	}
+	if(response.status==200){
+		entry.stored=now;
+		auto etag=response.headers.find("etag");
+		entry.etag=(etag!=response.headers.end() ? etag->second : "");
+		entry.body=response.body;
+		//a response which can be neither reused nor revalidated is not worth
+		//storing
+		if(maxAge.count()>0 || !entry.etag.empty())
+			store(url,entry);
+	}
+	return response;
+}
@@ -14,8 +14,14 @@ const std::string Client::federationRoleURL="https://raw.githubusercontent.com/s
 Client::ClusterComponent::ComponentStatus Client::checkFederationRBAC(const std::string& configPath, const std::string& systemNamespace) const{
 	static const std::string rbacVersionTag="slate-federation-role-version";
 
-	//find out what the RBAC is supposed to be
-	auto download=httpRequests::httpGet(federationRoleURL,defaultOptions());
+	//find out what the RBAC is supposed to be, while looking at what is installed
+	auto pendingDownload=httpRequests::httpGetAsync(federationRoleURL,defaultOptions());
+	//list all clusterroles once, rather than querying separately for the 
+	//labeled roles and the old, unlabeled one. ClusterRoles are not namespaced,
+	//but using the system namespace allows reusing a listing fetched together
+	//with the system namespace's other objects.
+	auto clusterRoles=kubeResources.get(configPath,systemNamespace,"","ClusterRole");
+	auto download=pendingDownload.get();
 	if (download.status != 200) {
 		throw std::runtime_error("Failed to download current RBAC manifest from " + federationRoleURL);
 	}
@@ -41,48 +47,28 @@ Client::ClusterComponent::ComponentStatus Client::checkFederationRBAC(const std:
 		rbacVersion=download.body.substr(pos,end!=std::string::npos?end-pos:end);
 	}
 
-	auto result=runCommand("kubectl",{"get","clusterroles",
-	                                  "-l=slate-federation-role-version",
-	                                  "-o=json",
-	                                  "--kubeconfig",configPath});
-	if (result.status != 0) {
-		throw std::runtime_error("kubectl failed: " + result.error);
+	if (clusterRoles->failed) {
+		throw std::runtime_error("kubectl failed: " + clusterRoles->error);
 	}
 	
-	rapidjson::Document json;
-	json.Parse(result.output.c_str());
-	if (!json.HasMember("items") || !json["items"].IsArray()) {
-		throw std::runtime_error("Malformed JSON from kubectl");
+	std::vector<std::string> installedVersions;
+	for(const auto& item : clusterRoles->items.GetArray()){
+		std::string installedVersion=getKubeLabel(item,rbacVersionTag);
+		if(!installedVersion.empty())
+			installedVersions.push_back(installedVersion);
 	}
 	
-	if(json["items"].Empty()){ //found nothing
+	if(installedVersions.empty()){ //found nothing
 		//try looking for a version too old to have the version label
-		result=runCommand("kubectl",{"get","clusterrole",
-		                              "federation-cluster",
-		                              "-o=json",
-		                              "--kubeconfig",configPath});
-		if(result.status!=0){
-			if (result.error.find("Error from server (NotFound)") != std::string::npos) {
-				return ClusterComponent::NotInstalled;
-			}
-			throw std::runtime_error("kubectl failed: "+result.error);
-		}
-		json.Parse(result.output.c_str());
-	
+		if(!findKubeObject(*clusterRoles,"federation-cluster"))
+			return ClusterComponent::NotInstalled;
 		return (ClusterComponent::OutOfDate);
 	}
 
-	if (json["items"].Size() != 2) { //if exactly two clusterroles are not found, something is not right
+	if (installedVersions.size() != 2) { //if exactly two clusterroles are not found, something is not right
 		return ClusterComponent::NotInstalled;
 	}
-	for(const auto& item : json["items"].GetArray()){
-		if (!item.IsObject() || !item.HasMember("metadata") || !item["metadata"].IsObject()
-		    || !item["metadata"].HasMember("labels") || !item["metadata"]["labels"].IsObject()
-		    || !item["metadata"]["labels"].HasMember("slate-federation-role-version")
-		    || !item["metadata"]["labels"]["slate-federation-role-version"].IsString()) {
-			continue;
-		} //this should be unreachable
-		std::string installedVersion=item["metadata"]["labels"]["slate-federation-role-version"].GetString();
+	for(const auto& installedVersion : installedVersions){
 		int verComp=compareVersions(installedVersion,rbacVersion);
 		switch(verComp){
 			case -1:
@@ -102,6 +88,7 @@ Client::ClusterComponent::ComponentStatus Client::checkFederationRBAC(const std:
 void Client::installFederationRBAC(const std::string& configPath, const std::string& systemNamespace) const{
 	std::cout << "Applying " << federationRoleURL << std::endl;
 	auto result=runCommand("kubectl",{"apply","-f",federationRoleURL,"--kubeconfig",configPath});
+	kubeResources.invalidate(configPath);
 	if (result.status) {
 		throw std::runtime_error("Failed to deploy federation clusterrole: " + result.error);
 	}
@@ -109,6 +96,7 @@ void Client::installFederationRBAC(const std::string& configPath, const std::str
 
 void Client::removeFederationRBAC(const std::string& configPath, const std::string& systemNamespace) const{
 	auto result=runCommand("kubectl",{"delete","-f",federationRoleURL,"--kubeconfig",configPath});
+	kubeResources.invalidate(configPath);
 	if (result.status) {
 		throw std::runtime_error("Failed to delete federation clusterrole: " + result.error);
 	}
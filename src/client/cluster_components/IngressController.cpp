@@ -711,53 +711,22 @@ webhooks:
 
 
 Client::ClusterComponent::ComponentStatus Client::checkIngressController(const std::string& configPath, const std::string& systemNamespace) const{
-	auto result=runCommand("kubectl",{"get","deployments","-n",systemNamespace,
-	                                  "-l=slate-ingress-version",
-	                                  "-o=json",
-	                                  "--kubeconfig",configPath});
-	if (result.status != 0) {
-		throw std::runtime_error("kubectl failed: " + result.error);
+	//list all deployments in the namespace once, rather than querying for each
+	//label which may identify the controller
+	auto deployments=kubeResources.get(configPath,systemNamespace,"","Deployment");
+	if (deployments->failed) {
+		throw std::runtime_error("kubectl failed: " + deployments->error);
 	}
 	
-	rapidjson::Document json;
-	json.Parse(result.output.c_str());
-
-	if (!json.HasMember("items") || !json["items"].IsArray()) {
-		throw std::runtime_error("Malformed JSON from kubectl");
-	}
-	if(json["items"].Size()==0){ //found nothing
-		//try looking for a version too old to have the version label
-		result=runCommand("kubectl",{"get","deployments","-n",systemNamespace,
-	                                  "-l=app.kubernetes.io/name=ingress-nginx",
-	                                  "-o=json",
-	                                  "--kubeconfig",configPath});
-
-		if (result.status != 0) {
-			throw std::runtime_error("kubectl failed: " + result.error);
-		}
-		
-		json.Parse(result.output.c_str());
-
-		if (!json.HasMember("items") || !json["items"].IsArray()) {
-			throw std::runtime_error("Malformed JSON from kubectl");
+	bool foundOld=false;
+	for(const auto& deployment : deployments->items.GetArray()){
+		std::string installedVersion=getKubeLabel(deployment,"slate-ingress-version");
+		if(installedVersion.empty()){
+			//look for a version too old to have the version label
+			if(getKubeLabel(deployment,"app.kubernetes.io/name")=="ingress-nginx")
+				foundOld=true;
+			continue;
 		}
-		if (json["items"].Size() == 0) { //if still nothing, the controller is not installed
-			return ClusterComponent::NotInstalled;
-		} else {
-			//otherwise we know it's old
-			return ClusterComponent::OutOfDate;
-		}
-	}
-	
-	//TODO: find and compare version
-	if (!json["items"][0].IsObject() || !json["items"][0].HasMember("metadata") ||
-	    !json["items"][0]["metadata"].IsObject()) {
-		throw std::runtime_error("Malformed JSON from kubectl");
-	}
-	
-	if(json["items"][0]["metadata"].HasMember("labels") && json["items"][0]["metadata"].IsObject() &&
-	  json["items"][0]["metadata"]["labels"].HasMember("slate-ingress-version")){
-		std::string installedVersion=json["items"][0]["metadata"]["labels"]["slate-ingress-version"].GetString();
 		int verComp=compareVersions(installedVersion,ingressControllerVersion);
 		switch(verComp){
 			case -1:
@@ -771,14 +740,9 @@ Client::ClusterComponent::ComponentStatus Client::checkIngressController(const s
 				throw std::runtime_error("Internal error: invalid version comparison result");
 		}
 	}
-	return ClusterComponent::OutOfDate;
-	
-	/*bool ready=result.output.find("Running")!=std::string::npos;
-	if(ready) //TODO: check version
-		return ClusterComponent::UpToDate;
-	if(!result.output.empty())
-		throw std::runtime_error("SLATE ingress controller is installed but in an unexpected state: "+result.output);
-	return ClusterComponent::NotInstalled;*/
+	if(foundOld)
+		return ClusterComponent::OutOfDate;
+	return ClusterComponent::NotInstalled;
 }
 
 void Client::installIngressController(const std::string &configPath, const std::string &systemNamespace) const {
@@ -843,6 +807,7 @@ void Client::installIngressController(const std::string &configPath, const std::
 		ingressControllerConfig.replace(pos, componentVersionPlaceholder.size(), ingressControllerVersion);
 	}
 	auto result=runCommandWithInput("kubectl",ingressControllerConfig,{"apply","--kubeconfig",configPath,"-f","-"});
+	kubeResources.invalidate(configPath);
 	if (result.status) {
 		throw std::runtime_error("Failed to install ingress controller: " + result.error);
 	}
@@ -883,6 +848,7 @@ void Client::installIngressController(const std::string &configPath, const std::
 		ingressControllerConfig.replace(pos, componentVersionPlaceholder.size(), ingressControllerVersion);
 	}
 	auto result=runCommandWithInput("kubectl",ingressControllerConfig,{"apply","--kubeconfig",configPath,"-f","-"});
+	kubeResources.invalidate(configPath);
 	if (result.status) {
 		throw std::runtime_error("Failed to install ingress controller: " + result.error);
 	}
@@ -901,6 +867,7 @@ void Client::removeIngressController(const std::string& configPath, const std::s
 		deleteArgs.push_back(object.first + "/" + object.second);
 	}
 	auto result=runCommand("kubectl",deleteArgs);
+	kubeResources.invalidate(configPath);
 	if (result.status != 0) {
 		throw std::runtime_error("Failed to remove ingress controller: " + result.error);
 	}
@@ -694,6 +694,15 @@ void registerUserCommands(CLI::App& parent, Client& client) {
 	registerUserUpdateToken(*usrcmd, client);
 }
 
+void registerBatchCommand(CLI::App& parent, Client& client){
+	auto batchOpt = std::make_shared<BatchOptions>();
+	auto batch = parent.add_subcommand("batch", "Run many commands, read one per line, "
+	                                   "using as few requests to the API server as possible");
+	batch->add_option("command-file", batchOpt->commandFile, "The file from which to read "
+	                  "commands, or - to read from standard input", true);
+	batch->callback([&client,batchOpt](){ client.runBatch(*batchOpt); });
+}
+
 void registerCommonOptions(CLI::App& parent, Client& client){
 	parent.add_option("--orderBy", client.orderBy, "the name of a column in the JSON output"
 			"by which to order the table printed to stdout.");
@@ -718,6 +727,10 @@ void registerCommonOptions(CLI::App& parent, Client& client){
 	                  "presented to the SLATE API server")
 	                 ->envname("SLATE_CRED_PATH")
 	                 ->type_name("PATH");
+	parent.add_flag_function("--no-cache",
+	                         [&](std::size_t){ client.useCache=false; },
+	                         "Do not use or update the local cache of responses "
+	                         "from the SLATE API server");
 	parent.add_option("--output",client.outputFormat,
 			  "The format in which to print output (can be specified as no-headers, json, jsonpointer, jsonpointer-file, custom-columns, or custom-columns-file)");
 #ifdef USE_CURLOPT_CAINFO
@@ -763,6 +776,7 @@ int main(int argc, char* argv[]){
 		registerInstanceCommands(slate,client);
 		registerSecretCommands(slate,client);
 		registerVolumeCommands(slate,client);
+		registerBatchCommand(slate,client);
 		registerCommonOptions(slate,client);
 		registerWhoAmI(slate,client);
 		registerUserCommands(slate,client);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cerrno>
 #include <iostream>
 #include <cctype>
@@ -7,17 +8,23 @@
 #define CROW_ENABLE_SSL
 #include <crow.h>
 
+#include "BlockingExecutor.h"
 #include "Entities.h"
 #include "Logging.h"
 #include "PersistentStore.h"
 #include "Process.h"
+#include "ServerTLS.h"
 #include "ServerUtilities.h"
+#include "StoreStreamListener.h"
 #include "Telemetry.h"
 
 #include "ApplicationCommands.h"
 #include "ApplicationInstanceCommands.h"
+#include "ChangeFeedCommands.h"
+#include "EventStream.h"
 #include "ClusterCommands.h"
 #include "GroupCommands.h"
+#include "LogLevelCommands.h"
 #include "MonitoringCredentialCommands.h"
 #include "UserCommands.h"
 #include "SecretCommands.h"
@@ -171,19 +178,30 @@ struct Configuration{
 	std::string awsRegion;
 	std::string awsURLScheme;
 	std::string awsEndpoint;
+	std::string route53Endpoint;
+	std::string storageBackend;
+	std::string storageDirectory;
 	std::string geocodeEndpoint;
 	std::string geocodeToken;
 	std::string portString;
 	std::string sslCertificate;
 	std::string sslKey;
+	std::string sslTicketKeyFile;
+	unsigned int sslSessionCacheSize;
+	unsigned int sslSessionTimeout;
+	unsigned int keepAliveTimeout;
+	unsigned int maxRequestsPerConnection;
 	std::string bootstrapUserFile;
 	std::string encryptionKeyFile;
 	std::string appLoggingServerName;
 	std::string appLoggingServerPortString;
 	bool allowAdHocApps;
+	bool followDatabaseStreams;
 	std::string mailgunEndpoint;
 	std::string mailgunKey;
 	std::string emailDomain;
+	std::string emailSpoolDirectory;
+	unsigned int emailQueueLimit;
 	std::string opsEmail;
 	std::string baseDomain;
 	std::string helmStableRepo;
@@ -193,7 +211,13 @@ struct Configuration{
 	bool disableTelemetrySampling;
 	std::string serverInstance;
 	std::string serverEnvironment;
+	std::string logLevel;
+	std::string logFormat;
 	unsigned int serverThreads;
+	unsigned int blockingThreads;
+	unsigned int blockingQueueLimit;
+	unsigned int commandTimeout;
+	unsigned int commandOutputLimit;
 	
 	std::map<std::string,ParamRef> options;
 	
@@ -203,14 +227,17 @@ struct Configuration{
 	awsRegion("us-east-1"),
 	awsURLScheme("http"),
 	awsEndpoint("localhost:8000"),
+	storageBackend("dynamodb"),
 	geocodeEndpoint("https://geocode.xyz"),
 	portString("18080"),
 	bootstrapUserFile("slate_portal_user"),
 	encryptionKeyFile("encryptionKey"),
 	appLoggingServerPortString("9200"),
 	allowAdHocApps(false),
+	followDatabaseStreams(false),
 	mailgunEndpoint("api.mailgun.net"),
 	emailDomain("slateci.io"),
+	emailQueueLimit(1000),
 	opsEmail("slateci-ops@googlegroups.com"),
 	helmStableRepo("https://slateci.io/slate-catalog-stable/"),
 	helmIncubatorRepo("https://slateci.io/slate-catalog-incubator/"),
@@ -219,14 +246,27 @@ struct Configuration{
 	disableTelemetrySampling(false),
 	serverInstance("SlateAPIServer-1"),
 	serverEnvironment("dev"),
+	logLevel("info"),
+	logFormat("text"),
 	baseDomain("slateci.net"),
 	serverThreads(0),
+	blockingThreads(0),
+	blockingQueueLimit(1024),
+	commandTimeout(300),
+	commandOutputLimit(64U<<20),
+	sslSessionCacheSize(20480),
+	sslSessionTimeout(7200),
+	keepAliveTimeout(5),
+	maxRequestsPerConnection(0),
 	options{
 		{"awsAccessKey",awsAccessKey},
 		{"awsSecretKey",awsSecretKey},
 		{"awsRegion",awsRegion},
 		{"awsURLScheme",awsURLScheme},
 		{"awsEndpoint",awsEndpoint},
+		{"route53Endpoint",route53Endpoint},
+		{"storageBackend",storageBackend},
+		{"storageDirectory",storageDirectory},
 		{"baseDomain", baseDomain},
 		{"helmStableRepo", helmStableRepo},
 		{"helmIncubatorRepo", helmIncubatorRepo},
@@ -235,21 +275,35 @@ struct Configuration{
 		{"disableSampling", disableTelemetrySampling},
 		{"serverInstance", serverInstance},
 		{"serverEnvironment", serverEnvironment},
+		{"logLevel",logLevel},
+		{"logFormat",logFormat},
 		{"geocodeEndpoint",geocodeEndpoint},
 		{"geocodeToken",geocodeToken},
 		{"port",portString},
 		{"sslCertificate",sslCertificate},
 		{"sslKey",sslKey},
+		{"sslTicketKeyFile",sslTicketKeyFile},
+		{"sslSessionCacheSize",sslSessionCacheSize},
+		{"sslSessionTimeout",sslSessionTimeout},
+		{"keepAliveTimeout",keepAliveTimeout},
+		{"maxRequestsPerConnection",maxRequestsPerConnection},
 		{"bootstrapUserFile",bootstrapUserFile},
 		{"encryptionKeyFile",encryptionKeyFile},
 		{"appLoggingServerName",appLoggingServerName},
 		{"appLoggingServerPort",appLoggingServerPortString},
 		{"allowAdHocApps",allowAdHocApps},
+		{"followDatabaseStreams",followDatabaseStreams},
 		{"mailgunEndpoint",mailgunEndpoint},
 		{"mailgunKey",mailgunKey},
 		{"emailDomain",emailDomain},
+		{"emailSpoolDirectory",emailSpoolDirectory},
+		{"emailQueueLimit",emailQueueLimit},
 		{"opsEmail",opsEmail},
-		{"threads",serverThreads}
+		{"threads",serverThreads},
+		{"blockingThreads",blockingThreads},
+		{"blockingQueueLimit",blockingQueueLimit},
+		{"commandTimeout",commandTimeout},
+		{"commandOutputLimit",commandOutputLimit}
 	}
 	{
 		//check for environment variables
@@ -445,6 +499,34 @@ crow::response multiplex(crow::SimpleApp& server, PersistentStore& store, const
 	return crow::response(to_string(result));
 }
 
+///Serve a request whose response is determined by data in the persistent store, 
+///replying with 304 Not Modified without running the handler if the client 
+///already has the current version of the response
+///\param computeETag a callable which produces the entity tag for the current 
+///                   response, or an empty string if it cannot be determined
+///\param handler a callable which produces the full response
+template<typename TagFunc, typename Handler>
+crow::response conditionalGet(PersistentStore& store, const crow::request& req, 
+                              TagFunc computeETag, Handler handler){
+	//let the handler reject unauthenticated requests in the usual way
+	if(!authenticateUser(store, req.url_params.get("token")))
+		return handler();
+	//The tag must be computed before the handler runs, so that a concurrent 
+	//modification can only make the response newer than its tag
+	const std::string etag=computeETag();
+	if(etag.empty())
+		return handler();
+	if(matchesETag(req, etag)){
+		crow::response response(304);
+		response.set_header("ETag", etag);
+		return response;
+	}
+	crow::response response=handler();
+	if(response.code==200)
+		response.set_header("ETag", etag);
+	return response;
+}
+
 int main(int argc, char* argv[]){
 	// Needed to work on gke since the load balancer occasionally
 	// closes TCP connections in a way that results in the rocky 9
@@ -453,6 +535,17 @@ int main(int argc, char* argv[]){
 	signal(SIGPIPE, SIG_IGN);
 
 	Configuration config(argc, argv);
+	
+	try{
+		setLogLevel(parseLogLevel(config.logLevel));
+	}catch(std::runtime_error& err){
+		log_fatal(err.what());
+	}
+	if(config.logFormat=="json")
+		setLogFormat(LogFormat::JSON);
+	else if(config.logFormat!="text")
+		log_fatal("Unrecognized log format: '" << config.logFormat << "'");
+	setLogTraceSource(&currentTraceID);
 
 	// setup opentelemetry
 	std::string endpoint = "http://localhost:4317/v1/traces";
@@ -481,7 +574,18 @@ int main(int argc, char* argv[]){
 		          " must be specified together");
 	}
 	
-	log_info("Database URL is " << config.awsURLScheme << "://" << config.awsEndpoint);
+	if(config.storageBackend=="dynamodb")
+		log_info("Database URL is " << config.awsURLScheme << "://" << config.awsEndpoint);
+	else if(config.storageBackend=="embedded"){
+		if(config.storageDirectory.empty())
+			log_warn("No --storageDirectory ($SLATE_storageDirectory) specified; data will not be persisted");
+		else
+			log_info("Storing data in " << config.storageDirectory);
+		if(config.followDatabaseStreams)
+			log_fatal("--followDatabaseStreams cannot be used with the embedded storage backend");
+	}
+	else
+		log_fatal("Unrecognized storage backend: '" << config.storageBackend << "'");
 	unsigned int port=0;
 	{
 		std::istringstream is(config.portString);
@@ -506,6 +610,15 @@ int main(int argc, char* argv[]){
 		config.serverThreads = std::thread::hardware_concurrency();
 	}
 	log_info("Using " << config.serverThreads << " web server threads");
+	//Most blocking work is waiting on other processes and remote servers, so
+	//many more of these threads than cores are useful
+	if (config.blockingThreads == 0) {
+		config.blockingThreads = 4*config.serverThreads;
+	}
+	log_info("Using " << config.blockingThreads << " threads for cluster operations");
+	//a value of zero for either limit disables it
+	kubernetes::setCommandLimits(commandLimits(std::chrono::seconds(config.commandTimeout),
+	                                           config.commandOutputLimit));
 	startReaper();
 	initializeHelm(config.helmStableRepo, config.helmIncubatorRepo);
 	// DB client initialization
@@ -531,17 +644,46 @@ int main(int argc, char* argv[]){
 
 	EmailClient emailClient(config.mailgunEndpoint,config.mailgunKey,config.emailDomain);
 
-	PersistentStore store(credentials, clientConfig,
+	//When changes from other replicas are applied from the database streams, 
+	//cached records remain accurate and can be kept much longer
+	const unsigned int cacheValidityFactor=(config.followDatabaseStreams ? 12 : 1);
+	std::unique_ptr<StorageBackend> storage;
+	try{
+		storage=makeStorageBackend(config.storageBackend, credentials, clientConfig,
+		                           config.storageDirectory);
+	}catch(std::runtime_error& err){
+		log_fatal("Unable to initialize storage: " << err.what());
+	}
+	PersistentStore store(std::move(storage), credentials, clientConfig,
 	                      config.bootstrapUserFile, config.encryptionKeyFile,
 			      config.appLoggingServerName, appLoggingServerPort,
 			      config.baseDomain,
-			      getTracer());
+			      getTracer(),
+			      cacheValidityFactor,
+			      config.route53Endpoint);
 	log_info("Initialized PersistentStore");
+	std::unique_ptr<StoreStreamListener> streamListener;
+	if(config.followDatabaseStreams){
+		try{
+			streamListener.reset(new StoreStreamListener(store, credentials, clientConfig));
+		}catch(std::runtime_error& err){
+			//the cache validities assume that streams are followed
+			log_fatal("Unable to follow database streams: " << err.what());
+		}
+	}
+	//Generation numbers, and so entity tags, reflect every change only when 
+	//other replicas' changes arrive through the streams, or when the embedded 
+	//backend guarantees that there are no other replicas
+	store.setGenerationsComplete(config.followDatabaseStreams || config.storageBackend=="embedded");
 	if (!config.geocodeEndpoint.empty() && !config.geocodeToken.empty()) {
 		store.setGeocoder(Geocoder(config.geocodeEndpoint, config.geocodeToken));
 	}
 	if(!config.mailgunEndpoint.empty() && !config.mailgunKey.empty() && !config.emailDomain.empty()){
-		store.setEmailClient(EmailClient(config.mailgunEndpoint,config.mailgunKey,config.emailDomain));
+		EmailQueue::Options emailOptions;
+		emailOptions.spoolDirectory=config.emailSpoolDirectory;
+		emailOptions.maxQueued=config.emailQueueLimit;
+		store.setEmailClient(EmailClient(config.mailgunEndpoint,config.mailgunKey,config.emailDomain),
+		                     emailOptions);
 		log_info("Email notifications configured");
 	} else {
 		log_info("Email notifications not configured");
@@ -549,11 +691,53 @@ int main(int argc, char* argv[]){
 	store.setOpsEmail(config.opsEmail);
 	log_info("Completed setup, starting REST server");
 
+	EventStream eventStream(store);
+	
+	//Requests which contact clusters, or run helm, may take a long time, so 
+	//they are run separately from the web server's threads, queued by the 
+	//cluster they involve so that a few unresponsive clusters cannot take 
+	//every thread.
+	BlockingExecutor blockingWork(config.blockingThreads, config.blockingQueueLimit,
+	                              std::max(1u,config.blockingThreads/4),
+	                              std::max(1u,config.blockingThreads/2));
+	//These find the cluster to which a request relates; if the object does not
+	//exist the result is empty and the handler reports the problem
+	auto clusterKey=[&](const std::string& cID){ return store.getCluster(cID).id; };
+	auto instanceKey=[&](const std::string& iID){ return store.getApplicationInstance(iID).cluster; };
+	auto secretKey=[&](const std::string& sID){ return store.getSecret(sID).cluster; };
+	auto volumeKey=[&](const std::string& vID){ return store.getPersistentVolumeClaim(vID).cluster; };
+	//This finds the cluster named in the body of a request which creates
+	//something on a cluster, optionally within a section of the body
+	auto bodyClusterKey=[&](const crow::request& req, const char* section)->std::string{
+		rapidjson::Document body;
+		try{
+			body.Parse(req.body.c_str());
+		}catch(std::runtime_error& err){
+			return "";
+		}
+		if(body.HasParseError() || !body.IsObject())
+			return "";
+		const rapidjson::Value* container=&body;
+		if(section){
+			if(!body.HasMember(section) || !body[section].IsObject())
+				return "";
+			container=&body[section];
+		}
+		if(!container->HasMember("cluster") || !(*container)["cluster"].IsString())
+			return "";
+		return store.getCluster((*container)["cluster"].GetString()).id;
+	};
+	//Work which involves no single cluster is queued by the user requesting 
+	//it, or the group it affects, so that one user cannot take every thread
+	auto callerKey=[&](const crow::request& req){ return authenticateUser(store,req.url_params.get("token")).id; };
+	auto groupKey=[&](const std::string& groupID){ return store.getGroup(groupID).id; };
+	
 	// REST server initialization
 	crow::SimpleApp server;
 	
 	CROW_ROUTE(server, "/v1alpha3/multiplex").methods("POST"_method)(
-	  [&](const crow::request& req){ return multiplex(server,store,req); });
+	  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch(callerKey(req),req,res,[&]{ return multiplex(server,store,req); }); });
 	
 	// == User commands ==
 	CROW_ROUTE(server, "/v1alpha3/users").methods("GET"_method)(
@@ -581,19 +765,27 @@ int main(int argc, char* argv[]){
 	
 	// == Cluster commands ==
 	CROW_ROUTE(server, "/v1alpha3/clusters").methods("GET"_method)(
-	  [&](const crow::request& req){ return listClusters(store,req); });
+	  [&](const crow::request& req){ 
+		  return conditionalGet(store,req,[&]{ return listClustersETag(store,req); },
+		                        [&]{ return listClusters(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters").methods("POST"_method)(
-	  [&](const crow::request& req){ return createCluster(store,req); });
+	  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch(callerKey(req),req,res,[&]{ return createCluster(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& cID){ return getClusterInfo(store,req,cID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& cID){
+		  blockingWork.dispatch(clusterKey(cID),req,res,[&,cID]{ return getClusterInfo(store,req,cID); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>").methods("DELETE"_method)(
-	  [&](const crow::request& req, const std::string& cID){ return deleteCluster(store,req,cID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& cID){
+		  blockingWork.dispatch(clusterKey(cID),req,res,[&,cID]{ return deleteCluster(store,req,cID); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>").methods("PUT"_method)(
-	  [&](const crow::request& req, const std::string& cID){ return updateCluster(store,req,cID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& cID){
+		  blockingWork.dispatch(clusterKey(cID),req,res,[&,cID]{ return updateCluster(store,req,cID); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>/ping").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& cID){ return pingCluster(store,req,cID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& cID){
+		  blockingWork.dispatch(clusterKey(cID),req,res,[&,cID]{ return pingCluster(store,req,cID); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>/verify").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& cID){ return verifyCluster(store,req,cID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& cID){
+		  blockingWork.dispatch(clusterKey(cID),req,res,[&,cID]{ return verifyCluster(store,req,cID); }); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>/allowed_groups").methods("GET"_method)(
 	  [&](const crow::request& req, const std::string& cID){ return listClusterAllowedgroups(store,req,cID); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>/allowed_groups/<string>").methods("GET"_method)(
@@ -620,7 +812,8 @@ int main(int argc, char* argv[]){
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>/monitoring_credential").methods("GET"_method)(
 	  [&](const crow::request& req, const std::string& cID){ return getClusterMonitoringCredential(store,req,cID); });
 	CROW_ROUTE(server, "/v1alpha3/clusters/<string>/monitoring_credential").methods("DELETE"_method)(
-	  [&](const crow::request& req, const std::string& cID){ return removeClusterMonitoringCredential(store,req,cID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& cID){
+		  blockingWork.dispatch(clusterKey(cID),req,res,[&,cID]{ return removeClusterMonitoringCredential(store,req,cID); }); });
 	
 	// == Monitoring Credential commands ==
 	CROW_ROUTE(server, "/v1alpha3/monitoring_credentials").methods("GET"_method)(
@@ -634,15 +827,20 @@ int main(int argc, char* argv[]){
 	
 	// == Group commands ==
 	CROW_ROUTE(server, "/v1alpha3/groups").methods("GET"_method)(
-	  [&](const crow::request& req){ return listGroups(store,req); });
+	  [&](const crow::request& req){ 
+		  return conditionalGet(store,req,[&]{ return listGroupsETag(store,req); },
+		                        [&]{ return listGroups(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/groups").methods("POST"_method)(
 	  [&](const crow::request& req){ return createGroup(store,req); });
 	CROW_ROUTE(server, "/v1alpha3/groups/<string>").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& groupID){ return getGroupInfo(store,req,groupID); });
+	  [&](const crow::request& req, const std::string& groupID){ 
+		  return conditionalGet(store,req,[&]{ return getGroupInfoETag(store,req,groupID); },
+		                        [&]{ return getGroupInfo(store,req,groupID); }); });
 	CROW_ROUTE(server, "/v1alpha3/groups/<string>").methods("PUT"_method)(
 	  [&](const crow::request& req, const std::string& groupID){ return updateGroup(store,req,groupID); });
 	CROW_ROUTE(server, "/v1alpha3/groups/<string>").methods("DELETE"_method)(
-	  [&](const crow::request& req, const std::string& groupID){ return deleteGroup(store,req,groupID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& groupID){
+		  blockingWork.dispatch(groupKey(groupID),req,res,[&,groupID]{ return deleteGroup(store,req,groupID); }); });
 	CROW_ROUTE(server, "/v1alpha3/groups/<string>/members").methods("GET"_method)(
 	  [&](const crow::request& req, const std::string& groupID){ return listGroupMembers(store,req,groupID); });
 	CROW_ROUTE(server, "/v1alpha3/groups/<string>/clusters").methods("GET"_method)(
@@ -650,66 +848,104 @@ int main(int argc, char* argv[]){
 	
 	// == Application commands ==
 	CROW_ROUTE(server, "/v1alpha3/apps").methods("GET"_method)(
-	  [&](const crow::request& req){ return listApplications(store,req); });
+	  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch("",req,res,[&]{ return listApplications(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/apps/<string>").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& aID){ return fetchApplicationConfig(store,req,aID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& aID){
+		  blockingWork.dispatch("",req,res,[&,aID]{ return fetchApplicationConfig(store,req,aID); }); });
 	CROW_ROUTE(server, "/v1alpha3/apps/<string>/info").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& aID){ return fetchApplicationDocumentation(store,req,aID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& aID){
+		  blockingWork.dispatch("",req,res,[&,aID]{ return fetchApplicationDocumentation(store,req,aID); }); });
 	CROW_ROUTE(server, "/v1alpha3/apps/<string>/versions").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& aID){ return fetchApplicationVersions(store,req,aID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& aID){
+		  blockingWork.dispatch("",req,res,[&,aID]{ return fetchApplicationVersions(store,req,aID); }); });
 	if(config.allowAdHocApps){
 		CROW_ROUTE(server, "/v1alpha3/apps/ad-hoc").methods("POST"_method)(
-		  [&](const crow::request& req){ return installAdHocApplication(store,req); });
+		  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch(bodyClusterKey(req,nullptr),req,res,[&]{ return installAdHocApplication(store,req); }); });
 	}
 	else{
 		CROW_ROUTE(server, "/v1alpha3/apps/ad-hoc").methods("POST"_method)(
 		  [&](const crow::request& req){ return crow::response(400,generateError("Ad-hoc application installation is not permitted")); });
 	}
 	CROW_ROUTE(server, "/v1alpha3/apps/<string>").methods("POST"_method)(
-	  [&](const crow::request& req, const std::string& aID){ return installApplication(store,req,aID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& aID){
+		  blockingWork.dispatch(bodyClusterKey(req,nullptr),req,res,[&,aID]{ return installApplication(store,req,aID); }); });
 	CROW_ROUTE(server, "/v1alpha3/update_apps").methods("POST"_method)(
-	  [&](const crow::request& req){ return updateCatalog(store,req); });
+	  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch("",req,res,[&]{ return updateCatalog(store,req); }); });
 	
 	// == Application Instance commands ==
 	CROW_ROUTE(server, "/v1alpha3/instances").methods("GET"_method)(
-	  [&](const crow::request& req){ return listApplicationInstances(store,req); });
+	  [&](const crow::request& req){ 
+		  return conditionalGet(store,req,[&]{ return listApplicationInstancesETag(store,req); },
+		                        [&]{ return listApplicationInstances(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return fetchApplicationInstanceInfo(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return fetchApplicationInstanceInfo(store,req,iID); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>").methods("DELETE"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return deleteApplicationInstance(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return deleteApplicationInstance(store,req,iID); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>/restart").methods("PUT"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return restartApplicationInstance(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return restartApplicationInstance(store,req,iID); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>/logs").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return getApplicationInstanceLogs(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return getApplicationInstanceLogs(store,req,iID); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>/scale").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return getApplicationInstanceScale(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return getApplicationInstanceScale(store,req,iID); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>/scale").methods("PUT"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return scaleApplicationInstance(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return scaleApplicationInstance(store,req,iID); }); });
 	CROW_ROUTE(server, "/v1alpha3/instances/<string>/update").methods("PUT"_method)(
-	  [&](const crow::request& req, const std::string& iID){ return updateApplicationInstance(store,req,iID); });
+	  [&](const crow::request& req, crow::response& res, const std::string& iID){
+		  blockingWork.dispatch(instanceKey(iID),req,res,[&,iID]{ return updateApplicationInstance(store,req,iID); }); });
 	
 	// == Secret commands ==
 	CROW_ROUTE(server, "/v1alpha3/secrets").methods("GET"_method)(
-	  [&](const crow::request& req){ return listSecrets(store,req); });
+	  [&](const crow::request& req){ 
+		  return conditionalGet(store,req,[&]{ return listSecretsETag(store,req); },
+		                        [&]{ return listSecrets(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/secrets").methods("POST"_method)(
-	  [&](const crow::request& req){ return createSecret(store,req); });
+	  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch(bodyClusterKey(req,"metadata"),req,res,[&]{ return createSecret(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/secrets/<string>").methods("GET"_method)(
 	  [&](const crow::request& req, const std::string& id){ return getSecret(store,req,id); });
 	CROW_ROUTE(server, "/v1alpha3/secrets/<string>").methods("DELETE"_method)(
-	  [&](const crow::request& req, const std::string& id){ return deleteSecret(store,req,id); });
+	  [&](const crow::request& req, crow::response& res, const std::string& id){
+		  blockingWork.dispatch(secretKey(id),req,res,[&,id]{ return deleteSecret(store,req,id); }); });
+	
+	// == Change feed ==
+	CROW_ROUTE(server, "/v1alpha3/changes").methods("GET"_method)(
+	  [&](const crow::request& req){ return listChanges(store,req,std::max(1u,config.serverThreads/4)); });
+	CROW_ROUTE(server, "/v1alpha3/events").websocket()
+	  .onaccept([&](const crow::request& req){ return eventStream.accept(req); })
+	  .onopen([&](crow::websocket::connection& conn){ eventStream.open(conn); })
+	  .onmessage([&](crow::websocket::connection& conn, const std::string& data, bool binary){
+	  	eventStream.message(conn,data,binary); })
+	  .onclose([&](crow::websocket::connection& conn, const std::string&){ eventStream.close(conn); });
 	
 	CROW_ROUTE(server, "/v1alpha3/stats").methods("GET"_method)(
-	  [&](){ return(store.getStatistics()); });
+	  [&](){ return(store.getStatistics()+getLogStatistics()+blockingWork.getStatistics()
+	                +getTLSStatistics()); });
+	CROW_ROUTE(server, "/v1alpha3/log_level").methods("GET"_method)(
+	  [&](const crow::request& req){ return fetchServerLogLevel(store,req); });
+	CROW_ROUTE(server, "/v1alpha3/log_level").methods("PUT"_method)(
+	  [&](const crow::request& req){ return updateServerLogLevel(store,req); });
 
 	// == Volume commands ==
 	CROW_ROUTE(server, "/v1alpha3/volumes").methods("GET"_method)(
 	  [&](const crow::request& req){ return listVolumeClaims(store,req); });
 	CROW_ROUTE(server, "/v1alpha3/volumes").methods("POST"_method)(
-	  [&](const crow::request& req){ return createVolumeClaim(store,req); });
+	  [&](const crow::request& req, crow::response& res){
+		  blockingWork.dispatch(bodyClusterKey(req,"metadata"),req,res,[&]{ return createVolumeClaim(store,req); }); });
 	CROW_ROUTE(server, "/v1alpha3/volumes/<string>").methods("GET"_method)(
-	  [&](const crow::request& req, const std::string& id){ return fetchVolumeClaimInfo(store,req,id); });
+	  [&](const crow::request& req, crow::response& res, const std::string& id){
+		  blockingWork.dispatch(volumeKey(id),req,res,[&,id]{ return fetchVolumeClaimInfo(store,req,id); }); });
 	CROW_ROUTE(server, "/v1alpha3/volumes/<string>").methods("DELETE"_method)(
-	  [&](const crow::request& req, const std::string& id){ return deleteVolumeClaim(store,req,id); });
+	  [&](const crow::request& req, crow::response& res, const std::string& id){
+		  blockingWork.dispatch(volumeKey(id),req,res,[&,id]{ return deleteVolumeClaim(store,req,id); }); });
 	
 	CROW_ROUTE(server, "/version").methods("GET"_method)(&serverVersionInfo);
 	
@@ -719,9 +955,21 @@ int main(int argc, char* argv[]){
 	  	return crow::response(400,generateError("Unsupported API version")); });
 	
 	server.loglevel(crow::LogLevel::Warning);
+	server.timeout(config.keepAliveTimeout)
+	      .max_requests_per_connection(config.maxRequestsPerConnection);
 	if (!config.sslCertificate.empty()) {
-		server.port(port).ssl_file(config.sslCertificate, config.sslKey).concurrency(
-			config.serverThreads).run();
+		TLSSettings tlsSettings;
+		tlsSettings.certificateFile=config.sslCertificate;
+		tlsSettings.keyFile=config.sslKey;
+		tlsSettings.ticketKeyFile=config.sslTicketKeyFile;
+		tlsSettings.sessionCacheSize=config.sslSessionCacheSize;
+		tlsSettings.sessionTimeout=config.sslSessionTimeout;
+		try{
+			server.ssl(makeServerTLSContext(tlsSettings));
+		}catch(std::runtime_error& err){
+			log_fatal(err.what());
+		}
+		server.port(port).concurrency(config.serverThreads).run();
 	} else {
 		server.port(port).concurrency(config.serverThreads).run();
 	}
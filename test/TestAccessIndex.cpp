@@ -0,0 +1,70 @@
+#include "test.h"
+
+#include <algorithm>
+
+#include <AccessIndex.h>
+
+TEST(AccessIndexGroupAccess){
+	AccessIndex index("*","<all>");
+	ENSURE(!index.groupHasAccess("cluster_1","group_1"),"Unknown clusters should not allow any group");
+
+	index.setGroupAccess("cluster_1","group_1",true);
+	index.setGroupAccess("cluster_2","group_2",true);
+	ENSURE(index.groupHasAccess("cluster_1","group_1"));
+	ENSURE(!index.groupHasAccess("cluster_1","group_2"),"Access to one cluster should not grant access to another");
+	ENSURE(index.groupHasAccess("cluster_2","group_2"));
+	ENSURE(!index.allowsAllGroups("cluster_1"));
+
+	index.setGroupAccess("cluster_1","group_1",false);
+	ENSURE(!index.groupHasAccess("cluster_1","group_1"),"Revoked access should not remain");
+	index.setGroupAccess("cluster_3","group_3",false);
+	ENSURE(!index.groupHasAccess("cluster_3","group_3"));
+}
+
+TEST(AccessIndexWildcard){
+	AccessIndex index("*","<all>");
+	index.setGroupAccess("cluster_1","*",true);
+	ENSURE(index.allowsAllGroups("cluster_1"));
+	ENSURE(index.groupHasAccess("cluster_1","group_1"),"A wildcard should grant access to every group");
+	ENSURE(index.groupsWithAccess("cluster_1").empty(),"The wildcard should not be listed as a group");
+	ENSURE(!index.allowsAllGroups("cluster_2"));
+
+	index.setGroupAccess("cluster_1","*",false);
+	ENSURE(!index.groupHasAccess("cluster_1","group_1"));
+}
+
+TEST(AccessIndexManyGroups){
+	AccessIndex index("*","<all>");
+	const unsigned int nGroups=200;
+	//grant access to every third group
+	for(unsigned int i=0; i<nGroups; i++)
+		index.setGroupAccess("cluster_1","group_"+std::to_string(i),i%3==0);
+	for(unsigned int i=0; i<nGroups; i++)
+		ENSURE_EQUAL(index.groupHasAccess("cluster_1","group_"+std::to_string(i)),i%3==0);
+
+	auto groups=index.groupsWithAccess("cluster_1");
+	ENSURE_EQUAL(groups.size(),(nGroups+2)/3);
+	ENSURE(std::is_sorted(groups.begin(),groups.end()),"Groups should be listed in order");
+	ENSURE_EQUAL(index.groupCount(),nGroups);
+	ENSURE_EQUAL(index.clusterCount(),1);
+}
+
+TEST(AccessIndexApplications){
+	AccessIndex index("*","<all>");
+	ENSURE(index.applications("cluster_1","group_1")==std::set<std::string>{"<all>"},
+	       "With no record all applications should be allowed");
+	ENSURE(index.applicationAllowed("cluster_1","group_1","nginx"));
+
+	index.setApplications("cluster_1","group_1",{"nginx","osg-frontier-squid"});
+	ENSURE(index.applicationAllowed("cluster_1","group_1","nginx"));
+	ENSURE(!index.applicationAllowed("cluster_1","group_1","jupyterhub"));
+	ENSURE(index.applicationAllowed("cluster_1","group_2","jupyterhub"),
+	       "Permissions for one group should not affect another");
+
+	index.setApplications("cluster_1","group_1",{});
+	ENSURE(index.applications("cluster_1","group_1").empty());
+	ENSURE(!index.applicationAllowed("cluster_1","group_1","nginx"));
+
+	index.setApplications("cluster_1","group_1",{"<all>"});
+	ENSURE(index.applicationAllowed("cluster_1","group_1","jupyterhub"));
+}
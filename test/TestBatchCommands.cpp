@@ -0,0 +1,144 @@
+#include "test.h"
+
+#include <stdexcept>
+
+#include <client/BatchCommands.h>
+
+namespace{
+	std::string resolveInstance(const std::string& name){
+		if(name=="missing")
+			throw std::runtime_error("No instance found with name "+name);
+		return "instance_"+name;
+	}
+
+	BatchRequest parse(const std::string& line){
+		return parseBatchCommand(splitCommandLine(line),&resolveInstance);
+	}
+
+	std::vector<BatchRequest> parseAll(const std::vector<std::string>& lines){
+		std::vector<BatchRequest> requests;
+		for(const auto& line : lines)
+			requests.push_back(parse(line));
+		return requests;
+	}
+
+	///\return the sizes of the bundles into which requests are divided
+	std::vector<std::size_t> bundleSizes(const std::vector<BatchRequest>& requests,
+	                                     std::size_t maxBundleSize=32){
+		std::vector<std::size_t> sizes;
+		for(std::size_t start=0, end=0; start<requests.size(); start=end){
+			end=batchBundleEnd(requests,start,maxBundleSize);
+			sizes.push_back(end-start);
+		}
+		return sizes;
+	}
+
+	bool rejected(const std::string& line){
+		try{
+			parse(line);
+		}catch(std::runtime_error&){
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST(SplitCommandLine){
+	auto words=splitCommandLine("cluster  info 'my cluster' \"a \\\"b\\\"\" c\\ d");
+	ENSURE_EQUAL(words.size(),5);
+	ENSURE_EQUAL(words[2],"my cluster");
+	ENSURE_EQUAL(words[3],"a \"b\"");
+	ENSURE_EQUAL(words[4],"c d");
+	ENSURE(splitCommandLine("   ").empty());
+	bool threw=false;
+	try{
+		splitCommandLine("group info 'unterminated");
+	}catch(std::runtime_error&){
+		threw=true;
+	}
+	ENSURE(threw,"An unterminated quotation should be rejected");
+}
+
+TEST(ParseBatchCommands){
+	BatchRequest info=parse("group info my-group");
+	ENSURE_EQUAL(info.method,"GET");
+	ENSURE_EQUAL(info.path,"groups/my-group");
+	ENSURE(info.objects==std::set<std::string>{"my-group"});
+	ENSURE(info.changes.empty(),"Reading a group should not change it");
+	ENSURE(!info.exclusive);
+
+	BatchRequest restart=parse("instance restart web");
+	ENSURE_EQUAL(restart.method,"PUT");
+	ENSURE_EQUAL(restart.path,"instances/instance_web/restart","Instance names should be resolved");
+	ENSURE(restart.changes==std::set<std::string>{"instance_web"});
+
+	BatchRequest del=parse("instance delete web --force");
+	ENSURE_EQUAL(del.method,"DELETE");
+	ENSURE_EQUAL(del.query,"&force");
+
+	BatchRequest groupDelete=parse("group delete my-group -y");
+	ENSURE_EQUAL(groupDelete.method,"DELETE");
+	ENSURE(groupDelete.exclusive,"Deleting a group may affect objects it does not name");
+
+	BatchRequest allow=parse("cluster allow-group my-cluster my-group");
+	ENSURE_EQUAL(allow.method,"PUT");
+	ENSURE_EQUAL(allow.path,"clusters/my-cluster/allowed_groups/my-group");
+
+	ENSURE(rejected("group"),"A command without a subcommand should be rejected");
+	ENSURE(rejected("group create my-group"),"Unsupported commands should be rejected");
+	ENSURE(rejected("group info"),"Missing arguments should be rejected");
+	ENSURE(rejected("group info my-group --force"),"--force should only be accepted for deletions");
+	ENSURE(rejected("group info my-group --cluster c"),"Unexpected options should be rejected");
+	ENSURE(rejected("instance info missing"),"Unresolvable instances should be rejected");
+}
+
+TEST(ParseBatchSecretCopy){
+	BatchRequest copy=parse("secret copy secret_source new-secret --group g --cluster c");
+	ENSURE_EQUAL(copy.method,"POST");
+	ENSURE_EQUAL(copy.path,"secrets");
+	ENSURE(copy.body.find("\"copyFrom\":\"secret_source\"")!=std::string::npos);
+	ENSURE(copy.body.find("\"name\":\"new-secret\"")!=std::string::npos);
+	ENSURE(copy.objects.count("secret_source"),"The source secret should be involved in a copy");
+	ENSURE(!copy.changes.count("secret_source"),"The source secret should not be changed by a copy");
+	ENSURE(copy.changes.count("new-secret"));
+	ENSURE(rejected("secret copy secret_source new-secret --group g"),
+	       "A copy without a cluster should be rejected");
+}
+
+TEST(BatchBundleConflicts){
+	//independent requests are sent together
+	auto sizes=bundleSizes(parseAll({"group info a","group info b","cluster info c"}));
+	ENSURE(sizes==std::vector<std::size_t>{3});
+
+	//reads of the same object do not conflict, but a change does
+	sizes=bundleSizes(parseAll({"secret info s","volume info s","secret delete s","secret info s"}));
+	ENSURE(sizes==(std::vector<std::size_t>{2,1,1}),
+	       "A change should wait for earlier reads of its object, and later reads for it");
+
+	//deleting the source of a copy must wait for the copy
+	sizes=bundleSizes(parseAll({"secret copy secret_1 copy --group g --cluster c",
+	                            "secret info secret_1",
+	                            "secret delete secret_1"}));
+	ENSURE(sizes==(std::vector<std::size_t>{2,1}),"Copying a secret should only read its source");
+
+	//a group deletion is always sent alone
+	sizes=bundleSizes(parseAll({"instance info web","group delete group_1","instance info web"}));
+	ENSURE(sizes==(std::vector<std::size_t>{1,1,1}),"A group deletion should not share a bundle");
+}
+
+TEST(BatchBundleDuplicateURLs){
+	//identical requests cannot share a multiplexed request
+	auto sizes=bundleSizes(parseAll({"group info a","group info a","group info a"}));
+	ENSURE(sizes==(std::vector<std::size_t>{1,1,1}),"Repeated requests should start new bundles");
+
+	//only the repeated request is held back
+	sizes=bundleSizes(parseAll({"group info a","cluster info c","group info a","cluster info d"}));
+	ENSURE(sizes==(std::vector<std::size_t>{2,2}));
+
+	//bundles are limited in size
+	std::vector<std::string> lines;
+	for(int i=0; i<5; i++)
+		lines.push_back("group info g"+std::to_string(i));
+	sizes=bundleSizes(parseAll(lines),2);
+	ENSURE(sizes==(std::vector<std::size_t>{2,2,1}));
+}
@@ -0,0 +1,89 @@
+#include "test.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+#include <BlockingExecutor.h>
+
+namespace{
+	///A task which waits until it is released
+	struct Gate{
+		std::promise<void> opened;
+		std::shared_future<void> signal;
+		Gate():signal(opened.get_future().share()){}
+		std::function<void()> task(std::atomic<int>& started){
+			std::shared_future<void> s=signal;
+			return [s,&started]{
+				started++;
+				s.wait();
+			};
+		}
+		void open(){ opened.set_value(); }
+	};
+
+	template<typename Predicate>
+	bool waitFor(Predicate pred){
+		auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+		while(!pred()){
+			if(std::chrono::steady_clock::now()>deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+}
+
+TEST(BlockingExecutorPerKeyLimit){
+	Gate gate;
+	std::atomic<int> slowStarted(0), fastDone(0);
+	{
+		BlockingExecutor executor(4,100,1,4);
+		for(int i=0; i<3; i++)
+			ENSURE(executor.submit("slow-cluster",gate.task(slowStarted)));
+		ENSURE(waitFor([&]{ return slowStarted.load()==1; }));
+		//work for other clusters must not be held up behind the slow one
+		for(int i=0; i<5; i++)
+			ENSURE(executor.submit("other-cluster",[&]{ fastDone++; }));
+		ENSURE(waitFor([&]{ return fastDone.load()==5; }),
+		       "Tasks for other keys should run while one key is at its limit");
+		ENSURE_EQUAL(slowStarted.load(),1,"Only one task per key should run at once");
+		ENSURE_EQUAL(executor.getQueueDepth(),2);
+		ENSURE_EQUAL(executor.getRunning(),1);
+		gate.open();
+	}
+	ENSURE_EQUAL(slowStarted.load(),3,"All queued tasks should run before the executor is destroyed");
+}
+
+TEST(BlockingExecutorUnkeyedTasks){
+	Gate gate;
+	std::atomic<int> started(0);
+	std::atomic<int> keyedDone(0);
+	BlockingExecutor executor(4,100,1,2);
+	for(int i=0; i<4; i++)
+		ENSURE(executor.submit("",gate.task(started)));
+	ENSURE(waitFor([&]{ return started.load()==2; }),
+	       "Tasks without a key should run up to their own limit");
+	for(int i=0; i<3; i++)
+		ENSURE(executor.submit("cluster",[&]{ keyedDone++; }));
+	ENSURE(waitFor([&]{ return keyedDone.load()==3; }),
+	       "Tasks without a key should not occupy every worker");
+	ENSURE_EQUAL(started.load(),2,"Tasks without a key should share their own limit");
+	gate.open();
+}
+
+TEST(BlockingExecutorRejection){
+	Gate gate;
+	std::atomic<int> started(0);
+	BlockingExecutor executor(1,2,1,1);
+	ENSURE(executor.submit("a",gate.task(started)));
+	ENSURE(waitFor([&]{ return started.load()==1; }));
+	ENSURE(executor.submit("a",gate.task(started)));
+	ENSURE(executor.submit("b",gate.task(started)));
+	ENSURE(!executor.submit("c",gate.task(started)),"Tasks beyond the queue limit should be rejected");
+	ENSURE_EQUAL(executor.getRejected(),1);
+	std::string stats=executor.getStatistics();
+	ENSURE(stats.find("Blocking tasks waiting: 2")!=std::string::npos);
+	ENSURE(stats.find("Blocking tasks rejected: 1")!=std::string::npos);
+	gate.open();
+}
@@ -0,0 +1,108 @@
+#include "test.h"
+
+#include <ServerUtilities.h>
+
+TEST(UnauthenticatedListChanges){
+	using namespace httpRequests;
+	TestContext tc;
+	
+	//try listing changes with no authentication
+	auto listResp=httpGet(tc.getAPIServerURL()+"/"+currentAPIVersion+"/changes");
+	ENSURE_EQUAL(listResp.status,403,
+				 "Requests to list changes without authentication should be rejected");
+	
+	//try listing changes with invalid authentication
+	listResp=httpGet(tc.getAPIServerURL()+"/"+currentAPIVersion+"/changes?token=00112233-4455-6677-8899-aabbccddeeff");
+	ENSURE_EQUAL(listResp.status,403,
+				 "Requests to list changes with invalid authentication should be rejected");
+}
+
+TEST(ListChanges){
+	using namespace httpRequests;
+	TestContext tc;
+
+	std::string adminKey=tc.getPortalToken();
+	std::string changeURL=tc.getAPIServerURL()+"/"+currentAPIVersion+"/changes?token="+adminKey;
+	auto schema=loadSchema(getSchemaDir()+"/ChangeListResultSchema.json");
+
+	auto listResp=httpGet(changeURL);
+	ENSURE_EQUAL(listResp.status,200,"Portal admin user should be able to list changes");
+	ENSURE(!listResp.body.empty());
+	rapidjson::Document data;
+	data.Parse(listResp.body.c_str());
+	ENSURE_CONFORMS(data,schema);
+	ENSURE(data["metadata"]["complete"].GetBool(),"All changes since server start should be available");
+	uint64_t revision=data["metadata"]["revision"].GetUint64();
+	std::string epoch=data["metadata"]["epoch"].GetString();
+	
+	//add a group
+	rapidjson::Document request1(rapidjson::kObjectType);
+	{
+		auto& alloc = request1.GetAllocator();
+		request1.AddMember("apiVersion", currentAPIVersion, alloc);
+		rapidjson::Value metadata(rapidjson::kObjectType);
+		metadata.AddMember("name", "testgroup1", alloc);
+		metadata.AddMember("scienceField", "Logic", alloc);
+		request1.AddMember("metadata", metadata, alloc);
+	}
+	auto createResp1=httpPost(tc.getAPIServerURL()+"/"+currentAPIVersion+"/groups?token="+adminKey,to_string(request1));
+	ENSURE_EQUAL(createResp1.status,200,"Portal admin user should be able to create a Group");
+	rapidjson::Document respData;
+	respData.Parse(createResp1.body.c_str());
+	std::string groupID=respData["metadata"]["id"].GetString();
+	
+	//list changes since the previous revision
+	listResp=httpGet(changeURL+"&since="+std::to_string(revision)+"&epoch="+epoch);
+	ENSURE_EQUAL(listResp.status,200,"Portal admin user should be able to list changes");
+	ENSURE(!listResp.body.empty());
+	data.Parse(listResp.body.c_str());
+	ENSURE_CONFORMS(data,schema);
+	ENSURE(data["metadata"]["complete"].GetBool(),"Recent changes should be available");
+	ENSURE(data["metadata"]["revision"].GetUint64()>revision,"Revision should advance after a change");
+	bool found=false;
+	for(const auto& item : data["items"].GetArray()){
+		ENSURE(item["revision"].GetUint64()>revision,"Only changes after the requested revision should be listed");
+		if(item["kind"].GetString()==std::string("Group") && item["id"].GetString()==groupID){
+			ENSURE_EQUAL(item["operation"].GetString(),std::string("add"),"Group creation should be listed as an addition");
+			found=true;
+		}
+	}
+	ENSURE(found,"Group creation should appear in the change list");
+	
+	//a long-poll with nothing new to report should return once the wait expires
+	revision=data["metadata"]["revision"].GetUint64();
+	listResp=httpGet(changeURL+"&since="+std::to_string(revision)+"&wait=1");
+	ENSURE_EQUAL(listResp.status,200,"Waiting for changes should succeed");
+	data.Parse(listResp.body.c_str());
+	ENSURE_CONFORMS(data,schema);
+	ENSURE_EQUAL(data["items"].Size(),0,"No changes should be listed");
+}
+
+TEST(ListChangesUnavailable){
+	using namespace httpRequests;
+	TestContext tc;
+
+	std::string adminKey=tc.getPortalToken();
+	std::string changeURL=tc.getAPIServerURL()+"/"+currentAPIVersion+"/changes?token="+adminKey;
+	auto schema=loadSchema(getSchemaDir()+"/ChangeListResultSchema.json");
+	
+	//a revision the server has not reached cannot be resumed from
+	auto listResp=httpGet(changeURL+"&since=1000000000");
+	ENSURE_EQUAL(listResp.status,200,"Portal admin user should be able to list changes");
+	rapidjson::Document data;
+	data.Parse(listResp.body.c_str());
+	ENSURE_CONFORMS(data,schema);
+	ENSURE(!data["metadata"]["complete"].GetBool(),"Unknown revision should require resynchronization");
+	ENSURE_EQUAL(data["items"].Size(),0,"No changes should be listed");
+	
+	//nor can a revision from a different server epoch
+	listResp=httpGet(changeURL+"&since=0&epoch=not-the-epoch");
+	ENSURE_EQUAL(listResp.status,200,"Portal admin user should be able to list changes");
+	data.Parse(listResp.body.c_str());
+	ENSURE_CONFORMS(data,schema);
+	ENSURE(!data["metadata"]["complete"].GetBool(),"Revision from another epoch should require resynchronization");
+	
+	//malformed revisions should be rejected
+	listResp=httpGet(changeURL+"&since=abc");
+	ENSURE_EQUAL(listResp.status,400,"Malformed revisions should be rejected");
+}
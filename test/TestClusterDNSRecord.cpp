@@ -0,0 +1,159 @@
+#include "test.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <crow.h>
+
+#include <ClusterCommands.h>
+#include <PersistentStore.h>
+
+namespace{
+	///A stand-in for the parts of the Route53 API used to make cluster records
+	class FakeRoute53{
+	public:
+		enum class Mode{
+			///Changes are accepted
+			Normal,
+			///Changes are accepted, but only after a delay
+			Slow,
+			///The record name already has an address record not made by SLATE
+			Foreign
+		};
+
+		FakeRoute53():mode(Mode::Normal),changes(0){
+			auto portResp=httpRequests::httpGet("http://localhost:52000/port/allocate");
+			ENSURE_EQUAL(portResp.status,200);
+			port=portResp.body;
+
+			CROW_ROUTE(app, "/2013-04-01/hostedzone").methods("GET"_method)([](){
+				return xmlResponse("<ListHostedZonesResponse xmlns=\"https://route53.amazonaws.com/doc/2013-04-01/\">"
+				                   "<HostedZones><HostedZone><Id>/hostedzone/ZTEST</Id><Name>slateci.net.</Name>"
+				                   "<CallerReference>test</CallerReference><ResourceRecordSetCount>2</ResourceRecordSetCount>"
+				                   "</HostedZone></HostedZones><IsTruncated>false</IsTruncated><MaxItems>100</MaxItems>"
+				                   "</ListHostedZonesResponse>");
+			});
+			auto records=[this](const crow::request& req, const std::string&){
+				if(req.method==crow::HTTPMethod::Post)
+					return change();
+				return listRecords(req);
+			};
+			CROW_ROUTE(app, "/2013-04-01/hostedzone/<string>/rrset").methods("GET"_method,"POST"_method)(records);
+			CROW_ROUTE(app, "/2013-04-01/hostedzone/<string>/rrset/").methods("GET"_method,"POST"_method)(records);
+			app.loglevel(crow::LogLevel::Warning);
+			app.port(std::stoul(port));
+			server=std::thread([this]{ app.run(); });
+			app.wait_for_server_start();
+		}
+
+		~FakeRoute53(){
+			app.stop();
+			server.join();
+			httpRequests::httpDelete("http://localhost:52000/port/"+port);
+		}
+
+		std::string endpoint() const{ return "localhost:"+port; }
+
+		void setMode(Mode m){
+			std::lock_guard<std::mutex> lock(mut);
+			mode=m;
+		}
+
+		std::size_t changeCount(){
+			std::lock_guard<std::mutex> lock(mut);
+			return changes;
+		}
+
+	private:
+		crow::SimpleApp app;
+		std::thread server;
+		std::string port;
+		std::mutex mut;
+		Mode mode;
+		std::size_t changes;
+
+		static crow::response xmlResponse(const std::string& body){
+			crow::response res(200,"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"+body);
+			res.set_header("Content-Type","text/xml");
+			return res;
+		}
+
+		crow::response listRecords(const crow::request& req){
+			std::string recordSets;
+			{
+				std::lock_guard<std::mutex> lock(mut);
+				const char* name=req.url_params.get("name");
+				if(mode==Mode::Foreign && name)
+					recordSets="<ResourceRecordSet><Name>"+std::string(name)+"</Name><Type>A</Type><TTL>300</TTL>"
+					           "<ResourceRecords><ResourceRecord><Value>198.51.100.1</Value></ResourceRecord>"
+					           "</ResourceRecords></ResourceRecordSet>";
+			}
+			return xmlResponse("<ListResourceRecordSetsResponse xmlns=\"https://route53.amazonaws.com/doc/2013-04-01/\">"
+			                   "<ResourceRecordSets>"+recordSets+"</ResourceRecordSets>"
+			                   "<IsTruncated>false</IsTruncated><MaxItems>10</MaxItems>"
+			                   "</ListResourceRecordSetsResponse>");
+		}
+
+		crow::response change(){
+			bool slow;
+			{
+				std::lock_guard<std::mutex> lock(mut);
+				slow=(mode==Mode::Slow);
+			}
+			if(slow)
+				std::this_thread::sleep_for(std::chrono::seconds(2));
+			{
+				std::lock_guard<std::mutex> lock(mut);
+				changes++;
+			}
+			return xmlResponse("<ChangeResourceRecordSetsResponse xmlns=\"https://route53.amazonaws.com/doc/2013-04-01/\">"
+			                   "<ChangeInfo><Id>/change/CTEST</Id><Status>PENDING</Status>"
+			                   "<SubmittedAt>2020-01-01T00:00:00Z</SubmittedAt></ChangeInfo>"
+			                   "</ChangeResourceRecordSetsResponse>");
+		}
+	};
+}
+
+TEST(ClusterDNSRecordMade){
+	FakeRoute53 route53;
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore(route53.endpoint());
+	PersistentStore& store=*storePtr;
+	ENSURE(store.canUpdateDNS(),"The store should use the Route53 stand-in");
+
+	auto made=store.setDNSRecord("*.made.slateci.net","192.0.2.1");
+	auto message=internal::describeDNSRecordChange(made,"made.slateci.net",std::chrono::seconds(10));
+	ENSURE(message.find("can be assigned subdomains within the made.slateci.net domain")!=std::string::npos,
+	       "Subdomains should be promised once the record has been made: "+message);
+	ENSURE_EQUAL(route53.changeCount(),1);
+}
+
+TEST(ClusterDNSRecordPending){
+	FakeRoute53 route53;
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore(route53.endpoint());
+	PersistentStore& store=*storePtr;
+	route53.setMode(FakeRoute53::Mode::Slow);
+
+	auto made=store.setDNSRecord("*.slow.slateci.net","192.0.2.2");
+	auto message=internal::describeDNSRecordChange(made,"slow.slateci.net",std::chrono::milliseconds(100));
+	ENSURE(message.find("not yet in place")!=std::string::npos,
+	       "A record which is still being made should be reported as pending: "+message);
+	ENSURE(made.wait_for(std::chrono::seconds(10))==std::future_status::ready);
+	ENSURE(made.get(),"The record should be made eventually");
+}
+
+TEST(ClusterDNSRecordRefused){
+	FakeRoute53 route53;
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore(route53.endpoint());
+	PersistentStore& store=*storePtr;
+	route53.setMode(FakeRoute53::Mode::Foreign);
+
+	auto made=store.setDNSRecord("*.taken.slateci.net","192.0.2.3");
+	auto message=internal::describeDNSRecordChange(made,"taken.slateci.net",std::chrono::seconds(10));
+	ENSURE(message.find("[Warning]")!=std::string::npos && message.find("could not be made")!=std::string::npos,
+	       "A record which could not be made should be reported: "+message);
+	ENSURE_EQUAL(route53.changeCount(),0,"Records not made by SLATE should not be changed");
+}
@@ -0,0 +1,152 @@
+#include "test.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <EmailClient.h>
+#include <FileHandle.h>
+#include <FileSystem.h>
+
+namespace{
+	///Records the messages it is asked to send
+	struct Recorder{
+		std::mutex mut;
+		std::vector<EmailClient::Email> sent;
+		std::function<bool(const EmailClient::Email&)> sender(){
+			return [this](const EmailClient::Email& email){
+				std::lock_guard<std::mutex> lock(mut);
+				sent.push_back(email);
+				return true;
+			};
+		}
+		std::size_t count(){
+			std::lock_guard<std::mutex> lock(mut);
+			return sent.size();
+		}
+	};
+
+	template<typename Predicate>
+	bool waitFor(Predicate pred){
+		auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+		while(!pred()){
+			if(std::chrono::steady_clock::now()>deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	EmailClient::Email makeEmail(const std::string& to, const std::string& subject){
+		EmailClient::Email email;
+		email.fromAddress="noreply@slate.io";
+		email.toAddresses={to};
+		email.subject=subject;
+		email.body="Body of "+subject;
+		return email;
+	}
+
+	std::size_t countFiles(const std::string& path){
+		std::size_t count=0;
+		for(const auto& entry : directory(path)){
+			if(is_regular_file(entry))
+				count++;
+		}
+		return count;
+	}
+}
+
+TEST(EmailQueueBatching){
+	Recorder recorder;
+	EmailQueue::Options options;
+	options.batchDelay=std::chrono::milliseconds(200);
+	EmailQueue queue(recorder.sender(),options);
+	ENSURE(queue.enqueue(makeEmail("a@example.com","First")));
+	ENSURE(queue.enqueue(makeEmail("b@example.com","Other")));
+	ENSURE(queue.enqueue(makeEmail("a@example.com","Second")));
+	ENSURE(waitFor([&]{ return recorder.count()==2; }));
+	ENSURE(waitFor([&]{ return queue.getQueueDepth()==0; }));
+
+	std::lock_guard<std::mutex> lock(recorder.mut);
+	const auto& combined=(recorder.sent[0].toAddresses.front()=="a@example.com" ? recorder.sent[0] : recorder.sent[1]);
+	ENSURE_EQUAL(combined.subject,"First (and 1 other notification)",
+	             "Messages to the same recipients should be combined");
+	ENSURE(combined.body.find("Body of First")!=std::string::npos);
+	ENSURE(combined.body.find("Body of Second")!=std::string::npos);
+	ENSURE(combined.body.find("Body of First")<combined.body.find("Body of Second"),
+	       "Combined messages should remain in order");
+	std::string stats=queue.getStatistics();
+	ENSURE(stats.find("Email messages sent: 3")!=std::string::npos);
+	ENSURE(stats.find("Emails sent: 2")!=std::string::npos);
+}
+
+TEST(EmailQueueRetry){
+	std::atomic<int> attempts(0);
+	EmailQueue::Options options;
+	options.batchDelay=std::chrono::milliseconds(0);
+	options.retryDelay=std::chrono::milliseconds(5);
+	EmailQueue queue([&](const EmailClient::Email&){ return ++attempts>2; },options);
+	ENSURE(queue.enqueue(makeEmail("a@example.com","Retried")));
+	ENSURE(waitFor([&]{ return queue.getQueueDepth()==0; }),"A failed message should be retried until sent");
+	ENSURE_EQUAL(attempts.load(),3);
+	std::string stats=queue.getStatistics();
+	ENSURE(stats.find("Email retries: 2")!=std::string::npos);
+	ENSURE(stats.find("Email messages failed: 0")!=std::string::npos);
+}
+
+TEST(EmailQueueGivingUp){
+	std::atomic<int> attempts(0);
+	EmailQueue::Options options;
+	options.batchDelay=std::chrono::milliseconds(0);
+	options.retryDelay=std::chrono::milliseconds(1);
+	options.maxAttempts=3;
+	EmailQueue queue([&](const EmailClient::Email&){ attempts++; return false; },options);
+	ENSURE(queue.enqueue(makeEmail("a@example.com","Undeliverable")));
+	ENSURE(waitFor([&]{ return queue.getQueueDepth()==0; }),"A message should be discarded after its last attempt");
+	ENSURE_EQUAL(attempts.load(),3);
+	ENSURE(queue.getStatistics().find("Email messages failed: 1")!=std::string::npos);
+}
+
+TEST(EmailQueueLimit){
+	Recorder recorder;
+	EmailQueue::Options options;
+	options.maxQueued=2;
+	options.batchDelay=std::chrono::seconds(60);
+	{
+		EmailQueue queue(recorder.sender(),options);
+		ENSURE(queue.enqueue(makeEmail("a@example.com","1")));
+		ENSURE(queue.enqueue(makeEmail("b@example.com","2")));
+		ENSURE(!queue.enqueue(makeEmail("c@example.com","3")),"Messages beyond the limit should be discarded");
+		ENSURE(queue.getStatistics().find("Email messages discarded: 1")!=std::string::npos);
+		ENSURE_EQUAL(recorder.count(),0,"Messages should wait to be combined with others");
+	}
+	ENSURE_EQUAL(recorder.count(),2,"Waiting messages should be sent when the queue stops");
+}
+
+TEST(EmailQueueSpool){
+	FileHandle spoolDir=makeTemporaryDir("/tmp/slate_email_spool_");
+	EmailQueue::Options options;
+	options.spoolDirectory=spoolDir.path();
+	options.batchDelay=std::chrono::milliseconds(0);
+	options.retryDelay=std::chrono::seconds(60);
+	{
+		//the mail service is unavailable, so the message is left for later
+		std::atomic<int> attempts(0);
+		EmailQueue queue([&](const EmailClient::Email&){ attempts++; return false; },options);
+		ENSURE(queue.enqueue(makeEmail("a@example.com","Spooled")));
+		ENSURE(waitFor([&]{ return attempts.load()==1; }));
+		ENSURE_EQUAL(countFiles(spoolDir),1,"An unsent message should be kept in the spool");
+	}
+	ENSURE_EQUAL(countFiles(spoolDir),1,"An unsent message should remain in the spool after stopping");
+
+	Recorder recorder;
+	{
+		EmailQueue queue(recorder.sender(),options);
+		ENSURE(waitFor([&]{ return recorder.count()==1; }),"Spooled messages should be sent after restarting");
+		ENSURE(waitFor([&]{ return queue.getQueueDepth()==0; }));
+	}
+	ENSURE_EQUAL(recorder.sent.front().subject,"Spooled");
+	ENSURE_EQUAL(recorder.sent.front().toAddresses.size(),1);
+	ENSURE_EQUAL(countFiles(spoolDir),0,"Sent messages should be removed from the spool");
+}
@@ -0,0 +1,306 @@
+#include "test.h"
+
+#include <fstream>
+
+#include <FileHandle.h>
+#include <StorageBackend.h>
+
+using namespace Aws::DynamoDB::Model;
+
+namespace{
+	void createTable(EmbeddedBackend& backend){
+		CreateTableRequest request;
+		request.SetTableName("things");
+		request.SetKeySchema({
+			KeySchemaElement().WithAttributeName("ID").WithKeyType(KeyType::HASH),
+			KeySchemaElement().WithAttributeName("sortKey").WithKeyType(KeyType::RANGE)
+		});
+		request.AddGlobalSecondaryIndexes(GlobalSecondaryIndex()
+		                                  .WithIndexName("ByName")
+		                                  .WithKeySchema({KeySchemaElement()
+		                                                  .WithAttributeName("name")
+		                                                  .WithKeyType(KeyType::HASH)})
+		                                  .WithProjection(Projection()
+		                                                  .WithProjectionType(ProjectionType::INCLUDE)
+		                                                  .WithNonKeyAttributes({"color"})));
+		auto outcome=backend.CreateTable(request);
+		ENSURE(outcome.IsSuccess(),"Table creation should succeed");
+	}
+
+	void putThing(EmbeddedBackend& backend, const std::string& id, const std::string& sortKey,
+	              const std::string& name, const std::string& color){
+		auto outcome=backend.PutItem(PutItemRequest()
+		                             .WithTableName("things")
+		                             .WithItem({{"ID",AttributeValue(id)},
+		                                        {"sortKey",AttributeValue(sortKey)},
+		                                        {"name",AttributeValue(name)},
+		                                        {"color",AttributeValue(color)},
+		                                        {"size",AttributeValue("large")}}));
+		ENSURE(outcome.IsSuccess(),"Item insertion should succeed");
+	}
+
+	std::vector<EmbeddedBackend::Item> findByName(EmbeddedBackend& backend, const std::string& name){
+		auto outcome=backend.Query(QueryRequest()
+		                           .WithTableName("things")
+		                           .WithIndexName("ByName")
+		                           .WithKeyConditionExpression("#name = :name_val")
+		                           .WithExpressionAttributeNames({{"#name","name"}})
+		                           .WithExpressionAttributeValues({{":name_val",AttributeValue(name)}}));
+		ENSURE(outcome.IsSuccess(),"Index query should succeed");
+		return outcome.GetResult().GetItems();
+	}
+}
+
+TEST(EmbeddedQueries){
+	EmbeddedBackend backend;
+	createTable(backend);
+	putThing(backend,"a","a","Alpha","red");
+	putThing(backend,"a","a:1","Alpha-1","green");
+	putThing(backend,"a","a:2","Alpha-2","blue");
+	putThing(backend,"b","b","Beta","red");
+
+	auto getOutcome=backend.GetItem(GetItemRequest()
+	                                .WithTableName("things")
+	                                .WithKey({{"ID",AttributeValue("b")},{"sortKey",AttributeValue("b")}}));
+	ENSURE(getOutcome.IsSuccess());
+	ENSURE_EQUAL(getOutcome.GetResult().GetItem().at("name").GetS(),"Beta");
+
+	auto queryOutcome=backend.Query(QueryRequest()
+	                                .WithTableName("things")
+	                                .WithKeyConditionExpression("#id = :id AND begins_with(#sortKey,:prefix)")
+	                                .WithExpressionAttributeNames({{"#id","ID"},{"#sortKey","sortKey"}})
+	                                .WithExpressionAttributeValues({{":id",AttributeValue("a")},{":prefix",AttributeValue("a:")}}));
+	ENSURE(queryOutcome.IsSuccess());
+	ENSURE_EQUAL(queryOutcome.GetResult().GetItems().size(),2,"Only items with the prefix should be returned");
+
+	auto byName=findByName(backend,"Alpha-2");
+	ENSURE_EQUAL(byName.size(),1);
+	ENSURE_EQUAL(byName.front().at("color").GetS(),"blue","Projected attributes should be returned");
+	ENSURE(!byName.front().count("size"),"Attributes not projected into the index should be omitted");
+
+	auto scanOutcome=backend.Scan(ScanRequest()
+	                              .WithTableName("things")
+	                              .WithFilterExpression("#color = :color")
+	                              .WithExpressionAttributeNames({{"#color","color"}})
+	                              .WithExpressionAttributeValues({{":color",AttributeValue("red")}}));
+	ENSURE(scanOutcome.IsSuccess());
+	ENSURE_EQUAL(scanOutcome.GetResult().GetItems().size(),2);
+
+	//the index must follow changes to items
+	auto updateOutcome=backend.UpdateItem(UpdateItemRequest()
+	                                      .WithTableName("things")
+	                                      .WithKey({{"ID",AttributeValue("b")},{"sortKey",AttributeValue("b")}})
+	                                      .WithUpdateExpression("SET #name = :name")
+	                                      .WithExpressionAttributeNames({{"#name","name"}})
+	                                      .WithExpressionAttributeValues({{":name",AttributeValue("Gamma")}}));
+	ENSURE(updateOutcome.IsSuccess());
+	ENSURE(findByName(backend,"Beta").empty());
+	ENSURE_EQUAL(findByName(backend,"Gamma").size(),1);
+
+	auto deleteOutcome=backend.DeleteItem(DeleteItemRequest()
+	                                      .WithTableName("things")
+	                                      .WithKey({{"ID",AttributeValue("b")},{"sortKey",AttributeValue("b")}}));
+	ENSURE(deleteOutcome.IsSuccess());
+	ENSURE(findByName(backend,"Gamma").empty());
+}
+
+TEST(EmbeddedProjections){
+	EmbeddedBackend backend;
+	createTable(backend);
+	putThing(backend,"a","a","Alpha","red");
+	putThing(backend,"b","b","Beta","blue");
+
+	auto getOutcome=backend.GetItem(GetItemRequest()
+	                                .WithTableName("things")
+	                                .WithKey({{"ID",AttributeValue("a")},{"sortKey",AttributeValue("a")}})
+	                                .WithProjectionExpression("ID, #name")
+	                                .WithExpressionAttributeNames({{"#name","name"}}));
+	ENSURE(getOutcome.IsSuccess());
+	const auto& item=getOutcome.GetResult().GetItem();
+	ENSURE_EQUAL(item.size(),2,"Only projected attributes should be returned");
+	ENSURE_EQUAL(item.at("name").GetS(),"Alpha");
+
+	auto scanOutcome=backend.Scan(ScanRequest()
+	                              .WithTableName("things")
+	                              .WithProjectionExpression("ID, color"));
+	ENSURE(scanOutcome.IsSuccess());
+	ENSURE_EQUAL(scanOutcome.GetResult().GetItems().size(),2);
+	for(const auto& scanned : scanOutcome.GetResult().GetItems()){
+		ENSURE(scanned.count("color"));
+		ENSURE(!scanned.count("size"),"Attributes not in the projection should be omitted");
+	}
+
+	auto queryOutcome=backend.Query(QueryRequest()
+	                                .WithTableName("things")
+	                                .WithIndexName("ByName")
+	                                .WithKeyConditionExpression("#name = :name_val")
+	                                .WithProjectionExpression("ID, size")
+	                                .WithExpressionAttributeNames({{"#name","name"}})
+	                                .WithExpressionAttributeValues({{":name_val",AttributeValue("Beta")}}));
+	ENSURE(queryOutcome.IsSuccess());
+	ENSURE_EQUAL(queryOutcome.GetResult().GetItems().size(),1);
+	const auto& found=queryOutcome.GetResult().GetItems().front();
+	ENSURE_EQUAL(found.at("ID").GetS(),"b");
+	ENSURE(!found.count("size"),"Attributes not projected into the index cannot be returned");
+	ENSURE(!found.count("name"),"Attributes not in the projection should be omitted");
+
+	auto badOutcome=backend.Scan(ScanRequest()
+	                             .WithTableName("things")
+	                             .WithProjectionExpression("ID, #missing"));
+	ENSURE(!badOutcome.IsSuccess(),"Undefined attribute names should be rejected");
+}
+
+TEST(EmbeddedConditionFailures){
+	EmbeddedBackend backend;
+
+	auto describeOutcome=backend.DescribeTable(DescribeTableRequest().WithTableName("things"));
+	ENSURE(!describeOutcome.IsSuccess());
+	ENSURE(describeOutcome.GetError().GetErrorType()==Aws::DynamoDB::DynamoDBErrors::RESOURCE_NOT_FOUND);
+
+	createTable(backend);
+	putThing(backend,"a","a","Alpha","red");
+
+	UpdateItemRequest request;
+	request.SetTableName("things");
+	request.SetKey({{"ID",AttributeValue("a")},{"sortKey",AttributeValue("a")}});
+	request.SetUpdateExpression("SET #owner = :owner");
+	request.SetConditionExpression("attribute_not_exists(#owner) OR #owner = :none");
+	request.SetExpressionAttributeNames({{"#owner","owner"}});
+	request.SetExpressionAttributeValues({{":owner",AttributeValue("me")},{":none",AttributeValue(" ")}});
+	auto outcome=backend.UpdateItem(request);
+	ENSURE(outcome.IsSuccess(),"First conditional update should succeed");
+	outcome=backend.UpdateItem(request);
+	ENSURE(!outcome.IsSuccess(),"Second conditional update should fail");
+	ENSURE(outcome.GetError().GetErrorType()==Aws::DynamoDB::DynamoDBErrors::CONDITIONAL_CHECK_FAILED);
+
+	auto scanOutcome=backend.Scan(ScanRequest()
+	                              .WithTableName("things")
+	                              .WithFilterExpression("#undefined = :undefined"));
+	ENSURE(!scanOutcome.IsSuccess(),"Expressions with missing substitutions should be rejected");
+	ENSURE(scanOutcome.GetError().GetErrorType()==Aws::DynamoDB::DynamoDBErrors::VALIDATION);
+}
+
+TEST(EmbeddedPersistence){
+	FileHandle dir=makeTemporaryDir(".embeddedStorage");
+	const std::string dataDir=dir.path()+"/data";
+	{
+		EmbeddedBackend backend(dataDir);
+		createTable(backend);
+		putThing(backend,"a","a","Alpha","red");
+		putThing(backend,"b","b","Beta","red");
+		backend.DeleteItem(DeleteItemRequest()
+		                   .WithTableName("things")
+		                   .WithKey({{"ID",AttributeValue("a")},{"sortKey",AttributeValue("a")}}));
+
+		bool locked=false;
+		try{
+			EmbeddedBackend other(dataDir);
+		}catch(std::runtime_error& err){
+			locked=true;
+		}
+		ENSURE(locked,"A data directory should not be usable by two backends at once");
+	}
+	{
+		EmbeddedBackend backend(dataDir);
+		auto describeOutcome=backend.DescribeTable(DescribeTableRequest().WithTableName("things"));
+		ENSURE(describeOutcome.IsSuccess(),"Tables should persist");
+		ENSURE_EQUAL(describeOutcome.GetResult().GetTable().GetGlobalSecondaryIndexes().size(),1,
+		             "Indices should persist");
+		ENSURE(findByName(backend,"Alpha").empty(),"Deletions should persist");
+		ENSURE_EQUAL(findByName(backend,"Beta").size(),1,"Items should persist");
+	}
+}
+
+TEST(EmbeddedJournalDamage){
+	FileHandle dir=makeTemporaryDir(".embeddedStorage");
+	const std::string dataDir=dir.path()+"/data";
+	const std::string journalPath=dataDir+"/journal";
+	{
+		EmbeddedBackend backend(dataDir);
+		createTable(backend);
+		putThing(backend,"a","a","Alpha","red");
+		putThing(backend,"b","b","Beta","red");
+	}
+	//simulate a crash while a record was being written
+	{
+		std::ofstream journal(journalPath,std::ios::app);
+		journal << "{\"op\":\"put\",\"tab";
+	}
+	{
+		EmbeddedBackend backend(dataDir);
+		ENSURE_EQUAL(findByName(backend,"Alpha").size(),1,"An incomplete final record should be discarded");
+		ENSURE_EQUAL(findByName(backend,"Beta").size(),1,"An incomplete final record should be discarded");
+	}
+	//damage a record before others
+	{
+		std::vector<std::string> lines;
+		{
+			std::ifstream journal(journalPath);
+			std::string line;
+			while(std::getline(journal,line))
+				lines.push_back(line);
+		}
+		ENSURE(lines.size()>2);
+		lines[1]="{\"op\":";
+		std::ofstream journal(journalPath,std::ios::trunc);
+		for(const auto& line : lines)
+			journal << line << '\n';
+	}
+	bool rejected=false;
+	try{
+		EmbeddedBackend backend(dataDir);
+	}catch(std::runtime_error& err){
+		rejected=true;
+	}
+	ENSURE(rejected,"A damaged record followed by others should prevent loading");
+	//the failed attempt should not have held on to the directory lock
+	{
+		std::ofstream journal(journalPath,std::ios::trunc);
+	}
+	EmbeddedBackend backend(dataDir);
+}
+
+TEST(EmbeddedTimeToLive){
+	FileHandle dir=makeTemporaryDir(".embeddedStorage");
+	const std::string dataDir=dir.path()+"/data";
+	auto putExpiring=[](EmbeddedBackend& backend, const std::string& id, const std::string& name, long long offset){
+		long long expiration=std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count()+offset;
+		auto outcome=backend.PutItem(PutItemRequest()
+		                             .WithTableName("things")
+		                             .WithItem({{"ID",AttributeValue(id)},
+		                                        {"sortKey",AttributeValue(id)},
+		                                        {"name",AttributeValue(name)},
+		                                        {"expires",AttributeValue().SetN(std::to_string(expiration))}}));
+		ENSURE(outcome.IsSuccess(),"Item insertion should succeed");
+	};
+	{
+		EmbeddedBackend backend(dataDir);
+		createTable(backend);
+		auto describeOutcome=backend.DescribeTimeToLive(DescribeTimeToLiveRequest().WithTableName("things"));
+		ENSURE(describeOutcome.IsSuccess());
+		ENSURE(describeOutcome.GetResult().GetTimeToLiveDescription().GetTimeToLiveStatus()==TimeToLiveStatus::DISABLED,
+		       "Items should not expire by default");
+		auto updateOutcome=backend.UpdateTimeToLive(UpdateTimeToLiveRequest()
+		                                            .WithTableName("things")
+		                                            .WithTimeToLiveSpecification(TimeToLiveSpecification()
+		                                                                         .WithAttributeName("expires")
+		                                                                         .WithEnabled(true)));
+		ENSURE(updateOutcome.IsSuccess(),"Enabling expiration should succeed");
+		putExpiring(backend,"a","Alpha",-60);
+		putExpiring(backend,"b","Beta",3600);
+		putThing(backend,"c","c","Gamma","red");
+		ENSURE_EQUAL(findByName(backend,"Alpha").size(),1,"Expired items are not removed immediately");
+	}
+	{
+		EmbeddedBackend backend(dataDir);
+		auto describeOutcome=backend.DescribeTimeToLive(DescribeTimeToLiveRequest().WithTableName("things"));
+		ENSURE(describeOutcome.IsSuccess());
+		const auto& desc=describeOutcome.GetResult().GetTimeToLiveDescription();
+		ENSURE(desc.GetTimeToLiveStatus()==TimeToLiveStatus::ENABLED,"The expiration setting should persist");
+		ENSURE_EQUAL(desc.GetAttributeName(),"expires");
+		ENSURE(findByName(backend,"Alpha").empty(),"Expired items should be removed when data is loaded");
+		ENSURE_EQUAL(findByName(backend,"Beta").size(),1,"Unexpired items should be kept");
+		ENSURE_EQUAL(findByName(backend,"Gamma").size(),1,"Items without expiration times should be kept");
+	}
+}
@@ -0,0 +1,290 @@
+#include "test.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <EventStream.h>
+#include <PersistentStore.h>
+
+namespace{
+	///A connection which records what is sent to it, and whose posted tasks
+	///run only when the test asks, standing in for the connection's thread
+	class FakeConnection : public crow::websocket::connection{
+	public:
+		FakeConnection():unsent(0){}
+
+		void send_binary(const std::string& msg) override{ send_text(msg); }
+		void send_text(const std::string& msg) override{
+			std::lock_guard<std::mutex> lock(mut);
+			sent.push_back(msg);
+		}
+		void close(const std::string&) override{}
+		void post_task(std::function<void()> handler) override{
+			std::lock_guard<std::mutex> lock(mut);
+			tasks.push_back(std::move(handler));
+		}
+		std::size_t unsent_bytes() const override{ return unsent; }
+
+		///Run all tasks posted so far
+		void runTasks(){
+			std::deque<std::function<void()>> toRun;
+			{
+				std::lock_guard<std::mutex> lock(mut);
+				std::swap(toRun,tasks);
+			}
+			for(auto& task : toRun)
+				task();
+		}
+
+		///Take the messages sent since this was last called
+		std::vector<rapidjson::Document> takeMessages(){
+			std::vector<std::string> raw;
+			{
+				std::lock_guard<std::mutex> lock(mut);
+				std::swap(raw,sent);
+			}
+			std::vector<rapidjson::Document> messages(raw.size());
+			for(std::size_t i=0; i<raw.size(); i++)
+				messages[i].Parse(raw[i].c_str());
+			return messages;
+		}
+
+		///The number of bytes to claim are waiting to be written
+		std::size_t unsent;
+	private:
+		std::mutex mut;
+		std::vector<std::string> sent;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	bool isKind(const rapidjson::Document& message, const std::string& kind){
+		return message.IsObject() && message.HasMember("kind") && message["kind"].GetString()==kind;
+	}
+
+	///Collect Event messages until one for the given record arrives
+	///\return the events received, the last of which is for the record, or
+	///        all events received before giving up
+	std::vector<rapidjson::Document> waitForEvent(FakeConnection& conn, const std::string& id){
+		std::vector<rapidjson::Document> events;
+		const auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(30);
+		while(std::chrono::steady_clock::now()<deadline){
+			conn.runTasks();
+			for(auto& message : conn.takeMessages()){
+				if(!isKind(message,"Event"))
+					continue;
+				bool found=(message["metadata"]["id"].GetString()==id);
+				events.push_back(std::move(message));
+				if(found)
+					return events;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		return events;
+	}
+
+	///Wait until the stream has distributed all changes made so far, which it
+	///reports in its reply to a subscription request
+	///\return any messages other than the reply which were sent meanwhile
+	std::vector<rapidjson::Document> waitDispatched(EventStream& stream, FakeConnection& conn,
+	                                                const PersistentStore& store){
+		const uint64_t target=store.getChangeLog().currentRevision();
+		std::vector<rapidjson::Document> others;
+		const auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(30);
+		while(std::chrono::steady_clock::now()<deadline){
+			stream.message(conn,"{\"action\":\"subscribe\"}",false);
+			bool done=false;
+			for(auto& message : conn.takeMessages()){
+				if(isKind(message,"Subscription"))
+					done=(message["metadata"]["revision"].GetUint64()>=target);
+				else
+					others.push_back(std::move(message));
+			}
+			if(done)
+				return others;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		FAIL("Changes were not distributed in time");
+		return others;
+	}
+
+	void acknowledge(EventStream& stream, FakeConnection& conn, uint64_t revision){
+		stream.message(conn,"{\"action\":\"ack\",\"revision\":"+std::to_string(revision)+"}",false);
+	}
+
+	User makeUser(PersistentStore& store, const std::string& name){
+		User user;
+		user.id=idGenerator.generateUserID();
+		user.token=idGenerator.generateUserToken();
+		user.name=name;
+		user.email=name+"@example.com";
+		user.phone="555-5555";
+		user.institution="Example University";
+		user.globusID=name+"_globus";
+		user.admin=false;
+		user.valid=true;
+		ENSURE(store.addUser(user),"User creation should succeed");
+		return user;
+	}
+
+	Group makeGroup(PersistentStore& store, const std::string& name){
+		Group group;
+		group.id=idGenerator.generateGroupID();
+		group.name=name;
+		group.email=name+"@example.com";
+		group.phone="555-5555";
+		group.scienceField="Logic";
+		group.description=" ";
+		group.valid=true;
+		ENSURE(store.addGroup(group),"Group creation should succeed");
+		return group;
+	}
+
+	std::string addInstance(PersistentStore& store, const Group& group, const std::string& name){
+		ApplicationInstance instance;
+		instance.id=idGenerator.generateInstanceID();
+		instance.name=name;
+		instance.application="test-app";
+		instance.owningGroup=group.id;
+		instance.cluster=idGenerator.generateClusterID();
+		instance.config="-";
+		instance.ctime="-";
+		instance.valid=true;
+		ENSURE(store.addApplicationInstance(instance),"Instance creation should succeed");
+		return instance.id;
+	}
+
+	///Open a connection to the stream for a user, as crow would
+	void connect(EventStream& stream, FakeConnection& conn, const User& user){
+		crow::request req;
+		req.url_params=crow::query_string("/stream?token="+user.token);
+		ENSURE(stream.accept(req),"The user's connection should be accepted");
+		stream.open(conn);
+	}
+}
+
+TEST(EventStreamRejectsInvalidToken){
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore();
+	EventStream stream(*storePtr);
+	crow::request req;
+	req.url_params=crow::query_string("/stream?token=00112233-4455-6677-8899-aabbccddeeff");
+	ENSURE(!stream.accept(req),"A connection with an invalid token should be refused");
+}
+
+TEST(EventStreamGroupVisibility){
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore();
+	PersistentStore& store=*storePtr;
+	User user=makeUser(store,"stream-user");
+	Group member=makeGroup(store,"stream-member-group");
+	Group other=makeGroup(store,"stream-other-group");
+	ENSURE(store.addUserToGroup(user.id,member.id),"Adding the user to a group should succeed");
+
+	EventStream stream(store);
+	FakeConnection conn;
+	connect(stream,conn,user);
+	ENSURE_EQUAL(stream.clientCount(),1);
+	stream.message(conn,"{\"action\":\"subscribe\",\"groups\":[\"*\"]}",false);
+	auto messages=conn.takeMessages();
+	ENSURE(messages.size()==1 && isKind(messages.front(),"Subscription"),
+	       "A subscription should be confirmed");
+
+	//an instance belonging to another group must not be reported, while the
+	//one which follows it, belonging to the user's group, must be
+	std::string hidden=addInstance(store,other,"hidden-instance");
+	std::string visible=addInstance(store,member,"visible-instance");
+	auto events=waitForEvent(conn,visible);
+	ENSURE(!events.empty() && events.back()["metadata"]["id"].GetString()==visible,
+	       "A change to an instance of the user's group should be reported");
+	for(const auto& event : events)
+		ENSURE(event["metadata"]["id"].GetString()!=hidden,
+		       "A change to an instance of another group should not be reported");
+	acknowledge(stream,conn,store.getChangeLog().currentRevision());
+
+	//once the user joins the other group, its instances become visible
+	ENSURE(store.addUserToGroup(user.id,other.id),"Adding the user to a group should succeed");
+	std::string joined=addInstance(store,other,"joined-instance");
+	events=waitForEvent(conn,joined);
+	ENSURE(!events.empty() && events.back()["metadata"]["id"].GetString()==joined,
+	       "Changes to instances of a newly joined group should be reported");
+
+	stream.close(conn);
+	ENSURE_EQUAL(stream.clientCount(),0);
+}
+
+TEST(EventStreamAcknowledgementWindow){
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore();
+	PersistentStore& store=*storePtr;
+	User user=makeUser(store,"stream-window-user");
+	Group group=makeGroup(store,"stream-window-group");
+	ENSURE(store.addUserToGroup(user.id,group.id),"Adding the user to a group should succeed");
+
+	EventStream stream(store,2,8);
+	FakeConnection conn;
+	connect(stream,conn,user);
+	stream.message(conn,"{\"action\":\"subscribe\",\"groups\":[\"stream-window-group\"]}",false);
+	conn.takeMessages();
+
+	std::vector<std::string> ids;
+	for(int i=0; i<3; i++)
+		ids.push_back(addInstance(store,group,"window-instance-"+std::to_string(i)));
+	waitDispatched(stream,conn,store);
+	conn.runTasks();
+	auto messages=conn.takeMessages();
+	ENSURE_EQUAL(messages.size(),2,"Only a window of events should be sent without acknowledgement");
+	if(messages.size()!=2)
+		return;
+	ENSURE_EQUAL(messages[0]["metadata"]["id"].GetString(),ids[0]);
+	ENSURE_EQUAL(messages[1]["metadata"]["id"].GetString(),ids[1]);
+
+	//acknowledging the first event makes room for the third
+	acknowledge(stream,conn,messages[0]["metadata"]["revision"].GetUint64());
+	messages=conn.takeMessages();
+	ENSURE_EQUAL(messages.size(),1,"Acknowledging an event should allow another to be sent");
+	if(!messages.empty())
+		ENSURE_EQUAL(messages[0]["metadata"]["id"].GetString(),ids[2]);
+}
+
+TEST(EventStreamResync){
+	DatabaseContext db;
+	auto storePtr=db.makePersistentStore();
+	PersistentStore& store=*storePtr;
+	User user=makeUser(store,"stream-resync-user");
+	Group group=makeGroup(store,"stream-resync-group");
+	ENSURE(store.addUserToGroup(user.id,group.id),"Adding the user to a group should succeed");
+
+	EventStream stream(store,4,3,1024);
+	FakeConnection conn;
+	connect(stream,conn,user);
+	stream.message(conn,"{\"action\":\"subscribe\",\"groups\":[\"stream-resync-group\"]}",false);
+	conn.takeMessages();
+
+	//while the connection cannot accept more data, events are held back
+	//until there are too many, and then discarded
+	conn.unsent=4096;
+	for(int i=0; i<5; i++)
+		addInstance(store,group,"resync-instance-"+std::to_string(i));
+	auto others=waitDispatched(stream,conn,store);
+	conn.runTasks();
+	ENSURE(others.empty() && conn.takeMessages().empty(),
+	       "No events should be sent while the connection's buffer is full");
+
+	//once the connection drains, the client is told to resynchronize
+	//instead of being sent the discarded events
+	conn.unsent=0;
+	conn.runTasks();
+	acknowledge(stream,conn,0);
+	auto messages=conn.takeMessages();
+	ENSURE_EQUAL(messages.size(),1,"Only a resynchronization message should be sent");
+	if(messages.empty())
+		return;
+	ENSURE(isKind(messages.front(),"Resync"),"The client should be told to resynchronize");
+	ENSURE_EQUAL(messages.front()["metadata"]["revision"].GetUint64(),
+	             store.getChangeLog().currentRevision(),
+	             "The client should resume from the latest revision");
+	ENSURE_EQUAL(messages.front()["metadata"]["epoch"].GetString(),store.getGenerationEpoch());
+}
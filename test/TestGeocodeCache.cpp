@@ -0,0 +1,220 @@
+#include "test.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <crow.h>
+
+#include <PersistentStore.h>
+
+namespace{
+	///A stand-in for the reverse geocoding service, which counts the lookups
+	///made of it
+	class FakeGeocoder{
+	public:
+		FakeGeocoder():delay(0),requests(0){
+			auto portResp=httpRequests::httpGet("http://localhost:52000/port/allocate");
+			ENSURE_EQUAL(portResp.status,200);
+			port=portResp.body;
+
+			CROW_ROUTE(app, "/<string>")([this](const std::string&){
+				std::chrono::milliseconds wait;
+				{
+					std::lock_guard<std::mutex> lock(mut);
+					requests++;
+					wait=delay;
+				}
+				std::this_thread::sleep_for(wait);
+				return crow::response(200,"{\"geocode\":\"TEST-GEOCODE\",\"timezone\":\"America/Chicago\","
+				                          "\"city\":\"Testville\",\"prov\":\"US\",\"country\":\"United States\"}");
+			});
+			app.loglevel(crow::LogLevel::Warning);
+			app.port(std::stoul(port));
+			server=std::thread([this]{ app.run(); });
+			app.wait_for_server_start();
+		}
+
+		~FakeGeocoder(){
+			app.stop();
+			server.join();
+			httpRequests::httpDelete("http://localhost:52000/port/"+port);
+		}
+
+		Geocoder makeGeocoder() const{ return Geocoder("http://localhost:"+port,"token"); }
+
+		///Make each lookup take some time
+		void setDelay(std::chrono::milliseconds d){
+			std::lock_guard<std::mutex> lock(mut);
+			delay=d;
+		}
+
+		std::size_t requestCount(){
+			std::lock_guard<std::mutex> lock(mut);
+			return requests;
+		}
+
+	private:
+		crow::SimpleApp app;
+		std::thread server;
+		std::string port;
+		std::mutex mut;
+		std::chrono::milliseconds delay;
+		std::size_t requests;
+	};
+
+	std::unique_ptr<PersistentStore> makeStore(const DatabaseContext& db, const FakeGeocoder& geocoder){
+		auto store=db.makePersistentStore();
+		store->setGeocoder(geocoder.makeGeocoder());
+		return store;
+	}
+
+	///Open the test database directly. With embedded storage no store may be
+	///open at the same time.
+	std::unique_ptr<StorageBackend> openStorage(const DatabaseContext& db){
+		if(db.usesEmbeddedStorage())
+			return std::unique_ptr<StorageBackend>(new EmbeddedBackend(db.getStorageDirectory()));
+		Aws::Auth::AWSCredentials credentials("foo","bar");
+		Aws::Client::ClientConfiguration clientConfig;
+		clientConfig.region="us-east-1";
+		clientConfig.scheme=Aws::Http::Scheme::HTTP;
+		clientConfig.endpointOverride="localhost:"+db.getDBPort();
+		return std::unique_ptr<StorageBackend>(new DynamoDBBackend(credentials,clientConfig));
+	}
+
+	long long secondsSinceEpoch(){
+		return std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	///Store a geocoding result as an earlier lookup would have
+	void storeRecord(StorageBackend& storage, const std::string& key,
+	                 const Aws::DynamoDB::Model::AttributeValue& expiration){
+		using Aws::DynamoDB::Model::AttributeValue;
+		auto outcome=storage.PutItem(Aws::DynamoDB::Model::PutItemRequest()
+		                             .WithTableName("SLATE_clusters")
+		                             .WithItem({{"ID",AttributeValue("Geocode")},
+		                                        {"sortKey",AttributeValue(key)},
+		                                        {"city",AttributeValue("Stale City")},
+		                                        {"expirationTime",expiration}}));
+		ENSURE(outcome.IsSuccess(),"Storing a geocoding record should succeed");
+	}
+}
+
+TEST(GeocodeRounding){
+	DatabaseContext db;
+	FakeGeocoder geocoder;
+	auto store=makeStore(db,geocoder);
+
+	auto result=store->reverseGeocode(GeoLocation{41.00012,-87.00021});
+	ENSURE(result,"Lookup should succeed: "+result.error);
+	ENSURE_EQUAL(result.city,"Testville");
+	ENSURE_EQUAL(geocoder.requestCount(),1);
+
+	result=store->reverseGeocode(GeoLocation{41.00038,-87.00004});
+	ENSURE_EQUAL(result.city,"Testville");
+	ENSURE_EQUAL(geocoder.requestCount(),1,"Coordinates within rounding distance should share a lookup");
+
+	store->reverseGeocode(GeoLocation{41.0012,-87.00021});
+	ENSURE_EQUAL(geocoder.requestCount(),2,"Coordinates farther apart should be looked up separately");
+
+	//coordinates which round to zero from either side are the same place
+	store->reverseGeocode(GeoLocation{-0.0004,0.0004});
+	store->reverseGeocode(GeoLocation{0.0004,-0.0004});
+	ENSURE_EQUAL(geocoder.requestCount(),3,"Coordinates rounding to zero should share a lookup");
+}
+
+TEST(GeocodeStoredRecordReuse){
+	DatabaseContext db;
+	FakeGeocoder geocoder;
+	{
+		auto store=makeStore(db,geocoder);
+		auto result=store->reverseGeocode(GeoLocation{41.0,-87.0});
+		ENSURE(result,"Lookup should succeed: "+result.error);
+		ENSURE_EQUAL(geocoder.requestCount(),1);
+	}
+	{
+		//a new store has nothing in memory, but should find the stored result
+		auto store=makeStore(db,geocoder);
+		auto result=store->reverseGeocode(GeoLocation{41.0,-87.0});
+		ENSURE(result,"Lookup should succeed: "+result.error);
+		ENSURE_EQUAL(result.city,"Testville");
+		ENSURE_EQUAL(result.countryName,"United States");
+		ENSURE_EQUAL(geocoder.requestCount(),1,"A stored result should be reused");
+	}
+	{
+		using namespace Aws::DynamoDB::Model;
+		auto storage=openStorage(db);
+		auto outcome=storage->GetItem(GetItemRequest()
+		                              .WithTableName("SLATE_clusters")
+		                              .WithKey({{"ID",AttributeValue("Geocode")},
+		                                        {"sortKey",AttributeValue("41.000,-87.000")}}));
+		ENSURE(outcome.IsSuccess());
+		const auto& item=outcome.GetResult().GetItem();
+		auto expiration=item.find("expirationTime");
+		ENSURE(expiration!=item.end(),"A stored result should have an expiration time");
+		if(expiration==item.end())
+			return;
+		ENSURE(expiration->second.GetType()==ValueType::NUMBER,
+		       "The expiration time should be a number, so that the database can use it");
+		ENSURE(std::stoll(expiration->second.GetN())>secondsSinceEpoch(),
+		       "The expiration time should be in the future");
+
+		auto ttlOutcome=storage->DescribeTimeToLive(DescribeTimeToLiveRequest().WithTableName("SLATE_clusters"));
+		ENSURE(ttlOutcome.IsSuccess());
+		const auto& ttl=ttlOutcome.GetResult().GetTimeToLiveDescription();
+		ENSURE(ttl.GetTimeToLiveStatus()==TimeToLiveStatus::ENABLED,
+		       "The database should delete expired results");
+		ENSURE_EQUAL(ttl.GetAttributeName(),"expirationTime");
+	}
+}
+
+TEST(GeocodeExpiry){
+	using Aws::DynamoDB::Model::AttributeValue;
+	DatabaseContext db;
+	FakeGeocoder geocoder;
+	//create the tables
+	makeStore(db,geocoder);
+	{
+		auto storage=openStorage(db);
+		storeRecord(*storage,"10.000,20.000",AttributeValue().SetN(std::to_string(secondsSinceEpoch()-60)));
+		//a record from before expiration times were numbers, which the
+		//database would never remove
+		storeRecord(*storage,"30.000,40.000",AttributeValue(std::to_string(secondsSinceEpoch()+3600)));
+		storeRecord(*storage,"50.000,60.000",AttributeValue().SetN(std::to_string(secondsSinceEpoch()+3600)));
+	}
+	auto store=makeStore(db,geocoder);
+
+	auto result=store->reverseGeocode(GeoLocation{10.0,20.0});
+	ENSURE_EQUAL(result.city,"Testville","An expired result should not be used");
+	ENSURE_EQUAL(geocoder.requestCount(),1);
+
+	result=store->reverseGeocode(GeoLocation{30.0,40.0});
+	ENSURE_EQUAL(result.city,"Testville","A result with a non-numeric expiration time should be replaced");
+	ENSURE_EQUAL(geocoder.requestCount(),2);
+
+	result=store->reverseGeocode(GeoLocation{50.0,60.0});
+	ENSURE_EQUAL(result.city,"Stale City","An unexpired result should be used");
+	ENSURE_EQUAL(geocoder.requestCount(),2);
+}
+
+TEST(GeocodeConcurrentLookups){
+	DatabaseContext db;
+	FakeGeocoder geocoder;
+	geocoder.setDelay(std::chrono::milliseconds(500));
+	auto store=makeStore(db,geocoder);
+
+	const std::size_t nThreads=8;
+	std::vector<Geocoder::GeocodeResult> results(nThreads);
+	std::vector<std::thread> threads;
+	for(std::size_t i=0; i<nThreads; i++)
+		threads.emplace_back([&,i]{ results[i]=store->reverseGeocode(GeoLocation{-33.86,151.21}); });
+	for(auto& thread : threads)
+		thread.join();
+
+	ENSURE_EQUAL(geocoder.requestCount(),1,"Concurrent lookups of the same place should share one request");
+	for(const auto& result : results){
+		ENSURE(result,"Every lookup should succeed: "+result.error);
+		ENSURE_EQUAL(result.city,"Testville");
+	}
+}
@@ -1,5 +1,6 @@
 #include "test.h"
 
+#include <PersistentStore.h>
 #include <ServerUtilities.h>
 
 TEST(UnauthenticatedFetchInstanceInfo){
@@ -228,3 +229,42 @@ TEST(UnrelatedUserInstanceInfo){
 		             " the owning Group should be rejected.");
 	}
 }
+
+TEST(InternalInstanceConfigStorage){
+	DatabaseContext db;
+	
+	//a large configuration, which should be stored compressed, and a small 
+	//one, which should be stored as it is
+	std::string largeConfig;
+	for(unsigned int i=0; i<2000; i++)
+		largeConfig+="key"+std::to_string(i)+": value"+std::to_string(i%7)+"\n";
+	const std::string smallConfig="foo: bar\n";
+	
+	ApplicationInstance large, small;
+	large.valid=small.valid=true;
+	large.id="instance_large";
+	small.id="instance_small";
+	large.name="large";
+	small.name="small";
+	large.application=small.application="test-app";
+	large.owningGroup=small.owningGroup="group_1";
+	large.cluster=small.cluster="cluster_1";
+	large.ctime=small.ctime=timestamp();
+	large.config=largeConfig;
+	small.config=smallConfig;
+	
+	{
+		auto store=db.makePersistentStore();
+		ENSURE(store->addApplicationInstance(large));
+		ENSURE(store->addApplicationInstance(small));
+		//configurations should be unchanged when read from the cache
+		ENSURE_EQUAL(store->getApplicationInstanceConfig(large.id),largeConfig);
+		ENSURE_EQUAL(store->getApplicationInstanceConfig(small.id),smallConfig);
+	}
+	{
+		//a new store must read the configurations from the database
+		auto store=db.makePersistentStore();
+		ENSURE_EQUAL(store->getApplicationInstanceConfig(large.id),largeConfig);
+		ENSURE_EQUAL(store->getApplicationInstanceConfig(small.id),smallConfig);
+	}
+}
@@ -0,0 +1,71 @@
+#include "test.h"
+
+#include <JSONExtractor.h>
+
+TEST(JSONExtractorSelectsPaths){
+	std::string json=R"({
+		"apiVersion": "v1",
+		"items": [
+			{"metadata": {"name": "a", "labels": {"app": "x"}}, "spec": {"nodeName": "n1", "containers": [1,2,3]}},
+			{"metadata": {"name": "b"}, "status": {"phase": "Running"}},
+			{"kind": "Pod"}
+		]
+	})";
+	JSONExtractor extractor({"/items/*/metadata/name","/items/*/status"});
+	rapidjson::Document result;
+	extractor.parseInsitu(json,result);
+
+	ENSURE(result.IsObject());
+	ENSURE(!result.HasMember("apiVersion"),"Unselected members should be dropped");
+	ENSURE(result.HasMember("items"));
+	ENSURE_EQUAL(result["items"].Size(),3,"Array elements should be kept so that indices are preserved");
+	ENSURE_EQUAL(std::string(result["items"][0]["metadata"]["name"].GetString()),"a");
+	ENSURE(!result["items"][0]["metadata"].HasMember("labels"));
+	ENSURE(!result["items"][0].HasMember("spec"));
+	ENSURE_EQUAL(std::string(result["items"][1]["metadata"]["name"].GetString()),"b");
+	ENSURE_EQUAL(std::string(result["items"][1]["status"]["phase"].GetString()),"Running",
+	             "Selected values should be kept in their entirety");
+	ENSURE(result["items"][2].IsObject());
+	ENSURE_EQUAL(result["items"][2].MemberCount(),0);
+}
+
+TEST(JSONExtractorScalarTypes){
+	std::string json=R"({"a": {"i": -4, "u": 7, "big": 12345678901, "d": 2.5, "t": true, "n": null, "s": "str"}, "b": 1})";
+	JSONExtractor extractor({"/a/i","/a/u","/a/big","/a/d","/a/t","/a/n","/a/s","/a/missing"});
+	rapidjson::Document result;
+	extractor.parseInsitu(json,result);
+	ENSURE(!result.HasMember("b"));
+	const auto& a=result["a"];
+	ENSURE_EQUAL(a["i"].GetInt(),-4);
+	ENSURE_EQUAL(a["u"].GetInt(),7);
+	ENSURE_EQUAL(a["big"].GetInt64(),12345678901LL);
+	ENSURE_EQUAL(a["d"].GetDouble(),2.5);
+	ENSURE(a["t"].GetBool());
+	ENSURE(a["n"].IsNull());
+	ENSURE_EQUAL(std::string(a["s"].GetString()),"str");
+	ENSURE(!a.HasMember("missing"));
+}
+
+TEST(JSONExtractorIgnoresMismatchedStructure){
+	//a scalar where an object is expected is not selected
+	std::string json=R"({"status": "unknown", "spec": [{"x": 1}]})";
+	JSONExtractor extractor({"/status/addresses","/spec/0/x"});
+	rapidjson::Document result;
+	extractor.parseInsitu(json,result);
+	ENSURE(!result.HasMember("status"));
+	ENSURE_EQUAL(result["spec"].Size(),1);
+	ENSURE_EQUAL(result["spec"][0]["x"].GetInt(),1);
+}
+
+TEST(JSONExtractorInvalidInput){
+	std::string json=R"({"items": [)";
+	JSONExtractor extractor({"/items"});
+	rapidjson::Document result;
+	bool threw=false;
+	try{
+		extractor.parseInsitu(json,result);
+	}catch(std::runtime_error& err){
+		threw=true;
+	}
+	ENSURE(threw,"Invalid input should be reported");
+}
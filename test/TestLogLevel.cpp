@@ -0,0 +1,71 @@
+#include "test.h"
+
+#include <ServerUtilities.h>
+
+TEST(UnauthorizedLogLevel){
+	using namespace httpRequests;
+	TestContext tc;
+	
+	std::string adminKey=tc.getPortalToken();
+	//create a regular user
+	std::string token;
+	{
+		rapidjson::Document request(rapidjson::kObjectType);
+		auto& alloc = request.GetAllocator();
+		request.AddMember("apiVersion", currentAPIVersion, alloc);
+		rapidjson::Value metadata(rapidjson::kObjectType);
+		metadata.AddMember("name", "Bob", alloc);
+		metadata.AddMember("email", "bob@place.com", alloc);
+		metadata.AddMember("phone", "555-5555", alloc);
+		metadata.AddMember("institution", "Center of the Earth University", alloc);
+		metadata.AddMember("admin", false, alloc);
+		metadata.AddMember("globusID", "Bob's Globus ID", alloc);
+		request.AddMember("metadata", metadata, alloc);
+		auto createResp=httpPost(tc.getAPIServerURL()+"/"+currentAPIVersion+"/users?token="+adminKey,to_string(request));
+		ENSURE_EQUAL(createResp.status,200,"User creation request should succeed");
+		rapidjson::Document createData;
+		createData.Parse(createResp.body.c_str());
+		token=createData["metadata"]["access_token"].GetString();
+	}
+	
+	auto levelURL=tc.getAPIServerURL()+"/"+currentAPIVersion+"/log_level";
+	auto resp=httpGet(levelURL);
+	ENSURE_EQUAL(resp.status,403,"Requests for the log level without authentication should be rejected");
+	resp=httpPut(levelURL,"{\"level\":\"error\"}");
+	ENSURE_EQUAL(resp.status,403,"Requests to set the log level without authentication should be rejected");
+	resp=httpGet(levelURL+"?token="+token);
+	ENSURE_EQUAL(resp.status,403,"Requests for the log level by non-admins should be rejected");
+	resp=httpPut(levelURL+"?token="+token,"{\"level\":\"error\"}");
+	ENSURE_EQUAL(resp.status,403,"Requests to set the log level by non-admins should be rejected");
+}
+
+TEST(AdjustLogLevel){
+	using namespace httpRequests;
+	TestContext tc;
+	
+	std::string adminKey=tc.getPortalToken();
+	auto levelURL=tc.getAPIServerURL()+"/"+currentAPIVersion+"/log_level?token="+adminKey;
+	
+	auto fetchLevel=[&]{
+		auto resp=httpGet(levelURL);
+		ENSURE_EQUAL(resp.status,200,"Admins should be able to fetch the log level");
+		rapidjson::Document data;
+		data.Parse(resp.body.c_str());
+		ENSURE(data.HasMember("level"));
+		return std::string(data["level"].GetString());
+	};
+	ENSURE_EQUAL(fetchLevel(),"info","The default log level should be info");
+	
+	auto resp=httpPut(levelURL,"{\"level\":\"error\"}");
+	ENSURE_EQUAL(resp.status,200,"Admins should be able to set the log level");
+	ENSURE_EQUAL(fetchLevel(),"error","The log level should be changed");
+	
+	resp=httpPut(levelURL,"{\"level\":\"verbose\"}");
+	ENSURE_EQUAL(resp.status,400,"Unknown log levels should be rejected");
+	resp=httpPut(levelURL,"{\"severity\":\"info\"}");
+	ENSURE_EQUAL(resp.status,400,"Requests without a level should be rejected");
+	ENSURE_EQUAL(fetchLevel(),"error","Rejected requests should not change the log level");
+	
+	resp=httpPut(levelURL,"{\"level\":\"info\"}");
+	ENSURE_EQUAL(resp.status,200);
+}
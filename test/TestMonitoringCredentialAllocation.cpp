@@ -139,6 +139,27 @@ TEST(InternalAllocateMultipleCredentials) {
 	}
 }
 
+TEST(InternalAllocateSkipsRevokedCredential) {
+	DatabaseContext db;
+	auto store = db.makePersistentStore();
+
+	S3Credential c1("foo", "bar"), c2("baz", "quux");
+	ENSURE(store->addMonitoringCredential(c1));
+	ENSURE(store->addMonitoringCredential(c2));
+	ENSURE_EQUAL(store->countAvailableMonitoringCredentials(), 2, "Both credentials should be available");
+
+	bool result = store->revokeMonitoringCredential(c1.accessKey);
+	ENSURE_EQUAL(result, true, "It should be possible to revoke a credential which is not in use");
+	ENSURE_EQUAL(store->countAvailableMonitoringCredentials(), 1, "A revoked credential should not be available");
+
+	auto cred = std::get<0>(store->allocateMonitoringCredential());
+	ENSURE(cred);
+	ENSURE_EQUAL(cred, c2, "Only the credential which was not revoked should be allocated");
+
+	cred = std::get<0>(store->allocateMonitoringCredential());
+	ENSURE(!cred); //the revoked credential must not be allocated
+}
+
 TEST(InternalRevokeUnusedCredential) {
 	DatabaseContext db;
 	auto store = db.makePersistentStore();
@@ -0,0 +1,57 @@
+#include "test.h"
+
+#include <Process.h>
+
+TEST(ConcurrentOutputCollection){
+	startReaper();
+	//The child fills the pipe for its standard error before writing anything
+	//to its standard output, so both must be read at the same time
+	auto result=runCommand("sh",{"-c","yes | head -c 200000 >&2; echo done"});
+	ENSURE_EQUAL(result.status,0);
+	ENSURE_EQUAL(result.output,"done\n");
+	ENSURE_EQUAL(result.error.size(),200000);
+	ENSURE(!result.timedOut);
+	ENSURE(!result.truncated);
+	
+	//Likewise, input must be written while output is read, since the child's 
+	//output will fill its pipe long before all of the input is consumed
+	std::string input(1<<20,'x');
+	result=runCommandWithInput("cat",input);
+	ENSURE_EQUAL(result.status,0);
+	ENSURE_EQUAL(result.output.size(),input.size());
+	stopReaper();
+}
+
+TEST(CommandLimits){
+	startReaper();
+	auto start=std::chrono::steady_clock::now();
+	auto result=runCommand("sleep",{"30"},{},commandLimits(std::chrono::milliseconds(200)));
+	auto elapsed=std::chrono::steady_clock::now()-start;
+	ENSURE(result.timedOut,"A command exceeding its time limit should be reported");
+	ENSURE(elapsed<std::chrono::seconds(10),"A command exceeding its time limit should be stopped");
+	ENSURE(result.status!=0);
+	
+	result=runCommand("sh",{"-c","head -c 100000 /dev/zero; echo fail >&2"},{},
+	                  commandLimits(std::chrono::milliseconds::zero(),1000));
+	ENSURE_EQUAL(result.status,0,"Output beyond the size limit should be drained");
+	ENSURE_EQUAL(result.output.size(),1000);
+	ENSURE_EQUAL(result.error,"fail\n");
+	ENSURE(result.truncated);
+	stopReaper();
+}
+
+TEST(DefaultCommandLimits){
+	startReaper();
+	setDefaultCommandLimits("sleep",commandLimits(std::chrono::milliseconds(200)));
+	auto result=runCommand("sleep",{"30"});
+	ENSURE(result.timedOut,"A command's default limits should apply when none are given");
+	
+	result=runCommand("sleep",{"1"},{},commandLimits(std::chrono::seconds(20)));
+	ENSURE(!result.timedOut,"Limits given explicitly should replace the default");
+	ENSURE_EQUAL(result.status,0);
+	
+	setDefaultCommandLimits("sleep",commandLimits());
+	result=runCommand("sleep",{"1"});
+	ENSURE(!result.timedOut,"Removing a default limit should stop it being applied");
+	stopReaper();
+}
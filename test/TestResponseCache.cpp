@@ -0,0 +1,139 @@
+#include "test.h"
+
+#include <fstream>
+
+#include <dirent.h>
+
+#include <FileHandle.h>
+#include <client/ResponseCache.h>
+
+namespace{
+	std::vector<std::string> listFiles(const std::string& path){
+		std::vector<std::string> files;
+		DIR* dir=opendir(path.c_str());
+		if(!dir)
+			return files;
+		while(dirent* item=readdir(dir)){
+			std::string name=item->d_name;
+			if(name!="." && name!="..")
+				files.push_back(name);
+		}
+		closedir(dir);
+		return files;
+	}
+
+	///Records the requests a cache makes, answering them with a fixed response
+	struct FakeServer{
+		httpRequests::Response response;
+		std::vector<std::string> etagsSent;
+		std::function<httpRequests::Response(const std::string&)> handler(){
+			return [this](const std::string& etag){
+				etagsSent.push_back(etag);
+				return response;
+			};
+		}
+	};
+
+	const std::string url="https://slate.example.com/v1alpha3/clusters?token=secret-token";
+}
+
+TEST(ResponseCacheStoreAndFetch){
+	FileHandle dir=makeTemporaryDir("/tmp/slate_response_cache_");
+	ResponseCache cache(dir.path());
+	ResponseCache::Entry entry;
+	ENSURE(!cache.fetch(url,entry),"An empty cache should have no entries");
+
+	ResponseCache::Entry stored;
+	stored.stored=std::chrono::system_clock::time_point(std::chrono::seconds(1000));
+	stored.etag="\"abc\"";
+	stored.body="{\"items\":[]}\nsecond line";
+	cache.store(url,stored);
+	ENSURE(cache.fetch(url,entry),"A stored entry should be found");
+	ENSURE_EQUAL(entry.etag,stored.etag);
+	ENSURE_EQUAL(entry.body,stored.body);
+	ENSURE(entry.stored==stored.stored,"The storage time should be kept");
+	ENSURE(!cache.fetch(url+"&group=other",entry),"Entries should not be shared between URLs");
+
+	auto files=listFiles(dir.path());
+	ENSURE_EQUAL(files.size(),1);
+	ENSURE_EQUAL(files.front().size(),64,"Entries should be named by a SHA-256 digest of the URL");
+	ENSURE(files.front().find_first_not_of("0123456789abcdef")==std::string::npos,
+	       "Entry names should be hexadecimal");
+	std::ifstream file(dir.path()+"/"+files.front());
+	std::string contents((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+	ENSURE(contents.find("secret-token")==std::string::npos,"The token should not be written to disk");
+
+	//a second cache using the same directory, as a later run of the client
+	//would, should find the same entry
+	ResponseCache other(dir.path());
+	ENSURE(other.fetch(url,entry),"Entries should be found by later instances");
+}
+
+TEST(ResponseCacheDamagedEntry){
+	FileHandle dir=makeTemporaryDir("/tmp/slate_response_cache_");
+	ResponseCache cache(dir.path());
+	ResponseCache::Entry stored;
+	stored.stored=std::chrono::system_clock::now();
+	stored.body="data";
+	cache.store(url,stored);
+	auto files=listFiles(dir.path());
+	ENSURE_EQUAL(files.size(),1);
+	{
+		std::ofstream file(dir.path()+"/"+files.front());
+		file << "not a cache file";
+	}
+	ResponseCache::Entry entry;
+	ENSURE(!cache.fetch(url,entry),"A damaged entry should be treated as missing");
+}
+
+TEST(ResponseCacheRevalidation){
+	FileHandle dir=makeTemporaryDir("/tmp/slate_response_cache_");
+	ResponseCache cache(dir.path());
+	FakeServer server;
+	server.response=httpRequests::Response{200,"first",{{"etag","\"v1\""}}};
+
+	auto response=cache.get(url,std::chrono::seconds(0),server.handler());
+	ENSURE_EQUAL(response.status,200);
+	ENSURE_EQUAL(response.body,"first");
+	ENSURE_EQUAL(server.etagsSent.size(),1);
+	ENSURE_EQUAL(server.etagsSent.back(),"","No entity tag should be sent without a stored response");
+
+	//the server reports that the stored response is still current
+	server.response=httpRequests::Response{304,"",{{"etag","\"v1\""}}};
+	response=cache.get(url,std::chrono::seconds(0),server.handler());
+	ENSURE_EQUAL(server.etagsSent.size(),2,"A response with no freshness should be revalidated");
+	ENSURE_EQUAL(server.etagsSent.back(),"\"v1\"","The stored entity tag should be sent");
+	ENSURE_EQUAL(response.status,200,"A revalidated response should be reported as a success");
+	ENSURE_EQUAL(response.body,"first","The stored body should be used");
+
+	//the data has changed
+	server.response=httpRequests::Response{200,"second",{{"etag","\"v2\""}}};
+	response=cache.get(url,std::chrono::seconds(0),server.handler());
+	ENSURE_EQUAL(response.body,"second");
+	ResponseCache::Entry entry;
+	ENSURE(cache.fetch(url,entry));
+	ENSURE_EQUAL(entry.etag,"\"v2\"","A changed response should replace the stored one");
+	ENSURE_EQUAL(entry.body,"second");
+
+	//a fresh entry is used without asking the server
+	response=cache.get(url,std::chrono::seconds(3600),server.handler());
+	ENSURE_EQUAL(server.etagsSent.size(),3,"A fresh response should not be revalidated");
+	ENSURE_EQUAL(response.body,"second");
+
+	//failures are passed on and do not replace the stored response
+	server.response=httpRequests::Response{500,"error",{}};
+	response=cache.get(url,std::chrono::seconds(0),server.handler());
+	ENSURE_EQUAL(response.status,500);
+	ENSURE(cache.fetch(url,entry));
+	ENSURE_EQUAL(entry.body,"second","A failed request should not replace the stored response");
+}
+
+TEST(ResponseCacheUncacheable){
+	FileHandle dir=makeTemporaryDir("/tmp/slate_response_cache_");
+	ResponseCache cache(dir.path());
+	FakeServer server;
+	server.response=httpRequests::Response{200,"data",{}};
+	cache.get(url,std::chrono::seconds(0),server.handler());
+	ENSURE(listFiles(dir.path()).empty(),
+	       "A response which can be neither reused nor revalidated should not be stored");
+}
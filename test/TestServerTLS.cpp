@@ -0,0 +1,114 @@
+#include "test.h"
+
+#include <memory>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <FileHandle.h>
+#include <Process.h>
+#include <ServerTLS.h>
+
+namespace{
+	struct SSLDeleter{
+		void operator()(SSL* ssl) const{ SSL_free(ssl); }
+		void operator()(SSL_CTX* ctx) const{ SSL_CTX_free(ctx); }
+		void operator()(SSL_SESSION* session) const{ SSL_SESSION_free(session); }
+	};
+	using SSLHandle=std::unique_ptr<SSL,SSLDeleter>;
+	using SessionHandle=std::unique_ptr<SSL_SESSION,SSLDeleter>;
+
+	///Move whatever one side has written to the other side's input
+	void transfer(SSL* from, SSL* to){
+		char buffer[4096];
+		int n;
+		while((n=BIO_read(SSL_get_wbio(from),buffer,sizeof(buffer)))>0)
+			BIO_write(SSL_get_rbio(to),buffer,n);
+	}
+
+	bool stillWorking(SSL* ssl, int ret){
+		if(ret==1)
+			return false;
+		int err=SSL_get_error(ssl,ret);
+		return err==SSL_ERROR_WANT_READ || err==SSL_ERROR_WANT_WRITE;
+	}
+
+	///Connect a client to the server over memory buffers
+	///\param resume a session from an earlier connection to offer the server
+	///\return the session the client may use for its next connection, or
+	///        null if the handshake failed
+	SessionHandle connect(SSL_CTX* serverCtx, SSL_CTX* clientCtx, SSL_SESSION* resume,
+	                      bool& serverReused){
+		SSLHandle server(SSL_new(serverCtx)), client(SSL_new(clientCtx));
+		SSL_set_bio(server.get(),BIO_new(BIO_s_mem()),BIO_new(BIO_s_mem()));
+		SSL_set_bio(client.get(),BIO_new(BIO_s_mem()),BIO_new(BIO_s_mem()));
+		SSL_set_accept_state(server.get());
+		SSL_set_connect_state(client.get());
+		if(resume)
+			SSL_set_session(client.get(),resume);
+
+		bool clientDone=false, serverDone=false;
+		for(int round=0; round<20 && !(clientDone && serverDone); round++){
+			if(!clientDone){
+				int ret=SSL_do_handshake(client.get());
+				if(!stillWorking(client.get(),ret) && ret!=1)
+					return nullptr;
+				clientDone=(ret==1);
+			}
+			transfer(client.get(),server.get());
+			if(!serverDone){
+				int ret=SSL_do_handshake(server.get());
+				if(!stillWorking(server.get(),ret) && ret!=1)
+					return nullptr;
+				serverDone=(ret==1);
+			}
+			transfer(server.get(),client.get());
+		}
+		if(!clientDone || !serverDone)
+			return nullptr;
+		//With TLS 1.3 the server sends session tickets after the handshake,
+		//so the client must read them before it has a session to reuse
+		char byte;
+		SSL_read(client.get(),&byte,1);
+		serverReused=SSL_session_reused(server.get());
+		SessionHandle session(SSL_get1_session(client.get()));
+		//A session is only kept for reuse if the connection is closed cleanly
+		SSL_shutdown(client.get());
+		transfer(client.get(),server.get());
+		SSL_shutdown(server.get());
+		return session;
+	}
+}
+
+TEST(ServerTLSSessionResumption){
+	FileHandle dir=makeTemporaryDir("/tmp/slate_tls_test_");
+	TLSSettings settings;
+	settings.certificateFile=dir.path()+"/cert.pem";
+	settings.keyFile=dir.path()+"/key.pem";
+	startReaper();
+	auto result=runCommand("openssl",{"req","-x509","-newkey","rsa:2048","-nodes",
+	                                  "-keyout",settings.keyFile,"-out",settings.certificateFile,
+	                                  "-days","1","-subj","/CN=localhost"});
+	stopReaper();
+	ENSURE_EQUAL(result.status,0,"Generating a test certificate should succeed: "+result.error);
+
+	auto serverCtx=makeServerTLSContext(settings);
+	std::unique_ptr<SSL_CTX,SSLDeleter> clientCtx(SSL_CTX_new(TLS_client_method()));
+	SSL_CTX_set_verify(clientCtx.get(),SSL_VERIFY_NONE,nullptr);
+
+	std::string before=getTLSStatistics();
+	bool reused=true;
+	SessionHandle session=connect(serverCtx.native_handle(),clientCtx.get(),nullptr,reused);
+	ENSURE(session,"The first connection should succeed");
+	ENSURE(!reused,"The first connection should need a full handshake");
+	ENSURE(SSL_SESSION_is_resumable(session.get()),"The server should offer a resumable session");
+
+	SessionHandle second=connect(serverCtx.native_handle(),clientCtx.get(),session.get(),reused);
+	ENSURE(second,"The second connection should succeed");
+	ENSURE(reused,"The second connection should resume the first one's session");
+
+	std::string stats=getTLSStatistics();
+	ENSURE(stats!=before,"Handshakes should be counted");
+	ENSURE(stats.find("TLS resumed handshakes: 0")==std::string::npos,
+	       "The resumed handshake should be counted");
+}
@@ -95,3 +95,61 @@ TEST(generateSuffixedString) {
 
 }
 
+
+TEST(makeETag) {
+	auto tag = makeETag("epoch", "/v1alpha3/clusters?token=abc", {1, 2});
+	ENSURE_EQUAL(tag, makeETag("epoch", "/v1alpha3/clusters?token=abc", {1, 2}), "Entity tags should be deterministic");
+	ENSURE(tag.size() > 2 && tag.front() == '"' && tag.back() == '"', "Entity tags should be quoted");
+	ENSURE(tag != makeETag("epoch", "/v1alpha3/clusters?token=abc", {1, 3}), "Generation changes should change the tag");
+	ENSURE(tag != makeETag("epoch", "/v1alpha3/groups?token=abc", {1, 2}), "Different requests should have different tags");
+	ENSURE(tag != makeETag("other", "/v1alpha3/clusters?token=abc", {1, 2}), "Different epochs should have different tags");
+}
+
+TEST(matchesETag) {
+	const std::string tag = makeETag("epoch", "/v1alpha3/clusters", {7});
+	crow::request req;
+	ENSURE(!matchesETag(req, tag), "A request without If-None-Match should not match");
+
+	req.headers.emplace("If-None-Match", tag);
+	ENSURE(matchesETag(req, tag), "An identical tag should match");
+
+	req.headers.clear();
+	req.headers.emplace("If-None-Match", "\"stale\", W/" + tag);
+	ENSURE(matchesETag(req, tag), "A weak tag in a list should match");
+
+	req.headers.clear();
+	req.headers.emplace("If-None-Match", "\"stale\"");
+	ENSURE(!matchesETag(req, tag), "A different tag should not match");
+
+	req.headers.clear();
+	req.headers.emplace("If-None-Match", "*");
+	ENSURE(matchesETag(req, tag), "A wildcard should match");
+}
+
+TEST(FieldSelection) {
+	rapidjson::Document doc;
+	doc.Parse(R"({"apiVersion":"v1alpha3","kind":"Cluster",
+	              "metadata":{"id":"c1","name":"a","location":[{"lat":1,"lon":2},{"lat":3,"lon":4}]},
+	              "services":[]})");
+
+	FieldSelection none("");
+	ENSURE(none.all(), "An empty selection should include everything");
+	ENSURE(none.includes("/metadata/nodes"));
+
+	FieldSelection fields("/metadata/id, /metadata/location/*/lat");
+	ENSURE(!fields.all());
+	ENSURE(fields.includes("/metadata"), "Parents of selected fields are included");
+	ENSURE(fields.includes("/metadata/location"));
+	ENSURE(fields.includes("/metadata/location/1/lat"), "Wildcards should match array indices");
+	ENSURE(!fields.includes("/metadata/name"));
+	ENSURE(!fields.includes("/services"));
+
+	fields.apply(doc);
+	ENSURE(doc.HasMember("apiVersion") && doc.HasMember("kind"), "apiVersion and kind should always be kept");
+	ENSURE(!doc.HasMember("services"));
+	ENSURE_EQUAL(std::string(doc["metadata"]["id"].GetString()), "c1");
+	ENSURE(!doc["metadata"].HasMember("name"));
+	ENSURE_EQUAL(doc["metadata"]["location"].Size(), 2);
+	ENSURE(doc["metadata"]["location"][1].HasMember("lat"));
+	ENSURE(!doc["metadata"]["location"][1].HasMember("lon"));
+}
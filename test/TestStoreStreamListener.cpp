@@ -0,0 +1,104 @@
+#include "test.h"
+
+#include <chrono>
+#include <thread>
+
+#include <PersistentStore.h>
+#include <StoreStreamListener.h>
+
+namespace{
+	///Wait for a condition to hold, giving up after a while
+	template<typename Condition>
+	bool waitFor(Condition condition){
+		const auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(30);
+		while(!condition()){
+			if(std::chrono::steady_clock::now()>deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+		return true;
+	}
+}
+
+TEST(StreamInvalidatesOtherReplicaChanges){
+	DatabaseContext db;
+	if(db.usesEmbeddedStorage())
+		return; //streams are a DynamoDB feature
+
+	Aws::Auth::AWSCredentials credentials("foo","bar");
+	Aws::Client::ClientConfiguration clientConfig;
+	clientConfig.region="us-east-1";
+	clientConfig.scheme=Aws::Http::Scheme::HTTP;
+	clientConfig.endpointOverride="localhost:"+db.getDBPort();
+
+	//two stores stand in for two server replicas using the same database,
+	//of which only the second follows the streams
+	auto writerPtr=db.makePersistentStore();
+	auto readerPtr=db.makePersistentStore();
+	PersistentStore& writer=*writerPtr;
+	PersistentStore& reader=*readerPtr;
+	StoreStreamListener listener(reader,credentials,clientConfig,std::chrono::milliseconds(100));
+
+	Group group;
+	group.id=idGenerator.generateGroupID();
+	group.name="stream-group";
+	group.email="abc@def";
+	group.phone="123";
+	group.scienceField="Logic";
+	group.description=" ";
+	group.valid=true;
+
+	uint64_t generation=reader.getGeneration(StoreCollection::Groups);
+	ENSURE(writer.addGroup(group),"Group addition should succeed");
+	ENSURE(waitFor([&]{ return reader.getGeneration(StoreCollection::Groups)>generation; }),
+	       "A group added by another replica should be recorded as a change");
+
+	//cache the group in the replica which did not write it
+	Group cached=reader.getGroup(group.id);
+	ENSURE(cached,"Group should be found");
+	ENSURE_EQUAL(cached.email,group.email);
+
+	group.email="ghi@jkl";
+	generation=reader.getGeneration(StoreCollection::Groups);
+	ENSURE(writer.updateGroup(group),"Group update should succeed");
+	ENSURE(waitFor([&]{ return reader.getGeneration(StoreCollection::Groups)>generation; }),
+	       "A group updated by another replica should be recorded as a change");
+	ENSURE_EQUAL(reader.getGroup(group.id).email,group.email,
+	             "The cached copy of a group changed by another replica should be discarded");
+}
+
+TEST(StreamIgnoresOwnChanges){
+	DatabaseContext db;
+	if(db.usesEmbeddedStorage())
+		return; //streams are a DynamoDB feature
+
+	Aws::Auth::AWSCredentials credentials("foo","bar");
+	Aws::Client::ClientConfiguration clientConfig;
+	clientConfig.region="us-east-1";
+	clientConfig.scheme=Aws::Http::Scheme::HTTP;
+	clientConfig.endpointOverride="localhost:"+db.getDBPort();
+
+	auto storePtr=db.makePersistentStore();
+	PersistentStore& store=*storePtr;
+	StoreStreamListener listener(store,credentials,clientConfig,std::chrono::milliseconds(100));
+
+	Group group;
+	group.id=idGenerator.generateGroupID();
+	group.name="stream-group";
+	group.email="abc@def";
+	group.phone="123";
+	group.scienceField="Logic";
+	group.description=" ";
+	group.valid=true;
+
+	uint64_t generation=store.getGeneration(StoreCollection::Groups);
+	uint64_t revision=store.getChangeLog().currentRevision();
+	std::size_t applied=listener.recordsApplied();
+	ENSURE(store.addGroup(group),"Group addition should succeed");
+	ENSURE(waitFor([&]{ return listener.recordsApplied()>applied; }),
+	       "The addition should be reported by the stream");
+	ENSURE_EQUAL(store.getGeneration(StoreCollection::Groups),generation+1,
+	             "A change made by the store itself should be counted once");
+	ENSURE_EQUAL(store.getChangeLog().currentRevision(),revision+1,
+	             "A change made by the store itself should be logged once");
+}
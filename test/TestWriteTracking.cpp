@@ -0,0 +1,140 @@
+#include "test.h"
+
+#include <StorageBackend.h>
+
+namespace{
+	using Item=Aws::Map<Aws::String,Aws::DynamoDB::Model::AttributeValue>;
+	using namespace Aws::DynamoDB::Model;
+
+	const std::string table="items";
+
+	///Keeps items in memory by ID, supporting just enough of the API,
+	///including returned values, for the tracking backend's writes
+	class FakeBackend : public StorageBackend{
+	public:
+		DescribeTableOutcome DescribeTable(const DescribeTableRequest&) override{ return DescribeTableOutcome(); }
+		CreateTableOutcome CreateTable(const CreateTableRequest&) override{ return CreateTableOutcome(); }
+		UpdateTableOutcome UpdateTable(const UpdateTableRequest&) override{ return UpdateTableOutcome(); }
+		DeleteTableOutcome DeleteTable(const DeleteTableRequest&) override{ return DeleteTableOutcome(); }
+		DescribeTimeToLiveOutcome DescribeTimeToLive(const DescribeTimeToLiveRequest&) override{ return DescribeTimeToLiveOutcome(); }
+		UpdateTimeToLiveOutcome UpdateTimeToLive(const UpdateTimeToLiveRequest&) override{ return UpdateTimeToLiveOutcome(); }
+		GetItemOutcome GetItem(const GetItemRequest&) override{ return GetItemOutcome(); }
+		QueryOutcome Query(const QueryRequest&) override{ return QueryOutcome(); }
+		ScanOutcome Scan(const ScanRequest&) override{ return ScanOutcome(); }
+
+		PutItemOutcome PutItem(const PutItemRequest& request) override{
+			Item& stored=items[request.GetItem().find("ID")->second.GetS()];
+			PutItemResult result;
+			if(request.GetReturnValues()==ReturnValue::ALL_OLD)
+				result.SetAttributes(stored);
+			stored=request.GetItem();
+			return PutItemOutcome(std::move(result));
+		}
+		///Sets the attribute 'value' to the request's ':value'
+		UpdateItemOutcome UpdateItem(const UpdateItemRequest& request) override{
+			Item& stored=items[request.GetKey().find("ID")->second.GetS()];
+			for(const auto& key : request.GetKey())
+				stored[key.first]=key.second;
+			stored["value"]=request.GetExpressionAttributeValues().find(":value")->second;
+			UpdateItemResult result;
+			if(request.GetReturnValues()==ReturnValue::ALL_NEW)
+				result.SetAttributes(stored);
+			return UpdateItemOutcome(std::move(result));
+		}
+		DeleteItemOutcome DeleteItem(const DeleteItemRequest& request) override{
+			auto it=items.find(request.GetKey().find("ID")->second.GetS());
+			DeleteItemResult result;
+			if(it!=items.end()){
+				if(request.GetReturnValues()==ReturnValue::ALL_OLD)
+					result.SetAttributes(it->second);
+				items.erase(it);
+			}
+			return DeleteItemOutcome(std::move(result));
+		}
+
+		std::map<std::string,Item> items;
+	};
+
+	Item makeItem(const std::string& id, const std::string& value){
+		return Item{
+			{"ID",AttributeValue(id)},
+			{"sortKey",AttributeValue(id)},
+			{"value",AttributeValue(value)}
+		};
+	}
+
+	void put(WriteTrackingBackend& backend, const Item& item){
+		ENSURE(backend.PutItem(PutItemRequest().WithTableName(table).WithItem(item)).IsSuccess());
+	}
+
+	void update(WriteTrackingBackend& backend, const std::string& id, const std::string& value){
+		auto outcome=backend.UpdateItem(UpdateItemRequest()
+		                                .WithTableName(table)
+		                                .WithKey({{"ID",AttributeValue(id)},{"sortKey",AttributeValue(id)}})
+		                                .WithUpdateExpression("SET value = :value")
+		                                .WithExpressionAttributeValues({{":value",AttributeValue(value)}}));
+		ENSURE(outcome.IsSuccess());
+	}
+
+	void remove(WriteTrackingBackend& backend, const std::string& id){
+		auto outcome=backend.DeleteItem(DeleteItemRequest()
+		                                .WithTableName(table)
+		                                .WithKey({{"ID",AttributeValue(id)},{"sortKey",AttributeValue(id)}}));
+		ENSURE(outcome.IsSuccess());
+	}
+}
+
+TEST(WriteTrackingMatchesNewImage){
+	WriteTrackingBackend backend(std::unique_ptr<StorageBackend>(new FakeBackend));
+	backend.setTracking(true);
+
+	Item item=makeItem("a","1");
+	put(backend,item);
+	ENSURE(!backend.consumeWrite(table,"a","a",describeItemImage(makeItem("a","2"))),
+	       "A change with a different result should not be taken for this process's write");
+	ENSURE(backend.consumeWrite(table,"a","a",describeItemImage(item)),
+	       "A write should be recognized by the item's new image");
+	ENSURE(!backend.consumeWrite(table,"a","a",describeItemImage(item)),
+	       "A write should only be recognized once");
+
+	update(backend,"a","2");
+	ENSURE(backend.consumeWrite(table,"a","a",describeItemImage(makeItem("a","2"))),
+	       "An update should be recognized by the item's contents afterwards");
+
+	remove(backend,"a");
+	ENSURE(backend.consumeWrite(table,"a","a",""),"A deletion should be recognized");
+}
+
+TEST(WriteTrackingIgnoresUnchangedItems){
+	WriteTrackingBackend backend(std::unique_ptr<StorageBackend>(new FakeBackend));
+	backend.setTracking(true);
+
+	Item item=makeItem("b","1");
+	put(backend,item);
+	ENSURE(backend.consumeWrite(table,"b","b",describeItemImage(item)));
+
+	//rewriting the same contents produces no stream record, so it must not
+	//be remembered, where it could hide another process's later change
+	put(backend,item);
+	ENSURE(!backend.consumeWrite(table,"b","b",describeItemImage(item)),
+	       "A put which changed nothing should not be remembered");
+
+	//likewise for deleting an item which does not exist
+	remove(backend,"missing");
+	ENSURE(!backend.consumeWrite(table,"missing","missing",""),
+	       "Deleting a nonexistent item should not be remembered");
+}
+
+TEST(WriteTrackingDisabled){
+	WriteTrackingBackend backend(std::unique_ptr<StorageBackend>(new FakeBackend));
+	Item item=makeItem("c","1");
+	put(backend,item);
+	ENSURE(!backend.consumeWrite(table,"c","c",describeItemImage(item)),
+	       "Writes should not be remembered unless tracking is enabled");
+
+	backend.setTracking(true);
+	put(backend,makeItem("c","2"));
+	backend.setTracking(false);
+	ENSURE(!backend.consumeWrite(table,"c","c",describeItemImage(makeItem("c","2"))),
+	       "Disabling tracking should forget remembered writes");
+}
@@ -126,6 +126,10 @@ public:
 	~DatabaseContext();
 	
 	std::string getDBPort() const{ return dbPort; }
+	///Whether the embedded storage backend is used instead of DynamoDB, as
+	///requested by setting $SLATE_TEST_STORAGE to 'embedded'
+	bool usesEmbeddedStorage() const{ return embeddedStorage; }
+	std::string getStorageDirectory() const{ return configDir.path()+"/data"; }
 	std::string getPortalUserConfigPath() const{ return configDir.path()+"/slate_portal_user"; }
 	std::string getEncryptionKeyPath() const{ return configDir.path()+"/encryptionKey"; }
 	///Get the user record for the web-portal user
@@ -134,8 +138,11 @@ public:
 	std::string getPortalUserID() const{ return baseUser.id; }
 	///Fetch the web-portal user's administrator token
 	std::string getPortalToken() const{ return baseUser.token; }
-	std::unique_ptr<PersistentStore> makePersistentStore() const;
+	///\param route53Endpoint a Route53 stand-in for the store to use for DNS
+	///                       changes, if any
+	std::unique_ptr<PersistentStore> makePersistentStore(const std::string& route53Endpoint="") const;
 private:
+	bool embeddedStorage;
 	std::string dbPort;
 	FileHandle configDir;
 	User baseUser;
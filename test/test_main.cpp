@@ -70,12 +70,17 @@ test_registry()
 }
 
 DatabaseContext::DatabaseContext():
+embeddedStorage(false),
 configDir(makeTemporaryDir(".storeConfig")){
 	using namespace httpRequests;
 
-	auto dbResp=httpGet("http://localhost:52000/dynamo/create");
-	ENSURE_EQUAL(dbResp.status,200);
-	dbPort=dbResp.body;
+	std::string storage;
+	embeddedStorage=fetchFromEnvironment("SLATE_TEST_STORAGE",storage) && storage=="embedded";
+	if(!embeddedStorage){
+		auto dbResp=httpGet("http://localhost:52000/dynamo/create");
+		ENSURE_EQUAL(dbResp.status,200);
+		dbPort=dbResp.body;
+	}
 
 	{
 		baseUser.id="user_testtesttest";
@@ -110,16 +115,29 @@ configDir(makeTemporaryDir(".storeConfig")){
 }
 
 DatabaseContext::~DatabaseContext(){
-	httpRequests::httpDelete("http://localhost:52000/dynamo/"+dbPort);
+	if(!embeddedStorage)
+		httpRequests::httpDelete("http://localhost:52000/dynamo/"+dbPort);
 }
 
-std::unique_ptr<PersistentStore> DatabaseContext::makePersistentStore() const{
+std::unique_ptr<PersistentStore> DatabaseContext::makePersistentStore(const std::string& route53Endpoint) const{
 	Aws::Auth::AWSCredentials credentials("foo","bar"); //the credentials can be made up here
 	Aws::Client::ClientConfiguration clientConfig;
 	clientConfig.region="us-east-1"; //also arbitrary
 	clientConfig.scheme=Aws::Http::Scheme::HTTP;
 	clientConfig.endpointOverride="localhost:"+getDBPort();
 	
+	if(embeddedStorage)
+		return std::unique_ptr<PersistentStore>(new PersistentStore(std::unique_ptr<StorageBackend>(new EmbeddedBackend(getStorageDirectory())),
+		                                                            credentials,
+		                                                            clientConfig,
+		                                                            getPortalUserConfigPath(),
+		                                                            getEncryptionKeyPath(),
+		                                                            "",
+		                                                            0,
+		                                                            "slateci.net",
+		                                                            getTracer(),
+		                                                            1,
+		                                                            route53Endpoint));
 	return std::unique_ptr<PersistentStore>(new PersistentStore(credentials,
 	                                                            clientConfig,
 	                                                            getPortalUserConfigPath(),
@@ -127,7 +145,9 @@ std::unique_ptr<PersistentStore> DatabaseContext::makePersistentStore() const{
 	                                                            "",
 																0,
 																"slateci.net",
-	                                                            getTracer()));
+	                                                            getTracer(),
+	                                                            1,
+	                                                            route53Endpoint));
 }
 
 void TestContext::waitServerReady(){
@@ -244,8 +264,12 @@ TestContext::TestContext(std::vector<std::string> options){
 	ENSURE_EQUAL(portResp.status,200);
 	serverPort=portResp.body;
 	
-	options.insert(options.end(),{"--awsEndpoint","localhost:"+db.getDBPort(),
-	                              "--port",serverPort,
+	if(db.usesEmbeddedStorage())
+		options.insert(options.end(),{"--storageBackend","embedded",
+		                              "--storageDirectory",db.getStorageDirectory()});
+	else
+		options.insert(options.end(),{"--awsEndpoint","localhost:"+db.getDBPort()});
+	options.insert(options.end(),{"--port",serverPort,
 								  "--disableTelemetry", "true",
 	                              "--bootstrapUserFile",db.getPortalUserConfigPath(),
 	                              "--encryptionKeyFile",db.getEncryptionKeyPath()});